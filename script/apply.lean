@@ -75,20 +75,17 @@ do emit $ sformat! "obj* apply_{n}(obj* f, {arg_decls}) {{\n",
        emit $ sformat! "    lean_assert(arity > {max});\n",
        emit $ sformat! "    obj * as[{n}] = {{ {args} };\n",
        emit "    obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT\n",
-       emit "    for (unsigned i = 0; i < fixed; i++) { inc(fx(i)); args[i] = fx(i); }\n",
+       emit "    void * fn = take_fixed_args(f, args);\n",
        emit $ sformat! "    for (unsigned i = 0; i < {n}; i++) args[fixed+i] = as[i];\n",
-       emit "    obj * r = FNN(f)(args);\n",
-       emit "    dec_ref(f);\n",
-       emit "    return r;\n",
+       emit "    return reinterpret_cast<fnn>(fn)(args);\n",
      emit "  }\n",
    emit $ sformat! "} else if (arity < fixed + {n}) {{\n",
      if n ≥ 2 then do
        emit $ sformat! "  obj * as[{n}] = {{ {args} };\n",
        emit "  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT\n",
-       emit "  for (unsigned i = 0; i < fixed; i++) { inc(fx(i)); args[i] = fx(i); }\n",
+       emit "  void * fn = take_fixed_args(f, args);\n",
        emit "  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];\n",
-       emit "  obj * new_f = curry(f, arity, args);\n",
-       emit "  dec_ref(f);\n",
+       emit "  obj * new_f = curry(fn, arity, args);\n",
        emit $ sformat! "  return apply_n(new_f, {n}+fixed-arity, as+arity-fixed);\n"
      else emit "  lean_assert(fixed < arity);\n  lean_unreachable();\n",
    emit "} else {\n",
@@ -105,8 +102,7 @@ do emit "static obj* curry(void* f, unsigned n, obj** as) {\n",
      emit $ sformat! "case {i+1}: return reinterpret_cast<fn{i+1}>(f)({as});\n",
    emit "default: return reinterpret_cast<fnn>(f)(as);\n",
    emit "}\n",
-   emit "}\n",
-   emit "static obj* curry(obj* f, unsigned n, obj** as) { return curry(closure_fun(f), n, as); }\n"
+   emit "}\n"
 
 def mk_apply_n (max : nat) : m unit :=
 do emit "obj* apply_n(obj* f, unsigned n, obj** as) {\n",
@@ -126,17 +122,14 @@ do emit "obj* apply_m(obj* f, unsigned n, obj** as) {\n",
    emit "unsigned fixed = closure_num_fixed(f);\n",
    emit $ sformat! "if (arity == fixed + n) {{\n",
      emit "  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT\n",
-     emit "  for (unsigned i = 0; i < fixed; i++) { inc(fx(i)); args[i] = fx(i); }\n",
+     emit "  void * fn = take_fixed_args(f, args);\n",
      emit "  for (unsigned i = 0; i < n; i++) args[fixed+i] = as[i];\n",
-     emit "  obj * r = FNN(f)(args);\n",
-     emit "  dec_ref(f);\n",
-     emit "  return r;\n",
+     emit "  return reinterpret_cast<fnn>(fn)(args);\n",
    emit $ sformat! "} else if (arity < fixed + n) {{\n",
      emit "  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT\n",
-     emit "  for (unsigned i = 0; i < fixed; i++) { inc(fx(i)); args[i] = fx(i); }\n",
+     emit "  void * fn = take_fixed_args(f, args);\n",
      emit "  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];\n",
-     emit "  obj * new_f = FNN(f)(args);\n",
-     emit "  dec_ref(f);\n",
+     emit "  obj * new_f = reinterpret_cast<fnn>(fn)(args);\n",
      emit "  return apply_n(new_f, n+fixed-arity, as+arity-fixed);\n",
    emit "} else {\n",
      emit "  return fix_args(f, n, as);\n",
@@ -174,6 +167,22 @@ static obj* fix_args(obj* f, unsigned n, obj*const* as) {
 static inline obj* fix_args(obj* f, std::initializer_list<obj*> const & l) {
     return fix_args(f, l.size(), l.begin());
 }
+
+/* Store the fixed arguments of `f` at `args` and return the function pointer of `f`, consuming `f`.
+   If `f` is exclusive, the ownership of the arguments is transferred instead of incrementing their
+   reference counts and then decrementing them again when `f` is deleted. */
+static inline void* take_fixed_args(obj* f, obj** args) {
+    void * fn = closure_fun(f);
+    unsigned fixed = closure_num_fixed(f);
+    if (is_exclusive(f)) {
+        for (unsigned i = 0; i < fixed; i++) args[i] = fx(i);
+        free_closure_obj(f);
+    } else {
+        for (unsigned i = 0; i < fixed; i++) { inc(fx(i)); args[i] = fx(i); }
+        dec_ref(f);
+    }
+    return fn;
+}
 "
 
 def mk_copyright : m unit :=
@@ -74,6 +74,9 @@ instance thunkCoe : CoeTail α (Thunk α) where
   -- Since coercions are expanded eagerly, `a` is evaluated lazily.
   coe a := ⟨fun _ => a⟩
 
+instance [Inhabited α] : Inhabited (Thunk α) where
+  default := .pure default
+
 /-- A variation on `Eq.ndrec` with the equality argument first. -/
 abbrev Eq.ndrecOn.{u1, u2} {α : Sort u2} {a : α} {motive : α → Sort u1} {b : α} (h : a = b) (m : motive a) : motive b :=
   Eq.ndrec m h
@@ -393,6 +396,10 @@ Any priority higher than `Task.Priority.max` will result in the task being sched
 immediately on a dedicated thread. This is particularly useful for long-running and/or
 I/O-bound tasks since Lean will by default allocate no more non-dedicated workers
 than the number of cores to reduce context switches.
+
+Dedicated threads are kept in a separate pool and reused for later dedicated tasks. The size of
+the pool is unbounded by default; setting the environment variable `LEAN_NUM_IO_THREADS` limits it,
+in which case dedicated tasks wait for a free thread instead of being scheduled immediately.
 -/
 def Priority.dedicated : Priority := 9
 
@@ -6,6 +6,7 @@ Authors: Gabriel Ebner
 prelude
 import Init.Data.Array.Basic
 import Init.Data.Array.QSort
+import Init.Data.Array.Parallel
 import Init.Data.Array.BinSearch
 import Init.Data.Array.InsertionSort
 import Init.Data.Array.DecidableEq
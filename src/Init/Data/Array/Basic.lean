@@ -34,6 +34,13 @@ def isEmpty (a : Array α) : Bool :=
 def singleton (v : α) : Array α :=
   mkArray 1 v
 
+/--
+  Ensure that `a` has room for at least `n` more elements without reallocating.
+  This is the identity function from the logical point of view. -/
+@[extern "lean_array_reserve"]
+def reserve (a : Array α) (n : @& Nat) : Array α :=
+  a
+
 /-- Low-level version of `fget` which is as fast as a C array read.
    `Fin` values are represented as tag pointers in the Lean runtime. Thus,
    `fget` may be slightly slower than `uget`. -/
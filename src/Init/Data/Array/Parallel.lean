@@ -0,0 +1,99 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.Array.QSort
+
+/-!
+Parallel array combinators. The array is split into chunks of `grainSize` elements, and each chunk
+is processed by a task spawned on the thread pool. If `grainSize` is `0`, it is chosen such that
+there are at most `Array.parMaxChunks` chunks of at least `Array.parMinGrainSize` elements each.
+Arrays that fit into a single chunk are processed on the current thread.
+-/
+
+namespace Array
+
+/-- Minimal number of elements per chunk when the grain size is chosen automatically. -/
+def parMinGrainSize : Nat := 1024
+/-- Maximal number of chunks when the grain size is chosen automatically. -/
+def parMaxChunks : Nat := 64
+
+/-- Return the number of elements per chunk for an array of size `n`. -/
+def parGrainSize (n : Nat) (grainSize : Nat := 0) : Nat :=
+  if grainSize == 0 then max parMinGrainSize ((n + parMaxChunks - 1) / parMaxChunks) else grainSize
+
+/-- Return the bounds `[lo, hi)` of the chunks of an array of size `n`. -/
+def parChunks (n : Nat) (grainSize : Nat := 0) : Array (Nat × Nat) :=
+  let grainSize := parGrainSize n grainSize
+  let numChunks := (n + grainSize - 1) / grainSize
+  Nat.fold (fun i r => r.push (i * grainSize, min n ((i + 1) * grainSize))) numChunks (mkEmpty numChunks)
+
+/-- Apply `f` to the chunks of an array of size `n` in parallel, and return the results in order. -/
+@[inline] def parChunkMap (n : Nat) (f : Nat → Nat → β) (grainSize : Nat := 0) (prio := Task.Priority.default) : Array β :=
+  let chunks := parChunks n grainSize
+  if chunks.size ≤ 1 then
+    chunks.map fun (lo, hi) => f lo hi
+  else
+    let tasks := chunks.map fun (lo, hi) => Task.spawn (prio := prio) fun _ => f lo hi
+    tasks.map Task.get
+
+/-- Parallel version of `Array.map`. -/
+@[inline] def parMap (f : α → β) (as : Array α) (grainSize : Nat := 0) (prio := Task.Priority.default) : Array β :=
+  if as.size ≤ parGrainSize as.size grainSize then
+    as.map f
+  else
+    let rs := parChunkMap as.size (grainSize := grainSize) (prio := prio) fun lo hi =>
+      as.foldl (fun r a => r.push (f a)) (mkEmpty (hi - lo)) lo hi
+    rs.foldl (· ++ ·) (mkEmpty as.size)
+
+/--
+  Parallel version of `Array.foldl`. Each chunk is folded with `f` starting from `init`, and the results
+  are combined from left to right using `combine`. The result agrees with `as.foldl f init` if `combine`
+  is associative with `init` as its neutral element, and `f (combine b c) a = combine b (f c a)`. -/
+@[inline] def parFoldl (f : β → α → β) (combine : β → β → β) (init : β) (as : Array α) (grainSize : Nat := 0)
+    (prio := Task.Priority.default) : β :=
+  if as.size ≤ parGrainSize as.size grainSize then
+    as.foldl f init
+  else
+    let rs := parChunkMap as.size (grainSize := grainSize) (prio := prio) fun lo hi =>
+      as.foldl f init lo hi
+    rs.foldl combine init
+
+/-- Merge the arrays `xs` and `ys`, which must be sorted with respect to `lt`. -/
+@[specialize] partial def mergeSorted [Inhabited α] (lt : α → α → Bool) (xs ys : Array α) : Array α :=
+  let rec loop (i j : Nat) (r : Array α) : Array α :=
+    if i < xs.size then
+      if j < ys.size then
+        if lt ys[j]! xs[i]! then
+          loop i (j+1) (r.push ys[j]!)
+        else
+          loop (i+1) j (r.push xs[i]!)
+      else
+        xs.foldl (·.push ·) r i
+    else
+      ys.foldl (·.push ·) r j
+  loop 0 0 (mkEmpty (xs.size + ys.size))
+
+/--
+  Parallel version of `Array.qsort`. The chunks are sorted in parallel using `qsort`, and then merged
+  pairwise, again in parallel, until a single array remains. -/
+@[inline] partial def parQSort {α : Type} [Inhabited α] (as : Array α) (lt : α → α → Bool) (grainSize : Nat := 0)
+    (prio := Task.Priority.default) : Array α :=
+  let rec @[specialize] merge (chunks : Array (Array α)) : Array α :=
+    if chunks.size ≤ 1 then
+      chunks.getD 0 #[]
+    else
+      let tasks := parChunks chunks.size 2 |>.map fun (lo, hi) =>
+        if hi - lo == 2 then
+          Task.spawn (prio := prio) fun _ => mergeSorted lt chunks[lo]! chunks[lo+1]!
+        else
+          Task.pure chunks[lo]!
+      merge (tasks.map Task.get)
+  if as.size ≤ parGrainSize as.size grainSize then
+    as.qsort lt
+  else
+    merge <| parChunkMap as.size (grainSize := grainSize) (prio := prio) fun lo hi =>
+      (as.extract lo hi).qsort lt
+
+end Array
@@ -5,3 +5,4 @@ Author: Leonardo de Moura
 -/
 prelude
 import Init.Data.ByteArray.Basic
+import Init.Data.ByteArray.Subarray
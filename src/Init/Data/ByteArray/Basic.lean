@@ -70,6 +70,13 @@ def uset : (a : ByteArray) → (i : USize) → UInt8 → i.toNat < a.size → By
 def isEmpty (s : ByteArray) : Bool :=
   s.size == 0
 
+/--
+  Ensure that `a` has room for at least `n` more bytes without reallocating.
+  This is the identity function from the logical point of view. -/
+@[extern "lean_sarray_reserve"]
+def reserve (a : ByteArray) (n : @& Nat) : ByteArray :=
+  a
+
 /--
   Copy the slice at `[srcOff, srcOff + len)` in `src` to `[destOff, destOff + len)` in `dest`, growing `dest` if necessary.
   If `exact` is `false`, the capacity will be doubled when grown. -/
@@ -102,6 +109,20 @@ partial def toList (bs : ByteArray) : List UInt8 :=
       none
   loop start
 
+/-- Set all bytes of `a` to `v`. -/
+@[extern "lean_byte_array_fill"]
+def fill : ByteArray → UInt8 → ByteArray
+  | ⟨bs⟩, v => ⟨mkArray bs.size v⟩
+
+@[extern "lean_byte_array_index_of"]
+def indexOfAux (a : @& ByteArray) (v : UInt8) (start : @& Nat) : Nat :=
+  (a.findIdx? (· == v) start).getD a.size
+
+/-- Return the index of the first occurrence of `v` at or after `start`, using `memchr` in the runtime. -/
+@[inline] def indexOf? (a : ByteArray) (v : UInt8) (start := 0) : Option Nat :=
+  let i := a.indexOfAux v start
+  if i < a.size then some i else none
+
 /--
   We claim this unsafe implementation is correct because an array cannot have more than `usizeSz` elements in our runtime.
   This is similar to the `Array` version.
@@ -0,0 +1,111 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ByteArray.Basic
+
+universe v w
+
+/--
+  A view of the bytes at `[start, stop)` in `bs`. Creating and reading a `ByteSubarray` does not copy
+  the underlying bytes; use `ByteSubarray.toByteArray` to materialize it. -/
+structure ByteSubarray where
+  bs : ByteArray
+  start : Nat
+  stop : Nat
+  h₁ : start ≤ stop
+  h₂ : stop ≤ bs.size
+
+namespace ByteSubarray
+
+def size (s : ByteSubarray) : Nat :=
+  s.stop - s.start
+
+def isEmpty (s : ByteSubarray) : Bool :=
+  s.size == 0
+
+def get (s : ByteSubarray) (i : Fin s.size) : UInt8 :=
+  have : s.start + i.val < s.bs.size := by
+   apply Nat.lt_of_lt_of_le _ s.h₂
+   have := i.isLt
+   simp [size] at this
+   rw [Nat.add_comm]
+   exact Nat.add_lt_of_lt_sub this
+  s.bs[s.start + i.val]
+
+instance : GetElem ByteSubarray Nat UInt8 fun xs i => i < xs.size where
+  getElem xs i h := xs.get ⟨i, h⟩
+
+@[inline] def getD (s : ByteSubarray) (i : Nat) (v₀ : UInt8) : UInt8 :=
+  if h : i < s.size then s.get ⟨i, h⟩ else v₀
+
+abbrev get! (s : ByteSubarray) (i : Nat) : UInt8 :=
+  getD s i default
+
+def popFront (s : ByteSubarray) : ByteSubarray :=
+  if h : s.start < s.stop then
+    { s with start := s.start + 1, h₁ := Nat.le_of_lt_succ (Nat.add_lt_add_right h 1) }
+  else
+    s
+
+/-- Copy the bytes of the view into a fresh `ByteArray`. -/
+def toByteArray (s : ByteSubarray) : ByteArray :=
+  s.bs.extract s.start s.stop
+
+@[inline] unsafe def forInUnsafe {β : Type v} {m : Type v → Type w} [Monad m] (s : ByteSubarray) (b : β) (f : UInt8 → β → m (ForInStep β)) : m β :=
+  let sz := USize.ofNat s.stop
+  let rec @[specialize] loop (i : USize) (b : β) : m β := do
+    if i < sz then
+      let a := s.bs.uget i lcProof
+      match (← f a b) with
+      | ForInStep.done  b => pure b
+      | ForInStep.yield b => loop (i+1) b
+    else
+      pure b
+  loop (USize.ofNat s.start) b
+
+/-- Reference implementation of `forIn`. The compiled code uses `forInUnsafe`, which avoids the bounds checks. -/
+@[implemented_by ByteSubarray.forInUnsafe]
+protected def forIn {β : Type v} {m : Type v → Type w} [Monad m] (s : ByteSubarray) (b : β) (f : UInt8 → β → m (ForInStep β)) : m β :=
+  let rec loop (i : Nat) (b : β) : Nat → m β
+    | 0   => pure b
+    | n+1 => do
+      match (← f (s.bs.get! i) b) with
+      | ForInStep.done  b => pure b
+      | ForInStep.yield b => loop (i+1) b n
+  loop s.start b s.size
+
+instance : ForIn m ByteSubarray UInt8 where
+  forIn := ByteSubarray.forIn
+
+@[inline]
+def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → UInt8 → m β) (init : β) (s : ByteSubarray) : m β :=
+  s.bs.foldlM f (init := init) (start := s.start) (stop := s.stop)
+
+@[inline]
+def foldl {β : Type v} (f : β → UInt8 → β) (init : β) (s : ByteSubarray) : β :=
+  Id.run <| s.foldlM f init
+
+end ByteSubarray
+
+namespace ByteArray
+
+/-- Create a view of the bytes at `[start, stop)` in `bs` without copying them. Out-of-range bounds are clamped. -/
+def toSubarray (bs : ByteArray) (start : Nat := 0) (stop : Nat := bs.size) : ByteSubarray :=
+  if h₂ : stop ≤ bs.size then
+     if h₁ : start ≤ stop then
+       { bs := bs, start := start, stop := stop, h₁ := h₁, h₂ := h₂ }
+     else
+       { bs := bs, start := stop, stop := stop, h₁ := Nat.le_refl _, h₂ := h₂ }
+  else
+     if h₁ : start ≤ bs.size then
+       { bs := bs, start := start, stop := bs.size, h₁ := h₁, h₂ := Nat.le_refl _ }
+     else
+       { bs := bs, start := bs.size, stop := bs.size, h₁ := Nat.le_refl _, h₂ := Nat.le_refl _ }
+
+end ByteArray
+
+instance : Coe ByteSubarray ByteArray := ⟨ByteSubarray.toByteArray⟩
+
+instance : ToString ByteSubarray := ⟨fun s => toString s.toByteArray⟩
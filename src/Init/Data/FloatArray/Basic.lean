@@ -76,6 +76,13 @@ def set! : FloatArray → (@& Nat) → Float → FloatArray
 def isEmpty (s : FloatArray) : Bool :=
   s.size == 0
 
+/--
+  Ensure that `a` has room for at least `n` more elements without reallocating.
+  This is the identity function from the logical point of view. -/
+@[extern "lean_sarray_reserve"]
+def reserve (a : FloatArray) (n : @& Nat) : FloatArray :=
+  a
+
 partial def toList (ds : FloatArray) : List Float :=
   let rec loop (i r) :=
     if h : i < ds.size then
@@ -158,6 +165,45 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → Float →
 def foldl {β : Type v} (f : β → Float → β) (init : β) (as : FloatArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/-- Set all elements of `ds` to `v`. -/
+@[extern "lean_float_array_fill"]
+def fill : FloatArray → Float → FloatArray
+  | ⟨ds⟩, v => ⟨mkArray ds.size v⟩
+
+/--
+  Sum of all elements. The runtime implementation uses several partial sums so that it can be vectorized,
+  so the result may differ in rounding from a sequential `foldl`. -/
+@[extern "lean_float_array_sum"]
+def sum (ds : @& FloatArray) : Float :=
+  ds.foldl (· + ·) 0
+
+/-- Dot product of the first `min ds.size es.size` elements. Rounding may differ as in `FloatArray.sum`. -/
+@[extern "lean_float_array_dot"]
+def dot (ds es : @& FloatArray) : Float :=
+  Nat.fold (fun i acc => acc + ds.get! i * es.get! i) (min ds.size es.size) 0
+
+/-- See comment at `forInUnsafe` -/
+@[inline]
+unsafe def mapUnsafe (f : Float → Float) (ds : FloatArray) : FloatArray :=
+  let sz := USize.ofNat ds.size
+  let rec @[specialize] loop (i : USize) (ds : FloatArray) : FloatArray :=
+    if i < sz then
+      loop (i+1) (ds.uset i (f (ds.uget i lcProof)) lcProof)
+    else
+      ds
+  loop 0 ds
+
+/-- Apply `f` to all elements, updating `ds` in place if it is not shared. -/
+@[implemented_by mapUnsafe]
+def map (f : Float → Float) (ds : FloatArray) : FloatArray :=
+  ⟨ds.data.map f⟩
+
+/-- Combine the first `min ds.size es.size` elements of `ds` and `es` using `f`. -/
+@[inline]
+def zipWith (f : Float → Float → Float) (ds es : FloatArray) : FloatArray :=
+  let n := min ds.size es.size
+  Nat.fold (fun i r => r.push (f (ds.get! i) (es.get! i))) n (mkEmpty n)
+
 end FloatArray
 
 def List.toFloatArray (ds : List Float) : FloatArray :=
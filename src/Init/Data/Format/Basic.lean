@@ -111,13 +111,16 @@ private structure SpaceResult where
     let r₂ := r₂ (w - r₁.space);
     { r₂ with space := r₁.space + r₂.space }
 
+/-- Space used by `s` from position `start` up to the next line break. -/
+private def spaceUptoLineText (s : String) (start : String.Pos) (flatten : Bool) : SpaceResult :=
+  let p := s.posOfAux '\n' s.endPos start
+  let off := if start == 0 then s.offsetOfPos p else (s.extract start p).length
+  { foundLine := p != s.endPos, foundFlattenedHardLine := flatten && p != s.endPos, space := off }
+
 private def spaceUptoLine : Format → Bool → Nat → SpaceResult
   | nil,          _,       _ => {}
   | line,         flatten, _ => if flatten then { space := 1 } else { foundLine := true }
-  | text s,       flatten, _ =>
-    let p := s.posOf '\n';
-    let off := s.offsetOfPos p;
-    { foundLine := p != s.endPos, foundFlattenedHardLine := flatten && p != s.endPos, space := off }
+  | text s,       flatten, _ => spaceUptoLineText s 0 flatten
   | append f₁ f₂, flatten, w => merge w (spaceUptoLine f₁ flatten w) (spaceUptoLine f₂ flatten)
   | nest _ f,     flatten, w => spaceUptoLine f flatten w
   | group f _,    _,       w => spaceUptoLine f true w
@@ -127,16 +130,24 @@ private structure WorkItem where
   f : Format
   indent : Int
   activeTags : Nat
+  /-- If `f` is `text s`, the part of `s` before `textPos` has already been output. Only text items can have a nonzero
+  `textPos`, so that rendering a text with many line breaks does not copy its remainder after each of them. -/
+  textPos : String.Pos := 0
 
 private structure WorkGroup where
   flatten : Bool
   flb     : FlattenBehavior
   items   : List WorkItem
 
+private def WorkItem.spaceUptoLine (i : WorkItem) (flatten : Bool) (w : Nat) : SpaceResult :=
+  match i.f with
+  | text s => spaceUptoLineText s i.textPos flatten
+  | f      => Format.spaceUptoLine f flatten w
+
 private partial def spaceUptoLine' : List WorkGroup → Nat → SpaceResult
   |   [],                         _ => {}
   |   { items := [],    .. }::gs, w => spaceUptoLine' gs w
-  | g@{ items := i::is, .. }::gs, w => merge w (spaceUptoLine i.f g.flatten w) (spaceUptoLine' ({ g with items := is }::gs))
+  | g@{ items := i::is, .. }::gs, w => merge w (i.spaceUptoLine g.flatten w) (spaceUptoLine' ({ g with items := is }::gs))
 
 /-- A monad in which we can pretty-print `Format` objects. -/
 class MonadPrettyFormat (m : Type → Type) where
@@ -173,15 +184,15 @@ private partial def be (w : Nat) [Monad m] [MonadPrettyFormat m] : List WorkGrou
     | append f₁ f₂ => be w (gs' ({ i with f := f₁, activeTags := 0 }::{ i with f := f₂ }::is))
     | nest n f => be w (gs' ({ i with f, indent := i.indent + n }::is))
     | text s =>
-      let p := s.posOf '\n'
+      let p := s.posOfAux '\n' s.endPos i.textPos
       if p == s.endPos then
-        pushOutput s
+        pushOutput (if i.textPos == 0 then s else s.extract i.textPos p)
         endTags i.activeTags
         be w (gs' is)
       else
-        pushOutput (s.extract {} p)
+        pushOutput (s.extract i.textPos p)
         pushNewline i.indent.toNat
-        let is := { i with f := text (s.extract (s.next p) s.endPos) }::is
+        let is := { i with textPos := s.next p }::is
         -- after a hard line break, re-evaluate whether to flatten the remaining group
         pushGroup g.flb is gs w >>= be w
     | line =>
@@ -265,7 +276,7 @@ private structure State where
 instance : MonadPrettyFormat (StateM State) where
   -- We avoid a structure instance update, and write these functions using pattern matching because of issue #316
   pushOutput s       := modify fun ⟨out, col⟩ => ⟨out ++ s, col + s.length⟩
-  pushNewline indent := modify fun ⟨out, _⟩ => ⟨out ++ "\n".pushn ' ' indent, indent⟩
+  pushNewline indent := modify fun ⟨out, _⟩ => ⟨(out.push '\n').pushn ' ' indent, indent⟩
   currColumn         := return (← get).column
   startTag _         := return ()
   endTags _          := return ()
@@ -59,6 +59,28 @@ instance : Ord USize where
 instance : Ord Char where
   compare x y := compareOfLessAndEq x y
 
+def ByteArray.compareAux (a b : ByteArray) (i : Nat) : Ordering :=
+  if h : i < a.size then
+    if h' : i < b.size then
+      match compare a[i] b[i] with
+      | .eq => compareAux a b (i+1)
+      | o   => o
+    else
+      .gt
+  else if i < b.size then .lt else .eq
+termination_by _ => a.size - i
+
+/-- The lexicographic order on byte arrays, implemented using `memcmp` in the runtime. -/
+@[extern "lean_byte_array_compare"]
+protected def ByteArray.compare (a b : @& ByteArray) : Ordering :=
+  ByteArray.compareAux a b 0
+
+instance : Ord ByteArray where
+  compare := ByteArray.compare
+
+instance : BEq ByteArray where
+  beq a b := ByteArray.compare a b == .eq
+
 /-- The lexicographic order on pairs. -/
 def lexOrd [Ord α] [Ord β] : Ord (α × β) where
   compare p1 p2 := match compare p1.1 p2.1 with
@@ -133,7 +133,9 @@ def toDigitsCore (base : Nat) : Nat → Nat → List Char → List Char
 def toDigits (base : Nat) (n : Nat) : List Char :=
   toDigitsCore base (n+1) n []
 
-protected def repr (n : Nat) : String :=
+/-- The decimal representation of `n`. The runtime formats it two digits at a time instead of building a list. -/
+@[extern "lean_nat_repr"]
+protected def repr (n : @& Nat) : String :=
   (toDigits 10 n).asString
 
 def superDigitChar (n : Nat) : Char :=
@@ -119,7 +119,9 @@ partial def posOfAux (s : String) (c : Char) (stopPos : Pos) (pos : Pos) : Pos :
   else if s.get pos == c then pos
        else posOfAux s c stopPos (s.next pos)
 
-@[inline] def posOf (s : String) (c : Char) : Pos :=
+/-- Position of the first occurrence of `c` in `s`, or `s.endPos` if there is none. The runtime searches with `memchr`. -/
+@[extern "lean_string_pos_of"]
+def posOf (s : @& String) (c : Char) : Pos :=
   posOfAux s c s.endPos 0
 
 partial def revPosOfAux (s : String) (c : Char) (pos : Pos) : Option Pos :=
@@ -197,9 +199,15 @@ partial def splitOnAux (s sep : String) (b : Pos) (i : Pos) (j : Pos) (r : List
     else
       splitOnAux s sep b i j r
   else
-    splitOnAux s sep b (s.next i) 0 r
+    -- continue after the start of the partial match, which may overlap with the next occurrence of `sep`
+    splitOnAux s sep b (s.next (i - j)) 0 r
 
-def splitOn (s : String) (sep : String := " ") : List String :=
+/--
+Split `s` at the occurrences of `sep`, from left to right. If `sep` is empty, the result is `[s]`. The runtime
+searches for `sep` with `memchr` and `memcmp` instead of comparing one character at a time.
+-/
+@[extern "lean_string_split_on"]
+def splitOn (s : @& String) (sep : @& String := " ") : List String :=
   if sep == "" then [s] else splitOnAux s sep 0 0 0 []
 
 instance : Inhabited String := ⟨""⟩
@@ -305,7 +313,9 @@ partial def offsetOfPosAux (s : String) (pos : Pos) (i : Pos) (offset : Nat) : N
   else
     offsetOfPosAux s pos (s.next i) (offset+1)
 
-def offsetOfPos (s : String) (pos : Pos) : Nat :=
+/-- Number of codepoints before `pos`. The runtime counts them using vector instructions where available. -/
+@[extern "lean_string_offset_of_pos"]
+def offsetOfPos (s : @& String) (pos : @& Pos) : Nat :=
   offsetOfPosAux s pos 0 0
 
 @[specialize] partial def foldlAux {α : Type u} (f : α → Char → α) (s : String) (stopPos : Pos) (i : Pos) (a : α) : α :=
@@ -339,7 +349,8 @@ anyAux s s.endPos p 0
 @[inline] def all (s : String) (p : Char → Bool) : Bool :=
 !s.any (fun c => !p c)
 
-def contains (s : String) (c : Char) : Bool :=
+@[extern "lean_string_contains"]
+def contains (s : @& String) (c : Char) : Bool :=
 s.any (fun a => a == c)
 
 @[specialize] partial def mapAux (f : Char → Char) (i : Pos) (s : String) : String :=
@@ -355,7 +366,9 @@ s.any (fun a => a == c)
 def isNat (s : String) : Bool :=
   !s.isEmpty && s.all (·.isDigit)
 
-def toNat? (s : String) : Option Nat :=
+/-- The number `s` is the decimal representation of, if any. The runtime parses eight digits at a time. -/
+@[extern "lean_string_to_nat"]
+def toNat? (s : @& String) : Option Nat :=
   if s.isNat then
     some <| s.foldl (fun n c => n*10 + (c.toNat - '0'.toNat)) 0
   else
@@ -379,17 +392,21 @@ where
 def isPrefixOf (p : String) (s : String) : Bool :=
   substrEq p 0 s 0 p.endPos.byteIdx
 
-/-- Replace all occurrences of `pattern` in `s` with `replacment`. -/
-partial def replace (s pattern replacement : String) : String :=
-  loop "" 0 0
-where
-  loop (acc : String) (accStop pos : String.Pos) :=
-    if pos.byteIdx + pattern.endPos.byteIdx > s.endPos.byteIdx then
-      acc ++ s.extract accStop s.endPos
-    else if s.substrEq pos pattern 0 pattern.endPos.byteIdx then
-      loop (acc ++ s.extract accStop pos ++ replacement) (pos + pattern) (pos + pattern)
-    else
-      loop acc accStop (s.next pos)
+partial def replaceAux (s pattern replacement : String) (acc : String) (accStop pos : String.Pos) : String :=
+  if pos.byteIdx + pattern.endPos.byteIdx > s.endPos.byteIdx then
+    acc ++ s.extract accStop s.endPos
+  else if s.substrEq pos pattern 0 pattern.endPos.byteIdx then
+    replaceAux s pattern replacement (acc ++ s.extract accStop pos ++ replacement) (pos + pattern) (pos + pattern)
+  else
+    replaceAux s pattern replacement acc accStop (s.next pos)
+
+/--
+Replace all occurrences of `pattern` in `s` with `replacement`, from left to right. If `pattern` is empty, `s` is
+returned unchanged. The runtime searches for `pattern` like `splitOn`.
+-/
+@[extern "lean_string_replace"]
+def replace (s pattern replacement : @& String) : String :=
+  if pattern.isEmpty then s else replaceAux s pattern replacement "" 0 0
 
 end String
 
@@ -476,7 +493,7 @@ partial def splitOn (s : Substring) (sep : String := " ") : List Substring :=
         else
           loop b i j r
       else
-        loop b (s.next i) 0 r
+        loop b (s.next (i-j)) 0 r
     loop 0 0 0 []
 
 @[inline] def foldl {α : Type u} (f : α → Char → α) (init : α) (s : Substring) : α :=
@@ -584,10 +601,14 @@ def takeRightWhile (s : String) (p : Char → Bool) : String :=
 def dropRightWhile (s : String) (p : Char → Bool) : String :=
   (s.toSubstring.dropRightWhile p).toString
 
-def startsWith (s pre : String) : Bool :=
+/-- Whether `pre` is a prefix of `s`. The runtime compares the bytes with `memcmp`. -/
+@[extern "lean_string_starts_with"]
+def startsWith (s pre : @& String) : Bool :=
   s.toSubstring.take pre.length == pre.toSubstring
 
-def endsWith (s post : String) : Bool :=
+/-- Whether `post` is a suffix of `s`. The runtime compares the bytes with `memcmp`. -/
+@[extern "lean_string_ends_with"]
+def endsWith (s post : @& String) : Bool :=
   s.toSubstring.takeRight post.length == post.toSubstring
 
 def trimRight (s : String) : String :=
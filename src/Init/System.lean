@@ -9,3 +9,6 @@ import Init.System.Platform
 import Init.System.Uri
 import Init.System.Mutex
 import Init.System.Promise
+import Init.System.ConcurrentHashMap
+import Init.System.BoundedChannel
+import Init.System.TaskGroup
@@ -0,0 +1,108 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+
+namespace IO
+
+private opaque BoundedChannelImpl (α : Type) : NonemptyType.{0}
+
+/--
+FIFO channel with a bounded buffer, implemented by a lock-free ring buffer in the runtime, where `recv?` returns a
+`Task`. Unlike `IO.Channel`, sending and receiving do not take any lock unless the buffer is full or empty, so it is
+suitable for pipelines of tasks that exchange many messages.
+
+A channel can be closed. Once it is closed, all `send`s are ignored, and `recv?` returns `none` once the buffer is
+empty. Messages are marked as multi-threaded when they are sent.
+-/
+def BoundedChannel (α : Type) : Type := (BoundedChannelImpl α).type
+
+instance : Nonempty (BoundedChannel α) := (BoundedChannelImpl α).property
+
+/-- Creates a new `BoundedChannel`. `capacity` is rounded up to a power of two. -/
+@[extern "lean_io_bounded_channel_new"]
+opaque BoundedChannel.new (capacity : @& Nat := 1024) : BaseIO (BoundedChannel α)
+
+namespace BoundedChannel
+
+/-- Number of messages that can be buffered. -/
+@[extern "lean_bounded_channel_capacity"]
+opaque capacity (ch : @& BoundedChannel α) : Nat
+
+/--
+Sends a message on a `BoundedChannel`.
+
+This function blocks while the buffer is full, so it should only be used in dedicated threads unless the consumers
+are known to keep up. See `trySend`.
+-/
+@[extern "lean_io_bounded_channel_send"]
+opaque send (v : α) (ch : @& BoundedChannel α) : BaseIO Unit
+
+/-- Sends a message on a `BoundedChannel` if its buffer is not full, and returns `false` otherwise. -/
+@[extern "lean_io_bounded_channel_try_send"]
+opaque trySend (v : α) (ch : @& BoundedChannel α) : BaseIO Bool
+
+/-- Closes a `BoundedChannel`. Producers waiting in `send` drop their message. -/
+@[extern "lean_io_bounded_channel_close"]
+opaque close (ch : @& BoundedChannel α) : BaseIO Unit
+
+/--
+Receives a message, without blocking.
+The returned task waits for the message.
+Every message is only received once.
+
+Returns `none` if the channel is closed and the buffer is empty.
+-/
+@[extern "lean_io_bounded_channel_recv"]
+opaque recv? (ch : @& BoundedChannel α) : BaseIO (Task (Option α))
+
+/--
+`ch.forAsync f` calls `f` for every messages received on `ch`.
+
+Note that if this function is called twice, each `forAsync` only gets half the messages.
+-/
+partial def forAsync (f : α → BaseIO Unit) (ch : BoundedChannel α)
+    (prio : Task.Priority := .default) : BaseIO (Task Unit) := do
+  BaseIO.bindTask (prio := prio) (← ch.recv?) fun
+    | none => return .pure ()
+    | some v => do f v; ch.forAsync f prio
+
+/-- Type tag for synchronous (blocking) operations on a `BoundedChannel`. -/
+def Sync := BoundedChannel
+
+/--
+Accesses synchronous (blocking) version of channel operations.
+
+For example, `ch.sync.recv?` blocks until the next message,
+and `for msg in ch.sync do ...` iterates synchronously over the channel.
+These functions should only be used in dedicated threads.
+-/
+def sync (ch : BoundedChannel α) : BoundedChannel.Sync α := ch
+
+/--
+Synchronously receives a message from the channel.
+
+Every message is only received once.
+Returns `none` if the channel is closed and the buffer is empty.
+-/
+def Sync.recv? (ch : BoundedChannel.Sync α) : BaseIO (Option α) := do
+  IO.wait (← BoundedChannel.recv? ch)
+
+private partial def Sync.forIn [Monad m] [MonadLiftT BaseIO m]
+    (ch : BoundedChannel.Sync α) (f : α → β → m (ForInStep β)) : β → m β := fun b => do
+  match ← ch.recv? with
+    | some a =>
+      match ← f a b with
+        | .done b => pure b
+        | .yield b => ch.forIn f b
+    | none => pure b
+
+/-- `for msg in ch.sync do ...` receives all messages in the channel until it is closed. -/
+instance [MonadLiftT BaseIO m] : ForIn m (BoundedChannel.Sync α) α where
+  forIn ch b f := ch.forIn f b
+
+end BoundedChannel
+
+end IO
@@ -0,0 +1,83 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.Data.Hashable
+
+namespace IO
+
+private opaque ConcurrentHashMapImpl (α β : Type) : NonemptyType.{0}
+
+/--
+A hash map that can be shared and updated by many tasks at once.
+
+The map is split into shards, each protected by its own lock, so that tasks working with different keys
+rarely wait for each other. This makes it suitable for caches shared between concurrently elaborated
+declarations, where storing a `HashMap` in a single `IO.Ref` would serialize all accesses.
+
+All values stored in the map are marked as multi-threaded.
+-/
+def ConcurrentHashMap (α β : Type) : Type := (ConcurrentHashMapImpl α β).type
+
+instance : Nonempty (ConcurrentHashMap α β) := (ConcurrentHashMapImpl α β).property
+
+/--
+Creates a new empty `ConcurrentHashMap`.
+`numShards` is rounded up to a power of two and bounds the number of tasks that can update the map
+without contention.
+-/
+@[extern "lean_io_concurrent_hash_map_new"]
+opaque ConcurrentHashMap.new (numShards : @& Nat := 64) : BaseIO (ConcurrentHashMap α β)
+
+namespace ConcurrentHashMap
+
+/-- Returns the entries whose keys have hash code `hash`. -/
+@[extern "lean_io_concurrent_hash_map_get_bucket"]
+private opaque getBucket (m : @& ConcurrentHashMap α β) (hash : UInt64) : BaseIO (List (α × β))
+
+/--
+Atomically replaces the entries whose keys have hash code `hash` with the first component of `f entries`.
+`f` is executed while holding the lock of the corresponding shard, so it must not access `m` itself.
+-/
+@[extern "lean_io_concurrent_hash_map_modify_bucket"]
+private opaque modifyBucket [Nonempty γ] (m : @& ConcurrentHashMap α β) (hash : UInt64)
+    (f : List (α × β) → List (α × β) × γ) : BaseIO γ
+
+private def eraseKey [BEq α] (a : α) : List (α × β) → List (α × β)
+  | []          => []
+  | (k, v) :: l => if k == a then l else (k, v) :: eraseKey a l
+
+variable [BEq α] [Hashable α]
+
+/-- Returns the value associated with `a`, if any. -/
+def find? (m : ConcurrentHashMap α β) (a : α) : BaseIO (Option β) := do
+  return (← getBucket m (hash a)).lookup a
+
+/-- Returns `true` if the map contains a value for `a`. -/
+def contains (m : ConcurrentHashMap α β) (a : α) : BaseIO Bool :=
+  return (← m.find? a).isSome
+
+/-- Associates `b` with `a`, replacing any previous value. -/
+def insert (m : ConcurrentHashMap α β) (a : α) (b : β) : BaseIO Unit :=
+  modifyBucket m (hash a) fun l => ((a, b) :: eraseKey a l, ())
+
+/-- Removes the value associated with `a`, if any. -/
+def erase (m : ConcurrentHashMap α β) (a : α) : BaseIO Unit :=
+  modifyBucket m (hash a) fun l => (eraseKey a l, ())
+
+/--
+Returns the value associated with `a`, or associates `b` with `a` and returns it if there is none.
+Concurrent calls for the same key all return the same value.
+-/
+def findOrInsert (m : ConcurrentHashMap α β) (a : α) (b : β) : BaseIO β :=
+  have : Nonempty β := ⟨b⟩
+  modifyBucket m (hash a) fun l =>
+    match l.lookup a with
+    | some b' => (l, b')
+    | none    => ((a, b) :: l, b)
+
+end ConcurrentHashMap
+
+end IO
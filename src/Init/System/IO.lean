@@ -216,9 +216,93 @@ local macro "nonempty_list" : tactic =>
     (h : tasks.length > 0 := by nonempty_list) : BaseIO α :=
   return tasks[0].get
 
+/--
+Wait until all of the given tasks have finished, then return their results. This is cheaper than waiting for each
+of them in turn, since the current thread is only woken up when a task finishes. -/
+@[extern "lean_io_wait_all"] opaque waitAll (tasks : @& Array (Task α)) : BaseIO (Array α) :=
+  return tasks.map (·.get)
+
 /-- Helper method for implementing "deterministic" timeouts. It is the number of "small" memory allocations performed by the current execution thread. -/
 @[extern "lean_io_get_num_heartbeats"] opaque getNumHeartbeats : BaseIO Nat
 
+/-- Resident set size of the current process in bytes, or `0` if it is not available on this platform. -/
+@[extern "lean_io_get_resident_memory"] opaque getResidentMemory : BaseIO Nat
+
+/--
+Register `h` to be run when memory usage exceeds the soft limit, i.e., `LEAN_SOFT_MEMORY_LIMIT` percent (by default 90%)
+of the maximum set with `lean --memory`. Handlers should release cached data so that the process can continue below
+the limit instead of failing with an out of memory error. They may run on any thread, and their errors are ignored. -/
+@[extern "lean_io_register_memory_pressure_handler"] opaque registerMemoryPressureHandler (h : IO Unit) : BaseIO Unit
+
+/--
+Run `act` with an arena: the small objects allocated by the current thread while running `act` are allocated in
+regions that are released together when `act` is done, and the objects of the arena reachable from the result (or
+error) of `act` are first moved to the regular heap. This is cheaper than allocating and freeing each object for
+actions that allocate many short-lived objects, e.g., a pass over a data structure that builds temporary ones.
+Reference counting is unchanged, so destructive updates still work, and objects freed while `act` is running are
+reused by later allocations of `act`. Large arrays and strings are not allocated in the arena.
+
+Closed terms, the values of thunks, and constants cached by the interpreter are always allocated on the heap, as they
+outlive `act`. If an object of the arena is stored in an `IO.Ref` created outside of `act`, in a task, or in a cache
+shared between threads, if `act` throws a runtime exception, if the result contains an external object allocated by
+`act`, or if anything but the result still refers to objects of the arena, e.g., a thread-local cache of the kernel,
+the memory of the arena is never released. This is also the case when many more objects are reachable from the
+result than `act` allocated, to keep the cost of moving the result out of the arena proportional to the work done by
+`act`. Objects of the arena must not be marked as persistent. -/
+@[extern "lean_io_with_arena"] opaque withArena (act : IO α) : IO α := act
+
+/-- Memory usage of one size class of the small object allocator. See `IO.getSmallAllocStats`. -/
+structure SmallAllocSlotStats where
+  /-- Size in bytes of the objects of this size class. -/
+  objSize         : Nat
+  /-- Bytes used by live objects. -/
+  liveBytes       : Nat
+  /-- Bytes available for new objects in the pages of this size class. -/
+  freeBytes       : Nat
+  /-- Number of non-empty pages of this size class. -/
+  numPages        : Nat
+  /-- Number of pages that are neither full nor empty. -/
+  numPartialPages : Nat
+  deriving Inhabited, Repr
+
+/-- Memory usage of the small object allocator. See `IO.getSmallAllocStats`. -/
+structure SmallAllocStats where
+  /-- Statistics for each size class that has at least one non-empty page. -/
+  slots         : Array SmallAllocSlotStats
+  /-- Pages without live objects, they can be reused for any size class. -/
+  numEmptyPages : Nat
+  numSegments   : Nat
+  numHeaps      : Nat
+  deriving Inhabited, Repr
+
+/--
+  Return memory usage statistics of the small object allocator for the heap of the current thread,
+  or for the heaps of all threads if `global := true`. Statistics for the heaps of other threads
+  are approximate if those threads are allocating concurrently. -/
+@[extern "lean_io_get_small_alloc_stats"] opaque getSmallAllocStats (global : Bool := false) : BaseIO SmallAllocStats
+
+/-- Contention on multi-threaded `IO.Ref`s since program start. See `IO.getRefContentionStats`. -/
+structure RefContentionStats where
+  /-- Number of `get`/`take` operations that found the value of the reference taken by another thread. -/
+  numContended : Nat
+  /-- Number of contended operations that had to block after spinning. -/
+  numParked    : Nat
+  deriving Inhabited, Repr
+
+/-- Return statistics on how often threads had to wait for multi-threaded `IO.Ref`s. -/
+@[extern "lean_io_get_ref_contention_stats"] opaque getRefContentionStats : BaseIO RefContentionStats
+
+/-- Contention on thunks since program start. See `IO.getThunkContentionStats`. -/
+structure ThunkContentionStats where
+  /-- Number of times a thread forced a thunk that was being evaluated by another thread. -/
+  numContended : Nat
+  /-- Number of contended forcings that had to block after spinning. -/
+  numParked    : Nat
+  deriving Inhabited, Repr
+
+/-- Return statistics on how often threads had to wait for thunks evaluated by other threads. -/
+@[extern "lean_io_get_thunk_contention_stats"] opaque getThunkContentionStats : BaseIO ThunkContentionStats
+
 inductive FS.Mode where
   | read | write | readWrite | append
 
@@ -290,7 +374,39 @@ If the returned array is empty, an end-of-file marker has been reached.
 Note that EOF does not actually close a handle, so further reads may block and return more data.
 -/
 @[extern "lean_io_prim_handle_read"] opaque read (h : @& Handle) (bytes : USize) : IO ByteArray
+/--
+Asynchronously read up to the given number of bytes from the handle. The returned task finishes as soon as some
+data is available, without occupying a thread while waiting. On most platforms, pending reads are served by a single
+event loop thread; otherwise, the read is performed synchronously. Reads still pending when the runtime is finalized
+fail with an error.
+As with `read`, an empty array signals an end-of-file marker.
+
+Unlike `read`, this function reads directly from the underlying file descriptor, so it should not be mixed with
+buffered reads such as `getLine` on the same handle.
+-/
+@[extern "lean_io_prim_handle_read_async"]
+opaque readAsync (h : @& Handle) (bytes : USize) : BaseIO (Task (Except IO.Error ByteArray))
 @[extern "lean_io_prim_handle_write"] opaque write (h : @& Handle) (buffer : @& ByteArray) : IO Unit
+@[extern "lean_io_prim_handle_write_slice"] opaque writeSliceAux (h : @& Handle) (buffer : @& ByteArray) (start stop : @& Nat) : IO Unit
+
+/-- Write all buffers in order, without concatenating them first. -/
+@[extern "lean_io_prim_handle_write_many"] opaque writeMany (h : @& Handle) (buffers : @& Array ByteArray) : IO Unit
+/--
+Read up to the given number of bytes starting at byte offset `offset` of the file, without changing the position
+of the handle (except on Windows). If the returned array is empty, the offset is at or past the end of the file.
+
+Like `readAsync`, this bypasses the buffer of the handle, so pending buffered writes must be flushed first.
+-/
+@[extern "lean_io_prim_handle_read_at"] opaque readAt (h : @& Handle) (offset : UInt64) (bytes : USize) : IO ByteArray
+/--
+Write `buffer` starting at byte offset `offset` of the file, without changing the position of the handle
+(except on Windows). This bypasses the buffer of the handle, so pending buffered writes must be flushed first.
+-/
+@[extern "lean_io_prim_handle_write_at"] opaque writeAt (h : @& Handle) (offset : UInt64) (buffer : @& ByteArray) : IO Unit
+
+/-- Write the bytes of `s` to the handle without copying them into a separate `ByteArray` first. -/
+def writeSubarray (h : Handle) (s : ByteSubarray) : IO Unit :=
+  h.writeSliceAux s.bs s.start s.stop
 
 /--
 Read text up to (including) the next line break from the handle.
@@ -298,6 +414,11 @@ If the returned string is empty, an end-of-file marker has been reached.
 Note that EOF does not actually close a handle, so further reads may block and return more data.
 -/
 @[extern "lean_io_prim_handle_get_line"] opaque getLine (h : @& Handle) : IO String
+/--
+Read up to `maxLines` lines from the handle, each including its line break as with `getLine`.
+If the returned array has fewer than `maxLines` elements, an end-of-file marker has been reached.
+-/
+@[extern "lean_io_prim_handle_get_lines"] opaque getLines (h : @& Handle) (maxLines : USize) : IO (Array String)
 @[extern "lean_io_prim_handle_put_str"] opaque putStr (h : @& Handle) (s : @& String) : IO Unit
 
 end Handle
@@ -341,6 +462,40 @@ partial def Handle.readToEnd (h : Handle) : IO String := do
       loop (s ++ line)
   loop ""
 
+/--
+A read-only memory mapping of a file, created by `IO.FS.mmap`. The mapping is released when the object is freed.
+
+The contents of the file are read on demand, so they should not be modified while the mapping is in use.
+-/
+opaque MappedFile : Type := Unit
+
+/-- Map the whole file `fname` into memory without reading it. -/
+@[extern "lean_io_mmap"] opaque mmap (fname : @& FilePath) : IO MappedFile
+
+namespace MappedFile
+
+/-- The size of the mapped file in bytes. -/
+@[extern "lean_io_mapped_file_size"] opaque size (m : @& MappedFile) : Nat
+
+/-- The byte at offset `i`, or `v₀` if `i` is out of bounds. -/
+@[extern "lean_io_mapped_file_get_d"] opaque getD (m : @& MappedFile) (i : @& Nat) (v₀ : UInt8) : UInt8
+
+/-- Copy the bytes in `[start, stop)` into a new `ByteArray`. Out-of-bounds offsets are clamped to the size. -/
+@[extern "lean_io_mapped_file_extract"] opaque extract (m : @& MappedFile) (start stop : @& Nat) : ByteArray
+
+@[extern "lean_io_mapped_file_index_of"] opaque indexOfAux (m : @& MappedFile) (v : UInt8) (start : @& Nat) : Nat
+
+/-- The offset of the first occurrence of `v` at or after `start`. -/
+def indexOf? (m : MappedFile) (v : UInt8) (start := 0) : Option Nat :=
+  let i := m.indexOfAux v start
+  if i < m.size then some i else none
+
+@[inline] def foldl (f : β → UInt8 → β) (init : β) (m : MappedFile) (start := 0) (stop := m.size) : β :=
+  let stop := min stop m.size
+  (stop - start).fold (init := init) fun k b => f b (m.getD (start + k) 0)
+
+end MappedFile
+
 def readBinFile (fname : FilePath) : IO ByteArray := do
   let h ← Handle.mk fname Mode.read true
   h.readBinToEnd
@@ -351,16 +506,20 @@ def readFile (fname : FilePath) : IO String := do
 
 partial def lines (fname : FilePath) : IO (Array String) := do
   let h ← Handle.mk fname Mode.read false
+  let batchSize := 1024
   let rec read (lines : Array String) := do
-    let line ← h.getLine
-    if line.length == 0 then
+    let batch ← h.getLines batchSize.toUSize
+    let lines := batch.foldl (init := lines) fun lines line =>
+      if line.back == '\n' then
+        let line := line.dropRight 1
+        let line := if System.Platform.isWindows && line.back == '\x0d' then line.dropRight 1 else line
+        lines.push line
+      else
+        lines.push line
+    if batch.size < batchSize then
       pure lines
-    else if line.back == '\n' then
-      let line := line.dropRight 1
-      let line := if System.Platform.isWindows && line.back == '\x0d' then line.dropRight 1 else line
-      read <| lines.push line
     else
-      pure <| lines.push line
+      read lines
   read #[]
 
 def writeBinFile (fname : FilePath) (content : ByteArray) : IO Unit := do
@@ -405,6 +564,20 @@ structure Metadata where
   type     : FileType
   deriving Repr
 
+/-- An entry returned by `IO.FS.readDirs`. -/
+structure WalkEntry where
+  path : FilePath
+  type : FileType
+  deriving Repr
+
+/--
+  Return the entries of all directories in `dirs`. The directories are read and the types of their entries are
+  determined using multiple threads, which hides most of the latency of network file systems. Symbolic links are
+  followed, except for broken ones, which are reported as `FileType.symlink`.
+  If `exts` is nonempty, only directories and entries with one of the given extensions are returned. -/
+@[extern "lean_io_read_dirs"]
+opaque readDirs (dirs : @& Array FilePath) (exts : @& Array String := #[]) : IO (Array WalkEntry)
+
 end FS
 end IO
 
@@ -447,6 +620,23 @@ where
       | FS.FileType.dir => go d.path
       | _ => pure ()
 
+/--
+  Traverse all directories satisfying `enter` starting at `p` breadth-first, calling `f` with the entries of each
+  level, which are read using `IO.FS.readDirs`. If `exts` is nonempty, only directories and entries with one of the
+  given extensions are passed to `f`. -/
+partial def walkDirBatched (p : FilePath) (f : Array IO.FS.WalkEntry → IO Unit) (exts : Array String := #[])
+    (enter : FilePath → IO Bool := fun _ => pure true) : IO Unit := do
+  if (← enter p) then
+    go #[p]
+where
+  go (dirs : Array FilePath) : IO Unit := do
+    if dirs.isEmpty then
+      return
+    let entries ← IO.FS.readDirs dirs exts
+    f entries
+    let next ← entries.filterM fun e => return e.type == .dir && (← enter e.path)
+    go (next.map (·.path))
+
 end System.FilePath
 
 namespace IO
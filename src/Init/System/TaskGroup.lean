@@ -0,0 +1,62 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+
+/--
+`as.parMap f` applies `f` to all elements of `as` in parallel, and returns a task for the resulting array.
+The array is split into chunks of `chunkSize` elements, each of them mapped by a task with priority `prio`.
+By default, there are about four chunks for each hardware thread. The result is resolved by the last chunk to
+finish, so waiting for it does not require a dependency on every chunk.
+-/
+@[extern "lean_array_par_map"]
+opaque Array.parMap (f : α → β) (as : Array α) (chunkSize : Nat := 0) (prio := Task.Priority.default) :
+    Task (Array β) :=
+  Task.spawn (prio := prio) fun _ => as.map f
+
+namespace IO
+
+private opaque TaskGroupImpl : NonemptyType.{0}
+
+/--
+A group of tasks that can be canceled and waited for together. Tasks spawned with `TaskGroup.spawn` are added to
+the group, including tasks spawned by tasks of the group. `TaskGroup.cancel` requests cooperative cancellation of
+all of them, see `IO.checkCanceled`, and of the tasks added afterwards.
+-/
+def TaskGroup : Type := TaskGroupImpl.type
+
+instance : Nonempty TaskGroup := TaskGroupImpl.property
+
+/-- Creates a new empty `TaskGroup`. -/
+@[extern "lean_io_task_group_new"]
+opaque TaskGroup.new : BaseIO TaskGroup
+
+namespace TaskGroup
+
+/-- Adds `t` to the group. If the group has been canceled, `t` is canceled. -/
+@[extern "lean_io_task_group_add"]
+opaque add (g : @& TaskGroup) (t : @& Task α) : BaseIO Unit
+
+/-- Requests cooperative cancellation of all tasks of the group. -/
+@[extern "lean_io_task_group_cancel"]
+opaque cancel (g : @& TaskGroup) : BaseIO Unit
+
+/-- Returns `true` if `cancel` has been called on the group. -/
+@[extern "lean_io_task_group_is_canceled"]
+opaque isCanceled (g : @& TaskGroup) : BaseIO Bool
+
+/-- Waits until all tasks of the group have finished, including the ones added while waiting. -/
+@[extern "lean_io_task_group_wait"]
+opaque wait (g : @& TaskGroup) : BaseIO Unit
+
+/-- Runs `act` in a new task of the group. -/
+def spawn (g : TaskGroup) (act : IO α) (prio := Task.Priority.default) : BaseIO (Task (Except IO.Error α)) := do
+  let t ← IO.asTask act prio
+  g.add t
+  return t
+
+end TaskGroup
+
+end IO
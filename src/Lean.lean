@@ -10,6 +10,7 @@ import Lean.Modifiers
 import Lean.ProjFns
 import Lean.Runtime
 import Lean.ResolveName
+import Lean.Replay
 import Lean.Attributes
 import Lean.Parser
 import Lean.ReducibilityAttrs
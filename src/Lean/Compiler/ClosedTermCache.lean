@@ -8,15 +8,43 @@ import Lean.Environment
 namespace Lean
 
 structure ClosedTermCache where
-  map        : PHashMap Expr Name := {}
+  map        : SMap Expr Name := {}
   constNames : NameSet := {}
+  /-- Closed term constants that are initialized on first access, see `compiler.lazy_closed_terms`. -/
+  lazyNames  : NameSet := {}
   deriving Inhabited
 
-builtin_initialize closedTermCacheExt : EnvExtension ClosedTermCache ← registerEnvExtension (pure {})
+inductive ClosedTermCacheEntry where
+  | closedTerm (e : Expr) (n : Name)
+  | lazy (n : Name)
+  deriving Inhabited
+
+def ClosedTermCache.addEntry (s : ClosedTermCache) (e : ClosedTermCacheEntry) : ClosedTermCache :=
+  match e with
+  | .closedTerm e n => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+  | .lazy n         => { s with lazyNames := s.lazyNames.insert n }
+
+def ClosedTermCache.switch (s : ClosedTermCache) : ClosedTermCache :=
+  { s with map := s.map.switch }
+
+/--
+Closed terms extracted by the compiler and the auxiliary constants they were extracted to. The cache is persistent, so
+closed terms of imported modules are reused instead of being extracted and initialized again by each module that uses
+them.
+-/
+builtin_initialize closedTermCacheExt : SimplePersistentEnvExtension ClosedTermCacheEntry ClosedTermCache ←
+  registerSimplePersistentEnvExtension {
+    addEntryFn    := ClosedTermCache.addEntry
+    addImportedFn := fun es => (mkStateFromImportedEntries ClosedTermCache.addEntry {} es).switch
+  }
 
 @[export lean_cache_closed_term_name]
 def cacheClosedTermName (env : Environment) (e : Expr) (n : Name) : Environment :=
-  closedTermCacheExt.modifyState env fun s => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+  closedTermCacheExt.addEntry env (.closedTerm e n)
+
+@[export lean_mark_lazy_closed_term]
+def markLazyClosedTerm (env : Environment) (n : Name) : Environment :=
+  closedTermCacheExt.addEntry env (.lazy n)
 
 @[export lean_get_closed_term_name]
 def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
@@ -25,4 +53,7 @@ def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
 def isClosedTermName (env : Environment) (n : Name) : Bool :=
   (closedTermCacheExt.getState env).constNames.contains n
 
+def isLazyClosedTermName (env : Environment) (n : Name) : Bool :=
+  (closedTermCacheExt.getState env).lazyNames.contains n
+
 end Lean
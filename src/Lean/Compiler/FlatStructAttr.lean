@@ -0,0 +1,25 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Environment
+import Lean.Attributes
+
+namespace Lean
+
+/-
+The layout of constructor objects is part of the ABI of compiled code, including the C code of `stage0` and the
+runtime, so it only changes for the structures that opt in. The attribute must be added when the structure is
+declared, before any code using it is compiled.
+-/
+builtin_initialize flatStructAttr : TagAttribute ←
+  registerTagAttribute `flat_struct "instruct the compiler to store the scalar fields of the tagged structure inline in the constructor objects containing its values, if it has no parameters and at least two scalar fields of at most 16 bytes in total"
+    (validate := fun declName => do
+      unless (← getEnv).find? declName matches some (.inductInfo _) do
+        throwError "invalid attribute 'flat_struct', '{declName}' is not a structure")
+
+@[export lean_has_flat_struct_attribute]
+def hasFlatStructAttribute (env : Environment) (n : Name) : Bool :=
+  flatStructAttr.hasTag env n
+
+end Lean
@@ -21,6 +21,8 @@ import Lean.Compiler.IR.ElimDeadBranches
 import Lean.Compiler.IR.EmitC
 import Lean.Compiler.IR.CtorLayout
 import Lean.Compiler.IR.Sorry
+import Lean.Compiler.IR.RCProfile
+import Lean.Util.Profile
 
 namespace Lean.IR
 
@@ -29,33 +31,65 @@ register_builtin_option compiler.reuse : Bool := {
   descr    := "heuristically insert reset/reuse instruction pairs"
 }
 
+/-- Number of instructions in `b`. -/
+private partial def bodySize (b : FnBody) : Nat :=
+  match b with
+  | .jdecl _ _ v k  => bodySize v + bodySize k + 1
+  | .case _ _ _ alts => alts.foldl (init := 1) fun n alt => n + bodySize alt.body
+  | b => if b.isTerminal then 1 else bodySize b.body + 1
+
+private def declsSize (decls : Array Decl) : Nat :=
+  decls.foldl (init := 0) fun n decl =>
+    match decl with
+    | .fdecl (body := b) .. => n + bodySize b
+    | .extern .. => n
+
+/--
+Run the IR pass `pass` on `decls` as the profiling category `compilation IR {passName}`. If `compiler.stats` is set,
+the size of `decls` before and after the pass is logged.
+-/
+private def runPass (passName : String) (pass : Array Decl → CompilerM (Array Decl)) (decls : Array Decl) :
+    CompilerM (Array Decl) := do
+  let newDecls ← (fun opts s => profileit s!"compilation IR {passName}" opts fun _ => pass decls opts s : CompilerM _)
+  if (← read).getBool `compiler.stats then
+    log (.message f!"compiler.stats IR {passName}: {declsSize decls} -> {declsSize newDecls}")
+  return newDecls
+
 private def compileAux (decls : Array Decl) : CompilerM Unit := do
   logDecls `init decls
   checkDecls decls
-  let mut decls ← elimDeadBranches decls
+  let mut decls ← runPass "elim_dead_branches" elimDeadBranches decls
   logDecls `elim_dead_branches decls
-  decls := decls.map Decl.pushProj
+  decls ← runPass "push_proj" (pure <| ·.map Decl.pushProj) decls
   logDecls `push_proj decls
   if compiler.reuse.get (← read) then
-    decls := decls.map Decl.insertResetReuse
+    decls ← runPass "inline_ctor_fns" inlineCtorFns decls
+    logDecls `inline_ctor_fns decls
+    decls ← runPass "reset_reuse" (pure <| ·.map Decl.insertResetReuse) decls
     logDecls `reset_reuse decls
-  decls := decls.map Decl.elimDead
+    if (← read).getBool `compiler.stats then
+      for decl in decls do
+        let (reused, total) := decl.reuseStats
+        if total > 0 then
+          log (.message f!"compiler.stats IR reuse {decl.name}: {reused}/{total} constructor applications reuse memory")
+  decls ← runPass "elim_dead" (pure <| ·.map Decl.elimDead) decls
   logDecls `elim_dead decls
-  decls := decls.map Decl.simpCase
+  decls ← runPass "simp_case" (pure <| ·.map Decl.simpCase) decls
   logDecls `simp_case decls
-  decls := decls.map Decl.normalizeIds
-  decls ← inferBorrow decls
+  decls ← runPass "normalize_ids" (pure <| ·.map Decl.normalizeIds) decls
+  decls ← runPass "borrow" inferBorrow decls
   logDecls `borrow decls
-  decls ← explicitBoxing decls
+  decls ← runPass "boxing" explicitBoxing decls
   logDecls `boxing decls
-  decls ← explicitRC decls
+  decls ← runPass "rc" explicitRC decls
   logDecls `rc decls
+  logRCProfile decls
   if compiler.reuse.get (← read) then
-    decls := decls.map Decl.expandResetReuse
+    decls ← runPass "expand_reset_reuse" (pure <| ·.map Decl.expandResetReuse) decls
     logDecls `expand_reset_reuse decls
-  decls := decls.map Decl.pushProj
+  decls ← runPass "push_proj" (pure <| ·.map Decl.pushProj) decls
   logDecls `push_proj decls
-  decls ← updateSorryDep decls
+  decls ← runPass "update_sorry_dep" updateSorryDep decls
   logDecls `result decls
   checkDecls decls
   addDecls decls
@@ -6,6 +6,7 @@ Authors: Leonardo de Moura
 import Lean.Compiler.ExportAttr
 import Lean.Compiler.IR.CompilerM
 import Lean.Compiler.IR.NormIds
+import Lean.Compiler.IR.RCProfile
 
 namespace Lean
 namespace IR
@@ -305,11 +306,57 @@ def collectDecls : M ParamMap := do
 def infer (env : Environment) (decls : Array Decl) : ParamMap :=
   collectDecls { env, decls } |>.run' { paramMap := mkInitParamMap env decls }
 
+/-- Variables reset in `b`. -/
+partial def collectResetVars (b : FnBody) (s : IndexSet := {}) : IndexSet :=
+  match b with
+  | .vdecl _ _ (.reset _ x) b => collectResetVars b (s.insert x.idx)
+  | .jdecl _ _ v b            => collectResetVars b (collectResetVars v s)
+  | .case _ _ _ alts          => alts.foldl (fun s alt => collectResetVars alt.body s) s
+  | b                         => if b.isTerminal then s else collectResetVars b.body s
+
+/-- Functions called in tail position in `b`. -/
+partial def collectTailCalls (b : FnBody) (s : NameSet := {}) : NameSet :=
+  match b with
+  | .vdecl x _ (.fap g _) (.ret (.var z)) => if x == z then s.insert g else s
+  | .jdecl _ _ v b                        => collectTailCalls b (collectTailCalls v s)
+  | .case _ _ _ alts                      => alts.foldl (fun s alt => collectTailCalls alt.body s) s
+  | b                                     => if b.isTerminal then s else collectTailCalls b.body s
+
+/--
+Mark the owned parameters of functions called at least `threshold` times in `prof` as borrowed if they are decremented
+in at least half of the calls, i.e., they are usually not consumed. This saves the `dec` in the function, as well as
+the `inc` before the call if the caller keeps using the argument. Parameters that are reset must stay owned, and so do
+the parameters of functions called in tail position in the block, as borrowing them would break the tail call.
+-/
+def applyRCProfile (env : Environment) (decls : Array Decl) (map : ParamMap) (prof : RCProfile) (threshold : Nat) :
+    ParamMap := Id.run do
+  let tailCalled := decls.foldl (init := {}) fun s decl =>
+    match decl with
+    | .fdecl (body := b) .. => collectTailCalls b s
+    | _ => s
+  let mut map := map
+  for decl in decls do
+    let .fdecl (f := f) (body := b) .. := decl | continue
+    let entries := prof.entries f
+    if entries < max threshold 1 || isExport env f || tailCalled.contains f then
+      continue
+    let some ps := map.find? (.decl f) | continue
+    let resetVars := collectResetVars b
+    let ps := ps.mapIdx fun i p =>
+      if !p.borrow && p.ty.isObj && !resetVars.contains p.x.idx && 2 * prof.paramCount f "dec" i.val ≥ entries then
+        { p with borrow := true }
+      else
+        p
+    map := map.insert (.decl f) ps
+  return map
+
 end Borrow
 
 def inferBorrow (decls : Array Decl) : CompilerM (Array Decl) := do
   let env ← getEnv
-  let paramMap := Borrow.infer env decls
+  let mut paramMap := Borrow.infer env decls
+  if let some prof ← getRCProfile? then
+    paramMap := Borrow.applyRCProfile env decls paramMap prof (compiler.rcProfileThreshold.get (← read))
   pure (Borrow.applyParamMap decls paramMap)
 
 end IR
@@ -96,6 +96,14 @@ def findEnvDecl (env : Environment) (declName : Name) : Option Decl :=
   | some modIdx => findAtSorted? (declMapExt.getModuleEntries env modIdx) declName
   | none        => declMapExt.getState env |>.find? declName
 
+/--
+Return `true` if the IR declaration `declName` belongs to an imported module. Used by the interpreter to decide which
+lookups it may share between environments with the same imports.
+-/
+@[export lean_ir_is_imported_decl]
+private def isImportedDecl (env : Environment) (declName : Name) : Bool :=
+  (env.getModuleIdxFor? declName).isSome
+
 def findDecl (n : Name) : CompilerM (Option Decl) :=
   return findEnvDecl (← get).env n
 
@@ -14,14 +14,17 @@ inductive CtorFieldInfo where
   | object (i : Nat)
   | usize  (i : Nat)
   | scalar (sz : Nat) (offset : Nat) (type : IRType)
+  /-- A small structure of scalars stored inline, `fields` are the positions of its fields in the constructor. -/
+  | struct (ctorName : Name) (fields : List CtorFieldInfo)
 
 namespace CtorFieldInfo
 
-def format : CtorFieldInfo → Format
+partial def format : CtorFieldInfo → Format
   | irrelevant => "◾"
   | object i   => f!"obj@{i}"
   | usize i    => f!"usize@{i}"
   | scalar sz offset type => f!"scalar#{sz}@{offset}:{type}"
+  | struct ctorName fields => f!"{ctorName}{fields.map format}"
 
 instance : ToFormat CtorFieldInfo := ⟨format⟩
 
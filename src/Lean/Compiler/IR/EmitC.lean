@@ -12,18 +12,43 @@ import Lean.Compiler.IR.EmitUtil
 import Lean.Compiler.IR.NormIds
 import Lean.Compiler.IR.SimpCase
 import Lean.Compiler.IR.Boxing
+import Lean.Compiler.IR.UnboxResult
 
 namespace Lean.IR.EmitC
 open ExplicitBoxing (requiresBoxedVersion mkBoxedName isBoxedName)
+open UnboxResult (tupleType mkTupleName)
 
 def leanMainFn := "_lean_main"
 
+register_builtin_option compiler.functionOrder : String := {
+  defValue := ""
+  group    := "compiler"
+  descr    := "(compiler) file containing the C names of hot functions, one per line and hottest first, e.g., extracted from a profile. When generating C code, these functions are emitted first, in this order, and marked with `LEAN_HOT`."
+}
+
+register_builtin_option compiler.cParts : Nat := {
+  defValue := 1
+  group    := "compiler"
+  descr    := "(compiler) number of C files the functions of a module are split into, so that they can be compiled in parallel. The first file is the one given by `-c`, the file `i` is named like it with extension `.<i>.c`. Each function is assigned to a file by the hash of its name, so that changing a function only changes one file."
+}
+
 structure Context where
   env        : Environment
   modName    : Name
   jpMap      : JPParamsMap := {}
+  varMap     : VarTypeMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- Position of each function of `compiler.functionOrder`, indexed by C name. -/
+  hotFns     : HashMap String Nat := {}
+  /-- Instrument reference counting instructions, see `compiler.rcProfile`. -/
+  rcProfile  : Bool := false
+  /-- Functions with a tuple version and the constructor they return, see `UnboxResult.collectTupleFns`. -/
+  tupleFns   : HashMap FunId CtorInfo := {}
+  /-- Number of C files of the module, see `compiler.cParts`. -/
+  numParts   : Nat := 1
+  /-- The C file being emitted. The first one contains the definitions of the closed terms and the initializer. -/
+  part       : Nat := 0
 
 abbrev M := ReaderT Context (EStateM String String)
 
@@ -62,6 +87,7 @@ def toCType : IRType → String
   | IRType.object     => "lean_object*"
   | IRType.tobject    => "lean_object*"
   | IRType.irrelevant => "lean_object*"
+  | IRType.struct none tys => s!"lean_obj_tuple{tys.size}"
   | IRType.struct _ _ => panic! "not implemented yet"
   | IRType.union _ _  => panic! "not implemented yet"
 
@@ -76,6 +102,10 @@ def toCName (n : Name) : M String := do
   | some _                   => throwInvalidExportName n
   | none                     => if n == `main then pure leanMainFn else pure n.mangle
 
+/-- Whether the functions of the module are split into several C files, which precludes `static` functions. -/
+def isSplit : M Bool :=
+  return (← read).numParts > 1
+
 def emitCName (n : Name) : M Unit :=
   toCName n >>= emit
 
@@ -90,12 +120,19 @@ def toCInitName (n : Name) : M String := do
 def emitCInitName (n : Name) : M Unit :=
   toCInitName n >>= emit
 
+/--
+Return `true` if `decl` is a closed term constant that is initialized on first access instead of by the module
+initializer, see `compiler.lazy_closed_terms`.
+-/
+def isLazyClosedTerm (env : Environment) (decl : Decl) : Bool :=
+  decl.params.isEmpty && decl.resultType.isObj && isLazyClosedTermName env decl.name
+
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
-    else if isExternal then emit "extern "
+    -- closed terms are not `static` because modules importing this one may reuse them, see `closedTermCacheExt`
+    if isExternal then emit "extern "
     else emit "LEAN_EXPORT "
   else
     if !isExternal then emit "LEAN_EXPORT "
@@ -112,6 +149,9 @@ def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M U
         emit (toCType ps[i]!.ty)
     emit ")"
   emitLn ";"
+  if isLazyClosedTerm env decl then
+    unless isExternal do emit "LEAN_EXPORT "
+    emit "lean_object* "; emitCInitName decl.name; emitLn "(void);"
 
 def emitFnDecl (decl : Decl) (isExternal : Bool) : M Unit := do
   let cppBaseName ← toCName decl.name
@@ -122,17 +162,54 @@ def emitExternDeclAux (decl : Decl) (cNameStr : String) : M Unit := do
   let extC := isExternC env decl.name
   emitFnDeclAux decl cNameStr extC
 
+/-- Position of `d` in `compiler.functionOrder`, if any. -/
+def getHotIdx? (d : Decl) : M (Option Nat) := do
+  let hotFns := (← read).hotFns
+  if hotFns.isEmpty then
+    return none
+  else
+    return hotFns.find? (← toCName d.name)
+
+/-- The C file `d` is emitted to. Hot functions stay together in the first one. -/
+def getPart (d : Decl) : M Nat := do
+  let numParts := (← read).numParts
+  if numParts ≤ 1 || (← getHotIdx? d).isSome then
+    return 0
+  else
+    return (hash d.name).toNat % numParts
+
 def emitFnDecls : M Unit := do
   let env ← getEnv
   let decls := getDecls env
   let modDecls  : NameSet := decls.foldl (fun s d => s.insert d.name) {}
-  let usedDecls : NameSet := decls.foldl (fun s d => collectUsedDecls env d (s.insert d.name)) {}
-  let usedDecls := usedDecls.toList
-  usedDecls.forM fun n => do
+  let part := (← read).part
+  -- a C file only declares the functions used by the functions it defines
+  let mut usedDecls : NameSet := {}
+  for d in decls do
+    if (← getPart d) == part then
+      usedDecls := collectUsedDecls env d (usedDecls.insert d.name)
+    else if part == 0 then
+      -- the initializer in the first C file refers to all declarations of the module and their initializers
+      usedDecls := usedDecls.insert d.name
+      if let some initFn := getInitFnNameFor? env d.name then
+        usedDecls := usedDecls.insert initFn
+  usedDecls.toList.forM fun n => do
     let decl ← getDecl n;
     match getExternNameFor env `c decl.name with
     | some cName => emitExternDeclAux decl cName
-    | none       => emitFnDecl decl (!modDecls.contains n)
+    -- the closed terms of the module are defined in the first C file
+    | none       => emitFnDecl decl (!modDecls.contains n || (decl.params.isEmpty && part != 0))
+  let tupleFns := (← read).tupleFns
+  decls.forM fun decl => do
+    if let some c := tupleFns.find? decl.name then
+      if usedDecls.contains decl.name then
+        unless (← isSplit) do emit "static "
+        emitFnDeclAux (UnboxResult.mkTupleDecl c decl) (← toCName (mkTupleName decl.name)) true
+  if (← isSplit) && part == 0 then
+    -- the initializer in the first C file calls the initializers of the closed terms of all files
+    decls.forM fun decl => do
+      if decl matches .fdecl .. && decl.params.isEmpty && !hasInitAttr env decl.name && !isLazyClosedTerm env decl then
+        emit "LEAN_EXPORT lean_object* "; emitCInitName decl.name; emitLn "(void);"
 
 def emitMainFn : M Unit := do
   let d ← getDecl `main
@@ -275,6 +352,19 @@ def isIf (alts : Array Alt) : Option (Nat × FnBody × FnBody) :=
     | Alt.ctor c b => some (c.cidx, b, alts[1]!.body)
     | _            => none
 
+/-- Return `true` if `f` reports an error, i.e., it is `panicCore`, `panic`, or a specialization of `panic`. -/
+def isPanicFn (f : FunId) : Bool :=
+  f == ``panicCore || ``panic |>.isPrefixOf f
+
+/--
+Return `true` if all paths of `b` end with `unreachable` or a call to a panic function.
+We use it to keep error paths out of the way of the code the C compiler considers likely. -/
+partial def isColdBody : FnBody → Bool
+  | .unreachable                => true
+  | .vdecl _ _ (.fap f _) b     => isPanicFn f || isColdBody b
+  | .case _ _ _ alts            => alts.all (isColdBody ·.body)
+  | b                           => !b.isTerminal && isColdBody b.body
+
 def emitInc (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
   emit $
     if checkRef then (if n == 1 then "lean_inc" else "lean_inc_n")
@@ -348,6 +438,11 @@ def emitCtorSetArgs (z : VarId) (ys : Array Arg) : M Unit :=
   ys.size.forM fun i => do
     emit "lean_ctor_set("; emit z; emit ", "; emit i; emit ", "; emitArg ys[i]!; emitLn ");"
 
+/-- Construct the tuple `z` returned by a tuple version, see `Lean.IR.UnboxResult`. -/
+def emitTupleCtor (z : VarId) (ys : Array Arg) : M Unit :=
+  ys.size.forM fun i => do
+    emit z; emit ".m_objs["; emit i; emit "] = "; emitArg ys[i]!; emitLn ";"
+
 def emitCtor (z : VarId) (c : CtorInfo) (ys : Array Arg) : M Unit := do
   emitLhs z;
   if c.size == 0 && c.usize == 0 && c.ssize == 0 then do
@@ -375,7 +470,10 @@ def emitReuse (z : VarId) (x : VarId) (c : CtorInfo) (updtHeader : Bool) (ys : A
   emitCtorSetArgs z ys
 
 def emitProj (z : VarId) (i : Nat) (x : VarId) : M Unit := do
-  emitLhs z; emit "lean_ctor_get("; emit x; emit ", "; emit i; emitLn ");"
+  if (← read).varMap.find? x |>.any (·.isStruct) then
+    emitLhs z; emit x; emit ".m_objs["; emit i; emitLn "];"
+  else
+    emitLhs z; emit "lean_ctor_get("; emit x; emit ", "; emit i; emitLn ");"
 
 def emitUProj (z : VarId) (i : Nat) (x : VarId) : M Unit := do
   emitLhs z; emit "lean_ctor_get_usize("; emit x; emit ", "; emit i; emitLn ");"
@@ -422,9 +520,16 @@ def emitFullApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
   match decl with
   | Decl.extern _ ps _ extData => emitExternCall f ps extData ys
   | _ =>
-    emitCName f
-    if ys.size > 0 then emit "("; emitArgs ys; emit ")"
-    emitLn ";"
+    if isLazyClosedTerm (← getEnv) decl then
+      emit "lean_lazy_closed_term(&"; emitCName f; emit ", "; emitCInitName f; emitLn ");"
+    else
+      emitCName f
+      if ys.size > 0 then emit "("; emitArgs ys; emit ")"
+      emitLn ";"
+
+/-- Call the tuple version of `f`, see `Lean.IR.UnboxResult`. -/
+def emitTupleApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
+  emitLhs z; emitCName (mkTupleName f); emit "("; emitArgs ys; emitLn ");"
 
 def emitPartialApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
   let decl ← getDecl f
@@ -502,15 +607,24 @@ def emitLit (z : VarId) (t : IRType) (v : LitVal) : M Unit := do
   | LitVal.num v => emitNumLit t v; emitLn ";"
   | LitVal.str v => emit "lean_mk_string_from_bytes("; emit (quoteString v); emit ", "; emit v.utf8ByteSize; emitLn ");"
 
+/-- Count the executions of an instruction of the given kind on `x` in the current function, see `Lean.IR.RCProfile`. -/
+def emitRCSite (kind : String) (x? : Option VarId := none) : M Unit := do
+  let ctx ← read
+  if ctx.rcProfile then
+    let var := match x?.bind fun x => ctx.mainParams.findIdx? (·.x == x) with
+      | some i => s!"p{i}"
+      | none   => "x"
+    emitLn s!"LEAN_RC_SITE({quoteString (toString ctx.mainFn)}, \"{kind}\", \"{var}\");"
+
 def emitVDecl (z : VarId) (t : IRType) (v : Expr) : M Unit :=
   match v with
-  | Expr.ctor c ys      => emitCtor z c ys
+  | Expr.ctor c ys      => if t.isStruct then emitTupleCtor z ys else emitCtor z c ys
   | Expr.reset n x      => emitReset z n x
   | Expr.reuse x c u ys => emitReuse z x c u ys
   | Expr.proj i x       => emitProj z i x
   | Expr.uproj i x      => emitUProj z i x
   | Expr.sproj n o x    => emitSProj z t n o x
-  | Expr.fap c ys       => emitFullApp z c ys
+  | Expr.fap c ys       => if t.isStruct then emitTupleApp z c ys else emitFullApp z c ys
   | Expr.pap c ys       => emitPartialApp z c ys
   | Expr.ap x ys        => emitApp z x ys
   | Expr.box t x        => emitBox z x t
@@ -580,7 +694,12 @@ def emitTailCall (v : Expr) : M Unit :=
 mutual
 
 partial def emitIf (x : VarId) (xType : IRType) (tag : Nat) (t : FnBody) (e : FnBody) : M Unit := do
-  emit "if ("; emitTag x xType; emit " == "; emit tag; emitLn ")";
+  let (pre, post) :=
+    match isColdBody t, isColdBody e with
+    | true, false => ("LEAN_UNLIKELY(", ")")
+    | false, true => ("LEAN_LIKELY(", ")")
+    | _, _        => ("", "")
+  emit "if ("; emit pre; emitTag x xType; emit " == "; emit tag; emit post; emitLn ")";
   emitFnBody t;
   emitLn "else";
   emitFnBody e
@@ -608,10 +727,14 @@ partial def emitBlock (b : FnBody) : M Unit := do
       emitVDecl x t v
       emitBlock b
   | FnBody.inc x n c p b       =>
-    unless p do emitInc x n c
+    unless p do
+      emitRCSite "inc" (some x)
+      emitInc x n c
     emitBlock b
   | FnBody.dec x n c p b       =>
-    unless p do emitDec x n c
+    unless p do
+      emitRCSite "dec" (some x)
+      emitDec x n c
     emitBlock b
   | FnBody.del x b             => emitDel x; emitBlock b
   | FnBody.setTag x i b        => emitSetTag x i; emitBlock b
@@ -638,16 +761,24 @@ partial def emitFnBody (b : FnBody) : M Unit := do
 
 end
 
-def emitDeclAux (d : Decl) : M Unit := do
+/-- If `tuple` is `true`, `d` is the tuple version of a function, see `Lean.IR.UnboxResult`. -/
+def emitDeclAux (d : Decl) (tuple := false) : M Unit := do
   let env ← getEnv
-  let (_, jpMap) := mkVarJPMaps d
-  withReader (fun ctx => { ctx with jpMap := jpMap }) do
+  let (varMap, jpMap) := mkVarJPMaps d
+  withReader (fun ctx => { ctx with jpMap, varMap }) do
   unless hasInitAttr env d.name do
     match d with
     | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. =>
-      let baseName ← toCName f;
-      if xs.size == 0 then
-        emit "static "
+      let baseName ← toCName (if tuple then mkTupleName f else f);
+      if (← read).hotFns.contains (← toCName f) then
+        emit "LEAN_HOT "
+      else if xs.size > 0 && isColdBody b then
+        emit "LEAN_COLD "
+      if tuple then
+        unless (← isSplit) do emit "static "
+      else if xs.size == 0 then
+        -- the initializers of lazy closed terms are also called by modules importing this one
+        emit (if isLazyClosedTerm env d || (← isSplit) then "LEAN_EXPORT " else "static ")
       else
         emit "LEAN_EXPORT "  -- make symbol visible to the interpreter
       emit (toCType t); emit " ";
@@ -669,22 +800,63 @@ def emitDeclAux (d : Decl) : M Unit := do
         xs.size.forM fun i => do
           let x := xs[i]!
           emit "lean_object* "; emit x.x; emit " = _args["; emit i; emitLn "];"
+      -- before `_start`, which is the target of self tail calls
+      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitRCSite "entry")
       emitLn "_start:";
       withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitFnBody b);
       emitLn "}"
     | _ => pure ()
 
+/--
+Emit `f` for a function with a tuple version returning `c`, i.e., a call to the tuple version followed by the
+allocation of the constructor object.
+-/
+def emitTupleWrapper (d : Decl) (c : CtorInfo) : M Unit := do
+  let xs := d.params
+  emit "LEAN_EXPORT lean_object* "; emitCName d.name; emit "("
+  xs.size.forM fun i => do
+    if i > 0 then emit ", "
+    emit (toCType xs[i]!.ty); emit " "; emit xs[i]!.x
+  emitLn ") {"
+  emit (toCType (tupleType c)); emit " _r = "; emitCName (mkTupleName d.name); emit "("
+  xs.size.forM fun i => do
+    if i > 0 then emit ", "
+    emit xs[i]!.x
+  emitLn ");"
+  emit "lean_object* _o = "; emitAllocCtor c
+  c.size.forM fun i => do
+    emit "lean_ctor_set(_o, "; emit i; emit ", _r.m_objs["; emit i; emitLn "]);"
+  emitLn "return _o;"
+  emitLn "}"
+
 def emitDecl (d : Decl) : M Unit := do
   let d := d.normalizeIds; -- ensure we don't have gaps in the variable indices
+  let tupleFns := (← read).tupleFns
+  let d := if tupleFns.isEmpty then d else UnboxResult.rewriteDeclCalls tupleFns d
   try
-    emitDeclAux d
+    match tupleFns.find? d.name with
+    | some c =>
+      emitDeclAux (UnboxResult.mkTupleDecl c d) (tuple := true)
+      emitTupleWrapper d c
+    | none => emitDeclAux d
   catch err =>
     throw s!"{err}\ncompiling:\n{d}"
 
 def emitFns : M Unit := do
   let env ← getEnv;
-  let decls := getDecls env;
-  decls.reverse.forM emitDecl
+  let decls := getDecls env |>.reverse.toArray
+  let part := (← read).part
+  let mut hot : Array (Nat × Decl) := #[]
+  let mut rest : Array Decl := #[]
+  for d in decls do
+    if (← getPart d) != part then
+      continue
+    match (← getHotIdx? d) with
+    | some i => hot := hot.push (i, d)
+    | none   => rest := rest.push d
+  -- all functions have been declared by `emitFnDecls`, so we are free to emit them in any order
+  (hot.qsort (·.1 < ·.1)).forM fun (_, d) => emitDecl d
+  rest.forM emitDecl
 
 def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
   if d.resultType.isObj then
@@ -712,7 +884,8 @@ def emitDeclInit (d : Decl) : M Unit := do
       if getBuiltinInitFnNameFor? env d.name |>.isSome then
         emit "}"
     | _ =>
-      emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
+      unless isLazyClosedTerm env d do
+        emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
 
 def emitInitFn : M Unit := do
   let env ← getEnv
@@ -737,16 +910,33 @@ def main : M Unit := do
   emitFileHeader
   emitFnDecls
   emitFns
-  emitInitFn
-  emitMainFnIfNeeded
+  if (← read).part == 0 then
+    emitInitFn
+    emitMainFnIfNeeded
   emitFileFooter
 
 end EmitC
 
+/--
+Generate the C code for module `modName` split into `numParts` files, see `compiler.cParts`. `hotFns` contains the C
+names of the functions to be emitted first, see `compiler.functionOrder`. If `rcProfile` is `true`, reference
+counting instructions are instrumented, see `compiler.rcProfile`. -/
 @[export lean_ir_emit_c]
-def emitC (env : Environment) (modName : Name) : Except String String :=
-  match (EmitC.main { env := env, modName := modName }).run "" with
-  | EStateM.Result.ok    _   s => Except.ok s
-  | EStateM.Result.error err _ => Except.error err
+def emitCParts (env : Environment) (modName : Name) (hotFns : Array String := #[]) (rcProfile := false)
+    (numParts := 1) : Except String (Array String) := do
+  let hotFns := hotFns.size.fold (init := ({} : HashMap String Nat)) fun i m => m.insert hotFns[i]! i
+  let tupleFns := UnboxResult.collectTupleFns env (getDecls env)
+  let numParts := max numParts 1
+  let mut parts := #[]
+  for part in [0:numParts] do
+    match (EmitC.main { env, modName, hotFns, rcProfile, tupleFns, numParts, part }).run "" with
+    | EStateM.Result.ok    _   s => parts := parts.push s
+    | EStateM.Result.error err _ => throw err
+  return parts
+
+/-- Generate the C code for module `modName` as a single file, see `emitCParts`. -/
+def emitC (env : Environment) (modName : Name) (hotFns : Array String := #[]) (rcProfile := false) :
+    Except String String := do
+  return (← emitCParts env modName hotFns rcProfile)[0]!
 
 end Lean.IR
@@ -0,0 +1,124 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Compiler.IR.CompilerM
+
+/-!
+Profile-guided reference counting.
+
+With `compiler.rcProfile`, `EmitC` counts the executions of every `inc` and `dec` instruction and the calls of every
+function. When the program exits, the runtime appends the counters to the file given by the environment variable
+`LEAN_RC_PROFILE`, one site per line:
+```
+<function>\t<kind>\t<variable>\t<count>
+```
+where `kind` is `entry`, `inc`, or `dec`, and `variable` is `p<i>` for the `i`-th parameter of the function and `x`
+for other variables. When compiling with `compiler.rcProfileData` set to such a file, borrow inference additionally
+marks parameters as borrowed that are mostly decremented instead of consumed by hot functions (see
+`Borrow.applyRCProfile`), and `trace.compiler.ir.rc_profile` reports the hottest sites that remain.
+-/
+
+namespace Lean.IR
+
+register_builtin_option compiler.rcProfile : Bool := {
+  defValue := false
+  group    := "compiler"
+  descr    := "(compiler) instrument the generated C code to count the executions of reference counting instructions, see `Lean.IR.RCProfile`"
+}
+
+register_builtin_option compiler.rcProfileData : String := {
+  defValue := ""
+  group    := "compiler"
+  descr    := "(compiler) reference counting profile written by a program compiled with `compiler.rcProfile`, used to guide borrow inference"
+}
+
+register_builtin_option compiler.rcProfileThreshold : Nat := {
+  defValue := 1000
+  group    := "compiler"
+  descr    := "(compiler) minimal number of calls in `compiler.rcProfileData` for the parameters of a function to be borrowed based on the profile"
+}
+
+/-- An instrumented instruction or function entry. -/
+structure RCProfile.Site where
+  /-- `entry`, `inc`, or `dec`. -/
+  kind  : String
+  /-- `p<i>` for the `i`-th parameter, `x` otherwise. -/
+  var   : String
+  count : Nat
+
+def RCProfile.Site.param? (s : RCProfile.Site) : Option Nat :=
+  if s.var.startsWith "p" then (s.var.drop 1).toNat? else none
+
+structure RCProfile where
+  path : String := ""
+  /-- The sites of each function, indexed by the name of the function. -/
+  fns  : HashMap String (Array RCProfile.Site) := {}
+  deriving Inhabited
+
+namespace RCProfile
+
+def parse (path : String) (input : String) : RCProfile := Id.run do
+  let mut fns : HashMap String (Array Site) := {}
+  for line in input.splitOn "\n" do
+    -- several runs may be appended to the same file, we simply keep all their sites
+    if let [fn, kind, var, count] := line.trimRight.splitOn "\t" then
+      fns := fns.insert fn ((fns.findD fn #[]).push { kind, var, count := count.toNat?.getD 0 })
+  return { path, fns }
+
+def sites (prof : RCProfile) (f : FunId) : Array Site :=
+  prof.fns.findD (toString f) #[]
+
+/-- Number of calls of `f`. -/
+def entries (prof : RCProfile) (f : FunId) : Nat :=
+  prof.sites f |>.foldl (init := 0) fun n s => if s.kind == "entry" then n + s.count else n
+
+/-- Number of executions of instructions of the given kind on the `i`-th parameter of `f`. -/
+def paramCount (prof : RCProfile) (f : FunId) (kind : String) (i : Nat) : Nat :=
+  prof.sites f |>.foldl (init := 0) fun n s => if s.kind == kind && s.param? == some i then n + s.count else n
+
+end RCProfile
+
+/-- The profile read last, so that it is parsed only once per module. -/
+builtin_initialize rcProfileCacheRef : IO.Ref RCProfile ← IO.mkRef {}
+
+private unsafe def loadRCProfileUnsafe (path : String) : Except String RCProfile := unsafeBaseIO do
+  let prof ← rcProfileCacheRef.get
+  if prof.path == path then
+    return .ok prof
+  match (← (IO.FS.readFile path).toBaseIO) with
+  | .ok input =>
+    let prof := RCProfile.parse path input
+    rcProfileCacheRef.set prof
+    return .ok prof
+  | .error e => return .error (toString e)
+
+@[implemented_by loadRCProfileUnsafe]
+private opaque loadRCProfile (path : String) : Except String RCProfile
+
+/-- The profile given by `compiler.rcProfileData`, if any. -/
+def getRCProfile? : CompilerM (Option RCProfile) := do
+  let path := compiler.rcProfileData.get (← read)
+  if path.isEmpty then
+    return none
+  match loadRCProfile path with
+  | .ok prof => return some prof
+  | .error e => throw s!"failed to read reference counting profile '{path}': {e}"
+
+/-- Log the hottest reference counting instructions of `decls` in the profile that have not been eliminated. -/
+def logRCProfile (decls : Array Decl) : CompilerM Unit := do
+  let some prof ← getRCProfile? | return
+  let mut sites : Array (FunId × RCProfile.Site) := #[]
+  for decl in decls do
+    let ps := decl.params
+    for s in prof.sites decl.name do
+      -- the decrements of parameters that are now borrowed are gone
+      let borrowed := match s.param? with
+        | some i => ps[i]?.any (·.borrow)
+        | none   => false
+      unless s.kind == "entry" || (s.kind == "dec" && borrowed) do
+        sites := sites.push (decl.name, s)
+  for (f, s) in sites.qsort (·.2.count > ·.2.count) |>.extract 0 10 do
+    logMessageIf `rc_profile f!"{f}: {s.kind} {s.var} executed {s.count} times"
+
+end Lean.IR
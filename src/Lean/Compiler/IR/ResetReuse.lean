@@ -3,9 +3,12 @@ Copyright (c) 2019 Microsoft Corporation. All rights reserved.
 Released under Apache 2.0 license as described in the file LICENSE.
 Authors: Leonardo de Moura
 -/
+import Lean.Compiler.InlineAttrs
 import Lean.Compiler.IR.Basic
 import Lean.Compiler.IR.LiveVars
 import Lean.Compiler.IR.Format
+import Lean.Compiler.IR.CompilerM
+import Lean.Compiler.IR.NormIds
 
 namespace Lean.IR.ResetReuse
 /-! Remark: the insertResetReuse transformation is applied before we have
@@ -156,4 +159,108 @@ def Decl.insertResetReuse (d : Decl) : Decl :=
     d.updateBody! bNew
   | other => other
 
+private partial def reuseStatsAux (b : FnBody) (acc : Nat × Nat) : Nat × Nat :=
+  match b with
+  | .vdecl _ _ (.ctor c _) b => reuseStatsAux b (if c.isScalar then acc else (acc.1, acc.2 + 1))
+  | .vdecl _ _ (.reuse ..) b => reuseStatsAux b (acc.1 + 1, acc.2 + 1)
+  | .jdecl _ _ v b           => reuseStatsAux b (reuseStatsAux v acc)
+  | .case _ _ _ alts         => alts.foldl (init := acc) fun acc alt => reuseStatsAux alt.body acc
+  | b                        => if b.isTerminal then acc else reuseStatsAux b.body acc
+
+/-- The number of constructor applications of `d` reusing memory, and the total number of constructor applications. -/
+def Decl.reuseStats (d : Decl) : Nat × Nat :=
+  reuseStatsAux d.body (0, 0)
+
+namespace InlineCtorFns
+/-!
+`R` only reuses the memory of an object taken apart by a function for constructor applications in the same
+function. Before inserting reset/reuse instructions, we inline the calls of small straight-line functions of the
+same compilation unit that construct objects which may reuse the memory of a scrutinee of an enclosing `case`, e.g.,
+```
+def mkNode (l r : Tree) : Tree := .node l (l.size + r.size + 1) r
+def Tree.mirror : Tree → Tree
+  | .node l _ r => mkNode r.mirror l.mirror
+  | .leaf       => .leaf
+```
+Functions of other compilation units are not inlined, as their IR already contains reference counting instructions.
+-/
+
+/-- Maximal number of instructions of the functions inlined before inserting reset/reuse instructions. -/
+def maxInstrs := 8
+
+/-- A function that may be inlined: its parameters, instructions, returned variable, and constructors. -/
+structure Candidate where
+  params : Array Param
+  instrs : Array FnBody
+  result : VarId
+  ctors  : Array CtorInfo
+
+private def toCandidate? (env : Environment) (d : Decl) : Option Candidate := do
+  let .fdecl f xs _ b _ := d | none
+  if hasNoInlineAttribute env f then none
+  let (instrs, .ret (.var result)) := b.flatten | none
+  guard (instrs.size ≤ maxInstrs)
+  let mut ctors := #[]
+  for instr in instrs do
+    match instr with
+    | .vdecl _ _ (.ctor c _) _ => unless c.isScalar do ctors := ctors.push c
+    | .vdecl _ _ (.fap g _) _  => if g == f then none
+    | .vdecl .. => pure ()
+    | _ => none
+  guard !ctors.isEmpty
+  return { params := xs, instrs, result, ctors }
+
+abbrev InlineM := ReaderT (HashMap FunId Candidate) (StateM Index)
+
+private def mkFreshVar : InlineM VarId :=
+  modifyGet fun idx => ({ idx }, idx + 1)
+
+/-- The instructions of `cand` applied to `ys`, with fresh variables, and the variable containing the result. -/
+private def instantiate (cand : Candidate) (ys : Array Arg) : InlineM (Array FnBody × VarId) := do
+  let mut m : HashMap VarId VarId := {}
+  for p in cand.params, y in ys do
+    if let .var y := y then m := m.insert p.x y
+  let mut instrs := #[]
+  for instr in cand.instrs do
+    if let .vdecl x t e _ := instr then
+      let x' ← mkFreshVar
+      instrs := instrs.push (.vdecl x' t (MapVars.mapExpr (fun z => m.findD z z) e) .nil)
+      m := m.insert x x'
+  return (instrs, m.findD cand.result cand.result)
+
+/-- Inline the calls of `b` to candidates constructing objects that may reuse the memory of `scrutinees`. -/
+partial def visit (scrutinees : Array CtorInfo) (b : FnBody) : InlineM FnBody := do
+  match b with
+  | .case tid x xType alts =>
+    return .case tid x xType (← alts.mapM fun alt => do
+      match alt with
+      | .ctor c b => return .ctor c (← visit (if c.isScalar then scrutinees else scrutinees.push c) b)
+      | .default b => return .default (← visit scrutinees b))
+  | .jdecl j xs v b => return .jdecl j xs (← visit scrutinees v) (← visit scrutinees b)
+  | .vdecl z t (.fap f ys) b =>
+    if let some cand := (← read).find? f then
+      if ys.all (· matches .var _) && cand.ctors.any (fun c => scrutinees.any (mayReuse · c)) then
+        let (instrs, y) ← instantiate cand ys
+        return reshape instrs (← visit scrutinees (b.replaceVar z y))
+    return .vdecl z t (.fap f ys) (← visit scrutinees b)
+  | b =>
+    if b.isTerminal then return b
+    else return b.setBody (← visit scrutinees b.body)
+
+end InlineCtorFns
+
+/-- Inline calls to small functions of `decls` that construct objects, see `InlineCtorFns`. -/
+def inlineCtorFns (decls : Array Decl) : CompilerM (Array Decl) := do
+  let env ← getEnv
+  let cands := decls.foldl (init := ({} : HashMap FunId InlineCtorFns.Candidate)) fun cands d =>
+    match InlineCtorFns.toCandidate? env d with
+    | some cand => cands.insert d.name cand
+    | none      => cands
+  if cands.isEmpty then
+    return decls
+  return decls.map fun d =>
+    match d with
+    | .fdecl (body := b) .. => d.updateBody! ((InlineCtorFns.visit #[] b cands).run' (d.maxIndex + 1))
+    | d => d
+
 end Lean.IR
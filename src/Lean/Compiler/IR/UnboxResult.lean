@@ -4,7 +4,11 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Authors: Leonardo de Moura
 -/
 import Lean.Data.Format
+import Lean.Compiler.ExportAttr
+import Lean.Compiler.InitAttr
 import Lean.Compiler.IR.Basic
+import Lean.Compiler.IR.FreeVars
+import Lean.Compiler.IR.Boxing
 
 namespace Lean.IR.UnboxResult
 
@@ -20,4 +24,187 @@ builtin_initialize unboxAttr : TagAttribute ←
 def hasUnboxAttr (env : Environment) (n : Name) : Bool :=
 unboxAttr.hasTag env n
 
+/-!
+Returning the fields of a constructor object without allocating it.
+
+If all values returned by a function `f` are freshly constructed objects of the same constructor with `2` to
+`maxTupleFields` fields and no scalar fields, e.g., the pairs `(a, s)` returned by the actions of a state monad,
+`EmitC` emits a *tuple version* of `f` returning the fields as a `lean_obj_tuple<n>` C struct, and implements `f`
+by calling the tuple version and allocating the constructor object. Calls to `f` whose results are only projected
+and consumed by a `dec` instruction, and tail calls in other tuple versions, use the tuple version instead.
+The IR stored in the environment is not modified, so the interpreter and other modules are not affected.
+
+In the IR produced here, the struct type `tupleType c` is used linearly, see `IRType`. Values of this type are
+constructed by `ctor` and returned, or returned by tuple versions and returned or projected. The projected fields are
+owned.
+-/
+
+/-- Maximal number of fields of a constructor returned without allocating it, see `lean_obj_tuple<n>` in `lean.h`. -/
+def maxTupleFields := 4
+
+/-- The type of the results of tuple versions returning the fields of `c`. -/
+def tupleType (c : CtorInfo) : IRType :=
+  .struct none (mkArray c.size .object)
+
+def mkTupleName (f : FunId) : Name :=
+  Name.mkStr f "_tuple"
+
+private def isTupleCtor (c : CtorInfo) (ys : Array Arg) : Bool :=
+  c.usize == 0 && c.ssize == 0 && 2 ≤ c.size && c.size ≤ maxTupleFields && ys.size == c.size
+
+/-- Return `true` if `x` is used in `b` only by `ret` instructions. -/
+partial def usedOnlyByRet (x : VarId) : FnBody → Bool
+  | .ret _           => true
+  | .case _ y _ alts => y != x && alts.all (usedOnlyByRet x ·.body)
+  | .jdecl _ _ v b   => usedOnlyByRet x v && usedOnlyByRet x b
+  | b                =>
+    if b.isTerminal then !b.hasFreeVar x
+    else !b.resetBody.hasFreeVar x && usedOnlyByRet x b.body
+
+/-- A value returned by a function. -/
+inductive RetKind where
+  | ctor (c : CtorInfo)
+  | call (g : FunId)
+
+/--
+Collect the values returned by `b`, or return `none` if `b` returns a value that is not constructed or computed by a
+full application in the same function, or that is also used for anything else. `vals` contains the variables in scope
+together with their values and the code using them.
+-/
+partial def collectRets (b : FnBody) (vals : HashMap VarId (Expr × FnBody) := {}) (acc : Array RetKind := #[]) :
+    Option (Array RetKind) :=
+  match b with
+  | .vdecl x _ e k     => collectRets k (vals.insert x (e, k)) acc
+  | .jdecl _ _ v k     => do collectRets k vals (← collectRets v vals acc)
+  | .case _ _ _ alts   => alts.foldlM (init := acc) fun acc alt => collectRets alt.body vals acc
+  | .ret (.var x)      =>
+    match vals.find? x with
+    | some (.ctor c ys, k) => if isTupleCtor c ys && usedOnlyByRet x k then some (acc.push (.ctor c)) else none
+    | some (.fap g _, k)   => if usedOnlyByRet x k then some (acc.push (.call g)) else none
+    | _                    => none
+  | .ret .irrelevant   => none
+  | b                  => if b.isTerminal then some acc else collectRets b.body vals acc
+
+/-- The constructor returned by a function returning `rs`, if it is known already. Fails if it is not unique. -/
+private def retCtor? (cands : HashMap FunId (Array RetKind)) (ctors : HashMap FunId CtorInfo) (rs : Array RetKind) :
+    Except Unit (Option CtorInfo) :=
+  rs.foldlM (init := none) fun c? r => do
+    let c'? ← match r with
+      | .ctor c => pure (some c)
+      | .call g => if cands.contains g then pure (ctors.find? g) else throw ()
+    match c?, c'? with
+    | some c, some c' => if c == c' then pure c? else throw ()
+    | none,   _       => pure c'?
+    | _,      none    => pure c?
+
+/-- Return the functions of `decls` that have a tuple version, together with the constructor they return. -/
+def collectTupleFns (env : Environment) (decls : List Decl) : HashMap FunId CtorInfo := Id.run do
+  let mut cands : HashMap FunId (Array RetKind) := {}
+  for decl in decls do
+    if let .fdecl f xs t b _ := decl then
+      -- functions called by other modules or the runtime keep their only implementation
+      if xs.size > 0 && t.isObj && f != `main && !ExplicitBoxing.isBoxedName f && !hasInitAttr env f &&
+          (getExportNameFor? env f).isNone then
+        if let some rs := collectRets b then
+          cands := cands.insert f rs
+  let mut ctors : HashMap FunId CtorInfo := {}
+  repeat
+    let mut changed := false
+    for (f, rs) in cands.toList do
+      match retCtor? cands ctors rs with
+      | .ok (some c) =>
+        unless ctors.contains f do
+          ctors := ctors.insert f c
+          changed := true
+      | .ok none     => pure ()
+      | .error _     =>
+        cands := cands.erase f
+        changed := true
+    unless changed do
+      -- the remaining functions without a constructor only return the results of each other
+      let unknown := cands.toList.filter fun (f, _) => !ctors.contains f
+      if unknown.isEmpty then
+        break
+      for (f, _) in unknown do
+        cands := cands.erase f
+  return ctors.fold (init := {}) fun r f c => if cands.contains f then r.insert f c else r
+
+/-- The body of the tuple version of a function returning `c`, see `collectTupleFns`. -/
+partial def mkTupleBody (c : CtorInfo) : FnBody → FnBody
+  | .vdecl x t e k =>
+    let k := mkTupleBody c k
+    match e with
+    | .ctor .. | .fap .. => if usedOnlyByRet x k && k.hasFreeVar x then .vdecl x (tupleType c) e k else .vdecl x t e k
+    | _                  => .vdecl x t e k
+  | .jdecl j ys v k  => .jdecl j ys (mkTupleBody c v) (mkTupleBody c k)
+  | .case tid x xType alts => .case tid x xType (alts.map (·.modifyBody (mkTupleBody c)))
+  | b => if b.isTerminal then b else b.setBody (mkTupleBody c b.body)
+
+/--
+Given the instructions `bs` and the terminal `term` following `let r := g ys`, where `g` has a tuple version returning
+`c`, return the code using the tuple version if `r` is only projected and then consumed by `dec r`.
+The fields of the tuple are owned while the fields of `r` are borrowed, so for each field, we remove one of its
+increments preceding `dec r`, or replace `dec r` with a decrement of the field if it is not incremented.
+-/
+private def useTuple? (r : VarId) (c : CtorInfo) (bs : Array FnBody) (term : FnBody) : StateM Index (Option (Array FnBody)) := do
+  if term.hasFreeVar r then return none
+  let some k := bs.findIdx? fun | .dec x 1 _ _ _ => x == r | _ => false | return none
+  -- the field projected by each variable
+  let mut fields : HashMap VarId Nat := {}
+  for i in [:bs.size] do
+    match bs[i]! with
+    | .vdecl x _ (.proj j y) _ => if y == r then fields := fields.insert x j
+    | b                        => if i != k && b.hasFreeVar r then return none
+  if (bs.extract (k+1) bs.size).any (·.hasFreeVar r) then return none
+  let mut pre : Array (Option FnBody) := bs.extract 0 k |>.map some
+  let mut decs := #[]
+  for j in [:c.size] do
+    let inc? := pre.findIdx? fun | some (.inc x _ _ _ _) => fields.find? x == some j | _ => false
+    match inc? with
+    | some i =>
+      if let some (.inc x n ch p b) := pre[i]! then
+        pre := pre.set! i (if n == 1 then none else some (.inc x (n-1) ch p b))
+    | none =>
+      let proj? := bs.extract 0 k |>.findSome? fun
+        | .vdecl x t (.proj j' y) _ => if y == r && j' == j then some (x, t) else none
+        | _                         => none
+      match proj? with
+      | some (x, t) => decs := decs.push (FnBody.dec x 1 (t != .object) false .nil)
+      | none =>
+        let x : VarId := ⟨← modifyGet fun idx => (idx + 1, idx + 1)⟩
+        decs := decs.push (.vdecl x .tobject (.proj j r) .nil)
+        decs := decs.push (.dec x 1 true false .nil)
+  return some (pre.filterMap id ++ decs ++ bs.extract (k+1) bs.size)
+
+/-- Use the tuple versions of `tupleFns` for calls whose results are only projected, see `useTuple?`. -/
+partial def rewriteCalls (tupleFns : HashMap FunId CtorInfo) (b : FnBody) : StateM Index FnBody := do
+  let (bs, term) := b.flatten
+  let term ← match term with
+    | .case tid x xType alts => do pure <| .case tid x xType (← alts.mapM (·.mmodifyBody (rewriteCalls tupleFns)))
+    | term => pure term
+  let mut bs ← bs.mapM fun
+    | .jdecl j ys v k => do pure <| .jdecl j ys (← rewriteCalls tupleFns v) k
+    | b => pure b
+  -- process the calls from the last one, so that the instructions following each call are final
+  let mut i := bs.size
+  while i > 0 do
+    i := i - 1
+    if let .vdecl r _ (.fap g ys) _ := bs[i]! then
+      if let some c := tupleFns.find? g then
+        if let some rest ← useTuple? r c (bs.extract (i+1) bs.size) term then
+          bs := (bs.extract 0 i).push (.vdecl r (tupleType c) (.fap g ys) .nil) ++ rest
+  return reshape bs term
+
+/-- Apply `rewriteCalls` to the body of `decl`. -/
+def rewriteDeclCalls (tupleFns : HashMap FunId CtorInfo) (decl : Decl) : Decl :=
+  match decl with
+  | .fdecl f xs t b info => .fdecl f xs t ((rewriteCalls tupleFns b).run' decl.maxIndex) info
+  | d                    => d
+
+/-- The tuple version of `decl`, which returns `c`. -/
+def mkTupleDecl (c : CtorInfo) (decl : Decl) : Decl :=
+  match decl with
+  | .fdecl f xs _ b info => .fdecl f xs (tupleType c) (mkTupleBody c b) info
+  | d                    => d
+
 end Lean.IR.UnboxResult
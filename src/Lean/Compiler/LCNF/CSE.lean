@@ -104,7 +104,7 @@ def Decl.cse (decl : Decl) : CompilerM Decl := do
   return { decl with value }
 
 def cse (phase : Phase := .base) (occurrence := 0) : Pass :=
-  .mkPerDeclaration `cse Decl.cse phase occurrence
+  .mkPerDeclaration `cse Decl.cse phase occurrence (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.cse (inherited := true)
@@ -303,7 +303,7 @@ def Decl.floatLetIn (decl : Decl) : CompilerM Decl := do
   FloatLetIn.floatLetIn decl
 
 def floatLetIn (phase := Phase.base) (occurrence := 0) : Pass :=
-  .mkPerDeclaration `floatLetIn Decl.floatLetIn phase occurrence
+  .mkPerDeclaration `floatLetIn Decl.floatLetIn phase occurrence (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.floatLetIn (inherited := true)
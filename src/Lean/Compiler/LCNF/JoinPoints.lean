@@ -604,7 +604,7 @@ def Decl.findJoinPoints (decl : Decl) : CompilerM Decl := do
   JoinPointFinder.replace decl findResult
 
 def findJoinPoints : Pass :=
-  .mkPerDeclaration `findJoinPoints Decl.findJoinPoints .base
+  .mkPerDeclaration `findJoinPoints Decl.findJoinPoints .base (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.findJoinPoints (inherited := true)
@@ -613,7 +613,7 @@ def Decl.extendJoinPointContext (decl : Decl) : CompilerM Decl := do
   JoinPointContextExtender.extend decl
 
 def extendJoinPointContext : Pass :=
-  .mkPerDeclaration `extendJoinPointContext Decl.extendJoinPointContext .mono
+  .mkPerDeclaration `extendJoinPointContext Decl.extendJoinPointContext .mono (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.extendJoinPointContext (inherited := true)
@@ -622,7 +622,7 @@ def Decl.commonJoinPointArgs (decl : Decl) : CompilerM Decl := do
   JoinPointCommonArgs.reduce decl
 
 def commonJoinPointArgs : Pass :=
-  .mkPerDeclaration `commonJoinPointArgs Decl.commonJoinPointArgs .mono
+  .mkPerDeclaration `commonJoinPointArgs Decl.commonJoinPointArgs .mono (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.commonJoinPointArgs (inherited := true)
@@ -57,6 +57,35 @@ mutual
     | _ => lctx
 end
 
+def LCtx.eraseDecl (lctx : LCtx) (decl : Decl) : LCtx :=
+  eraseCode decl.value <| lctx.eraseParams decl.params
+
+def LCtx.addParams (lctx : LCtx) (ps : Array Param) : LCtx :=
+  { lctx with params := ps.foldl (init := lctx.params) fun params p => params.insert p.fvarId p }
+
+mutual
+  /-- Add `decl` and the free variables occurring in it. -/
+  partial def LCtx.addFunDeclRec (lctx : LCtx) (decl : FunDecl) : LCtx :=
+    addCode decl.value <| (lctx.addFunDecl decl).addParams decl.params
+
+  partial def LCtx.addAlts (alts : Array Alt) (lctx : LCtx) : LCtx :=
+    alts.foldl (init := lctx) fun lctx alt =>
+      match alt with
+      | .default k => addCode k lctx
+      | .alt _ ps k => addCode k <| lctx.addParams ps
+
+  /-- Add all free variables declared in `code`, the inverse of `eraseCode`. -/
+  partial def LCtx.addCode (code : Code) (lctx : LCtx) : LCtx :=
+    match code with
+    | .let decl k => addCode k <| lctx.addLetDecl decl
+    | .jp decl k | .fun decl k => addCode k <| addFunDeclRec lctx decl
+    | .cases c => addAlts c.alts lctx
+    | _ => lctx
+end
+
+def LCtx.addDecl (lctx : LCtx) (decl : Decl) : LCtx :=
+  addCode decl.value <| lctx.addParams decl.params
+
 /--
 Convert a LCNF local context into a regular Lean local context.
 -/
@@ -12,6 +12,7 @@ import Lean.Compiler.LCNF.Check
 import Lean.Compiler.LCNF.PullLetDecls
 import Lean.Compiler.LCNF.PhaseExt
 import Lean.Compiler.LCNF.CSE
+import Lean.Compiler.LCNF.ResultCache
 
 namespace Lean.Compiler.LCNF
 /--
@@ -68,6 +69,11 @@ def run (declNames : Array Name) : CompilerM (Array Decl) := withAtLeastMaxRecDe
   -/
   let declNames ← declNames.filterM (shouldGenerateCode ·)
   if declNames.isEmpty then return #[]
+  let hash? ← ResultCache.getHash? declNames
+  if let some hash := hash? then
+    if let some entry ← ResultCache.find? hash then
+      return entry.monoDecls
+  let numSpecs := Specialize.specCacheExt.getEntries (← getEnv) |>.length
   let mut decls ← declNames.mapM toDecl
   decls := markRecDecls decls
   let manager ← getPassManager
@@ -80,6 +86,8 @@ def run (declNames : Array Name) : CompilerM (Array Decl) := withAtLeastMaxRecDe
       -- We display the declaration saved in the environment because the names have been normalized
       let some decl' ← getDeclAt? decl.name .mono | unreachable!
       Lean.addTrace `Compiler.result m!"size: {decl.size}\n{← ppDecl' decl'}"
+  if let some hash := hash? then
+    ResultCache.record hash declNames decls numSpecs
   return decls
 
 end PassManager
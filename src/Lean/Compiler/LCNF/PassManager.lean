@@ -86,13 +86,66 @@ instance : ToString Phase where
     | .mono => "mono"
     | .impure => "impure"
 
+register_builtin_option compiler.parallelPassThreshold : Nat := {
+  defValue := 1000
+  group    := "compiler"
+  descr    := "(compiler) minimal total size of a batch of declarations for running the parallel per declaration passes on its declarations in parallel, 0 disables it"
+}
+
 namespace Pass
 
-def mkPerDeclaration (name : Name) (run : Decl → CompilerM Decl) (phase : Phase) (occurrence : Nat := 0) : Pass where
+/--
+Run `f` on each of `decls` in a separate task. Each task gets its own name generator, so that the free variables
+created for different declarations are distinct, and the states of the tasks are merged in the order of `decls`,
+so the result does not depend on scheduling. Changes of the environment made by `f` are dropped, so `f` may only
+update caches in the environment, e.g., the ones of `inferType`.
+-/
+def runPerDeclarationParallel (f : Decl → CompilerM Decl) (decls : Array Decl) : CompilerM (Array Decl) := do
+  let ctx ← read
+  let s ← get
+  let coreCtx ← readThe Core.Context
+  let coreState ← getThe Core.State
+  let mut ngen := coreState.ngen
+  let mut tasks := #[]
+  for decl in decls do
+    let (child, parent) := ngen.mkChild
+    ngen := parent
+    let coreState := { coreState with ngen := child, traceState := {}, messages := {} }
+    tasks := tasks.push (← EIO.asTask (CoreM.run (StateRefT'.run (f decl ctx) s) coreCtx coreState))
+  let mut result := #[]
+  let mut lctx := s.lctx
+  let mut nextIdx := s.nextIdx
+  let mut traces := coreState.traceState.traces
+  let mut messages := coreState.messages
+  for decl in decls, task in tasks do
+    match task.get with
+    | .error ex => throw ex
+    | .ok ((decl', s'), coreState') =>
+      lctx := lctx.eraseDecl decl |>.addDecl decl'
+      nextIdx := max nextIdx s'.nextIdx
+      traces := coreState'.traceState.traces.foldl (·.push ·) traces
+      messages := messages ++ coreState'.messages
+      result := result.push decl'
+  set { s with lctx, nextIdx }
+  modifyThe Core.State fun s => { s with ngen, traceState.traces := traces, messages }
+  return result
+
+/--
+Create a pass that runs `run` on each declaration. If `parallel` is `true`, the declarations of large batches are
+processed in parallel, see `runPerDeclarationParallel`. This is only valid if `run` does not modify the environment
+except for caches, and does not depend on the local context of other declarations.
+-/
+def mkPerDeclaration (name : Name) (run : Decl → CompilerM Decl) (phase : Phase) (occurrence : Nat := 0)
+    (parallel := false) : Pass where
   occurrence := occurrence
   phase := phase
   name := name
-  run := fun xs => xs.mapM run
+  run := fun xs => do
+    let threshold := compiler.parallelPassThreshold.get (← getOptions)
+    if parallel && xs.size > 1 && threshold != 0 && xs.foldl (· + ·.size) 0 ≥ threshold then
+      runPerDeclarationParallel run xs
+    else
+      xs.mapM run
 
 end Pass
 
@@ -71,7 +71,7 @@ def Decl.reduceJpArity (decl : Decl) : CompilerM Decl := do
   return { decl with value }
 
 def reduceJpArity (phase := Phase.base) : Pass :=
-  .mkPerDeclaration `reduceJpArity Decl.reduceJpArity phase
+  .mkPerDeclaration `reduceJpArity Decl.reduceJpArity phase (parallel := true)
 
 builtin_initialize
   registerTraceClass `Compiler.reduceJpArity (inherited := true)
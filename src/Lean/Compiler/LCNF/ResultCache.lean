@@ -0,0 +1,201 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Compiler.CSimpAttr
+import Lean.Compiler.ExternAttr
+import Lean.Compiler.ImplementedByAttr
+import Lean.Compiler.InlineAttrs
+import Lean.Compiler.Specialize
+import Lean.Compiler.LCNF.DeclHash
+import Lean.Compiler.LCNF.PassManager
+import Lean.Compiler.LCNF.PhaseExt
+import Lean.Compiler.LCNF.SpecInfo
+import Lean.Compiler.LCNF.Specialize
+import Lean.Compiler.LCNF.ToDecl
+
+/-!
+Caching of the results of the LCNF pipeline across builds of a module.
+
+When `compiler.lcnfCache` is set, the results of the previous build are read from the given file, and
+`PassManager.run` reuses the results of a batch of declarations whose inputs are unchanged instead of running the
+passes again. `saveResultCache` writes the results of the current build to the file. The cache is disabled by
+default; the `lean` executable writes it after the `.olean` file only if the option is set explicitly.
+
+A batch is identified by the hash of
+- the compiler options and the names of the passes,
+- the names, types, values, and inline, specialization, `implemented_by`, `extern` and `csimp` attributes of its
+  declarations, and
+- for each constant they use, the same attributes, its LCNF declaration or its type if there is none, and,
+  transitively, the constants that replace it (`csimp`, `implemented_by`) and the values of `macro_inline`
+  constants, which are expanded before their LCNF declarations are used. Like declarations saved in the environment,
+  the LCNF declarations are normalized, and they already reflect the declarations they depend on.
+
+Only batches whose effects on the environment are saving their own declarations and specialization information are
+cached. In particular, batches that create auxiliary declarations such as specializations are always compiled again.
+-/
+
+namespace Lean.Compiler.LCNF
+
+register_builtin_option compiler.lcnfCache : String := {
+  defValue := ""
+  group    := "compiler"
+  descr    := "(compiler) file for caching the results of the LCNF pipeline across builds of a module, the results of the previous build are reused for declarations whose inputs did not change"
+}
+
+namespace ResultCache
+
+/-- The results of compiling a batch of declarations. -/
+structure Entry where
+  hash      : UInt64
+  baseDecls : Array Decl
+  monoDecls : Array Decl
+  specInfos : Array SpecEntry
+  deriving Inhabited
+
+structure Cache where
+  fileName : String := ""
+  entries  : HashMap UInt64 Entry := {}
+  deriving Inhabited
+
+/-- The cache read last, so that it is read only once per build. -/
+builtin_initialize cacheRef : IO.Ref Cache ← IO.mkRef {}
+
+/-- The entries of the batches compiled, or reused, in the current module. -/
+builtin_initialize newEntriesExt : EnvExtension (Array Entry) ← registerEnvExtension (pure #[])
+
+private unsafe def loadUnsafe (fileName : String) : IO Cache := do
+  let cache ← cacheRef.get
+  if cache.fileName == fileName then
+    return cache
+  let mut entries : HashMap UInt64 Entry := {}
+  if (← System.FilePath.pathExists fileName) then
+    try
+      -- The region stays alive as the cached declarations are added to the environment.
+      let (mod, _) ← readModuleData fileName
+      for (_, es) in mod.entries do
+        for e in es do
+          let e : Entry := unsafeCast e
+          entries := entries.insert e.hash e
+    catch _ =>
+      -- an unreadable cache, e.g. of another version of Lean, is ignored
+      pure ()
+  let cache : Cache := { fileName, entries }
+  cacheRef.set cache
+  return cache
+
+@[implemented_by loadUnsafe]
+private opaque load (fileName : String) : IO Cache
+
+private def hashDecl? (decl? : Option Decl) : Option UInt64 :=
+  decl?.map hash
+
+private def ExternEntry.toString : ExternEntry → String
+  | .adhoc backend          => s!"adhoc {backend}"
+  | .inline backend pattern => s!"inline {backend} {pattern}"
+  | .standard backend fn    => s!"standard {backend} {fn}"
+  | .foreign backend fn     => s!"foreign {backend} {fn}"
+
+/-- The hash of the attributes of `declName` that affect the code generated for it or for its users. -/
+private def hashAttributes (env : Environment) (declName : Name) : UInt64 :=
+  let h := hash (getInlineAttribute? env declName)
+  let h := mixHash h (hash (hasSpecializeAttribute env declName, hasNospecializeAttribute env declName))
+  let h := mixHash h (hash (getImplementedBy? env declName))
+  let h := mixHash h (hash (CSimp.ext.getState env |>.map.find? declName))
+  let extern? := getExternAttrData? env declName |>.map fun d => (d.arity?, d.entries.map ExternEntry.toString)
+  mixHash h (hash extern?)
+
+private partial def hashDependency (declName : Name) : StateT NameSet CoreM UInt64 := do
+  if (← get).contains declName then return hash declName
+  modify (·.insert declName)
+  let env ← getEnv
+  let mut h := mixHash (hash declName) (hashAttributes env declName)
+  if let some declName' := CSimp.ext.getState env |>.map.find? declName then
+    h := mixHash h (← hashDependency declName')
+  if let some declName' := getImplementedBy? env declName then
+    h := mixHash h (← hashDependency declName')
+  if getInlineAttribute? env declName == some .macroInline then
+    if let some value := env.find? declName |>.bind (·.value?) then
+      h := mixHash h (hash value)
+      for c in value.getUsedConstants do
+        h := mixHash h (← hashDependency c)
+  if let some h' := hashDecl? (← getMonoDecl? declName) then return mixHash h h'
+  if let some h' := hashDecl? (← getBaseDecl? declName) then return mixHash h h'
+  match env.find? declName with
+  | some info => return mixHash h (hash info.type)
+  | none      => return h
+
+/-- The hash identifying the batch `declNames`, or `none` if the cache is disabled. -/
+def getHash? (declNames : Array Name) : CompilerM (Option UInt64) := do
+  let opts ← getOptions
+  if compiler.lcnfCache.get opts |>.isEmpty then return none
+  -- traces of cached batches would be missing
+  if (← Lean.isTracingEnabledFor `Compiler) then return none
+  let env ← getEnv
+  let opts := opts.entries.filter (·.1 != `compiler.lcnfCache)
+  let mut h := hash (toString opts)
+  for pass in (← getPassManager).passes do
+    h := mixHash h (hash pass.name)
+  for declName in declNames do
+    let some info ← getDeclInfo? declName | return none
+    h := mixHash h (mixHash (hash declName) (hash info.type))
+    h := mixHash h (info.value?.map hash |>.getD 0)
+    h := mixHash h (hashAttributes env declName)
+  let mut visited : NameSet := declNames.foldl (·.insert ·) {}
+  for declName in declNames do
+    let some info ← getDeclInfo? declName | return none
+    for c in info.value?.map (·.getUsedConstants) |>.getD #[] do
+      let (hc, visited') ← hashDependency c |>.run visited
+      h := mixHash h hc
+      visited := visited'
+  return some h
+
+private def recordEntry (entry : Entry) : CoreM Unit :=
+  modifyEnv fun env => newEntriesExt.modifyState env (·.push entry)
+
+/-- Replay the results of the batch with hash `h` of the previous build if there are any. -/
+def find? (h : UInt64) : CompilerM (Option Entry) := do
+  let cache ← load (compiler.lcnfCache.get (← getOptions))
+  let some entry := cache.entries.find? h | return none
+  for decl in entry.baseDecls do
+    decl.saveBase
+  for decl in entry.monoDecls do
+    decl.saveMono
+  for specInfo in entry.specInfos do
+    modifyEnv fun env => specExtension.addEntry env specInfo
+  recordEntry entry
+  return some entry
+
+/--
+Record the results `decls` of the batch `declNames` with hash `h`. `numSpecs` is the number of specializations of the
+module before compiling the batch.
+-/
+def record (h : UInt64) (declNames : Array Name) (decls : Array Decl) (numSpecs : Nat) : CompilerM Unit := do
+  let env ← getEnv
+  unless decls.all (declNames.contains ·.name) do return
+  unless Specialize.specCacheExt.getEntries env |>.length == numSpecs do return
+  let mut entry : Entry := { hash := h, baseDecls := #[], monoDecls := #[], specInfos := #[] }
+  for declName in declNames do
+    if let some decl := baseExt.getState env |>.find? declName then
+      entry := { entry with baseDecls := entry.baseDecls.push decl }
+    if let some decl := monoExt.getState env |>.find? declName then
+      entry := { entry with monoDecls := entry.monoDecls.push decl }
+    if let some paramsInfo := getSpecParamInfoCore? env declName then
+      entry := { entry with specInfos := entry.specInfos.push { declName, paramsInfo } }
+  recordEntry entry
+
+end ResultCache
+
+/-- Write the results of the LCNF pipeline for the current module to `fileName`, see `compiler.lcnfCache`. -/
+@[export lean_lcnf_save_result_cache]
+unsafe def saveResultCache (env : Environment) (fileName : String) : IO Unit := do
+  let entries := ResultCache.newEntriesExt.getState env |>.map fun e => (unsafeCast e : EnvExtensionEntry)
+  saveModuleData fileName env.mainModule {
+    imports         := #[]
+    constants       := #[]
+    extraConstNames := #[]
+    entries         := #[(`lcnfCache, entries)]
+    constNames      := #[]
+  }
+
+end Lean.Compiler.LCNF
@@ -46,6 +46,10 @@ structure State where
   messages        : MessageLog     := {}
   /-- Info tree. We have the info tree here because we want to update it while adding attributes. -/
   infoState       : Elab.InfoState := {}
+  /--
+  Cache of `resolveGlobalName`. Unlike `cache`, `modifyEnv` only resets it when the new environment changes the
+  constants or aliases, see `ResolveName.Cache.forEnv`. -/
+  resolveNameCache : ResolveName.Cache := {}
   deriving Inhabited
 
 /-- Context for the CoreM monad. -/
@@ -88,7 +92,9 @@ instance : MonadRef CoreM where
 
 instance : MonadEnv CoreM where
   getEnv := return (← get).env
-  modifyEnv f := modify fun s => { s with env := f s.env, cache := {} }
+  modifyEnv f := modify fun s =>
+    let env := f s.env
+    { s with env, cache := {}, resolveNameCache := s.resolveNameCache.forEnv env }
 
 instance : MonadOptions CoreM where
   getOptions := return (← read).options
@@ -111,6 +117,11 @@ instance : MonadRecDepth CoreM where
 instance : MonadResolveName CoreM where
   getCurrNamespace := return (← read).currNamespace
   getOpenDecls := return (← read).openDecls
+  resolveNameCache? := some {
+    get := return (← get).resolveNameCache
+    modify := fun f => do
+      let cache ← modifyGet fun s => (s.resolveNameCache, { s with resolveNameCache := {} })
+      modify fun s => { s with resolveNameCache := f cache } }
 
 protected def withFreshMacroScope (x : CoreM α) : CoreM α := do
   let fresh ← modifyGetThe Core.State (fun st => (st.nextMacroScope, { st with nextMacroScope := st.nextMacroScope + 1 }))
@@ -126,7 +137,8 @@ instance : Elab.MonadInfoTree CoreM where
   modifyInfoState f := modify fun s => { s with infoState := f s.infoState }
 
 @[inline] def modifyCache (f : Cache → Cache) : CoreM Unit :=
-  modify fun ⟨env, next, ngen, trace, cache, messages, infoState⟩ => ⟨env, next, ngen, trace, f cache, messages, infoState⟩
+  modify fun ⟨env, next, ngen, trace, cache, messages, infoState, resolveNameCache⟩ =>
+    ⟨env, next, ngen, trace, f cache, messages, infoState, resolveNameCache⟩
 
 @[inline] def modifyInstLevelTypeCache (f : InstantiateLevelCache → InstantiateLevelCache) : CoreM Unit :=
   modifyCache fun ⟨c₁, c₂⟩ => ⟨f c₁, c₂⟩
@@ -163,7 +175,9 @@ instance : MonadTrace CoreM where
 
 /-- Restore backtrackable parts of the state. -/
 def restore (b : State) : CoreM Unit :=
-  modify fun s => { s with env := b.env, messages := b.messages, infoState := b.infoState }
+  modify fun s => { s with
+    env := b.env, messages := b.messages, infoState := b.infoState
+    resolveNameCache := s.resolveNameCache.forEnv b.env }
 
 private def mkFreshNameImp (n : Name) : CoreM Name := do
   let fresh ← modifyGet fun s => (s.nextMacroScope, { s with nextMacroScope := s.nextMacroScope + 1 })
@@ -267,10 +281,61 @@ def Exception.isMaxHeartbeat (ex : Exception) : Bool :=
 def mkArrow (d b : Expr) : CoreM Expr :=
   return Lean.mkForall (← mkFreshUserName `x) BinderInfo.default d b
 
+register_builtin_option kernel.async : Bool := {
+  defValue := false
+  descr := "type check the values of theorems in the background, so that elaboration of the following commands does not wait for the kernel; failures are reported at the end of the file"
+}
+
+/-- A theorem value being type checked in the background, see `kernel.async`. -/
+structure AsyncKernelCheck where
+  declName : Name
+  fileName : String
+  pos      : Position
+  task     : Task (Except KernelException Unit)
+
+builtin_initialize asyncKernelChecksExt : EnvExtension (Array AsyncKernelCheck) ← registerEnvExtension (pure #[])
+
+/--
+Wait for the theorem values of `env` still being checked in the background and return their failures as messages,
+together with `env` without pending checks. This must be done before the environment is trusted, e.g. before
+writing it to an `.olean` file. -/
+def Environment.waitAsyncKernelChecks (env : Environment) (opts : Options) : BaseIO (Environment × MessageLog) := do
+  let mut log : MessageLog := {}
+  for check in asyncKernelChecksExt.getState env do
+    if let .error ex := check.task.get then
+      log := log.add {
+        fileName := check.fileName
+        pos      := check.pos
+        severity := .error
+        data     := m!"(kernel) failed to check theorem '{check.declName}': " ++ ex.toMessageData opts
+      }
+  return (asyncKernelChecksExt.setState env #[], log)
+
 def addDecl (decl : Declaration) : CoreM Unit := do
   if !(← MonadLog.hasErrors) && decl.hasSorry then
     logWarning "declaration uses 'sorry'"
-  match (← getEnv).addDecl decl with
+  let env ← getEnv
+  if let .thmDecl thm := decl then
+    if kernel.async.get (← getOptions) then
+      match env.addTheoremAsync decl with
+      | .ok (env, task) =>
+        let check := { declName := thm.name, fileName := ← getFileName, pos := ← getRefPosition, task }
+        setEnv <| asyncKernelChecksExt.modifyState env (·.push check)
+      | .error ex => throwKernelException ex
+      return
+  match profileitDecl "kernel" (← getOptions) (decl.getNames.headD .anonymous) fun _ => env.addDecl decl with
+  | Except.ok    env => setEnv env
+  | Except.error ex  => throwKernelException ex
+
+/--
+Add a batch of declarations whose dependencies are already in the environment or earlier in `decls`.
+In contrast to calling `addDecl` for each of them, the values of theorems are type checked in parallel.
+-/
+def addDecls (decls : List Declaration) : CoreM Unit := do
+  if !(← MonadLog.hasErrors) && decls.any (·.hasSorry) then
+    logWarning "declaration uses 'sorry'"
+  let env ← getEnv
+  match profileit "kernel" (← getOptions) fun _ => env.addDecls decls with
   | Except.ok    env => setEnv env
   | Except.error ex  => throwKernelException ex
 
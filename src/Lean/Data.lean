@@ -4,7 +4,10 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Authors: Sebastian Ullrich
 -/
 import Lean.Data.AssocList
+import Lean.Data.BloomFilter
+import Lean.Data.BTreeMap
 import Lean.Data.Format
+import Lean.Data.FlatHashMap
 import Lean.Data.HashMap
 import Lean.Data.HashSet
 import Lean.Data.Json
@@ -0,0 +1,325 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+
+/-!
+Persistent ordered maps implemented as B-trees.
+
+`BTreeMap` has the same interface as `RBMap`, but a node stores up to `BTreeMap.maxKeys` keys and values in arrays
+instead of a single entry. A lookup visits `O(log₁₆ n)` nodes and performs a binary search over consecutive keys in
+each of them, which touches far fewer cache lines than the `O(log₂ n)` nodes of a red-black tree. In exchange, an
+insertion copies the arrays of the nodes on its path unless they are not shared, in which case they are updated in
+place.
+
+`erase` does not merge underfull nodes, the tree only shrinks when its root becomes empty. As maps of the compiler
+mostly grow, this keeps `erase` simple without affecting the depth of the tree in practice.
+-/
+
+namespace Lean
+universe u v w
+
+inductive BTreeMap.Node (α : Type u) (β : Type v) where
+  | leaf (keys : Array α) (vals : Array β)
+  /-- An inner node with `keys.size + 1` children, where the keys of `children[i]` are between `keys[i-1]` and `keys[i]`. -/
+  | node (keys : Array α) (vals : Array β) (children : Array (BTreeMap.Node α β))
+
+structure BTreeMap (α : Type u) (β : Type v) (cmp : α → α → Ordering) where
+  root : BTreeMap.Node α β := .leaf #[] #[]
+  size : Nat := 0
+
+namespace BTreeMap
+variable {α : Type u} {β : Type v} {σ : Type w} {cmp : α → α → Ordering}
+
+/-- Maximal number of keys of a node, nodes are split into two nodes of `maxKeys / 2` keys when they overflow. -/
+def maxKeys : Nat := 15
+
+namespace Node
+
+instance : Inhabited (Node α β) := ⟨.leaf #[] #[]⟩
+
+/-- The index of the first key of `keys[lo:hi]` that is not less than `k`, and whether it is equal to `k`. -/
+@[specialize] partial def lowerBound (cmp : α → α → Ordering) (keys : Array α) (k : α) (lo hi : Nat) : Nat × Bool :=
+  if lo < hi then
+    let mid := (lo + hi) / 2
+    if h : mid < keys.size then
+      match cmp keys[mid] k with
+      | .lt => lowerBound cmp keys k (mid + 1) hi
+      | .gt => lowerBound cmp keys k lo mid
+      | .eq => (mid, true)
+    else
+      (lo, false)
+  else
+    (lo, false)
+
+@[specialize] partial def find? (cmp : α → α → Ordering) : Node α β → α → Option β
+  | .leaf keys vals, k =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    if found then vals[i]? else none
+  | .node keys vals children, k =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    if found then
+      vals[i]?
+    else match children[i]? with
+      | some c => find? cmp c k
+      | none   => none
+
+inductive InsertResult (α : Type u) (β : Type v) where
+  | done (n : Node α β)
+  | split (l : Node α β) (k : α) (v : β) (r : Node α β)
+
+private def splitLeaf (keys : Array α) (vals : Array β) : InsertResult α β :=
+  let m := keys.size / 2
+  if h : m < keys.size ∧ m < vals.size then
+    .split (.leaf (keys.extract 0 m) (vals.extract 0 m)) (keys[m]'h.1) (vals[m]'h.2)
+      (.leaf (keys.extract (m+1) keys.size) (vals.extract (m+1) vals.size))
+  else
+    .done (.leaf keys vals)
+
+private def splitNode (keys : Array α) (vals : Array β) (children : Array (Node α β)) : InsertResult α β :=
+  let m := keys.size / 2
+  if h : m < keys.size ∧ m < vals.size then
+    .split (.node (keys.extract 0 m) (vals.extract 0 m) (children.extract 0 (m+1))) (keys[m]'h.1) (vals[m]'h.2)
+      (.node (keys.extract (m+1) keys.size) (vals.extract (m+1) vals.size) (children.extract (m+1) children.size))
+  else
+    .done (.node keys vals children)
+
+/-- Insert `k ↦ v`, the result is `true` if `k` was not in the tree yet. -/
+@[specialize] partial def ins (cmp : α → α → Ordering) (k : α) (v : β) : Node α β → InsertResult α β × Bool
+  | .leaf keys vals =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    if found then
+      (.done (.leaf (keys.set! i k) (vals.set! i v)), false)
+    else
+      let keys := keys.insertAt! i k
+      let vals := vals.insertAt! i v
+      (if keys.size > maxKeys then splitLeaf keys vals else .done (.leaf keys vals), true)
+  | .node keys vals children =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    if found then
+      (.done (.node (keys.set! i k) (vals.set! i v) children), false)
+    else match children[i]? with
+      | none   => (.done (.node keys vals children), false)
+      | some c =>
+        -- take the child out of `children` so that it can be updated in place
+        let children := children.set! i default
+        match ins cmp k v c with
+        | (.done c, isNew) => (.done (.node keys vals (children.set! i c)), isNew)
+        | (.split l k' v' r, isNew) =>
+          let keys     := keys.insertAt! i k'
+          let vals     := vals.insertAt! i v'
+          let children := (children.set! i l).insertAt! (i+1) r
+          (if keys.size > maxKeys then splitNode keys vals children else .done (.node keys vals children), isNew)
+
+/-- Remove the maximal entry of the tree, or return `none` if it is empty. -/
+partial def popMax? : Node α β → Option (Node α β × α × β)
+  | .leaf keys vals =>
+    match keys.back?, vals.back? with
+    | some k, some v => some (.leaf keys.pop vals.pop, k, v)
+    | _, _           => none
+  | .node keys vals children =>
+    match children.back? with
+    | none   => none
+    | some c =>
+      match popMax? c with
+      | some (c, k, v) => some (.node keys vals (children.set! (children.size - 1) c), k, v)
+      | none =>
+        -- the last child is empty, the last key of the node is the maximum
+        match keys.back?, vals.back? with
+        | some k, some v => some (.node keys.pop vals.pop children.pop, k, v)
+        | _, _           => none
+
+/-- Remove `k`, the result is `true` if `k` was in the tree. -/
+@[specialize] partial def del (cmp : α → α → Ordering) (k : α) : Node α β → Node α β × Bool
+  | n@(.leaf keys vals) =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    if found then (.leaf (keys.eraseIdx i) (vals.eraseIdx i), true) else (n, false)
+  | n@(.node keys vals children) =>
+    let (i, found) := lowerBound cmp keys k 0 keys.size
+    match children[i]? with
+    | none   => (n, false)
+    | some c =>
+      let children := children.set! i default
+      if found then
+        -- replace the entry by the maximum of its left subtree
+        match popMax? c with
+        | some (c, k', v') => (.node (keys.set! i k') (vals.set! i v') (children.set! i c), true)
+        | none             => (.node (keys.eraseIdx i) (vals.eraseIdx i) (children.eraseIdx i), true)
+      else
+        let (c, erased) := del cmp k c
+        (.node keys vals (children.set! i c), erased)
+
+@[specialize] partial def foldM [Monad m] (f : σ → α → β → m σ) (init : σ) : Node α β → m σ
+  | .leaf keys vals => do
+    let mut b := init
+    for i in [0:keys.size] do
+      if let (some k, some v) := (keys[i]?, vals[i]?) then
+        b ← f b k v
+    return b
+  | .node keys vals children => do
+    let mut b := init
+    for i in [0:keys.size] do
+      if let some c := children[i]? then
+        b ← foldM f b c
+      if let (some k, some v) := (keys[i]?, vals[i]?) then
+        b ← f b k v
+    if let some c := children.back? then
+      b ← foldM f b c
+    return b
+
+@[specialize] partial def forIn [Monad m] (n : Node α β) (init : σ) (f : α × β → σ → m (ForInStep σ)) :
+    m (ForInStep σ) := do
+  let visit (b : σ) (keys : Array α) (vals : Array β) (i : Nat) : m (ForInStep σ) :=
+    match keys[i]?, vals[i]? with
+    | some k, some v => f (k, v) b
+    | _, _           => pure (.yield b)
+  match n with
+  | .leaf keys vals =>
+    let mut b := init
+    for i in [0:keys.size] do
+      match (← visit b keys vals i) with
+      | .done b   => return .done b
+      | .yield b' => b := b'
+    return .yield b
+  | .node keys vals children =>
+    let mut b := init
+    for i in [0:keys.size] do
+      if let some c := children[i]? then
+        match (← forIn c b f) with
+        | .done b   => return .done b
+        | .yield b' => b := b'
+      match (← visit b keys vals i) with
+      | .done b   => return .done b
+      | .yield b' => b := b'
+    match children.back? with
+    | some c => forIn c b f
+    | none   => return .yield b
+
+partial def min? : Node α β → Option (α × β)
+  | .leaf keys vals => match keys[0]?, vals[0]? with
+    | some k, some v => some (k, v)
+    | _, _           => none
+  | .node keys vals children =>
+    match children[0]?.bind min? with
+    | some e => some e
+    | none   => match keys[0]?, vals[0]? with
+      | some k, some v => some (k, v)
+      | _, _           => none
+
+partial def max? : Node α β → Option (α × β)
+  | .leaf keys vals => match keys.back?, vals.back? with
+    | some k, some v => some (k, v)
+    | _, _           => none
+  | .node keys vals children =>
+    match children.back?.bind max? with
+    | some e => some e
+    | none   => match keys.back?, vals.back? with
+      | some k, some v => some (k, v)
+      | _, _           => none
+
+/-- Number of nodes on the path from the root to the leftmost leaf. -/
+partial def depth : Node α β → Nat
+  | .leaf ..            => 1
+  | .node _ _ children => (children[0]?.map depth |>.getD 0) + 1
+
+end Node
+
+instance : EmptyCollection (BTreeMap α β cmp) := ⟨{}⟩
+
+instance : Inhabited (BTreeMap α β cmp) := ⟨{}⟩
+
+@[inline] def empty : BTreeMap α β cmp := {}
+
+@[inline] def isEmpty (t : BTreeMap α β cmp) : Bool :=
+  t.size == 0
+
+@[inline] def find? (t : BTreeMap α β cmp) (k : α) : Option β :=
+  t.root.find? cmp k
+
+@[inline] def findD (t : BTreeMap α β cmp) (k : α) (v₀ : β) : β :=
+  (t.find? k).getD v₀
+
+@[inline] def find! [Inhabited β] (t : BTreeMap α β cmp) (k : α) : β :=
+  match t.find? k with
+  | some b => b
+  | none   => panic! "key is not in the map"
+
+@[inline] def contains (t : BTreeMap α β cmp) (k : α) : Bool :=
+  (t.find? k).isSome
+
+@[specialize] def insert (t : BTreeMap α β cmp) (k : α) (v : β) : BTreeMap α β cmp :=
+  -- destructure `t` first so that the root is not shared with it
+  let ⟨root, size⟩ := t
+  match root.ins cmp k v with
+  | (.done root, isNew)       => { root, size := if isNew then size + 1 else size }
+  | (.split l k v r, isNew)   => { root := .node #[k] #[v] #[l, r], size := if isNew then size + 1 else size }
+
+@[specialize] def erase (t : BTreeMap α β cmp) (k : α) : BTreeMap α β cmp :=
+  let ⟨root, size⟩ := t
+  match root.del cmp k with
+  | (_, false)                     => { root, size }
+  | (.node #[] #[] #[root], true) => { root, size := size - 1 }
+  | (root, true)                  => { root, size := size - 1 }
+
+@[inline] def foldM [Monad m] (f : σ → α → β → m σ) (init : σ) (t : BTreeMap α β cmp) : m σ :=
+  t.root.foldM f init
+
+@[inline] def fold (f : σ → α → β → σ) (init : σ) (t : BTreeMap α β cmp) : σ :=
+  Id.run <| t.foldM f init
+
+@[inline] def forM [Monad m] (f : α → β → m PUnit) (t : BTreeMap α β cmp) : m PUnit :=
+  t.foldM (fun _ k v => f k v) ⟨⟩
+
+@[inline] protected def forIn [Monad m] (t : BTreeMap α β cmp) (init : σ) (f : (α × β) → σ → m (ForInStep σ)) : m σ := do
+  match (← t.root.forIn init f) with
+  | .done b  => pure b
+  | .yield b => pure b
+
+instance : ForIn m (BTreeMap α β cmp) (α × β) where
+  forIn := BTreeMap.forIn
+
+def toList (t : BTreeMap α β cmp) : List (α × β) :=
+  t.fold (fun ps k v => (k, v) :: ps) [] |>.reverse
+
+def toArray (t : BTreeMap α β cmp) : Array (α × β) :=
+  t.fold (fun ps k v => ps.push (k, v)) (Array.mkEmpty t.size)
+
+/-- Returns the kv pair `(a,b)` such that `a ≤ k` for all keys in the map. -/
+@[inline] protected def min (t : BTreeMap α β cmp) : Option (α × β) :=
+  t.root.min?
+
+/-- Returns the kv pair `(a,b)` such that `a ≥ k` for all keys in the map. -/
+@[inline] protected def max (t : BTreeMap α β cmp) : Option (α × β) :=
+  t.root.max?
+
+@[specialize] def ofList : List (α × β) → BTreeMap α β cmp
+  | []        => {}
+  | (k,v)::xs => (ofList xs).insert k v
+
+@[inline] def fromList (l : List (α × β)) (cmp : α → α → Ordering) : BTreeMap α β cmp :=
+  l.foldl (fun t (k, v) => t.insert k v) {}
+
+@[inline] def fromArray (l : Array (α × β)) (cmp : α → α → Ordering) : BTreeMap α β cmp :=
+  l.foldl (fun t (k, v) => t.insert k v) {}
+
+/-- Returns true if the given predicate is true for all items in the map. -/
+@[inline] def all (t : BTreeMap α β cmp) (p : α → β → Bool) : Bool := Id.run do
+  for (k, v) in t do
+    unless p k v do return false
+  return true
+
+/-- Returns true if the given predicate is true for any item in the map. -/
+@[inline] def any (t : BTreeMap α β cmp) (p : α → β → Bool) : Bool := Id.run do
+  for (k, v) in t do
+    if p k v then return true
+  return false
+
+def depth (t : BTreeMap α β cmp) : Nat :=
+  t.root.depth
+
+instance [Repr α] [Repr β] : Repr (BTreeMap α β cmp) where
+  reprPrec m prec := Repr.addAppParen ("Lean.BTreeMap.fromList " ++ repr m.toList) prec
+
+end BTreeMap
+
+end Lean
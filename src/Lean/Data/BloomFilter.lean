@@ -0,0 +1,65 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+namespace Lean
+universe u
+
+/--
+  A Bloom filter over the hashes of a set of values: `mayContain` returns `false` only for values that have not been
+  inserted, and `true` for all inserted values and for a small fraction of the others. Every value sets
+  `BloomFilter.numProbes` bits of a byte array, which are derived from its 64-bit hash by double hashing.
+
+  The empty filter, which has no bits, may contain every value. As with `Array`, `insert` is destructive only if the
+  filter is not shared, so filters are meant to be built once and then only queried. -/
+structure BloomFilter where
+  bits : ByteArray := ByteArray.empty
+  deriving Inhabited
+
+namespace BloomFilter
+
+/-- Number of bits set by every value. With `16` bits per value, about `0.2%` of the other values pass the filter. -/
+def numProbes : Nat := 5
+
+/-- Smallest power of two that is at least `64` bytes and has `16` bits for each of `n` values. -/
+private partial def numBytesFor (n : Nat) (c : Nat := 64) : Nat :=
+  if n * 2 ≤ c then c else numBytesFor n (c * 2)
+
+/-- An empty filter with room for `n` values. -/
+def mkEmpty (n : Nat) : BloomFilter :=
+  { bits := ⟨mkArray (numBytesFor n) 0⟩ }
+
+@[inline] private def probe (numBits : UInt64) (h : UInt64) (i : Nat) : Nat :=
+  -- the second hash is odd, so that the probes of a value are distinct
+  ((h + i.toUInt64 * ((h >>> 32) ||| 1)) &&& (numBits - 1)).toNat
+
+def insertHash (f : BloomFilter) (h : UInt64) : BloomFilter := Id.run do
+  let numBits := (f.bits.size * 8).toUInt64
+  let mut bits := f.bits
+  for i in [0:numProbes] do
+    let j := probe numBits h i
+    bits := bits.set! (j / 8) (bits.get! (j / 8) ||| (1 <<< (j % 8).toUInt8))
+  return { bits }
+
+def mayContainHash (f : BloomFilter) (h : UInt64) : Bool := Id.run do
+  if f.bits.size == 0 then
+    return true
+  let numBits := (f.bits.size * 8).toUInt64
+  for i in [0:numProbes] do
+    let j := probe numBits h i
+    if f.bits.get! (j / 8) &&& (1 <<< (j % 8).toUInt8) == 0 then
+      return false
+  return true
+
+@[inline] def insert {α : Type u} [Hashable α] (f : BloomFilter) (a : α) : BloomFilter :=
+  f.insertHash (hash a)
+
+@[inline] def mayContain {α : Type u} [Hashable α] (f : BloomFilter) (a : α) : Bool :=
+  f.mayContainHash (hash a)
+
+/-- Size of the filter in bytes. -/
+def numBytes (f : BloomFilter) : Nat :=
+  f.bits.size
+
+end BloomFilter
+end Lean
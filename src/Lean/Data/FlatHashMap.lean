@@ -0,0 +1,155 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+namespace Lean
+universe u v w
+
+/--
+  A hash map using open addressing with linear probing. Keys and values are stored in two flat arrays,
+  and a byte array holds one control byte per slot: `0` for an empty slot, and otherwise the top seven
+  bits of the hash of the key in the slot with the high bit set, so that most probes for other keys are
+  rejected without comparing keys. Erasing an entry shifts the following entries of its probe sequence
+  back, so there are no tombstones.
+
+  Unlike `HashMap`, entries are not allocated individually. Unused slots hold `default` keys and values.
+  As with `Array`, updates are destructive only if the map is not shared. -/
+structure FlatHashMap (α : Type u) (β : Type v) where
+  size : Nat
+  ctrl : ByteArray
+  keys : Array α
+  vals : Array β
+
+namespace FlatHashMap
+variable {α : Type u} {β : Type v} [BEq α] [Hashable α] [Inhabited α] [Inhabited β]
+
+/-- Smallest power of two that is at least `8` and can hold `n` entries with a load factor of 0.75. -/
+private partial def capacityFor (n : Nat) (c : Nat := 8) : Nat :=
+  if n * 4 ≤ c * 3 then c else capacityFor n (c * 2)
+
+def empty (capacity := 0) : FlatHashMap α β :=
+  let n := capacityFor capacity
+  { size := 0
+    ctrl := ⟨mkArray n 0⟩
+    keys := mkArray n default
+    vals := mkArray n default }
+
+instance : EmptyCollection (FlatHashMap α β) := ⟨empty⟩
+
+instance : Inhabited (FlatHashMap α β) := ⟨empty⟩
+
+@[inline] private def ctrlOf (h : UInt64) : UInt8 :=
+  (h >>> 57).toUInt8 ||| 0x80
+
+@[inline] private def homeSlot (capacity : Nat) (h : UInt64) : Nat :=
+  (h &&& (capacity - 1).toUInt64).toNat
+
+/-- Return the slot containing `a`, or the empty slot at which `a` would be inserted. -/
+@[specialize] private partial def findSlot (ctrl : ByteArray) (keys : Array α) (a : α) (c : UInt8) (i : Nat) : Nat :=
+  let c' := ctrl.get! i
+  if c' == 0 then
+    i
+  else if c' == c && keys[i]! == a then
+    i
+  else
+    findSlot ctrl keys a c ((i + 1) &&& (ctrl.size - 1))
+
+@[inline] private def slotOf (m : FlatHashMap α β) (a : α) : Nat × UInt8 :=
+  let h := hash a
+  (findSlot m.ctrl m.keys a (ctrlOf h) (homeSlot m.ctrl.size h), ctrlOf h)
+
+def find? (m : FlatHashMap α β) (a : α) : Option β :=
+  let (i, _) := slotOf m a
+  if m.ctrl.get! i == 0 then none else some m.vals[i]!
+
+@[inline] def findD (m : FlatHashMap α β) (a : α) (b₀ : β) : β :=
+  (m.find? a).getD b₀
+
+@[inline] def find! (m : FlatHashMap α β) (a : α) : β :=
+  match m.find? a with
+  | some b => b
+  | none   => panic! "key is not in the map"
+
+def contains (m : FlatHashMap α β) (a : α) : Bool :=
+  let (i, _) := slotOf m a
+  m.ctrl.get! i != 0
+
+@[inline] def foldM {δ : Type w} {m : Type w → Type w} [Monad m] (f : δ → α → β → m δ) (init : δ) (h : FlatHashMap α β) : m δ :=
+  h.ctrl.size.foldM (init := init) fun i d =>
+    if h.ctrl.get! i == 0 then pure d else f d h.keys[i]! h.vals[i]!
+
+@[inline] def fold {δ : Type w} (f : δ → α → β → δ) (init : δ) (m : FlatHashMap α β) : δ :=
+  Id.run <| m.foldM f init
+
+@[inline] def forM {m : Type w → Type w} [Monad m] (f : α → β → m PUnit) (h : FlatHashMap α β) : m PUnit :=
+  h.foldM (fun _ a b => f a b) ⟨⟩
+
+private def grow (m : FlatHashMap α β) : FlatHashMap α β :=
+  let m' : FlatHashMap α β := empty (m.ctrl.size * 3 / 2)
+  m.fold (init := m') fun m' a b =>
+    match m' with
+    | ⟨size, ctrl, keys, vals⟩ =>
+      let h := hash a
+      -- the keys of `m` are distinct, so `a` is always placed at an empty slot
+      let i := findSlot ctrl keys a (ctrlOf h) (homeSlot ctrl.size h)
+      ⟨size + 1, ctrl.set! i (ctrlOf h), keys.set! i a, vals.set! i b⟩
+
+/-- Similar to `insert`, but also returns a Boolean flag indicating whether an existing entry has been replaced with `a -> b`. -/
+def insert' (m : FlatHashMap α β) (a : α) (b : β) : FlatHashMap α β × Bool :=
+  let m := if (m.size + 1) * 4 > m.ctrl.size * 3 then grow m else m
+  let (i, c) := slotOf m a
+  match m with
+  | ⟨size, ctrl, keys, vals⟩ =>
+    if ctrl.get! i == 0 then
+      (⟨size + 1, ctrl.set! i c, keys.set! i a, vals.set! i b⟩, false)
+    else
+      (⟨size, ctrl, keys.set! i a, vals.set! i b⟩, true)
+
+@[inline] def insert (m : FlatHashMap α β) (a : α) (b : β) : FlatHashMap α β :=
+  (m.insert' a b).1
+
+/--
+  Move entries following the freed slot `i` back until reaching an empty slot. The entry at slot `j` is
+  moved to `i` unless its home slot lies cyclically within `(i, j]`. -/
+private partial def shiftBack (i j : Nat) (ctrl : ByteArray) (keys : Array α) (vals : Array β) : ByteArray × Array α × Array β :=
+  let c := ctrl.get! j
+  if c == 0 then
+    (ctrl.set! i 0, keys.set! i default, vals.set! i default)
+  else
+    let next := (j + 1) &&& (ctrl.size - 1)
+    let k := homeSlot ctrl.size (hash keys[j]!)
+    let stays := if i ≤ j then i < k && k ≤ j else i < k || k ≤ j
+    if stays then
+      shiftBack i next ctrl keys vals
+    else
+      shiftBack j next (ctrl.set! i c) (keys.set! i keys[j]!) (vals.set! i vals[j]!)
+
+def erase (m : FlatHashMap α β) (a : α) : FlatHashMap α β :=
+  let (i, _) := slotOf m a
+  match m with
+  | ⟨size, ctrl, keys, vals⟩ =>
+    if ctrl.get! i == 0 then
+      ⟨size, ctrl, keys, vals⟩
+    else
+      let (ctrl, keys, vals) := shiftBack i ((i + 1) &&& (ctrl.size - 1)) ctrl keys vals
+      ⟨size - 1, ctrl, keys, vals⟩
+
+instance : GetElem (FlatHashMap α β) α (Option β) fun _ _ => True where
+  getElem m k _ := m.find? k
+
+@[inline] def isEmpty (m : FlatHashMap α β) : Bool :=
+  m.size = 0
+
+def toList (m : FlatHashMap α β) : List (α × β) :=
+  m.fold (init := []) fun r k v => (k, v)::r
+
+def toArray (m : FlatHashMap α β) : Array (α × β) :=
+  m.fold (init := #[]) fun r k v => r.push (k, v)
+
+/-- Builds a `FlatHashMap` from a list of key-value pairs. Values of duplicated keys are replaced by their respective last occurrences. -/
+def ofList (l : List (α × β)) : FlatHashMap α β :=
+  l.foldl (init := empty) (fun m p => m.insert p.fst p.snd)
+
+end FlatHashMap
+
+end Lean
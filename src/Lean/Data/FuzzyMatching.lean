@@ -41,6 +41,23 @@ private def containsInOrderLower (a b : String) : Bool := Id.run do
 
 end Utils
 
+/--
+A summary of the characters occurring in `s` such that `fuzzyMatchScore? pattern word` can only
+succeed if `charMask pattern &&& charMask word == charMask pattern`. It can be computed once per word
+to cheaply skip words that cannot match a pattern. The native implementation processes the bytes of `s`, which
+yields the same mask as all bytes of multi-byte characters are at least `128`. -/
+@[extern "lean_fuzzy_char_mask"]
+def charMask (s : @& String) : UInt64 :=
+  s.foldl (init := 0) fun m c =>
+    let c := c.toLower
+    if 'a' ≤ c && c ≤ 'z' then
+      m ||| (1 <<< (c.toNat - 'a'.toNat).toUInt64)
+    else if c.toNat < 128 then
+      m ||| (1 <<< (26 + c.toNat % 37).toUInt64)
+    else
+      -- `containsInOrderLower` compares bytes of multi-byte characters in the word as `'A'`
+      m ||| (1 <<< 63) ||| 1
+
 
 /-- Represents the type of a single character. -/
 inductive CharType where
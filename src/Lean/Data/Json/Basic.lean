@@ -180,6 +180,13 @@ inductive Json where
 
 namespace Json
 
+/--
+The position of the first `"`, `\` or control character at or after `pos` in `s`, or `s.endPos`. These are the
+characters that have to be escaped in JSON strings. The native implementation scans eight bytes at a time. -/
+@[extern "lean_json_next_special_pos"]
+def nextSpecialPos (s : @& String) (pos : @& String.Pos) : String.Pos :=
+  s.findAux (fun c => c = '"' || c = '\\' || c.val < 0x20) s.endPos pos
+
 private partial def beq' : Json → Json → Bool
   | null,   null   => true
   | bool a, bool b => a == b
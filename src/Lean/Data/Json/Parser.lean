@@ -17,9 +17,9 @@ def hexChar : Parsec Nat := do
   if '0' ≤ c ∧ c ≤ '9' then
     pure $ c.val.toNat - '0'.val.toNat
   else if 'a' ≤ c ∧ c ≤ 'f' then
-    pure $ c.val.toNat - 'a'.val.toNat
+    pure $ c.val.toNat - 'a'.val.toNat + 10
   else if 'A' ≤ c ∧ c ≤ 'F' then
-    pure $ c.val.toNat - 'A'.val.toNat
+    pure $ c.val.toNat - 'A'.val.toNat + 10
   else
     fail "invalid hex character"
 
@@ -39,7 +39,14 @@ def escapedChar : Parsec Char := do
     return Char.ofNat $ 4096*u1 + 256*u2 + 16*u3 + u4
   | _ => fail "illegal \\u escape"
 
+/-- Skip the characters that need no unescaping at once and append them to `acc`. -/
+@[inline]
+def plainChars (acc : String) : Parsec String := fun it =>
+  let stop := Json.nextSpecialPos it.s it.i
+  .success ⟨it.s, stop⟩ (if stop == it.i then acc else acc ++ it.s.extract it.i stop)
+
 partial def strCore (acc : String) : Parsec String := do
+  let acc ← plainChars acc
   let c ← peek!
   if c = '"' then -- "
     skip
@@ -51,8 +58,6 @@ partial def strCore (acc : String) : Parsec String := do
     -- as to whether c.val > 0xffff should be split up and encoded with multiple \u,
     -- the JSON standard is not definite: both directly printing the character
     -- and encoding it with multiple \u is allowed. we choose the former.
-    else if 0x0020 ≤ c.val ∧ c.val ≤ 0x10ffff then
-      strCore (acc.push c)
     else
       fail "unexpected character in string"
 
@@ -37,12 +37,25 @@ private def escapeAux (acc : String) (c : Char) : String :=
       Nat.digitChar ((n % 256) / 16),
       Nat.digitChar (n % 16) ].asString
 
+/-- Append `s` escaped to `acc`. Runs of characters that need no escaping are appended in one go. -/
+private partial def escapeTo (acc : String) (s : String) (pos : String.Pos := 0) : String :=
+  let stop := nextSpecialPos s pos
+  let acc := if pos == 0 && stop == s.endPos then acc ++ s else acc ++ s.extract pos stop
+  if stop.byteIdx < s.endPos.byteIdx then
+    escapeTo (escapeAux acc (s.get stop)) s (s.next stop)
+  else
+    acc
+
 def escape (s : String) : String :=
-  s.foldl escapeAux ""
+  if nextSpecialPos s 0 == s.endPos then s else escapeTo "" s
 
 def renderString (s : String) : String :=
   "\"" ++ escape s ++ "\""
 
+/-- Same as `acc ++ renderString s`, without creating intermediate strings. -/
+private def renderStringTo (acc : String) (s : String) : String :=
+  (escapeTo (acc.push '"') s).push '"'
+
 section
 
 partial def render : Json → Format
@@ -83,14 +96,14 @@ where go (acc : String) : List Json.CompressWorkItem → String
     | bool true  => go (acc ++ "true") is
     | bool false => go (acc ++ "false") is
     | num s      => go (acc ++ s.toString) is
-    | str s      => go (acc ++ renderString s) is
+    | str s      => go (renderStringTo acc s) is
     | arr elems  => go (acc ++ "[") (elems.toList.map arrayElem ++ [arrayEnd] ++ is)
     | obj kvs    => go (acc ++ "{") (kvs.fold (init := []) (fun acc k j => objectField k j :: acc) ++ [objectEnd] ++ is)
   | arrayElem j :: arrayEnd :: is      => go acc (json j :: arrayEnd :: is)
   | arrayElem j :: is                  => go acc (json j :: comma :: is)
   | arrayEnd :: is                     => go (acc ++ "]") is
-  | objectField k j :: objectEnd :: is => go (acc ++ renderString k ++ ":") (json j :: objectEnd :: is)
-  | objectField k j :: is              => go (acc ++ renderString k ++ ":") (json j :: comma :: is)
+  | objectField k j :: objectEnd :: is => go (renderStringTo acc k ++ ":") (json j :: objectEnd :: is)
+  | objectField k j :: is              => go (renderStringTo acc k ++ ":") (json j :: comma :: is)
   | objectEnd :: is                    => go (acc ++ "}") is
   | comma :: is                        => go (acc ++ ",") is
 
@@ -95,14 +95,17 @@ end
 section
   variable [ToJson α]
 
-  def writeLspMessage (h : FS.Stream) (msg : Message) : IO Unit := do
+  /-- Write a message that has already been serialized to the compressed JSON `j`. -/
+  def writeLspMessageJson (h : FS.Stream) (j : String) : IO Unit := do
     -- inlined implementation instead of using jsonrpc's writeMessage
     -- to maintain the atomicity of putStr
-    let j := (toJson msg).compress
     let header := s!"Content-Length: {toString j.utf8ByteSize}\r\n\r\n"
     h.putStr (header ++ j)
     h.flush
 
+  def writeLspMessage (h : FS.Stream) (msg : Message) : IO Unit :=
+    h.writeLspMessageJson (toJson msg).compress
+
   def writeLspRequest (h : FS.Stream) (r : Request α) : IO Unit :=
     h.writeLspMessage r
 
@@ -135,10 +135,13 @@ structure RpcReleaseParams where
 
 The client must send an RPC notification every 10s in order to keep the RPC session alive.
 This is the simplest one. On not seeing any notifications for three 10s periods, the server
-will drop the RPC session and its associated references. -/
+will drop the RPC session and its associated references. Clients with several sessions for the
+same document can keep all of them alive with a single notification using `sessionIds?`. -/
 structure RpcKeepAliveParams where
   uri : DocumentUri
   sessionId : UInt64
+  /-- Further sessions to keep alive. -/
+  sessionIds? : Option (Array UInt64) := none
   deriving FromJson, ToJson
 
 /--
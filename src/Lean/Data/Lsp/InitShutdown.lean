@@ -52,6 +52,9 @@ structure InitializationOptions where
   the server may cease including information which can be retrieved interactively in some standard
   LSP messages. Defaults to false. -/
   hasWidgets? : Option Bool
+  /-- Number of file workers started in advance. They import the header of the most recently opened file, so that
+  the next file with the same imports is ready sooner, at the cost of the memory of the idle workers. Defaults to 0. -/
+  workerPoolSize? : Option Nat := none
   deriving ToJson, FromJson
 
 structure InitializeParams where
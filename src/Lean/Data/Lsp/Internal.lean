@@ -91,4 +91,14 @@ structure LeanIleanInfoParams where
   references : ModuleRefs
   deriving FromJson, ToJson
 
+/-- `$/lean/preImport` watchdog->worker notification, sent before `initialize` to the workers that the watchdog starts
+in advance.
+
+Asks the worker to import the header of the file `uri` with contents `text` while it waits for a file to be assigned
+to it, in the expectation that this file has the same imports. -/
+structure LeanPreImportParams where
+  uri  : DocumentUri
+  text : String
+  deriving FromJson, ToJson
+
 end Lean.Lsp
@@ -157,6 +157,14 @@ def anyS (n : Name) (f : String → Bool) : Bool :=
   | .num p _ => p.anyS f
   | _ => false
 
+/--
+Return the representative of `n` in a global table of names, adding `n` if there is none.
+Structurally equal interned names are pointer equal, which makes comparing them cheap.
+Interned names are never freed.
+-/
+@[extern "lean_name_intern"]
+opaque intern (n : @& Name) : Name
+
 end Name
 end Lean
 
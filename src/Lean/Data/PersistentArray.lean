@@ -75,11 +75,18 @@ partial def setAux : PersistentArrayNode α → USize → USize → α → Persi
     node <| cs.modify j.toNat fun c => setAux c i shift a
   | leaf cs, i, _,     a => leaf (cs.set! i.toNat a)
 
+/-
+  The update functions below destructure `t` before touching its fields. Projecting `t.root` or `t.tail`
+  while `t` is still needed for `{ t with ... }` or another field would make the node shared, and force
+  `Array.set!`/`Array.push` to copy it even when `t` itself is not shared. -/
+
 def set (t : PersistentArray α) (i : Nat) (a : α) : PersistentArray α :=
-  if i >= t.tailOff then
-    { t with tail := t.tail.set! (i - t.tailOff) a }
-  else
-    { t with root := setAux t.root (USize.ofNat i) t.shift a }
+  match t with
+  | ⟨root, tail, size, shift, tailOff⟩ =>
+    if i >= tailOff then
+      ⟨root, tail.set! (i - tailOff) a, size, shift, tailOff⟩
+    else
+      ⟨setAux root (USize.ofNat i) shift a, tail, size, shift, tailOff⟩
 
 @[specialize] partial def modifyAux [Inhabited α] (f : α → α) : PersistentArrayNode α → USize → USize → PersistentArrayNode α
   | node cs, i, shift =>
@@ -90,10 +97,12 @@ def set (t : PersistentArray α) (i : Nat) (a : α) : PersistentArray α :=
   | leaf cs, i, _     => leaf (cs.modify i.toNat f)
 
 @[specialize] def modify [Inhabited α] (t : PersistentArray α) (i : Nat) (f : α → α) : PersistentArray α :=
-  if i >= t.tailOff then
-    { t with tail := t.tail.modify (i - t.tailOff) f }
-  else
-    { t with root := modifyAux f t.root (USize.ofNat i) t.shift }
+  match t with
+  | ⟨root, tail, size, shift, tailOff⟩ =>
+    if i >= tailOff then
+      ⟨root, tail.modify (i - tailOff) f, size, shift, tailOff⟩
+    else
+      ⟨modifyAux f root (USize.ofNat i) shift, tail, size, shift, tailOff⟩
 
 partial def mkNewPath (shift : USize) (a : Array α) : PersistentArrayNode α :=
   if shift == 0 then
@@ -116,26 +125,29 @@ partial def insertNewLeaf : PersistentArrayNode α → USize → USize → Array
   | n, _, _, _ => n -- unreachable
 
 def mkNewTail (t : PersistentArray α) : PersistentArray α :=
-  if t.size <= (mul2Shift 1 (t.shift + initShift)).toNat then
-    { t with
-      tail    := mkEmptyArray, root := insertNewLeaf t.root (USize.ofNat (t.size - 1)) t.shift t.tail,
-      tailOff := t.size }
-  else
-    { t with
-      tail := #[],
-      root := let n := mkEmptyArray.push t.root;
-              node (n.push (mkNewPath t.shift t.tail)),
-      shift   := t.shift + initShift,
-      tailOff := t.size }
+  match t with
+  | ⟨root, tail, size, shift, _⟩ =>
+    if size <= (mul2Shift 1 (shift + initShift)).toNat then
+      { tail    := mkEmptyArray, root := insertNewLeaf root (USize.ofNat (size - 1)) shift tail,
+        size, shift, tailOff := size }
+    else
+      { tail    := #[],
+        root    := let n := mkEmptyArray.push root;
+                   node (n.push (mkNewPath shift tail)),
+        size,
+        shift   := shift + initShift,
+        tailOff := size }
 
 def tooBig : Nat := USize.size / 8
 
 def push (t : PersistentArray α) (a : α) : PersistentArray α :=
-  let r := { t with tail := t.tail.push a, size := t.size + 1 }
-  if r.tail.size < branching.toNat || t.size >= tooBig then
-    r
-  else
-    mkNewTail r
+  match t with
+  | ⟨root, tail, size, shift, tailOff⟩ =>
+    let tail := tail.push a
+    if tail.size < branching.toNat || size >= tooBig then
+      ⟨root, tail, size + 1, shift, tailOff⟩
+    else
+      mkNewTail ⟨root, tail, size + 1, shift, tailOff⟩
 
 private def emptyArray {α : Type u} : Array (PersistentArrayNode α) :=
   Array.mkEmpty PersistentArray.branching.toNat
@@ -159,27 +171,29 @@ partial def popLeaf : PersistentArrayNode α → Option (Array α) × Array (Per
   | leaf vs   => (some vs, emptyArray)
 
 def pop (t : PersistentArray α) : PersistentArray α :=
-  if t.tail.size > 0 then
-    { t with tail := t.tail.pop, size := t.size - 1 }
-  else
-    match popLeaf t.root with
-    | (none, _) => t
-    | (some last, newRoots) =>
-      let last       := last.pop
-      let newSize    := t.size - 1
-      let newTailOff := newSize - last.size
-      if newRoots.size == 1 && (newRoots.get! 0).isNode then
-        { root    := newRoots.get! 0,
-          shift   := t.shift - initShift,
-          size    := newSize,
-          tail    := last,
-          tailOff := newTailOff }
-      else
-        { t with
-          root    := node newRoots,
-          size    := newSize,
-          tail    := last,
-          tailOff := newTailOff }
+  match t with
+  | ⟨root, tail, size, shift, tailOff⟩ =>
+    if tail.size > 0 then
+      ⟨root, tail.pop, size - 1, shift, tailOff⟩
+    else
+      match popLeaf root with
+      | (none, _) => ⟨root, tail, size, shift, tailOff⟩
+      | (some last, newRoots) =>
+        let last       := last.pop
+        let newSize    := size - 1
+        let newTailOff := newSize - last.size
+        if newRoots.size == 1 && (newRoots.get! 0).isNode then
+          { root    := newRoots.get! 0,
+            shift   := shift - initShift,
+            size    := newSize,
+            tail    := last,
+            tailOff := newTailOff }
+        else
+          { root    := node newRoots,
+            shift,
+            size    := newSize,
+            tail    := last,
+            tailOff := newTailOff }
 
 section
 variable {m : Type v → Type w} [Monad m]
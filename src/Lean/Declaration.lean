@@ -70,7 +70,7 @@ structure ConstantVal where
   name : Name
   levelParams : List Name
   type : Expr
-  deriving Inhabited
+  deriving Inhabited, BEq
 
 structure AxiomVal extends ConstantVal where
   isUnsafe : Bool
@@ -170,6 +170,16 @@ def Declaration.isUnsafeInductiveDeclEx : Declaration → Bool
   | Declaration.inductDecl _ _ _ isUnsafe => isUnsafe
   | _ => false
 
+/-- Returns the names of the main constants added by the declaration, for use in messages. -/
+def Declaration.getNames : Declaration → List Name
+  | .axiomDecl val          => [val.name]
+  | .defnDecl val           => [val.name]
+  | .thmDecl val            => [val.name]
+  | .opaqueDecl val         => [val.name]
+  | .quotDecl               => [`Quot]
+  | .mutualDefnDecl defns   => defns.map (·.name)
+  | .inductDecl _ _ types _ => types.map (·.name)
+
 @[specialize] def Declaration.foldExprM {α} {m : Type → Type} [Monad m] (d : Declaration) (f : α → Expr → m α) (a : α) : m α :=
   match d with
   | Declaration.quotDecl                                        => pure a
@@ -272,7 +282,7 @@ structure ConstructorVal extends ConstantVal where
   /-- Number of fields (i.e., arity - nparams) -/
   numFields : Nat
   isUnsafe : Bool
-  deriving Inhabited
+  deriving Inhabited, BEq
 
 @[export lean_mk_constructor_val]
 def mkConstructorValEx (name : Name) (levelParams : List Name) (type : Expr) (induct : Name) (cidx numParams numFields : Nat) (isUnsafe : Bool) : ConstructorVal := {
@@ -296,7 +306,7 @@ structure RecursorRule where
   nfields : Nat
   /-- Right hand side of the reduction rule -/
   rhs : Expr
-  deriving Inhabited
+  deriving Inhabited, BEq
 
 structure RecursorVal extends ConstantVal where
   /-- List of all inductive datatypes in the mutual declaration that generated this recursor -/
@@ -322,7 +332,7 @@ structure RecursorVal extends ConstantVal where
   -/
   k : Bool
   isUnsafe : Bool
-  deriving Inhabited
+  deriving Inhabited, BEq
 
 @[export lean_mk_recursor_val]
 def mkRecursorValEx (name : Name) (levelParams : List Name) (type : Expr) (all : List Name) (numParams numIndices numMotives numMinors : Nat)
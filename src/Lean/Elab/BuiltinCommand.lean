@@ -130,7 +130,7 @@ private partial def elabChoiceAux (cmds : Array Syntax) (i : Nat) : CommandElabM
     let id := idStx.getId
     let declName ← resolveNameUsingNamespaces nss idStx
     aliases := aliases.push (currNamespace ++ id, declName)
-  modify fun s => { s with env := aliases.foldl (init := s.env) fun env p => addAlias env p.1 p.2 }
+  modifyEnv fun env => aliases.foldl (init := env) fun env p => addAlias env p.1 p.2
 
 @[builtin_command_elab «open»] def elabOpen : CommandElab
   | `(open $decl:openDecl) => do
@@ -142,6 +142,9 @@ private def elabTParserMacroAux (prec lhsPrec e : Term) : TermElabM Syntax := do
   let stxNew ← `(sorryAx _ false)
   withMacroExpansion stx stxNew <| elabTerm stxNew expectedType?
 
+@[builtin_term_elab omission] def elabOmission : TermElab := fun _ _ =>
+  throwError "'⋯' stands for a subterm omitted by the pretty printer, set `pp.deepTerms` to `true` to display it"
+
 /-- Return syntax `Prod.mk elems[0] (Prod.mk elems[1] ... (Prod.mk elems[elems.size - 2] elems[elems.size - 1])))` -/
 partial def mkPairs (elems : Array Term) : MacroM Term :=
   let rec loop (i : Nat) (acc : Term) := do
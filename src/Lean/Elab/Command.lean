@@ -32,6 +32,10 @@ structure State where
   ngen           : NameGenerator := {}
   infoState      : InfoState := {}
   traceState     : TraceState := {}
+  /-- Cache of `resolveGlobalName`, shared by all commands, see `ResolveName.Cache`. -/
+  resolveNameCache : ResolveName.Cache := {}
+  /-- The messages of linters still running in the background, see `linter.async`. -/
+  asyncLinters   : Array (Task MessageLog) := #[]
   deriving Inhabited
 
 structure Context where
@@ -79,7 +83,9 @@ instance : MonadInfoTree CommandElabM where
 
 instance : MonadEnv CommandElabM where
   getEnv := do pure (← get).env
-  modifyEnv f := modify fun s => { s with env := f s.env }
+  modifyEnv f := modify fun s =>
+    let env := f s.env
+    { s with env, resolveNameCache := s.resolveNameCache.forEnv env }
 
 @[always_inline]
 instance : MonadOptions CommandElabM where
@@ -152,13 +158,14 @@ def liftCoreM (x : CoreM α) : CommandElabM α := do
   let heartbeats ← IO.getNumHeartbeats
   let Eα := Except Exception α
   let x : CoreM Eα := try let a ← x; pure <| Except.ok a catch ex => pure <| Except.error ex
-  let x : EIO Exception (Eα × Core.State) := (ReaderT.run x (mkCoreContext ctx s heartbeats)).run { env := s.env, ngen := s.ngen, traceState := s.traceState, messages := {}, infoState.enabled := s.infoState.enabled }
+  let x : EIO Exception (Eα × Core.State) := (ReaderT.run x (mkCoreContext ctx s heartbeats)).run { env := s.env, ngen := s.ngen, traceState := s.traceState, messages := {}, infoState.enabled := s.infoState.enabled, resolveNameCache := s.resolveNameCache }
   let (ea, coreS) ← liftM x
   modify fun s => { s with
     env := coreS.env
     ngen := coreS.ngen
     messages := addTraceAsMessagesCore ctx (s.messages ++ coreS.messages) coreS.traceState
     traceState := coreS.traceState
+    resolveNameCache := coreS.resolveNameCache
     infoState.trees := s.infoState.trees.append coreS.infoState.trees
   }
   match ea with
@@ -183,6 +190,11 @@ def getScope : CommandElabM Scope := do pure (← get).scopes.head!
 instance : MonadResolveName CommandElabM where
   getCurrNamespace := return (← getScope).currNamespace
   getOpenDecls     := return (← getScope).openDecls
+  resolveNameCache? := some {
+    get := return (← get).resolveNameCache
+    modify := fun f => do
+      let cache ← modifyGet fun s => (s.resolveNameCache, { s with resolveNameCache := {} })
+      modify fun s => { s with resolveNameCache := f cache } }
 
 instance : MonadLog CommandElabM where
   getRef      := getRef
@@ -195,7 +207,12 @@ instance : MonadLog CommandElabM where
     let msg := { msg with data := MessageData.withNamingContext { currNamespace := currNamespace, openDecls := openDecls } msg.data }
     modify fun s => { s with messages := s.messages.add msg }
 
-def runLinters (stx : Syntax) : CommandElabM Unit := do profileitM Exception "linting" (← getOptions) do
+register_builtin_option linter.async : Bool := {
+  defValue := false
+  descr := "run the linters of a command in the background, so that elaboration of the following commands does not wait for them; their messages are reported at the end of the file"
+}
+
+private def runLintersCore (stx : Syntax) : CommandElabM Unit := do profileitM Exception "linting" (← getOptions) do
   let linters ← lintersRef.get
   unless linters.isEmpty do
     for linter in linters do
@@ -207,6 +224,31 @@ def runLinters (stx : Syntax) : CommandElabM Unit := do profileitM Exception "li
       finally
         modify fun s => { savedState with messages := s.messages }
 
+/--
+Run the linters on the command `stx`, using the info trees of the current state. As linters only add messages, with
+`linter.async` they run in the background on a copy of the state.
+-/
+def runLinters (stx : Syntax) : CommandElabM Unit := do
+  unless linter.async.get (← getOptions) do
+    return ← runLintersCore stx
+  if (← lintersRef.get).isEmpty then
+    return
+  let ctx := { (← read) with tacticCache? := none }
+  let s := { (← get) with messages := {}, asyncLinters := #[] }
+  let task ← BaseIO.asTask do
+    match (← ((withLogging (runLintersCore stx)).run ctx |>.run s).toBaseIO) with
+    | .ok (_, s) => return s.messages
+    -- exceptions other than errors are not reported by synchronous linting either
+    | .error _   => return {}
+  modify fun s => { s with asyncLinters := s.asyncLinters.push task }
+
+/-- Wait for the linters still running in the background and return their messages, together with `s` without pending linters. -/
+def State.waitAsyncLinters (s : State) : BaseIO (State × MessageLog) := do
+  let mut log : MessageLog := {}
+  for task in s.asyncLinters do
+    log := log ++ (← IO.wait task)
+  return ({ s with asyncLinters := #[] }, log)
+
 protected def getCurrMacroScope : CommandElabM Nat  := do pure (← read).currMacroScope
 protected def getMainModule     : CommandElabM Name := do pure (← getEnv).mainModule
 
@@ -391,14 +433,18 @@ def liftTermElabM (x : TermElabM α) : CommandElabM α := do
   -- We execute `x` with an empty message log. Thus, `x` cannot modify/view messages produced by previous commands.
   -- This is useful for implementing `runTermElabM` where we use `Term.resetMessageLog`
   let x : TermElabM _  := withSaveInfoContext x
-  let x : MetaM _      := (observing x).run (mkTermContext ctx s) { levelNames := scope.levelNames }
+  let x : MetaM _      := do
+    let r ← (observing x).run (mkTermContext ctx s) { levelNames := scope.levelNames }
+    Meta.traceClosedDefEqCacheStats
+    return r
   let x : CoreM _      := x.run mkMetaContext {}
-  let x : EIO _ _      := x.run (mkCoreContext ctx s heartbeats) { env := s.env, ngen := s.ngen, nextMacroScope := s.nextMacroScope, infoState.enabled := s.infoState.enabled }
+  let x : EIO _ _      := x.run (mkCoreContext ctx s heartbeats) { env := s.env, ngen := s.ngen, nextMacroScope := s.nextMacroScope, infoState.enabled := s.infoState.enabled, resolveNameCache := s.resolveNameCache }
   let (((ea, _), _), coreS) ← liftEIO x
   modify fun s => { s with
     env             := coreS.env
     nextMacroScope  := coreS.nextMacroScope
     ngen            := coreS.ngen
+    resolveNameCache := coreS.resolveNameCache
     infoState.trees := s.infoState.trees.append coreS.infoState.trees
     messages        := addTraceAsMessagesCore ctx (s.messages ++ coreS.messages) coreS.traceState
   }
@@ -10,11 +10,45 @@ import Lean.Server.References
 
 namespace Lean.Elab.Frontend
 
+register_builtin_option parseAhead : Bool := {
+  defValue := false
+  descr := "parse the next command in a separate task while the current one is being elaborated; the result is discarded if the command changed the parser"
+}
+
+/-- The parts of a `ParserModuleContext` that may affect the result of `Parser.parseCommand`. -/
+structure ParserDeps where
+  parserState   : Parser.ParserExtension.State
+  namespaces    : NameSSet
+  options       : Options
+  currNamespace : Name
+  openDecls     : List OpenDecl
+
+def ParserDeps.ofContext (pmctx : Parser.ParserModuleContext) : ParserDeps := {
+  parserState   := Parser.parserExtension.getState pmctx.env
+  namespaces    := namespacesExt.getState pmctx.env
+  options       := pmctx.options
+  currNamespace := pmctx.currNamespace
+  openDecls     := pmctx.openDecls
+}
+
+private unsafe def ParserDeps.equivUnsafe (a b : ParserDeps) : Bool :=
+  ptrEq a.parserState b.parserState && ptrEq a.namespaces b.namespaces && ptrEq a.options b.options &&
+    a.currNamespace == b.currNamespace && ptrEq a.openDecls b.openDecls
+
+@[implemented_by ParserDeps.equivUnsafe]
+private opaque ParserDeps.equiv (a b : ParserDeps) : Bool
+
+/-- The next command, parsed in the background with the context before the elaboration of the current one. -/
+structure ParseAhead where
+  deps   : ParserDeps
+  result : Task (Syntax × Parser.ModuleParserState × MessageLog)
+
 structure State where
   commandState : Command.State
   parserState  : Parser.ModuleParserState
   cmdPos       : String.Pos
   commands     : Array Syntax := #[]
+  parseAhead?  : Option ParseAhead := none
 
 structure Context where
   inputCtx : Parser.InputContext
@@ -50,6 +84,17 @@ def setParserState (ps : Parser.ModuleParserState) : FrontendM Unit := modify fu
 def setMessages (msgs : MessageLog) : FrontendM Unit := modify fun s => { s with commandState := { s.commandState with messages := msgs } }
 def getInputContext : FrontendM Parser.InputContext := do pure (← read).inputCtx
 
+/-- Report the failures of kernel checks still running in the background, see `kernel.async`. -/
+def reportAsyncKernelChecks : FrontendM Unit := do
+  let cmdState ← getCommandState
+  let (env, log) ← cmdState.env.waitAsyncKernelChecks cmdState.scopes.head!.opts
+  setCommandState { cmdState with env, messages := cmdState.messages ++ log }
+
+/-- Report the messages of linters still running in the background, see `linter.async`. -/
+def reportAsyncLinters : FrontendM Unit := do
+  let (cmdState, log) ← (← getCommandState).waitAsyncLinters
+  setCommandState { cmdState with messages := cmdState.messages ++ log }
+
 def processCommand : FrontendM Bool := do
   updateCmdPos
   let cmdState ← getCommandState
@@ -57,16 +102,39 @@ def processCommand : FrontendM Bool := do
   let pstate ← getParserState
   let scope := cmdState.scopes.head!
   let pmctx := { env := cmdState.env, options := scope.opts, currNamespace := scope.currNamespace, openDecls := scope.openDecls }
-  match profileit "parsing" scope.opts fun _ => Parser.parseCommand ictx pmctx pstate cmdState.messages with
+  let deps := ParserDeps.ofContext pmctx
+  let parseAhead? := (← get).parseAhead?
+  let parsed := profileit "parsing" scope.opts fun _ =>
+    match parseAhead? with
+    | some pa =>
+      if pa.deps.equiv deps then
+        let (cmd, ps, messages) := pa.result.get
+        (cmd, ps, cmdState.messages ++ messages)
+      else
+        Parser.parseCommand ictx pmctx pstate cmdState.messages
+    | none => Parser.parseCommand ictx pmctx pstate cmdState.messages
+  modify fun s => { s with parseAhead? := none }
+  match parsed with
   | (cmd, ps, messages) =>
     modify fun s => { s with commands := s.commands.push cmd }
     setParserState ps
     setMessages messages
     if Parser.isEOI cmd then
+      reportAsyncLinters
+      reportAsyncKernelChecks
       pure true -- Done
     else
+      if parseAhead.get scope.opts && !Parser.isTerminalCommand cmd then
+        -- If elaborating `cmd` does not change `deps`, parsing the next command does not depend on it.
+        let result := Task.spawn fun _ => Parser.parseCommand ictx pmctx ps {}
+        modify fun s => { s with parseAhead? := some { deps, result } }
       profileitM IO.Error "elaboration" scope.opts <| elabCommandAtFrontend cmd
-      pure (Parser.isTerminalCommand cmd)
+      if Parser.isTerminalCommand cmd then
+        reportAsyncLinters
+        reportAsyncKernelChecks
+        pure true
+      else
+        pure false
 
 partial def processCommands : FrontendM Unit := do
   let done ← processCommand
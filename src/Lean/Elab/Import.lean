@@ -16,10 +16,91 @@ def headerToImports (header : Syntax) : List Import :=
     let id      := stx[2].getId
     { module := id, runtimeOnly := runtime }
 
+deriving instance BEq for Import
+
+/-- An environment imported by `lean --daemon`, kept alive for later requests with the same imports. -/
+structure ImportCacheEntry where
+  imports    : List Import
+  trustLevel : UInt32
+  /-- Modification times of the `.olean` files of all modules in `env`, used to detect rebuilt dependencies. -/
+  oleanTimes : Array (System.FilePath × IO.FS.SystemTime)
+  env        : Environment
+
+/-- Imported environments, most recently used first. It is `none` unless the cache has been enabled by `enableImportCache`. -/
+builtin_initialize importCacheRef : IO.Ref (Option (Array ImportCacheEntry)) ← IO.mkRef none
+
+/--
+Environments removed from `importCacheRef` whose compacted regions have not been freed yet. Their regions are freed by
+`freeEvictedImports` between two requests, when no other references to them exist.
+-/
+builtin_initialize evictedImportsRef : IO.Ref (List Environment) ← IO.mkRef []
+
+private def evict (entries : Array ImportCacheEntry) : IO Unit :=
+  evictedImportsRef.modify fun envs => entries.foldl (fun envs entry => entry.env :: envs) envs
+
+builtin_initialize
+  IO.registerMemoryPressureHandler do
+    -- the most recently used environment may be in use by the current request
+    let evicted ← importCacheRef.modifyGet fun
+      | some cache => (cache.extract 1 cache.size, some (cache.extract 0 1))
+      | none       => (#[], none)
+    evict evicted
+
+private unsafe def freeEnvs : List Environment → IO Unit
+  | []          => pure ()
+  | env :: envs => do env.freeRegions; freeEnvs envs
+
+/--
+Free the compacted regions of the environments evicted from the import cache. Called by `lean --daemon` after each
+request, see `Environment.freeRegions` for the conditions.
+-/
+@[export lean_free_evicted_imports]
+unsafe def freeEvictedImports : IO Unit := do
+  freeEnvs (← evictedImportsRef.modifyGet fun envs => (envs, []))
+
+/-- Maximal number of environments in `importCacheRef`. -/
+def maxImportCacheSize := 8
+
+/-- Enable reusing imported environments across `processHeader` calls. Used by `lean --daemon`. -/
+@[export lean_enable_import_cache]
+def enableImportCache : IO Unit :=
+  importCacheRef.set (some #[])
+
+private def getOLeanTimes (env : Environment) : IO (Array (System.FilePath × IO.FS.SystemTime)) :=
+  env.header.moduleNames.mapM fun mod => do
+    let fname ← findOLean mod
+    return (fname, (← fname.metadata).modified)
+
+private def isUpToDate (entry : ImportCacheEntry) : IO Bool :=
+  entry.oleanTimes.allM fun (fname, time) => do
+    try
+      return (← fname.metadata).modified == time
+    catch _ =>
+      return false
+
+/--
+Similar to `importModules`, but reuses the environment of a previous call with the same imports if the cache is enabled
+and none of the imported `.olean` files has changed since. The options must not affect the imported environment. -/
+def importModulesCached (imports : List Import) (opts : Options) (trustLevel : UInt32 := 0) : IO Environment := do
+  let some cache ← importCacheRef.get | importModules imports opts trustLevel
+  let mut cache := cache
+  if let some i := cache.findIdx? fun entry => entry.imports == imports && entry.trustLevel == trustLevel then
+    let entry := cache[i]!
+    cache := cache.eraseIdx i
+    if (← isUpToDate entry) then
+      importCacheRef.set (some (#[entry] ++ cache))
+      return entry.env
+    evict #[entry]
+  let env ← importModules imports opts trustLevel
+  let entry : ImportCacheEntry := { imports, trustLevel, oleanTimes := (← getOLeanTimes env), env }
+  evict (cache.extract (maxImportCacheSize - 1) cache.size)
+  importCacheRef.set (some (#[entry] ++ cache.extract 0 (maxImportCacheSize - 1)))
+  return env
+
 def processHeader (header : Syntax) (opts : Options) (messages : MessageLog) (inputCtx : Parser.InputContext) (trustLevel : UInt32 := 0)
     : IO (Environment × MessageLog) := do
   try
-    let env ← importModules (headerToImports header) opts trustLevel
+    let env ← importModulesCached (headerToImports header) opts trustLevel
     pure (env, messages)
   catch e =>
     let env ← mkEmptyEnvironment
@@ -63,4 +144,19 @@ def printImportsJson (fileNames : Array String) : IO Unit := do
     catch e => return { errors := #[e.toString] }
   IO.println (toJson { imports := rs : PrintImportsResult })
 
+/-- Statistics about `env` reported by `lean --stats-json`, as a compressed JSON object. -/
+@[export lean_environment_stats_json]
+def environmentStatsJson (env : Environment) : String :=
+  let numMapped := env.header.regions.filter (·.isMemoryMapped) |>.size
+  Json.compress <| Json.mkObj [
+    ("imports",         toJson env.header.imports),
+    ("modules",         toJson env.header.regions.size),
+    ("mappedModules",   toJson numMapped),
+    ("copiedModules",   toJson (env.header.regions.size - numMapped)),
+    ("consts",          toJson env.constants.size),
+    ("importedConsts",  toJson env.constants.stageSizes.1),
+    ("localConsts",     toJson env.constants.stageSizes.2),
+    ("extensions",      toJson env.extensions.size)
+  ]
+
 end Lean.Elab
@@ -307,9 +307,13 @@ structure UnfoldEqnExtState where
   map : PHashMap Name Name := {}
   deriving Inhabited
 
-/- We generate the unfold equation on demand, and do not save them on .olean files. -/
-builtin_initialize unfoldEqnExt : EnvExtension UnfoldEqnExtState ←
-  registerEnvExtension (pure {})
+/- We generate the unfold equation on demand, and save them on .olean files like the equations, see `eqnsExt`. -/
+builtin_initialize unfoldEqnExt : SimplePersistentEnvExtension (Name × Name) UnfoldEqnExtState ←
+  registerSimplePersistentEnvExtension {
+    addEntryFn    := fun s (declName, eq) => { s with map := s.map.insert declName eq }
+    addImportedFn := fun es => mkStateFromImportedEntries (fun s (declName, eq) => { s with map := s.map.insert declName eq }) {} es
+    lazyImport    := true
+  }
 
 /--
   Auxiliary method for `mkUnfoldEq`. The structure is based on `mkEqnTypes`.
@@ -379,7 +383,7 @@ def getUnfoldFor? (declName : Name) (getInfo? : Unit → Option EqnInfoCore) : M
     return some eq
   else if let some info := getInfo? () then
     let eq ← mkUnfoldEq declName info
-    modifyEnv fun env => unfoldEqnExt.modifyState env fun s => { s with map := s.map.insert declName eq }
+    modifyEnv fun env => unfoldEqnExt.addEntry env (declName, eq)
     return some eq
   else
     return none
@@ -132,6 +132,12 @@ and this is bad when rethrowing the exception at the `catch` block in these meth
 We marked these places with a `(*)` in these methods.
 -/
 
+register_builtin_option profiler.tactics : Bool := {
+  defValue := false
+  group    := "profiler"
+  descr    := "together with `profiler`, profile each tactic: the time and heartbeats of a tactic, excluding the ones of nested tactics, are reported as 'tactic <kind> of <declaration>' and accumulated per tactic kind in the cumulative profiling times"
+}
+
 /--
   Auxiliary datastructure for capturing exceptions at `evalTactic`.
 -/
@@ -152,7 +158,12 @@ partial def evalTactic (stx : Syntax) : TacticM Unit :=
         if evalFns.isEmpty && macros.isEmpty then
           throwErrorAt stx "tactic '{stx.getKind}' has not been implemented"
         let s ← Tactic.saveState
-        expandEval s macros evalFns #[]
+        let opts ← getOptions
+        if profiler.tactics.get opts then
+          profileitDeclM Exception s!"tactic {stx.getKind}" opts ((← Term.getDeclName?).getD .anonymous) do
+            expandEval s macros evalFns #[]
+        else
+          expandEval s macros evalFns #[]
     | .missing => pure ()
     | _ => throwError m!"unexpected tactic{indentD stx}"
 where
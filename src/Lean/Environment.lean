@@ -6,6 +6,7 @@ Authors: Leonardo de Moura
 import Lean.Data.HashMap
 import Lean.ImportingFlag
 import Lean.Data.SMap
+import Lean.Data.BloomFilter
 import Lean.Declaration
 import Lean.LocalContext
 import Lean.Util.Path
@@ -63,6 +64,14 @@ structure ModuleData where
   -/
   extraConstNames : Array Name
   entries         : Array (Name × Array EnvExtensionEntry)
+  /--
+  Declaration-name index: `constNames[i]` is the name of `constants[i]`. It allows `importModules` to populate the
+  constant map without touching the (memory-mapped) `ConstantInfo` objects, which are paged in by the first lookup
+  that uses them. The map itself is still built eagerly for all imported constants; inserting constants only on their
+  first lookup would need `Environment.find?` to fall back to a per-module index. The field must remain last: `.olean`
+  files written by older versions lack it, and `readModuleData` adds it when reading them.
+  -/
+  constNames      : Array Name
   deriving Inhabited
 
 /-- Environment fields that are not used often. -/
@@ -89,6 +98,11 @@ structure EnvironmentHeader where
   moduleNames  : Array Name   := #[]
   /-- Module data for all imported modules. -/
   moduleData   : Array ModuleData := #[]
+  /--
+  Filter over the names of the imported constants, i.e., the keys of `constants.map₁` once the environment is in
+  stage 2. Most names that are not imported constants are rejected by the filter without probing the map.
+  -/
+  importedConstFilter : BloomFilter := {}
   deriving Inhabited
 
 /--
@@ -152,13 +166,31 @@ def addExtraName (env : Environment) (name : Name) : Environment :=
   else
     { env with extraConstNames := env.extraConstNames.insert name }
 
+/--
+Return `false` if `n` is certainly not in `env.constants.map₁`. In stage 1, constants are still added to
+`env.constants.map₁`, and the filter of the header does not cover them.
+-/
+@[inline] private def mayBeInMap₁ (env : Environment) (n : Name) : Bool :=
+  env.constants.stage₁ || env.header.importedConstFilter.mayContain n
+
 @[export lean_environment_find]
 def find? (env : Environment) (n : Name) : Option ConstantInfo :=
-  /- It is safe to use `find'` because we never overwrite imported declarations. -/
-  env.constants.find?' n
+  /- It is safe to search `map₁` first because we never overwrite imported declarations. -/
+  if env.mayBeInMap₁ n then
+    env.constants.find?' n
+  else
+    env.constants.map₂.find? n
 
 def contains (env : Environment) (n : Name) : Bool :=
-  env.constants.contains n
+  if env.mayBeInMap₁ n then
+    env.constants.contains n
+  else
+    env.constants.map₂.contains n
+
+/-- Return `true` if `n` is an imported constant. Used by the kernel to decide which terms it may cache across declarations. -/
+@[export lean_environment_is_imported_const]
+private def isImportedConst (env : Environment) (n : Name) : Bool :=
+  env.mayBeInMap₁ n && env.constants.map₁.contains n
 
 def imports (env : Environment) : Array Import :=
   env.header.imports
@@ -213,6 +245,8 @@ inductive KernelException where
   | appTypeMismatch  (env : Environment) (lctx : LocalContext) (app : Expr) (funType : Expr) (argType : Expr)
   | invalidProj      (env : Environment) (lctx : LocalContext) (proj : Expr)
   | other            (msg : String)
+  /-- The kernel was interrupted, e.g. because the task executing it has been canceled. -/
+  | interrupted
 
 namespace Environment
 
@@ -220,6 +254,22 @@ namespace Environment
 @[extern "lean_add_decl"]
 opaque addDecl (env : Environment) (decl : @& Declaration) : Except KernelException Environment
 
+/--
+Type check the given declarations and add them to the environment in order.
+The values of theorems are checked concurrently in separate tasks; if any declaration fails to type check,
+the error for the first failing declaration is returned.
+-/
+@[extern "lean_add_decls"]
+opaque addDecls (env : Environment) (decls : @& List Declaration) : Except KernelException Environment
+
+/--
+Type check the header of the theorem `decl` and add it to the environment, while its value is checked concurrently by
+the returned task. The environment must not be trusted unless the task succeeds.
+-/
+@[extern "lean_add_theorem_async"]
+opaque addTheoremAsync (env : Environment) (decl : @& Declaration) :
+  Except KernelException (Environment × Task (Except KernelException Unit))
+
 end Environment
 
 namespace ConstantInfo
@@ -409,6 +459,8 @@ structure PersistentEnvExtension (α : Type) (β : Type) (σ : Type) where
   addEntryFn      : σ → β → σ
   exportEntriesFn : σ → Array α
   statsFn         : σ → Format
+  /-- See `PersistentEnvExtensionDescr.parallelImport`. -/
+  parallelImport  : Bool := false
 
 instance {α σ} [Inhabited σ] : Inhabited (PersistentEnvExtensionState α σ) :=
   ⟨{importedEntries := #[], state := default }⟩
@@ -456,6 +508,10 @@ structure PersistentEnvExtensionDescr (α β σ : Type) where
   addEntryFn      : σ → β → σ
   exportEntriesFn : σ → Array α
   statsFn         : σ → Format := fun _ => Format.nil
+  /--
+  Whether `addImportedFn` only depends on the imported entries of this extension, and not on the state of other
+  extensions in the environment it is given. The `addImportedFn` of such extensions are run in parallel at import. -/
+  parallelImport  : Bool := false
 
 unsafe def registerPersistentEnvExtensionUnsafe {α β σ : Type} [Inhabited σ] (descr : PersistentEnvExtensionDescr α β σ) : IO (PersistentEnvExtension α β σ) := do
   let pExts ← persistentEnvExtensionsRef.get
@@ -473,7 +529,8 @@ unsafe def registerPersistentEnvExtensionUnsafe {α β σ : Type} [Inhabited σ]
     addImportedFn   := descr.addImportedFn,
     addEntryFn      := descr.addEntryFn,
     exportEntriesFn := descr.exportEntriesFn,
-    statsFn         := descr.statsFn
+    statsFn         := descr.statsFn,
+    parallelImport  := descr.parallelImport
   }
   persistentEnvExtensionsRef.modify fun pExts => pExts.push (unsafeCast pExt)
   return pExt
@@ -481,8 +538,10 @@ unsafe def registerPersistentEnvExtensionUnsafe {α β σ : Type} [Inhabited σ]
 @[implemented_by registerPersistentEnvExtensionUnsafe]
 opaque registerPersistentEnvExtension {α β σ : Type} [Inhabited σ] (descr : PersistentEnvExtensionDescr α β σ) : IO (PersistentEnvExtension α β σ)
 
-/-- Simple `PersistentEnvExtension` that implements `exportEntriesFn` using a list of entries. -/
-def SimplePersistentEnvExtension (α σ : Type) := PersistentEnvExtension α α (List α × σ)
+/--
+Simple `PersistentEnvExtension` that implements `exportEntriesFn` using a list of entries. The state is a thunk so
+that it can be computed on first access, see `SimplePersistentEnvExtensionDescr.lazyImport`. -/
+def SimplePersistentEnvExtension (α σ : Type) := PersistentEnvExtension α α (List α × Thunk σ)
 
 @[specialize] def mkStateFromImportedEntries {α σ : Type} (addEntryFn : σ → α → σ) (initState : σ) (as : Array (Array α)) : σ :=
   as.foldl (fun r es => es.foldl (fun r e => addEntryFn r e) r) initState
@@ -492,22 +551,29 @@ structure SimplePersistentEnvExtensionDescr (α σ : Type) where
   addEntryFn    : σ → α → σ
   addImportedFn : Array (Array α) → σ
   toArrayFn     : List α → Array α := fun es => es.toArray
+  /--
+  Whether the state is only computed from the imported entries when it is first accessed, together with the entries
+  added since. Intended for extensions that most importers never query, e.g. ones only used by the language server.
+  Writing the `.olean` file of a module only needs the local entries and does not force the state. -/
+  lazyImport    : Bool := false
 
 def registerSimplePersistentEnvExtension {α σ : Type} [Inhabited σ] (descr : SimplePersistentEnvExtensionDescr α σ) : IO (SimplePersistentEnvExtension α σ) :=
   registerPersistentEnvExtension {
     name            := descr.name,
-    mkInitial       := pure ([], descr.addImportedFn #[]),
-    addImportedFn   := fun as => pure ([], descr.addImportedFn as),
+    mkInitial       := pure ([], .pure (descr.addImportedFn #[])),
+    addImportedFn   := fun as => pure ([], if descr.lazyImport then .mk fun _ => descr.addImportedFn as else .pure (descr.addImportedFn as)),
     addEntryFn      := fun s e => match s with
-      | (entries, s) => (e::entries, descr.addEntryFn s e),
+      | (entries, s) => (e::entries, if descr.lazyImport then s.map (descr.addEntryFn · e) else .pure (descr.addEntryFn s.get e)),
     exportEntriesFn := fun s => descr.toArrayFn s.1.reverse,
-    statsFn := fun s => format "number of local entries: " ++ format s.1.length
+    statsFn := fun s => format "number of local entries: " ++ format s.1.length,
+    -- `addImportedFn` is a pure function of the imported entries
+    parallelImport  := true
   }
 
 namespace SimplePersistentEnvExtension
 
 instance {α σ : Type} [Inhabited σ] : Inhabited (SimplePersistentEnvExtension α σ) :=
-  inferInstanceAs (Inhabited (PersistentEnvExtension α α (List α × σ)))
+  inferInstanceAs (Inhabited (PersistentEnvExtension α α (List α × Thunk σ)))
 
 /-- Get the list of values used to update the state of the given
 `SimplePersistentEnvExtension` in the current file. -/
@@ -516,15 +582,15 @@ def getEntries {α σ : Type} [Inhabited σ] (ext : SimplePersistentEnvExtension
 
 /-- Get the current state of the given `SimplePersistentEnvExtension`. -/
 def getState {α σ : Type} [Inhabited σ] (ext : SimplePersistentEnvExtension α σ) (env : Environment) : σ :=
-  (PersistentEnvExtension.getState ext env).2
+  (PersistentEnvExtension.getState ext env).2.get
 
 /-- Set the current state of the given `SimplePersistentEnvExtension`. This change is *not* persisted across files. -/
 def setState {α σ : Type} (ext : SimplePersistentEnvExtension α σ) (env : Environment) (s : σ) : Environment :=
-  PersistentEnvExtension.modifyState ext env (fun ⟨entries, _⟩ => (entries, s))
+  PersistentEnvExtension.modifyState ext env (fun ⟨entries, _⟩ => (entries, .pure s))
 
 /-- Modify the state of the given extension in the given environment by applying the given function. This change is *not* persisted across files. -/
 def modifyState {α σ : Type} (ext : SimplePersistentEnvExtension α σ) (env : Environment) (f : σ → σ) : Environment :=
-  PersistentEnvExtension.modifyState ext env (fun ⟨entries, s⟩ => (entries, f s))
+  PersistentEnvExtension.modifyState ext env (fun ⟨entries, s⟩ => (entries, .pure (f s.get)))
 
 end SimplePersistentEnvExtension
 
@@ -598,6 +664,36 @@ opaque saveModuleData (fname : @& System.FilePath) (mod : @& Name) (data : @& Mo
 @[extern "lean_read_module_data"]
 opaque readModuleData (fname : @& System.FilePath) : IO (ModuleData × CompactedRegion)
 
+/--
+Ask the operating system to start reading `fname` into the page cache in the background. This is only a hint, it
+does nothing on platforms without `posix_fadvise`. -/
+@[extern "lean_prefetch_olean"]
+opaque prefetchOLean (fname : @& System.FilePath) : IO Unit
+
+/--
+The number of major page faults of the process so far, i.e., page faults that required reading from disk. It is `0` on
+Windows. -/
+@[extern "lean_get_major_page_faults"]
+opaque getMajorPageFaults : BaseIO Nat
+
+/-- Start reading the given `.olean` files in parallel on the task manager. The result is in the order of `fnames`. -/
+def readModuleDataAsync (fnames : Array System.FilePath) : BaseIO (Array (Task (Except IO.Error (ModuleData × CompactedRegion)))) :=
+  fnames.mapM fun fname => IO.asTask (readModuleData fname)
+
+/--
+  Write a dictionary of the objects that occur in at least `minModules` of the given `.olean` files to `fname`.
+  Modules written while the environment variable `LEAN_OLEAN_DICT` is set to the dictionary file reference its objects
+  instead of storing copies of them, and can then only be read with the same dictionary. -/
+@[extern "lean_save_olean_dictionary"]
+opaque saveOleanDictionary (fname : @& System.FilePath) (oleans : @& Array System.FilePath) (minModules : @& Nat := 2) : IO Unit
+
+/--
+  Return a hash of the interface of the module stored in the given `.olean` file, i.e. of everything in it that can
+  affect modules importing it. It does not depend on the proofs of theorems, declaration ranges, or docstrings, so
+  modules importing it do not need to be rebuilt as long as the hash does not change. -/
+@[extern "lean_read_module_interface_hash"]
+opaque readModuleInterfaceHash (fname : @& System.FilePath) : IO UInt64
+
 /--
   Free compacted regions of imports. No live references to imported objects may exist at the time of invocation; in
   particular, `env` should be the last reference to any `Environment` derived from these imports. -/
@@ -625,11 +721,13 @@ def mkModuleData (env : Environment) : IO ModuleData := do
   let entries := pExts.map fun pExt =>
     let state := pExt.getState env
     (pExt.name, pExt.exportEntriesFn state)
+  let constants := env.constants.foldStage2 (fun cs _ c => cs.push c) #[]
   pure {
     imports         := env.header.imports
-    constants       := env.constants.foldStage2 (fun cs _ c => cs.push c) #[]
+    constants       := constants
     extraConstNames := env.extraConstNames.toArray
     entries         := entries
+    constNames      := constants.map (·.name)
   }
 
 @[export lean_write_module]
@@ -666,9 +764,22 @@ private def setImportedEntries (env : Environment) (mods : Array ModuleData) (st
 @[extern 1 "lean_get_num_attributes"] opaque getNumBuiltiAttributes : IO Nat
 
 private partial def finalizePersistentExtensions (env : Environment) (mods : Array ModuleData) (opts : Options) : IO Environment := do
-  loop 0 env
+  -- Extensions with `parallelImport` do not depend on the states computed by the extensions before them,
+  -- so they are all started right away.
+  let mut tasks := #[]
+  for extDescr in (← persistentEnvExtensionsRef.get) do
+    if extDescr.parallelImport then
+      tasks := tasks.push (some (← IO.asTask (addImported extDescr env)))
+    else
+      tasks := tasks.push none
+  loop tasks 0 env
 where
-  loop (i : Nat) (env : Environment) : IO Environment := do
+  addImported (extDescr : PersistentEnvExtension EnvExtensionEntry EnvExtensionEntry EnvExtensionState)
+      (env : Environment) : IO EnvExtensionState :=
+    profileitIO s!"import {extDescr.name}" opts do
+      extDescr.addImportedFn (extDescr.toEnvExtension.getState env).importedEntries { env := env, opts := opts }
+  loop (tasks : Array (Option (Task (Except IO.Error EnvExtensionState)))) (i : Nat) (env : Environment) :
+      IO Environment := do
     -- Recall that the size of the array stored `persistentEnvExtensionRef` may increase when we import user-defined environment extensions.
     let pExtDescrs ← persistentEnvExtensionsRef.get
     if i < pExtDescrs.size then
@@ -676,7 +787,9 @@ where
       let s := extDescr.toEnvExtension.getState env
       let prevSize := (← persistentEnvExtensionsRef.get).size
       let prevAttrSize ← getNumBuiltiAttributes
-      let newState ← extDescr.addImportedFn s.importedEntries { env := env, opts := opts }
+      let newState ← match tasks[i]? with
+        | some (some t) => IO.ofExcept t.get
+        | _             => addImported extDescr env
       let mut env := extDescr.toEnvExtension.setState env { s with state := newState }
       env ← ensureExtensionsArraySize env
       if (← persistentEnvExtensionsRef.get).size > prevSize || (← getNumBuiltiAttributes) > prevAttrSize then
@@ -686,39 +799,82 @@ where
         env ← setImportedEntries env mods prevSize
         -- See comment at `updateEnvAttributesRef`
         env ← updateEnvAttributes env
-      loop (i + 1) env
+      loop tasks (i + 1) env
     else
       return env
 
+/-- Map of the constants of the imported modules, or the name of a constant declared by two of them. -/
+private def mkImportedConstantMap (mods : Array ModuleData) (numConsts : Nat) :
+    Except Name (HashMap Name ConstantInfo) := do
+  let mut constantMap : HashMap Name ConstantInfo := mkHashMap (capacity := numConsts)
+  for mod in mods do
+    for cname in mod.constNames, cinfo in mod.constants do
+      match constantMap.insert' cname cinfo with
+      | (constantMap', replaced) =>
+        constantMap := constantMap'
+        if replaced then throw cname
+  return constantMap
+
+private def mkImportedConst2ModIdx (mods : Array ModuleData) (numConsts : Nat) : HashMap Name ModuleIdx := Id.run do
+  let mut const2ModIdx : HashMap Name ModuleIdx := mkHashMap (capacity := numConsts)
+  let mut modIdx : Nat := 0
+  for mod in mods do
+    for cname in mod.constNames do
+      const2ModIdx := const2ModIdx.insert cname modIdx
+    for cname in mod.extraConstNames do
+      const2ModIdx := const2ModIdx.insert cname modIdx
+    modIdx := modIdx + 1
+  return const2ModIdx
+
+private def mkImportedConstFilter (mods : Array ModuleData) (numConsts : Nat) : BloomFilter := Id.run do
+  let mut filter := BloomFilter.mkEmpty numConsts
+  for mod in mods do
+    for cname in mod.constNames do
+      filter := filter.insert cname
+  return filter
+
+/--
+The number of major page faults during the last `importModules`, reported by `lean --stats`. Page faults on memory-mapped
+`.olean` files can be reduced by the hints `readModuleData` gives when `LEAN_OLEAN_MADVISE=1` or `LEAN_OLEAN_MLOCK=1` is
+set. -/
+builtin_initialize importMajorPageFaultsRef : IO.Ref Nat ← IO.mkRef 0
+
 structure ImportState where
   moduleNameSet : NameSet := {}
   moduleNames   : Array Name := #[]
   moduleData    : Array ModuleData := #[]
   regions       : Array CompactedRegion := #[]
+  /-- `.olean` files that are being read in the background, see `importModules.prefetchMods`. -/
+  pending       : HashMap Name (Task (Except IO.Error (ModuleData × CompactedRegion))) := {}
+
+private unsafe def freeCompactedRegionsUnsafe (regions : Array CompactedRegion) : IO Unit :=
+  regions.forM CompactedRegion.free
+
+/-- Free compacted regions that no live object refers to anymore, e.g., after a failed import. -/
+@[implemented_by freeCompactedRegionsUnsafe]
+private opaque freeCompactedRegions (regions : Array CompactedRegion) : IO Unit
 
 @[export lean_import_modules]
-partial def importModules (imports : List Import) (opts : Options) (trustLevel : UInt32 := 0) : IO Environment := profileitIO "import" opts do
+partial def importModules (imports : List Import) (opts : Options) (trustLevel : UInt32 := 0) :
+    IO Environment := profileitIO "import" opts do
   for imp in imports do
     if imp.module matches .anonymous then
       throw <| IO.userError "import failed, trying to import module with anonymous name"
   withImporting do
-    let (_, s) ← importMods imports |>.run {}
+    let majorPageFaults ← getMajorPageFaults
+    let (_, s) ← importAll imports |>.run {}
     let mut numConsts := 0
+    let mut numExtraConsts := 0
     for mod in s.moduleData do
       numConsts := numConsts + mod.constants.size
-    let mut modIdx : Nat := 0
-    let mut const2ModIdx : HashMap Name ModuleIdx := mkHashMap (capacity := numConsts)
-    let mut constantMap : HashMap Name ConstantInfo := mkHashMap (capacity := numConsts)
-    for mod in s.moduleData do
-      for cinfo in mod.constants do
-        const2ModIdx := const2ModIdx.insert cinfo.name modIdx
-        match constantMap.insert' cinfo.name cinfo with
-        | (constantMap', replaced) =>
-          constantMap := constantMap'
-          if replaced then throw (IO.userError s!"import failed, environment already contains '{cinfo.name}'")
-      for cname in mod.extraConstNames do
-        const2ModIdx := const2ModIdx.insert cname modIdx
-      modIdx := modIdx + 1
+      numExtraConsts := numExtraConsts + mod.extraConstNames.size
+    -- The two maps are independent, so `constantMap` is built on another thread while this one builds `const2ModIdx`.
+    let constantMapTask := Task.spawn (prio := .dedicated) fun _ => mkImportedConstantMap s.moduleData numConsts
+    let constFilterTask := Task.spawn fun _ => mkImportedConstFilter s.moduleData numConsts
+    let const2ModIdx ← IO.lazyPure fun _ => mkImportedConst2ModIdx s.moduleData (numConsts + numExtraConsts)
+    let constantMap ← match constantMapTask.get with
+      | .ok constantMap => pure constantMap
+      | .error cname    => throw (IO.userError s!"import failed, environment already contains '{cname}'")
     let constants : ConstMap := SMap.fromHashMap constantMap false
     let exts ← mkInitialExtensionStates
     let env : Environment := {
@@ -733,12 +889,76 @@ partial def importModules (imports : List Import) (opts : Options) (trustLevel :
         regions      := s.regions
         moduleNames  := s.moduleNames
         moduleData   := s.moduleData
+        importedConstFilter := constFilterTask.get
       }
     }
     let env ← setImportedEntries env s.moduleData
     let env ← finalizePersistentExtensions env s.moduleData opts
+    importMajorPageFaultsRef.set ((← getMajorPageFaults) - majorPageFaults)
     pure env
 where
+  /-- Import the closure of `imports`. If this fails, the regions read so far are freed, including the pending ones. -/
+  importAll (imports : List Import) : StateRefT ImportState IO Unit := do
+    try
+      prefetchClosure imports
+      importMods imports
+    catch e =>
+      let s ← get
+      -- wait for the files still being read, nothing refers to their regions yet
+      let regions := s.pending.fold (init := s.regions) fun regions _ t =>
+        match t.get with
+        | .ok (_, region) => regions.push region
+        | .error _        => regions
+      set ({} : ImportState)
+      freeCompactedRegions regions
+      throw e
+  /--
+    Start reading the `.olean` files of the given imports in parallel. The modules are still added to the
+    import state in dependency order by `importMods`, which only waits for the corresponding tasks. -/
+  prefetchMods (imports : List Import) : StateRefT ImportState IO Unit := do
+    let s ← get
+    let mut mods  := #[]
+    let mut files := #[]
+    for i in imports do
+      unless i.runtimeOnly || s.moduleNameSet.contains i.module || s.pending.contains i.module || mods.contains i.module do
+        let mFile ← findOLean i.module
+        -- missing files are reported by `importMods`
+        if (← mFile.pathExists) then
+          mods  := mods.push i.module
+          files := files.push mFile
+    -- the kernel starts reading all files right away, the tasks only read as many of them as there are workers
+    for file in files do
+      prefetchOLean file
+    let tasks ← readModuleDataAsync files
+    modify fun s => { s with pending := mods.zip tasks |>.foldl (fun m (mod, t) => m.insert mod t) s.pending }
+  /--
+    Start reading the `.olean` files of all modules imported directly or indirectly: as soon as any file has been
+    read, the files of its imports are prefetched, without waiting for the files before it. Otherwise, the imports of a module are only discovered
+    once `importMods` reaches it, and the reads along every path of the import graph are serialized. -/
+  prefetchClosure (imports : List Import) : StateRefT ImportState IO Unit := do
+    let mut visited : NameSet := {}
+    let mut reading : List (Task (Except IO.Error (ModuleData × CompactedRegion))) := []
+    let mut next := imports
+    repeat
+      prefetchMods next
+      for i in next do
+        unless visited.contains i.module do
+          visited := visited.insert i.module
+          if let some t := (← get).pending.find? i.module then
+            reading := t :: reading
+      let t :: ts := reading | break
+      -- continue with the files that have been read first instead of waiting for them in order
+      discard <| IO.waitAny (t :: ts)
+      next := []
+      let mut rest := []
+      for task in t :: ts do
+        if (← IO.hasFinished task) then
+          -- errors are reported by `importMods`
+          if let .ok (mod, _) := task.get then
+            next := mod.imports.toList ++ next
+        else
+          rest := task :: rest
+      reading := rest
   importMods : List Import → StateRefT ImportState IO Unit
   | []    => pure ()
   | i::is => do
@@ -749,7 +969,14 @@ where
       let mFile ← findOLean i.module
       unless (← mFile.pathExists) do
         throw <| IO.userError s!"object file '{mFile}' of module {i.module} does not exist"
-      let (mod, region) ← readModuleData mFile
+      let (mod, region) ← match (← get).pending.find? i.module with
+        | some t =>
+          modify fun s => { s with pending := s.pending.erase i.module }
+          match t.get with
+          | .ok r    => pure r
+          | .error e => throw e
+        | none   => readModuleData mFile
+      prefetchMods mod.imports.toList
       importMods mod.imports.toList
       modify fun s => { s with
         moduleData  := s.moduleData.push mod
@@ -807,11 +1034,15 @@ def displayStats (env : Environment) : IO Unit := do
   let pExtDescrs ← persistentEnvExtensionsRef.get
   IO.println ("direct imports:                        " ++ toString env.header.imports);
   IO.println ("number of imported modules:            " ++ toString env.header.regions.size);
-  IO.println ("number of memory-mapped modules:       " ++ toString (env.header.regions.filter (·.isMemoryMapped) |>.size));
+  let numMapped := env.header.regions.filter (·.isMemoryMapped) |>.size
+  IO.println ("number of memory-mapped modules:       " ++ toString numMapped);
+  IO.println ("number of copied modules:              " ++ toString (env.header.regions.size - numMapped));
+  IO.println ("major page faults during import:       " ++ toString (← importMajorPageFaultsRef.get));
   IO.println ("number of consts:                      " ++ toString env.constants.size);
   IO.println ("number of imported consts:             " ++ toString env.constants.stageSizes.1);
   IO.println ("number of local consts:                " ++ toString env.constants.stageSizes.2);
   IO.println ("number of buckets for imported consts: " ++ toString env.constants.numBuckets);
+  IO.println ("size of imported const filter (bytes): " ++ toString env.header.importedConstFilter.numBytes);
   IO.println ("trust level:                           " ++ toString env.header.trustLevel);
   IO.println ("number of extensions:                  " ++ toString env.extensions.size);
   pExtDescrs.forM fun extDescr => do
@@ -821,6 +1052,33 @@ def displayStats (env : Environment) : IO Unit := do
     unless fmt.isNil do IO.println ("  " ++ toString (Format.nest 2 (extDescr.statsFn s.state)))
     IO.println ("  number of imported entries: " ++ toString (s.importedEntries.foldl (fun sum es => sum + es.size) 0))
 
+@[extern "lean_display_object_stats"]
+private opaque displayObjectStatsCore (env : @& Environment) (roots : @& Array (String × NonScalar)) : IO Unit
+
+private unsafe def displayObjectStatsUnsafe (env : Environment) : IO Unit := do
+  let mut roots : Array (String × NonScalar) := #[]
+  for mod in env.header.moduleNames, data in env.header.moduleData do
+    roots := roots.push (s!"module {mod}", unsafeCast data)
+  for extDescr in (← persistentEnvExtensionsRef.get) do
+    roots := roots.push (s!"extension {extDescr.name}", unsafeCast (extDescr.toEnvExtension.getState env))
+  roots := roots.push ("other extensions", unsafeCast env.extensions)
+  roots := roots.push ("constant map", unsafeCast env.constants)
+  roots := roots.push ("module index map", unsafeCast env.const2ModIdx)
+  roots := roots.push ("environment", unsafeCast env)
+  displayObjectStatsCore env roots
+
+@[implemented_by displayObjectStatsUnsafe]
+private opaque displayObjectStatsImp (env : Environment) : IO Unit
+
+/--
+Display the sizes of the expressions of the constants of `env`, with and without sharing of subterms, and the number
+and sizes of the objects reachable from `env`. The objects are counted for the first of the imported modules,
+persistent environment extensions, and remaining parts of `env` that reaches them. Used by `lean --object-stats`.
+-/
+@[export lean_environment_display_object_stats]
+def displayObjectStats (env : Environment) : IO Unit :=
+  displayObjectStatsImp env
+
 /--
   Evaluate the given declaration under the given environment to a value of the given type.
   This function is only safe to use if the type matches the declaration's type in the environment
@@ -874,6 +1132,16 @@ def isDefEqGuarded (env : Environment) (lctx : LocalContext) (a b : Expr) : Bool
 @[extern "lean_kernel_whnf"]
 opaque whnf (env : Environment) (lctx : LocalContext) (a : Expr) : Except KernelException Expr
 
+/--
+  Enables or disables collection of kernel type checker statistics such as cache hit rates and the
+  number of times each constant is unfolded. Only type checkers created afterwards are affected. -/
+@[extern "lean_kernel_set_stats_enabled"]
+opaque setStatsEnabled (enabled : Bool) : BaseIO Unit
+
+/-- Returns a report of the kernel type checker statistics collected so far. -/
+@[extern "lean_kernel_stats"]
+opaque getStats : BaseIO String
+
 end Kernel
 
 class MonadEnv (m : Type → Type) where
@@ -202,9 +202,27 @@ def addDecl (lctx : LocalContext) (newDecl : LocalDecl) : LocalContext :=
     let newDecl := newDecl.setIndex idx
     { fvarIdToDecl := map.insert newDecl.fvarId newDecl, decls := decls.push newDecl }
 
+/-- Number of the most recently added declarations that `find?` checks before the hash map. -/
+private def numRecentDecls := 8
+
+/-- The declaration of `fvarId`, whose name has hash `h`, among the `k` entries of `tail` before index `i`. -/
+private def findRecent? (tail : Array (Option LocalDecl)) (fvarId : FVarId) (h : UInt64) : Nat → Nat → Option LocalDecl
+  | 0,     _     => none
+  | _,     0     => none
+  | k + 1, i + 1 =>
+    match tail[i]! with
+    | some decl =>
+      if decl.fvarId.name.hash == h && decl.fvarId == fvarId then some decl else findRecent? tail fvarId h k i
+    | none => findRecent? tail fvarId h k i
+
 @[export lean_local_ctx_find]
 def find? (lctx : LocalContext) (fvarId : FVarId) : Option LocalDecl :=
-  lctx.fvarIdToDecl.find? fvarId
+  /- Most lookups are of recently added declarations, which are at the end of the tail of `decls`. Comparing the
+  cached hashes of their names is cheaper than a lookup in the hash map. -/
+  let tail := lctx.decls.tail
+  match findRecent? tail fvarId fvarId.name.hash numRecentDecls tail.size with
+  | some decl => some decl
+  | none      => lctx.fvarIdToDecl.find? fvarId
 
 def findFVar? (lctx : LocalContext) (e : Expr) : Option LocalDecl :=
   lctx.find? e.fvarId!
@@ -211,12 +211,33 @@ abbrev InferTypeCache := PersistentExprStructMap Expr
 abbrev FunInfoCache   := PersistentHashMap InfoCacheKey FunInfo
 abbrev WhnfCache      := PersistentExprStructMap Expr
 
+/--
+  A weak head normal form of a term containing free variables, together with the declarations of the
+  free variables it depends on (including the ones occurring in these declarations).
+  It may only be reused in local contexts containing the same declarations, and with the same configuration
+  options that affect the unfolding of let-variables and structure eta. -/
+structure WhnfLocalEntry where
+  result     : Expr
+  decls      : Array LocalDecl
+  zetaNonDep : Bool
+  etaStruct  : EtaStructMode
+  deriving Inhabited
+
+abbrev WhnfLocalCache := PersistentExprStructMap WhnfLocalEntry
+
 /--
   A mapping `(s, t) ↦ isDefEq s t`.
   TODO: consider more efficient representations (e.g., a proper set) and caching policies (e.g., imperfect cache).
   We should also investigate the impact on memory consumption. -/
 abbrev DefEqCache := PersistentHashMap (Expr × Expr) Bool
 
+/--
+  A mapping `(cfg, s, t) ↦ isDefEq s t` for closed terms `s` and `t`, i.e., without metavariables and free variables,
+  where `cfg` identifies the transparency and the other relevant configuration options, see
+  `Meta.isExprDefEqAuxImpl`. Unlike `DefEqCache`, it is not reset between `isDefEq` calls, as the results do not
+  depend on the state of the `MetavarContext`. -/
+abbrev ClosedDefEqCache := PersistentHashMap (UInt64 × Expr × Expr) Bool
+
 /--
   Cache datastructures for type inference, type class resolution, whnf, and definitional equality.
 -/
@@ -226,7 +247,13 @@ structure Cache where
   synthInstance  : SynthInstanceCache := {}
   whnfDefault    : WhnfCache := {} -- cache for closed terms and `TransparencyMode.default`
   whnfAll        : WhnfCache := {} -- cache for closed terms and `TransparencyMode.all`
+  whnfDefaultLocal : WhnfLocalCache := {} -- cache for terms with free variables and `TransparencyMode.default`
+  whnfAllLocal   : WhnfLocalCache := {} -- cache for terms with free variables and `TransparencyMode.all`
   defEq          : DefEqCache := {}
+  defEqClosed    : ClosedDefEqCache := {}
+  /-- Number of hits and misses of `defEqClosed`, see `trace.Meta.isDefEq.cache.stats`. -/
+  defEqClosedHits   : Nat := 0
+  defEqClosedMisses : Nat := 0
   deriving Inhabited
 
 /--
@@ -315,7 +342,11 @@ instance : MonadMCtx MetaM where
 
 instance : MonadEnv MetaM where
   getEnv      := return (← getThe Core.State).env
-  modifyEnv f := do modifyThe Core.State fun s => { s with env := f s.env, cache := {} }; modify fun s => { s with cache := {} }
+  modifyEnv f := do
+    modifyThe Core.State fun s =>
+      let env := f s.env
+      { s with env, cache := {}, resolveNameCache := s.resolveNameCache.forEnv env }
+    modify fun s => { s with cache := {} }
 
 instance : AddMessageContext MetaM where
   addMessageContext := addMessageContextFull
@@ -1618,8 +1649,33 @@ partial def processPostponed (mayPostpone : Bool := true) (exceptionOnFailure :=
   We currently try to postpone universe constraints as much as possible, even when by postponing them we
   are not sure whether `x` really succeeded or not.
 -/
-@[specialize] def checkpointDefEq (x : MetaM Bool) (mayPostpone : Bool := true) : MetaM Bool := do
+/--
+Save the state for `checkpointDefEq`. The assignment tables are not saved, instead the assignments made from now on
+are recorded in the trail of the metavariable context so that `restoreDefEqCheckpoint` can undo them. Returns the
+state, the size of the trail, and whether the trail was already in use.
+-/
+private def saveDefEqCheckpoint : MetaM (SavedState × Nat × Bool) := do
   let s ← saveState
+  let mctx := s.meta.mctx
+  let checkpoint := (mctx.trail.size, mctx.trailing)
+  let s := { s with meta.mctx := { mctx with eAssignment := {}, lAssignment := {}, trail := #[] } }
+  unless checkpoint.2 do
+    modifyMCtx fun mctx => { mctx with trailing := true, trail := #[] }
+  return (s, checkpoint)
+
+private def restoreDefEqCheckpoint (s : SavedState) (checkpoint : Nat × Bool) : MetaM Unit := do
+  let mctx ← getMCtx
+  s.restore
+  -- `mctx` is not shared anymore, so that its assignment tables are updated in place
+  let mctx := mctx.undoAssignments checkpoint.1
+  modifyMCtx fun saved => { saved with
+    eAssignment := mctx.eAssignment
+    lAssignment := mctx.lAssignment
+    trail       := if checkpoint.2 then mctx.trail else #[]
+    trailing    := checkpoint.2 }
+
+@[specialize] def checkpointDefEq (x : MetaM Bool) (mayPostpone : Bool := true) : MetaM Bool := do
+  let (s, checkpoint) ← saveDefEqCheckpoint
   /-
     It is not safe to use the `isDefEq` cache between different `isDefEq` calls.
     Reason: different configuration settings, and result depends on the state of the `MetavarContext`
@@ -1636,15 +1692,17 @@ partial def processPostponed (mayPostpone : Bool := true) (exceptionOnFailure :=
       if (← processPostponed mayPostpone) then
         let newPostponed ← getPostponed
         setPostponed (postponed ++ newPostponed)
+        unless checkpoint.2 do
+          modifyMCtx fun mctx => { mctx with trailing := false, trail := #[] }
         return true
       else
-        s.restore
+        restoreDefEqCheckpoint s checkpoint
         return false
     else
-      s.restore
+      restoreDefEqCheckpoint s checkpoint
       return false
   catch ex =>
-    s.restore
+    restoreDefEqCheckpoint s checkpoint
     throw ex
 
 /--
@@ -63,6 +63,19 @@ def Key.lt : Key → Key → Bool
   | .proj s₁ i₁,  .proj s₂ i₂  => Name.quickLt s₁ s₂ || (s₁ == s₂ && i₁ < i₂)
   | k₁,           k₂           => k₁.ctorIdx < k₂.ctorIdx
 
+/-- Three-way comparison consistent with `Key.lt`, which needs only one name comparison. -/
+def Key.cmp : Key → Key → Ordering
+  | .lit v₁,      .lit v₂      => if v₁ < v₂ then .lt else if v₂ < v₁ then .gt else .eq
+  | .fvar n₁ a₁,  .fvar n₂ a₂  => thenCmp (Name.quickCmp n₁.name n₂.name) a₁ a₂
+  | .const n₁ a₁, .const n₂ a₂ => thenCmp (Name.quickCmp n₁ n₂) a₁ a₂
+  | .proj s₁ i₁,  .proj s₂ i₂  => thenCmp (Name.quickCmp s₁ s₂) i₁ i₂
+  | k₁,           k₂           => compare k₁.ctorIdx k₂.ctorIdx
+where
+  thenCmp (o : Ordering) (a₁ a₂ : Nat) : Ordering :=
+    match o with
+    | .eq => compare a₁ a₂
+    | o   => o
+
 instance : LT Key := ⟨fun a b => Key.lt a b⟩
 instance (a b : Key) : Decidable (a < b) := inferInstanceAs (Decidable (Key.lt a b))
 
@@ -358,6 +371,35 @@ def insertCore [BEq α] (d : DiscrTree α) (keys : Array Key) (v : α) : DiscrTr
       let c := insertAux keys v 1 c
       { root := d.root.insert k c }
 
+/-- Minimal number of entries for which `insertMany` builds subtries in parallel. -/
+private def parallelInsertThreshold := 4096
+
+/--
+  Insert `entries` in order. This is equivalent to folding `insertCore` over `entries`, but with many
+  entries, the subtries of different root keys are built in parallel. It is used when importing modules. -/
+def insertMany [BEq α] (d : DiscrTree α) (entries : Array (Array Key × α)) : DiscrTree α := Id.run do
+  if entries.size < parallelInsertThreshold || entries.any (·.1.isEmpty) then
+    return entries.foldl (init := d) fun d (keys, v) => d.insertCore keys v
+  -- group the entries by root key, keeping their order within each group
+  let mut groupIdx : HashMap Key Nat := {}
+  let mut groups : Array (Key × Array (Array Key × α)) := #[]
+  for e in entries do
+    let k := e.1[0]!
+    match groupIdx.find? k with
+    | some i => groups := groups.modify i fun (k, es) => (k, es.push e)
+    | none   =>
+      groupIdx := groupIdx.insert k groups.size
+      groups := groups.push (k, #[e])
+  let tasks := groups.map fun (k, es) => Task.spawn fun _ =>
+    es.foldl (init := d.root.find? k) fun c? (keys, v) => some <| match c? with
+      | none   => createNodes keys v 1
+      | some c => insertAux keys v 1 c
+  let mut root := d.root
+  for (k, _) in groups, t in tasks do
+    if let some c := t.get then
+      root := root.insert k c
+  return { root }
+
 def insert [BEq α] (d : DiscrTree α) (e : Expr) (v : α) : MetaM (DiscrTree α) := do
   let keys ← mkPath e
   return d.insertCore keys v
@@ -447,8 +489,20 @@ private def getStarResult (d : DiscrTree α) : Array α :=
   | none                  => result
   | some (.node vs _) => result ++ vs
 
-private abbrev findKey (cs : Array (Key × Trie α)) (k : Key) : Option (Key × Trie α) :=
-  cs.binSearch (k, default) (fun a b => a.1 < b.1)
+/-- Find the child for `k` in `cs`, which is sorted by `Key.lt`. -/
+private partial def findKey (cs : Array (Key × Trie α)) (k : Key) : Option (Key × Trie α) :=
+  go 0 cs.size
+where
+  go (lo hi : Nat) : Option (Key × Trie α) :=
+    if lo < hi then
+      let m := (lo + hi) / 2
+      let c := cs[m]!
+      match c.1.cmp k with
+      | .lt => go (m + 1) hi
+      | .gt => go lo m
+      | .eq => some c
+    else
+      none
 
 private partial def getMatchLoop (todo : Array Expr) (c : Trie α) (result : Array α) : MetaM (Array α) := do
   match c with
@@ -53,9 +53,17 @@ structure EqnsExtState where
   map : PHashMap Name (Array Name) := {}
   deriving Inhabited
 
-/- We generate the equations on demand, and do not save them on .olean files. -/
-builtin_initialize eqnsExt : EnvExtension EqnsExtState ←
-  registerEnvExtension (pure {})
+/-
+We generate the equations on demand. The equations generated by a module are saved in its .olean file, so that
+modules importing it do not generate them again. Most modules never query the equations of most imported definitions,
+so the state is only computed on first access.
+-/
+builtin_initialize eqnsExt : SimplePersistentEnvExtension (Name × Array Name) EqnsExtState ←
+  registerSimplePersistentEnvExtension {
+    addEntryFn    := fun s (declName, eqs) => { s with map := s.map.insert declName eqs }
+    addImportedFn := fun es => mkStateFromImportedEntries (fun s (declName, eqs) => { s with map := s.map.insert declName eqs }) {} es
+    lazyImport    := true
+  }
 
 /--
   Simple equation theorem for nonrecursive definitions.
@@ -86,12 +94,12 @@ def getEqnsFor? (declName : Name) (nonRec := false) : MetaM (Option (Array Name)
   else if (← shouldGenerateEqnThms declName) then
     for f in (← getEqnsFnsRef.get) do
       if let some r ← f declName then
-        modifyEnv fun env => eqnsExt.modifyState env fun s => { s with map := s.map.insert declName r }
+        modifyEnv fun env => eqnsExt.addEntry env (declName, r)
         return some r
     if nonRec then
       let some eqThm ← mkSimpleEqThm declName | return none
       let r := #[eqThm]
-      modifyEnv fun env => eqnsExt.modifyState env fun s => { s with map := s.map.insert declName r }
+      modifyEnv fun env => eqnsExt.addEntry env (declName, r)
       return some r
   return none
 
@@ -1716,6 +1716,41 @@ private def getCachedResult (key : Expr × Expr) : MetaM LBool := do
 private def cacheResult (key : Expr × Expr) (result : Bool) : MetaM Unit := do
   modifyDefEqCache fun c => c.insert key result
 
+private def transparencyToUInt64 : TransparencyMode → UInt64
+  | .all       => 0
+  | .default   => 1
+  | .reducible => 2
+  | .instances => 3
+
+private def etaStructToUInt64 : EtaStructMode → UInt64
+  | .all        => 0
+  | .notClasses => 1
+  | .none       => 2
+
+/--
+The configuration and the options that the result of `isDefEq` on closed terms may depend on. The options can change
+within a declaration, e.g., with a term-level `set_option ... in`.
+-/
+private def closedDefEqKey (cfg : Config) (opts : Options) : UInt64 :=
+  transparencyToUInt64 cfg.transparency ||| (etaStructToUInt64 cfg.etaStruct <<< 2) ||| (cfg.zetaNonDep.toUInt64 <<< 4) |||
+    (cfg.unificationHints.toUInt64 <<< 5) ||| (cfg.proofIrrelevance.toUInt64 <<< 6) ||| (cfg.offsetCnstrs.toUInt64 <<< 7) |||
+    ((smartUnfolding.get opts).toUInt64 <<< 8)
+
+/-- The key of `key` in `Cache.defEqClosed` if it is a closed problem. -/
+private def getClosedCacheKey? (key : Expr × Expr) : MetaM (Option (UInt64 × Expr × Expr)) := do
+  if key.1.hasMVar || key.2.hasMVar || key.1.hasFVar || key.2.hasFVar then
+    return none
+  let ctx ← read
+  if ctx.canUnfold?.isSome then
+    return none
+  return some (closedDefEqKey ctx.config (← getOptions), key.1, key.2)
+
+/-- Report the hit rate of `Cache.defEqClosed` in the current declaration. -/
+def traceClosedDefEqCacheStats : MetaM Unit := do
+  let c := (← get).cache
+  if c.defEqClosedHits + c.defEqClosedMisses > 0 then
+    trace[Meta.isDefEq.cache.stats] "closed problems: {c.defEqClosedHits} hits, {c.defEqClosedMisses} misses, {c.defEqClosed.size} entries"
+
 @[export lean_is_expr_def_eq]
 partial def isExprDefEqAuxImpl (t : Expr) (s : Expr) : MetaM Bool := withIncRecDepth do
   withTraceNode `Meta.isDefEq (return m!"{exceptBoolEmoji ·} {t} =?= {s}") do
@@ -1740,6 +1775,12 @@ partial def isExprDefEqAuxImpl (t : Expr) (s : Expr) : MetaM Bool := withIncRecD
     let s ← instantiateMVars s
     let numPostponed ← getNumPostponed
     let k := mkCacheKey t s
+    let closedKey? ← getClosedCacheKey? k
+    if let some ck := closedKey? then
+      if let some result := (← get).cache.defEqClosed.find? ck then
+        trace[Meta.isDefEq.cache] "closed cache hit '{result}' for {t} =?= {s}"
+        modifyCache fun c => { c with defEqClosedHits := c.defEqClosedHits + 1 }
+        return result
     match (← getCachedResult k) with
     | .true  =>
       trace[Meta.isDefEq.cache] "cache hit 'true' for {t} =?= {s}"
@@ -1752,6 +1793,10 @@ partial def isExprDefEqAuxImpl (t : Expr) (s : Expr) : MetaM Bool := withIncRecD
       if numPostponed == (← getNumPostponed) then
         trace[Meta.isDefEq.cache] "cache {result} for {t} =?= {s}"
         cacheResult k result
+        if let some ck := closedKey? then
+          modifyCache fun c => { c with
+            defEqClosed       := c.defEqClosed.insert ck result
+            defEqClosedMisses := c.defEqClosedMisses + 1 }
       return result
 
 builtin_initialize
@@ -1762,5 +1807,6 @@ builtin_initialize
   registerTraceClass `Meta.isDefEq.assign
   registerTraceClass `Meta.isDefEq.assign.checkTypes (inherited := true)
   registerTraceClass `Meta.isDefEq.eta.struct
+  registerTraceClass `Meta.isDefEq.cache.stats
 
 end Lean.Meta
@@ -35,6 +35,14 @@ def addInstanceEntry (d : Instances) (e : InstanceEntry) : Instances :=
   | some n => { d with discrTree := d.discrTree.insertCore e.keys e, instanceNames := d.instanceNames.insert n }
   | none   => { d with discrTree := d.discrTree.insertCore e.keys e }
 
+/-- Equivalent to folding `addInstanceEntry` over `es`. -/
+def addInstanceEntries (d : Instances) (es : Array InstanceEntry) : Instances :=
+  let instanceNames := es.foldl (init := d.instanceNames) fun s e =>
+    match e.globalName? with
+    | some n => s.insert n
+    | none   => s
+  { d with discrTree := d.discrTree.insertMany (es.map fun e => (e.keys, e)), instanceNames }
+
 def Instances.eraseCore (d : Instances) (declName : Name) : Instances :=
   { d with erased := d.erased.insert declName, instanceNames := d.instanceNames.erase declName }
 
@@ -47,6 +55,7 @@ builtin_initialize instanceExtension : SimpleScopedEnvExtension InstanceEntry In
   registerSimpleScopedEnvExtension {
     initial  := {}
     addEntry := addInstanceEntry
+    addImportedEntries? := some addInstanceEntries
   }
 
 private def mkInstanceKey (e : Expr) : MetaM (Array DiscrTree.Key) := do
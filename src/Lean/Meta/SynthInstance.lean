@@ -24,6 +24,11 @@ register_builtin_option synthInstance.maxSize : Nat := {
   descr := "maximum number of instances used to construct a solution in the type class instance synthesis procedure"
 }
 
+register_builtin_option synthInstance.globalCache : Bool := {
+  defValue := false
+  descr := "reuse the results of type class problems without local instances in later commands, as long as no scoped environment extension (such as the set of instances) and no reducibility annotation of the current module changes"
+}
+
 namespace SynthInstance
 
 def getMaxHeartbeats (opts : Options) : Nat :=
@@ -154,8 +159,10 @@ structure Answer where
   deriving Inhabited
 
 structure TableEntry where
-  waiters : Array Waiter
-  answers : Array Answer := #[]
+  waiters     : Array Waiter
+  answers     : Array Answer := #[]
+  /-- The `resultType`s of `answers`, used to detect duplicate answers without scanning `answers`. -/
+  answerTypes : HashSet Expr := {}
 
 structure Context where
   maxResultSize : Nat
@@ -382,11 +389,10 @@ def wakeUp (answer : Answer) : Waiter → SynthM Unit
   | Waiter.consumerNode cNode =>
     modify fun s => { s with resumeStack := s.resumeStack.push (cNode, answer) }
 
-def isNewAnswer (oldAnswers : Array Answer) (answer : Answer) : Bool :=
-  oldAnswers.all fun oldAnswer =>
-    -- Remark: isDefEq here is too expensive. TODO: if `==` is too imprecise, add some light normalization to `resultType` at `addAnswer`
-    -- iseq ← isDefEq oldAnswer.resultType answer.resultType; pure (!iseq)
-    oldAnswer.resultType != answer.resultType
+def isNewAnswer (entry : TableEntry) (answer : Answer) : Bool :=
+  -- Remark: isDefEq here is too expensive. TODO: if `==` is too imprecise, add some light normalization to `resultType` at `addAnswer`
+  -- iseq ← isDefEq oldAnswer.resultType answer.resultType; pure (!iseq)
+  !entry.answerTypes.contains answer.resultType
 
 private def mkAnswer (cNode : ConsumerNode) : MetaM Answer :=
   withMCtx cNode.mctx do
@@ -411,8 +417,8 @@ def addAnswer (cNode : ConsumerNode) : SynthM Unit := do
     -- Remark: `answer` does not contain assignable or assigned metavariables.
     let key := cNode.key
     let entry ← getEntry key
-    if isNewAnswer entry.answers answer then
-      let newEntry := { entry with answers := entry.answers.push answer }
+    if isNewAnswer entry answer then
+      let newEntry := { entry with answers := entry.answers.push answer, answerTypes := entry.answerTypes.insert answer.resultType }
       modify fun s => { s with tableEntries := s.tableEntries.insert key newEntry }
       entry.waiters.forM (wakeUp answer)
 
@@ -592,6 +598,55 @@ def main (type : Expr) (maxResultSize : Nat) : MetaM (Option AbstractMVarsResult
        else
          throw ex
 
+/-- Parts of the environment that results of type class resolution depend on, compared by pointer equality. -/
+structure GlobalCacheDeps where
+  scopedStates : Array (ScopedEnvExtension.StateStack EnvExtensionEntry EnvExtensionEntry EnvExtensionState) := #[]
+  reducibility : NameMap ReducibilityStatus := {}
+  deriving Inhabited
+
+/-- Results of type class problems without local instances, shared by all commands of a module. -/
+structure GlobalCache where
+  deps    : GlobalCacheDeps := {}
+  /-- Keys are preprocessed types without metavariables and free variables, and the maximum result size used. -/
+  entries : PHashMap (Expr × Nat) (Option Expr) := {}
+  deriving Inhabited
+
+builtin_initialize globalCacheExt : EnvExtension GlobalCache ← registerEnvExtension (pure {})
+
+private def getGlobalCacheDeps : MetaM GlobalCacheDeps := do
+  let env ← getEnv
+  return {
+    scopedStates := (← scopedEnvExtensionsRef.get).map (·.ext.getState env)
+    reducibility := reducibilityAttrs.ext.getState env
+  }
+
+private unsafe def GlobalCacheDeps.equivUnsafe (a b : GlobalCacheDeps) : Bool :=
+  ptrEq a.reducibility b.reducibility && a.scopedStates.size == b.scopedStates.size &&
+    (a.scopedStates.zipWith b.scopedStates ptrEq).all id
+
+@[implemented_by GlobalCacheDeps.equivUnsafe]
+private opaque GlobalCacheDeps.equiv (a b : GlobalCacheDeps) : Bool
+
+/-- Return `true` if the result of `synthInstance? type` may be stored in the global cache. -/
+def useGlobalCache (type : Expr) : MetaM Bool := do
+  return synthInstance.globalCache.get (← getOptions) && !type.hasFVar && !type.hasMVar && (← getLocalInstances).isEmpty
+
+def findGlobalCache? (type : Expr) (maxResultSize : Nat) : MetaM (Option (Option Expr)) := do
+  let cache := globalCacheExt.getState (← getEnv)
+  if cache.entries.isEmpty then
+    return none
+  let some result := cache.entries.find? (type, maxResultSize) | return none
+  if GlobalCacheDeps.equiv cache.deps (← getGlobalCacheDeps) then
+    return some result
+  else
+    return none
+
+def insertGlobalCache (type : Expr) (maxResultSize : Nat) (result? : Option Expr) : MetaM Unit := do
+  let deps ← getGlobalCacheDeps
+  modifyEnv fun env => globalCacheExt.modifyState env fun cache =>
+    let cache := if GlobalCacheDeps.equiv cache.deps deps then cache else { deps }
+    { cache with entries := cache.entries.insert (type, maxResultSize) result? }
+
 end SynthInstance
 
 /-!
@@ -676,6 +731,11 @@ def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (
     match s.cache.synthInstance.find? type with
     | some result => pure result
     | none        =>
+      let useGlobalCache ← SynthInstance.useGlobalCache type
+      if useGlobalCache then
+        if let some result? ← SynthInstance.findGlobalCache? type maxResultSize then
+          modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert type result? }
+          return result?
       withTraceNode `Meta.synthInstance
         (return m!"{exceptOptionEmoji ·} {← instantiateMVars type}") do
       let result? ← withNewMCtxDepth do
@@ -727,6 +787,8 @@ def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (
         pure result?
       else do
         modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert type result? }
+        if useGlobalCache then
+          SynthInstance.insertGlobalCache type maxResultSize result?
         pure result?
 
 /--
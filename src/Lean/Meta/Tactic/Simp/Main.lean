@@ -243,6 +243,17 @@ where
     else
       e
 
+/--
+  Return the result for `e` stored by a previous invocation. The persistent cache is only used by invocations with
+  the same local context, see `PersistentCacheDeps`. -/
+def findPersistent? (e : Expr) : SimpM (Option Result) := do
+  let some entry := (← get).persistent.find? e | return none
+  if entry.result.dischargeDepth > (← readThe Simp.Context).dischargeDepth then
+    return none
+  entry.usedTheorems.forM recordSimpTheorem
+  modify fun s => { s with cache := s.cache.insert e entry.result }
+  return some entry.result
+
 partial def simp (e : Expr) : M Result := withIncRecDepth do
   checkMaxHeartbeats "simp"
   let cfg ← getConfig
@@ -256,6 +267,8 @@ partial def simp (e : Expr) : M Result := withIncRecDepth do
       -/
       if result.dischargeDepth ≤ (← readThe Simp.Context).dischargeDepth then
         return result
+    if let some result ← findPersistent? e then
+      return result
   simpLoop { expr := e }
 
 where
@@ -690,11 +703,78 @@ where
       modify fun s => { s with cache := s.cache.insert e { r with dischargeDepth } }
     return r
 
-def main (e : Expr) (ctx : Context) (usedSimps : UsedSimps := {}) (methods : Methods := {}) : MetaM (Result × UsedSimps) := do
+register_builtin_option simp.persistentCache : Bool := {
+  defValue := false
+  descr := "reuse the results of previous `simp` invocations with the same simp set, configuration and default discharger, for subterms without metavariables whose free variables are unchanged"
+}
+
+/--
+  The inputs of a `simp` invocation that its results depend on. The discharger is not part of it: the persistent
+  cache is only used with the default discharger, whose results depend on the hypotheses of the local context and on
+  the local instances. -/
+structure PersistentCacheDeps where
+  simpTheorems   : SimpTheoremsArray
+  congrTheorems  : SimpCongrTheorems
+  config         : Config
+  lctx           : LocalContext
+  localInstances : LocalInstances
+
+private def sameLocalDecls (lctx₁ lctx₂ : LocalContext) : Bool :=
+  let ds₁ := lctx₁.decls.toArray.filterMap id
+  let ds₂ := lctx₂.decls.toArray.filterMap id
+  ds₁.size == ds₂.size && (ds₁.zipWith ds₂ fun d₁ d₂ =>
+    d₁.fvarId == d₂.fvarId && d₁.type == d₂.type && d₁.value? == d₂.value?).all id
+
+private unsafe def PersistentCacheDeps.equivUnsafe (a b : PersistentCacheDeps) : Bool :=
+  a.simpTheorems.size == b.simpTheorems.size && (a.simpTheorems.zipWith b.simpTheorems ptrEq).all id &&
+    ptrEq a.congrTheorems b.congrTheorems && a.config == b.config && a.localInstances == b.localInstances &&
+    (ptrEq a.lctx b.lctx || sameLocalDecls a.lctx b.lctx)
+
+@[implemented_by PersistentCacheDeps.equivUnsafe]
+private opaque PersistentCacheDeps.equiv (a b : PersistentCacheDeps) : Bool
+
+/--
+  Caches of the simp sets used most recently in the current file, most recent first.
+  `simp [h]` creates a new simp set at each invocation, so only invocations that share their simp set
+  object, e.g. `simp` and `simp at h` with the default set, share a cache. -/
+builtin_initialize persistentCacheExt : EnvExtension (List (PersistentCacheDeps × PersistentCache)) ←
+  registerEnvExtension (pure [])
+
+/-- Maximal number of simp sets in `persistentCacheExt`. -/
+def maxPersistentCaches : Nat := 4
+
+/-- Maximal number of results in each cache of `persistentCacheExt`. -/
+def maxPersistentCacheSize : Nat := 8192
+
+private def getPersistentCache (deps : PersistentCacheDeps) : CoreM PersistentCache := do
+  match (persistentCacheExt.getState (← getEnv)).find? (·.1.equiv deps) with
+  | some (_, cache) => return cache
+  | none            => return {}
+
+/-- Store the results of `s.cache` that contain no metavariables for later invocations with `deps`. -/
+private def savePersistentCache (deps : PersistentCacheDeps) (s : State) : MetaM Unit := do
+  let usedTheorems := s.usedTheorems.toArray.map (·.1)
+  let cache := s.cache.fold (init := s.persistent) fun cache e r =>
+    if cache.size ≥ maxPersistentCacheSize || e.hasMVar || r.expr.hasMVar || r.proof?.any (·.hasMVar) ||
+        cache.contains e then
+      cache
+    else
+      cache.insert e { result := r, usedTheorems }
+  modifyEnv fun env => persistentCacheExt.modifyState env fun caches =>
+    (deps, cache) :: (caches.filter (!·.1.equiv deps) |>.take (maxPersistentCaches - 1))
+
+def main (e : Expr) (ctx : Context) (usedSimps : UsedSimps := {}) (methods : Methods := {}) (persistent := false) : MetaM (Result × UsedSimps) := do
+  let deps : PersistentCacheDeps := {
+    simpTheorems := ctx.simpTheorems, congrTheorems := ctx.congrTheorems, config := ctx.config
+    lctx := (← getLCtx), localInstances := (← getLocalInstances) }
+  let persistent := persistent && ctx.config.memoize && simp.persistentCache.get (← getOptions)
   let ctx := { ctx with config := (← ctx.config.updateArith) }
   withConfig (fun c => { c with etaStruct := ctx.config.etaStruct }) <| withReducible do
     try
-      let (r, s) ← simp e methods ctx |>.run { usedTheorems := usedSimps }
+      let cache ← if persistent then getPersistentCache deps else pure {}
+      let (r, s) ← simp e methods ctx |>.run { usedTheorems := usedSimps, persistent := cache }
+      if persistent then
+        savePersistentCache deps s
       pure (r, s.usedTheorems)
     catch ex =>
       if ex.isMaxHeartbeat then throwNestedTacticEx `simp ex else throw ex
@@ -815,7 +895,7 @@ open Simp (UsedSimps)
 def simp (e : Expr) (ctx : Simp.Context) (discharge? : Option Simp.Discharge := none)
     (usedSimps : UsedSimps := {}) : MetaM (Simp.Result × UsedSimps) := do profileitM Exception "simp" (← getOptions) do
   match discharge? with
-  | none   => Simp.main e ctx usedSimps (methods := Simp.DefaultMethods.methods)
+  | none   => Simp.main e ctx usedSimps (methods := Simp.DefaultMethods.methods) (persistent := true)
   | some d => Simp.main e ctx usedSimps (methods := { pre := (Simp.preDefault · d), post := (Simp.postDefault · d), discharge? := d })
 
 def dsimp (e : Expr) (ctx : Simp.Context)
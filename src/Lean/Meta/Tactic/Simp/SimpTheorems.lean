@@ -356,15 +356,30 @@ def mkSimpAttr (attrName : Name) (attrDescr : String) (ext : SimpExtension)
       modifyEnv fun env => ext.modifyState env fun _ => s
   }
 
+def addSimpEntry (d : SimpTheorems) : SimpEntry → SimpTheorems
+  | SimpEntry.thm e => addSimpTheoremEntry d e
+  | SimpEntry.toUnfold n => d.addDeclToUnfoldCore n
+  | SimpEntry.toUnfoldThms n thms => d.registerDeclToUnfoldThms n thms
+
+/-- Equivalent to folding `addSimpEntry` over `es`. -/
+def addSimpEntries (d : SimpTheorems) (es : Array SimpEntry) : SimpTheorems := Id.run do
+  let mut d := d
+  let mut pre := #[]
+  let mut post := #[]
+  for e in es do
+    match e with
+    | SimpEntry.thm e =>
+      if e.post then post := post.push (e.keys, e) else pre := pre.push (e.keys, e)
+      d := { d with lemmaNames := d.lemmaNames.insert e.origin }
+    | e => d := addSimpEntry d e
+  return { d with pre := d.pre.insertMany pre, post := d.post.insertMany post }
+
 def mkSimpExt (name : Name := by exact decl_name%) : IO SimpExtension :=
   registerSimpleScopedEnvExtension {
     name     := name
     initial  := {}
-    addEntry := fun d e =>
-      match e with
-      | SimpEntry.thm e => addSimpTheoremEntry d e
-      | SimpEntry.toUnfold n => d.addDeclToUnfoldCore n
-      | SimpEntry.toUnfoldThms n thms => d.registerDeclToUnfoldThms n thms
+    addEntry := addSimpEntry
+    addImportedEntries? := some addSimpEntries
   }
 
 abbrev SimpExtensionMap := HashMap Name SimpExtension
@@ -37,11 +37,22 @@ def Context.mkDefault : MetaM Context :=
 
 abbrev UsedSimps := HashMap Origin Nat
 
+/-- A result reused across `simp` invocations, see `simp.persistentCache`. -/
+structure PersistentCacheEntry where
+  result       : Result
+  /-- Theorems used by the invocation that produced the entry, a superset of the ones used for it. -/
+  usedTheorems : Array Origin
+  deriving Inhabited
+
+abbrev PersistentCache := PHashMap Expr PersistentCacheEntry
+
 structure State where
   cache        : Cache := {}
   congrCache   : CongrCache := {}
   usedTheorems : UsedSimps := {}
   numSteps     : Nat := 0
+  /-- Results of previous invocations with the same simp set and configuration. -/
+  persistent   : PersistentCache := {}
 
 abbrev SimpM := ReaderT Context $ StateRefT State MetaM
 
@@ -94,11 +105,12 @@ def getSimpCongrTheorems : M SimpCongrTheorems :=
 
 @[inline] def withSimpTheorems (s : SimpTheoremsArray) (x : M α) : M α := do
   let cacheSaved := (← get).cache
-  modify fun s => { s with cache := {} }
+  let persistentSaved := (← get).persistent
+  modify fun s => { s with cache := {}, persistent := {} }
   try
     withTheReader Context (fun ctx => { ctx with simpTheorems := s }) x
   finally
-    modify fun s => { s with cache := cacheSaved }
+    modify fun s => { s with cache := cacheSaved, persistent := persistentSaved }
 
 def recordSimpTheorem (thmId : Origin) : SimpM Unit :=
   modify fun s => if s.usedTheorems.contains thmId then s else
@@ -9,6 +9,7 @@ import Lean.Meta.GetConst
 import Lean.Meta.FunInfo
 import Lean.Meta.Match.MatcherInfo
 import Lean.Meta.Match.MatchPatternAttr
+import Lean.Util.CollectFVars
 
 namespace Lean.Meta
 
@@ -807,9 +808,12 @@ def reduceNat? (e : Expr) : MetaM (Option Expr) :=
 
 
 @[inline] private def useWHNFCache (e : Expr) : MetaM Bool := do
-  -- We cache only closed terms without expr metavars.
+  -- We cache only terms without expr metavars.
   -- Potential refinement: cache if `e` is not stuck at a metavariable
-  if e.hasFVar || e.hasExprMVar || (← read).canUnfold?.isSome then
+  if e.hasExprMVar || (← read).canUnfold?.isSome then
+    return false
+  -- Reusing the result for a term with free variables would not record the let-variables it unfolds.
+  else if e.hasFVar && (← getConfig).trackZeta then
     return false
   else
     match (← getConfig).transparency with
@@ -817,21 +821,71 @@ def reduceNat? (e : Expr) : MetaM (Option Expr) :=
     | TransparencyMode.all     => return true
     | _                        => return false
 
+private def sameLocalDecl : LocalDecl → LocalDecl → Bool
+  | .cdecl (type := t₁) .., .cdecl (type := t₂) .. => t₁ == t₂
+  | .ldecl (type := t₁) (value := v₁) (nonDep := n₁) .., .ldecl (type := t₂) (value := v₂) (nonDep := n₂) .. =>
+    t₁ == t₂ && v₁ == v₂ && n₁ == n₂
+  | _, _ => false
+
+/--
+  Return the declarations of the free variables occurring in `e`, and transitively in their types and values,
+  or `none` if one of them contains metavariables. -/
+private partial def getWhnfLocalDecls? (e : Expr) : MetaM (Option (Array LocalDecl)) :=
+  return go (← getLCtx) (collectFVars {} e) 0 #[]
+where
+  go (lctx : LocalContext) (s : CollectFVars.State) (i : Nat) (decls : Array LocalDecl) : Option (Array LocalDecl) :=
+    if h : i < s.fvarIds.size then
+      match lctx.find? s.fvarIds[i] with
+      | none      => none
+      | some decl =>
+        if decl.hasExprMVar then
+          none
+        else
+          let s := collectFVars s decl.type
+          let s := match decl.value? with
+            | some v => collectFVars s v
+            | none   => s
+          go lctx s (i + 1) (decls.push decl)
+    else
+      some decls
+
+private def findLocal? (cache : WhnfLocalCache) (e : Expr) : MetaM (Option Expr) := do
+  let some entry := cache.find? e | return none
+  let cfg ← getConfig
+  unless entry.zetaNonDep == cfg.zetaNonDep && entry.etaStruct == cfg.etaStruct do
+    return none
+  let lctx ← getLCtx
+  if entry.decls.all fun decl => (lctx.find? decl.fvarId).any (sameLocalDecl decl) then
+    return some entry.result
+  else
+    return none
+
 @[inline] private def cached? (useCache : Bool) (e : Expr) : MetaM (Option Expr) := do
   if useCache then
-    match (← getConfig).transparency with
-    | TransparencyMode.default => return (← get).cache.whnfDefault.find? e
-    | TransparencyMode.all     => return (← get).cache.whnfAll.find? e
-    | _                        => unreachable!
+    match (← getConfig).transparency, e.hasFVar with
+    | TransparencyMode.default, false => return (← get).cache.whnfDefault.find? e
+    | TransparencyMode.all,     false => return (← get).cache.whnfAll.find? e
+    | TransparencyMode.default, true  => findLocal? (← get).cache.whnfDefaultLocal e
+    | TransparencyMode.all,     true  => findLocal? (← get).cache.whnfAllLocal e
+    | _,                        _     => unreachable!
   else
     return none
 
 private def cache (useCache : Bool) (e r : Expr) : MetaM Expr := do
   if useCache then
-    match (← getConfig).transparency with
-    | TransparencyMode.default => modify fun s => { s with cache.whnfDefault := s.cache.whnfDefault.insert e r }
-    | TransparencyMode.all     => modify fun s => { s with cache.whnfAll     := s.cache.whnfAll.insert e r }
-    | _                        => unreachable!
+    if e.hasFVar then
+      if let some decls ← getWhnfLocalDecls? e then
+        let cfg ← getConfig
+        let entry := { result := r, decls, zetaNonDep := cfg.zetaNonDep, etaStruct := cfg.etaStruct }
+        match cfg.transparency with
+        | TransparencyMode.default => modify fun s => { s with cache.whnfDefaultLocal := s.cache.whnfDefaultLocal.insert e entry }
+        | TransparencyMode.all     => modify fun s => { s with cache.whnfAllLocal     := s.cache.whnfAllLocal.insert e entry }
+        | _                        => unreachable!
+    else
+      match (← getConfig).transparency with
+      | TransparencyMode.default => modify fun s => { s with cache.whnfDefault := s.cache.whnfDefault.insert e r }
+      | TransparencyMode.all     => modify fun s => { s with cache.whnfAll     := s.cache.whnfAll.insert e r }
+      | _                        => unreachable!
   return r
 
 @[export lean_whnf]
@@ -301,6 +301,12 @@ structure DelayedMetavarAssignment where
   fvars         : Array Expr
   mvarIdPending : MVarId
 
+/-- An assignment recorded in `MetavarContext.trail`, together with the previous value of the metavariable. -/
+inductive AssignmentTrailEntry where
+  | expr  (mvarId : MVarId) (prev? : Option Expr)
+  | level (mvarId : LMVarId) (prev? : Option Level)
+  deriving Inhabited
+
 /-- The metavariable context is a set of metavariable declarations and their assignments.
 
 For more information on specifics see the comment in the file that `MetavarContext` is defined in.
@@ -322,6 +328,11 @@ structure MetavarContext where
   /-- Assignment table for delayed abstraction metavariables.
   For more information about delayed abstraction, see the docstring for `DelayedMetavarAssignment`. -/
   dAssignment    : PersistentHashMap MVarId DelayedMetavarAssignment := {}
+  /-- Undo log of the assignments made while `trailing` is set. `checkpointDefEq` undoes them instead of restoring
+  the assignment tables it started with, so that it does not keep a reference to the tables and assignments can
+  update them in place instead of copying their paths. -/
+  trail          : Array AssignmentTrailEntry := #[]
+  trailing       : Bool := false
 
 /-- A monad with a stateful metavariable context, defining `getMCtx` and `modifyMCtx`. -/
 class MonadMCtx (m : Type → Type) where
@@ -449,6 +460,35 @@ def hasAssignableMVar [Monad m] [MonadMCtx m] : Expr → m Bool
   | .proj _ _ e      => pure e.hasMVar <&&> hasAssignableMVar e
   | .mvar mvarId     => mvarId.isAssignable
 
+/-- Add `mvarId := val` to the assignment, recording it in the trail if `m.trailing` is set. -/
+@[inline] def MetavarContext.assignExpr (m : MetavarContext) (mvarId : MVarId) (val : Expr) : MetavarContext :=
+  if m.trailing then
+    let prev? := m.eAssignment.find? mvarId
+    { m with eAssignment := m.eAssignment.insert mvarId val, trail := m.trail.push (.expr mvarId prev?) }
+  else
+    { m with eAssignment := m.eAssignment.insert mvarId val }
+
+/-- Add `mvarId := val` to the universe assignment, recording it in the trail if `m.trailing` is set. -/
+@[inline] def MetavarContext.assignLevel (m : MetavarContext) (mvarId : LMVarId) (val : Level) : MetavarContext :=
+  if m.trailing then
+    let prev? := m.lAssignment.find? mvarId
+    { m with lAssignment := m.lAssignment.insert mvarId val, trail := m.trail.push (.level mvarId prev?) }
+  else
+    { m with lAssignment := m.lAssignment.insert mvarId val }
+
+/-- Undo the assignments of the trail after its first `size` entries, and remove them from the trail. -/
+def MetavarContext.undoAssignments (m : MetavarContext) (size : Nat) : MetavarContext := Id.run do
+  let mut m := m
+  while m.trail.size > size do
+    let entry := m.trail.back
+    m := { m with trail := m.trail.pop }
+    match entry with
+    | .expr mvarId (some val)  => m := { m with eAssignment := m.eAssignment.insert mvarId val }
+    | .expr mvarId none        => m := { m with eAssignment := m.eAssignment.erase mvarId }
+    | .level mvarId (some val) => m := { m with lAssignment := m.lAssignment.insert mvarId val }
+    | .level mvarId none       => m := { m with lAssignment := m.lAssignment.erase mvarId }
+  return m
+
 /--
   Add `mvarId := u` to the universe metavariable assignment.
   This method does not check whether `mvarId` is already assigned, nor it checks whether
@@ -456,7 +496,7 @@ def hasAssignableMVar [Monad m] [MonadMCtx m] : Expr → m Bool
   This is a low-level API, and it is safer to use `isLevelDefEq (mkLevelMVar mvarId) u`.
 -/
 def assignLevelMVar [MonadMCtx m] (mvarId : LMVarId) (val : Level) : m Unit :=
-  modifyMCtx fun m => { m with lAssignment := m.lAssignment.insert mvarId val }
+  modifyMCtx (·.assignLevel mvarId val)
 
 /--
 Add `mvarId := x` to the metavariable assignment.
@@ -465,7 +505,7 @@ a cycle is being introduced, or whether the expression has the right type.
 This is a low-level API, and it is safer to use `isDefEq (mkMVar mvarId) x`.
 -/
 def _root_.Lean.MVarId.assign [MonadMCtx m] (mvarId : MVarId) (val : Expr) : m Unit :=
-  modifyMCtx fun m => { m with eAssignment := m.eAssignment.insert mvarId val }
+  modifyMCtx (·.assignExpr mvarId val)
 
 @[deprecated MVarId.assign]
 def assignExprMVar [MonadMCtx m] (mvarId : MVarId) (val : Expr) : m Unit :=
@@ -583,10 +623,35 @@ instance : MonadMCtx (StateRefT MetavarContext (ST ω)) where
   getMCtx    := get
   modifyMCtx := modify
 
+/-! Accessors used by the native implementation of `instantiateMVars` in `src/kernel/instantiate_mvars.cpp`. -/
+
+@[export lean_get_mvar_assignment]
+def getExprMVarAssignmentExp (m : @& MetavarContext) (mvarId : @& MVarId) : Option Expr :=
+  m.eAssignment.find? mvarId
+
+@[export lean_get_delayed_mvar_assignment]
+def getDelayedMVarAssignmentExp (m : @& MetavarContext) (mvarId : @& MVarId) : Option DelayedMetavarAssignment :=
+  m.dAssignment.find? mvarId
+
+@[export lean_assign_mvar]
+def assignExprMVarExp (m : MetavarContext) (mvarId : MVarId) (val : Expr) : MetavarContext :=
+  m.assignExpr mvarId val
+
+@[export lean_instantiate_level_mvars]
+def instantiateLevelMVarsExp (m : MetavarContext) (l : Level) : MetavarContext × Level :=
+  let (l, m) := runST fun _ => (instantiateLevelMVars l : StateRefT MetavarContext (ST _) Level) |>.run m
+  (m, l)
+
+/--
+Native implementation of `instantiateExprMVars`. It avoids the overhead of the monad stack and of the
+`ExprStructEq` cache, and only caches shared subterms. -/
+@[extern "lean_instantiate_expr_mvars"]
+opaque instantiateExprMVarsImp (mctx : MetavarContext) (e : Expr) : MetavarContext × Expr :=
+  (mctx, e)
+
 def instantiateMVarsCore (mctx : MetavarContext) (e : Expr) : Expr × MetavarContext :=
-  let instantiate {ω} (e : Expr) : (MonadCacheT ExprStructEq Expr <| StateRefT MetavarContext (ST ω)) Expr :=
-    instantiateExprMVars e
-  runST fun _ => instantiate e |>.run |>.run mctx
+  let (mctx, r) := instantiateExprMVarsImp mctx e
+  (r, mctx)
 
 def instantiateMVars [Monad m] [MonadMCtx m] (e : Expr) : m Expr := do
   if !e.hasMVar then
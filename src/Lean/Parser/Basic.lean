@@ -84,18 +84,6 @@ def minPrec  : Nat := eval_prec min
 
 abbrev Token := String
 
-structure TokenCacheEntry where
-  startPos : String.Pos := 0
-  stopPos  : String.Pos := 0
-  token    : Syntax := Syntax.missing
-
-structure ParserCache where
-  tokenCache : TokenCacheEntry
-
-def initCacheForInput (input : String) : ParserCache := {
-  tokenCache := { startPos := input.endPos + ' ' /- make sure it is not a valid position -/}
-}
-
 abbrev TokenTable := Trie Token
 
 abbrev SyntaxNodeKindSet := PersistentHashMap SyntaxNodeKind Unit
@@ -158,6 +146,43 @@ def merge (e₁ e₂ : Error) : Error :=
 
 end Error
 
+structure TokenCacheEntry where
+  startPos : String.Pos := 0
+  stopPos  : String.Pos := 0
+  token    : Syntax := Syntax.missing
+
+/--
+  Part of the parser context and state a category parser depends on, together with the category and the
+  start position. The remaining context fields only change in `withResetCacheFn` regions. -/
+structure ParserCacheKey where
+  catName            : Name
+  pos                : String.Pos
+  prec               : Nat
+  lhsPrec            : Nat
+  quotDepth          : Nat
+  suppressInsideQuot : Bool
+  savedPos?          : Option String.Pos
+  forbiddenTk?       : Option Token
+  deriving BEq, Hashable
+
+/-- Outcome of running a category parser: the single syntax tree it pushed, and the resulting state. -/
+structure ParserCacheEntry where
+  stx      : Syntax
+  lhsPrec  : Nat
+  newPos   : String.Pos
+  errorMsg : Option Error
+
+structure ParserCache where
+  tokenCache  : TokenCacheEntry
+  /-- Memoized results of the category parsers in `cachedCategories`, see `withCacheFn`. -/
+  parserCache : HashMap ParserCacheKey ParserCacheEntry := {}
+  hits        : Nat := 0
+  misses      : Nat := 0
+
+def initCacheForInput (input : String) : ParserCache := {
+  tokenCache := { startPos := input.endPos + ' ' /- make sure it is not a valid position -/}
+}
+
 structure ParserState where
   stxStack : Array Syntax := #[]
   /--
@@ -1074,11 +1099,11 @@ private def tokenFnAux : ParserFn := fun c s =>
 private def updateCache (startPos : String.Pos) (s : ParserState) : ParserState :=
   -- do not cache token parsing errors, which are rare and usually fatal and thus not worth an extra field in `TokenCache`
   match s with
-  | ⟨stack, lhsPrec, pos, _,     none⟩ =>
-    if stack.size == 0 then s
+  | ⟨stack, lhsPrec, pos, cache, none⟩ =>
+    if stack.size == 0 then ⟨stack, lhsPrec, pos, cache, none⟩
     else
       let tk := stack.back
-      ⟨stack, lhsPrec, pos, { tokenCache := { startPos := startPos, stopPos := pos, token := tk } }, none⟩
+      ⟨stack, lhsPrec, pos, { cache with tokenCache := { startPos := startPos, stopPos := pos, token := tk } }, none⟩
   | other => other
 
 def tokenFn (expected : List String := []) : ParserFn := fun c s =>
@@ -1675,8 +1700,54 @@ builtin_initialize categoryParserFnExtension : EnvExtension CategoryParserFn ←
 def categoryParserFn (catName : Name) : ParserFn := fun ctx s =>
   categoryParserFnExtension.getState ctx.env catName ctx s
 
+/-- Categories whose parsers are memoized by `withCacheFn`. -/
+def cachedCategories : List Name := [`term, `tactic]
+
+/-- Maximal number of entries in `ParserCache.parserCache`. The table is emptied when it is full. -/
+def maxParserCacheSize : Nat := 4096
+
+/--
+  Run the category parser `p` for `catName`, reusing its result if it has already been run at the same
+  position in the same context. This avoids re-parsing the same term or tactic when backtracking
+  through `<|>`, `many`, or the longest-match loop of `prattParser`.
+  Results are only stored if `p` pushed exactly one syntax tree. -/
+def withCacheFn (catName : Name) (p : ParserFn) : ParserFn := fun c s =>
+  if s.hasError then p c s else
+  let key : ParserCacheKey := {
+    catName, pos := s.pos, prec := c.prec, lhsPrec := s.lhsPrec, quotDepth := c.quotDepth
+    suppressInsideQuot := c.suppressInsideQuot, savedPos? := c.savedPos?, forbiddenTk? := c.forbiddenTk? }
+  match s.cache.parserCache.find? key with
+  | some r =>
+    match s with
+    | ⟨stack, _, _, cache, _⟩ =>
+      ⟨stack.push r.stx, r.lhsPrec, r.newPos, { cache with hits := cache.hits + 1 }, r.errorMsg⟩
+  | none =>
+    let iniSz := s.stackSize
+    match p c s with
+    | ⟨stack, lhsPrec, pos, cache, errorMsg⟩ =>
+      let cache := { cache with misses := cache.misses + 1 }
+      if stack.size != iniSz + 1 then
+        ⟨stack, lhsPrec, pos, cache, errorMsg⟩
+      else
+        let parserCache := if cache.parserCache.size ≥ maxParserCacheSize then {} else cache.parserCache
+        let parserCache := parserCache.insert key { stx := stack.back, lhsPrec, newPos := pos, errorMsg }
+        ⟨stack, lhsPrec, pos, { cache with parserCache }, errorMsg⟩
+
+/--
+  Run `p` with an empty parser cache, and restore the outer one afterwards. Must be used by combinators
+  that change parts of the context not in `ParserCacheKey`, such as the environment or the token table. -/
+def withResetCacheFn (p : ParserFn) : ParserFn := fun c s =>
+  let parserCache := s.cache.parserCache
+  match p c { s with cache := { s.cache with parserCache := {} } } with
+  | ⟨stack, lhsPrec, pos, cache, errorMsg⟩ => ⟨stack, lhsPrec, pos, { cache with parserCache }, errorMsg⟩
+
 def categoryParser (catName : Name) (prec : Nat) : Parser := {
-  fn := fun c s => categoryParserFn catName { c with prec := prec } s
+  fn := fun c s =>
+    let c := { c with prec := prec }
+    if cachedCategories.contains catName then
+      withCacheFn catName (categoryParserFn catName) c s
+    else
+      categoryParserFn catName c s
 }
 
 -- Define `termParser` here because we need it for antiquotations
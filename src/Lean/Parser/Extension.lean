@@ -365,7 +365,7 @@ unsafe def evalParserConstUnsafe (declName : Name) : ParserFn := fun ctx s => un
   | .ok (_, p) =>
     -- We should manually register `p`'s tokens before invoking it as it might not be part of any syntax category (yet)
     let ctx := { ctx with tokens := p.info.collectTokens [] |>.foldl (fun tks tk => tks.insert tk tk) ctx.tokens }
-    return p.fn ctx s
+    return withResetCacheFn p.fn ctx s
   | .error e   => return s.mkUnexpectedError e.toString
 
 @[implemented_by evalParserConstUnsafe]
@@ -587,7 +587,7 @@ private def withNamespaces (ids : Array Name) (p : ParserFn) (addOpenSimple : Bo
       (env, openDecls)
     { c with env, openDecls }
   let tokens := parserExtension.getState c.env |>.tokens
-  p { c with tokens } s
+  withResetCacheFn p { c with tokens } s
 
 def withOpenDeclFnCore (openDeclStx : Syntax) (p : ParserFn) : ParserFn := fun c s =>
   if openDeclStx.getKind == `Lean.Parser.Command.openSimple then
@@ -96,6 +96,8 @@ def optSemicolon (p : Parser) : Parser := ppDedent $ semicolonOrLinebreak >> ppL
 @[builtin_term_parser] def syntheticHole := leading_parser "?" >> (ident <|> hole)
 /-- A temporary placeholder for a missing proof or value. -/
 @[builtin_term_parser] def «sorry» := leading_parser "sorry"
+/-- A subterm omitted by the pretty printer, see `pp.deepTerms`. It cannot be elaborated. -/
+@[builtin_term_parser] def omission := leading_parser "⋯"
 /--
 A placeholder for an implicit lambda abstraction's variable. The lambda abstraction is scoped to the surrounding parentheses.
 For example, `(· + ·)` is equivalent to `fun x y => x + y`.
@@ -41,6 +41,19 @@ structure Context where
   openDecls      : List OpenDecl
   inPattern      : Bool := false -- true when delaborating `match` patterns
   subExpr        : SubExpr
+  /-- The subterms without loose bound variables that occur more than once in the input, see `withMemo`. -/
+  sharedSubterms : HashSet ExprStructEq := {}
+
+/-- The result of delaborating a subterm at `pos`, see `withMemo`. -/
+structure MemoEntry where
+  /-- Identifies the local context, which is only extended while delaborating a term. -/
+  lctxKey   : Nat × Option FVarId
+  inPattern : Bool
+  /-- The depth of `pos` if `pp.deepTerms` is false, and `0` otherwise. -/
+  depth     : Nat
+  pos       : Pos
+  stx       : Term
+  infos     : PosMap Info
 
 structure State where
   /-- We attach `Elab.Info` at various locations in the `Syntax` output in order to convey
@@ -49,6 +62,7 @@ structure State where
   infos    : PosMap Info := {}
   /-- See `SubExpr.nextExtraPos`. -/
   holeIter : SubExpr.HoleIterator := {}
+  memo     : ExprStructMap (Array MemoEntry) := {}
 
 -- Exceptions from delaborators are not expected. We use an internal exception to signal whether
 -- the delaborator was able to produce a Syntax object.
@@ -82,8 +96,8 @@ instance (priority := low) : MonadWithReaderOf SubExpr DelabM where
 
 instance (priority := low) : MonadStateOf SubExpr.HoleIterator DelabM where
   get         := State.holeIter <$> get
-  set iter    := modify fun ⟨infos, _⟩ => ⟨infos, iter⟩
-  modifyGet f := modifyGet fun ⟨infos, iter⟩ => let (ret, iter') := f iter; (ret, ⟨infos, iter'⟩)
+  set iter    := modify fun s => { s with holeIter := iter }
+  modifyGet f := modifyGet fun s => let (ret, iter') := f s.holeIter; (ret, { s with holeIter := iter' })
 
 -- Macro scopes in the delaborator output are ultimately ignored by the pretty printer,
 -- so give a trivial implementation.
@@ -232,24 +246,111 @@ partial def delabFor : Name → Delab
     -- have `app.Option.some` fall back to `app` etc.
     <|> if k.isAtomic then failure else delabFor k.getRoot
 
+/-- Whether to display the current subterm as `⋯`, see `pp.deepTerms`. Small subterms are always displayed. -/
+def shouldOmitExpr (e : Expr) : DelabM Bool := do
+  if e.isAtomic then return false
+  let opts ← getOptionsAtCurrPos
+  if getPPDeepTerms opts then return false
+  let threshold := getPPDeepTermsThreshold opts
+  return (← getPos).depth > threshold && e.data.approxDepth.toNat > threshold / 4
+
+/-- `⋯` in place of the current subterm. Its info still refers to the subterm, which can be displayed on hover. -/
+def omission : Delab :=
+  annotateTermInfo ⟨mkNode ``Lean.Parser.Term.omission #[mkAtom "⋯"]⟩
+
+/-- The subterms of `e` without loose bound variables that occur more than once. -/
+partial def findSharedSubterms (e : Expr) : HashSet ExprStructEq :=
+  let (_, counts) := go e |>.run {}
+  counts.fold (init := {}) fun s e n => if n > 1 then s.insert e else s
+where
+  go (e : Expr) : StateM (ExprStructMap Nat) Unit := do
+    if e.isAtomic then return
+    if !e.hasLooseBVars then
+      if let some n := (← get).find? ⟨e⟩ then
+        -- the subterms of a repeated subterm are reused together with it
+        modify (·.insert ⟨e⟩ (n + 1))
+        return
+      modify (·.insert ⟨e⟩ 1)
+    match e with
+    | .app f a           => go f; go a
+    | .lam _ d b _       => go d; go b
+    | .forallE _ d b _   => go d; go b
+    | .letE _ t v b _    => go t; go v; go b
+    | .mdata _ b         => go b
+    | .proj _ _ b        => go b
+    | _                  => return
+
+private partial def rebaseSyntax (q q' : Pos) : Syntax → Syntax
+  | .node info k args     => .node (rebaseInfo info) k (args.map (rebaseSyntax q q'))
+  | .atom info val        => .atom (rebaseInfo info) val
+  | .ident info raw val p => .ident (rebaseInfo info) raw val p
+  | .missing              => .missing
+where
+  rebasePos (pos : String.Pos) : String.Pos :=
+    ⟨q.replacePrefix? q' pos.byteIdx |>.getD pos.byteIdx⟩
+  rebaseInfo : SourceInfo → SourceInfo
+    | .synthetic pos endPos canonical => .synthetic (rebasePos pos) (rebasePos endPos) canonical
+    | info                            => info
+
+private def rebaseElabInfo (q q' : Pos) : Info → Info
+  | .ofTermInfo i  => .ofTermInfo { i with stx := rebaseSyntax q q' i.stx }
+  | .ofFieldInfo i => .ofFieldInfo { i with stx := rebaseSyntax q q' i.stx }
+  | i              => i
+
+/--
+Delaborate the current subterm using `x`. If the subterm occurs more than once in the input, the result is reused
+for the other occurrences in the same local context, with the positions of the output and of its infos moved to the
+position of the occurrence. Subterms with subterm-specific options, or whose output uses extra positions, are
+delaborated every time.
+-/
+def withMemo (x : Delab) : Delab := do
+  let e ← getExpr
+  let ctx ← read
+  unless ctx.sharedSubterms.contains ⟨e⟩ do return ← x
+  let pos ← getPos
+  if ctx.optionsPerPos.any fun p _ => (p.replacePrefix? pos pos).isSome then return ← x
+  let lctx ← getLCtx
+  let lctxKey := (lctx.numIndices, if lctx.numIndices == 0 then none else lctx.lastDecl.map (·.fvarId))
+  let depth := if getPPDeepTerms ctx.defaultOptions then 0 else pos.depth
+  let entries := (← get).memo.findD ⟨e⟩ #[]
+  let isMatch (entry : MemoEntry) :=
+    entry.lctxKey == lctxKey && entry.inPattern == ctx.inPattern && entry.depth == depth
+  if let some entry := entries.find? isMatch then
+    modify fun s => { s with infos := entry.infos.fold (init := s.infos) fun infos p info =>
+      match p.replacePrefix? entry.pos pos with
+      | some p' => infos.insert p' (rebaseElabInfo entry.pos pos info)
+      | none    => infos }
+    return ⟨rebaseSyntax entry.pos pos entry.stx⟩
+  -- collect the infos of the subterm separately
+  let outer ← modifyGet fun s => (s.infos, { s with infos := {} })
+  let holeIter := (← get).holeIter
+  let (stx, infos) ← tryFinally (return (← x, (← get).infos)) do
+    modify fun s => { s with infos := s.infos.fold (init := outer) fun infos p info => infos.insert p info }
+  if (← get).holeIter.curr == holeIter.curr then
+    let entry : MemoEntry := { lctxKey, inPattern := ctx.inPattern, depth, pos, stx, infos }
+    modify fun s => { s with memo := s.memo.insert ⟨e⟩ (entries.push entry) }
+  return stx
+
 partial def delab : Delab := do
   checkMaxHeartbeats "delab"
   let e ← getExpr
-
-  -- no need to hide atomic proofs
-  if ← pure !e.isAtomic <&&> pure !(← getPPOption getPPProofs) <&&> (try Meta.isProof e catch _ => pure false) then
-    if ← getPPOption getPPProofsWithType then
-      let stx ← withType delab
-      return ← annotateTermInfo (← `((_ : $stx)))
+  if ← shouldOmitExpr e then
+    return ← omission
+  withMemo do
+    -- no need to hide atomic proofs
+    if ← pure !e.isAtomic <&&> pure !(← getPPOption getPPProofs) <&&> (try Meta.isProof e catch _ => pure false) then
+      if ← getPPOption getPPProofsWithType then
+        let stx ← withType delab
+        return ← annotateTermInfo (← `((_ : $stx)))
+      else
+        return ← annotateTermInfo (← ``(_))
+    let k ← getExprKind
+    let stx ← delabFor k <|> (liftM $ show MetaM _ from throwError "don't know how to delaborate '{k}'")
+    if ← getPPOption getPPAnalyzeTypeAscriptions <&&> getPPOption getPPAnalysisNeedsType <&&> pure !e.isMData then
+      let typeStx ← withType delab
+      `(($stx : $typeStx)) >>= annotateCurPos
     else
-      return ← annotateTermInfo (← ``(_))
-  let k ← getExprKind
-  let stx ← delabFor k <|> (liftM $ show MetaM _ from throwError "don't know how to delaborate '{k}'")
-  if ← getPPOption getPPAnalyzeTypeAscriptions <&&> getPPOption getPPAnalysisNeedsType <&&> pure !e.isMData then
-    let typeStx ← withType delab
-    `(($stx : $typeStx)) >>= annotateCurPos
-  else
-    return stx
+      return stx
 
 unsafe def mkAppUnexpanderAttribute : IO (KeyedDeclsAttribute Unexpander) :=
   KeyedDeclsAttribute.init {
@@ -292,7 +393,8 @@ def delabCore (e : Expr) (optionsPerPos : OptionsPerPos := {}) (delab := Delabor
         currNamespace := (← getCurrNamespace)
         openDecls := (← getOpenDecls)
         subExpr := SubExpr.mkRoot e
-        inPattern := opts.getInPattern }
+        inPattern := opts.getInPattern
+        sharedSubterms := Delaborator.findSharedSubterms e }
       |>.run { : Delaborator.State })
     (fun _ => unreachable!)
   return (stx, infos)
@@ -0,0 +1,152 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Environment
+import Lean.Message
+import Lean.Util.FoldConsts
+
+/-!
+Re-checking the declarations of `.olean` files with the kernel, used by `lean --replay <module>...`.
+
+The constants of the given modules and their imports are read from the `.olean` files, and added to an empty
+environment in dependency order: every constant is added after the constants referenced by its type and value. As in
+`Environment.addDecls`, the values of theorems are checked by tasks in parallel, while the following declarations only
+wait for the statements of the theorems they use. Constructors and recursors are not replayed but generated by the
+kernel when adding their inductive types, and then compared with the ones of the `.olean` files.
+-/
+
+namespace Lean.Replay
+
+structure State where
+  /-- The constants of the `.olean` files. -/
+  constants : HashMap Name ConstantInfo
+  /-- Constants whose declaration has already been added to `decls`, or is being added. -/
+  visited   : NameHashSet := {}
+  decls     : Array Declaration := #[]
+  numTheorems : Nat := 0
+
+abbrev M := StateRefT State IO
+
+private def getConst (n : Name) : M ConstantInfo := do
+  let some c := (← get).constants.find? n
+    | throw <| IO.userError s!"unknown constant '{n}' in the imported modules"
+  return c
+
+private def usedConstants (c : ConstantInfo) : Array Name :=
+  let cs := c.type.getUsedConstants
+  match c.value? with
+  | some v => cs ++ v.getUsedConstants
+  | none   => cs
+
+/-- The constant whose declaration adds `c`. Constructors and recursors are added by their inductive types. -/
+private def getDeclConst (c : ConstantInfo) : Name :=
+  match c with
+  | .ctorInfo v => v.induct
+  | .recInfo v  => v.getInduct
+  | _           => c.name
+
+mutual
+/-- Add the declaration of `n` to `decls` after the declarations of the constants it depends on. -/
+private partial def replayConst (n : Name) : M Unit := do
+  let c ← getConst n
+  let n := getDeclConst c
+  if (← get).visited.contains n then return
+  match ← getConst n with
+  | .inductInfo v   => replayInductive v
+  | .quotInfo _     =>
+    -- the kernel checks that `Eq` has the expected type before adding the quotient constants
+    replayConst ``Eq
+    for q in [``Quot, ``Quot.mk, ``Quot.lift, ``Quot.ind] do
+      modify fun s => { s with visited := s.visited.insert q }
+    modify fun s => { s with decls := s.decls.push .quotDecl }
+  | c@(.defnInfo v) =>
+    if v.safety != .safe && v.all.length > 1 then
+      -- mutual `unsafe` and `partial` definitions refer to each other and are added together
+      replayBlock v.all fun defns => .mutualDefnDecl <| defns.filterMap fun
+        | .defnInfo v => some v
+        | _           => none
+    else
+      replayBlock [c.name] fun _ => .defnDecl v
+  | c@(.thmInfo v)    =>
+    replayBlock [c.name] fun _ => .thmDecl v
+    modify fun s => { s with numTheorems := s.numTheorems + 1 }
+  | c@(.axiomInfo v)  => replayBlock [c.name] fun _ => .axiomDecl v
+  | c@(.opaqueInfo v) => replayBlock [c.name] fun _ => .opaqueDecl v
+  | .ctorInfo _ | .recInfo _ => unreachable!
+
+/--
+Mark the constants `ns` as visited, replay their dependencies outside of `ns`, and add the declaration `mkDecl cs`,
+where `cs` are the constants `ns`.
+-/
+private partial def replayBlock (ns : List Name) (mkDecl : List ConstantInfo → Declaration) : M Unit := do
+  for n in ns do
+    modify fun s => { s with visited := s.visited.insert n }
+  let cs ← ns.mapM getConst
+  for c in cs do
+    for d in usedConstants c do
+      replayConst d
+  modify fun s => { s with decls := s.decls.push (mkDecl cs) }
+
+private partial def replayInductive (v : InductiveVal) : M Unit := do
+  let mut types := []
+  let mut ctorNames := []
+  for n in v.all do
+    let .inductInfo t ← getConst n | throw <| IO.userError s!"'{n}' is not an inductive type"
+    let mut ctors := []
+    for ctor in t.ctors do
+      let c ← getConst ctor
+      ctors := ctors ++ [{ name := c.name, type := c.type : Constructor }]
+    types := types ++ [{ name := t.name, type := t.type, ctors : InductiveType }]
+    ctorNames := ctorNames ++ t.ctors
+  -- the recursors are generated by the kernel and compared with the imported ones in `checkGenerated`
+  replayBlock (v.all ++ ctorNames) fun _ => .inductDecl v.levelParams v.numParams types v.isUnsafe
+end
+
+/-- Check that the constructors and recursors generated by the kernel are the ones of the `.olean` files. -/
+private def checkGenerated (env : Environment) (constants : HashMap Name ConstantInfo) : IO Unit := do
+  for (n, c) in constants.toList do
+    let generated? := match c with
+      | .ctorInfo v => some (env.find? n |>.bind fun
+        | .ctorInfo v' => some (v == v')
+        | _ => some false)
+      -- this includes the number of parameters, indices, motives, and minor premises, and the fields of each rule
+      | .recInfo v => some (env.find? n |>.bind fun
+        | .recInfo v' => some (v == v')
+        | _ => some false)
+      | _ => none
+    match generated? with
+    | some (some true) => pure ()
+    | some _           => throw <| IO.userError s!"'{n}' does not match the constant generated by the kernel"
+    | none             => pure ()
+
+end Replay
+
+open Replay in
+/--
+Check all constants of the modules `mods` and their imports with the kernel, and print the number of declarations and
+the throughput. The `.olean` files are found using the search path of `lean`.
+-/
+@[export lean_replay_modules]
+def replayModules (mods : Array String) : IO UInt32 := do
+  let start ← IO.monoMsNow
+  let imports := mods.toList.map fun mod => { module := mod.toName : Import }
+  let env ← importModules imports {}
+  let mut constants : HashMap Name ConstantInfo := mkHashMap (capacity := env.constants.size)
+  for mod in env.header.moduleData do
+    for n in mod.constNames, c in mod.constants do
+      constants := constants.insert n c
+  let readTime := (← IO.monoMsNow) - start
+  let (_, s) ← (constants.forM fun n _ => replayConst n).run { constants }
+  let env' ← mkEmptyEnvironment
+  match env'.addDecls s.decls.toList with
+  | .error ex =>
+    IO.eprintln s!"replay failed: {← (ex.toMessageData {}).toString}"
+    return 1
+  | .ok env' =>
+    checkGenerated env' constants
+    let time := (← IO.monoMsNow) - start - readTime
+    IO.println s!"checked {s.decls.size} declarations ({s.numTheorems} theorems, {constants.size} constants) of {env.header.moduleNames.size} modules in {time}ms ({s.decls.size * 1000 / max time 1} declarations/s), reading took {readTime}ms"
+    return 0
+
+end Lean
@@ -137,6 +137,65 @@ def resolveGlobalName (env : Environment) (ns : Name) (openDecls : List OpenDecl
     | _ => []
   loop extractionResult.name []
 
+/--
+Results of `resolveGlobalName` in a fixed current namespace, list of open declarations, and environment. The results
+only depend on the constants, aliases, protected declarations, and main module of the environment, and the cache is
+only valid for the same objects, see `Cache.isValidFor`. In particular, adding a constant invalidates the cache.
+-/
+structure Cache where
+  currNamespace  : Name := .anonymous
+  openDecls      : List OpenDecl := []
+  mainModule     : Name := .anonymous
+  constants      : ConstMap := {}
+  aliases        : AliasState := {}
+  protectedDecls : NameSet := {}
+  entries        : HashMap Name (List (Name × List String)) := {}
+  deriving Inhabited
+
+namespace Cache
+
+def mkFor (env : Environment) (ns : Name) (openDecls : List OpenDecl) : Cache where
+  currNamespace  := ns
+  openDecls      := openDecls
+  mainModule     := env.mainModule
+  constants      := env.constants
+  aliases        := getAliasState env
+  protectedDecls := protectedExt.getState env
+
+private unsafe def isValidForEnvUnsafe (c : Cache) (env : Environment) : Bool :=
+  c.mainModule == env.mainModule && ptrEq c.constants env.constants && ptrEq c.aliases (getAliasState env) &&
+  ptrEq c.protectedDecls (protectedExt.getState env)
+
+/--
+Return `true` if the entries of `c` only depend on parts of the environment that `env` shares with the environment
+of `c`. The components are compared by pointer equality, so this takes constant time, but may return `false` for
+equal components.
+-/
+@[implemented_by isValidForEnvUnsafe]
+opaque isValidForEnv (c : Cache) (env : Environment) : Bool
+
+private unsafe def isValidForUnsafe (c : Cache) (env : Environment) (ns : Name) (openDecls : List OpenDecl) : Bool :=
+  c.currNamespace == ns && ptrEq c.openDecls openDecls && c.isValidForEnv env
+
+/-- Return `true` if the entries of `c` are the results of `resolveGlobalName env ns openDecls`, see `isValidForEnv`. -/
+@[implemented_by isValidForUnsafe]
+opaque isValidFor (c : Cache) (env : Environment) (ns : Name) (openDecls : List OpenDecl) : Bool
+
+/--
+Return `c` if it is still valid for `env`, and an empty cache otherwise. Monads that cache the results of
+`resolveGlobalName` use it whenever they replace the environment, so that the cache does not keep the constants and
+aliases of an older environment alive.
+-/
+def forEnv (c : Cache) (env : Environment) : Cache :=
+  if c.isValidForEnv env then c else {}
+
+end Cache
+
+/-- Access to the cache of `resolveGlobalName` in the monad `m`, see `MonadResolveName.resolveNameCache?`. -/
+structure CacheRef (m : Type → Type) where
+  get    : m Cache
+  modify : (Cache → Cache) → m Unit
+
 /-! # Namespace resolution -/
 
 def resolveNamespaceUsingScope? (env : Environment) (n : Name) : Name → Option Name
@@ -170,12 +229,16 @@ end ResolveName
 class MonadResolveName (m : Type → Type) where
   getCurrNamespace   : m Name
   getOpenDecls       : m (List OpenDecl)
+  /-- Cache of `resolveGlobalName`. The default `none` means that the monad does not cache the results. -/
+  resolveNameCache?  : Option (ResolveName.CacheRef m) := none
 
 export MonadResolveName (getCurrNamespace getOpenDecls)
 
 instance (m n) [MonadLift m n] [MonadResolveName m] : MonadResolveName n where
-  getCurrNamespace := liftM (m:=m) getCurrNamespace
-  getOpenDecls     := liftM (m:=m) getOpenDecls
+  getCurrNamespace  := liftM (m:=m) getCurrNamespace
+  getOpenDecls      := liftM (m:=m) getOpenDecls
+  resolveNameCache? := (MonadResolveName.resolveNameCache? (m:=m)).map fun c =>
+    { get := liftM c.get, modify := fun f => liftM (c.modify f) }
 
 /--
   Given a name `n`, return a list of possible interpretations.
@@ -201,7 +264,21 @@ instance (m n) [MonadLift m n] [MonadResolveName m] : MonadResolveName n where
   - `resolveGlobalName x.z.w` => `[(Foo.x, [z, w]), (Boo.x, [z, w])]`
 -/
 def resolveGlobalName [Monad m] [MonadResolveName m] [MonadEnv m] (id : Name) : m (List (Name × List String)) := do
-  return ResolveName.resolveGlobalName (← getEnv) (← getCurrNamespace) (← getOpenDecls) id
+  let env ← getEnv
+  let ns ← getCurrNamespace
+  let openDecls ← getOpenDecls
+  let some c := MonadResolveName.resolveNameCache? (m := m)
+    | return ResolveName.resolveGlobalName env ns openDecls id
+  let cache ← c.get
+  let valid := cache.isValidFor env ns openDecls
+  if valid then
+    if let some r := cache.entries.find? id then
+      return r
+  let r := ResolveName.resolveGlobalName env ns openDecls id
+  c.modify fun cache =>
+    let cache := if valid then cache else .mkFor env ns openDecls
+    { cache with entries := cache.entries.insert id r }
+  return r
 
 /--
 Given a namespace name, return a list of possible interpretations.
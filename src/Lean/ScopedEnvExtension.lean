@@ -35,7 +35,13 @@ structure Descr (α : Type) (β : Type) (σ : Type) where
   ofOLeanEntry   : σ → α → ImportM β
   toOLeanEntry   : β → α
   addEntry       : σ → β → σ
+  /-- Add the global entries of all imported modules at once. Equivalent to folding `addEntry`, but
+  may be more efficient. If it is provided, `ofOLeanEntry` is given the initial state instead of the
+  state after adding the previous entries. -/
+  addImportedEntries? : Option (σ → Array β → σ) := none
   finalizeImport : σ → σ := id
+  /-- See `PersistentEnvExtensionDescr.parallelImport`. Only valid if `ofOLeanEntry` does not read the environment. -/
+  parallelImport : Bool := false
 
 instance [Inhabited α] : Inhabited (Descr α β σ) where
   default := {
@@ -57,15 +63,21 @@ def ScopedEntries.insert (scopedEntries : ScopedEntries β) (ns : Name) (b : β)
 def addImportedFn (descr : Descr α β σ) (as : Array (Array (Entry α))) : ImportM (StateStack α β σ) := do
   let mut s ← descr.mkInitial
   let mut scopedEntries : ScopedEntries β := {}
+  let mut globalEntries : Array β := #[]
   for a in as do
     for e in a do
       match e with
       | Entry.global a =>
         let b ← descr.ofOLeanEntry s a
-        s := descr.addEntry s b
+        if descr.addImportedEntries?.isSome then
+          globalEntries := globalEntries.push b
+        else
+          s := descr.addEntry s b
       | Entry.scoped ns a =>
         let b ← descr.ofOLeanEntry s a
         scopedEntries := scopedEntries.insert ns b
+  if let some addImportedEntries := descr.addImportedEntries? then
+    s := addImportedEntries s globalEntries
   s := descr.finalizeImport s
   return { stateStack := [ { state := s } ], scopedEntries := scopedEntries }
 
@@ -111,6 +123,7 @@ unsafe def registerScopedEnvExtensionUnsafe (descr : Descr α β σ) : IO (Scope
     addEntryFn      := addEntryFn descr
     exportEntriesFn := exportEntriesFn
     statsFn         := fun s => format "number of local entries: " ++ format s.newEntries.length
+    parallelImport  := descr.parallelImport
   }
   let ext := { descr := descr, ext := ext : ScopedEnvExtension α β σ }
   scopedEnvExtensionsRef.modify fun exts => exts.push (unsafeCast ext)
@@ -200,6 +213,8 @@ structure SimpleScopedEnvExtension.Descr (α : Type) (σ : Type) where
   name           : Name := by exact decl_name%
   addEntry       : σ → α → σ
   initial        : σ
+  /-- See `ScopedEnvExtension.Descr.addImportedEntries?`. -/
+  addImportedEntries? : Option (σ → Array α → σ) := none
   finalizeImport : σ → σ := id
 
 def registerSimpleScopedEnvExtension (descr : SimpleScopedEnvExtension.Descr α σ) : IO (SimpleScopedEnvExtension α σ) := do
@@ -209,7 +224,9 @@ def registerSimpleScopedEnvExtension (descr : SimpleScopedEnvExtension.Descr α
     addEntry       := descr.addEntry
     toOLeanEntry   := id
     ofOLeanEntry   := fun _ a => return a
+    addImportedEntries? := descr.addImportedEntries?
     finalizeImport := descr.finalizeImport
+    parallelImport := true
   }
 
 end Lean
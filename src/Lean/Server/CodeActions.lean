@@ -72,6 +72,8 @@ builtin_initialize codeActionProviderExt : SimplePersistentEnvExtension Name Nam
   addImportedFn := fun nss => nss.foldl (fun acc ns => ns.foldl NameSet.insert acc) ∅
   addEntryFn := fun s n => s.insert n
   toArrayFn  := fun es => es.toArray.qsort Name.quickLt
+  -- only queried by the language server
+  lazyImport := true
 }
 
 builtin_initialize registerBuiltinAttribute {
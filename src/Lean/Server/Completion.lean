@@ -6,6 +6,7 @@ Authors: Leonardo de Moura
 import Lean.Environment
 import Lean.Parser.Term
 import Lean.Data.FuzzyMatching
+import Lean.Data.NameTrie
 import Lean.Data.Lsp.LanguageFeatures
 import Lean.Data.Lsp.Capabilities
 import Lean.Data.Lsp.Utf16
@@ -35,6 +36,38 @@ private def isBlackListed (declName : Name) : MetaM Bool := do
   <||> (pure <| completionBlackListExt.isTagged env declName)
   <||> isMatcher declName
 
+/-- The imported declarations indexed by the namespace containing them, see `getImportedDeclIndex`. -/
+structure ImportedDeclIndex where
+  moduleNames : Array Name := #[]
+  decls       : NameTrie (Array Name) := {}
+  deriving Inhabited
+
+builtin_initialize importedDeclIndexRef : IO.Ref ImportedDeclIndex ← IO.mkRef {}
+
+/--
+The names of the imported declarations of `env` indexed by the namespace containing them. The index is computed
+once per set of imports, i.e., once per file worker.
+-/
+private def getImportedDeclIndex (env : Environment) : IO (NameTrie (Array Name)) := do
+  let moduleNames := env.allImportedModuleNames
+  let index ← importedDeclIndexRef.get
+  if index.moduleNames == moduleNames then
+    return index.decls
+  let pairs := env.constants.map₁.fold (init := #[]) fun pairs declName _ => pairs.push (declName.getPrefix, declName)
+  -- group the declarations by namespace without copying the arrays in the trie
+  let pairs := pairs.qsort fun a b => Name.quickLt a.1 b.1
+  let mut decls : NameTrie (Array Name) := {}
+  let mut i := 0
+  while i < pairs.size do
+    let ns := pairs[i]!.1
+    let mut group := #[]
+    while i < pairs.size && pairs[i]!.1 == ns do
+      group := group.push pairs[i]!.2
+      i := i + 1
+    decls := decls.insert ns group
+  importedDeclIndexRef.set { moduleNames, decls }
+  return decls
+
 private partial def consumeImplicitPrefix (e : Expr) (k : Expr → MetaM α) : MetaM α := do
   match e with
   | Expr.forallE n d b c =>
@@ -230,6 +263,17 @@ def completeNamespaces (ctx : ContextInfo) (id : Name) (danglingDot : Bool) : M
           | _ => return ()
       visitNamespaces ctx.currNamespace
 
+/-- The namespaces in which `idCompletionCore` looks for declarations: the root namespace, the current namespace and
+its prefixes, and the open namespaces. -/
+private def completionNamespaces (ctx : ContextInfo) : Array Name :=
+  ctx.openDecls.foldl (init := currNamespaces ctx.currNamespace #[.anonymous]) fun nss
+    | .simple ns _ => nss.push ns
+    | _            => nss
+where
+  currNamespaces : Name → Array Name → Array Name
+    | ns@(.str p _), nss => currNamespaces p (nss.push ns)
+    | _,             nss => nss
+
 private def idCompletionCore (ctx : ContextInfo) (id : Name) (hoverInfo : HoverInfo) (danglingDot : Bool) (expectedType? : Option Expr) : M Unit := do
   let mut id := id.eraseMacroScopes
   let mut danglingDot := danglingDot
@@ -244,7 +288,16 @@ private def idCompletionCore (ctx : ContextInfo) (id : Name) (hoverInfo : HoverI
         addCompletionItem localDecl.userName localDecl.type expectedType? none (kind := CompletionItemKind.variable) score
   -- search for matches in the environment
   let env ← getEnv
-  env.constants.forM fun declName c => do
+  /- Without a dangling dot, `matchDecl?` only succeeds if the last component of `id` fuzzy matches the last component
+  of the declaration name, so we skip the other declarations before the more expensive checks. -/
+  let idMask? := match id with
+    | .str _ s => if danglingDot then none else some (FuzzyMatching.charMask s)
+    | _        => none
+  let visitDecl (declName : Name) (c : ConstantInfo) : M Unit := do
+    if let some idMask := idMask? then
+      let .str _ s := declName | return
+      if FuzzyMatching.charMask s &&& idMask != idMask then
+        return
     unless (← isBlackListed declName) do
       let matchUsingNamespace (ns : Name): M Bool := do
         if let some (label, score) ← matchDecl? ns id danglingDot declName then
@@ -270,6 +323,20 @@ private def idCompletionCore (ctx : ContextInfo) (id : Name) (hoverInfo : HoverI
             if (← matchUsingNamespace ns) then
               return ()
         | _ => pure ()
+  /- `visitDecl` only succeeds on declarations in the namespace `ns ++ id` with a dangling dot, and `ns ++ id.getPrefix`
+  otherwise, where `ns` is one of `completionNamespaces`. We only visit these imported declarations, but all
+  declarations of the current file. As the current module is not imported, its private names are not in the index. -/
+  let idNs := if danglingDot then id else id.getPrefix
+  let index ← getImportedDeclIndex env
+  let mut visited : Array Name := #[]
+  for ns in completionNamespaces ctx do
+    let ns := ns ++ idNs
+    unless visited.contains ns do
+      visited := visited.push ns
+      for declName in (index.find? ns).getD #[] do
+        if let some c := env.constants.map₁.find? declName then
+          visitDecl declName c
+  env.constants.map₂.forM visitDecl
   -- Recall that aliases may not be atomic and include the namespace where they were created.
   let matchAlias (ns : Name) (alias : Name) : Option Float :=
     if ns.isPrefixOf alias then
@@ -21,6 +21,7 @@ import Lean.Server.AsyncList
 import Lean.Server.References
 
 import Lean.Server.FileWorker.Utils
+import Lean.Server.FileWorker.DiagnosticsCache
 import Lean.Server.FileWorker.RequestHandling
 import Lean.Server.FileWorker.WidgetRequests
 import Lean.Server.Rpc.Basic
@@ -65,12 +66,66 @@ structure WorkerContext where
 
 /-! # Asynchronous snapshot elaboration -/
 
+register_builtin_option server.memoryLimit : Nat := {
+  defValue := 0
+  group    := "server"
+  descr    := "(server) resident memory in megabytes above which the file worker drops the tactic caches of snapshots away from the last edit (0 = unlimited). Dropped caches only make re-elaboration of the corresponding commands slower."
+}
+
 section Elab
   structure AsyncElabState where
-    snaps : Array Snapshot
+    snaps   : Array Snapshot
+    /-- Index of the first snapshot elaborated for the current document version, i.e. the one after the last edit. -/
+    editIdx : Nat := 0
+    /-- Diagnostics of the previous session on the same file contents, see `DiagnosticsCache`. They are shown for
+    the part of the file that has not been elaborated yet. -/
+    cachedDiags : Array (Diagnostic × String) := #[]
+
+  /-- Number of snapshots on each side of the last edit that keep their tactic caches when
+  `server.memoryLimit` is exceeded. -/
+  private def retainedCacheRadius := 2
+
+  /-- Drops the tactic caches of snapshots away from the last edit if the worker uses more memory than
+  `server.memoryLimit` allows. The tactic cache of a snapshot is only used to speed up re-elaborating
+  the following command, and is rebuilt when that command is elaborated again. -/
+  private def enforceMemoryLimit (s : AsyncElabState) (limitMB : Nat) : BaseIO Unit := do
+    if limitMB == 0 || (← IO.getResidentMemory) ≤ limitMB * 1024 * 1024 then
+      return
+    for i in [0:s.snaps.size] do
+      unless s.editIdx ≤ i + retainedCacheRadius && i ≤ s.editIdx + retainedCacheRadius do
+        s.snaps[i]!.tacticCache.set {}
 
   abbrev AsyncElabM := StateT AsyncElabState <| EIO ElabTaskError
 
+  /-- The serialized diagnostics `diags` of the file up to `pos`, followed by the cached diagnostics after `pos`. -/
+  private def withCachedDiags (m : DocumentMeta) (pos : String.Pos) (diags : PersistentArray String)
+      (cachedDiags : Array (Diagnostic × String)) : Array String :=
+    if cachedDiags.isEmpty then
+      diags.toArray
+    else
+      let lspPos := m.text.utf8PosToLspPos pos
+      diags.toArray ++ (cachedDiags.filter (lspPos ≤ ·.1.range.start)).map (·.2)
+
+  /-- Read the diagnostics cached for the contents of `m` elaborated after `headerSnap`. -/
+  def loadCachedDiags (m : DocumentMeta) (headerSnap : Snapshot) : IO (Array Diagnostic) := do
+    try
+      let some fileName ← DiagnosticsCache.cacheFile? m.uri | return #[]
+      let key ← DiagnosticsCache.computeKey m.text.source headerSnap.cmdState.scopes.head!.opts
+        headerSnap.env.header.moduleNames
+      return (← DiagnosticsCache.load fileName key).getD #[]
+    catch _ =>
+      return #[]
+
+  /-- Write the diagnostics of the fully elaborated file to the cache, see `DiagnosticsCache`. -/
+  private def saveCachedDiags (m : DocumentMeta) (headerSnap lastSnap : Snapshot) : IO Unit := do
+    try
+      let some fileName ← DiagnosticsCache.cacheFile? m.uri | return
+      let key ← DiagnosticsCache.computeKey m.text.source headerSnap.cmdState.scopes.head!.opts
+        headerSnap.env.header.moduleNames
+      DiagnosticsCache.save fileName { key, diagnostics := lastSnap.diagnostics.toArray }
+    catch _ =>
+      pure ()
+
   -- Placed here instead of Lean.Server.Utils because of an import loop
   private def publishIleanInfo (method : String) (m : DocumentMeta) (hOut : FS.Stream)
       (snaps : Array Snapshot) : IO Unit := do
@@ -92,15 +147,18 @@ section Elab
     let s ← get
     let lastSnap := s.snaps.back
     if lastSnap.isAtEnd then
-      publishDiagnostics m lastSnap.diagnostics.toArray ctx.hOut
+      publishDiagnosticsJson m lastSnap.diagnosticsJson.toArray ctx.hOut
       publishProgressDone m ctx.hOut
+      saveCachedDiags m s.snaps[0]! lastSnap
       -- This will overwrite existing ilean info for the file, in case something
       -- went wrong during the incremental updates.
       publishIleanInfoFinal m ctx.hOut s.snaps
       return none
     publishProgressAtPos m lastSnap.endPos ctx.hOut
     let snap ← compileNextCmd m.mkInputContext lastSnap ctx.clientHasWidgets
-    set { s with snaps := s.snaps.push snap }
+    let s := { s with snaps := s.snaps.push snap }
+    set s
+    enforceMemoryLimit s (server.memoryLimit.get snap.cmdState.scopes.head!.opts)
     -- TODO(MH): check for interrupt with increased precision
     cancelTk.check
     /- NOTE(MH): This relies on the client discarding old diagnostics upon receiving new ones
@@ -115,13 +173,13 @@ section Elab
     -- NOTE(WN): this is *not* redundent even if there are no new diagnostics in this snapshot
     -- because empty diagnostics clear existing error/information squiggles. Therefore we always
     -- want to publish in case there was previously a message at this position.
-    publishDiagnostics m snap.diagnostics.toArray ctx.hOut
+    publishDiagnosticsJson m (withCachedDiags m snap.endPos snap.diagnosticsJson s.cachedDiags) ctx.hOut
     publishIleanInfoUpdate m ctx.hOut #[snap]
     return some snap
 
   /-- Elaborates all commands after the last snap (at least the header snap is assumed to exist), emitting the diagnostics into `hOut`. -/
   def unfoldCmdSnaps (m : DocumentMeta) (snaps : Array Snapshot) (cancelTk : CancelToken)
-      : ReaderT WorkerContext IO (AsyncList ElabTaskError Snapshot) := do
+      (cachedDiags : Array Diagnostic := #[]) : ReaderT WorkerContext IO (AsyncList ElabTaskError Snapshot) := do
     let ctx ← read
     let headerSnap := snaps[0]!
     if headerSnap.msgLog.hasErrors then
@@ -134,7 +192,12 @@ section Elab
       -- This will overwrite existing ilean info for the file since this has a
       -- higher version number.
       publishIleanInfoUpdate m ctx.hOut snaps
-      return AsyncList.ofList snaps.toList ++ (← AsyncList.unfoldAsync (nextCmdSnap ctx m cancelTk) { snaps })
+      let cachedDiags := cachedDiags.map fun d => (d, (toJson d).compress)
+      unless cachedDiags.isEmpty do
+        let lastSnap := snaps.back
+        publishDiagnosticsJson m (withCachedDiags m lastSnap.endPos lastSnap.diagnosticsJson cachedDiags) ctx.hOut
+      return AsyncList.ofList snaps.toList ++
+        (← AsyncList.unfoldAsync (nextCmdSnap ctx m cancelTk) { snaps, editIdx := snaps.size, cachedDiags })
 end Elab
 
 -- Pending requests are tracked so they can be cancelled
@@ -185,9 +248,9 @@ section Initialization
     | 2 => pure []  -- no lakefile.lean
     | _ => throwServerError s!"`{cmdStr}` failed:\n{stdout}\nstderr:\n{stderr}"
 
-  def compileHeader (m : DocumentMeta) (hOut : FS.Stream) (opts : Options) (hasWidgets : Bool)
-      : IO (Snapshot × SearchPath) := do
-    let (headerStx, headerParserState, msgLog) ← Parser.parseHeader m.mkInputContext
+  /-- Set up the search path for the imports of `headerStx` and import them. -/
+  def processHeaderImports (m : DocumentMeta) (headerStx : Syntax) (msgLog : MessageLog) (hOut : FS.Stream)
+      (opts : Options) : IO (Environment × MessageLog × SearchPath) := do
     let mut srcSearchPath ← initSrcSearchPath (← getBuildDir)
     let lakePath ← match (← IO.getEnv "LAKE") with
       | some path => pure <| System.FilePath.mk path
@@ -207,6 +270,45 @@ section Initialization
     catch e =>  -- should be from `lake print-paths`
       let msgs := MessageLog.empty.add { fileName := "<ignored>", pos := ⟨0, 0⟩, data := e.toString }
       pure (← mkEmptyEnvironment, msgs)
+    return (headerEnv, msgLog, srcSearchPath)
+
+  /-- The result of importing a header in advance, see `LeanPreImportParams`. -/
+  structure PreImported where
+    imports       : Array Import
+    env           : Environment
+    srcSearchPath : SearchPath
+
+  private def importsKey (imports : Array Import) : Array (Name × Bool) :=
+    imports.map fun i => (i.module, i.runtimeOnly)
+
+  /--
+  Import the header of `p.text` in the background. Progress of `lake print-paths` is not reported, as the worker is
+  not assigned to a file yet. Headers with errors are not reused, the file then reports them by importing its header
+  again.
+  -/
+  def preImport (p : LeanPreImportParams) (opts : Options) : IO (Task (Option PreImported)) := do
+    let m : DocumentMeta := ⟨p.uri, 0, p.text.toFileMap⟩
+    let hOut := FS.Stream.ofBuffer (← IO.mkRef {})
+    let task ← IO.asTask do
+      let (headerStx, _, msgLog) ← Parser.parseHeader m.mkInputContext
+      let (env, msgLog, srcSearchPath) ← processHeaderImports m headerStx msgLog hOut opts
+      if msgLog.hasErrors then
+        return none
+      return some { imports := (Lean.Elab.headerToImports headerStx).toArray, env, srcSearchPath }
+    return task.map fun
+      | .ok preImported? => preImported?
+      | .error _         => none
+
+  def compileHeader (m : DocumentMeta) (hOut : FS.Stream) (opts : Options) (hasWidgets : Bool)
+      (preImported? : Option (Task (Option PreImported)) := none) : IO (Snapshot × SearchPath) := do
+    let (headerStx, headerParserState, msgLog) ← Parser.parseHeader m.mkInputContext
+    let imports := (Lean.Elab.headerToImports headerStx).toArray
+    let preImported? ← match preImported? with
+      | some t => pure <| (← IO.wait t).filter (importsKey ·.imports == importsKey imports)
+      | none   => pure none
+    let (headerEnv, msgLog, srcSearchPath) ← match preImported? with
+      | some p => pure (p.env, msgLog, p.srcSearchPath)
+      | none   => processHeaderImports m headerStx msgLog hOut opts
     let mut headerEnv := headerEnv
     try
       if let some path := System.Uri.fileUriToPath? m.uri then
@@ -229,21 +331,23 @@ section Initialization
           )).toPArray'
       )].toPArray'
     }}
+    let interactiveDiags ← cmdState.messages.msgs.mapM (Widget.msgToInteractiveDiagnostic m.text · hasWidgets)
     let headerSnap := {
       beginPos := 0
       stx := headerStx
       mpState := headerParserState
       cmdState := cmdState
-      interactiveDiags := ← cmdState.messages.msgs.mapM (Widget.msgToInteractiveDiagnostic m.text · hasWidgets)
+      interactiveDiags
+      diagnosticsJson := interactiveDiags.map Snapshot.diagnosticJson
       tacticCache := (← IO.mkRef {})
     }
-    publishDiagnostics m headerSnap.diagnostics.toArray hOut
+    publishDiagnosticsJson m headerSnap.diagnosticsJson.toArray hOut
     return (headerSnap, srcSearchPath)
 
   def initializeWorker (meta : DocumentMeta) (i o e : FS.Stream) (initParams : InitializeParams) (opts : Options)
-      : IO (WorkerContext × WorkerState) := do
+      (preImported? : Option (Task (Option PreImported)) := none) : IO (WorkerContext × WorkerState) := do
     let clientHasWidgets := initParams.initializationOptions?.bind (·.hasWidgets?) |>.getD false
-    let headerTask ← EIO.asTask <| compileHeader meta o opts (hasWidgets := clientHasWidgets)
+    let headerTask ← EIO.asTask <| compileHeader meta o opts (hasWidgets := clientHasWidgets) preImported?
     let cancelTk ← CancelToken.new
     let ctx :=
       { hIn  := i
@@ -254,7 +358,7 @@ section Initialization
         clientHasWidgets
       }
     let cmdSnaps ← EIO.mapTask (t := headerTask) (match · with
-      | Except.ok (s, _) => unfoldCmdSnaps meta #[s] cancelTk ctx
+      | Except.ok (s, _) => do unfoldCmdSnaps meta #[s] cancelTk (← loadCachedDiags meta s) ctx
       | Except.error e   => throw (e : ElabTaskError))
     let doc : EditableDocument := ⟨meta, AsyncList.delayed cmdSnaps, cancelTk⟩
     return (ctx,
@@ -288,9 +392,10 @@ section Updates
       let changePos := oldDoc.meta.text.source.firstDiffPos newMeta.text.source
       -- Ignore exceptions, we are only interested in the successful snapshots
       let (cmdSnaps, _) ← oldDoc.cmdSnaps.getFinishedPrefix
-      -- NOTE(WN): we invalidate eagerly as `endPos` consumes input greedily. To re-elaborate only
-      -- when really necessary, we could do a whitespace-aware `Syntax` comparison instead.
-      let mut validSnaps := cmdSnaps.takeWhile (fun s => s.endPos < changePos)
+      -- A command is unaffected by a change after its last token, even if the change is in the whitespace
+      -- and comments consumed by it; e.g., starting a new command after a long proof should not
+      -- re-elaborate the proof. The reparse below checks that the command's syntax is still the same.
+      let mut validSnaps := cmdSnaps.takeWhile (fun s => s.stx.getTailPos?.getD s.endPos < changePos)
       if validSnaps.length ≤ 1 then
         validSnaps := [newHeaderSnap]
       else
@@ -303,9 +408,12 @@ section Updates
         let preLastSnap := if validSnaps.length ≥ 2
           then validSnaps.get! (validSnaps.length - 2)
           else newHeaderSnap
-        let newLastStx ← parseNextCmd newMeta.mkInputContext preLastSnap
+        let (newLastStx, newLastMpState) ← parseNextCmdWithState newMeta.mkInputContext preLastSnap
         if newLastStx != lastSnap.stx then
           validSnaps := validSnaps.dropLast
+        else
+          -- the whitespace consumed by the command may have changed, so continue from the new parser state
+          validSnaps := validSnaps.dropLast ++ [{ lastSnap with stx := newLastStx, mpState := newLastMpState }]
       unfoldCmdSnaps newMeta validSnaps.toArray cancelTk ctx
     modify fun st => { st with doc := ⟨newMeta, AsyncList.delayed newSnaps, cancelTk⟩ }
 end Updates
@@ -338,15 +446,17 @@ def handleRpcRelease (p : Lsp.RpcReleaseParams) : WorkerM Unit := do
       for ref in p.refs do
         discard do rpcReleaseRef ref
     seshRef.modify fun st =>
-      let st := st.keptAlive monoMsNow
-      let ((), objects) := discardRefs st.objects
+      -- take the object store out of the session so that it is updated in place
+      let objects := st.objects
+      let st := { st.keptAlive monoMsNow with objects := {} }
+      let ((), objects) := discardRefs objects
       { st with objects }
 
 def handleRpcKeepAlive (p : Lsp.RpcKeepAliveParams) : WorkerM Unit := do
-  match (← get).rpcSessions.find? p.sessionId with
-  | none => return
-  | some seshRef =>
-    seshRef.modify (·.keptAlive (← IO.monoMsNow))
+  let monoMsNow ← IO.monoMsNow
+  for sessionId in #[p.sessionId] ++ p.sessionIds?.getD #[] do
+    if let some seshRef := (← get).rpcSessions.find? sessionId then
+      seshRef.modify (·.keptAlive monoMsNow)
 
 end NotificationHandling
 
@@ -461,7 +571,18 @@ end MainLoop
 def initAndRunWorker (i o e : FS.Stream) (opts : Options) : IO UInt32 := do
   let i ← maybeTee "fwIn.txt" false i
   let o ← maybeTee "fwOut.txt" true o
-  let initParams ← i.readLspRequestAs "initialize" InitializeParams
+  -- workers started in advance by the watchdog first receive the header to import
+  let (preImported?, msg) ← match (← i.readLspMessage) with
+    | .notification "$/lean/preImport" (some params) =>
+      let p ← IO.ofExcept <| fromJson? (α := LeanPreImportParams) (toJson params)
+      pure (some (← preImport p opts), ← i.readLspMessage)
+    | msg => pure (none, msg)
+  -- unused workers of the pool are terminated before `initialize`
+  if let .notification "exit" _ := msg then
+    return 0
+  let .request _ "initialize" (some params) := msg
+    | throwServerError s!"Expected `initialize` request, got {(toJson msg).compress}"
+  let initParams : InitializeParams ← IO.ofExcept <| fromJson? (toJson params)
   let ⟨_, param⟩ ← i.readLspNotificationAs "textDocument/didOpen" DidOpenTextDocumentParams
   let doc := param.textDocument
   /- NOTE(WN): `toFileMap` marks line beginnings as immediately following
@@ -473,7 +594,7 @@ def initAndRunWorker (i o e : FS.Stream) (opts : Options) : IO UInt32 := do
   let e := e.withPrefix s!"[{param.textDocument.uri}] "
   let _ ← IO.setStderr e
   try
-    let (ctx, st) ← initializeWorker meta i o e initParams.param opts
+    let (ctx, st) ← initializeWorker meta i o e initParams opts preImported?
     let _ ← StateRefT'.run (s := st) <| ReaderT.run (r := ctx) mainLoop
     return (0 : UInt32)
   catch e =>
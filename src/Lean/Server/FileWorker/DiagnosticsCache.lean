@@ -0,0 +1,85 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Environment
+import Lean.Util.Path
+import Lean.Data.Lsp.Diagnostics
+
+/-!
+Persistence of the final diagnostics of a file across file worker sessions.
+
+When the environment variable `LEAN_SERVER_CACHE_DIR` is set, the file worker writes the diagnostics of a file to a
+file in that directory whenever it has finished elaborating the file. When the file is opened again, e.g. after
+restarting the file or the server, and neither the file nor the `.olean` files of its imports have changed, the
+diagnostics of the commands that have not been elaborated yet are taken from the cache, so that they are shown right
+away instead of appearing one command at a time.
+
+Like `.olean` files, the cache is written with `saveModuleData`. It only contains plain `Lsp.Diagnostic`s: the
+environment, info trees, and interactive messages of the snapshots cannot be compacted, as they contain closures, so
+the file is still elaborated to answer requests.
+-/
+
+namespace Lean.Server.FileWorker.DiagnosticsCache
+open Lsp
+
+structure Entry where
+  /-- The hash of the file contents, options, and imports the diagnostics were produced with. -/
+  key         : UInt64
+  diagnostics : Array Diagnostic
+  deriving Inhabited
+
+/-- The file the diagnostics of `uri` are cached in, or `none` if `LEAN_SERVER_CACHE_DIR` is not set. -/
+def cacheFile? (uri : DocumentUri) : IO (Option System.FilePath) := do
+  let some dir ← IO.getEnv "LEAN_SERVER_CACHE_DIR" | return none
+  return some <| System.FilePath.mk dir / s!"{hash uri}.diags"
+
+/--
+The key of the diagnostics of `text` elaborated with `opts` in an environment importing `modNames`. The `.olean`
+files of the imports are identified by their modification time and size instead of their contents, as hashing them
+would take longer than elaborating most files.
+-/
+def computeKey (text : String) (opts : Options) (modNames : Array Name) : IO UInt64 := do
+  let mut h := mixHash (hash text) (hash (toString opts))
+  for mod in modNames do
+    h := mixHash h (hash mod)
+    try
+      let md ← (← findOLean mod).metadata
+      h := mixHash h (mixHash (hash md.modified.sec) (mixHash (hash md.modified.nsec) (hash md.byteSize)))
+    catch _ =>
+      pure ()
+  return h
+
+private unsafe def loadUnsafe (fileName : System.FilePath) (key : UInt64) : IO (Option (Array Diagnostic)) := do
+  unless (← fileName.pathExists) do
+    return none
+  try
+    -- The region is never freed, it is read at most once per file worker.
+    let (mod, _) ← readModuleData fileName
+    let some (_, #[e]) := mod.entries[0]? | return none
+    let e : Entry := unsafeCast e
+    return if e.key == key then some e.diagnostics else none
+  catch _ =>
+    -- an unreadable cache, e.g. of another version of Lean, is ignored
+    return none
+
+/-- The diagnostics cached in `fileName` if they have the key `key`. -/
+@[implemented_by loadUnsafe]
+opaque load (fileName : System.FilePath) (key : UInt64) : IO (Option (Array Diagnostic))
+
+private unsafe def saveUnsafe (fileName : System.FilePath) (entry : Entry) : IO Unit := do
+  if let some dir := fileName.parent then
+    IO.FS.createDirAll dir
+  saveModuleData fileName `_diagnosticsCache {
+    imports         := #[]
+    constants       := #[]
+    extraConstNames := #[]
+    entries         := #[(`diagnosticsCache, #[unsafeCast entry])]
+    constNames      := #[]
+  }
+
+/-- Write `entry` to `fileName`. -/
+@[implemented_by saveUnsafe]
+opaque save (fileName : System.FilePath) (entry : Entry) : IO Unit
+
+end Lean.Server.FileWorker.DiagnosticsCache
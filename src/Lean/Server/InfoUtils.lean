@@ -124,6 +124,65 @@ def Info.occursInside? (i : Info) (hoverPos : String.Pos) : Option String.Pos :=
   guard (headPos ≤ hoverPos && hoverPos < tailPos)
   return hoverPos - headPos
 
+/--
+  A node of an `InfoIndex`: an info tree node together with its innermost surrounding context and
+  the smallest range containing all nodes of its subtree that have position information, extended by
+  their trailing whitespace (or at least one character). -/
+inductive InfoIndex.Node where
+  | mk (ctx : ContextInfo) (info : Info) (children : PersistentArray InfoTree) (span : String.Range)
+      (subnodes : Array InfoIndex.Node)
+
+/--
+  An `InfoTree` in which every subtree is annotated with the range it covers, so that position queries
+  only visit the subtrees that may contain results for that position instead of the whole tree.
+  Subtrees without any position information are dropped since they cannot match a position. -/
+structure InfoIndex where
+  roots : Array InfoIndex.Node := #[]
+  deriving Inhabited
+
+namespace InfoIndex
+
+private def ownSpan? (i : Info) : Option String.Range := do
+  let pos ← i.pos?
+  let tailPos ← i.tailPos?
+  return ⟨pos, ⟨tailPos.byteIdx + max 1 i.stx.getTrailingSize⟩⟩
+
+private def mergeSpan : Option String.Range → String.Range → String.Range
+  | none,   r => r
+  | some r, r' => ⟨if r.start ≤ r'.start then r.start else r'.start, if r.stop ≥ r'.stop then r.stop else r'.stop⟩
+
+partial def ofTrees (ts : Array InfoTree) : InfoIndex :=
+  { roots := ts.filterMap (go none) }
+where go
+  | _, .context ctx t => go ctx t
+  | some ctx, .node i cs =>
+    let subnodes := cs.foldl (init := #[]) fun ns c =>
+      match go (i.updateContext? ctx) c with
+      | some n => ns.push n
+      | none   => ns
+    let span? := subnodes.foldl (init := ownSpan? i) fun span? (.mk _ _ _ span _) => some (mergeSpan span? span)
+    span?.map (.mk ctx i cs · subnodes)
+  | _, _ => none
+
+def ofTree (t : InfoTree) : InfoIndex :=
+  ofTrees #[t]
+
+/--
+  `InfoTree.collectNodesBottomUp` restricted to the subtrees whose span contains `pos`. This gives the
+  same result as long as `p` returns the union of nested results for nodes that do not contain `pos`
+  (including their trailing whitespace). -/
+partial def collectNodesBottomUpAt (idx : InfoIndex) (pos : String.Pos)
+    (p : ContextInfo → Info → PersistentArray InfoTree → List α → List α) : List α :=
+  idx.roots.toList.bind go
+where go
+  | .mk ctx i cs span ns =>
+    if span.contains pos (includeStop := true) then
+      p ctx i cs (ns.toList.bind go)
+    else
+      []
+
+end InfoIndex
+
 def InfoTree.smallestInfo? (p : Info → Bool) (t : InfoTree) : Option (ContextInfo × Info) :=
   let ts := t.deepestNodes fun ctx i _ => if p i then some (ctx, i) else none
 
@@ -134,9 +193,9 @@ def InfoTree.smallestInfo? (p : Info → Bool) (t : InfoTree) : Option (ContextI
   infos.toArray.getMax? (fun a b => a.1 > b.1) |>.map fun (_, ci, i) => (ci, i)
 
 /-- Find an info node, if any, which should be shown on hover/cursor at position `hoverPos`. -/
-partial def InfoTree.hoverableInfoAt? (t : InfoTree) (hoverPos : String.Pos) (includeStop := false) (omitAppFns := false) : Option (ContextInfo × Info) := Id.run do
-  let results := t.visitM (m := Id) (postNode := fun ctx info _ results => do
-    let mut results := results.bind (·.getD [])
+def InfoIndex.hoverableInfoAt? (idx : InfoIndex) (hoverPos : String.Pos) (includeStop := false) (omitAppFns := false) : Option (ContextInfo × Info) := Id.run do
+  let results := idx.collectNodesBottomUpAt hoverPos fun ctx info _ results => Id.run do
+    let mut results := results
     if omitAppFns && info.stx.isOfKind ``Parser.Term.app && info.stx[0].isIdent then
       results := results.filter (·.2.2.stx != info.stx[0])
     unless results.isEmpty do
@@ -156,7 +215,7 @@ partial def InfoTree.hoverableInfoAt? (t : InfoTree) (hoverPos : String.Pos) (in
       else if info matches .ofTermInfo { expr := .fvar .., .. } then
         0  -- prefer results for constants over variables (which overlap at declaration names)
       else 1
-    [(priority, ctx, info)]) |>.getD []
+    [(priority, ctx, info)]
   let maxPrio? := results.map (·.1) |>.maximum?
   let res? := results.find? (·.1 == maxPrio?) |>.map (·.2)
   if let some (_, i) := res? then
@@ -165,6 +224,10 @@ partial def InfoTree.hoverableInfoAt? (t : InfoTree) (hoverPos : String.Pos) (in
         return none
   return res?
 
+/-- Find an info node, if any, which should be shown on hover/cursor at position `hoverPos`. -/
+def InfoTree.hoverableInfoAt? (t : InfoTree) (hoverPos : String.Pos) (includeStop := false) (omitAppFns := false) : Option (ContextInfo × Info) :=
+  (InfoIndex.ofTree t).hoverableInfoAt? hoverPos includeStop omitAppFns
+
 def Info.type? (i : Info) : MetaM (Option Expr) :=
   match i with
   | Info.ofTermInfo ti => Meta.inferType ti.expr
@@ -267,8 +330,8 @@ structure GoalsAtResult where
   - the hover position is after the info's start position *and*
   - there is no nested tactic info after the hover position (tactic combinators should decide for themselves
     where to show intermediate states by calling `withTacticInfoContext`) -/
-partial def InfoTree.goalsAt? (text : FileMap) (t : InfoTree) (hoverPos : String.Pos) : List GoalsAtResult :=
-  let gs := t.collectNodesBottomUp fun ctx i cs gs => Id.run do
+partial def InfoIndex.goalsAt? (text : FileMap) (idx : InfoIndex) (hoverPos : String.Pos) : List GoalsAtResult :=
+  let gs := idx.collectNodesBottomUpAt hoverPos fun ctx i cs gs => Id.run do
     if let Info.ofTacticInfo ti := i then
       if let (some pos, some tailPos) := (i.pos?, i.tailPos?) then
         let trailSize := i.stx.getTrailingSize
@@ -306,9 +369,16 @@ where
       cs.any (hasNestedTactic pos tailPos)
     | _ => false
 
-partial def InfoTree.termGoalAt? (t : InfoTree) (hoverPos : String.Pos) : Option (ContextInfo × Info) :=
+/-- See `InfoIndex.goalsAt?`. -/
+def InfoTree.goalsAt? (text : FileMap) (t : InfoTree) (hoverPos : String.Pos) : List GoalsAtResult :=
+  (InfoIndex.ofTree t).goalsAt? text hoverPos
+
+def InfoIndex.termGoalAt? (idx : InfoIndex) (hoverPos : String.Pos) : Option (ContextInfo × Info) :=
   -- In the case `f a b`, where `f` is an identifier, the term goal at `f` should be the goal for the full application `f a b`.
-  hoverableInfoAt? t hoverPos (includeStop := true) (omitAppFns := true)
+  idx.hoverableInfoAt? hoverPos (includeStop := true) (omitAppFns := true)
+
+def InfoTree.termGoalAt? (t : InfoTree) (hoverPos : String.Pos) : Option (ContextInfo × Info) :=
+  (InfoIndex.ofTree t).termGoalAt? hoverPos
 
 partial def InfoTree.hasSorry : InfoTree → IO Bool :=
   go none
@@ -6,6 +6,7 @@ Authors: Joscha Mennicken
 -/
 import Lean.Data.Lsp.Internal
 import Lean.Server.Utils
+import Lean.Data.FuzzyMatching
 
 /-! # Representing collected and deduplicated definitions and usages -/
 
@@ -227,44 +228,71 @@ def findModuleRefs (text : FileMap) (trees : Array InfoTree) (localVars : Bool :
 
 /-! # Collecting and maintaining reference info from different sources -/
 
+/-- A constant defined in a module. -/
+structure Definition where
+  name     : Name
+  /-- `FuzzyMatching.charMask` of `name.toString` -/
+  charMask : UInt64
+  range    : Lsp.Range
+
+def Definition.ofModuleRefs (refs : Lsp.ModuleRefs) : Array Definition :=
+  refs.fold (init := #[]) fun defs ident info =>
+    if let (RefIdent.const name, some range) := (ident, info.definition) then
+      defs.push { name, charMask := FuzzyMatching.charMask name.toString, range }
+    else
+      defs
+
 structure References where
   /-- References loaded from ilean files -/
   ileans : HashMap Name (System.FilePath × Lsp.ModuleRefs)
   /-- References from workers, overriding the corresponding ilean files -/
   workers : HashMap Name (Nat × Lsp.ModuleRefs)
+  /-- Constants defined in each module according to `ileans` and `workers`, computed on first use
+  after the references of the module change. -/
+  definitions : HashMap Name (Thunk (Array Definition))
 
 namespace References
 
-def empty : References := { ileans := HashMap.empty, workers := HashMap.empty }
+def empty : References := { ileans := HashMap.empty, workers := HashMap.empty, definitions := HashMap.empty }
+
+/-- Update `definitions` after the references of `module` have changed. -/
+private def updateDefinitions (self : References) (module : Name) : References :=
+  let refs? := match self.workers.find? module with
+    | some (_, refs) => some refs
+    | none           => self.ileans.find? module |>.map (·.2)
+  match refs? with
+  | some refs => { self with definitions := self.definitions.insert module (.mk fun _ => Definition.ofModuleRefs refs) }
+  | none      => { self with definitions := self.definitions.erase module }
 
 def addIlean (self : References) (path : System.FilePath) (ilean : Ilean) : References :=
   { self with ileans := self.ileans.insert ilean.module (path, ilean.references) }
+    |>.updateDefinitions ilean.module
 
 def removeIlean (self : References) (path : System.FilePath) : References :=
   let namesToRemove := self.ileans.toList.filter (fun (_, p, _) => p == path)
     |>.map (fun (n, _, _) => n)
   namesToRemove.foldl (init := self) fun self name =>
-    { self with ileans := self.ileans.erase name }
+    { self with ileans := self.ileans.erase name } |>.updateDefinitions name
 
 def updateWorkerRefs (self : References) (name : Name) (version : Nat) (refs : Lsp.ModuleRefs) : References := Id.run do
   if let some (currVersion, _) := self.workers.find? name then
     if version > currVersion then
-      return { self with workers := self.workers.insert name (version, refs) }
+      return { self with workers := self.workers.insert name (version, refs) } |>.updateDefinitions name
     if version == currVersion then
       let current := self.workers.findD name (version, HashMap.empty)
       let merged := refs.fold (init := current.snd) fun m ident info =>
         m.findD ident Lsp.RefInfo.empty |>.merge info |> m.insert ident
-      return { self with workers := self.workers.insert name (version, merged) }
+      return { self with workers := self.workers.insert name (version, merged) } |>.updateDefinitions name
   return self
 
 def finalizeWorkerRefs (self : References) (name : Name) (version : Nat) (refs : Lsp.ModuleRefs) : References := Id.run do
   if let some (currVersion, _) := self.workers.find? name then
     if version < currVersion then
       return self
-  return { self with workers := self.workers.insert name (version, refs) }
+  return { self with workers := self.workers.insert name (version, refs) } |>.updateDefinitions name
 
 def removeWorkerRefs (self : References) (name : Name) : References :=
-  { self with workers := self.workers.erase name }
+  { self with workers := self.workers.erase name } |>.updateDefinitions name
 
 def allRefs (self : References) : HashMap Name Lsp.ModuleRefs :=
   let ileanRefs := self.ileans.toList.foldl (init := HashMap.empty) fun m (name, _, refs) => m.insert name refs
@@ -308,19 +336,24 @@ def definitionOf? (self : References) (ident : RefIdent) (srcSearchPath : Search
           return some ⟨uri, definition⟩
   return none
 
+/--
+  Return the definitions of all constants for which `filter` returns `some _`. Only constants whose
+  `FuzzyMatching.charMask` of the name contains `charMask` are passed to `filter`. -/
 def definitionsMatching (self : References) (srcSearchPath : SearchPath) (filter : Name → Option α)
-    (maxAmount? : Option Nat := none) : IO $ Array (α × Location) := do
+    (maxAmount? : Option Nat := none) (charMask : UInt64 := 0) : IO $ Array (α × Location) := do
   let mut result := #[]
-  for (module, refs) in self.allRefs.toList do
+  for (module, defs) in self.definitions.toList do
+    let found := defs.get.filterMap fun d =>
+      if d.charMask &&& charMask == charMask then (filter d.name).map (·, d.range) else none
+    if found.isEmpty then
+      continue
     if let some path ← srcSearchPath.findModuleWithExt "lean" module then
       let uri := System.Uri.pathToUri <| ← IO.FS.realPath path
-      for (ident, info) in refs.toList do
-        if let (RefIdent.const name, some definition) := (ident, info.definition) then
-          if let some a := filter name then
-            result := result.push (a, ⟨uri, definition⟩)
-            if let some maxAmount := maxAmount? then
-              if result.size >= maxAmount then
-                return result
+      for (a, definition) in found do
+        result := result.push (a, ⟨uri, definition⟩)
+        if let some maxAmount := maxAmount? then
+          if result.size >= maxAmount then
+            return result
   return result
 
 end References
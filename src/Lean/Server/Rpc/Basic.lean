@@ -22,7 +22,7 @@ structure RpcRef where
   /- NOTE(WN): It is important for this to be a single-field structure
   in order to deserialize as an `Object` on the JS side. -/
   p : USize
-  deriving BEq, Hashable, FromJson, ToJson
+  deriving Inhabited, BEq, Hashable, FromJson, ToJson
 
 instance : ToString RpcRef where
   toString r := toString r.p
@@ -31,36 +31,84 @@ end Lean.Lsp
 
 namespace Lean.Server
 
+/-- A slot of `RpcObjectStore`. -/
+structure RpcObjectStore.Slot where
+  /-- Incremented whenever the object in the slot is released, so that outdated references to the
+  slot are not valid anymore. -/
+  generation : USize := 0
+  obj?       : Option Dynamic := none
+  deriving Inhabited
+
 structure RpcObjectStore : Type where
-  /-- Objects that are being kept alive for the RPC client, together with their type names,
-  mapped to by their RPC reference.
+  /-- Objects that are being kept alive for the RPC client, together with their type names. An
+  `RpcRef` consists of the index of its slot and the generation of the slot, see
+  `RpcObjectStore.mkRef`. Slots of released objects are reused.
 
   Note that we may currently have multiple references to the same object. It is only disposed
   of once all of those are gone. This simplifies the client a bit as it can drop every reference
   received separately. -/
-  aliveRefs : PersistentHashMap Lsp.RpcRef Dynamic := {}
-  /-- Value to use for the next `RpcRef`. It is monotonically increasing to avoid any possible
-  bugs resulting from its reuse. -/
-  nextRef   : USize := 0
-
-def rpcStoreRef (any : Dynamic) : StateM RpcObjectStore Lsp.RpcRef := do
-  let st ← get
-  set { st with
-    aliveRefs := st.aliveRefs.insert ⟨st.nextRef⟩ any
-    nextRef := st.nextRef + 1
-  }
-  return ⟨st.nextRef⟩
-
-def rpcGetRef (r : Lsp.RpcRef) : ReaderT RpcObjectStore Id (Option Dynamic) :=
-  return (← read).aliveRefs.find? r
-
-def rpcReleaseRef (r : Lsp.RpcRef) : StateM RpcObjectStore Bool := do
-  let st ← get
-  if st.aliveRefs.contains r then
-    set { st with aliveRefs := st.aliveRefs.erase r }
-    return true
+  slots     : Array RpcObjectStore.Slot := #[]
+  /-- Indices of the empty slots. -/
+  freeSlots : Array Nat := #[]
+
+namespace RpcObjectStore
+
+/-- Number of bits of an `RpcRef` used for the index of its slot. -/
+def indexBits : USize :=
+  if System.Platform.numBits == 64 then 32 else 20
+
+/-- Number of bits of an `RpcRef` used for the generation of its slot. References are sent as JSON
+numbers, which JavaScript clients represent exactly only below `2^53`. -/
+def generationBits : USize :=
+  if System.Platform.numBits == 64 then 53 - indexBits else 32 - indexBits
+
+/-- The maximal number of slots. -/
+def maxSlots : Nat :=
+  1 <<< indexBits.toNat
+
+def mkRef (idx : Nat) (generation : USize) : Lsp.RpcRef :=
+  if idx < maxSlots then
+    ⟨(generation <<< indexBits) ||| idx.toUSize⟩
   else
-    return false
+    panic! s!"too many RPC references, at most {maxSlots} objects can be stored"
+
+/-- The index of the slot of `r` if it refers to a live object. -/
+def findSlot? (st : RpcObjectStore) (r : Lsp.RpcRef) : Option Nat :=
+  let idx := (r.p &&& ((1 <<< indexBits) - 1)).toNat
+  match st.slots[idx]? with
+  | some slot =>
+    if slot.obj?.isSome && mkRef idx slot.generation == r then some idx else none
+  | none => none
+
+end RpcObjectStore
+
+/-- Store `any` in a free slot. The store is updated with `modifyGet` so that the slots are not
+shared and updated in place. -/
+def rpcStoreRef (any : Dynamic) : StateM RpcObjectStore Lsp.RpcRef :=
+  modifyGet fun st =>
+    if let some idx := st.freeSlots.back? then
+      let generation := st.slots[idx]!.generation
+      (RpcObjectStore.mkRef idx generation, { st with
+        slots     := st.slots.set! idx { generation, obj? := some any }
+        freeSlots := st.freeSlots.pop })
+    else
+      (RpcObjectStore.mkRef st.slots.size 0, { st with slots := st.slots.push { obj? := some any } })
+
+def rpcGetRef (r : Lsp.RpcRef) : ReaderT RpcObjectStore Id (Option Dynamic) := do
+  let st ← read
+  return st.findSlot? r >>= fun idx => st.slots[idx]!.obj?
+
+def rpcReleaseRef (r : Lsp.RpcRef) : StateM RpcObjectStore Bool :=
+  modifyGet fun st =>
+    if let some idx := st.findSlot? r then
+      let generation := st.slots[idx]!.generation + 1
+      -- the slot is retired once its references would not be exact JSON numbers anymore
+      let reuse := generation < (1 <<< RpcObjectStore.generationBits)
+      (true, { st with
+        slots     := st.slots.set! idx { generation }
+        freeSlots := if reuse then st.freeSlots.push idx else st.freeSlots })
+    else
+      (false, st)
 
 /--
 `RpcEncodable α` means that `α` can be serialized in the RPC system of the Lean server.
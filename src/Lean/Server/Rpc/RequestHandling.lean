@@ -87,7 +87,10 @@ def wrapRpcProcedure (method : Name) paramType respType
       | Except.error e => throw e
       | Except.ok ret =>
         seshRef.modifyGet fun st =>
-          rpcEncode ret st.objects |>.map id ({st with objects := ·})⟩
+          -- take the object store out of the session so that it is updated in place
+          let objects := st.objects
+          let st := { st with objects := {} }
+          rpcEncode ret objects |>.map id ({st with objects := ·})⟩
 
 def registerBuiltinRpcProcedure (method : Name) paramType respType
     [RpcEncodable paramType] [RpcEncodable respType]
@@ -10,6 +10,7 @@ import Lean.Elab.Import
 import Lean.Elab.Command
 
 import Lean.Widget.InteractiveDiagnostic
+import Lean.Server.InfoUtils
 
 /-! One can think of this module as being a partial reimplementation
 of Lean.Elab.Frontend which also stores a snapshot of the world after
@@ -37,7 +38,12 @@ structure Snapshot where
   from previous snapshots when publishing diagnostics for every new snapshot (this is quadratic),
   as well as not to invoke it once again when handling `$/lean/interactiveDiagnostics`. -/
   interactiveDiags : PersistentArray Widget.InteractiveDiagnostic
+  /-- The diagnostics of `interactiveDiags` serialized to LSP JSON, see `Snapshot.diagnosticJson`. They are cached
+  so that the diagnostics of previous snapshots are not converted and serialized again after every command. -/
+  diagnosticsJson : PersistentArray String := {}
   tacticCache : IO.Ref Tactic.Cache
+  /-- Index of the info trees for position queries such as hovers and goals, built on first use. -/
+  infoIndex : Thunk InfoIndex := .mk fun _ => InfoIndex.ofTrees cmdState.infoState.trees
 
 instance : Inhabited Snapshot where
   default := {
@@ -63,6 +69,10 @@ def msgLog (s : Snapshot) : MessageLog :=
 def diagnostics (s : Snapshot) : PersistentArray Lsp.Diagnostic :=
   s.interactiveDiags.map fun d => d.toDiagnostic
 
+/-- The compressed JSON of `d` as an LSP diagnostic, as cached in `Snapshot.diagnosticsJson`. -/
+def diagnosticJson (d : Widget.InteractiveDiagnostic) : String :=
+  (toJson d.toDiagnostic).compress
+
 def infoTree (s : Snapshot) : InfoTree :=
   -- the parser returns exactly one command per snapshot, and the elaborator creates exactly one node per command
   assert! s.cmdState.infoState.trees.size == 1
@@ -93,14 +103,19 @@ def runTermElabM (snap : Snapshot) (meta : DocumentMeta) (c : TermElabM α) : EI
 end Snapshot
 
 /-- Parses the next command occurring after the given snapshot
-without elaborating it. -/
-def parseNextCmd (inputCtx : Parser.InputContext) (snap : Snapshot) : IO Syntax := do
+without elaborating it, also returning the parser state after it. -/
+def parseNextCmdWithState (inputCtx : Parser.InputContext) (snap : Snapshot) : IO (Syntax × Parser.ModuleParserState) := do
   let cmdState := snap.cmdState
   let scope := cmdState.scopes.head!
   let pmctx := { env := cmdState.env, options := scope.opts, currNamespace := scope.currNamespace, openDecls := scope.openDecls }
-  let (cmdStx, _, _) :=
+  let (cmdStx, mpState, _) :=
     Parser.parseCommand inputCtx pmctx snap.mpState snap.msgLog
-  return cmdStx
+  return (cmdStx, mpState)
+
+/-- Parses the next command occurring after the given snapshot
+without elaborating it. -/
+def parseNextCmd (inputCtx : Parser.InputContext) (snap : Snapshot) : IO Syntax :=
+  return (← parseNextCmdWithState inputCtx snap).1
 
 register_builtin_option server.stderrAsMessages : Bool := {
   defValue := true
@@ -121,12 +136,17 @@ def compileNextCmd (inputCtx : Parser.InputContext) (snap : Snapshot) (hasWidget
     Parser.parseCommand inputCtx pmctx snap.mpState snap.msgLog
   let cmdPos := cmdStx.getPos?.get!
   if Parser.isEOI cmdStx then
+    let (cmdState, lintLog) ← cmdState.waitAsyncLinters
+    let (env, asyncLog) ← cmdState.env.waitAsyncKernelChecks scope.opts
+    let msgLog := msgLog ++ lintLog ++ asyncLog
+    let (interactiveDiags, diagnosticsJson) ← withNewInteractiveDiags msgLog
     let endSnap : Snapshot := {
       beginPos := cmdPos
       stx := cmdStx
       mpState := cmdParserState
-      cmdState := snap.cmdState
-      interactiveDiags := ← withNewInteractiveDiags msgLog
+      cmdState := { cmdState with env }
+      interactiveDiags
+      diagnosticsJson
       tacticCache := snap.tacticCache
     }
     return endSnap
@@ -159,12 +179,14 @@ def compileNextCmd (inputCtx : Parser.InputContext) (snap : Snapshot) (hasWidget
           data     := output
         }
       }
+    let (interactiveDiags, diagnosticsJson) ← withNewInteractiveDiags postCmdState.messages
     let postCmdSnap : Snapshot := {
       beginPos := cmdPos
       stx := cmdStx
       mpState := cmdParserState
       cmdState := postCmdState
-      interactiveDiags := ← withNewInteractiveDiags postCmdState.messages
+      interactiveDiags
+      diagnosticsJson
       tacticCache := (← IO.mkRef {})
     }
     return postCmdSnap
@@ -172,13 +194,17 @@ def compileNextCmd (inputCtx : Parser.InputContext) (snap : Snapshot) (hasWidget
 where
   /-- Compute the current interactive diagnostics log by finding a "diff" relative to the parent
   snapshot. We need to do this because unlike the `MessageLog` itself, interactive diags are not
-  part of the command state. -/
-  withNewInteractiveDiags (msgLog : MessageLog) : IO (PersistentArray Widget.InteractiveDiagnostic) := do
+  part of the command state. Only the new messages are converted to LSP JSON. -/
+  withNewInteractiveDiags (msgLog : MessageLog) :
+      IO (PersistentArray Widget.InteractiveDiagnostic × PersistentArray String) := do
     let newMsgCount := msgLog.msgs.size - snap.msgLog.msgs.size
     let mut ret := snap.interactiveDiags
+    let mut json := snap.diagnosticsJson
     for i in List.iota newMsgCount do
       let newMsg := msgLog.msgs.get! (msgLog.msgs.size - i)
-      ret := ret.push (← Widget.msgToInteractiveDiagnostic inputCtx.fileMap newMsg hasWidgets)
-    return ret
+      let diag ← Widget.msgToInteractiveDiagnostic inputCtx.fileMap newMsg hasWidgets
+      ret := ret.push diag
+      json := json.push (Snapshot.diagnosticJson diag)
+    return (ret, json)
 
 end Lean.Server.Snapshots
@@ -122,6 +122,17 @@ def publishDiagnostics (m : DocumentMeta) (diagnostics : Array Lsp.Diagnostic) (
     }
   }
 
+/--
+Like `publishDiagnostics`, but for diagnostics that have already been serialized with `toJson` and `Json.compress`.
+The file worker publishes all diagnostics of the file after every command, so it serializes each of them only once.
+-/
+def publishDiagnosticsJson (m : DocumentMeta) (diagnostics : Array String) (hOut : FS.Stream) : IO Unit :=
+  -- the same as the output of `Json.compress`, which orders the fields by name
+  hOut.writeLspMessageJson <|
+    "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"diagnostics\":[" ++
+    ",".intercalate diagnostics.toList ++ "],\"uri\":" ++ (toJson m.uri).compress ++
+    ",\"version\":" ++ toString m.version ++ "}}"
+
 def publishProgress (m : DocumentMeta) (processing : Array LeanFileProgressProcessingInfo) (hOut : FS.Stream) : IO Unit :=
   hOut.writeLspNotification {
     method := "$/lean/fileProgress"
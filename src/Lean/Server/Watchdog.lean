@@ -9,6 +9,7 @@ import Init.Data.ByteArray
 import Lean.Data.RBMap
 
 import Lean.Elab.Import
+import Lean.Syntax.Compact
 import Lean.Util.Paths
 
 import Lean.Data.FuzzyMatching
@@ -55,6 +56,9 @@ Moreover, we don't implement the full protocol at this level:
 - `$/cancelRequest` notifications are forwarded to all file workers.
 - File workers are always terminated with an `exit` notification, without previously receiving a `shutdown` request.
   Similarly, they never receive a `didClose` notification.
+- With `workerPoolSize?` set in the initialization options, the watchdog starts file workers in advance and sends
+  them the header of the most recently opened file in a `$/lean/preImport` notification before `initialize`. A file
+  whose header is the same is assigned one of these workers, which has already imported it.
 
 ## Watchdog <-> client communication
 
@@ -72,7 +76,8 @@ open System.Uri
 section Utils
   structure OpenDocument where
     meta      : DocumentMeta
-    headerAst : Syntax
+    /-- The header of `meta.text`, kept for the lifetime of the document. -/
+    headerAst : CompactSyntax
 
   def workerCfg : Process.StdioConfig := {
     stdin  := Process.Stdio.piped
@@ -131,6 +136,12 @@ section FileWorker
     pendingRequestsRef : IO.Ref PendingRequestMap
     groupedEditsRef    : IO.Ref (Option GroupedEdits)
 
+  /-- A file worker started in advance that is not assigned to a file yet, see `takePooledWorker?`. -/
+  structure PooledWorker where
+    proc      : Process.Child workerCfg
+    /-- The header that the worker imports while it waits. -/
+    headerAst : Syntax
+
   namespace FileWorker
 
   def stdin (fw : FileWorker) : FS.Stream :=
@@ -183,6 +194,8 @@ section ServerM
     workerPath     : System.FilePath
     srcSearchPath  : System.SearchPath
     references     : IO.Ref References
+    workerPoolSize : Nat
+    workerPoolRef  : IO.Ref (Array PooledWorker)
 
   abbrev ServerM := ReaderT ServerContext IO
 
@@ -271,19 +284,60 @@ section ServerM
       | Except.ok ev   => ev
       | Except.error e => WorkerEvent.ioError e
 
+  def terminatePooledWorker (pw : PooledWorker) : IO Unit := do
+    try
+      (FS.Stream.ofHandle pw.proc.stdin).writeLspMessage (Message.notification "exit" none)
+    catch _ =>
+      -- the worker has crashed already
+      return
+
+  /--
+  Take a worker from the pool that imports `headerAst`, if any. Then replace the workers of the pool that import
+  another header with workers importing the header of `m`, as the next opened file is likely to share it.
+  -/
+  def takePooledWorker? (m : DocumentMeta) (headerAst : Syntax) : ServerM (Option (Process.Child workerCfg)) := do
+    let st ← read
+    if st.workerPoolSize == 0 then
+      return none
+    let pool ← st.workerPoolRef.get
+    let (proc?, pool) := match pool.findIdx? (·.headerAst == headerAst) with
+      | some i => (some pool[i]!.proc, pool.eraseIdx i)
+      | none   => (none, pool)
+    let (pool, stale) := pool.partition (·.headerAst == headerAst)
+    for pw in stale do
+      terminatePooledWorker pw
+      -- reap the process without blocking the watchdog while the worker finishes its import and exits
+      discard <| IO.asTask (prio := .dedicated) pw.proc.wait
+    let mut pool := pool
+    while pool.size < st.workerPoolSize do
+      let proc ← Process.spawn {
+        toStdioConfig := workerCfg
+        cmd           := st.workerPath.toString
+        args          := #["--worker"] ++ st.args.toArray
+      }
+      (FS.Stream.ofHandle proc.stdin).writeLspNotification {
+        method := "$/lean/preImport"
+        param  := { uri := m.uri, text := m.text.source : LeanPreImportParams }
+      }
+      pool := pool.push { proc, headerAst }
+    st.workerPoolRef.set pool
+    return proc?
+
   def startFileWorker (m : DocumentMeta) : ServerM Unit := do
     publishProgressAtPos m 0 (← read).hOut
     let st ← read
     let headerAst ← parseHeaderAst m.text.source
-    let workerProc ← Process.spawn {
-      toStdioConfig := workerCfg
-      cmd           := st.workerPath.toString
-      args          := #["--worker"] ++ st.args.toArray ++ #[m.uri]
-    }
+    let workerProc ← match (← takePooledWorker? m headerAst) with
+      | some proc => pure proc
+      | none      => Process.spawn {
+        toStdioConfig := workerCfg
+        cmd           := st.workerPath.toString
+        args          := #["--worker"] ++ st.args.toArray ++ #[m.uri]
+      }
     let pendingRequestsRef ← IO.mkRef (RBMap.empty : PendingRequestMap)
     -- The task will never access itself, so this is fine
     let fw : FileWorker := {
-      doc                := ⟨m, headerAst⟩
+      doc                := ⟨m, headerAst.compact⟩
       proc               := workerProc
       commTask           := Task.pure WorkerEvent.terminated
       state              := WorkerState.running
@@ -403,6 +457,8 @@ def handleWorkspaceSymbol (p : WorkspaceSymbolParams) : ServerM (Array SymbolInf
   let references ← (← read).references.get
   let srcSearchPath := (← read).srcSearchPath
   let symbols ← references.definitionsMatching srcSearchPath (maxAmount? := none)
+    -- the user-facing name of a private constant only contains characters of its full name
+    (charMask := FuzzyMatching.charMask p.query)
     fun name =>
       let name := privateToUserName? name |>.getD name
       if let some score := fuzzyMatchScoreWithThreshold? p.query name.toString then
@@ -442,11 +498,12 @@ section NotificationHandling
     let newDocText := foldDocumentChanges changes oldDoc.meta.text
     let newMeta : DocumentMeta := ⟨doc.uri, newVersion, newDocText⟩
     let newHeaderAst ← parseHeaderAst newDocText.source
-    if newHeaderAst != oldDoc.headerAst then
+    if newHeaderAst != oldDoc.headerAst.expand oldDoc.meta.text.source then
       terminateFileWorker doc.uri
       startFileWorker newMeta
     else
-      let newDoc : OpenDocument := ⟨newMeta, oldDoc.headerAst⟩
+      -- the positions of the header may have changed
+      let newDoc : OpenDocument := ⟨newMeta, newHeaderAst.compact⟩
       updateFileWorkers { fw with doc := newDoc }
       tryWriteMessage doc.uri (Notification.mk "textDocument/didChange" ge.params) (restartCrashedWorker := true)
       for msg in ge.queuedMsgs do
@@ -568,6 +625,11 @@ section MainLoop
       terminateFileWorker uri
     for ⟨_, fw⟩ in fileWorkers do
       discard <| IO.wait fw.commTask
+    let pool ← (←read).workerPoolRef.modifyGet (·, #[])
+    for pw in pool do
+      terminatePooledWorker pw
+    for pw in pool do
+      discard <| pw.proc.wait
 
   inductive ServerEvent where
     | workerEvent (fw : FileWorker) (ev : WorkerEvent)
@@ -722,10 +784,13 @@ def findWorkerPath : IO System.FilePath := do
 
 def loadReferences : IO References := do
   let oleanSearchPath ← Lean.searchPathRef.get
+  let paths ← oleanSearchPath.findAllWithExt "ilean"
+  -- parsing the ilean files dominates the startup time of the server for large projects
+  let tasks ← paths.mapM fun path => IO.asTask (Ilean.load path)
   let mut refs := References.empty
-  for path in ← oleanSearchPath.findAllWithExt "ilean" do
+  for path in paths, task in tasks do
     try
-      refs := refs.addIlean path (← Ilean.load path)
+      refs := refs.addIlean path (← IO.ofExcept task.get)
     catch _ =>
       -- could be a race with the build system, for example
       -- ilean load errors should not be fatal, but we *should* log them
@@ -738,6 +803,7 @@ def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
   let srcSearchPath ← initSrcSearchPath (← getBuildDir)
   let references ← IO.mkRef (← loadReferences)
   let fileWorkersRef ← IO.mkRef (RBMap.empty : FileWorkerMap)
+  let workerPoolRef ← IO.mkRef #[]
   let i ← maybeTee "wdIn.txt" false i
   let o ← maybeTee "wdOut.txt" true o
   let e ← maybeTee "wdErr.txt" true e
@@ -777,6 +843,8 @@ def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
     workerPath
     srcSearchPath
     references
+    workerPoolSize := initRequest.param.initializationOptions? |>.bind InitializationOptions.workerPoolSize? |>.getD 0
+    workerPoolRef
     : ServerContext
   }
 
@@ -72,6 +72,12 @@ def all (pred : Nat → Bool) (p : Pos) : Bool :=
 
 def append : Pos → Pos → Pos := foldl push
 
+/-- If `p` is `q` or a position below `q`, returns the corresponding position below `q'`. -/
+partial def replacePrefix? (q q' : Pos) (p : Pos) : Option Pos :=
+  if p.asNat == q.asNat then some q'
+  else if p.asNat < q.asNat || p.isRoot then none
+  else (replacePrefix? q q' p.tail).map (·.push p.head)
+
 /-- Creates a subexpression `Pos` from an array of 'coordinates'.
 Each coordinate is a number {0,1,2} expressing which child subexpression should be explored.
 The first coordinate in the array corresponds to the root of the expression tree.  -/
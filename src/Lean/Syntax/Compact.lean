@@ -0,0 +1,60 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Syntax
+
+/-!
+A compact representation of syntax trees that are stored for a long time.
+
+The `SourceInfo.original` of every token produced by the parser contains two `Substring`s of the input for its
+leading and trailing whitespace, and every identifier additionally contains a `Substring` of its raw value. In
+`CompactSyntax`, tokens store the boundaries of these substrings as positions into the input instead, which are
+unboxed, and the substrings are reconstructed from the input by `CompactSyntax.expand`. This roughly halves the size
+of the tokens.
+-/
+
+namespace Lean
+
+/-- A syntax tree whose tokens from the input are represented by positions into the input, see `Syntax.compact`. -/
+inductive CompactSyntax where
+  | node (info : SourceInfo) (kind : SyntaxNodeKind) (args : Array CompactSyntax)
+  /-- An atom with the original info `⟨leadStart, pos⟩ pos ⟨endPos, trailStop⟩ endPos`. -/
+  | atom (leadStart pos endPos trailStop : String.Pos) (val : String)
+  /-- An identifier with the original info `⟨leadStart, pos⟩ pos ⟨endPos, trailStop⟩ endPos` and raw value
+  `⟨pos, endPos⟩`. -/
+  | ident (leadStart pos endPos trailStop : String.Pos) (val : Name) (preresolved : List Syntax.Preresolved)
+  /-- Syntax that is not represented more compactly, e.g. tokens with synthetic info. -/
+  | other (stx : Syntax)
+  deriving Inhabited
+
+/--
+Represent the tokens of `stx` that were parsed from an input by positions into the input. Tokens whose whitespace
+substrings do not adjoin their positions, in particular tokens whose info was modified after parsing, are kept as
+they are.
+-/
+partial def Syntax.compact : Syntax → CompactSyntax
+  | .node info kind args => .node info kind (args.map compact)
+  | stx@(.atom (.original leading pos trailing endPos) val) =>
+    if leading.stopPos == pos && trailing.startPos == endPos then
+      .atom leading.startPos pos endPos trailing.stopPos val
+    else
+      .other stx
+  | stx@(.ident (.original leading pos trailing endPos) rawVal val preresolved) =>
+    if leading.stopPos == pos && trailing.startPos == endPos && rawVal.startPos == pos && rawVal.stopPos == endPos then
+      .ident leading.startPos pos endPos trailing.stopPos val preresolved
+    else
+      .other stx
+  | stx => .other stx
+
+/-- Reconstruct the syntax tree that `stx` was created from by `Syntax.compact`, which was parsed from `input`. -/
+partial def CompactSyntax.expand (input : String) : CompactSyntax → Syntax
+  | .node info kind args => .node info kind (args.map (expand input))
+  | .atom leadStart pos endPos trailStop val =>
+    .atom (.original ⟨input, leadStart, pos⟩ pos ⟨input, endPos, trailStop⟩ endPos) val
+  | .ident leadStart pos endPos trailStop val preresolved =>
+    .ident (.original ⟨input, leadStart, pos⟩ pos ⟨input, endPos, trailStop⟩ endPos) ⟨input, pos, endPos⟩ val
+      preresolved
+  | .other stx => stx
+
+end Lean
@@ -9,6 +9,7 @@ paths containing package roots: an import `A.B.C` resolves to
 with a directory `A/`. `import A` resolves to `path/A.olean`.
 -/
 import Lean.Data.Name
+import Lean.Data.HashMap
 
 namespace Lean
 open System
@@ -29,13 +30,29 @@ abbrev SearchPath := System.SearchPath
 
 namespace SearchPath
 
+/--
+Search path entries in which `findWithExt` found the package for an extension and package name, valid for the
+given search path. Cached entries are revalidated with a single check, so all modules of a package after the first
+one are resolved in constant time; the cache does not notice if the package is added to an earlier entry later on. -/
+private builtin_initialize pkgRootCacheRef : IO.Ref (SearchPath × HashMap (String × String) FilePath) ←
+  IO.mkRef ({}, {})
+
 /-- If the package of `mod` can be found in `sp`, return the path with extension
 `ext` (`lean` or `olean`) corresponding to `mod`. Otherwise, return `none`. Does
 not check whether the returned path exists. -/
 def findWithExt (sp : SearchPath) (ext : String) (mod : Name) : IO (Option FilePath) := do
   let pkg := mod.getRoot.toString
-  let root? ← sp.findM? fun p =>
+  let isRoot (p : FilePath) : IO Bool :=
     (p / pkg).isDir <||> ((p / pkg).withExtension ext).pathExists
+  let (cachedSp, cache) ← pkgRootCacheRef.get
+  if cachedSp == sp then
+    if let some root := cache.find? (ext, pkg) then
+      if ← isRoot root then
+        return some (modToFilePath root mod ext)
+  let root? ← sp.findM? isRoot
+  if let some root := root? then
+    pkgRootCacheRef.modify fun (cachedSp, cache) =>
+      (sp, (if cachedSp == sp then cache else {}).insert (ext, pkg) root)
   return root?.map (modToFilePath · mod ext)
 
 /-- Like `findWithExt`, but ensures the returned path exists. -/
@@ -49,7 +66,11 @@ def findAllWithExt (sp : SearchPath) (ext : String) : IO (Array FilePath) := do
   let mut paths := #[]
   for p in sp do
     if (← p.isDir) then
-      paths := paths ++ (← p.walkDir).filter (·.extension == some ext)
+      let found ← IO.mkRef paths
+      p.walkDirBatched (exts := #[ext]) fun entries =>
+        found.modify fun paths => entries.foldl (init := paths) fun paths e =>
+          if e.path.extension == some ext then paths.push e.path else paths
+      paths ← found.get
   return paths
 
 end SearchPath
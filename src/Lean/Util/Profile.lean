@@ -7,10 +7,22 @@ import Lean.Data.Options
 
 namespace Lean
 
-/-- Print and accumulate run time of `act` when option `profiler` is set to `true`. -/
+/--
+Print and accumulate run time of `act` when option `profiler` is set to `true`.
+When option `profiler.json` is set to a file name, the span of `act` is also appended to that file as a
+JSON object with fields `file`, `decl`, `category`, `start`, `end` (in microseconds since the Unix epoch),
+`tid` and `heartbeats`, one per line.
+-/
 @[extern "lean_profileit"]
 def profileit {α : Type} (category : @& String) (opts : @& Options) (fn : Unit → α) : α := fn ()
 
+/--
+Like `profileit`, but the printed message also mentions the declaration `decl` and the number of
+heartbeats used by `fn`.
+-/
+@[extern "lean_profileit_decl"]
+def profileitDecl {α : Type} (category : @& String) (opts : @& Options) (decl : @& Name) (fn : Unit → α) : α := fn ()
+
 unsafe def profileitIOUnsafe {ε α : Type} (category : String) (opts : Options) (act : EIO ε α) : EIO ε α :=
   match profileit category opts fun _ => unsafeEIO act with
   | Except.ok a    => pure a
@@ -23,4 +35,16 @@ def profileitIO {ε α : Type} (category : String) (opts : Options) (act : EIO 
 def profileitM {m : Type → Type} (ε : Type) [MonadFunctorT (EIO ε) m] {α : Type} (category : String) (opts : Options) (act : m α) : m α :=
   monadMap (fun {β} => profileitIO (ε := ε) (α := β) category opts) act
 
+unsafe def profileitDeclIOUnsafe {ε α : Type} (category : String) (opts : Options) (decl : Name) (act : EIO ε α) : EIO ε α :=
+  match profileitDecl category opts decl fun _ => unsafeEIO act with
+  | Except.ok a    => pure a
+  | Except.error e => throw e
+
+@[implemented_by profileitDeclIOUnsafe]
+def profileitDeclIO {ε α : Type} (category : String) (opts : Options) (decl : Name) (act : EIO ε α) : EIO ε α := act
+
+/-- Like `profileitM`, but for `profileitDecl`. -/
+def profileitDeclM {m : Type → Type} (ε : Type) [MonadFunctorT (EIO ε) m] {α : Type} (category : String) (opts : Options) (decl : Name) (act : m α) : m α :=
+  monadMap (fun {β} => profileitDeclIO (ε := ε) (α := β) category opts decl) act
+
 end Lean
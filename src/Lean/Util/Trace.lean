@@ -98,9 +98,34 @@ where
     else
       false
 
+/-- Whether the options object `opts` sets some `trace.*` option. -/
+private structure TraceOptionsCache where
+  opts     : Options := .empty
+  hasTrace : Bool := false
+
+builtin_initialize traceOptionsCacheRef : IO.Ref TraceOptionsCache ← IO.mkRef {}
+
+private unsafe def hasTraceOptionUnsafe (opts : Options) : Bool := unsafeBaseIO do
+  let c ← traceOptionsCacheRef.get
+  if ptrEq c.opts opts then
+    return c.hasTrace
+  let hasTrace := (KVMap.entries opts).any fun (n, _) => (`trace).isPrefixOf n
+  traceOptionsCacheRef.set { opts, hasTrace }
+  return hasTrace
+
+/--
+  Return `true` if `opts` sets some `trace.*` option. The result for the options last queried is cached,
+  so that checking a disabled trace class in hot code, e.g., in `isDefEq` and `whnf`, only costs a pointer
+  comparison as long as the options do not change. -/
+@[implemented_by hasTraceOptionUnsafe]
+private opaque hasTraceOption (opts : Options) : Bool
+
 def isTracingEnabledFor (cls : Name) : m Bool := do
+  let opts ← getOptions
+  if !hasTraceOption opts then
+    return false
   let inherited ← (inheritedTraceOptions.get : IO _)
-  pure (checkTraceOption inherited (← getOptions) cls)
+  pure (checkTraceOption inherited opts cls)
 
 @[inline] def getTraces : m (PersistentArray TraceElem) := do
   let s ← getTraceState
@@ -60,6 +60,8 @@ builtin_initialize widgetSourceRegistry : WidgetSourceRegistry ←
     addImportedFn := fun xss => xss.foldl (Array.foldl (fun s n => s.insert n.1 n.2)) ∅
     addEntryFn    := fun s n => s.insert n.1 n.2
     toArrayFn     := fun es => es.toArray
+    -- only queried by the language server
+    lazyImport    := true
   }
 
 private unsafe def getUserWidgetDefinitionUnsafe
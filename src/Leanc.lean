@@ -12,7 +12,9 @@ as-is to the wrapped compiler.
 
 Interesting options:
 * `--print-cflags`: print C compiler flags necessary for building against the Lean runtime and exit
-* `--print-ldlags`: print C compiler flags necessary for statically linking against the Lean library and exit"
+* `--print-ldlags`: print C compiler flags necessary for statically linking against the Lean library and exit
+* `--lto`: compile with ThinLTO and statically link against the runtime built as LLVM bitcode, so that runtime
+  functions can be inlined into Lean code; requires a Lean built with `-DRUNTIME_LTO=ON` and an LTO-capable linker"
     return 1
 
   let root ← match (← IO.getEnv "LEAN_SYSROOT") with
@@ -22,12 +24,16 @@ Interesting options:
 
   -- let compileOnly := args.contains "-c"
   let linkStatic := !args.contains "-shared"
+  let lto := args.contains "--lto"
+  let args := args.filter (· != "--lto")
 
   -- We assume that the CMake variables do not contain escaped spaces
   let cflags := getCFlags root
   let mut cflagsInternal := "@LEANC_INTERNAL_FLAGS@".trim.splitOn
   let mut ldflagsInternal := "@LEANC_INTERNAL_LINKER_FLAGS@".trim.splitOn
-  let ldflags := getLinkerFlags root linkStatic
+  let mut ldflags := getLinkerFlags root linkStatic
+  if lto then
+    ldflags := ldflags.map fun f => if f == "-lleanrt" then "-lleanrt_lto" else f
 
   for arg in args do
     match arg with
@@ -46,7 +52,8 @@ Interesting options:
     cflagsInternal := []
     ldflagsInternal := []
   cc := rootify cc
-  let args := cflags ++ cflagsInternal ++ args ++ ldflagsInternal ++ ldflags ++ ["-Wno-unused-command-line-argument"]
+  let ltoFlags := if lto then ["-flto=thin"] else []
+  let args := cflags ++ cflagsInternal ++ ltoFlags ++ args ++ ldflagsInternal ++ ldflags ++ ["-Wno-unused-command-line-argument"]
   let args := args.filter (!·.isEmpty) |>.map rootify
   if args.contains "-v" then
     IO.eprintln s!"{cc} {" ".intercalate args.toList}"
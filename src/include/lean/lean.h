@@ -35,10 +35,14 @@ extern "C" {
 #define LEAN_UNLIKELY(x) (__builtin_expect((x), 0))
 #define LEAN_LIKELY(x) (__builtin_expect((x), 1))
 #define LEAN_ALWAYS_INLINE __attribute__((always_inline))
+#define LEAN_HOT __attribute__((hot))
+#define LEAN_COLD __attribute__((cold))
 #else
 #define LEAN_UNLIKELY(x) (x)
 #define LEAN_LIKELY(x) (x)
 #define LEAN_ALWAYS_INLINE
+#define LEAN_HOT
+#define LEAN_COLD
 #endif
 
 #ifndef assert
@@ -148,6 +152,12 @@ typedef lean_object * u_lean_obj_arg; /* Unique (aka non shared) object argument
 typedef lean_object * lean_obj_res;   /* Standard object result. */
 typedef lean_object * b_lean_obj_res; /* Borrowed object result. */
 
+/* Fields of a constructor object returned by a function without allocating the object, see `Lean.IR.UnboxResult`.
+   The fields are owned by the caller. */
+typedef struct { lean_object * m_objs[2]; } lean_obj_tuple2;
+typedef struct { lean_object * m_objs[3]; } lean_obj_tuple3;
+typedef struct { lean_object * m_objs[4]; } lean_obj_tuple4;
+
 typedef struct {
     lean_object   m_header;
     lean_object * m_objs[0];
@@ -418,6 +428,16 @@ static inline _Atomic(int) * lean_get_rc_mt_addr(lean_object* o) {
     return (_Atomic(int)*)(&(o->m_rc));
 }
 
+/*
+The reference counter of multi-threaded objects is updated using atomic operations. When the compiler provides atomic
+builtins, we perform them inline instead of calling into the runtime, which is significant for objects shared by
+many tasks such as environments and expressions. Increments do not need to synchronize with other threads, and
+decrements only need to synchronize with the thread that releases the last reference, see `lean_dec_ref_last`.
+*/
+#if defined(__GNUC__) || defined(__clang__)
+#define LEAN_INLINE_ATOMIC_RC
+#endif
+
 LEAN_SHARED void lean_inc_ref_cold(lean_object * o);
 LEAN_SHARED void lean_inc_ref_n_cold(lean_object * o, unsigned n);
 
@@ -425,7 +445,11 @@ static inline void lean_inc_ref(lean_object * o) {
     if (LEAN_LIKELY(lean_is_st(o))) {
         o->m_rc++;
     } else if (o->m_rc != 0) {
+#ifdef LEAN_INLINE_ATOMIC_RC
+        __atomic_fetch_sub(&o->m_rc, 1, __ATOMIC_RELAXED);
+#else
         lean_inc_ref_cold(o);
+#endif
     }
 }
 
@@ -433,23 +457,58 @@ static inline void lean_inc_ref_n(lean_object * o, size_t n) {
     if (LEAN_LIKELY(lean_is_st(o))) {
         o->m_rc += n;
     } else if (o->m_rc != 0) {
+#ifdef LEAN_INLINE_ATOMIC_RC
+        __atomic_fetch_sub(&o->m_rc, (int)n, __ATOMIC_RELAXED);
+#else
         lean_inc_ref_n_cold(o, n);
+#endif
     }
 }
 
 LEAN_SHARED void lean_dec_ref_cold(lean_object * o);
+/* Free `o` after its last reference has been released, i.e., its reference counter is `1` if it is a single-threaded
+   object, and has been atomically updated to `0` if it is a multi-threaded object. */
+LEAN_SHARED void lean_dec_ref_last(lean_object * o);
 
 static inline void lean_dec_ref(lean_object * o) {
     if (LEAN_LIKELY(o->m_rc > 1)) {
         o->m_rc--;
     } else if (o->m_rc != 0) {
+#ifdef LEAN_INLINE_ATOMIC_RC
+        if (o->m_rc == 1 || __atomic_fetch_add(&o->m_rc, 1, __ATOMIC_RELEASE) == -1)
+            lean_dec_ref_last(o);
+#else
         lean_dec_ref_cold(o);
+#endif
     }
 }
 static inline void lean_inc(lean_object * o) { if (!lean_is_scalar(o)) lean_inc_ref(o); }
 static inline void lean_inc_n(lean_object * o, size_t n) { if (!lean_is_scalar(o)) lean_inc_ref_n(o, n); }
 static inline void lean_dec(lean_object * o) { if (!lean_is_scalar(o)) lean_dec_ref(o); }
 
+/* Execution counter of a reference counting instruction or function entry in code compiled with
+   `compiler.rcProfile`. The counters are appended to the file `LEAN_RC_PROFILE` when the process exits. */
+typedef struct lean_rc_site {
+    struct lean_rc_site * m_next;
+    char const *          m_fn;
+    char const *          m_kind;
+    char const *          m_var;
+    size_t                m_count;
+    bool                  m_registered;
+} lean_rc_site;
+
+LEAN_SHARED void lean_rc_site_register(lean_rc_site * s);
+
+static inline void lean_rc_site_hit(lean_rc_site * s) {
+    if (LEAN_UNLIKELY(!s->m_registered)) lean_rc_site_register(s);
+    s->m_count++;
+}
+
+#define LEAN_RC_SITE(fn, kind, var) do { \
+    static lean_rc_site lean_rc_site_ = {NULL, fn, kind, var, 0, false}; \
+    lean_rc_site_hit(&lean_rc_site_); \
+} while (0)
+
 /* Just free memory */
 LEAN_SHARED void lean_dealloc(lean_object * o);
 
@@ -497,6 +556,19 @@ static inline bool lean_is_shared(lean_object * o) {
 LEAN_SHARED void lean_mark_mt(lean_object * o);
 LEAN_SHARED void lean_mark_persistent(lean_object * o);
 
+/* Closed terms extracted with `compiler.lazy_closed_terms` are stored in `*p` and initialized using `init` on first
+   access instead of at module initialization time. */
+LEAN_SHARED lean_object * lean_lazy_closed_term_core(lean_object ** p, lean_object * (*init)(void));
+
+static inline b_lean_obj_res lean_lazy_closed_term(lean_object ** p, lean_object * (*init)(void)) {
+#ifdef LEAN_INLINE_ATOMIC_RC
+    /* Pairs with the release store in `lean_lazy_closed_term_core`, so that the initialized object is visible. */
+    lean_object * r = __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    if (LEAN_LIKELY(r != NULL)) return r;
+#endif
+    return lean_lazy_closed_term_core(p, init);
+}
+
 static inline void lean_set_st_header(lean_object * o, unsigned tag, unsigned other) {
     o->m_rc       = 1;
     o->m_tag      = tag;
@@ -754,6 +826,7 @@ static inline lean_object * lean_array_get(lean_obj_arg def_val, b_lean_obj_arg
 }
 
 LEAN_SHARED lean_obj_res lean_copy_expand_array(lean_obj_arg a, bool expand);
+LEAN_SHARED lean_obj_res lean_array_reserve(lean_obj_arg a, b_lean_obj_arg n);
 
 static inline lean_obj_res lean_copy_array(lean_obj_arg a) {
     return lean_copy_expand_array(a, false);
@@ -848,6 +921,7 @@ static inline void lean_sarray_set_size(u_lean_obj_arg o, size_t sz) {
     lean_to_sarray(o)->m_size = sz;
 }
 static inline uint8_t* lean_sarray_cptr(lean_object * o) { return lean_to_sarray(o)->m_data; }
+LEAN_SHARED lean_obj_res lean_sarray_reserve(lean_obj_arg a, b_lean_obj_arg n);
 
 /* Remark: expand sarray API after we add better support in the compiler */
 
@@ -883,6 +957,9 @@ static inline uint8_t lean_byte_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_SHARED lean_obj_res lean_byte_array_push(lean_obj_arg a, uint8_t b);
+LEAN_SHARED lean_obj_res lean_byte_array_fill(lean_obj_arg a, uint8_t v);
+LEAN_SHARED lean_obj_res lean_byte_array_index_of(b_lean_obj_arg a, uint8_t v, b_lean_obj_arg start);
+LEAN_SHARED uint8_t lean_byte_array_compare(b_lean_obj_arg a, b_lean_obj_arg b);
 
 static inline lean_object * lean_byte_array_uset(lean_obj_arg a, size_t i, uint8_t v) {
     lean_obj_res r;
@@ -948,6 +1025,9 @@ static inline double lean_float_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_SHARED lean_obj_res lean_float_array_push(lean_obj_arg a, double d);
+LEAN_SHARED lean_obj_res lean_float_array_fill(lean_obj_arg a, double d);
+LEAN_SHARED double lean_float_array_sum(b_lean_obj_arg a);
+LEAN_SHARED double lean_float_array_dot(b_lean_obj_arg a, b_lean_obj_arg b);
 
 static inline lean_obj_res lean_float_array_uset(lean_obj_arg a, size_t i, double d) {
     lean_obj_res r;
@@ -1007,11 +1087,19 @@ LEAN_SHARED lean_obj_res lean_string_data(lean_obj_arg s);
 LEAN_SHARED uint32_t  lean_string_utf8_get(b_lean_obj_arg s, b_lean_obj_arg i);
 LEAN_SHARED lean_obj_res lean_string_utf8_next(b_lean_obj_arg s, b_lean_obj_arg i);
 LEAN_SHARED lean_obj_res lean_string_utf8_prev(b_lean_obj_arg s, b_lean_obj_arg i);
+LEAN_SHARED lean_obj_res lean_string_offset_of_pos(b_lean_obj_arg s, b_lean_obj_arg i);
 LEAN_SHARED lean_obj_res lean_string_utf8_set(lean_obj_arg s, b_lean_obj_arg i, uint32_t c);
 static inline uint8_t lean_string_utf8_at_end(b_lean_obj_arg s, b_lean_obj_arg i) {
     return !lean_is_scalar(i) || lean_unbox(i) >= lean_string_size(s) - 1;
 }
 LEAN_SHARED lean_obj_res lean_string_utf8_extract(b_lean_obj_arg s, b_lean_obj_arg b, b_lean_obj_arg e);
+LEAN_SHARED lean_obj_res lean_string_pos_of(b_lean_obj_arg s, uint32_t c);
+LEAN_SHARED uint8_t lean_string_contains(b_lean_obj_arg s, uint32_t c);
+LEAN_SHARED uint8_t lean_string_starts_with(b_lean_obj_arg s, b_lean_obj_arg pre);
+LEAN_SHARED uint8_t lean_string_ends_with(b_lean_obj_arg s, b_lean_obj_arg post);
+LEAN_SHARED lean_obj_res lean_string_split_on(b_lean_obj_arg s, b_lean_obj_arg sep);
+LEAN_SHARED lean_obj_res lean_string_replace(b_lean_obj_arg s, b_lean_obj_arg pattern, b_lean_obj_arg replacement);
+LEAN_SHARED lean_obj_res lean_json_next_special_pos(b_lean_obj_arg s, b_lean_obj_arg i);
 static inline lean_obj_res lean_string_utf8_byte_size(b_lean_obj_arg s) { return lean_box(lean_string_size(s) - 1); }
 LEAN_SHARED bool lean_string_eq_cold(b_lean_obj_arg s1, b_lean_obj_arg s2);
 static inline bool lean_string_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) {
@@ -1022,6 +1110,9 @@ LEAN_SHARED bool lean_string_lt(b_lean_obj_arg s1, b_lean_obj_arg s2);
 static inline uint8_t lean_string_dec_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_eq(s1, s2); }
 static inline uint8_t lean_string_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_lt(s1, s2); }
 LEAN_SHARED uint64_t lean_string_hash(b_lean_obj_arg);
+LEAN_SHARED lean_obj_res lean_nat_repr(b_lean_obj_arg n);
+LEAN_SHARED lean_obj_res lean_string_to_nat(b_lean_obj_arg s);
+LEAN_SHARED uint64_t lean_fuzzy_char_mask(b_lean_obj_arg);
 
 /* Thunks */
 
@@ -1091,6 +1182,8 @@ LEAN_SHARED void lean_io_cancel_core(b_lean_obj_arg t);
 LEAN_SHARED bool lean_io_has_finished_core(b_lean_obj_arg t);
 /* primitive for implementing `IO.waitAny : List (Task a) -> IO (Task a)` */
 LEAN_SHARED b_lean_obj_res lean_io_wait_any_core(b_lean_obj_arg task_list);
+/* primitive for implementing `IO.waitAll : Array (Task a) -> IO (Array a)` */
+LEAN_SHARED void lean_io_wait_all_core(b_lean_obj_arg tasks);
 
 /* External objects */
 
@@ -7,17 +7,91 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <utility>
 #include <vector>
+#include "runtime/thread.h"
+#include "runtime/interrupt.h"
 #include "kernel/abstract.h"
 #include "kernel/replace_fn.h"
+#include "kernel/assoc_cache.h"
+#include "kernel/cache_stack.h"
+
+#ifndef LEAN_FVAR_MASK_CACHE_CAPACITY
+#define LEAN_FVAR_MASK_CACHE_CAPACITY 1024*8
+#endif
 
 namespace lean {
+/* The free variables of a term are summarized by a 64-bit Bloom filter, where the free variable `x` sets
+   bit `hash(x) % 64`. `abstract` skips shared subterms whose filter is disjoint from the one of the free
+   variables being abstracted. Filters are memoized for shared terms only, since unshared terms are
+   visited at most once by `replace`. The memoized filters are discarded after each top-level `abstract`, so
+   that the cache does not keep the terms of previous calls alive. */
+static cache_counters g_fvar_mask_counters("abstract fvar masks");
+
+struct fvar_mask_cache {
+    struct eqp_fn { bool operator()(expr const & a, expr const & b) const { return is_eqp(a, b); } };
+    assoc_cache<expr, uint64, eqp_fn, 4> m_cache;
+    fvar_mask_cache(unsigned capacity):m_cache(capacity, g_fvar_mask_counters) {}
+    void clear() { m_cache.clear(); }
+};
+
+/* CACHE_RESET: NO */
+MK_CACHE_STACK(fvar_mask_cache, LEAN_FVAR_MASK_CACHE_CAPACITY)
+
+static uint64 get_fvar_bit(name const & n) {
+    return static_cast<uint64>(1) << (n.hash() % 64);
+}
+
+static uint64 get_fvar_mask(expr const & e, fvar_mask_cache_ref const & c) {
+    if (!has_fvar(e))
+        return 0;
+    unsigned h = hash_ptr(e.raw());
+    bool shared = is_shared(e);
+    if (shared) {
+        if (uint64 * r = c->m_cache.find(e, h))
+            return *r;
+    }
+    check_system("abstract");
+    uint64 r = 0;
+    switch (e.kind()) {
+    case expr_kind::BVar: case expr_kind::MVar: case expr_kind::Sort:
+    case expr_kind::Const: case expr_kind::Lit:
+        break;
+    case expr_kind::FVar:
+        r = get_fvar_bit(fvar_name(e));
+        break;
+    case expr_kind::MData:
+        r = get_fvar_mask(mdata_expr(e), c);
+        break;
+    case expr_kind::Proj:
+        r = get_fvar_mask(proj_expr(e), c);
+        break;
+    case expr_kind::App:
+        r = get_fvar_mask(app_fn(e), c) | get_fvar_mask(app_arg(e), c);
+        break;
+    case expr_kind::Lambda: case expr_kind::Pi:
+        r = get_fvar_mask(binding_domain(e), c) | get_fvar_mask(binding_body(e), c);
+        break;
+    case expr_kind::Let:
+        r = get_fvar_mask(let_type(e), c) | get_fvar_mask(let_value(e), c) | get_fvar_mask(let_body(e), c);
+        break;
+    }
+    if (shared)
+        c->m_cache.insert(e, h, r);
+    return r;
+}
+
 expr abstract(expr const & e, unsigned n, expr const * subst) {
     lean_assert(std::all_of(subst, subst+n, [](expr const & e) { return !has_loose_bvars(e) && is_fvar(e); }));
     if (!has_fvar(e))
         return e;
-    return replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
+    uint64 mask = 0;
+    for (unsigned i = 0; i < n; i++)
+        mask |= get_fvar_bit(fvar_name(subst[i]));
+    fvar_mask_cache_ref cache;
+    return replace(e, [=, &cache](expr const & m, unsigned offset) -> optional<expr> {
             if (!has_fvar(m))
                 return some_expr(m); // expression m does not contain free variables
+            if (is_shared(m) && (get_fvar_mask(m, cache) & mask) == 0)
+                return some_expr(m); // expression m does not contain the free variables in `subst`
             if (is_fvar(m)) {
                 unsigned i = n;
                 while (i > 0) {
@@ -43,9 +117,22 @@ static object * lean_expr_abstract_core(object * e0, size_t n, object * subst) {
         lean_inc(e0);
         return e0;
     }
-    expr r = replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
+    /* The Bloom filters are only used if `subst` does not contain metavariables. */
+    bool only_fvars = true;
+    uint64 mask     = 0;
+    for (size_t i = 0; i < n; i++) {
+        object * v = lean_array_get_core(subst, i);
+        if (is_fvar_core(v))
+            mask |= get_fvar_bit(fvar_name_core(v));
+        else if (is_mvar_core(v))
+            only_fvars = false;
+    }
+    fvar_mask_cache_ref cache;
+    expr r = replace(e, [=, &cache](expr const & m, unsigned offset) -> optional<expr> {
             if (!has_fvar(m) && !has_mvar(m))
                 return some_expr(m); // expression m does not contain free/meta variables
+            if (only_fvars && is_shared(m) && (get_fvar_mask(m, cache) & mask) == 0)
+                return some_expr(m); // expression m does not contain the free variables in `subst`
             bool fv = is_fvar(m);
             bool mv = is_mvar(m);
             if (fv || mv) {
@@ -0,0 +1,29 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "kernel/assoc_cache.h"
+
+namespace lean {
+/* All `cache_counters` objects. They are registered during static initialization, so no lock is needed. */
+static cache_counters * g_cache_counters = nullptr;
+static atomic<bool>     g_cache_stats_enabled{false};
+
+cache_counters::cache_counters(char const * name):m_name(name), m_next(g_cache_counters) {
+    g_cache_counters = this;
+}
+
+void set_cache_stats_enabled(bool enabled) { g_cache_stats_enabled = enabled; }
+bool get_cache_stats_enabled() { return g_cache_stats_enabled; }
+
+void display_cache_stats(std::ostream & out) {
+    for (cache_counters * c = g_cache_counters; c; c = c->m_next) {
+        uint64 hits   = c->m_hits;
+        uint64 misses = c->m_misses;
+        if (hits + misses == 0)
+            continue;
+        out << "  " << c->m_name << " cache: " << hits << " hits, " << misses << " misses ("
+            << (100 * hits / (hits + misses)) << "% hits)\n";
+    }
+}
+}
@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include "runtime/int64.h"
+#include "runtime/thread.h"
+#include "runtime/debug.h"
+
+namespace lean {
+/** \brief Hit and miss counters shared by all caches of the same kind.
+    Caches only add their counts to them when they are cleared and cache statistics are enabled.
+    Instances must have static storage duration. */
+struct cache_counters {
+    char const *     m_name;
+    atomic<uint64>   m_hits{0};
+    atomic<uint64>   m_misses{0};
+    cache_counters * m_next;
+    explicit cache_counters(char const * name);
+};
+
+void set_cache_stats_enabled(bool enabled);
+bool get_cache_stats_enabled();
+/** \brief Display the counters of all caches that have been used so far. */
+void display_cache_stats(std::ostream & out);
+
+/** \brief Fixed size set-associative cache.
+
+    Each key is mapped to a set of `Ways` entries using its hash code. Inserting a key into a full set
+    evicts the least recently used entry of the set. With `Ways == 1`, this is a direct-mapped cache,
+    i.e., `insert` overwrites any entry whose key is in the same set.
+
+    `Eq` is used to compare keys, and `Key()` and `Value()` are used to release the entries on `clear`. */
+template<typename Key, typename Value, typename Eq, unsigned Ways>
+class assoc_cache {
+    struct entry {
+        bool  m_valid{false};
+        Key   m_key;
+        Value m_value;
+    };
+    unsigned              m_num_sets;
+    /* Set `i` is stored at `[i * Ways, (i + 1) * Ways)`, ordered from most to least recently used. */
+    std::vector<entry>    m_entries;
+    std::vector<unsigned> m_used;
+    cache_counters &      m_counters;
+    uint64                m_hits{0};
+    uint64                m_misses{0};
+
+    unsigned get_set(unsigned h) const { return h % m_num_sets; }
+
+    /* Move the entry at `base + j` to the front of its set. */
+    void touch(unsigned base, unsigned j) {
+        if (j > 0)
+            std::rotate(m_entries.begin() + base, m_entries.begin() + base + j, m_entries.begin() + base + j + 1);
+    }
+public:
+    /* `capacity` is the total number of entries, which is rounded up to a multiple of `Ways`. */
+    assoc_cache(unsigned capacity, cache_counters & counters):
+        m_num_sets(std::max(1u, (capacity + Ways - 1) / Ways)), m_entries(m_num_sets * Ways), m_counters(counters) {}
+
+    Value * find(Key const & k, unsigned h) {
+        unsigned base = get_set(h) * Ways;
+        for (unsigned j = 0; j < Ways; j++) {
+            entry & e = m_entries[base + j];
+            if (!e.m_valid)
+                break;
+            if (Eq()(e.m_key, k)) {
+                m_hits++;
+                touch(base, j);
+                return &m_entries[base].m_value;
+            }
+        }
+        m_misses++;
+        return nullptr;
+    }
+
+    void insert(Key const & k, unsigned h, Value const & v) {
+        unsigned set  = get_set(h);
+        unsigned base = set * Ways;
+        if (!m_entries[base].m_valid)
+            m_used.push_back(set);
+        unsigned j = 0;
+        /* Reuse the entry for `k` if there is one, and the least recently used one otherwise. */
+        while (j < Ways - 1 && m_entries[base + j].m_valid && !Eq()(m_entries[base + j].m_key, k))
+            j++;
+        entry & e  = m_entries[base + j];
+        e.m_valid  = true;
+        e.m_key    = k;
+        e.m_value  = v;
+        touch(base, j);
+    }
+
+    void clear() {
+        for (unsigned set : m_used) {
+            for (unsigned j = 0; j < Ways; j++) {
+                entry & e = m_entries[set * Ways + j];
+                e.m_valid = false;
+                e.m_key   = Key();
+                e.m_value = Value();
+            }
+        }
+        m_used.clear();
+        if (get_cache_stats_enabled()) {
+            m_counters.m_hits   += m_hits;
+            m_counters.m_misses += m_misses;
+        }
+        m_hits   = 0;
+        m_misses = 0;
+    }
+};
+}
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "runtime/thread.h"
+#include "runtime/memory.h"
+#include "kernel/closed_term_cache.h"
+#include "kernel/expr_cache.h"
+
+namespace lean {
+
+/* Maximum number of subterms visited by `is_cacheable`. */
+static unsigned const g_max_cacheable_size = 128;
+static unsigned const g_num_shards         = 16;
+
+/* The size of the cache can be set using the environment variable `LEAN_KERNEL_CACHE_SIZE`,
+   `0` disables it. */
+static unsigned get_kernel_cache_size() {
+    if (char const * sz = std::getenv("LEAN_KERNEL_CACHE_SIZE")) {
+        return atoi(sz);
+    }
+    return 1u << 16;
+}
+
+static unsigned const g_num_kinds = 4;
+
+struct closed_term_cache_shard {
+    mutex      m_mutex;
+    object *   m_scope{nullptr};
+    /* indexed by `closed_term_cache::kind` */
+    std::vector<expr_cache> m_caches;
+    explicit closed_term_cache_shard(unsigned capacity):m_caches(g_num_kinds, expr_cache(capacity)) {}
+    expr_cache & get(closed_term_cache::kind k) { return m_caches[static_cast<unsigned>(k)]; }
+    void clear() {
+        for (expr_cache & c : m_caches)
+            c.clear();
+    }
+};
+
+static std::vector<closed_term_cache_shard *> * g_shards = nullptr;
+
+static closed_term_cache_shard & get_shard(expr const & e) {
+    return *(*g_shards)[(hash(e) >> 24) % g_num_shards];
+}
+
+object * closed_term_cache::get_scope(environment const & env) {
+    if (g_shards->empty())
+        return nullptr;
+    return env.get_imported_constants();
+}
+
+bool closed_term_cache::is_cacheable(environment const & env, expr const & e) {
+    if (has_fvar(e) || has_metavar(e) || has_loose_bvars(e))
+        return false;
+    unsigned visited = 0;
+    std::vector<expr const *> todo;
+    todo.push_back(&e);
+    while (!todo.empty()) {
+        expr const & t = *todo.back();
+        todo.pop_back();
+        if (++visited > g_max_cacheable_size)
+            return false;
+        switch (t.kind()) {
+        case expr_kind::BVar: case expr_kind::Sort: case expr_kind::Lit:
+        case expr_kind::FVar: case expr_kind::MVar:
+            break;
+        case expr_kind::Const:
+            if (!env.is_imported_constant(const_name(t)))
+                return false;
+            break;
+        case expr_kind::MData: todo.push_back(&mdata_expr(t)); break;
+        case expr_kind::Proj:
+            if (!env.is_imported_constant(proj_sname(t)))
+                return false;
+            todo.push_back(&proj_expr(t));
+            break;
+        case expr_kind::App:
+            todo.push_back(&app_fn(t));
+            todo.push_back(&app_arg(t));
+            break;
+        case expr_kind::Lambda: case expr_kind::Pi:
+            todo.push_back(&binding_domain(t));
+            todo.push_back(&binding_body(t));
+            break;
+        case expr_kind::Let:
+            todo.push_back(&let_type(t));
+            todo.push_back(&let_value(t));
+            todo.push_back(&let_body(t));
+            break;
+        }
+    }
+    return true;
+}
+
+optional<expr> closed_term_cache::find(object * scope, kind k, expr const & e) {
+    closed_term_cache_shard & s = get_shard(e);
+    unique_lock<mutex> lock(s.m_mutex);
+    if (s.m_scope != scope)
+        return none_expr();
+    expr * r = s.get(k).find(e);
+    return r ? some_expr(*r) : none_expr();
+}
+
+void closed_term_cache::insert(object * scope, kind k, expr const & e, expr const & r) {
+    // the cache is shared between threads
+    mark_mt(e.raw());
+    mark_mt(r.raw());
+    closed_term_cache_shard & s = get_shard(e);
+    unique_lock<mutex> lock(s.m_mutex);
+    if (s.m_scope != scope) {
+        /* Switch to the new scope. We keep a reference to the scope so that its address cannot be reused
+           by a different constant map while there are entries for it. */
+        s.clear();
+        if (s.m_scope) dec(s.m_scope);
+        inc(scope);
+        mark_mt(scope);
+        s.m_scope = scope;
+    }
+    s.get(k).insert(e, r);
+}
+
+/* Memory pressure handler, see `check_memory`. */
+static void clear_closed_term_cache() {
+    for (closed_term_cache_shard * s : *g_shards) {
+        unique_lock<mutex> lock(s->m_mutex);
+        s->clear();
+    }
+}
+
+void initialize_closed_term_cache() {
+    g_shards = new std::vector<closed_term_cache_shard *>();
+    unsigned sz = get_kernel_cache_size();
+    if (sz > 0) {
+        unsigned capacity = std::max(sz / g_num_shards, 1u);
+        for (unsigned i = 0; i < g_num_shards; i++)
+            g_shards->push_back(new closed_term_cache_shard(capacity));
+        register_memory_pressure_handler(clear_closed_term_cache);
+    }
+}
+
+void finalize_closed_term_cache() {
+    for (closed_term_cache_shard * s : *g_shards) {
+        s->clear();
+        if (s->m_scope) dec(s->m_scope);
+        delete s;
+    }
+    delete g_shards;
+}
+}
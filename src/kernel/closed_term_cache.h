@@ -0,0 +1,34 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include "kernel/environment.h"
+
+namespace lean {
+/** \brief Process-wide, bounded and thread-safe cache for `whnf` and `infer` results of closed terms,
+    and for the types and values of constants instantiated with universe levels (keyed by the constant term).
+
+    In contrast to the caches in `type_checker::state`, it survives across `lean_add_decl` calls, so consecutive
+    declarations do not have to re-reduce the same (imported) constants.
+
+    The result of reducing a term only depends on the definitions of the constants it (transitively) refers to.
+    We therefore only cache terms without free variables and metavariables that exclusively refer to *imported*
+    constants, which cannot change for a given set of imports. The cache is tied to the imported constant map of
+    the environment (its *scope*), and is flushed whenever an environment with different imports uses it. */
+class closed_term_cache {
+public:
+    enum class kind { Whnf, Infer, Type, Value };
+    /** \brief Return the scope of the cache for `env`, or `nullptr` if the cache cannot be used with `env`
+        (e.g., because it is disabled, or because `env` is still importing modules). */
+    static object * get_scope(environment const & env);
+    /** \brief Return `true` if `e` can be stored in the cache for the given scope. This check is cheap,
+        but rejects large terms. */
+    static bool is_cacheable(environment const & env, expr const & e);
+    static optional<expr> find(object * scope, kind k, expr const & e);
+    static void insert(object * scope, kind k, expr const & e, expr const & r);
+};
+
+void initialize_closed_term_cache();
+void finalize_closed_term_cache();
+}
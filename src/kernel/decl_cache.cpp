@@ -0,0 +1,195 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+#include "runtime/memory.h"
+#include "kernel/decl_cache.h"
+#include "kernel/assoc_cache.h"
+
+namespace lean {
+LEAN_THREAD_GLOBAL_PTR(decl_deps, g_decl_deps);
+
+/* The maximum number of declarations in the cache can be set using the environment variable
+   `LEAN_KERNEL_DECL_CACHE_SIZE`, `0` disables it. */
+static unsigned get_decl_cache_size() {
+    if (char const * sz = std::getenv("LEAN_KERNEL_DECL_CACHE_SIZE")) {
+        return atoi(sz);
+    }
+    return 1u << 12;
+}
+
+static cache_counters g_decl_cache_counters("kernel declaration cache");
+
+namespace {
+struct decl_cache_entry {
+    declaration                                      m_decl;
+    object *                                         m_imports;
+    unsigned                                         m_trust_lvl;
+    bool                                             m_quot_init;
+    std::vector<pair<name, optional<constant_info>>> m_deps;
+};
+}
+
+struct decl_cache_state {
+    mutex                                                m_mutex;
+    unsigned                                             m_capacity;
+    unsigned                                             m_size{0};
+    std::unordered_multimap<unsigned, decl_cache_entry>  m_entries;
+    explicit decl_cache_state(unsigned capacity):m_capacity(capacity) {}
+};
+
+static decl_cache_state * g_decl_cache = nullptr;
+
+static constant_val const & get_constant_val(declaration const & d) {
+    switch (d.kind()) {
+    case declaration_kind::Axiom:      return d.to_axiom_val().to_constant_val();
+    case declaration_kind::Definition: return d.to_definition_val().to_constant_val();
+    case declaration_kind::Theorem:    return d.to_theorem_val().to_constant_val();
+    case declaration_kind::Opaque:     return d.to_opaque_val().to_constant_val();
+    default: lean_unreachable();
+    }
+}
+
+static optional<expr> get_value(declaration const & d) {
+    switch (d.kind()) {
+    case declaration_kind::Definition: return some_expr(d.to_definition_val().get_value());
+    case declaration_kind::Theorem:    return some_expr(d.to_theorem_val().get_value());
+    case declaration_kind::Opaque:     return some_expr(d.to_opaque_val().get_value());
+    default:                           return none_expr();
+    }
+}
+
+static unsigned hash_decl(declaration const & d) {
+    constant_val const & v = get_constant_val(d);
+    unsigned h = hash(static_cast<unsigned>(v.get_name().hash()), hash(v.get_type()));
+    if (optional<expr> val = get_value(d))
+        h = hash(h, hash(*val));
+    return h;
+}
+
+static bool is_same_safety(declaration const & d1, declaration const & d2) {
+    switch (d1.kind()) {
+    case declaration_kind::Definition: return d1.to_definition_val().get_safety() == d2.to_definition_val().get_safety();
+    case declaration_kind::Opaque:     return d1.to_opaque_val().is_unsafe() == d2.to_opaque_val().is_unsafe();
+    case declaration_kind::Axiom:      return d1.to_axiom_val().is_unsafe() == d2.to_axiom_val().is_unsafe();
+    default:                           return true;
+    }
+}
+
+/* Binder names and annotations do not affect type checking, so we use `==` on the type and value. */
+static bool is_same_decl(declaration const & d1, declaration const & d2) {
+    if (is_eqp(d1, d2))
+        return true;
+    if (d1.kind() != d2.kind() || !is_same_safety(d1, d2))
+        return false;
+    constant_val const & v1 = get_constant_val(d1);
+    constant_val const & v2 = get_constant_val(d2);
+    if (v1.get_name() != v2.get_name() || v1.get_lparams() != v2.get_lparams() || v1.get_type() != v2.get_type())
+        return false;
+    optional<expr> val1 = get_value(d1);
+    optional<expr> val2 = get_value(d2);
+    return !val1 || *val1 == *val2;
+}
+
+static bool is_same_deps(environment const & env, std::vector<pair<name, optional<constant_info>>> const & deps) {
+    for (auto const & p : deps) {
+        optional<constant_info> info = env.find(p.first);
+        if (static_cast<bool>(info) != static_cast<bool>(p.second))
+            return false;
+        if (info && !is_eqp(*info, *p.second))
+            return false;
+    }
+    return true;
+}
+
+bool decl_cache::is_cacheable(environment const & env, declaration const & d) {
+    if (g_decl_cache == nullptr)
+        return false;
+    switch (d.kind()) {
+    case declaration_kind::Axiom: case declaration_kind::Definition:
+    case declaration_kind::Theorem: case declaration_kind::Opaque:
+        return env.get_imported_constants() != nullptr;
+    default:
+        return false;
+    }
+}
+
+bool decl_cache::contains(environment const & env, declaration const & d) {
+    unsigned h = hash_decl(d);
+    object * imports = env.get_imported_constants();
+    unique_lock<mutex> lock(g_decl_cache->m_mutex);
+    auto range = g_decl_cache->m_entries.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        decl_cache_entry const & entry = it->second;
+        if (entry.m_imports == imports &&
+            entry.m_trust_lvl == env.trust_lvl() &&
+            entry.m_quot_init == env.is_quot_initialized() &&
+            is_same_decl(entry.m_decl, d) &&
+            is_same_deps(env, entry.m_deps)) {
+            if (get_cache_stats_enabled())
+                g_decl_cache_counters.m_hits++;
+            return true;
+        }
+    }
+    if (get_cache_stats_enabled())
+        g_decl_cache_counters.m_misses++;
+    return false;
+}
+
+static void release(decl_cache_entry & entry) {
+    dec(entry.m_imports);
+}
+
+void decl_cache::insert(environment const & env, declaration const & d, decl_deps const & deps) {
+    // the cache is shared between threads
+    mark_mt(d.raw());
+    for (auto const & p : deps.m_deps) {
+        mark_mt(p.first.raw());
+        if (p.second)
+            mark_mt(p.second->raw());
+    }
+    object * imports = env.get_imported_constants();
+    /* We keep a reference to the imported constants so that their address cannot be reused by a different
+       constant map while there are entries for it. */
+    inc(imports);
+    mark_mt(imports);
+    decl_cache_entry entry{d, imports, env.trust_lvl(), env.is_quot_initialized(), deps.m_deps};
+    unique_lock<mutex> lock(g_decl_cache->m_mutex);
+    if (g_decl_cache->m_size >= g_decl_cache->m_capacity) {
+        for (auto & p : g_decl_cache->m_entries)
+            release(p.second);
+        g_decl_cache->m_entries.clear();
+        g_decl_cache->m_size = 0;
+    }
+    g_decl_cache->m_entries.emplace(hash_decl(d), std::move(entry));
+    g_decl_cache->m_size++;
+}
+
+/* Memory pressure handler, see `check_memory`. */
+static void clear_decl_cache() {
+    unique_lock<mutex> lock(g_decl_cache->m_mutex);
+    for (auto & p : g_decl_cache->m_entries)
+        release(p.second);
+    g_decl_cache->m_entries.clear();
+    g_decl_cache->m_size = 0;
+}
+
+void initialize_decl_cache() {
+    unsigned sz = get_decl_cache_size();
+    if (sz > 0) {
+        g_decl_cache = new decl_cache_state(sz);
+        register_memory_pressure_handler(clear_decl_cache);
+    }
+}
+
+void finalize_decl_cache() {
+    if (g_decl_cache) {
+        for (auto & p : g_decl_cache->m_entries)
+            release(p.second);
+        delete g_decl_cache;
+    }
+}
+}
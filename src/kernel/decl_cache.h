@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <vector>
+#include "runtime/thread.h"
+#include "kernel/environment.h"
+
+namespace lean {
+/** \brief Constants looked up in the environment while checking a declaration.
+    Only the first lookup of each name is recorded. */
+struct decl_deps {
+    std::vector<pair<name, optional<constant_info>>> m_deps;
+    name_set                                         m_names;
+    void record(name const & n, optional<constant_info> const & info) {
+        if (!m_names.contains(n)) {
+            m_names.insert(n);
+            m_deps.emplace_back(n, info);
+        }
+    }
+};
+
+/* The dependencies of the declaration being checked by the current thread, if any. */
+LEAN_THREAD_EXTERN_PTR(decl_deps, g_decl_deps);
+
+/** \brief Process-wide, bounded and thread-safe cache of declarations that have been successfully checked.
+
+    When the server re-elaborates a file, the declarations that were not affected by an edit are sent to the
+    kernel again. The result of checking a declaration only depends on the declaration itself and on the constants
+    the type checker looks up while checking it, so we record these lookups (see `decl_deps`) and skip the check if a
+    structurally equal declaration was checked before in an environment with the same imports, trust level and
+    `Quot` initialization, where all the recorded constants had pointer equal values.
+
+    Only axioms, definitions, theorems and opaque constants are cached. */
+class decl_cache {
+public:
+    /** \brief Return `true` if `d` was already successfully checked in an environment compatible with `env`. */
+    static bool contains(environment const & env, declaration const & d);
+    static void insert(environment const & env, declaration const & d, decl_deps const & deps);
+    /** \brief Return `true` if `d` can be stored in the cache. */
+    static bool is_cacheable(environment const & env, declaration const & d);
+};
+
+void initialize_decl_cache();
+void finalize_decl_cache();
+}
@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include <limits>
+#include <cstdlib>
 #include "runtime/sstream.h"
 #include "runtime/thread.h"
 #include "util/map_foreach.h"
@@ -15,6 +16,9 @@ Author: Leonardo de Moura
 #include "kernel/kernel_exception.h"
 #include "kernel/type_checker.h"
 #include "kernel/quot.h"
+#include "kernel/decl_cache.h"
+#include "kernel/for_each_fn.h"
+#include "kernel/max_sharing.h"
 
 namespace lean {
 extern "C" object* lean_environment_add(object*, object*);
@@ -28,6 +32,11 @@ extern "C" object* lean_get_extension(object*, object*);
 extern "C" object* lean_set_extension(object*, object*, object*);
 extern "C" object* lean_environment_set_main_module(object*, object*);
 extern "C" object* lean_environment_main_module(object*);
+extern "C" uint8 lean_environment_is_imported_const(b_obj_arg env, b_obj_arg n);
+
+#ifndef LEAN_CONST_LOOKUP_CACHE_CAPACITY
+#define LEAN_CONST_LOOKUP_CACHE_CAPACITY 1024
+#endif
 
 environment mk_empty_environment(uint32 trust_lvl) {
     return get_io_result<environment>(lean_mk_empty_environment(trust_lvl, io_mk_world()));
@@ -57,17 +66,79 @@ void environment::mark_quot_initialized() {
     m_obj = lean_environment_mark_quot_init(m_obj);
 }
 
+/* Direct-mapped cache of imported constants for `environment::find`.
+
+   Looking up a constant hashes its name and probes the `SMap` of the environment, first the map of the
+   constants declared in the current module, and then the map of the imported ones. The imported constants
+   of an environment do not change once it has finished importing modules, and the kernel makes sure
+   the current module does not redeclare them (see `check_name`). Thus, a lookup that found an imported
+   constant returns the same result in every environment with the same imported constant map (the *scope*). */
+struct const_lookup_cache {
+    struct entry {
+        object *      m_scope{nullptr};
+        name          m_name;
+        constant_info m_info;
+    };
+    std::vector<entry> m_entries;
+    const_lookup_cache():m_entries(LEAN_CONST_LOOKUP_CACHE_CAPACITY) {}
+    ~const_lookup_cache() {
+        for (entry & e : m_entries)
+            if (e.m_scope) dec(e.m_scope);
+    }
+    entry & get_entry(name const & n) { return m_entries[n.hash() % m_entries.size()]; }
+};
+
+/* CACHE_RESET: No */
+MK_THREAD_LOCAL_GET_DEF(const_lookup_cache, get_const_lookup_cache);
+
+object * environment::get_imported_constants() const {
+    // `Environment.constants : SMap Name ConstantInfo`, see `src/Lean/Environment.lean` and `src/Lean/Data/SMap.lean`
+    object * constants = cnstr_get(raw(), 1);
+    bool stage1 = lean_ctor_get_uint8(constants, 2 * sizeof(void *)) != 0;
+    if (stage1)
+        return nullptr;
+    return cnstr_get(constants, 0); // `map₁`
+}
+
+bool environment::is_imported_constant(name const & n) const {
+    return lean_environment_is_imported_const(raw(), n.raw());
+}
+
+static optional<constant_info> find_core(environment const & env, name const & n) {
+    object * scope = env.get_imported_constants();
+    if (scope) {
+        const_lookup_cache::entry & e = get_const_lookup_cache().get_entry(n);
+        if (e.m_scope == scope && e.m_name == n)
+            return optional<constant_info>(e.m_info);
+    }
+    optional<constant_info> r = to_optional<constant_info>(lean_environment_find(env.to_obj_arg(), n.to_obj_arg()));
+    if (r && scope && env.is_imported_constant(n)) {
+        const_lookup_cache::entry & e = get_const_lookup_cache().get_entry(n);
+        if (e.m_scope != scope) {
+            if (e.m_scope) dec(e.m_scope);
+            inc(scope);
+            e.m_scope = scope;
+        }
+        e.m_name = n;
+        e.m_info = *r;
+    }
+    return r;
+}
+
 optional<constant_info> environment::find(name const & n) const {
-    return to_optional<constant_info>(lean_environment_find(to_obj_arg(), n.to_obj_arg()));
+    optional<constant_info> r = find_core(*this, n);
+    if (g_decl_deps)
+        g_decl_deps->record(n, r);
+    return r;
 }
 
 constant_info environment::get(name const & n) const {
-    object * o = lean_environment_find(to_obj_arg(), n.to_obj_arg());
-    if (is_scalar(o))
+    optional<constant_info> r = find_core(*this, n);
+    if (g_decl_deps)
+        g_decl_deps->record(n, r);
+    if (!r)
         throw unknown_constant_exception(*this, n);
-    constant_info r(cnstr_get(o, 0), true);
-    dec(o);
-    return r;
+    return *r;
 }
 
 static void check_no_metavar(environment const & env, name const & n, expr const & e) {
@@ -110,12 +181,38 @@ void environment::check_duplicated_univ_params(names ls) const {
     ::lean::check_duplicated_univ_params(*this, ls);
 }
 
+/* Terms elaborated by tactics are often trees with many duplicate subterms, which defeat the caches of the type checker
+   since they are keyed by pointers. If `LEAN_KERNEL_MAX_SHARING` is set to `n > 0`, types and values with at least `n`
+   distinct subterms are maximally shared before checking them. */
+static unsigned g_max_sharing_threshold = 0;
+/* Shared by all declarations, so that subterms common to many declarations are only processed once. */
+static max_sharing_table * g_max_sharing_table = nullptr;
+
+static unsigned get_num_subterms(expr const & e) {
+    unsigned n = 0;
+    for_each(e, [&](expr const &, unsigned) { n++; return true; });
+    return n;
+}
+
+static expr share_if_large(expr const & e) {
+    if (g_max_sharing_threshold == 0)
+        return e;
+    unsigned before = get_num_subterms(e);
+    if (before < g_max_sharing_threshold)
+        return e;
+    expr r = max_sharing_fn(*g_max_sharing_table)(e);
+    if (get_kernel_stats_enabled())
+        report_kernel_max_sharing(before, get_num_subterms(r));
+    return r;
+}
+
 static void check_constant_val(environment const & env, constant_val const & v, type_checker & checker) {
     check_name(env, v.get_name());
     check_duplicated_univ_params(env, v.get_lparams());
     check_no_metavar_no_fvar(env, v.get_name(), v.get_type());
-    expr sort = checker.check(v.get_type(), v.get_lparams());
-    checker.ensure_sort(sort, v.get_type());
+    expr type = share_if_large(v.get_type());
+    expr sort = checker.check(type, v.get_lparams());
+    checker.ensure_sort(sort, type);
 }
 
 static void check_constant_val(environment const & env, constant_val const & v, bool safe_only) {
@@ -153,7 +250,7 @@ environment environment::add_definition(declaration const & d, bool check) const
             bool safe_only = false;
             type_checker checker(new_env, safe_only);
             check_no_metavar_no_fvar(new_env, v.get_name(), v.get_value());
-            expr val_type = checker.check(v.get_value(), v.get_lparams());
+            expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
             if (!checker.is_def_eq(val_type, v.get_type()))
                 throw definition_type_mismatch_exception(new_env, d, val_type);
         }
@@ -163,7 +260,7 @@ environment environment::add_definition(declaration const & d, bool check) const
             type_checker checker(*this);
             check_constant_val(*this, v.to_constant_val(), checker);
             check_no_metavar_no_fvar(*this, v.get_name(), v.get_value());
-            expr val_type = checker.check(v.get_value(), v.get_lparams());
+            expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
             if (!checker.is_def_eq(val_type, v.get_type()))
                 throw definition_type_mismatch_exception(*this, d, val_type);
         }
@@ -178,19 +275,34 @@ environment environment::add_theorem(declaration const & d, bool check) const {
         type_checker checker(*this);
         check_constant_val(*this, v.to_constant_val(), checker);
         check_no_metavar_no_fvar(*this, v.get_name(), v.get_value());
-        expr val_type = checker.check(v.get_value(), v.get_lparams());
+        expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
         if (!checker.is_def_eq(val_type, v.get_type()))
             throw definition_type_mismatch_exception(*this, d, val_type);
     }
     return add(constant_info(d));
 }
 
+environment environment::add_theorem_header(declaration const & d) const {
+    theorem_val const & v = d.to_theorem_val();
+    check_constant_val(*this, v.to_constant_val(), true);
+    return add(constant_info(d));
+}
+
+void environment::check_theorem_value(declaration const & d) const {
+    theorem_val const & v = d.to_theorem_val();
+    type_checker checker(*this);
+    check_no_metavar_no_fvar(*this, v.get_name(), v.get_value());
+    expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
+    if (!checker.is_def_eq(val_type, v.get_type()))
+        throw definition_type_mismatch_exception(*this, d, val_type);
+}
+
 environment environment::add_opaque(declaration const & d, bool check) const {
     opaque_val const & v = d.to_opaque_val();
     if (check) {
         type_checker checker(*this);
         check_constant_val(*this, v.to_constant_val(), checker);
-        expr val_type = checker.check(v.get_value(), v.get_lparams());
+        expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
         if (!checker.is_def_eq(val_type, v.get_type()))
             throw definition_type_mismatch_exception(*this, d, val_type);
     }
@@ -224,7 +336,7 @@ environment environment::add_mutual(declaration const & d, bool check) const {
         type_checker checker(new_env, safe_only);
         for (definition_val const & v : vs) {
             check_no_metavar_no_fvar(new_env, v.get_name(), v.get_value());
-            expr val_type = checker.check(v.get_value(), v.get_lparams());
+            expr val_type = checker.check(share_if_large(v.get_value()), v.get_lparams());
             if (!checker.is_def_eq(val_type, v.get_type()))
                 throw definition_type_mismatch_exception(new_env, d, val_type);
         }
@@ -232,7 +344,30 @@ environment environment::add_mutual(declaration const & d, bool check) const {
     return new_env;
 }
 
+/* Record the constants looked up by the current thread in `deps` while this object is alive. */
+class scoped_decl_deps {
+    decl_deps * m_old;
+public:
+    explicit scoped_decl_deps(decl_deps & deps):m_old(g_decl_deps) { g_decl_deps = &deps; }
+    ~scoped_decl_deps() { g_decl_deps = m_old; }
+};
+
 environment environment::add(declaration const & d, bool check) const {
+    if (check && decl_cache::is_cacheable(*this, d)) {
+        if (decl_cache::contains(*this, d))
+            return add(constant_info(d));
+        decl_deps deps;
+        environment r = [&]() {
+            scoped_decl_deps scope(deps);
+            return add_decl_core(d, check);
+        }();
+        decl_cache::insert(*this, d, deps);
+        return r;
+    }
+    return add_decl_core(d, check);
+}
+
+environment environment::add_decl_core(declaration const & d, bool check) const {
     switch (d.kind()) {
     case declaration_kind::Axiom:            return add_axiom(d, check);
     case declaration_kind::Definition:       return add_definition(d, check);
@@ -251,6 +386,86 @@ extern "C" LEAN_EXPORT object * lean_add_decl(object * env, object * decl) {
         });
 }
 
+/* (env : Environment) (decl : Declaration) (_ : Unit) : Except KernelException Unit */
+static obj_res check_theorem_value_fn(obj_arg env, obj_arg decl, obj_arg) {
+    environment e(env);
+    declaration d(decl);
+    return catch_kernel_exceptions<object_ref>([&]() {
+            e.check_theorem_value(d);
+            return object_ref(box(0));
+        });
+}
+
+/*
+addDecls (env : Environment) (decls : @& List Declaration) : Except KernelException Environment
+
+Add the declarations `decls` in order. Theorem headers are checked and the theorems are added right away,
+while their values are checked by tasks on the task manager, so that the following declarations, which
+may only depend on the statements of the theorems, do not have to wait for them.
+If checking fails, the error for the first failing declaration in `decls` is returned.
+*/
+extern "C" LEAN_EXPORT object * lean_add_decls(object * env, b_obj_arg decls) {
+    environment e(env);
+    std::vector<object_ref> tasks;
+    object * err = nullptr;
+    for (object * it = decls; !is_scalar(it); it = cnstr_get(it, 1)) {
+        declaration d(cnstr_get(it, 0), true);
+        object * r;
+        if (d.is_theorem()) {
+            environment prev = e;
+            r = catch_kernel_exceptions<environment>([&]() { return prev.add_theorem_header(d); });
+            if (cnstr_tag(r) == 1) {
+                object * c = lean_alloc_closure((void*)check_theorem_value_fn, 3, 2);
+                lean_closure_set(c, 0, prev.steal());
+                lean_closure_set(c, 1, d.to_obj_arg());
+                tasks.push_back(object_ref(task_spawn(c)));
+            }
+        } else {
+            r = catch_kernel_exceptions<environment>([&]() { return e.add(d); });
+        }
+        if (cnstr_tag(r) == 0) {
+            err = r;
+            break;
+        }
+        e = environment(cnstr_get(r, 0), true);
+        dec(r);
+    }
+    for (object_ref const & t : tasks) {
+        object * v = task_get(t.raw());
+        if (cnstr_tag(v) == 0) {
+            if (err) dec(err);
+            inc(v);
+            return v;
+        }
+    }
+    if (err)
+        return err;
+    return mk_cnstr(1, e).steal();
+}
+
+/*
+addTheoremAsync (env : Environment) (decl : @& Declaration) : Except KernelException (Environment × Task (Except KernelException Unit))
+
+Check the header of the theorem `decl` and add it to `env` right away, while its value is checked by a task on the
+task manager, as in `addDecls`.
+*/
+extern "C" LEAN_EXPORT object * lean_add_theorem_async(object * env, b_obj_arg decl) {
+    environment e(env);
+    declaration d(decl, true);
+    lean_always_assert(d.is_theorem());
+    object * r = catch_kernel_exceptions<environment>([&]() { return e.add_theorem_header(d); });
+    if (cnstr_tag(r) == 0)
+        return r;
+    object * c = lean_alloc_closure((void*)check_theorem_value_fn, 3, 2);
+    lean_closure_set(c, 0, e.steal());
+    lean_closure_set(c, 1, d.to_obj_arg());
+    object * p = alloc_cnstr(0, 2, 0);
+    cnstr_set(p, 0, cnstr_get(r, 0));
+    cnstr_set(p, 1, task_spawn(c));
+    cnstr_set(r, 0, p);
+    return r;
+}
+
 void environment::for_each_constant(std::function<void(constant_info const & d)> const & f) const {
     smap_foreach(cnstr_get(raw(), 1), [&](object *, object * v) {
             constant_info cinfo(v, true);
@@ -265,8 +480,13 @@ void environment::display_stats() const {
 }
 
 void initialize_environment() {
+    if (char const * v = std::getenv("LEAN_KERNEL_MAX_SHARING"))
+        g_max_sharing_threshold = atoi(v);
+    if (g_max_sharing_threshold > 0)
+        g_max_sharing_table = new max_sharing_table();
 }
 
 void finalize_environment() {
+    delete g_max_sharing_table;
 }
 }
@@ -45,6 +45,7 @@ class environment : public object_ref {
     environment add_mutual(declaration const & d, bool check) const;
     environment add_quot() const;
     environment add_inductive(declaration const & d) const;
+    environment add_decl_core(declaration const & d, bool check) const;
 public:
     environment(unsigned trust_lvl = 0);
     environment(environment const & other):object_ref(other) {}
@@ -74,6 +75,22 @@ public:
     /** \brief Extends the current environment with the given declaration */
     environment add(declaration const & d, bool check = true) const;
 
+    /** \brief Check the header of the theorem \c d and extend the current environment with it
+        without checking its value. The value must be checked using \c check_theorem_value
+        on the current environment (not the resulting one). */
+    environment add_theorem_header(declaration const & d) const;
+
+    /** \brief Check the value of the theorem \c d against its type. */
+    void check_theorem_value(declaration const & d) const;
+
+    /** \brief Return the map of imported constants, or `nullptr` if this environment is still importing modules.
+        The map does not change once importing has finished, and all environments with the same imports share it,
+        so caches of imported constants use it to identify the environments they are valid for. */
+    object * get_imported_constants() const;
+
+    /** \brief Return true iff \c n is an imported constant. */
+    bool is_imported_constant(name const & n) const;
+
     /** \brief Apply the function \c f to each constant */
     void for_each_constant(std::function<void(constant_info const & d)> const & f) const;
 
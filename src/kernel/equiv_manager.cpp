@@ -6,24 +6,68 @@ Author: Leonardo de Moura
 */
 #include "runtime/interrupt.h"
 #include "runtime/flet.h"
+#include "runtime/thread.h"
 #include "kernel/equiv_manager.h"
 
 namespace lean {
-auto equiv_manager::mk_node() -> node_ref {
-    node_ref r = m_nodes.size();
+/* Tables with more nodes are not reused to avoid retaining memory after big `is_def_eq` problems. */
+static unsigned const g_max_reused_nodes  = 1u << 16;
+/* Maximum number of tables kept for reuse by each thread. */
+static unsigned const g_max_reused_tables = 8;
+
+struct equiv_manager_pool {
+    std::vector<std::unique_ptr<equiv_manager::tables>> m_free;
+};
+MK_THREAD_LOCAL_GET_DEF(equiv_manager_pool, get_equiv_manager_pool);
+
+auto equiv_manager::acquire_tables() -> std::unique_ptr<tables> {
+    equiv_manager_pool & pool = get_equiv_manager_pool();
+    if (pool.m_free.empty())
+        return std::unique_ptr<tables>(new tables());
+    std::unique_ptr<tables> r = std::move(pool.m_free.back());
+    pool.m_free.pop_back();
+    return r;
+}
+
+void equiv_manager::release_tables(std::unique_ptr<tables> t) {
+    if (in_thread_finalization() || t->m_nodes.size() > g_max_reused_nodes)
+        return;
+    equiv_manager_pool & pool = get_equiv_manager_pool();
+    if (pool.m_free.size() >= g_max_reused_tables)
+        return;
+    t->clear();
+    pool.m_free.push_back(std::move(t));
+}
+
+equiv_manager::~equiv_manager() {
+    release_tables(std::move(m_tables));
+}
+
+auto equiv_manager::mk_node(expr const & e) -> node_ref {
+    std::vector<node> & nodes = m_tables->m_nodes;
+    node_ref r = nodes.size();
     node n;
     n.m_parent = r;
     n.m_rank   = 0;
-    m_nodes.push_back(n);
+    n.m_expr   = e;
+    nodes.push_back(n);
     return r;
 }
 
 auto equiv_manager::find(node_ref n) -> node_ref {
+    std::vector<node> & nodes = m_tables->m_nodes;
+    m_num_finds++;
     while (true) {
-        node_ref p = m_nodes[n].m_parent;
+        node_ref p = nodes[n].m_parent;
         if (p == n)
             return p;
-        n = p;
+        node_ref g = nodes[p].m_parent;
+        if (g != p) {
+            /* path halving */
+            nodes[n].m_parent = g;
+            m_num_compressions++;
+        }
+        n = g;
     }
 }
 
@@ -31,8 +75,8 @@ void equiv_manager::merge(node_ref n1, node_ref n2) {
     node_ref r1 = find(n1);
     node_ref r2 = find(n2);
     if (r1 != r2) {
-        node & ref1 = m_nodes[r1];
-        node & ref2 = m_nodes[r2];
+        node & ref1 = m_tables->m_nodes[r1];
+        node & ref2 = m_tables->m_nodes[r2];
         if (ref1.m_rank < ref2.m_rank) {
             ref1.m_parent = r2;
         } else if (ref1.m_rank > ref2.m_rank) {
@@ -45,11 +89,11 @@ void equiv_manager::merge(node_ref n1, node_ref n2) {
 }
 
 auto equiv_manager::to_node(expr const & e) -> node_ref {
-    auto it = m_to_node.find(e);
-    if (it != m_to_node.end())
+    auto it = m_tables->m_to_node.find(e.raw());
+    if (it != m_tables->m_to_node.end())
         return it->second;
-    node_ref r = mk_node();
-    m_to_node.insert(mk_pair(e, r));
+    node_ref r = mk_node(e);
+    m_tables->m_to_node.insert(mk_pair(e.raw(), r));
     return r;
 }
 
@@ -6,6 +6,8 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <vector>
+#include <memory>
+#include <unordered_map>
 #include "kernel/expr_maps.h"
 
 namespace lean {
@@ -15,20 +17,43 @@ class equiv_manager {
     struct node {
         node_ref m_parent;
         unsigned m_rank;
+        /* The expression represented by the node, it keeps the key in `m_to_node` alive. */
+        expr     m_expr;
     };
 
-    std::vector<node>  m_nodes;
-    expr_map<node_ref> m_to_node;
-    bool               m_use_hash;
+    struct ptr_hash { size_t operator()(object * o) const { return std::hash<object *>()(o); } };
 
-    node_ref mk_node();
+    /* Node table and index. Nodes are identified by the address of the expressions they represent,
+       structurally equal expressions at different addresses are merged by `is_equiv_core`.
+       Tables are reset and reused by later `equiv_manager` objects of the same thread, see `acquire_tables`. */
+    struct tables {
+        std::vector<node>                                m_nodes;
+        std::unordered_map<object *, node_ref, ptr_hash> m_to_node;
+        void clear() { m_nodes.clear(); m_to_node.clear(); }
+    };
+
+    std::unique_ptr<tables> m_tables;
+    bool                    m_use_hash;
+    uint64                  m_num_finds{0};
+    uint64                  m_num_compressions{0};
+
+    friend struct equiv_manager_pool;
+    static std::unique_ptr<tables> acquire_tables();
+    static void release_tables(std::unique_ptr<tables> t);
+
+    node_ref mk_node(expr const & e);
     node_ref find(node_ref n);
     void merge(node_ref n1, node_ref n2);
     node_ref to_node(expr const & e);
     bool is_equiv_core(expr const & e1, expr const & e2);
 public:
-    equiv_manager():m_use_hash(false) {}
+    equiv_manager():m_tables(acquire_tables()), m_use_hash(false) {}
+    equiv_manager(equiv_manager const &) = delete;
+    ~equiv_manager();
     bool is_equiv(expr const & e1, expr const & e2, bool use_hash = false);
     void add_equiv(expr const & e1, expr const & e2);
+    /** \brief Number of `find` operations, and number of nodes whose parent was updated by path compression. */
+    uint64 get_num_finds() const { return m_num_finds; }
+    uint64 get_num_compressions() const { return m_num_compressions; }
 };
 }
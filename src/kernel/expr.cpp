@@ -39,6 +39,10 @@ literal::literal(nat const & v):
     object_ref(mk_cnstr(static_cast<unsigned>(literal_kind::Nat), v)) {
 }
 
+literal::literal(string_ref const & v):
+    object_ref(mk_cnstr(static_cast<unsigned>(literal_kind::String), v)) {
+}
+
 bool operator==(literal const & a, literal const & b) {
     if (a.kind() != b.kind()) return false;
     switch (a.kind()) {
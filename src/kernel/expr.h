@@ -49,6 +49,7 @@ public:
     explicit literal(unsigned v);
     explicit literal(mpz const & v);
     explicit literal(nat const & v);
+    explicit literal(string_ref const & v);
     literal():literal(0u) {}
     literal(literal const & other):object_ref(other) {}
     literal(literal && other):object_ref(other) {}
@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #pragma once
 #include <vector>
 #include "kernel/expr.h"
+#include "kernel/assoc_cache.h"
 
 namespace lean {
 /** \brief Cache for storing mappings from expressions to expressions.
@@ -28,4 +29,17 @@ public:
     expr * find(expr const & e);
     void clear();
 };
+
+/** \brief Set-associative variant of `expr_cache`, an entry is only overwritten after inserting `Ways`
+    entries whose hash codes are in the same set. */
+template<unsigned Ways = 4>
+class expr_assoc_cache {
+    struct eq_fn { bool operator()(expr const & a, expr const & b) const { return is_bi_equal(a, b); } };
+    assoc_cache<expr, expr, eq_fn, Ways> m_cache;
+public:
+    expr_assoc_cache(unsigned c, cache_counters & counters):m_cache(c, counters) {}
+    void insert(expr const & e, expr const & v) { m_cache.insert(e, hash(e), v); }
+    expr * find(expr const & e) { return m_cache.find(e, hash(e)); }
+    void clear() { m_cache.clear(); }
+};
 }
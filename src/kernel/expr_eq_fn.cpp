@@ -6,17 +6,36 @@ Author: Leonardo de Moura
 */
 #include <vector>
 #include <memory>
+#include <unordered_set>
 #include "runtime/interrupt.h"
 #include "runtime/thread.h"
 #include "kernel/expr.h"
 #include "kernel/expr_sets.h"
+#include "kernel/assoc_cache.h"
 
 #ifndef LEAN_EQ_CACHE_CAPACITY
 #define LEAN_EQ_CACHE_CAPACITY 1024*8
 #endif
 
+/* Number of nodes visited by a single comparison before pairs are also recorded in the exact `visited` set. */
+#ifndef LEAN_EQ_VISITED_THRESHOLD
+#define LEAN_EQ_VISITED_THRESHOLD 1024
+#endif
+
+/* Maximum number of pairs recorded in the `visited` set. */
+#ifndef LEAN_EQ_VISITED_CAPACITY
+#define LEAN_EQ_VISITED_CAPACITY 1024*1024
+#endif
+
 namespace lean {
+static cache_counters g_eq_visited_counters("expr_eq_fn visited");
+
 struct eq_cache {
+    struct ptr_pair_hash {
+        std::size_t operator()(std::pair<object *, object *> const & p) const {
+            return hash(hash_ptr(p.first), hash_ptr(p.second));
+        }
+    };
     struct entry {
         object * m_a;
         object * m_b;
@@ -25,27 +44,52 @@ struct eq_cache {
     unsigned              m_capacity;
     std::vector<entry>    m_cache;
     std::vector<unsigned> m_used;
+    /* Number of nodes visited by the current comparison. */
+    unsigned              m_num_visited{0};
+    /* Exact set of pairs used for large comparisons, where collisions in `m_cache` would make us
+       compare shared subterms over and over again. */
+    std::unordered_set<std::pair<object *, object *>, ptr_pair_hash> m_visited;
+    uint64                m_visited_hits{0};
+    uint64                m_visited_misses{0};
     eq_cache():m_capacity(LEAN_EQ_CACHE_CAPACITY), m_cache(LEAN_EQ_CACHE_CAPACITY) {}
 
+    /* Return true if `(a, b)` is already being compared. We do not need to wait for the result,
+       since the whole comparison fails if any pair is not equal. */
     bool check(expr const & a, expr const & b) {
         if (!is_shared(a) || !is_shared(b))
             return false;
+        m_num_visited++;
         unsigned i = hash(hash(a), hash(b)) % m_capacity;
         if (m_cache[i].m_a == a.raw() && m_cache[i].m_b == b.raw()) {
             return true;
-        } else {
-            if (m_cache[i].m_a == nullptr)
-                m_used.push_back(i);
-            m_cache[i].m_a = a.raw();
-            m_cache[i].m_b = b.raw();
-            return false;
+        } else if (m_num_visited > LEAN_EQ_VISITED_THRESHOLD && m_visited.size() < LEAN_EQ_VISITED_CAPACITY) {
+            if (!m_visited.insert(std::make_pair(a.raw(), b.raw())).second) {
+                m_visited_hits++;
+                return true;
+            }
+            m_visited_misses++;
         }
+        if (m_cache[i].m_a == nullptr)
+            m_used.push_back(i);
+        m_cache[i].m_a = a.raw();
+        m_cache[i].m_b = b.raw();
+        return false;
     }
 
     void clear() {
         for (unsigned i : m_used)
             m_cache[i].m_a = nullptr;
         m_used.clear();
+        m_num_visited = 0;
+        if (!m_visited.empty()) {
+            m_visited.clear();
+            if (get_cache_stats_enabled()) {
+                g_eq_visited_counters.m_hits   += m_visited_hits;
+                g_eq_visited_counters.m_misses += m_visited_misses;
+            }
+            m_visited_hits   = 0;
+            m_visited_misses = 0;
+        }
     }
 };
 
@@ -4,8 +4,15 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <exception>
+#include <functional>
 #include "runtime/sstream.h"
 #include "runtime/utf8.h"
+#include "runtime/thread.h"
+#include "runtime/interrupt.h"
 #include "util/name_generator.h"
 #include "kernel/environment.h"
 #include "kernel/type_checker.h"
@@ -121,6 +128,20 @@ optional<recursor_rule> get_rec_rule_for(recursor_val const & rec_val, expr cons
 }
 
 /* Auxiliary class for adding a mutual inductive datatype declaration. */
+/* Constructors are checked, and their recursor rules are created, in parallel if the declaration has at least
+   this many constructors. */
+static unsigned const g_min_parallel_cnstrs = 64;
+
+/* Run `fn` and report the time it took as `phase` if kernel statistics are enabled. */
+template<typename F> static void timed_phase(char const * phase, F const & fn) {
+    if (!get_kernel_stats_enabled()) {
+        fn();
+        return;
+    }
+    xtimeit timer([&](second_duration d) { report_kernel_phase_time(phase, d); });
+    fn();
+}
+
 class add_inductive_fn {
     environment            m_env;
     name_generator         m_ngen;
@@ -396,49 +417,128 @@ public:
         }
     }
 
-    /** \brief Check whether the constructor declarations are type correct, parameters are in the expected positions,
-        constructor fields are in acceptable universe levels, positivity constraints, and returns the expected result. */
+    /** \brief Mark the objects that are shared by the copies of this object used by `parallel_for` as multi-threaded. */
+    void mark_shared() {
+        mark_mt(m_env.raw());
+        mark_mt(m_lctx.raw());
+        mark_mt(m_lparams.raw());
+        mark_mt(m_levels.raw());
+        mark_mt(m_result_level.raw());
+        mark_mt(m_elim_level.raw());
+        for (inductive_type const & ind_type : m_ind_types) mark_mt(ind_type.raw());
+        for (expr const & e : m_params) mark_mt(e.raw());
+        for (expr const & e : m_ind_cnsts) mark_mt(e.raw());
+        for (rec_info const & info : m_rec_infos) {
+            mark_mt(info.m_C.raw());
+            mark_mt(info.m_major.raw());
+            for (expr const & e : info.m_minors) mark_mt(e.raw());
+            for (expr const & e : info.m_indices) mark_mt(e.raw());
+        }
+    }
+
+    /** \brief Run `fn(worker, i)` for all `i < n`, where `worker` is a copy of this object with its own local context
+        and name generator, so the local declarations created by `fn` are not visible in this object.
+        If `n >= g_min_parallel_cnstrs`, the calls are distributed over multiple threads. `fn` must only share
+        objects with other calls that are reachable from this object or are marked as multi-threaded.
+        If some calls fail, the exception of the call with the smallest `i` is rethrown, and the calls with larger `i`
+        that have not started yet are skipped. Interrupts are checked by the calling thread between its calls, which
+        cancels all remaining calls. */
+    void parallel_for(unsigned n, std::function<void(add_inductive_fn &, unsigned)> const & fn) {
+        unsigned num_threads = n < g_min_parallel_cnstrs ? 1 : std::min(n, std::max(1u, hardware_concurrency()));
+        std::vector<std::unique_ptr<add_inductive_fn>> workers;
+        if (num_threads > 1)
+            mark_shared();
+        for (unsigned t = 0; t < num_threads; t++) {
+            workers.emplace_back(new add_inductive_fn(*this));
+            workers.back()->m_ngen = m_ngen.mk_child();
+        }
+        atomic<bool> canceled(false);
+        std::exception_ptr interrupt, error;
+        try {
+            lean::parallel_for(n, num_threads, [&](size_t t, size_t i) {
+                if (canceled.load())
+                    return;
+                if (t == 0) {
+                    // the interrupt flag and the task of the caller are thread-local
+                    try {
+                        check_system("inductive");
+                    } catch (...) {
+                        interrupt = std::current_exception();
+                        canceled = true;
+                        return;
+                    }
+                }
+                fn(*workers[t], i);
+            });
+        } catch (...) {
+            error = std::current_exception();
+        }
+        workers.clear();
+        if (interrupt)
+            std::rethrow_exception(interrupt);
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /** \brief Check whether the constructor `cnstr` of the inductive datatype at position `idx` is type correct,
+        parameters are in the expected positions, constructor fields are in acceptable universe levels,
+        positivity constraints, and returns the expected result. */
+    void check_constructor(unsigned idx, constructor const & cnstr) {
+        name const & n = constructor_name(cnstr);
+        expr t = constructor_type(cnstr);
+        m_env.check_name(n);
+        check_no_metavar_no_fvar(m_env, n, t);
+        tc().check(t, m_lparams);
+        unsigned i = 0;
+        while (is_pi(t)) {
+            if (i < m_nparams) {
+                if (!is_def_eq(binding_domain(t), get_param_type(i)))
+                    throw kernel_exception(m_env, sstream() << "arg #" << (i + 1) << " of '" << n << "' "
+                                           << "does not match inductive datatypes parameters'");
+                t = instantiate(binding_body(t), m_params[i]);
+            } else {
+                expr s = tc().ensure_type(binding_domain(t));
+                // the sort is ok IF
+                //   1- its level is <= inductive datatype level, OR
+                //   2- is an inductive predicate
+                if (!(is_geq(m_result_level, sort_level(s)) || is_zero(m_result_level))) {
+                    throw kernel_exception(m_env, sstream() << "universe level of type_of(arg #" << (i + 1) << ") "
+                                           << "of '" << n << "' is too big for the corresponding inductive datatype");
+                }
+                if (!m_is_unsafe)
+                    check_positivity(binding_domain(t), n, i);
+                expr local = mk_local_decl_for(t);
+                t = instantiate(binding_body(t), local);
+            }
+            i++;
+        }
+        if (!is_valid_ind_app(t, idx))
+            throw kernel_exception(m_env, sstream() << "invalid return type for '" << n << "'");
+    }
+
+    /** \brief Check all constructor declarations, see `check_constructor`. */
     void check_constructors() {
-        for (unsigned idx = 0; idx < m_ind_types.size(); idx++) {
+        buffer<pair<unsigned, constructor>> cnstrs;
+        optional<name> duplicate;
+        for (unsigned idx = 0; idx < m_ind_types.size() && !duplicate; idx++) {
             inductive_type const & ind_type = m_ind_types[idx];
             name_set found_cnstrs;
             for (constructor const & cnstr : ind_type.get_cnstrs()) {
                 name const & n = constructor_name(cnstr);
                 if (found_cnstrs.contains(n)) {
-                    throw kernel_exception(m_env, sstream() << "duplicate constructor name '" << n << "'");
+                    duplicate = n;
+                    break;
                 }
                 found_cnstrs.insert(n);
-                expr t = constructor_type(cnstr);
-                m_env.check_name(n);
-                check_no_metavar_no_fvar(m_env, n, t);
-                tc().check(t, m_lparams);
-                unsigned i = 0;
-                while (is_pi(t)) {
-                    if (i < m_nparams) {
-                        if (!is_def_eq(binding_domain(t), get_param_type(i)))
-                            throw kernel_exception(m_env, sstream() << "arg #" << (i + 1) << " of '" << n << "' "
-                                                   << "does not match inductive datatypes parameters'");
-                        t = instantiate(binding_body(t), m_params[i]);
-                    } else {
-                        expr s = tc().ensure_type(binding_domain(t));
-                        // the sort is ok IF
-                        //   1- its level is <= inductive datatype level, OR
-                        //   2- is an inductive predicate
-                        if (!(is_geq(m_result_level, sort_level(s)) || is_zero(m_result_level))) {
-                            throw kernel_exception(m_env, sstream() << "universe level of type_of(arg #" << (i + 1) << ") "
-                                                   << "of '" << n << "' is too big for the corresponding inductive datatype");
-                        }
-                        if (!m_is_unsafe)
-                            check_positivity(binding_domain(t), n, i);
-                        expr local = mk_local_decl_for(t);
-                        t = instantiate(binding_body(t), local);
-                    }
-                    i++;
-                }
-                if (!is_valid_ind_app(t, idx))
-                    throw kernel_exception(m_env, sstream() << "invalid return type for '" << n << "'");
+                cnstrs.push_back(mk_pair(idx, cnstr));
             }
         }
+        /* Errors in constructors before the duplicate take precedence, as if the constructors were checked in order. */
+        parallel_for(cnstrs.size(), [&](add_inductive_fn & worker, unsigned i) {
+                worker.check_constructor(cnstrs[i].first, cnstrs[i].second);
+            });
+        if (duplicate)
+            throw kernel_exception(m_env, sstream() << "duplicate constructor name '" << *duplicate << "'");
     }
 
     void declare_constructors() {
@@ -691,50 +791,45 @@ public:
             ms.append(m_rec_infos[i].m_minors);
     }
 
-    recursor_rules mk_rec_rules(unsigned d_idx, buffer<expr> const & Cs, buffer<expr> const & minors, unsigned & minor_idx) {
-        inductive_type const & d = m_ind_types[d_idx];
+    /** \brief Return the recursor rule for `cnstr`, whose minor premise is `minors[minor_idx]`. */
+    recursor_rule mk_rec_rule(constructor const & cnstr, buffer<expr> const & Cs, buffer<expr> const & minors, unsigned minor_idx) {
         levels lvls = get_rec_levels();
-        buffer<recursor_rule> rules;
-        for (constructor const & cnstr : d.get_cnstrs()) {
-            buffer<expr> b_u;
-            buffer<expr> u;
-            expr t = constructor_type(cnstr);
-            unsigned i = 0;
-            while (is_pi(t)) {
-                if (i < m_nparams) {
-                    t = instantiate(binding_body(t), m_params[i]);
-                } else {
-                    expr l = mk_local_decl_for(t);
-                    b_u.push_back(l);
-                    if (is_rec_argument(binding_domain(t)))
-                        u.push_back(l);
-                    t = instantiate(binding_body(t), l);
-                }
-                i++;
+        buffer<expr> b_u;
+        buffer<expr> u;
+        expr t = constructor_type(cnstr);
+        unsigned i = 0;
+        while (is_pi(t)) {
+            if (i < m_nparams) {
+                t = instantiate(binding_body(t), m_params[i]);
+            } else {
+                expr l = mk_local_decl_for(t);
+                b_u.push_back(l);
+                if (is_rec_argument(binding_domain(t)))
+                    u.push_back(l);
+                t = instantiate(binding_body(t), l);
             }
-            buffer<expr> v;
-            for (unsigned i = 0; i < u.size(); i++) {
-                expr u_i    = u[i];
-                expr u_i_ty = whnf(infer_type(u_i));
-                buffer<expr> xs;
-                while (is_pi(u_i_ty)) {
-                    expr x = mk_local_decl_for(u_i_ty);
-                    xs.push_back(x);
-                    u_i_ty = whnf(instantiate(binding_body(u_i_ty), x));
-                }
-                buffer<expr> it_indices;
-                unsigned it_idx = get_I_indices(u_i_ty, it_indices);
-                name rec_name   = mk_rec_name(m_ind_types[it_idx].get_name());
-                expr rec_app    = mk_constant(rec_name, lvls);
-                rec_app         = mk_app(mk_app(mk_app(mk_app(mk_app(rec_app, m_params), Cs), minors), it_indices), mk_app(u_i, xs));
-                v.push_back(mk_lambda(xs, rec_app));
+            i++;
+        }
+        buffer<expr> v;
+        for (unsigned i = 0; i < u.size(); i++) {
+            expr u_i    = u[i];
+            expr u_i_ty = whnf(infer_type(u_i));
+            buffer<expr> xs;
+            while (is_pi(u_i_ty)) {
+                expr x = mk_local_decl_for(u_i_ty);
+                xs.push_back(x);
+                u_i_ty = whnf(instantiate(binding_body(u_i_ty), x));
             }
-            expr e_app    = mk_app(mk_app(minors[minor_idx], b_u), v);
-            expr comp_rhs = mk_lambda(m_params, mk_lambda(Cs, mk_lambda(minors, mk_lambda(b_u, e_app))));
-            rules.push_back(recursor_rule(constructor_name(cnstr), b_u.size(), comp_rhs));
-            minor_idx++;
+            buffer<expr> it_indices;
+            unsigned it_idx = get_I_indices(u_i_ty, it_indices);
+            name rec_name   = mk_rec_name(m_ind_types[it_idx].get_name());
+            expr rec_app    = mk_constant(rec_name, lvls);
+            rec_app         = mk_app(mk_app(mk_app(mk_app(mk_app(rec_app, m_params), Cs), minors), it_indices), mk_app(u_i, xs));
+            v.push_back(mk_lambda(xs, rec_app));
         }
-        return recursor_rules(rules);
+        expr e_app    = mk_app(mk_app(minors[minor_idx], b_u), v);
+        expr comp_rhs = mk_lambda(m_params, mk_lambda(Cs, mk_lambda(minors, mk_lambda(b_u, e_app))));
+        return recursor_rule(constructor_name(cnstr), b_u.size(), comp_rhs);
     }
 
     /** \brief Declare recursors. */
@@ -744,6 +839,15 @@ public:
         unsigned nminors   = minors.size();
         unsigned nmotives  = Cs.size();
         names all          = get_all_inductive_names();
+        /* The minor premises are in the same order as the constructors. */
+        buffer<constructor> cnstrs;
+        for (inductive_type const & ind_type : m_ind_types)
+            to_buffer(ind_type.get_cnstrs(), cnstrs);
+        std::vector<recursor_rule> all_rules(cnstrs.size(), recursor_rule(name(), 0, expr()));
+        for (expr const & e : Cs) mark_mt(e.raw());
+        parallel_for(cnstrs.size(), [&](add_inductive_fn & worker, unsigned i) {
+                all_rules[i] = worker.mk_rec_rule(cnstrs[i], Cs, minors, i);
+            });
         unsigned minor_idx = 0;
         for (unsigned d_idx = 0; d_idx < m_ind_types.size(); d_idx++) {
             rec_info const & info = m_rec_infos[d_idx];
@@ -754,7 +858,10 @@ public:
             rec_ty                = mk_pi(Cs, rec_ty);
             rec_ty                = mk_pi(m_params, rec_ty);
             rec_ty                = infer_implicit(rec_ty, true /* strict */);
-            recursor_rules rules  = mk_rec_rules(d_idx, Cs, minors, minor_idx);
+            buffer<recursor_rule> rules_buffer;
+            for (unsigned j = 0; j < length(m_ind_types[d_idx].get_cnstrs()); j++)
+                rules_buffer.push_back(all_rules[minor_idx++]);
+            recursor_rules rules(rules_buffer);
             name rec_name         = mk_rec_name(m_ind_types[d_idx].get_name());
             names rec_lparams     = get_rec_lparams();
             m_env.add_core(constant_info(recursor_val(rec_name, rec_lparams, rec_ty, all,
@@ -765,14 +872,13 @@ public:
 
     environment operator()() {
         m_env.check_duplicated_univ_params(m_lparams);
-        check_inductive_types();
-        declare_inductive_types();
-        check_constructors();
+        timed_phase("add_inductive: check types", [&]() { check_inductive_types(); });
+        timed_phase("add_inductive: declare types", [&]() { declare_inductive_types(); });
+        timed_phase("add_inductive: check constructors", [&]() { check_constructors(); });
         declare_constructors();
-        init_elim_level();
-        init_K_target();
-        mk_rec_infos();
-        declare_recursors();
+        timed_phase("add_inductive: elimination level", [&]() { init_elim_level(); init_K_target(); });
+        timed_phase("add_inductive: recursor infos", [&]() { mk_rec_infos(); });
+        timed_phase("add_inductive: recursors", [&]() { declare_recursors(); });
         return m_env;
     }
 };
@@ -12,6 +12,8 @@ Author: Leonardo de Moura
 #include "kernel/local_ctx.h"
 #include "kernel/inductive.h"
 #include "kernel/quot.h"
+#include "kernel/closed_term_cache.h"
+#include "kernel/decl_cache.h"
 
 namespace lean {
 void initialize_kernel_module() {
@@ -19,6 +21,8 @@ void initialize_kernel_module() {
     initialize_expr();
     initialize_declaration();
     initialize_type_checker();
+    initialize_closed_term_cache();
+    initialize_decl_cache();
     initialize_environment();
     initialize_local_ctx();
     initialize_inductive();
@@ -30,6 +34,8 @@ void finalize_kernel_module() {
     finalize_inductive();
     finalize_local_ctx();
     finalize_environment();
+    finalize_decl_cache();
+    finalize_closed_term_cache();
     finalize_type_checker();
     finalize_declaration();
     finalize_expr();
@@ -213,6 +213,55 @@ expr cheap_beta_reduce(expr const & e) {
     }
 }
 
+/* Implementation of `instantiate_beta` and `instantiate_rev_beta`. `lift` is the number of binders between
+   the root of the term being instantiated and `a`, i.e., the amount by which loose bound variables in `subst`
+   must be lifted in addition to the binders inside `a`. */
+static expr instantiate_beta_core(expr const & a, unsigned s, unsigned n, expr const * subst, bool rev, unsigned lift) {
+    if (s >= get_loose_bvar_range(a) || n == 0)
+        return a;
+    auto get_subst = [=](unsigned i) -> expr const & { return subst[rev ? n - i - 1 : i]; };
+    return replace(a, [=](expr const & m, unsigned offset) -> optional<expr> {
+            unsigned s1 = s + offset;
+            if (s1 < s)
+                return some_expr(m); // overflow, vidx can't be >= max unsigned
+            if (s1 >= get_loose_bvar_range(m))
+                return some_expr(m); // expression m does not contain loose bound variables with idx >= s1
+            unsigned h = s1 + n;
+            if (is_bvar(m)) {
+                nat const & vidx = bvar_idx(m);
+                if (vidx >= s1) {
+                    if (h < s1 /* overflow, h is bigger than any vidx */ || vidx < h) {
+                        return some_expr(lift_loose_bvars(get_subst(vidx.get_small_value() - s1), offset + lift));
+                    } else {
+                        return some_expr(mk_bvar(vidx - nat(n)));
+                    }
+                }
+            } else if (is_app(m)) {
+                expr const & fn = get_app_fn(m);
+                if (is_bvar(fn) && bvar_idx(fn) >= s1 && (h < s1 || bvar_idx(fn) < h)) {
+                    expr const & v = get_subst(bvar_idx(fn).get_small_value() - s1);
+                    if (is_lambda(v)) {
+                        /* Beta-reduce right away instead of creating the redex `v args` first. */
+                        buffer<expr> args;
+                        get_app_rev_args(m, args);
+                        for (expr & arg : args)
+                            arg = instantiate_beta_core(arg, s1, n, subst, rev, lift + offset);
+                        return some_expr(head_beta_reduce(apply_beta(lift_loose_bvars(v, offset + lift), args.size(), args.data())));
+                    }
+                }
+            }
+            return none_expr();
+        });
+}
+
+expr instantiate_beta(expr const & e, unsigned n, expr const * s) {
+    return instantiate_beta_core(e, 0, n, s, false, 0);
+}
+
+expr instantiate_rev_beta(expr const & e, unsigned n, expr const * s) {
+    return instantiate_beta_core(e, 0, n, s, true, 0);
+}
+
 expr instantiate_lparams(expr const & e, names const & lps, levels const & ls) {
     if (!has_param_univ(e))
         return e;
@@ -24,6 +24,12 @@ inline expr instantiate_rev(expr const & e, buffer<expr> const & s) {
     return instantiate_rev(e, s.size(), s.data());
 }
 
+/** \brief Similar to `instantiate(e, n, s)` and `instantiate_rev(e, n, s)`, but applications `x a_1 ... a_k` where `x`
+    is replaced with a lambda are beta-reduced during the same traversal, which avoids creating and then
+    traversing the redexes. Other redexes in `e` are not reduced. */
+expr instantiate_beta(expr const & e, unsigned n, expr const * s);
+expr instantiate_rev_beta(expr const & e, unsigned n, expr const * s);
+
 expr apply_beta(expr f, unsigned num_rev_args, expr const * rev_args);
 bool is_head_beta(expr const & t);
 expr head_beta_reduce(expr const & t);
@@ -0,0 +1,198 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <unordered_map>
+#include <utility>
+#include "runtime/option_ref.h"
+#include "runtime/array_ref.h"
+#include "runtime/interrupt.h"
+#include "kernel/instantiate.h"
+#include "kernel/abstract.h"
+
+namespace lean {
+/* Accessors for `MetavarContext`, implemented in `src/Lean/MetavarContext.lean`. */
+extern "C" object * lean_get_mvar_assignment(b_obj_arg mctx, b_obj_arg mid);
+extern "C" object * lean_get_delayed_mvar_assignment(b_obj_arg mctx, b_obj_arg mid);
+extern "C" object * lean_assign_mvar(obj_arg mctx, obj_arg mid, obj_arg val);
+extern "C" object * lean_instantiate_level_mvars(obj_arg mctx, obj_arg l);
+
+/** \brief Native version of `instantiateExprMVars`, see `src/Lean/MetavarContext.lean`.
+
+    It produces the same result: assigned metavariables are replaced with their instantiated values,
+    which are written back to the metavariable context, instantiated metavariables in head position are
+    beta-reduced with their arguments, and delayed assignments are applied when the pending metavariable
+    has been fully instantiated. Levels are instantiated by the Lean implementation in order to preserve
+    its simplifications of `max` and `imax`. */
+class instantiate_mvars_fn {
+    object_ref                                                 m_mctx;
+    /* Shared subterms visited so far. The key is kept alive by the first component. */
+    std::unordered_map<lean_object *, std::pair<expr, expr>>   m_cache;
+
+    optional<expr> get_assignment(name const & mid) {
+        option_ref<expr> r(lean_get_mvar_assignment(m_mctx.raw(), mid.raw()));
+        return r.get();
+    }
+
+    void assign(name const & mid, expr const & val) {
+        m_mctx = object_ref(lean_assign_mvar(m_mctx.steal(), mid.to_obj_arg(), val.to_obj_arg()));
+    }
+
+    level visit_level(level const & l) {
+        if (!has_mvar(l))
+            return l;
+        object * r = lean_instantiate_level_mvars(m_mctx.steal(), l.to_obj_arg());
+        m_mctx = object_ref(cnstr_get(r, 0), true);
+        level new_l(cnstr_get(r, 1), true);
+        dec(r);
+        return new_l;
+    }
+
+    levels visit_levels(levels const & ls) {
+        buffer<level> new_ls;
+        bool modified = false;
+        for (level const & l : ls) {
+            level new_l = visit_level(l);
+            if (!is_eqp(new_l, l))
+                modified = true;
+            new_ls.push_back(new_l);
+        }
+        return modified ? levels(new_ls) : ls;
+    }
+
+    expr cache(expr const & e, expr const & r, bool shared) {
+        if (shared)
+            m_cache.insert(mk_pair(e.raw(), mk_pair(e, r)));
+        return r;
+    }
+
+    expr visit_mvar(expr const & e) {
+        name const & mid = mvar_name(e);
+        optional<expr> a = get_assignment(mid);
+        if (!a)
+            return e;
+        if (!has_mvar(*a))
+            return *a;
+        expr new_a = visit(*a);
+        if (!is_eqp(*a, new_a))
+            assign(mid, new_a);
+        return new_a;
+    }
+
+    /* `f args` where `f` has already been visited. */
+    expr visit_args(expr const & e, expr const & f, expr const & new_f, buffer<expr> & args) {
+        bool modified = !is_eqp(f, new_f);
+        for (expr & a : args) {
+            expr new_a = visit(a);
+            if (!is_eqp(a, new_a))
+                modified = true;
+            a = new_a;
+        }
+        return modified ? mk_app(new_f, args.size(), args.data()) : e;
+    }
+
+    /* Same as `Expr.betaRev f args.reverse`. */
+    static expr beta(expr const & f, buffer<expr> const & args) {
+        unsigned sz = args.size();
+        unsigned i  = 0;
+        expr b = f;
+        while (true) {
+            if (is_lambda(b)) {
+                if (i + 1 < sz) {
+                    b = binding_body(b);
+                    i++;
+                } else {
+                    return instantiate_rev(binding_body(b), sz, args.data());
+                }
+            } else if (is_mdata(b)) {
+                b = mdata_expr(b);
+            } else {
+                return mk_app(instantiate_rev(b, i, args.data()), sz - i, args.data() + i);
+            }
+        }
+    }
+
+    expr visit_app(expr const & e) {
+        buffer<expr> args;
+        expr const & f = get_app_args(e, args);
+        if (!is_mvar(f))
+            return visit_args(e, f, visit(f), args);
+        name const & mid = mvar_name(f);
+        object * d = lean_get_delayed_mvar_assignment(m_mctx.raw(), mid.raw());
+        if (is_scalar(d)) {
+            expr new_f = visit_mvar(f);
+            if (is_lambda(new_f))
+                /* Some of the arguments may be irrelevant after beta reduction. */
+                return visit(beta(new_f, args));
+            return visit_args(e, f, new_f, args);
+        }
+        object_ref delayed(cnstr_get(d, 0), true);
+        dec(d);
+        array_ref<expr> fvars(cnstr_get(delayed.raw(), 0), true);
+        name mid_pending(cnstr_get(delayed.raw(), 1), true);
+        if (fvars.size() > args.size())
+            return visit_args(e, f, f, args);
+        expr new_val = visit(mk_mvar(mid_pending));
+        if (has_expr_mvar(new_val))
+            return visit_args(e, f, f, args);
+        for (expr & a : args)
+            a = visit(a);
+        buffer<expr> fvars_buf;
+        for (expr const & x : fvars)
+            fvars_buf.push_back(x);
+        expr r = abstract(new_val, fvars_buf.size(), fvars_buf.data());
+        r = instantiate_rev(r, fvars_buf.size(), args.data());
+        return mk_app(r, args.size() - fvars_buf.size(), args.data() + fvars_buf.size());
+    }
+
+    expr visit(expr const & e) {
+        if (!has_mvar(e))
+            return e;
+        bool shared = false;
+        if (is_shared(e)) {
+            auto it = m_cache.find(e.raw());
+            if (it != m_cache.end())
+                return it->second.second;
+            shared = true;
+        }
+        check_system("instantiate metavariables");
+        switch (e.kind()) {
+        case expr_kind::BVar: case expr_kind::Lit: case expr_kind::FVar:
+            lean_unreachable();
+        case expr_kind::Sort:
+            return cache(e, update_sort(e, visit_level(sort_level(e))), shared);
+        case expr_kind::Const:
+            return cache(e, update_const(e, visit_levels(const_levels(e))), shared);
+        case expr_kind::MVar:
+            return cache(e, visit_mvar(e), shared);
+        case expr_kind::MData:
+            return cache(e, update_mdata(e, visit(mdata_expr(e))), shared);
+        case expr_kind::Proj:
+            return cache(e, update_proj(e, visit(proj_expr(e))), shared);
+        case expr_kind::App:
+            return cache(e, visit_app(e), shared);
+        case expr_kind::Pi: case expr_kind::Lambda:
+            return cache(e, update_binding(e, visit(binding_domain(e)), visit(binding_body(e))), shared);
+        case expr_kind::Let:
+            return cache(e, update_let(e, visit(let_type(e)), visit(let_value(e)), visit(let_body(e))), shared);
+        }
+        lean_unreachable();
+    }
+
+public:
+    explicit instantiate_mvars_fn(obj_arg mctx):m_mctx(mctx) {}
+    expr operator()(expr const & e) { return visit(e); }
+    object * steal_mctx() { return m_mctx.steal(); }
+};
+
+/* instantiateExprMVarsImp (mctx : MetavarContext) (e : Expr) : MetavarContext × Expr */
+extern "C" LEAN_EXPORT object * lean_instantiate_expr_mvars(obj_arg mctx, obj_arg e0) {
+    expr e(e0);
+    instantiate_mvars_fn fn(mctx);
+    expr r = fn(e);
+    object * p = alloc_cnstr(0, 2, 0);
+    cnstr_set(p, 0, fn.steal_mctx());
+    cnstr_set(p, 1, r.steal());
+    return p;
+}
+}
@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #pragma once
 #include "kernel/environment.h"
 #include "kernel/local_ctx.h"
+#include "runtime/interrupt.h"
 
 namespace lean {
 /** \brief Base class for all kernel exceptions. */
@@ -159,11 +160,16 @@ inductive KernelException
 9  | appTypeMismatch  (env : Environment) (lctx : LocalContext) (app : Expr) (funType : Expr) (argType : Expr)
 10 | invalidProj      (env : Environment) (lctx : LocalContext) (proj : Expr)
 11 | other            (msg : String)
+12 | interrupted
 ```
+
+Cancellation of the current task is observed by the kernel's `check_system` calls and reported as `interrupted`,
+so that outdated elaboration tasks stop type checking promptly.
 */
 template<typename A>
 object * catch_kernel_exceptions(std::function<A()> const & f) {
     try {
+        scoped_task_cancellation scope;
         A a = f();
         return mk_cnstr(1, a).steal();
     } catch (unknown_constant_exception & ex) {
@@ -202,6 +208,9 @@ object * catch_kernel_exceptions(std::function<A()> const & f) {
     } catch (exception & ex) {
         // 11 | other            (msg : String)
         return mk_cnstr(0, mk_cnstr(11, string_ref(ex.what()))).steal();
+    } catch (interrupted &) {
+        // 12 | interrupted
+        return mk_cnstr(0, box(12)).steal();
     }
 }
 }
@@ -8,7 +8,9 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include "runtime/debug.h"
+#include "runtime/thread.h"
 #include "runtime/interrupt.h"
 #include "runtime/hash.h"
 #include "runtime/buffer.h"
@@ -480,7 +482,37 @@ level mk_succ(level l, unsigned k) {
     return l;
 }
 
-level normalize(level const & l) {
+struct level_pair_hash {
+    unsigned operator()(level_pair const & p) const { return hash(hash(p.first), hash(p.second)); }
+};
+
+/* The caches are cleared when they reach this number of entries. */
+static unsigned const g_level_cache_capacity = 1u << 16;
+
+/** \brief Memoized results of `normalize` and `is_geq`.
+
+    Normal forms are hash-consed in `m_table`, so equivalent levels have pointer equal normal forms
+    and `normalize(l1) == normalize(l2)` is usually decided by `is_eqp`. */
+struct level_cache {
+    std::unordered_set<level, level_hash>                 m_table;
+    std::unordered_map<level, level, level_hash>          m_normalize;
+    std::unordered_map<level_pair, bool, level_pair_hash> m_is_geq;
+
+    level intern(level const & l) { return *m_table.insert(l).first; }
+
+    void check_capacity() {
+        if (m_table.size() + m_normalize.size() + m_is_geq.size() > g_level_cache_capacity) {
+            m_table.clear();
+            m_normalize.clear();
+            m_is_geq.clear();
+        }
+    }
+};
+
+/* CACHE_RESET: No */
+MK_THREAD_LOCAL_GET_DEF(level_cache, get_level_cache);
+
+static level normalize_core(level const & l) {
     auto p = to_offset(l);
     level const & r = p.first;
     switch (kind(r)) {
@@ -544,6 +576,21 @@ level normalize(level const & l) {
     lean_unreachable(); // LCOV_EXCL_LINE
 }
 
+level normalize(level const & l) {
+    if (is_explicit(l) || is_param(l) || is_mvar(l))
+        return l;
+    level_cache & cache = get_level_cache();
+    auto it = cache.m_normalize.find(l);
+    if (it != cache.m_normalize.end())
+        return it->second;
+    level r = cache.intern(normalize_core(l));
+    cache.check_capacity();
+    cache.m_normalize.insert(mk_pair(l, r));
+    /* normal forms are fixpoints of `normalize` */
+    cache.m_normalize.insert(mk_pair(r, r));
+    return r;
+}
+
 bool is_equivalent(level const & lhs, level const & rhs) {
     check_system("level constraints");
     return lhs == rhs || normalize(lhs) == normalize(rhs);
@@ -569,7 +616,17 @@ bool is_geq_core(level l1, level l2) {
     return false;
 }
 bool is_geq(level const & l1, level const & l2) {
-    return is_geq_core(normalize(l1), normalize(l2));
+    if (is_eqp(l1, l2) || is_zero(l2))
+        return true;
+    level_pair key(l1, l2);
+    level_cache & cache = get_level_cache();
+    auto it = cache.m_is_geq.find(key);
+    if (it != cache.m_is_geq.end())
+        return it->second;
+    bool r = is_geq_core(normalize(l1), normalize(l2));
+    cache.check_capacity();
+    cache.m_is_geq.insert(mk_pair(key, r));
+    return r;
 }
 levels lparams_to_levels(names const & ps) {
     buffer<level> ls;
@@ -124,6 +124,134 @@ expr local_ctx::mk_pi(unsigned num, expr const * fvars, expr const & e, bool rem
     return mk_binding<false>(num, fvars, e, remove_dead_let);
 }
 
+static unsigned const g_empty_slot = std::numeric_limits<unsigned>::max();
+
+void local_ctx_stack::insert_slot(unsigned idx) {
+    unsigned i = static_cast<unsigned>(m_entries[idx].m_name.hash()) & m_mask;
+    while (m_table[i] != g_empty_slot)
+        i = (i + 1) & m_mask;
+    m_table[i] = idx;
+    m_entries[idx].m_slot = i;
+}
+
+void local_ctx_stack::grow() {
+    unsigned capacity = m_table.empty() ? 64 : 2 * m_table.size();
+    m_table.assign(capacity, g_empty_slot);
+    m_mask = capacity - 1;
+    /* reinserting in the original order preserves the invariant used by `pop_to` */
+    for (unsigned i = 0; i < m_entries.size(); i++)
+        insert_slot(i);
+}
+
+expr local_ctx_stack::push(entry && e) {
+    m_entries.push_back(std::move(e));
+    /* keep the load factor below 1/2 */
+    if (2 * m_entries.size() > m_table.size())
+        grow();
+    else
+        insert_slot(m_entries.size() - 1);
+    return mk_fvar(m_entries.back().m_name);
+}
+
+expr local_ctx_stack::mk_local_decl(name_generator & g, name const & un, expr const & type, binder_info bi) {
+    return push(entry{g.next(), un, type, none_expr(), bi, 0});
+}
+
+expr local_ctx_stack::mk_local_decl(name_generator & g, name const & un, expr const & type, expr const & value) {
+    return push(entry{g.next(), un, type, some_expr(value), mk_binder_info(), 0});
+}
+
+void local_ctx_stack::pop_to(unsigned sz) {
+    while (m_entries.size() > sz) {
+        m_table[m_entries.back().m_slot] = g_empty_slot;
+        m_entries.pop_back();
+    }
+}
+
+local_ctx_stack::entry const * local_ctx_stack::find(expr const & fvar) const {
+    if (m_entries.empty())
+        return nullptr;
+    name const & n = fvar_name(fvar);
+    unsigned i = static_cast<unsigned>(n.hash()) & m_mask;
+    while (m_table[i] != g_empty_slot) {
+        entry const & e = m_entries[m_table[i]];
+        if (e.m_name == n)
+            return &e;
+        i = (i + 1) & m_mask;
+    }
+    return nullptr;
+}
+
+optional<expr> local_ctx_stack::find_type(expr const & fvar) const {
+    if (entry const * e = find(fvar))
+        return some_expr(e->m_type);
+    if (optional<local_decl> decl = m_base.find_local_decl(fvar))
+        return some_expr(decl->get_type());
+    return none_expr();
+}
+
+optional<expr> local_ctx_stack::find_value(expr const & fvar) const {
+    if (entry const * e = find(fvar))
+        return e->m_value;
+    if (optional<local_decl> decl = m_base.find_local_decl(fvar))
+        return decl->get_value();
+    return none_expr();
+}
+
+bool local_ctx_stack::is_let_fvar(expr const & fvar) const {
+    return static_cast<bool>(find_value(fvar));
+}
+
+local_ctx local_ctx_stack::to_local_ctx() const {
+    local_ctx r = m_base;
+    for (entry const & e : m_entries) {
+        if (e.m_value)
+            r.mk_local_decl(e.m_name, e.m_user_name, e.m_type, *e.m_value);
+        else
+            r.mk_local_decl(e.m_name, e.m_user_name, e.m_type, e.m_bi);
+    }
+    return r;
+}
+
+template<bool is_lambda>
+expr local_ctx_stack::mk_binding(unsigned num, expr const * fvars, expr const & b, bool remove_dead_let) const {
+    /* Binders for free variables of the base context are rare, we handle them using `local_ctx::mk_binding`. */
+    for (unsigned i = 0; i < num; i++) {
+        if (!find(fvars[i]))
+            return is_lambda ? to_local_ctx().mk_lambda(num, fvars, b, remove_dead_let) : to_local_ctx().mk_pi(num, fvars, b, remove_dead_let);
+    }
+    expr r     = abstract(b, num, fvars);
+    unsigned i = num;
+    while (i > 0) {
+        --i;
+        entry const & decl = *find(fvars[i]);
+        if (decl.m_value) {
+            if (!remove_dead_let || has_loose_bvar(r, 0)) {
+                expr type  = abstract(decl.m_type, i, fvars);
+                expr value = abstract(*decl.m_value, i, fvars);
+                r = ::lean::mk_let(decl.m_user_name, type, value, r);
+            } else {
+                r = lower_loose_bvars(r, 1, 1);
+            }
+        } else if (is_lambda) {
+            expr type = abstract(decl.m_type, i, fvars);
+            r = ::lean::mk_lambda(decl.m_user_name, type, r, decl.m_bi);
+        } else {
+            expr type = abstract(decl.m_type, i, fvars);
+            r = ::lean::mk_pi(decl.m_user_name, type, r, decl.m_bi);
+        }
+    }
+    return r;
+}
+
+expr local_ctx_stack::mk_lambda(buffer<expr> const & fvars, expr const & e, bool remove_dead_let) const {
+    return mk_binding<true>(fvars.size(), fvars.data(), e, remove_dead_let);
+}
+
+expr local_ctx_stack::mk_pi(buffer<expr> const & fvars, expr const & e, bool remove_dead_let) const {
+    return mk_binding<false>(fvars.size(), fvars.data(), e, remove_dead_let);
+}
+
 void initialize_local_ctx() {
     g_dummy_type   = new expr(mk_constant(name::mk_internal_unique_name()));
     mark_persistent(g_dummy_type->raw());
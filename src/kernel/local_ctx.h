@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
+#include <vector>
 #include "util/name_generator.h"
 #include "util/rb_map.h"
 #include "util/name_map.h"
@@ -101,6 +102,69 @@ public:
     expr mk_pi(std::initializer_list<expr> const & fvars, expr const & e) { return mk_pi(fvars.size(), fvars.begin(), e); }
 };
 
+/** \brief Local context extended with a stack of local declarations.
+
+    The kernel type checker introduces a local declaration for every binder it visits, and removes it
+    when it is done with the binder. Adding these declarations to a `local_ctx` allocates a node in its
+    persistent map for each one. Instead, we store them in an array and index them using an open addressing
+    hash table. Declarations must be removed in LIFO order (see `scope`), which allows us to remove
+    entries from the hash table without tombstones: a declaration is only removed after all declarations
+    added after it, so no other probe sequence can pass through its slot.
+
+    Declarations of the base local context are still available, and `to_local_ctx` converts it back into a
+    `local_ctx` (e.g., for error messages). */
+class local_ctx_stack {
+    struct entry {
+        name           m_name;
+        name           m_user_name;
+        expr           m_type;
+        optional<expr> m_value;
+        binder_info    m_bi;
+        unsigned       m_slot;
+    };
+    local_ctx             m_base;
+    std::vector<entry>    m_entries;
+    /* Open addressing hash table from the names of the free variables to positions in `m_entries`. */
+    std::vector<unsigned> m_table;
+    unsigned              m_mask{0};
+
+    void insert_slot(unsigned idx);
+    void grow();
+    entry const * find(expr const & fvar) const;
+    expr push(entry && e);
+    template<bool is_lambda> expr mk_binding(unsigned num, expr const * fvars, expr const & b, bool remove_dead_let) const;
+public:
+    explicit local_ctx_stack(local_ctx const & base):m_base(base) {}
+
+    unsigned size() const { return m_entries.size(); }
+    /** \brief Remove the declarations added after the first `sz` ones. */
+    void pop_to(unsigned sz);
+
+    expr mk_local_decl(name_generator & g, name const & un, expr const & type, binder_info bi = mk_binder_info());
+    expr mk_local_decl(name_generator & g, name const & un, expr const & type, expr const & value);
+
+    /** \brief Return the type of the given free variable, or `none` if it is not in the context. */
+    optional<expr> find_type(expr const & fvar) const;
+    /** \brief Return `true` if the given free variable is in the context and has a value. */
+    bool is_let_fvar(expr const & fvar) const;
+    /** \brief Return the value of the given free variable (if it is a let-variable in the context). */
+    optional<expr> find_value(expr const & fvar) const;
+
+    local_ctx to_local_ctx() const;
+
+    expr mk_lambda(buffer<expr> const & fvars, expr const & e, bool remove_dead_let = false) const;
+    expr mk_pi(buffer<expr> const & fvars, expr const & e, bool remove_dead_let = false) const;
+
+    /** \brief Remove the declarations added while this object is alive. */
+    class scope {
+        local_ctx_stack & m_stack;
+        unsigned          m_old_size;
+    public:
+        explicit scope(local_ctx_stack & s):m_stack(s), m_old_size(s.size()) {}
+        ~scope() { m_stack.pop_to(m_old_size); }
+    };
+};
+
 void initialize_local_ctx();
 void finalize_local_ctx();
 }
@@ -9,9 +9,57 @@ Author: Leonardo de Moura
 #include <functional>
 #include "runtime/interrupt.h"
 #include "runtime/buffer.h"
-#include "library/max_sharing.h"
+#include "runtime/thread.h"
+#include "kernel/max_sharing.h"
 
 namespace lean {
+struct max_sharing_table::shard {
+    mutex                                                        m_mutex;
+    std::unordered_set<expr, expr_hash, is_bi_equal_proc>        m_exprs;
+    std::unordered_set<level, level_hash>                        m_levels;
+};
+
+max_sharing_table::max_sharing_table(unsigned capacity, unsigned num_shards):m_capacity(capacity) {
+    for (unsigned i = 0; i < num_shards; i++)
+        m_shards.emplace_back(new shard());
+}
+
+max_sharing_table::~max_sharing_table() {}
+
+expr max_sharing_table::intern(expr const & e) {
+    shard & s = *m_shards[hash(e) % m_shards.size()];
+    lock_guard<mutex> lock(s.m_mutex);
+    auto it = s.m_exprs.find(e);
+    if (it != s.m_exprs.end())
+        return *it;
+    if (s.m_exprs.size() >= m_capacity)
+        s.m_exprs.clear();
+    mark_mt(e.raw());
+    s.m_exprs.insert(e);
+    return e;
+}
+
+level max_sharing_table::intern(level const & l) {
+    shard & s = *m_shards[hash(l) % m_shards.size()];
+    lock_guard<mutex> lock(s.m_mutex);
+    auto it = s.m_levels.find(l);
+    if (it != s.m_levels.end())
+        return *it;
+    if (s.m_levels.size() >= m_capacity)
+        s.m_levels.clear();
+    mark_mt(l.raw());
+    s.m_levels.insert(l);
+    return l;
+}
+
+void max_sharing_table::clear() {
+    for (auto & s : m_shards) {
+        lock_guard<mutex> lock(s->m_mutex);
+        s->m_exprs.clear();
+        s->m_levels.clear();
+    }
+}
+
 /**
    \brief Implementation of the functional object for creating expressions with maximally
    shared sub-expressions.
@@ -19,8 +67,12 @@ namespace lean {
 struct max_sharing_fn::imp {
     typedef typename std::unordered_set<expr, expr_hash, is_bi_equal_proc> expr_cache;
     typedef typename std::unordered_set<level, level_hash>                 level_cache;
-    expr_cache  m_expr_cache;
-    level_cache m_lvl_cache;
+    expr_cache          m_expr_cache;
+    level_cache         m_lvl_cache;
+    max_sharing_table * m_table{nullptr};
+
+    imp() {}
+    explicit imp(max_sharing_table * t):m_table(t) {}
 
     level apply(level const & l) {
         auto r = m_lvl_cache.find(l);
@@ -42,6 +94,8 @@ struct max_sharing_fn::imp {
             res = update_max(l, apply(imax_lhs(l)), apply(imax_rhs(l)));
             break;
         }
+        if (m_table)
+            res = m_table->intern(res);
         m_lvl_cache.insert(res);
         return res;
     }
@@ -93,6 +147,8 @@ struct max_sharing_fn::imp {
             break;
         }
         }
+        if (m_table)
+            res = m_table->intern(res);
         m_expr_cache.insert(res);
         return res;
     }
@@ -108,6 +164,7 @@ struct max_sharing_fn::imp {
 };
 
 max_sharing_fn::max_sharing_fn():m_ptr(new imp) {}
+max_sharing_fn::max_sharing_fn(max_sharing_table & t):m_ptr(new imp(&t)) {}
 max_sharing_fn::~max_sharing_fn() {}
 expr max_sharing_fn::operator()(expr const & a) { return (*m_ptr)(a); }
 void max_sharing_fn::clear() { m_ptr->m_expr_cache.clear(); }
@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2013 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: Leonardo de Moura
+*/
+#pragma once
+#include <memory>
+#include <vector>
+#include "kernel/expr.h"
+
+namespace lean {
+/**
+   \brief Thread-safe table of maximally shared expressions and levels that can be used by many
+   `max_sharing_fn` objects, possibly running in different threads. Then, the sharing cost is paid only
+   once for each distinct subterm, and terms processed by different calls share their common subterms.
+
+   The table is split into shards protected by their own lock. A shard is flushed when it contains
+   more than `capacity` entries. All objects in the table are marked as multi-threaded.
+*/
+class max_sharing_table {
+    struct shard;
+    std::vector<std::unique_ptr<shard>> m_shards;
+    unsigned                            m_capacity;
+public:
+    explicit max_sharing_table(unsigned capacity = 1u << 16, unsigned num_shards = 16);
+    ~max_sharing_table();
+    /** \brief Return the representative of `e` in the table, adding `e` if there is none.
+        \pre The children of `e` are representatives. */
+    expr intern(expr const & e);
+    /** \brief Return the representative of `l` in the table, adding `l` if there is none.
+        \pre The children of `l` are representatives. */
+    level intern(level const & l);
+    void clear();
+};
+
+/**
+   \brief Functional object for creating expressions with maximally
+   shared sub-expressions.
+*/
+class max_sharing_fn {
+    struct imp;
+    friend expr max_sharing(expr const & a);
+    std::unique_ptr<imp> m_ptr;
+public:
+    max_sharing_fn();
+    /** \brief Use `t` to share subterms with the terms processed by other users of `t`. */
+    explicit max_sharing_fn(max_sharing_table & t);
+    ~max_sharing_fn();
+
+    expr operator()(expr const & a);
+
+    /** \brief Return true iff \c a was already processed by this object. */
+    bool already_processed(expr const & a) const;
+
+    /** \brief Clear the cache. */
+    void clear();
+};
+
+/**
+   \brief The resultant expression is structurally identical to the input one, but
+   it uses maximally shared sub-expressions.
+*/
+expr max_sharing(expr const & a);
+}
@@ -8,48 +8,42 @@ Author: Leonardo de Moura
 #include <memory>
 #include "kernel/replace_fn.h"
 #include "kernel/cache_stack.h"
+#include "kernel/assoc_cache.h"
 
 #ifndef LEAN_DEFAULT_REPLACE_CACHE_CAPACITY
 #define LEAN_DEFAULT_REPLACE_CACHE_CAPACITY 1024*8
 #endif
 
 namespace lean {
+/* Number of entries per set of `replace_cache`, 1 makes it a direct-mapped cache. */
+#ifndef LEAN_DEFAULT_REPLACE_CACHE_WAYS
+#define LEAN_DEFAULT_REPLACE_CACHE_WAYS 4
+#endif
+
+static cache_counters g_replace_cache_counters("replace");
+
 struct replace_cache {
-    struct entry {
-        object  *  m_cell;
+    struct key {
+        object *   m_cell;
         unsigned   m_offset;
-        expr       m_result;
-        entry():m_cell(nullptr) {}
+        key():m_cell(nullptr), m_offset(0) {}
+        key(object * cell, unsigned offset):m_cell(cell), m_offset(offset) {}
     };
-    unsigned              m_capacity;
-    std::vector<entry>    m_cache;
-    std::vector<unsigned> m_used;
-    replace_cache(unsigned c):m_capacity(c), m_cache(c) {}
+    struct key_eq_fn {
+        bool operator()(key const & k1, key const & k2) const { return k1.m_cell == k2.m_cell && k1.m_offset == k2.m_offset; }
+    };
+    assoc_cache<key, expr, key_eq_fn, LEAN_DEFAULT_REPLACE_CACHE_WAYS> m_cache;
+    replace_cache(unsigned c):m_cache(c, g_replace_cache_counters) {}
 
     expr * find(expr const & e, unsigned offset) {
-        unsigned i = hash(hash(e), offset) % m_capacity;
-        if (m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset)
-            return &m_cache[i].m_result;
-        else
-            return nullptr;
+        return m_cache.find(key(e.raw(), offset), hash(hash(e), offset));
     }
 
     void insert(expr const & e, unsigned offset, expr const & v) {
-        unsigned i = hash(hash(e), offset) % m_capacity;
-        if (m_cache[i].m_cell == nullptr)
-            m_used.push_back(i);
-        m_cache[i].m_cell   = e.raw();
-        m_cache[i].m_offset = offset;
-        m_cache[i].m_result = v;
+        m_cache.insert(key(e.raw(), offset), hash(hash(e), offset), v);
     }
 
-    void clear() {
-        for (unsigned i : m_used) {
-            m_cache[i].m_cell   = nullptr;
-            m_cache[i].m_result = expr();
-        }
-        m_used.clear();
-    }
+    void clear() { m_cache.clear(); }
 };
 
 /* CACHE_RESET: NO */
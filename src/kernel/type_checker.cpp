@@ -6,9 +6,16 @@ Author: Leonardo de Moura
 */
 #include <utility>
 #include <vector>
+#include <algorithm>
+#include <sstream>
+#include <map>
+#include <string>
 #include "runtime/interrupt.h"
+#include "runtime/thread.h"
+#include "runtime/io.h"
 #include "runtime/sstream.h"
 #include "runtime/flet.h"
+#include "runtime/utf8.h"
 #include "util/lbool.h"
 #include "kernel/type_checker.h"
 #include "kernel/expr_maps.h"
@@ -19,6 +26,8 @@ Author: Leonardo de Moura
 #include "kernel/for_each_fn.h"
 #include "kernel/quot.h"
 #include "kernel/inductive.h"
+#include "kernel/closed_term_cache.h"
+#include "kernel/assoc_cache.h"
 
 namespace lean {
 static name * g_kernel_fresh = nullptr;
@@ -33,9 +42,178 @@ static expr * g_nat_mod      = nullptr;
 static expr * g_nat_div      = nullptr;
 static expr * g_nat_beq      = nullptr;
 static expr * g_nat_ble      = nullptr;
+static expr * g_nat_pow      = nullptr;
+static expr * g_nat_gcd      = nullptr;
+static expr * g_nat_log2     = nullptr;
+static expr * g_nat_land     = nullptr;
+static expr * g_nat_lor      = nullptr;
+static expr * g_nat_xor      = nullptr;
+static expr * g_nat_shiftl   = nullptr;
+static expr * g_nat_shiftr   = nullptr;
+static expr * g_string_length = nullptr;
+static expr * g_string_utf8_byte_size = nullptr;
+static expr * g_string_append = nullptr;
+static expr * g_string_get    = nullptr;
+static expr * g_string_dec_eq = nullptr;
+static expr * g_string_pos_mk = nullptr;
+static expr * g_char_of_nat   = nullptr;
+static expr * g_char_default  = nullptr;
+static expr * g_decidable_is_true = nullptr;
+static expr * g_eq_refl_string = nullptr;
+static expr * g_string        = nullptr;
+static expr * g_eq_string     = nullptr;
+
+static atomic<bool> g_kernel_stats_enabled{false};
+static mutex *       g_kernel_stats_mutex = nullptr;
+static kernel_stats * g_kernel_stats      = nullptr;
+static std::map<std::string, second_duration> * g_kernel_phase_times = nullptr;
+
+void kernel_stats::merge(kernel_stats const & o) {
+    m_infer              += o.m_infer;
+    m_infer_hits         += o.m_infer_hits;
+    m_whnf_core          += o.m_whnf_core;
+    m_whnf_core_hits     += o.m_whnf_core_hits;
+    m_whnf               += o.m_whnf;
+    m_whnf_hits          += o.m_whnf_hits;
+    m_closed_hits        += o.m_closed_hits;
+    m_lazy_delta_steps   += o.m_lazy_delta_steps;
+    m_failed_before_hits += o.m_failed_before_hits;
+    m_offset_hits        += o.m_offset_hits;
+    m_reduce_nat_hits    += o.m_reduce_nat_hits;
+    m_eqv_finds          += o.m_eqv_finds;
+    m_eqv_compressions   += o.m_eqv_compressions;
+    m_max_sharing        += o.m_max_sharing;
+    m_max_sharing_before += o.m_max_sharing_before;
+    m_max_sharing_after  += o.m_max_sharing_after;
+    for (auto const & p : o.m_unfold)
+        m_unfold[p.first] += p.second;
+}
+
+void set_kernel_stats_enabled(bool enabled) {
+    g_kernel_stats_enabled = enabled;
+    set_cache_stats_enabled(enabled);
+}
+bool get_kernel_stats_enabled() { return g_kernel_stats_enabled; }
+
+void report_kernel_phase_time(char const * phase, second_duration d) {
+    if (!g_kernel_stats_enabled)
+        return;
+    lock_guard<mutex> lock(*g_kernel_stats_mutex);
+    (*g_kernel_phase_times)[phase] += d;
+}
+
+void report_kernel_max_sharing(uint64 before, uint64 after) {
+    if (!g_kernel_stats_enabled)
+        return;
+    lock_guard<mutex> lock(*g_kernel_stats_mutex);
+    g_kernel_stats->m_max_sharing++;
+    g_kernel_stats->m_max_sharing_before += before;
+    g_kernel_stats->m_max_sharing_after  += after;
+}
+
+static void display_hits(std::ostream & out, char const * what, uint64 calls, uint64 hits) {
+    out << "  " << what << ": " << calls << " calls, " << hits << " cache hits";
+    if (calls > 0)
+        out << " (" << (100 * hits / calls) << "%)";
+    out << "\n";
+}
+
+void display_kernel_stats(std::ostream & out) {
+    lock_guard<mutex> lock(*g_kernel_stats_mutex);
+    kernel_stats const & s = *g_kernel_stats;
+    out << "kernel statistics:\n";
+    display_hits(out, "infer_type", s.m_infer, s.m_infer_hits);
+    display_hits(out, "whnf_core", s.m_whnf_core, s.m_whnf_core_hits);
+    display_hits(out, "whnf", s.m_whnf, s.m_whnf_hits);
+    out << "  closed term cache hits: " << s.m_closed_hits << "\n";
+    out << "  lazy delta reduction steps: " << s.m_lazy_delta_steps << "\n";
+    out << "  failed_before hits: " << s.m_failed_before_hits << "\n";
+    out << "  is_def_eq_offset hits: " << s.m_offset_hits << "\n";
+    out << "  reduce_nat hits: " << s.m_reduce_nat_hits << "\n";
+    out << "  equiv_manager: " << s.m_eqv_finds << " finds, " << s.m_eqv_compressions << " path compressions\n";
+    if (s.m_max_sharing > 0)
+        out << "  max_sharing: " << s.m_max_sharing << " terms, " << s.m_max_sharing_before << " subterms before, "
+            << s.m_max_sharing_after << " after\n";
+    display_cache_stats(out);
+    std::vector<std::pair<name, uint64>> unfolds(s.m_unfold.begin(), s.m_unfold.end());
+    std::sort(unfolds.begin(), unfolds.end(), [](std::pair<name, uint64> const & a, std::pair<name, uint64> const & b) {
+            return a.second > b.second;
+        });
+    if (!unfolds.empty())
+        out << "  most unfolded constants:\n";
+    for (size_t i = 0; i < unfolds.size() && i < 20; i++)
+        out << "    " << unfolds[i].first << " " << unfolds[i].second << "\n";
+    if (!g_kernel_phase_times->empty())
+        out << "  phase times:\n";
+    for (auto const & p : *g_kernel_phase_times)
+        out << "    " << p.first << " " << display_profiling_time{p.second} << "\n";
+}
+
+/* Kernel.setStatsEnabled (enabled : Bool) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_kernel_set_stats_enabled(uint8 enabled, obj_arg) {
+    set_kernel_stats_enabled(enabled);
+    return io_result_mk_ok(box(0));
+}
+
+/* Kernel.getStats : BaseIO String */
+extern "C" LEAN_EXPORT obj_res lean_kernel_stats(obj_arg) {
+    std::ostringstream out;
+    display_kernel_stats(out);
+    return io_result_mk_ok(mk_string(out.str()));
+}
 
 type_checker::state::state(environment const & env):
-    m_env(env), m_ngen(*g_kernel_fresh) {}
+    m_env(env), m_ngen(*g_kernel_fresh), m_closed_scope(closed_term_cache::get_scope(env)) {
+    if (g_kernel_stats_enabled)
+        m_stats.reset(new kernel_stats());
+}
+
+type_checker::state::~state() {
+    if (m_stats) {
+        m_stats->m_eqv_finds        += m_eqv_manager.get_num_finds();
+        m_stats->m_eqv_compressions += m_eqv_manager.get_num_compressions();
+        lock_guard<mutex> lock(*g_kernel_stats_mutex);
+        g_kernel_stats->merge(*m_stats);
+    }
+}
+
+/* Lookup `e` in the process-wide cache for closed terms. This cache survives across type checker instances,
+   see `closed_term_cache`. It is only used in safe mode, since unsafe definitions may be unfolded otherwise. */
+optional<expr> type_checker::find_closed(bool whnf, expr const & e) {
+    if (!m_st->m_closed_scope || !m_safe_only || has_fvar(e) || has_metavar(e))
+        return none_expr();
+    return closed_term_cache::find(m_st->m_closed_scope, whnf ? closed_term_cache::kind::Whnf : closed_term_cache::kind::Infer, e);
+}
+
+void type_checker::cache_closed(bool whnf, expr const & e, expr const & r) {
+    if (!m_st->m_closed_scope || !m_safe_only || !closed_term_cache::is_cacheable(env(), e))
+        return;
+    closed_term_cache::insert(m_st->m_closed_scope, whnf ? closed_term_cache::kind::Whnf : closed_term_cache::kind::Infer, e, r);
+}
+
+/* Return the type (if `value == false`) or value of the constant `info` referenced by `e`, instantiated with the
+   universe levels of `e`. Universe polymorphic constants are often used with the same levels many times, so we
+   memoize the results in the state, and for imported constants in `closed_term_cache`. */
+expr type_checker::instantiate_const_lparams(constant_info const & info, expr const & e, bool value) {
+    if (is_nil(const_levels(e)) || !has_param_univ(value ? info.get_value() : info.get_type()))
+        return value ? instantiate_value_lparams(info, const_levels(e)) : instantiate_type_lparams(info, const_levels(e));
+    expr_map<expr> & cache = m_st->m_inst_lparams[value];
+    auto it = cache.find(e);
+    if (it != cache.end())
+        return it->second;
+    closed_term_cache::kind k = value ? closed_term_cache::kind::Value : closed_term_cache::kind::Type;
+    if (m_st->m_closed_scope && !has_metavar(e)) {
+        if (auto c = closed_term_cache::find(m_st->m_closed_scope, k, e)) {
+            cache.insert(mk_pair(e, *c));
+            return *c;
+        }
+    }
+    expr r = value ? instantiate_value_lparams(info, const_levels(e)) : instantiate_type_lparams(info, const_levels(e));
+    cache.insert(mk_pair(e, r));
+    if (m_st->m_closed_scope && closed_term_cache::is_cacheable(env(), e))
+        closed_term_cache::insert(m_st->m_closed_scope, k, e, r);
+    return r;
+}
 
 /** \brief Make sure \c e "is" a sort, and return the corresponding sort.
     If \c e is not a sort, then the whnf procedure is invoked.
@@ -49,7 +227,7 @@ expr type_checker::ensure_sort_core(expr e, expr const & s) {
     if (is_sort(new_e)) {
         return new_e;
     } else {
-        throw type_expected_exception(env(), m_lctx, s);
+        throw type_expected_exception(env(), m_lctx.to_local_ctx(), s);
     }
 }
 
@@ -61,7 +239,7 @@ expr type_checker::ensure_pi_core(expr e, expr const & s) {
     if (is_pi(new_e)) {
         return new_e;
     } else {
-        throw function_expected_exception(env(), m_lctx, s);
+        throw function_expected_exception(env(), m_lctx.to_local_ctx(), s);
     }
 }
 
@@ -74,8 +252,8 @@ void type_checker::check_level(level const & l) {
 }
 
 expr type_checker::infer_fvar(expr const & e) {
-    if (optional<local_decl> decl = m_lctx.find_local_decl(e)) {
-        return decl->get_type();
+    if (optional<expr> type = m_lctx.find_type(e)) {
+        return *type;
     } else {
         throw kernel_exception(env(), "unknown free variable");
     }
@@ -97,11 +275,11 @@ expr type_checker::infer_constant(expr const & e, bool infer_only) {
         for (level const & l : ls)
             check_level(l);
     }
-    return instantiate_type_lparams(info, ls);
+    return instantiate_const_lparams(info, e, false);
 }
 
 expr type_checker::infer_lambda(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    local_ctx_stack::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     expr e = _e;
     while (is_lambda(e)) {
@@ -119,7 +297,7 @@ expr type_checker::infer_lambda(expr const & _e, bool infer_only) {
 }
 
 expr type_checker::infer_pi(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    local_ctx_stack::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     buffer<level> us;
     expr e = _e;
@@ -148,9 +326,9 @@ expr type_checker::infer_app(expr const & e, bool infer_only) {
         expr a_type = infer_type_core(app_arg(e), infer_only);
         expr d_type = binding_domain(f_type);
         if (!is_def_eq(a_type, d_type)) {
-            throw app_type_mismatch_exception(env(), m_lctx, e, f_type, a_type);
+            throw app_type_mismatch_exception(env(), m_lctx.to_local_ctx(), e, f_type, a_type);
         }
-        return instantiate(binding_body(f_type), app_arg(e));
+        return instantiate_beta(binding_body(f_type), 1, &app_arg(e));
     } else {
         buffer<expr> args;
         expr const & f = get_app_args(e, args);
@@ -161,13 +339,13 @@ expr type_checker::infer_app(expr const & e, bool infer_only) {
             if (is_pi(f_type)) {
                 f_type = binding_body(f_type);
             } else {
-                f_type = instantiate_rev(f_type, i-j, args.data()+j);
+                f_type = instantiate_rev_beta(f_type, i-j, args.data()+j);
                 f_type = ensure_pi_core(f_type, e);
                 f_type = binding_body(f_type);
                 j = i;
             }
         }
-        return instantiate_rev(f_type, nargs-j, args.data()+j);
+        return instantiate_rev_beta(f_type, nargs-j, args.data()+j);
     }
 }
 
@@ -188,7 +366,7 @@ static void mark_used(unsigned n, expr const * fvars, expr const & b, bool * use
 }
 
 expr type_checker::infer_let(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    local_ctx_stack::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     buffer<expr> vals;
     expr e = _e;
@@ -202,7 +380,7 @@ expr type_checker::infer_let(expr const & _e, bool infer_only) {
             ensure_sort_core(infer_type_core(type, infer_only), type);
             expr val_type = infer_type_core(val, infer_only);
             if (!is_def_eq(val_type, type)) {
-                throw def_type_mismatch_exception(env(), m_lctx, let_name(e), val_type, type);
+                throw def_type_mismatch_exception(env(), m_lctx.to_local_ctx(), let_name(e), val_type, type);
             }
         }
         e = let_body(e);
@@ -229,47 +407,47 @@ expr type_checker::infer_let(expr const & _e, bool infer_only) {
 expr type_checker::infer_proj(expr const & e, bool infer_only) {
     expr type = whnf(infer_type_core(proj_expr(e), infer_only));
     if (!proj_idx(e).is_small())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     unsigned idx = proj_idx(e).get_small_value();
     buffer<expr> args;
     expr const & I = get_app_args(type, args);
     if (!is_constant(I))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     name const & I_name  = const_name(I);
     if (I_name != proj_sname(e))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     constant_info I_info = env().get(I_name);
     if (!I_info.is_inductive())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     inductive_val I_val = I_info.to_inductive_val();
     if (length(I_val.get_cnstrs()) != 1 || args.size() != I_val.get_nparams() + I_val.get_nindices())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
 
     constant_info c_info = env().get(head(I_val.get_cnstrs()));
     expr r = instantiate_type_lparams(c_info, const_levels(I));
     for (unsigned i = 0; i < I_val.get_nparams(); i++) {
         lean_assert(i < args.size());
         r = whnf(r);
-        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
         r = instantiate(binding_body(r), args[i]);
     }
     bool is_prop_type = is_prop(type);
     for (unsigned i = 0; i < idx; i++) {
         r = whnf(r);
-        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
         if (has_loose_bvars(binding_body(r))) {
             if (is_prop_type && !is_prop(binding_domain(r)))
-                throw invalid_proj_exception(env(), m_lctx, e);
+                throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
             r = instantiate(binding_body(r), mk_proj(I_name, i, proj_expr(e)));
         } else {
             r = binding_body(r);
         }
     }
     r = whnf(r);
-    if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+    if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     r = binding_domain(r);
     if (is_prop_type && !is_prop(r))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     return r;
 }
 
@@ -282,9 +460,19 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     lean_assert(!has_loose_bvars(e));
     check_system("type checker");
 
+    if (auto s = stats()) s->m_infer++;
     auto it = m_st->m_infer_type[infer_only].find(e);
-    if (it != m_st->m_infer_type[infer_only].end())
+    if (it != m_st->m_infer_type[infer_only].end()) {
+        if (auto s = stats()) s->m_infer_hits++;
         return it->second;
+    }
+    if (infer_only) {
+        if (auto r = find_closed(false, e)) {
+            if (auto s = stats()) s->m_closed_hits++;
+            m_st->m_infer_type[infer_only].insert(mk_pair(e, *r));
+            return *r;
+        }
+    }
 
     expr r;
     switch (e.kind()) {
@@ -307,6 +495,8 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     }
 
     m_st->m_infer_type[infer_only].insert(mk_pair(e, r));
+    if (infer_only)
+        cache_closed(false, e, r);
     return r;
 }
 
@@ -355,11 +545,9 @@ optional<expr> type_checker::reduce_recursor(expr const & e, bool cheap_rec, boo
 }
 
 expr type_checker::whnf_fvar(expr const & e, bool cheap_rec, bool cheap_proj) {
-    if (optional<local_decl> decl = m_lctx.find_local_decl(e)) {
-        if (optional<expr> const & v = decl->get_value()) {
-            /* zeta-reduction */
-            return whnf_core(*v, cheap_rec, cheap_proj);
-        }
+    if (optional<expr> v = m_lctx.find_value(e)) {
+        /* zeta-reduction */
+        return whnf_core(*v, cheap_rec, cheap_proj);
     }
     return e;
 }
@@ -390,15 +578,6 @@ optional<expr> type_checker::reduce_proj(expr const & e, bool cheap_rec, bool ch
         return none_expr();
 }
 
-static bool is_let_fvar(local_ctx const & lctx, expr const & e) {
-    lean_assert(is_fvar(e));
-    if (optional<local_decl> decl = lctx.find_local_decl(e)) {
-        return static_cast<bool>(decl->get_value());
-    } else {
-        return false;
-    }
-}
-
 /** \brief Weak head normal form core procedure. It does not perform delta reduction nor normalization extensions.
     If `cheap == true`, then we don't perform delta-reduction when reducing major premise of recursors and projections.
     We also do not cache results. */
@@ -414,7 +593,7 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     case expr_kind::MData:
         return whnf_core(mdata_expr(e), cheap_rec, cheap_proj);
     case expr_kind::FVar:
-        if (is_let_fvar(m_lctx, e))
+        if (m_lctx.is_let_fvar(e))
             break;
         else
             return e;
@@ -424,9 +603,12 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     }
 
     // check cache
+    if (auto s = stats()) s->m_whnf_core++;
     auto it = m_st->m_whnf_core.find(e);
-    if (it != m_st->m_whnf_core.end())
+    if (it != m_st->m_whnf_core.end()) {
+        if (auto s = stats()) s->m_whnf_core_hits++;
         return it->second;
+    }
 
     // do the actual work
     expr r;
@@ -496,8 +678,10 @@ optional<constant_info> type_checker::is_delta(expr const & e) const {
 optional<expr> type_checker::unfold_definition_core(expr const & e) {
     if (is_constant(e)) {
         if (auto d = is_delta(e)) {
-            if (length(const_levels(e)) == d->get_num_lparams())
-                return some_expr(instantiate_value_lparams(*d, const_levels(e)));
+            if (length(const_levels(e)) == d->get_num_lparams()) {
+                if (auto s = stats()) s->m_unfold[const_name(e)]++;
+                return some_expr(instantiate_const_lparams(*d, e, true));
+            }
         }
     }
     return none_expr();
@@ -569,6 +753,22 @@ template<typename F> optional<expr> type_checker::reduce_bin_nat_op(F const & f,
     return some_expr(mk_lit(literal(nat(f(v1.raw(), v2.raw())))));
 }
 
+/* Operations such as `Nat.pow` and `Nat.shiftLeft` produce numbers of size linear in their second argument.
+   We only evaluate them natively if the result is of reasonable size, and otherwise fall back to unfolding,
+   which avoids runtime panics on huge exponents. */
+static unsigned const g_nat_max_exponent = 1u << 24;
+
+optional<expr> type_checker::reduce_bin_nat_exp_op(nat_bin_op f, expr const & e) {
+    expr arg1 = whnf(app_arg(app_fn(e)));
+    if (!is_nat_lit_ext(arg1)) return none_expr();
+    expr arg2 = whnf(app_arg(e));
+    if (!is_nat_lit_ext(arg2)) return none_expr();
+    nat v1 = get_nat_val(arg1);
+    nat v2 = get_nat_val(arg2);
+    if (v2 > g_nat_max_exponent) return none_expr();
+    return some_expr(mk_lit(literal(nat(f(v1.raw(), v2.raw())))));
+}
+
 template<typename F> optional<expr> type_checker::reduce_bin_nat_pred(F const & f, expr const & e) {
     expr arg1 = whnf(app_arg(app_fn(e)));
     if (!is_nat_lit_ext(arg1)) return none_expr();
@@ -590,6 +790,12 @@ optional<expr> type_checker::reduce_nat(expr const & e) {
             nat v = get_nat_val(arg);
             return some_expr(mk_lit(literal(nat(v+nat(1)))));
         }
+        if (f == *g_nat_log2) {
+            expr arg = whnf(app_arg(e));
+            if (!is_nat_lit_ext(arg)) return none_expr();
+            nat v = get_nat_val(arg);
+            return some_expr(mk_lit(literal(nat(lean_nat_log2(v.raw())))));
+        }
     } else if (nargs == 2) {
         expr const & f = app_fn(app_fn(e));
         if (!is_constant(f)) return none_expr();
@@ -598,12 +804,82 @@ optional<expr> type_checker::reduce_nat(expr const & e) {
         if (f == *g_nat_mul) return reduce_bin_nat_op(nat_mul, e);
         if (f == *g_nat_mod) return reduce_bin_nat_op(nat_mod, e);
         if (f == *g_nat_div) return reduce_bin_nat_op(nat_div, e);
+        if (f == *g_nat_gcd) return reduce_bin_nat_op(lean_nat_gcd, e);
+        if (f == *g_nat_land) return reduce_bin_nat_op(nat_land, e);
+        if (f == *g_nat_lor) return reduce_bin_nat_op(nat_lor, e);
+        if (f == *g_nat_xor) return reduce_bin_nat_op(nat_lxor, e);
+        if (f == *g_nat_shiftr) return reduce_bin_nat_op(lean_nat_shiftr, e);
+        if (f == *g_nat_pow) return reduce_bin_nat_exp_op(lean_nat_pow, e);
+        if (f == *g_nat_shiftl) return reduce_bin_nat_exp_op(lean_nat_shiftl, e);
         if (f == *g_nat_beq) return reduce_bin_nat_pred(nat_eq, e);
         if (f == *g_nat_ble) return reduce_bin_nat_pred(nat_le, e);
     }
     return none_expr();
 }
 
+/* Return the string literal `e` reduces to, if any. */
+optional<expr> type_checker::whnf_string_lit(expr const & e) {
+    expr r = whnf(e);
+    if (is_string_lit(r)) return some_expr(r);
+    return none_expr();
+}
+
+/* Evaluate common `String` operations on literals, which would otherwise be reduced by expanding
+   the literals into `String.mk` applications on lists of characters. */
+optional<expr> type_checker::reduce_string(expr const & e) {
+    if (has_fvar(e)) return none_expr();
+    unsigned nargs = get_app_num_args(e);
+    if (nargs == 1) {
+        expr const & f = app_fn(e);
+        if (f != *g_string_length && f != *g_string_utf8_byte_size) return none_expr();
+        optional<expr> s = whnf_string_lit(app_arg(e));
+        if (!s) return none_expr();
+        string_ref const & v = lit_value(*s).get_string();
+        if (f == *g_string_length)
+            return some_expr(mk_lit(literal(nat(static_cast<unsigned long>(v.length())))));
+        else
+            return some_expr(mk_lit(literal(nat(static_cast<unsigned long>(v.num_bytes())))));
+    } else if (nargs == 2) {
+        expr const & f = app_fn(app_fn(e));
+        if (f != *g_string_append && f != *g_string_get && f != *g_string_dec_eq) return none_expr();
+        optional<expr> s1 = whnf_string_lit(app_arg(app_fn(e)));
+        if (!s1) return none_expr();
+        string_ref const & v1 = lit_value(*s1).get_string();
+        if (f == *g_string_get) {
+            expr p = whnf(app_arg(e));
+            if (!is_app(p) || app_fn(p) != *g_string_pos_mk) return none_expr();
+            expr i = whnf(app_arg(p));
+            if (!is_nat_lit_ext(i)) return none_expr();
+            nat n = get_nat_val(i);
+            size_t size = v1.num_bytes();
+            if (n.is_small()) {
+                /* Same as `utf8GetAux`: only positions at the beginning of a character are valid. */
+                char const * str = v1.data();
+                size_t pos = 0;
+                while (pos < size) {
+                    if (pos == n.get_small_value()) {
+                        unsigned c = next_utf8(str, size, pos);
+                        return some_expr(whnf(mk_app(*g_char_of_nat, mk_lit(literal(c)))));
+                    }
+                    next_utf8(str, size, pos);
+                }
+            }
+            return some_expr(whnf(*g_char_default));
+        }
+        optional<expr> s2 = whnf_string_lit(app_arg(e));
+        if (!s2) return none_expr();
+        string_ref const & v2 = lit_value(*s2).get_string();
+        if (f == *g_string_append) {
+            return some_expr(mk_lit(literal(string_ref(v1.to_std_string() + v2.to_std_string()))));
+        } else if (v1 == v2) {
+            /* We do not have a short proof of `¬ s1 = s2` for distinct literals, so we only take the fast path
+               if the strings are equal. */
+            return some_expr(mk_app(*g_decidable_is_true, mk_app(*g_eq_string, *s1, *s2), mk_app(*g_eq_refl_string, *s1)));
+        }
+    }
+    return none_expr();
+}
+
 /** \brief Put expression \c t in weak head normal form */
 expr type_checker::whnf(expr const & e) {
     // Do not cache easy cases
@@ -614,7 +890,7 @@ expr type_checker::whnf(expr const & e) {
     case expr_kind::MData:
         return whnf(mdata_expr(e));
     case expr_kind::FVar:
-        if (is_let_fvar(m_lctx, e))
+        if (m_lctx.is_let_fvar(e))
             break;
         else
             return e;
@@ -624,9 +900,17 @@ expr type_checker::whnf(expr const & e) {
     }
 
     // check cache
+    if (auto s = stats()) s->m_whnf++;
     auto it = m_st->m_whnf.find(e);
-    if (it != m_st->m_whnf.end())
+    if (it != m_st->m_whnf.end()) {
+        if (auto s = stats()) s->m_whnf_hits++;
         return it->second;
+    }
+    if (auto r = find_closed(true, e)) {
+        if (auto s = stats()) s->m_closed_hits++;
+        m_st->m_whnf.insert(mk_pair(e, *r));
+        return *r;
+    }
 
     expr t = e;
     while (true) {
@@ -635,13 +919,20 @@ expr type_checker::whnf(expr const & e) {
             m_st->m_whnf.insert(mk_pair(e, *v));
             return *v;
         } else if (auto v = reduce_nat(t1)) {
+            if (auto s = stats()) s->m_reduce_nat_hits++;
             m_st->m_whnf.insert(mk_pair(e, *v));
+            cache_closed(true, e, *v);
+            return *v;
+        } else if (auto v = reduce_string(t1)) {
+            m_st->m_whnf.insert(mk_pair(e, *v));
+            cache_closed(true, e, *v);
             return *v;
         } else if (auto next_t = unfold_definition(t1)) {
             t = *next_t;
         } else {
             auto r = t1;
             m_st->m_whnf.insert(mk_pair(e, r));
+            cache_closed(true, e, r);
             return r;
         }
     }
@@ -657,7 +948,7 @@ expr type_checker::whnf(expr const & e) {
 bool type_checker::is_def_eq_binding(expr t, expr s) {
     lean_assert(t.kind() == s.kind());
     lean_assert(is_binding(t));
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    local_ctx_stack::scope save_lctx(m_lctx);
     expr_kind k = t.kind();
     buffer<expr> subst;
     do {
@@ -810,15 +1101,20 @@ lbool type_checker::is_def_eq_proof_irrel(expr const & t, expr const & s) {
 }
 
 bool type_checker::failed_before(expr const & t, expr const & s) const {
+    bool r;
     if (hash(t) < hash(s)) {
-        return m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end();
+        r = m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end();
     } else if (hash(t) > hash(s)) {
-        return m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
+        r = m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
     } else {
-        return
+        r =
             m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end() ||
             m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
     }
+    if (r) {
+        if (auto st = stats()) st->m_failed_before_hits++;
+    }
+    return r;
 }
 
 void type_checker::cache_failure(expr const & t, expr const & s) {
@@ -849,6 +1145,7 @@ optional<expr> type_checker::try_unfold_proj_app(expr const & e) {
 
      \remark t_n, s_n and cs are updated. */
 auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reduction_status {
+    if (auto s = stats()) s->m_lazy_delta_steps++;
     auto d_t = is_delta(t_n);
     auto d_s = is_delta(s_n);
     if (!d_t && !d_s) {
@@ -939,12 +1236,21 @@ lbool type_checker::is_def_eq_offset(expr const & t, expr const & s) {
 lbool type_checker::lazy_delta_reduction(expr & t_n, expr & s_n) {
     while (true) {
         lbool r = is_def_eq_offset(t_n, s_n);
-        if (r != l_undef) return r;
+        if (r != l_undef) {
+            if (auto s = stats()) s->m_offset_hits++;
+            return r;
+        }
 
         if (!has_fvar(t_n) && !has_fvar(s_n)) {
             if (auto t_v = reduce_nat(t_n)) {
+                if (auto s = stats()) s->m_reduce_nat_hits++;
                 return to_lbool(is_def_eq_core(*t_v, s_n));
             } else if (auto s_v = reduce_nat(s_n)) {
+                if (auto s = stats()) s->m_reduce_nat_hits++;
+                return to_lbool(is_def_eq_core(t_n, *s_v));
+            } else if (auto t_v = reduce_string(t_n)) {
+                return to_lbool(is_def_eq_core(*t_v, s_n));
+            } else if (auto s_v = reduce_string(s_n)) {
                 return to_lbool(is_def_eq_core(t_n, *s_v));
             }
         }
@@ -1071,7 +1377,7 @@ bool type_checker::is_def_eq(expr const & t, expr const & s) {
 
 expr type_checker::eta_expand(expr const & e) {
     buffer<expr> fvars;
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    local_ctx_stack::scope save_lctx(m_lctx);
     expr it = e;
     while (is_lambda(it)) {
         expr d = instantiate_rev(binding_domain(it), fvars.size(), fvars.data());
@@ -1149,6 +1455,46 @@ void initialize_type_checker() {
     mark_persistent(g_nat_beq->raw());
     g_nat_ble      = new expr(mk_constant(name{"Nat", "ble"}));
     mark_persistent(g_nat_ble->raw());
+    g_nat_pow      = new expr(mk_constant(name{"Nat", "pow"}));
+    mark_persistent(g_nat_pow->raw());
+    g_nat_gcd      = new expr(mk_constant(name{"Nat", "gcd"}));
+    mark_persistent(g_nat_gcd->raw());
+    g_nat_log2     = new expr(mk_constant(name{"Nat", "log2"}));
+    mark_persistent(g_nat_log2->raw());
+    g_nat_land     = new expr(mk_constant(name{"Nat", "land"}));
+    mark_persistent(g_nat_land->raw());
+    g_nat_lor      = new expr(mk_constant(name{"Nat", "lor"}));
+    mark_persistent(g_nat_lor->raw());
+    g_nat_xor      = new expr(mk_constant(name{"Nat", "xor"}));
+    mark_persistent(g_nat_xor->raw());
+    g_nat_shiftl   = new expr(mk_constant(name{"Nat", "shiftLeft"}));
+    mark_persistent(g_nat_shiftl->raw());
+    g_nat_shiftr   = new expr(mk_constant(name{"Nat", "shiftRight"}));
+    mark_persistent(g_nat_shiftr->raw());
+    g_string_length = new expr(mk_constant(name{"String", "length"}));
+    mark_persistent(g_string_length->raw());
+    g_string_utf8_byte_size = new expr(mk_constant(name{"String", "utf8ByteSize"}));
+    mark_persistent(g_string_utf8_byte_size->raw());
+    g_string_append = new expr(mk_constant(name{"String", "append"}));
+    mark_persistent(g_string_append->raw());
+    g_string_get    = new expr(mk_constant(name{"String", "get"}));
+    mark_persistent(g_string_get->raw());
+    g_string_dec_eq = new expr(mk_constant(name{"String", "decEq"}));
+    mark_persistent(g_string_dec_eq->raw());
+    g_string_pos_mk = new expr(mk_constant(name{"String", "Pos", "mk"}));
+    mark_persistent(g_string_pos_mk->raw());
+    g_char_of_nat   = new expr(mk_constant(name{"Char", "ofNat"}));
+    mark_persistent(g_char_of_nat->raw());
+    g_char_default  = new expr(mk_app(*g_char_of_nat, mk_lit(literal(static_cast<unsigned>('A')))));
+    mark_persistent(g_char_default->raw());
+    g_decidable_is_true = new expr(mk_constant(name{"Decidable", "isTrue"}));
+    mark_persistent(g_decidable_is_true->raw());
+    g_string        = new expr(mk_constant(name{"String"}));
+    mark_persistent(g_string->raw());
+    g_eq_string     = new expr(mk_app(mk_constant(name{"Eq"}, levels(mk_level_one())), *g_string));
+    mark_persistent(g_eq_string->raw());
+    g_eq_refl_string = new expr(mk_app(mk_constant(name{"Eq", "refl"}, levels(mk_level_one())), *g_string));
+    mark_persistent(g_eq_refl_string->raw());
     g_string_mk    = new expr(mk_constant(name{"String", "mk"}));
     mark_persistent(g_string_mk->raw());
     g_lean_reduce_bool = new expr(mk_constant(name{"Lean", "reduceBool"}));
@@ -1156,9 +1502,15 @@ void initialize_type_checker() {
     g_lean_reduce_nat  = new expr(mk_constant(name{"Lean", "reduceNat"}));
     mark_persistent(g_lean_reduce_nat->raw());
     register_name_generator_prefix(*g_kernel_fresh);
+    g_kernel_stats_mutex = new mutex();
+    g_kernel_stats       = new kernel_stats();
+    g_kernel_phase_times = new std::map<std::string, second_duration>();
 }
 
 void finalize_type_checker() {
+    delete g_kernel_stats;
+    delete g_kernel_phase_times;
+    delete g_kernel_stats_mutex;
     delete g_dont_care;
     delete g_kernel_fresh;
     delete g_nat_succ;
@@ -1170,6 +1522,26 @@ void finalize_type_checker() {
     delete g_nat_mod;
     delete g_nat_beq;
     delete g_nat_ble;
+    delete g_nat_pow;
+    delete g_nat_gcd;
+    delete g_nat_log2;
+    delete g_nat_land;
+    delete g_nat_lor;
+    delete g_nat_xor;
+    delete g_nat_shiftl;
+    delete g_nat_shiftr;
+    delete g_string_length;
+    delete g_string_utf8_byte_size;
+    delete g_string_append;
+    delete g_string_get;
+    delete g_string_dec_eq;
+    delete g_string_pos_mk;
+    delete g_char_of_nat;
+    delete g_char_default;
+    delete g_decidable_is_true;
+    delete g_string;
+    delete g_eq_string;
+    delete g_eq_refl_string;
     delete g_string_mk;
     delete g_lean_reduce_bool;
     delete g_lean_reduce_nat;
@@ -6,18 +6,54 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <unordered_set>
+#include <unordered_map>
 #include <memory>
+#include <iostream>
 #include <utility>
 #include <algorithm>
 #include "util/lbool.h"
 #include "util/name_set.h"
 #include "util/name_generator.h"
+#include "util/timeit.h"
 #include "kernel/environment.h"
 #include "kernel/local_ctx.h"
 #include "kernel/expr_maps.h"
 #include "kernel/equiv_manager.h"
 
 namespace lean {
+/** \brief Counters for finding out what the kernel spends time on, collected only if enabled
+    using `set_kernel_stats_enabled`. */
+struct kernel_stats {
+    uint64 m_infer{0};
+    uint64 m_infer_hits{0};
+    uint64 m_whnf_core{0};
+    uint64 m_whnf_core_hits{0};
+    uint64 m_whnf{0};
+    uint64 m_whnf_hits{0};
+    uint64 m_closed_hits{0};
+    uint64 m_lazy_delta_steps{0};
+    uint64 m_failed_before_hits{0};
+    uint64 m_offset_hits{0};
+    uint64 m_reduce_nat_hits{0};
+    uint64 m_eqv_finds{0};
+    uint64 m_eqv_compressions{0};
+    uint64 m_max_sharing{0};
+    uint64 m_max_sharing_before{0};
+    uint64 m_max_sharing_after{0};
+    std::unordered_map<name, uint64, name_hash_fn, name_eq_fn> m_unfold;
+    void merge(kernel_stats const & other);
+};
+
+void set_kernel_stats_enabled(bool enabled);
+bool get_kernel_stats_enabled();
+/** \brief Add `d` to the time spent in the given phase of the kernel (e.g., of `add_inductive`), if statistics are enabled. */
+void report_kernel_phase_time(char const * phase, second_duration d);
+/** \brief Record that a term with `before` distinct subterms was maximally shared into one with `after` distinct subterms,
+    if statistics are enabled. */
+void report_kernel_max_sharing(uint64 before, uint64 after);
+/** \brief Display the statistics accumulated by all type checkers whose state has been destroyed. */
+void display_kernel_stats(std::ostream & out);
+
 /** \brief Lean Type Checker. It can also be used to infer types, check whether a
     type \c A is convertible to a type \c B, etc. */
 class type_checker {
@@ -30,11 +66,18 @@ public:
         infer_cache               m_infer_type[2];
         expr_map<expr>            m_whnf_core;
         expr_map<expr>            m_whnf;
+        /* Types (index 0) and values (index 1) of constants instantiated with universe levels. */
+        expr_map<expr>            m_inst_lparams[2];
         equiv_manager             m_eqv_manager;
         expr_pair_set             m_failure;
+        /* Scope for `closed_term_cache`, `nullptr` if it cannot be used with `m_env`. */
+        object *                  m_closed_scope;
+        /* Statistics, added to the global ones on destruction. `nullptr` if statistics are disabled. */
+        std::unique_ptr<kernel_stats> m_stats;
         friend type_checker;
     public:
         state(environment const & env);
+        ~state();
         environment & env() { return m_env; }
         environment const & env() const { return m_env; }
         name_generator & ngen() { return m_ngen; }
@@ -42,12 +85,13 @@ public:
 private:
     bool                      m_st_owner;
     state *                   m_st;
-    local_ctx                 m_lctx;
+    local_ctx_stack           m_lctx;
     bool                      m_safe_only;
     /* When `m_lparams != nullptr, the `check` method makes sure all level parameters
        are in `m_lparams`. */
     names const *             m_lparams;
 
+    kernel_stats * stats() const { return m_st->m_stats.get(); }
     expr ensure_sort_core(expr e, expr const & s);
     expr ensure_pi_core(expr e, expr const & s);
     void check_level(level const & l);
@@ -60,6 +104,9 @@ private:
     expr infer_let(expr const & e, bool infer_only);
     expr infer_type_core(expr const & e, bool infer_only);
     expr infer_type(expr const & e);
+    optional<expr> find_closed(bool whnf, expr const & e);
+    void cache_closed(bool whnf, expr const & e, expr const & r);
+    expr instantiate_const_lparams(constant_info const & info, expr const & e, bool value);
 
     enum class reduction_status { Continue, DefUnknown, DefEqual, DefDiff };
     optional<expr> reduce_recursor(expr const & e, bool cheap_rec, bool cheap_proj);
@@ -97,8 +144,12 @@ private:
     optional<expr> try_unfold_proj_app(expr const & e);
 
     template<typename F> optional<expr> reduce_bin_nat_op(F const & f, expr const & e);
+    typedef object * (*nat_bin_op)(object *, object *);
+    optional<expr> reduce_bin_nat_exp_op(nat_bin_op f, expr const & e);
     template<typename F> optional<expr> reduce_bin_nat_pred(F const & f, expr const & e);
     optional<expr> reduce_nat(expr const & e);
+    optional<expr> whnf_string_lit(expr const & e);
+    optional<expr> reduce_string(expr const & e);
 public:
     type_checker(state & st, local_ctx const & lctx, bool safe_only = true);
     type_checker(state & st, bool safe_only = true):type_checker(st, local_ctx(), safe_only) {}
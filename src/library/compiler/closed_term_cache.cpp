@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 namespace lean {
 extern "C" object * lean_cache_closed_term_name(object * env, object * e, object * n);
 extern "C" object * lean_get_closed_term_name(object * env, object * e);
+extern "C" object * lean_mark_lazy_closed_term(object * env, object * n);
 
 optional<name> get_closed_term_name(environment const & env, expr const & e) {
     return to_optional<name>(lean_get_closed_term_name(env.to_obj_arg(), e.to_obj_arg()));
@@ -17,4 +18,8 @@ optional<name> get_closed_term_name(environment const & env, expr const & e) {
 environment cache_closed_term_name(environment const & env, expr const & e, name const & n) {
     return environment(lean_cache_closed_term_name(env.to_obj_arg(), e.to_obj_arg(), n.to_obj_arg()));
 }
+
+environment mark_lazy_closed_term(environment const & env, name const & n) {
+    return environment(lean_mark_lazy_closed_term(env.to_obj_arg(), n.to_obj_arg()));
+}
 }
@@ -9,4 +9,6 @@ Author: Leonardo de Moura
 namespace lean {
 optional<name> get_closed_term_name(environment const & env, expr const & e);
 environment cache_closed_term_name(environment const & env, expr const & e, name const & n);
+/* Mark the closed term constant `n` to be initialized on first access, see `compiler.lazy_closed_terms`. */
+environment mark_lazy_closed_term(environment const & env, name const & n);
 }
@@ -4,11 +4,18 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <exception>
+#include <cstdlib>
+#include "runtime/thread.h"
 #include "util/option_declarations.h"
 #include "util/io.h"
 #include "kernel/type_checker.h"
 #include "kernel/kernel_exception.h"
-#include "library/max_sharing.h"
+#include "kernel/max_sharing.h"
 #include "library/trace.h"
 #include "library/time_task.h"
 #include "library/compiler/util.h"
@@ -23,6 +30,7 @@ Author: Leonardo de Moura
 #include "library/compiler/implemented_by_attribute.h"
 #include "library/compiler/lambda_lifting.h"
 #include "library/compiler/extract_closed.h"
+#include "library/compiler/closed_term_cache.h"
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/ll_infer_type.h"
 #include "library/compiler/simp_app_args.h"
@@ -33,9 +41,23 @@ Author: Leonardo de Moura
 #include "library/compiler/ir.h"
 
 namespace lean {
-static name * g_extract_closed = nullptr;
+static option_key * g_extract_closed = nullptr;
+static option_key * g_compiler_stats = nullptr;
+static option_key * g_lazy_closed_terms = nullptr;
+/* Batches with at least this many declarations are transformed on multiple threads by the passes that do not update
+   the environment; 0 disables this. Can be set using `LEAN_COMPILER_MIN_PARALLEL_DECLS`. */
+static unsigned g_min_parallel_decls = 16;
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
+static bool is_compiler_stats_enabled(options const & opts) { return opts.get_bool(*g_compiler_stats, false); }
+static bool is_lazy_closed_terms_enabled(options const & opts) { return opts.get_bool(*g_lazy_closed_terms, false); }
+
+static unsigned get_lcnf_size(environment const & env, comp_decls const & ds) {
+    unsigned r = 0;
+    for (comp_decl const & d : ds)
+        r += get_lcnf_size(env, d.snd());
+    return r;
+}
 
 static name get_real_name(name const & n) {
     if (optional<name> new_n = is_unsafe_rec_name(n))
@@ -55,14 +77,56 @@ static expr eta_expand(environment const & env, expr const & e) {
     return type_checker(env).eta_expand(e);
 }
 
+/* Return `map(ds, fn)`. The declarations are processed by multiple threads if there are at least `g_min_parallel_decls`
+   of them and tracing is disabled, since trace output is collected per thread. `fn` must only share objects with other
+   calls that are reachable from `env` or `ds`. The result does not depend on the number of threads; if some calls
+   fail, the exception of the first failing declaration is rethrown. */
+template<typename F>
+static comp_decls parallel_map(environment const * env, comp_decls const & ds, F const & fn) {
+    buffer<comp_decl> in;
+    to_buffer(ds, in);
+    unsigned n = in.size();
+    if (g_min_parallel_decls == 0 || n < g_min_parallel_decls || is_trace_enabled())
+        return map(ds, [&](comp_decl const & d) { return fn(d); });
+    unsigned num_threads = std::min(n, hardware_concurrency());
+    if (num_threads <= 1)
+        return map(ds, [&](comp_decl const & d) { return fn(d); });
+    if (env)
+        mark_mt(env->raw());
+    for (comp_decl const & d : in)
+        mark_mt(d.raw());
+    buffer<comp_decl> out(in);
+    std::vector<std::exception_ptr> errors(n);
+    auto run = [&](unsigned t) {
+        for (unsigned i = t; i < n; i += num_threads) {
+            try {
+                out[i] = fn(in[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::unique_ptr<lthread>> threads;
+    for (unsigned t = 1; t < num_threads; t++)
+        threads.emplace_back(new lthread([&, t]() { run(t); }));
+    run(0);
+    for (auto & th : threads)
+        th->join();
+    for (std::exception_ptr const & ex : errors) {
+        if (ex)
+            std::rethrow_exception(ex);
+    }
+    return comp_decls(out);
+}
+
 template<typename F>
 comp_decls apply(F && f, environment const & env, comp_decls const & ds) {
-    return map(ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(env, d.snd())); });
+    return parallel_map(&env, ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(env, d.snd())); });
 }
 
 template<typename F>
 comp_decls apply(F && f, comp_decls const & ds) {
-    return map(ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(d.snd())); });
+    return parallel_map(nullptr, ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(d.snd())); });
 }
 
 void trace_comp_decl(comp_decl const & d) {
@@ -200,26 +264,42 @@ environment compile(environment const & env, options const & opts, names cs) {
 
     comp_decls ds = to_comp_decls(env, cs);
     csimp_cfg cfg(opts);
+    environment new_env = env;
+    bool stats = is_compiler_stats_enabled(opts);
+    /* Run the pass `fn` as the profiling category `compilation <pass_name>`. If `compiler.stats` is set, report its
+       time and the size of `ds` before and after it. */
+    auto pass = [&](char const * pass_name, auto const & fn) {
+        unsigned size_before = stats ? get_lcnf_size(new_env, ds) : 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            time_task t(std::string("compilation ") + pass_name, opts);
+            fn();
+        }
+        if (stats) {
+            second_duration time = std::chrono::steady_clock::now() - start;
+            tout() << "compiler.stats " << pass_name << ": " << size_before << " -> " << get_lcnf_size(new_env, ds)
+                   << " (" << display_profiling_time{time} << ")\n";
+        }
+    };
     // Use the following line to see compiler intermediate steps
     // scope_traces_as_string trace_scope;
     auto simp  = [&](environment const & env, expr const & e) { return csimp(env, e, cfg); };
     auto esimp = [&](environment const & env, expr const & e) { return cesimp(env, e, cfg); };
     trace_compiler(name({"compiler", "input"}), ds);
-    ds = apply(eta_expand, env, ds);
+    pass("eta_expand", [&]() { ds = apply(eta_expand, env, ds); });
     trace_compiler(name({"compiler", "eta_expand"}), ds);
-    ds = apply(to_lcnf, env, ds);
-    ds = apply(find_jp, env, ds);
+    pass("lcnf", [&]() { ds = apply(to_lcnf, env, ds); });
+    pass("find_jp", [&]() { ds = apply(find_jp, env, ds); });
     // trace(ds);
     trace_compiler(name({"compiler", "lcnf"}), ds);
     // trace(ds);
-    ds = apply(cce, env, ds);
+    pass("cce", [&]() { ds = apply(cce, env, ds); });
     trace_compiler(name({"compiler", "cce"}), ds);
-    ds = apply(csimp_replace_constants, env, ds);
-    ds = apply(simp, env, ds);
+    pass("csimp_replace_constants", [&]() { ds = apply(csimp_replace_constants, env, ds); });
+    pass("simp", [&]() { ds = apply(simp, env, ds); });
     trace_compiler(name({"compiler", "simp"}), ds);
     // trace(ds);
-    environment new_env = env;
-    std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
+    pass("eager_lambda_lifting", [&]() { std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg); });
     trace_compiler(name({"compiler", "eager_lambda_lifting"}), ds);
     ds = apply(max_sharing, ds);
     trace_compiler(name({"compiler", "stage1"}), ds);
@@ -233,38 +313,49 @@ environment compile(environment const & env, options const & opts, names cs) {
            when it is partially applied. Then, we can mark all `match` auxiliary functions as `[strong_inline]` */
         return new_env;
     }
-    std::tie(new_env, ds) = specialize(new_env, ds, cfg);
+    pass("specialize", [&]() { std::tie(new_env, ds) = specialize(new_env, ds, cfg, specialize_cfg(opts)); });
     lean_assert(lcnf_check_let_decls(new_env, ds));
     trace_compiler(name({"compiler", "specialize"}), ds);
-    ds = apply(elim_dead_let, ds);
+    pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
     trace_compiler(name({"compiler", "elim_dead_let"}), ds);
-    ds = apply(erase_irrelevant, new_env, ds);
+    pass("erase_irrelevant", [&]() {
+            erase_irrelevant_cache cache;
+            ds = apply([&](environment const & env, expr const & e) {
+                    return erase_irrelevant_core(env, local_ctx(), e, cache);
+                }, new_env, ds);
+        });
     trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
-    ds = apply(struct_cases_on, new_env, ds);
+    pass("struct_cases_on", [&]() { ds = apply(struct_cases_on, new_env, ds); });
     trace_compiler(name({"compiler", "struct_cases_on"}), ds);
-    ds = apply(esimp, new_env, ds);
+    pass("simp", [&]() { ds = apply(esimp, new_env, ds); });
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = reduce_arity(new_env, ds);
+    pass("reduce_arity", [&]() { ds = reduce_arity(new_env, ds); });
     trace_compiler(name({"compiler", "reduce_arity"}), ds);
-    std::tie(new_env, ds) = lambda_lifting(new_env, ds);
+    pass("lambda_lifting", [&]() { std::tie(new_env, ds) = lambda_lifting(new_env, ds); });
     trace_compiler(name({"compiler", "lambda_lifting"}), ds);
     // trace(ds);
-    ds = apply(esimp, new_env, ds);
+    pass("simp", [&]() { ds = apply(esimp, new_env, ds); });
     trace_compiler(name({"compiler", "simp"}), ds);
     new_env = cache_stage2(new_env, ds);
     trace_compiler(name({"compiler", "stage2"}), ds);
     if (is_extract_closed_enabled(opts)) {
-        std::tie(new_env, ds) = extract_closed(new_env, ds);
-        ds = apply(elim_dead_let, ds);
-        ds = apply(esimp, new_env, ds);
+        pass("extract_closed", [&]() { std::tie(new_env, ds) = extract_closed(new_env, ds); });
+        if (is_lazy_closed_terms_enabled(opts)) {
+            for (comp_decl const & d : ds) {
+                if (is_extract_closed_aux_fn(d.fst()))
+                    new_env = mark_lazy_closed_term(new_env, d.fst());
+            }
+        }
+        pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
+        pass("simp", [&]() { ds = apply(esimp, new_env, ds); });
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
-    ds = apply(esimp, new_env, ds);
+    pass("simp", [&]() { ds = apply(esimp, new_env, ds); });
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = apply(simp_app_args, new_env, ds);
-    ds = apply(ecse, new_env, ds);
-    ds = apply(elim_dead_let, ds);
+    pass("simp_app_args", [&]() { ds = apply(simp_app_args, new_env, ds); });
+    pass("cse", [&]() { ds = apply(ecse, new_env, ds); });
+    pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
     trace_compiler(name({"compiler", "simp_app_args"}), ds);
     // std::cout << trace_scope.get_string() << "\n";
     /* compile IR. */
@@ -278,9 +369,17 @@ extern "C" LEAN_EXPORT object * lean_compile_decls(object * env, object * opts,
 }
 
 void initialize_compiler() {
-    g_extract_closed = new name{"compiler", "extract_closed"};
-    mark_persistent(g_extract_closed->raw());
-    register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
+    if (char const * v = std::getenv("LEAN_COMPILER_MIN_PARALLEL_DECLS"))
+        g_min_parallel_decls = atoi(v);
+    g_extract_closed = new option_key(name{"compiler", "extract_closed"});
+    register_bool_option(g_extract_closed->get_name(), true, "(compiler) enable/disable closed term caching");
+    g_compiler_stats = new option_key(name{"compiler", "stats"});
+    register_bool_option(g_compiler_stats->get_name(), false,
+                         "(compiler) report the time and code size of each compiler pass");
+    g_lazy_closed_terms = new option_key(name{"compiler", "lazy_closed_terms"});
+    register_bool_option(g_lazy_closed_terms->get_name(), false,
+                         "(compiler) initialize extracted closed terms on first access instead of at program startup, "
+                         "`[init]` declarations are still initialized at startup");
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
     register_trace_class({"compiler", "inline"});
@@ -323,5 +422,7 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_compiler_stats;
+    delete g_lazy_closed_terms;
 }
 }
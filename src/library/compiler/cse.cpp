@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <vector>
 #include "runtime/flet.h"
 #include "util/name_generator.h"
+#include "util/name_hash_map.h"
 #include "kernel/environment.h"
 #include "kernel/instantiate.h"
 #include "kernel/abstract.h"
@@ -20,6 +21,26 @@ Author: Leonardo de Moura
 namespace lean {
 static name * g_cse_fresh = nullptr;
 
+/* Replace the free variables `x` with `idx[x] < n` in `e` with `bvar(n - idx[x] - 1)`.
+   This is `abstract(e, n, fvars)` for the first `n` elements of `fvars`, where `idx` maps `fvars[i]` to `i`. The latter
+   searches `fvars` for every occurrence of a free variable, which is quadratic when abstracting the values
+   of a long sequence of let-declarations. */
+static expr abstract_prefix(expr const & e, unsigned n, name_hash_map<unsigned> const & idx) {
+    if (!has_fvar(e))
+        return e;
+    return replace(e, [&](expr const & m, unsigned offset) -> optional<expr> {
+            if (!has_fvar(m))
+                return some_expr(m);
+            if (is_fvar(m)) {
+                auto it = idx.find(fvar_name(m));
+                if (it != idx.end() && it->second < n)
+                    return some_expr(mk_bvar(offset + n - it->second - 1));
+                return some_expr(m);
+            }
+            return none_expr();
+        });
+}
+
 class cse_fn {
     environment       m_env;
     name_generator    m_ngen;
@@ -84,13 +105,16 @@ public:
             e = let_body(e);
         }
         e = visit(instantiate_rev(e, fvars.size(), fvars.data()));
-        e = abstract(e, to_keep_fvars.size(), to_keep_fvars.data());
         lean_assert(entries.size() == to_keep_fvars.size());
+        name_hash_map<unsigned> idx;
+        for (unsigned i = 0; i < to_keep_fvars.size(); i++)
+            idx.insert(mk_pair(fvar_name(to_keep_fvars[i]), i));
+        e = abstract_prefix(e, to_keep_fvars.size(), idx);
         unsigned i = entries.size();
         while (i > 0) {
             --i;
-            expr new_type  = abstract(std::get<1>(entries[i]), i, to_keep_fvars.data());
-            expr new_value = abstract(std::get<2>(entries[i]), i, to_keep_fvars.data());
+            expr new_type  = abstract_prefix(std::get<1>(entries[i]), i, idx);
+            expr new_value = abstract_prefix(std::get<2>(entries[i]), i, idx);
             e = mk_let(std::get<0>(entries[i]), new_type, new_value, e);
         }
         /* Restore m_map */
@@ -7,7 +7,9 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <unordered_set>
 #include <unordered_map>
+#include <cstdlib>
 #include "runtime/flet.h"
+#include "runtime/thread.h"
 #include "kernel/type_checker.h"
 #include "kernel/for_each_fn.h"
 #include "kernel/find_fn.h"
@@ -15,6 +17,7 @@ Author: Leonardo de Moura
 #include "kernel/instantiate.h"
 #include "kernel/inductive.h"
 #include "kernel/kernel_exception.h"
+#include "kernel/assoc_cache.h"
 #include "library/util.h"
 #include "library/constants.h"
 #include "library/class.h"
@@ -62,6 +65,92 @@ optional<expr> fold_bin_op(bool before_erasure, expr const & f, expr const & a,
     return to_optional_expr(lean_fold_bin_op(before_erasure, f.raw(), a.raw(), b.raw()));
 }
 
+/* Information about an inline candidate, i.e., the `_cstage1` or `_cstage2` auxiliary definition of a function,
+   that is needed to decide whether to inline it. */
+struct inline_candidate {
+    unsigned       m_size;
+    bool           m_unsafe;
+    /* Whether the function is recursive (see `is_recursive_fn`) for the inline threshold `m_recursive_threshold`,
+       or `none` if it has not been computed yet. */
+    unsigned       m_recursive_threshold{0};
+    optional<bool> m_recursive;
+};
+
+/* Process-wide and thread-safe cache of `inline_candidate`s, so that the bodies of `[inline]` definitions are not
+   traversed again at every call site of every declaration being compiled.
+
+   An entry is only used if the environment contains the very same `constant_info` object the entry was created for,
+   so entries stay valid when switching to an unrelated environment (e.g., when the server re-elaborates a file) that
+   contains a different definition with the same name. The cache is cleared when it is full.
+   The maximum number of entries can be set using the environment variable `LEAN_CSIMP_INLINE_CACHE_SIZE`, `0`
+   disables it. */
+class inline_candidate_cache {
+    struct entry {
+        constant_info    m_info;
+        inline_candidate m_candidate;
+    };
+    mutex                                                     m_mutex;
+    unsigned                                                  m_capacity;
+    std::unordered_map<name, entry, name_hash_fn, name_eq_fn> m_entries;
+public:
+    explicit inline_candidate_cache(unsigned capacity):m_capacity(capacity) {}
+
+    optional<inline_candidate> find(name const & c, constant_info const & info) {
+        if (m_capacity == 0)
+            return optional<inline_candidate>();
+        lock_guard<mutex> lock(m_mutex);
+        auto it = m_entries.find(c);
+        if (it != m_entries.end() && is_eqp(it->second.m_info, info))
+            return optional<inline_candidate>(it->second.m_candidate);
+        return optional<inline_candidate>();
+    }
+
+    void insert(name const & c, constant_info const & info, inline_candidate const & candidate) {
+        if (m_capacity == 0)
+            return;
+        // the entries may be released by a different thread
+        mark_mt(c.raw());
+        mark_mt(info.raw());
+        lock_guard<mutex> lock(m_mutex);
+        if (m_entries.size() >= m_capacity)
+            m_entries.clear();
+        auto it = m_entries.find(c);
+        if (it != m_entries.end())
+            m_entries.erase(it);
+        m_entries.insert(mk_pair(c, entry{info, candidate}));
+    }
+};
+
+static inline_candidate_cache * g_inline_candidates = nullptr;
+static cache_counters g_inline_candidate_counters("csimp inline candidates");
+
+static bool uses_unsafe_inductive(environment const & env, expr const & val) {
+    return static_cast<bool>(find(val, [&](expr const & e, unsigned) {
+                if (!is_constant(e) || !is_cases_on_recursor(env, const_name(e))) return false;
+                name const & I = const_name(e).get_prefix();
+                constant_info I_cinfo = env.get(I);
+                return I_cinfo.is_unsafe();
+            }));
+}
+
+/* Return the information about the inline candidate `c` of `env`, whose definition is `info`. */
+static inline_candidate get_inline_candidate(environment const & env, name const & c, constant_info const & info) {
+    optional<inline_candidate> r = g_inline_candidates->find(c, info);
+    if (get_cache_stats_enabled()) {
+        if (r)
+            g_inline_candidate_counters.m_hits++;
+        else
+            g_inline_candidate_counters.m_misses++;
+    }
+    if (r)
+        return *r;
+    inline_candidate new_r;
+    new_r.m_size   = get_lcnf_size(env, info.get_value());
+    new_r.m_unsafe = uses_unsafe_inductive(env, info.get_value());
+    g_inline_candidates->insert(c, info, new_r);
+    return new_r;
+}
+
 class csimp_fn {
     typedef expr_pair_struct_map<expr> jp_cache;
     type_checker::state      m_st;
@@ -1643,7 +1732,7 @@ class csimp_fn {
                 return optional<constant_info>();
             } else if (has_inline_attribute(m_env, f)) {
                 return info;
-            } else if (get_lcnf_size(m_env, info->get_value()) <= m_cfg.m_inline_threshold) {
+            } else if (get_inline_candidate(m_env, c, *info).m_size <= m_cfg.m_inline_threshold) {
                 return info;
             } else {
                 return optional<constant_info>();
@@ -1669,19 +1758,15 @@ class csimp_fn {
         }
     };
 
-    /* We don't inline recursive functions. */
-    bool is_recursive(name const & c) {
-        return is_recursive_fn(env(), m_cfg, m_before_erasure)(c);
-    }
-
-    bool uses_unsafe_inductive(name const & c) {
-        constant_info info = env().get(c);
-        return static_cast<bool>(::lean::find(info.get_value(), [&](expr const & e, unsigned) {
-                    if (!is_constant(e) || !is_cases_on_recursor(env(), const_name(e))) return false;
-                    name const & I = const_name(e).get_prefix();
-                    constant_info I_cinfo = env().get(I);
-                    return I_cinfo.is_unsafe();
-                }));
+    /* We don't inline recursive functions. `c` is the inline candidate of `f`. */
+    bool is_recursive(name const & f, name const & c, constant_info const & info) {
+        inline_candidate r = get_inline_candidate(env(), c, info);
+        if (!r.m_recursive || r.m_recursive_threshold != m_cfg.m_inline_threshold) {
+            r.m_recursive           = is_recursive_fn(env(), m_cfg, m_before_erasure)(f);
+            r.m_recursive_threshold = m_cfg.m_inline_threshold;
+            g_inline_candidates->insert(c, info, r);
+        }
+        return *r.m_recursive;
     }
 
     bool is_stuck_at_cases(expr e) {
@@ -1743,16 +1828,16 @@ class csimp_fn {
             bool inline_attr           = has_inline_attribute(env(), const_name(fn));
             bool inline_if_reduce_attr = has_inline_if_reduce_attribute(env(), const_name(fn));
             if (!inline_attr && !inline_if_reduce_attr &&
-                (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold ||
+                (get_inline_candidate(env(), c, *info).m_size > m_cfg.m_inline_threshold ||
                  is_constant(e))) { /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
                 return none_expr();
             }
-            if (!inline_if_reduce_attr && is_recursive(const_name(fn))) return none_expr();
+            if (!inline_if_reduce_attr && is_recursive(const_name(fn), c, *info)) return none_expr();
             if (!is_matcher(env(), const_name(fn))) {
                 // Hack for test `inliner_loop`. We don't generate code for auxiliary matcher applications.
                 // However, they are safe to be inline even when they use unsafe inductive types.
                 // REMARK: the to be implemented `[strong_inline]` attribute should not be used in unsafe code.
-                if (uses_unsafe_inductive(c)) return none_expr();
+                if (get_inline_candidate(env(), c, *info).m_unsafe) return none_expr();
             }
             lean_trace(name({"compiler", "inline"}), tout() << const_name(fn) << "\n";);
             expr new_fn = instantiate_value_lparams(*info, const_levels(fn));
@@ -1769,9 +1854,10 @@ class csimp_fn {
             if (!info || !info->is_definition()) return none_expr();
             unsigned arity = get_num_nested_lambdas(info->get_value());
             if (get_app_num_args(e) < arity || arity == 0) return none_expr();
-            if (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold) return none_expr();
-            if (is_recursive(const_name(fn))) return none_expr();
-            if (uses_unsafe_inductive(c)) return none_expr();
+            inline_candidate const & candidate = get_inline_candidate(env(), c, *info);
+            if (candidate.m_size > m_cfg.m_inline_threshold) return none_expr();
+            if (candidate.m_unsafe) return none_expr();
+            if (is_recursive(const_name(fn), c, *info)) return none_expr();
             return some_expr(beta_reduce(info->get_value(), e, is_let_val));
         }
     }
@@ -2124,4 +2210,15 @@ expr csimp_core(environment const & env, local_ctx const & lctx, expr const & e0
         e = new_e;
     }
 }
+
+void initialize_csimp() {
+    unsigned capacity = 1u << 14;
+    if (char const * sz = std::getenv("LEAN_CSIMP_INLINE_CACHE_SIZE"))
+        capacity = atoi(sz);
+    g_inline_candidates = new inline_candidate_cache(capacity);
+}
+
+void finalize_csimp() {
+    delete g_inline_candidates;
+}
 }
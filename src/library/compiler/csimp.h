@@ -30,4 +30,7 @@ inline expr csimp(environment const & env, expr const & e, csimp_cfg const & cfg
 inline expr cesimp(environment const & env, expr const & e, csimp_cfg const & cfg = csimp_cfg()) {
     return csimp_core(env, local_ctx(), e, false, cfg);
 }
+
+void initialize_csimp();
+void finalize_csimp();
 }
@@ -10,10 +10,55 @@ Author: Leonardo de Moura
 #include "kernel/abstract.h"
 #include "kernel/type_checker.h"
 #include "kernel/inductive.h"
+#include "kernel/assoc_cache.h"
 #include "library/compiler/util.h"
 #include "library/compiler/implemented_by_attribute.h"
+#include "library/compiler/erase_irrelevant.h"
 
 namespace lean {
+/* Every miss is a query to the type checker. */
+static cache_counters g_irrelevant_counters("erase_irrelevant relevance");
+static cache_counters g_runtime_type_counters("erase_irrelevant runtime type");
+
+static void count_cache_lookup(cache_counters & counters, bool hit) {
+    if (get_cache_stats_enabled()) {
+        if (hit)
+            counters.m_hits++;
+        else
+            counters.m_misses++;
+    }
+}
+
+optional<bool> erase_irrelevant_cache::find_irrelevant(expr const & c) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_irrelevant.find(c);
+    if (it != m_irrelevant.end())
+        return optional<bool>(it->second);
+    return optional<bool>();
+}
+
+void erase_irrelevant_cache::insert_irrelevant(expr const & c, bool r) {
+    // the entries may be released by a different thread
+    mark_mt(c.raw());
+    lock_guard<mutex> lock(m_mutex);
+    m_irrelevant.insert(mk_pair(c, r));
+}
+
+optional<expr> erase_irrelevant_cache::find_runtime_type(expr const & type) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_runtime_type.find(type);
+    if (it != m_runtime_type.end())
+        return some_expr(it->second);
+    return none_expr();
+}
+
+void erase_irrelevant_cache::insert_runtime_type(expr const & type, expr const & r) {
+    mark_mt(type.raw());
+    mark_mt(r.raw());
+    lock_guard<mutex> lock(m_mutex);
+    m_runtime_type.insert(mk_pair(type, r));
+}
+
 class erase_irrelevant_fn {
     typedef std::tuple<name, expr, expr> let_entry;
     type_checker::state  m_st;
@@ -22,7 +67,9 @@ class erase_irrelevant_fn {
     buffer<let_entry>    m_let_entries;
     name                 m_x;
     unsigned             m_next_idx{1};
+    /* Entries for free variables, the ones for constants are in `m_cache`. */
     expr_map<bool>       m_irrelevant_cache;
+    erase_irrelevant_cache & m_cache;
 
     environment & env() { return m_st.env(); }
 
@@ -43,18 +90,34 @@ class erase_irrelevant_fn {
     }
 
     expr mk_runtime_type(expr e) {
-        return ::lean::mk_runtime_type(m_st, m_lctx, e);
+        if (has_fvar(e))
+            return ::lean::mk_runtime_type(m_st, m_lctx, e);
+        optional<expr> r = m_cache.find_runtime_type(e);
+        count_cache_lookup(g_runtime_type_counters, static_cast<bool>(r));
+        if (r)
+            return *r;
+        expr new_r = ::lean::mk_runtime_type(m_st, m_lctx, e);
+        m_cache.insert_runtime_type(e, new_r);
+        return new_r;
     }
 
     bool cache_is_irrelevant(expr const & e, bool r) {
-        if (is_constant(e) || is_fvar(e))
+        if (is_constant(e))
+            m_cache.insert_irrelevant(e, r);
+        else if (is_fvar(e))
             m_irrelevant_cache.insert(mk_pair(e, r));
         return r;
     }
 
     bool is_irrelevant(expr const & e) {
-        if (is_constant(e) || is_fvar(e)) {
+        if (is_constant(e)) {
+            optional<bool> r = m_cache.find_irrelevant(e);
+            count_cache_lookup(g_irrelevant_counters, static_cast<bool>(r));
+            if (r)
+                return *r;
+        } else if (is_fvar(e)) {
             auto it1 = m_irrelevant_cache.find(e);
+            count_cache_lookup(g_irrelevant_counters, it1 != m_irrelevant_cache.end());
             if (it1 != m_irrelevant_cache.end())
                 return it1->second;
         }
@@ -485,14 +548,20 @@ class erase_irrelevant_fn {
         lean_unreachable();
     }
 public:
-    erase_irrelevant_fn(environment const & env, local_ctx const & lctx):
-        m_st(env), m_lctx(lctx), m_x("_x") {}
+    erase_irrelevant_fn(environment const & env, local_ctx const & lctx, erase_irrelevant_cache & cache):
+        m_st(env), m_lctx(lctx), m_x("_x"), m_cache(cache) {}
     expr operator()(expr const & e) {
         return mk_let(0, visit(e));
     }
 };
 
+expr erase_irrelevant_core(environment const & env, local_ctx const & lctx, expr const & e,
+                           erase_irrelevant_cache & cache) {
+    return erase_irrelevant_fn(env, lctx, cache)(e);
+}
+
 expr erase_irrelevant_core(environment const & env, local_ctx const & lctx, expr const & e) {
-    return erase_irrelevant_fn(env, lctx)(e);
+    erase_irrelevant_cache cache;
+    return erase_irrelevant_core(env, lctx, e, cache);
 }
 }
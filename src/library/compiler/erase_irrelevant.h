@@ -5,8 +5,26 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
+#include "runtime/thread.h"
 #include "kernel/environment.h"
+#include "kernel/expr_maps.h"
 namespace lean {
+/* Results of `erase_irrelevant` that do not depend on the declaration being erased: whether a constant is
+   irrelevant, and the runtime type of a closed type. It is shared by all declarations of a compilation unit,
+   which may be erased by different threads, and must only be used with a single environment. */
+class erase_irrelevant_cache {
+    mutex          m_mutex;
+    expr_map<bool> m_irrelevant;
+    expr_map<expr> m_runtime_type;
+public:
+    optional<bool> find_irrelevant(expr const & c);
+    void insert_irrelevant(expr const & c, bool r);
+    optional<expr> find_runtime_type(expr const & type);
+    void insert_runtime_type(expr const & type, expr const & r);
+};
+
+expr erase_irrelevant_core(environment const & env, local_ctx const & lctx, expr const & e,
+                           erase_irrelevant_cache & cache);
 expr erase_irrelevant_core(environment const & env, local_ctx const & lctx, expr const & e);
 inline expr erase_irrelevant(environment const & env, expr const & e) { return erase_irrelevant_core(env, local_ctx(), e); }
 }
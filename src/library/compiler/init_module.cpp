@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include "library/compiler/lcnf.h"
 #include "library/compiler/elim_dead_let.h"
 #include "library/compiler/cse.h"
+#include "library/compiler/csimp.h"
 #include "library/compiler/specialize.h"
 #include "library/compiler/llnf.h"
 #include "library/compiler/compiler.h"
@@ -22,6 +23,7 @@ void initialize_compiler_module() {
     initialize_lcnf();
     initialize_elim_dead_let();
     initialize_cse();
+    initialize_csimp();
     initialize_specialize();
     initialize_llnf();
     initialize_compiler();
@@ -39,6 +41,7 @@ void finalize_compiler_module() {
     finalize_compiler();
     finalize_llnf();
     finalize_specialize();
+    finalize_csimp();
     finalize_cse();
     finalize_elim_dead_let();
     finalize_lcnf();
@@ -5,7 +5,11 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <string>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
 #include "runtime/array_ref.h"
+#include "runtime/sstream.h"
 #include "util/nat.h"
 #include "kernel/instantiate.h"
 #include "kernel/type_checker.h"
@@ -575,18 +579,61 @@ extern "C" LEAN_EXPORT object* lean_add_extern(object * env, object * fn) {
     }
 }
 
-extern "C" object * lean_ir_emit_c(object * env, object * mod_name);
+extern "C" object * lean_ir_emit_c(object * env, object * mod_name, object * hot_fns, uint8 rc_profile, object * num_parts);
+
+/* Read the function names in the file given by `compiler.functionOrder`, one per line. */
+static array_ref<string_ref> get_hot_fns(options const & opts) {
+    buffer<string_ref> fns;
+    char const * fname = opts.get_string(name({"compiler", "functionOrder"}), "");
+    if (*fname == 0)
+        return array_ref<string_ref>(fns);
+    std::ifstream in(fname);
+    if (in.fail())
+        throw exception(sstream() << "failed to open function order file '" << fname << "'");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            fns.push_back(string_ref(line));
+    }
+    return array_ref<string_ref>(fns);
+}
 
-string_ref emit_c(environment const & env, name const & mod_name) {
-    object * r = lean_ir_emit_c(env.to_obj_arg(), mod_name.to_obj_arg());
-    string_ref s(cnstr_get(r, 0), true);
+array_ref<string_ref> emit_c(environment const & env, name const & mod_name, options const & opts) {
+    bool rc_profile    = opts.get_bool(name({"compiler", "rcProfile"}), false);
+    unsigned num_parts = opts.get_unsigned(name({"compiler", "cParts"}), 1);
+    object * r = lean_ir_emit_c(env.to_obj_arg(), mod_name.to_obj_arg(), get_hot_fns(opts).steal(), rc_profile,
+                                mk_nat_obj(num_parts));
     if (cnstr_tag(r) == 0) {
+        string_ref s(cnstr_get(r, 0), true);
         dec_ref(r);
         throw exception(s.to_std_string());
     } else {
+        array_ref<string_ref> parts(cnstr_get(r, 0), true);
         dec_ref(r);
-        return s;
+        return parts;
+    }
+}
+
+/* The C file of part `i` of the module, see `compiler.cParts`: `foo.c` for part 0, `foo.<i>.c` for the others. */
+std::string c_part_file_name(std::string const & fn, unsigned i) {
+    if (i == 0)
+        return fn;
+    std::string stem = fn.size() >= 2 && fn.compare(fn.size() - 2, 2, ".c") == 0 ? fn.substr(0, fn.size() - 2) : fn;
+    return stem + "." + std::to_string(i) + ".c";
+}
+
+void write_c_files(std::string const & fn, array_ref<string_ref> const & parts) {
+    for (unsigned i = 0; i < parts.size(); i++) {
+        std::string part_fn = c_part_file_name(fn, i);
+        std::ofstream out(part_fn, std::ios_base::binary);
+        if (out.fail())
+            throw exception(sstream() << "failed to create '" << part_fn << "'");
+        out << parts[i].data();
     }
+    // remove the files of parts left over from a previous run with a larger `compiler.cParts`
+    for (unsigned i = std::max<unsigned>(parts.size(), 1); std::remove(c_part_file_name(fn, i).c_str()) == 0; i++) {}
 }
 
 /*
@@ -595,6 +642,7 @@ inductive CtorFieldInfo
 | object (i : Nat)
 | usize  (i : Nat)
 | scalar (sz : Nat) (offset : Nat) (type : IRType)
+| struct (ctorName : Name) (fields : List CtorFieldInfo)
 
 structure CtorLayout :=
 (cidx       : Nat)
@@ -603,24 +651,30 @@ structure CtorLayout :=
 (numUSize   : Nat)
 (scalarSize : Nat)
 */
+static object_ref to_object_ref(field_info const & finfo) {
+    switch (finfo.m_kind) {
+    case field_info::Irrelevant:
+        return object_ref(box(0));
+    case field_info::Object:
+        return mk_cnstr(1, nat(finfo.m_idx));
+    case field_info::USize:
+        return mk_cnstr(2, nat(finfo.m_idx));
+    case field_info::Scalar:
+        return mk_cnstr(3, nat(finfo.m_size), nat(finfo.m_offset), object_ref(ir::box_type(to_ir_type(finfo.m_type))));
+    case field_info::Struct: {
+        buffer<object_ref> fields;
+        for (field_info const & sub : finfo.m_fields)
+            fields.push_back(to_object_ref(sub));
+        return mk_cnstr(4, finfo.m_cnstr, list_ref<object_ref>(fields));
+    }
+    }
+    lean_unreachable();
+}
+
 object_ref to_object_ref(cnstr_info const & info) {
     buffer<object_ref> fields;
-    for (field_info const & finfo : info.m_field_info) {
-        switch (finfo.m_kind) {
-        case field_info::Irrelevant:
-            fields.push_back(object_ref(box(0)));
-            break;
-        case field_info::Object:
-            fields.push_back(mk_cnstr(1, nat(finfo.m_idx)));
-            break;
-        case field_info::USize:
-            fields.push_back(mk_cnstr(2, nat(finfo.m_idx)));
-            break;
-        case field_info::Scalar:
-            fields.push_back(mk_cnstr(3, nat(finfo.m_size), nat(finfo.m_offset), object_ref(ir::box_type(to_ir_type(finfo.m_type)))));
-            break;
-        }
-    }
+    for (field_info const & finfo : info.m_field_info)
+        fields.push_back(to_object_ref(finfo));
     return mk_cnstr(0, nat(info.m_cidx), list_ref<object_ref>(fields), nat(info.m_num_objs), nat(info.m_num_usizes), nat(info.m_scalar_sz));
 }
 
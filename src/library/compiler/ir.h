@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include "runtime/array_ref.h"
 #include "kernel/environment.h"
 #include "library/compiler/util.h"
 namespace lean {
@@ -36,7 +37,10 @@ std::string decl_to_string(decl const & d);
 void test(decl const & d);
 environment compile(environment const & env, options const & opts, comp_decls const & decls);
 environment add_extern(environment const & env, name const & fn);
-string_ref emit_c(environment const & env, name const & mod_name);
+/* The C code of module `mod_name`, split into the number of files given by `compiler.cParts`. */
+array_ref<string_ref> emit_c(environment const & env, name const & mod_name, options const & opts);
+/* Write the parts returned by `emit_c` to `fn` and the files named after it, see `compiler.cParts`. */
+void write_c_files(std::string const & fn, array_ref<string_ref> const & parts);
 }
 void initialize_ir();
 void finalize_ir();
@@ -10,16 +10,18 @@ Motivation
 ==========
 
 Even with a JIT compiler, we still have a need for a simpler interpreter on platforms LLVM JIT does not support (i.e.
-WebAssembly). Because this is mostly an edge case, we strive for simplicity instead of performance and thus reuse the
-existing compiler IR instead of inventing something like a new bytecode format.
+WebAssembly). Because this is mostly an edge case, we strive for simplicity instead of performance and thus stay close
+to the existing compiler IR instead of inventing a separate bytecode format and compiler pipeline.
 
 Implementation
 ==============
 
 The interpreter mainly consists of a homogeneous stack of `value`s, which are either unboxed values or pointers to boxed
 objects. The IR type system tells us which union member is active at any time. IR variables are mapped to stack
-slots by adding the current base pointer to the variable index. Further stacks are used for storing join points and call
-stack metadata. The interpreted IR is taken directly from the environment. Whenever possible, we try to switch to native
+slots by adding the current base pointer to the variable index. A further stack is used for storing call stack metadata.
+The interpreted IR is taken directly from the environment and translated on first use into a flat array of pre-decoded
+instructions per declaration, in which variables, join points, literals, and callees are already resolved; see `code`
+below. Whenever possible, we try to switch to native
 code by checking for the mangled symbol via dlsym/GetProcAddress, which is also how we can call external functions
 (which only works if the file declaring them has already been compiled). We always call the "boxed" versions of native
 functions, which have a (relatively) homogeneous ABI that we can use without runtime code generation; see also
@@ -28,6 +30,13 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 */
 #include <string>
 #include <vector>
+#include <memory>
+#include <climits>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
 #include <psapi.h>
@@ -37,9 +46,14 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #include "runtime/flet.h"
 #include "runtime/apply.h"
 #include "runtime/interrupt.h"
+#include "runtime/memory.h"
+#include "runtime/alloc.h"
+#include "runtime/buffer.h"
 #include "runtime/io.h"
 #include "runtime/option_ref.h"
 #include "runtime/array_ref.h"
+#include "runtime/thread.h"
+#include "runtime/load_dynlib.h"
 #include "library/time_task.h"
 #include "library/trace.h"
 #include "library/compiler/ir.h"
@@ -51,6 +65,14 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #define LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE true
 #endif
 
+#ifndef LEAN_DEFAULT_INTERPRETER_PROFILE
+#define LEAN_DEFAULT_INTERPRETER_PROFILE false
+#endif
+
+#ifndef LEAN_DEFAULT_INTERPRETER_HOT_THRESHOLD
+#define LEAN_DEFAULT_INTERPRETER_HOT_THRESHOLD 1000
+#endif
+
 namespace lean {
 namespace ir {
 // C++ wrappers of Lean data types
@@ -190,7 +212,9 @@ extern "C" double lean_float_of_nat(lean_obj_arg a);
 static string_ref * g_mangle_prefix = nullptr;
 static string_ref * g_boxed_suffix = nullptr;
 static string_ref * g_boxed_mangled_suffix = nullptr;
-static name * g_interpreter_prefer_native = nullptr;
+static option_key * g_interpreter_prefer_native = nullptr;
+static option_key * g_interpreter_hot_threshold = nullptr;
+static option_key * g_interpreter_profile = nullptr;
 
 // constants (lacking native declarations) initialized by `lean_run_init`
 static name_map<object *> * g_init_globals;
@@ -295,7 +319,7 @@ void print_value(tout const & ios, value const & v, type t) {
   return print_value(const_cast<tout &>(ios), v, t);
 }
 
-void * lookup_symbol_in_cur_exe(char const * sym) {
+static void * lookup_symbol_in_cur_exe_core(char const * sym) {
 #ifdef LEAN_WINDOWS
     HMODULE hmods[128];  // 128 modules should be enough for everyone
     DWORD bytes_needed;
@@ -312,57 +336,706 @@ void * lookup_symbol_in_cur_exe(char const * sym) {
 #endif
 }
 
+/** \brief Results of `lookup_symbol_in_cur_exe_core`, shared by all threads.
+
+    `dlsym(RTLD_DEFAULT, sym)` searches the executable and every loaded library, which is slow with several large
+    libraries loaded via `--load-dynlib`, in particular for symbols that do not exist such as the boxed versions of
+    most functions. Each mangled name is only looked up once. Failed lookups are retried after another library has been
+    loaded. */
+class symbol_table {
+    struct entry {
+        void *   m_addr;
+        // value of `get_dynlib_generation()` at the lookup
+        unsigned m_generation;
+    };
+    mutex                                  m_mutex;
+    std::unordered_map<std::string, entry> m_entries;
+public:
+    void * find(char const * sym) {
+        unsigned generation = get_dynlib_generation();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            auto it = m_entries.find(sym);
+            if (it != m_entries.end() && (it->second.m_addr || it->second.m_generation == generation))
+                return it->second.m_addr;
+        }
+        void * addr = lookup_symbol_in_cur_exe_core(sym);
+        lock_guard<mutex> lock(m_mutex);
+        m_entries[sym] = entry{addr, generation};
+        return addr;
+    }
+};
+
+static symbol_table * g_symbol_table = nullptr;
+
+void * lookup_symbol_in_cur_exe(char const * sym) {
+    return g_symbol_table->find(sym);
+}
+
 class interpreter;
 LEAN_THREAD_PTR(interpreter, g_interpreter);
 
+// stack slot offset of an irrelevant argument in pre-decoded instructions
+static constexpr unsigned g_irrelevant_slot = UINT_MAX;
+static constexpr unsigned g_no_instr = UINT_MAX;
+// number of slots in the first segment of the interpreter stack
+static constexpr size_t g_value_stack_segment_size = 1 << 14;
+
+extern "C" uint8 lean_ir_is_imported_decl(b_obj_arg env, b_obj_arg n);
+
+/** \brief Symbol lookups and constant values of imported declarations, shared by all interpreters (on any thread) whose
+    environments have the same imports. Entries are dropped when an interpreter with different imports inserts into
+    the cache. All stored objects are marked as multi-threaded. */
+class shared_interpreter_cache {
+public:
+    struct symbol_entry {
+        decl   m_decl;
+        void * m_addr;
+        bool   m_boxed;
+        // true iff the native symbol must be used even if `interpreter.prefer_native` is false
+        bool   m_native_required;
+    };
+private:
+    struct constant_entry {
+        bool   m_is_scalar;
+        value  m_val;
+    };
+    mutex    m_mutex;
+    // imported constant map of the environments the entries belong to
+    object * m_scope = nullptr;
+    std::unordered_map<name, symbol_entry, name_hash_fn, name_eq_fn>   m_symbols;
+    std::unordered_map<name, constant_entry, name_hash_fn, name_eq_fn> m_constants;
+
+    void clear_core() {
+        for (auto const & p : m_constants) {
+            if (!p.second.m_is_scalar)
+                dec(p.second.m_val.m_obj);
+        }
+        m_constants.clear();
+        m_symbols.clear();
+        if (m_scope)
+            dec(m_scope);
+        m_scope = nullptr;
+    }
+
+    void set_scope(object * scope) {
+        if (m_scope != scope) {
+            clear_core();
+            // mark as multi-threaded so that the interpreter replacing it may release it from a different thread
+            mark_mt(scope);
+            inc(scope);
+            m_scope = scope;
+        }
+    }
+public:
+    ~shared_interpreter_cache() { clear_core(); }
+
+    void clear() {
+        lock_guard<mutex> lock(m_mutex);
+        clear_core();
+    }
+
+    bool find_symbol(object * scope, name const & fn, symbol_entry & r) {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_scope != scope)
+            return false;
+        auto it = m_symbols.find(fn);
+        if (it == m_symbols.end())
+            return false;
+        r = it->second;
+        return true;
+    }
+
+    void insert_symbol(object * scope, name const & fn, symbol_entry const & e) {
+        mark_mt(fn.raw());
+        mark_mt(e.m_decl.raw());
+        lock_guard<mutex> lock(m_mutex);
+        set_scope(scope);
+        auto it = m_symbols.find(fn);
+        if (it == m_symbols.end()) {
+            m_symbols.emplace(fn, e);
+        } else {
+            it->second = e;
+        }
+    }
+
+    /* If the value of the constant `fn` is cached, store a new reference to it in `r`. */
+    bool find_constant(object * scope, name const & fn, value & r) {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_scope != scope)
+            return false;
+        auto it = m_constants.find(fn);
+        if (it == m_constants.end())
+            return false;
+        r = it->second.m_val;
+        if (!it->second.m_is_scalar)
+            inc(r.m_obj);
+        return true;
+    }
+
+    /* Store the value of the constant `fn`. If `is_scalar` is false, the cache takes a new reference to it. */
+    void insert_constant(object * scope, name const & fn, bool is_scalar, value v) {
+        mark_mt(fn.raw());
+        if (!is_scalar)
+            mark_mt(v.m_obj);
+        lock_guard<mutex> lock(m_mutex);
+        set_scope(scope);
+        if (m_constants.find(fn) == m_constants.end()) {
+            if (!is_scalar)
+                inc(v.m_obj);
+            m_constants.emplace(fn, constant_entry { is_scalar, v });
+        }
+    }
+};
+static shared_interpreter_cache * g_shared_cache = nullptr;
+
+/* Memory pressure handler, see `check_memory`. */
+static void clear_shared_interpreter_cache() {
+    g_shared_cache->clear();
+}
+
+/** \brief Stack of interpreter variable slots made of segments that are never reallocated, so that slots do not move
+    when the stack grows. Every allocation is contiguous; allocations that do not fit into the current segment start a
+    new one. Segments are kept for reuse after the stack shrinks. */
+class value_stack {
+    struct segment {
+        std::unique_ptr<value[]> m_data;
+        size_t                   m_size;
+    };
+    std::vector<segment> m_segments;
+    unsigned             m_seg{0};
+    value *              m_top{nullptr};
+    value *              m_end{nullptr};
+    size_t               m_in_use{0};
+    size_t               m_max_in_use{0};
+
+    void next_segment(size_t n) {
+        unsigned seg = m_top ? m_seg + 1 : 0;
+        if (seg < m_segments.size() && m_segments[seg].m_size < n) {
+            // too small, and not in use because it is above the top
+            m_segments.resize(seg);
+        }
+        if (seg == m_segments.size()) {
+            size_t size = std::max(n, seg == 0 ? g_value_stack_segment_size : 2 * m_segments.back().m_size);
+            m_segments.push_back(segment { std::unique_ptr<value[]>(new value[size]), size });
+        }
+        m_seg = seg;
+        m_top = m_segments[seg].m_data.get();
+        m_end = m_top + m_segments[seg].m_size;
+    }
+public:
+    struct mark {
+        unsigned m_seg;
+        value *  m_top;
+        size_t   m_in_use;
+    };
+
+    mark get_mark() const { return mark { m_seg, m_top, m_in_use }; }
+
+    /** \brief Return `n` contiguous slots. */
+    value * alloc(size_t n) {
+        if (static_cast<size_t>(m_end - m_top) < n)
+            next_segment(n);
+        value * r = m_top;
+        m_top += n;
+        m_in_use += n;
+        m_max_in_use = std::max(m_max_in_use, m_in_use);
+        return r;
+    }
+
+    /** \brief Release all slots allocated since `m` was taken. */
+    void restore(mark const & m) {
+        m_seg    = m.m_seg;
+        m_top    = m.m_top;
+        m_end    = m_top ? m_segments[m_seg].m_data.get() + m_segments[m_seg].m_size : nullptr;
+        m_in_use = m.m_in_use;
+    }
+
+    size_t get_max_in_use() const { return m_max_in_use; }
+    size_t get_num_segments() const { return m_segments.size(); }
+};
+
+/* Statistics of all interpreters that have finished so far, see `display_interpreter_stats` */
+static atomic<uint64> g_interpreter_sessions(0);
+static atomic<uint64> g_interpreter_max_depth(0);
+static atomic<uint64> g_interpreter_max_slots(0);
+static atomic<uint64> g_interpreter_max_segments(0);
+
+static void update_max(atomic<uint64> & m, uint64 v) {
+    uint64 old = m.load();
+    while (old < v && !m.compare_exchange_weak(old, v)) {}
+}
+
+/* Profile of all interpreters that have finished so far, see `interpreter.profile` */
+struct interpreter_profile_entry {
+    uint64          m_calls{0};
+    second_duration m_self{0};
+    // time of outermost calls, so that recursive calls are not counted twice
+    second_duration m_total{0};
+};
+static mutex * g_interpreter_profile_mutex = nullptr;
+// keyed by the function name, followed by ` [native]` for native code called from the interpreter
+static std::unordered_map<std::string, interpreter_profile_entry> * g_interpreter_profile_entries = nullptr;
+// self time per call stack, in the "folded stacks" format of flame graph tools
+static std::unordered_map<std::string, second_duration> * g_interpreter_profile_stacks = nullptr;
+
 class interpreter {
     // stack of IR variable slots
-    std::vector<value> m_arg_stack;
-    // stack of join points
-    std::vector<fn_body const *> m_jp_stack;
+    value_stack m_stack;
     struct frame {
-        name m_fn;
-        // base pointers into the stack above
-        size_t m_arg_bp;
-        size_t m_jp_bp;
-
-        frame(name const & mFn, size_t mArgBp, size_t mJpBp) : m_fn(mFn), m_arg_bp(mArgBp), m_jp_bp(mJpBp) {}
+        // owned by the symbol or code cache
+        decl const *       m_decl;
+        // slots of the frame; `nullptr` for native code
+        value *            m_base;
+        // stack top before the frame was allocated
+        value_stack::mark  m_mark;
+        // only used if `m_profile` is set
+        unsigned           m_prof_node;
+        std::chrono::steady_clock::time_point m_prof_start;
+        second_duration    m_prof_children;
     };
+    // trivially copyable, so growing it is cheap
     std::vector<frame> m_call_stack;
+    // `m_base` of the current frame
+    value * m_base = nullptr;
+    size_t m_max_depth = 0;
     environment const & m_env;
     options const & m_opts;
     // if `false`, use IR code where possible
     bool m_prefer_native;
+    // number of interpreted calls after which we look for native code again; 0 if disabled
+    unsigned m_hot_threshold;
+    // if `true`, record time and calls of each function in the call tree below
+    bool m_profile;
+    struct profile_node {
+        decl const *    m_decl;
+        unsigned        m_parent;
+        bool            m_native;
+        uint64          m_calls;
+        second_duration m_self;
+        second_duration m_total;
+        // time of the calls without an active call of the same function further up the stack
+        second_duration m_outer;
+    };
+    struct profile_key_hash {
+        size_t operator()(std::pair<unsigned, decl const *> const & k) const {
+            return std::hash<decl const *>()(k.second) ^ (static_cast<size_t>(k.first) * 0x9e3779b9u);
+        }
+    };
+    // node 0 is the root; parents precede their children
+    std::vector<profile_node> m_profile_nodes;
+    std::unordered_map<std::pair<unsigned, decl const *>, unsigned, profile_key_hash> m_profile_children;
+    // number of active frames per function, keyed by whether the frame is native and the declaration
+    std::unordered_map<std::pair<unsigned, decl const *>, unsigned, profile_key_hash> m_profile_active;
+    // key of `g_shared_cache` entries usable with `m_env`; `nullptr` if they are not
+    object * m_shared_scope;
     struct constant_cache_entry {
       bool m_is_scalar;
       value m_val;
     };
     // caches values of nullary functions ("constants")
     name_map<constant_cache_entry> m_constant_cache;
+
+    /* Pre-decoded function bodies
+       ===========================
+
+       Before a function body is interpreted for the first time, we translate it into a flat array of `instr`s (see
+       `code_builder`) so that `eval_body` does not have to go through the IR accessors and decode `nat` fields in every
+       step: variables are resolved to stack slot offsets, join points to instruction indices, literals to `value`s,
+       and callees to symbol cache entries (on first execution). `JDecl` and `MData` nodes are erased. */
+    enum class op : uint8 {
+        Ctor, Reset, Reuse, Proj, UProj, SProj, FAp, Const, TailCall, PAp, Ap, Box, Unbox, Lit, IsShared, IsTaggedPtr,
+        Set, SetTag, USet, SSet, Inc, Dec, Del, Case, Ret, Jmp, Unreachable, Invalid
+    };
+    struct code;
     struct symbol_cache_entry {
         decl m_decl;
         // symbol address; `nullptr` if function does not have native code
         void * m_addr;
         // true iff we chose the boxed version of a function where the IR uses the unboxed version
         bool m_boxed;
+        // pre-decoded body; `nullptr` until first interpreted
+        code * m_code;
+        // number of interpreted calls and self tail calls since we last looked for native code, see `tier_up`
+        unsigned m_num_calls;
+    };
+    struct instr {
+        op       m_op;
+        // type of the declared variable, or of the stored field (`SSet`) or discriminant (`Case`)
+        type     m_type;
+        // `Box`: type of the unboxed value
+        type     m_arg_type;
+        // `Reuse`: whether the constructor tag must be updated; `Lit`: whether `m_lit` must be incremented
+        bool     m_flag;
+        // stack slot offsets of the declared variable, the object operand, and the stored value or argument
+        unsigned m_dst;
+        unsigned m_src;
+        unsigned m_val;
+        // decoded numeric field: constructor tag, field index or byte offset, counter increment, or, for `Jmp`,
+        // the offset of the join point parameters in `code::m_args`
+        unsigned m_num;
+        // `Ctor`, `Reuse`: constructor layout
+        unsigned m_size;
+        unsigned m_usize;
+        unsigned m_ssize;
+        // arguments at `[m_args, m_args + m_num_args)` in `code::m_args`, or alternatives in `code::m_alts` for `Case`
+        unsigned m_args;
+        unsigned m_num_args;
+        // index of the continuation, or of the join point body for `Jmp`
+        unsigned m_next;
+        value    m_lit;
+        // callee of `FAp` and `PAp`, resolved on first execution
+        symbol_cache_entry * m_fn;
+        // original IR, used for tracing and by instructions that are not worth decoding
+        fn_body const * m_body;
+    };
+    struct case_alt {
+        bool     m_default;
+        unsigned m_tag;
+        unsigned m_target;
+    };
+    struct code {
+        // keeps the IR referenced by `instr::m_body` alive
+        decl                  m_decl;
+        unsigned              m_entry;
+        // number of stack slots used by the function body, including its parameters
+        unsigned              m_num_slots;
+        std::vector<instr>    m_instrs;
+        std::vector<unsigned> m_args;
+        std::vector<case_alt> m_alts;
+
+        explicit code(decl const & d) : m_decl(d), m_entry(0), m_num_slots(decl_params(d).size()) {}
+    };
+    // caches symbol lookup successes _and_ failures; entries must not move because `instr::m_fn` points to them
+    std::unordered_map<name, symbol_cache_entry, name_hash_fn, name_eq_fn> m_symbol_cache;
+    std::unordered_map<name, std::unique_ptr<code>, name_hash_fn, name_eq_fn> m_code_cache;
+
+    /** \brief Translate a function body into `code`. */
+    class code_builder {
+        struct jp_info {
+            unsigned m_id;
+            unsigned m_body;
+            unsigned m_params;
+        };
+        code &               m_code;
+        // join points in scope
+        std::vector<jp_info> m_jps;
+
+        unsigned slot(var_id const & x) {
+            // variables are 1-indexed
+            unsigned s = x.get_small_value() - 1;
+            m_code.m_num_slots = std::max(m_code.m_num_slots, s + 1);
+            return s;
+        }
+
+        unsigned arg_slot(arg const & a) {
+            return arg_is_irrelevant(a) ? g_irrelevant_slot : slot(arg_var_id(a));
+        }
+
+        void set_args(instr & i, array_ref<arg> const & args) {
+            i.m_args     = m_code.m_args.size();
+            i.m_num_args = args.size();
+            for (arg const & a : args) {
+                m_code.m_args.push_back(arg_slot(a));
+            }
+        }
+
+        void set_ctor(instr & i, ctor_info const & c) {
+            i.m_num   = ctor_info_tag(c).get_small_value();
+            i.m_size  = ctor_info_size(c).get_small_value();
+            i.m_usize = ctor_info_usize(c).get_small_value();
+            i.m_ssize = ctor_info_ssize(c).get_small_value();
+        }
+
+        void set_lit(instr & i, lit_val const & l) {
+            i.m_op = op::Lit;
+            if (lit_val_tag(l) == lit_val_kind::Str) {
+                i.m_lit  = lit_val_str(l).raw();
+                i.m_flag = true;
+                return;
+            }
+            nat const & n = lit_val_num(l);
+            switch (i.m_type) {
+                case type::Float:
+                    lean_inc(n.raw());
+                    i.m_lit = value::from_float(lean_float_of_nat(n.raw()));
+                    break;
+                case type::UInt8:
+                case type::UInt16:
+                case type::UInt32:
+                case type::USize:
+                    i.m_lit = lean_usize_of_nat(n.raw());
+                    break;
+                case type::UInt64:
+                    i.m_lit = lean_uint64_of_nat(n.raw());
+                    break;
+                // `nat` literal
+                case type::Object:
+                case type::TObject:
+                    i.m_lit  = n.raw();
+                    i.m_flag = !is_scalar(n.raw());
+                    break;
+                case type::Irrelevant:
+                    i.m_op = op::Invalid;
+                    break;
+            }
+        }
+
+        /* Decode variable declaration `b`. Return `true` if it is a self tail call, which makes its continuation dead. */
+        bool set_vdecl(instr & i, fn_body const & b) {
+            expr const & e = fn_body_vdecl_expr(b);
+            i.m_type = fn_body_vdecl_type(b);
+            i.m_dst  = slot(fn_body_vdecl_var(b));
+            switch (expr_tag(e)) {
+                case expr_kind::Ctor:
+                    i.m_op = op::Ctor;
+                    set_ctor(i, expr_ctor_info(e));
+                    set_args(i, expr_ctor_args(e));
+                    break;
+                case expr_kind::Reset:
+                    i.m_op  = op::Reset;
+                    i.m_src = slot(expr_reset_obj(e));
+                    i.m_num = expr_reset_num_objs(e).get_small_value();
+                    break;
+                case expr_kind::Reuse:
+                    i.m_op   = op::Reuse;
+                    i.m_src  = slot(expr_reuse_obj(e));
+                    i.m_flag = expr_reuse_update_header(e);
+                    set_ctor(i, expr_reuse_ctor(e));
+                    set_args(i, expr_reuse_args(e));
+                    break;
+                case expr_kind::Proj:
+                    i.m_op  = op::Proj;
+                    i.m_src = slot(expr_proj_obj(e));
+                    i.m_num = expr_proj_idx(e).get_small_value();
+                    break;
+                case expr_kind::UProj:
+                    i.m_op  = op::UProj;
+                    i.m_src = slot(expr_uproj_obj(e));
+                    i.m_num = expr_uproj_idx(e).get_small_value();
+                    break;
+                case expr_kind::SProj:
+                    i.m_op  = op::SProj;
+                    i.m_src = slot(expr_sproj_obj(e));
+                    i.m_num = expr_sproj_idx(e).get_small_value() * sizeof(void *) + expr_sproj_offset(e).get_small_value();
+                    break;
+                case expr_kind::FAp: {
+                    set_args(i, expr_fap_args(e));
+                    fn_body const & cont = fn_body_vdecl_cont(b);
+                    if (expr_fap_args(e).size() == 0) {
+                        // nullary function ("constant")
+                        i.m_op = op::Const;
+                    } else if (expr_fap_fun(e) == decl_fun_id(m_code.m_decl) && fn_body_tag(cont) == fn_body_kind::Ret &&
+                               !arg_is_irrelevant(fn_body_ret_arg(cont)) &&
+                               arg_var_id(fn_body_ret_arg(cont)) == fn_body_vdecl_var(b)) {
+                        i.m_op = op::TailCall;
+                        return true;
+                    } else {
+                        i.m_op = op::FAp;
+                    }
+                    break;
+                }
+                case expr_kind::PAp:
+                    i.m_op = op::PAp;
+                    set_args(i, expr_pap_args(e));
+                    break;
+                case expr_kind::Ap:
+                    i.m_op  = op::Ap;
+                    i.m_src = slot(expr_ap_fun(e));
+                    set_args(i, expr_ap_args(e));
+                    break;
+                case expr_kind::Box:
+                    i.m_op       = op::Box;
+                    i.m_src      = slot(expr_box_obj(e));
+                    i.m_arg_type = expr_box_type(e);
+                    break;
+                case expr_kind::Unbox:
+                    i.m_op  = op::Unbox;
+                    i.m_src = slot(expr_unbox_obj(e));
+                    break;
+                case expr_kind::Lit:
+                    set_lit(i, expr_lit_val(e));
+                    break;
+                case expr_kind::IsShared:
+                    i.m_op  = op::IsShared;
+                    i.m_src = slot(expr_is_shared_obj(e));
+                    break;
+                case expr_kind::IsTaggedPtr:
+                    i.m_op  = op::IsTaggedPtr;
+                    i.m_src = slot(expr_is_tagged_ptr_obj(e));
+                    break;
+                default:
+                    i.m_op = op::Invalid;
+                    break;
+            }
+            return false;
+        }
+
+        /* Append the instructions of `b0` and return the index of the first one. */
+        unsigned compile(fn_body const & b0) {
+            size_t   num_jps = m_jps.size();
+            unsigned start   = g_no_instr;
+            unsigned prev    = g_no_instr;
+            auto emit = [&](instr const & i) {
+                unsigned idx = m_code.m_instrs.size();
+                m_code.m_instrs.push_back(i);
+                if (prev == g_no_instr) {
+                    start = idx;
+                } else {
+                    m_code.m_instrs[prev].m_next = idx;
+                }
+                prev = idx;
+                return idx;
+            };
+            fn_body const * b = &b0;
+            bool done = false;
+            while (!done) {
+                instr i {};
+                i.m_body = b;
+                switch (fn_body_tag(*b)) {
+                    case fn_body_kind::VDecl:
+                        done = set_vdecl(i, *b);
+                        emit(i);
+                        b = &fn_body_vdecl_cont(*b);
+                        break;
+                    case fn_body_kind::JDecl: {
+                        jp_info jp;
+                        jp.m_id     = fn_body_jdecl_id(*b).get_small_value();
+                        jp.m_params = m_code.m_args.size();
+                        for (param const & p : fn_body_jdecl_params(*b)) {
+                            m_code.m_args.push_back(slot(param_var(p)));
+                        }
+                        jp.m_body = compile(fn_body_jdecl_body(*b));
+                        m_jps.push_back(jp);
+                        b = &fn_body_jdecl_cont(*b);
+                        break;
+                    }
+                    case fn_body_kind::Set:
+                        i.m_op  = op::Set;
+                        i.m_src = slot(fn_body_set_var(*b));
+                        i.m_num = fn_body_set_idx(*b).get_small_value();
+                        i.m_val = arg_slot(fn_body_set_arg(*b));
+                        emit(i);
+                        b = &fn_body_set_cont(*b);
+                        break;
+                    case fn_body_kind::SetTag:
+                        i.m_op  = op::SetTag;
+                        i.m_src = slot(fn_body_set_tag_var(*b));
+                        i.m_num = fn_body_set_tag_cidx(*b).get_small_value();
+                        emit(i);
+                        b = &fn_body_set_tag_cont(*b);
+                        break;
+                    case fn_body_kind::USet:
+                        i.m_op  = op::USet;
+                        i.m_src = slot(fn_body_uset_target(*b));
+                        i.m_num = fn_body_uset_idx(*b).get_small_value();
+                        i.m_val = slot(fn_body_uset_source(*b));
+                        emit(i);
+                        b = &fn_body_uset_cont(*b);
+                        break;
+                    case fn_body_kind::SSet:
+                        i.m_op   = op::SSet;
+                        i.m_type = fn_body_sset_type(*b);
+                        i.m_src  = slot(fn_body_sset_target(*b));
+                        i.m_num  = fn_body_sset_idx(*b).get_small_value() * sizeof(void *) +
+                                   fn_body_sset_offset(*b).get_small_value();
+                        i.m_val  = slot(fn_body_sset_source(*b));
+                        emit(i);
+                        b = &fn_body_sset_cont(*b);
+                        break;
+                    case fn_body_kind::Inc:
+                        i.m_op  = op::Inc;
+                        i.m_src = slot(fn_body_inc_var(*b));
+                        i.m_num = fn_body_inc_val(*b).get_small_value();
+                        emit(i);
+                        b = &fn_body_inc_cont(*b);
+                        break;
+                    case fn_body_kind::Dec:
+                        i.m_op  = op::Dec;
+                        i.m_src = slot(fn_body_dec_var(*b));
+                        i.m_num = fn_body_dec_val(*b).get_small_value();
+                        emit(i);
+                        b = &fn_body_dec_cont(*b);
+                        break;
+                    case fn_body_kind::Del:
+                        i.m_op  = op::Del;
+                        i.m_src = slot(fn_body_del_var(*b));
+                        emit(i);
+                        b = &fn_body_del_cont(*b);
+                        break;
+                    case fn_body_kind::MData:
+                        b = &fn_body_mdata_cont(*b);
+                        break;
+                    case fn_body_kind::Case: {
+                        array_ref<alt_core> const & alts = fn_body_case_alts(*b);
+                        i.m_op       = op::Case;
+                        i.m_type     = fn_body_case_var_type(*b);
+                        i.m_src      = slot(fn_body_case_var(*b));
+                        i.m_args     = m_code.m_alts.size();
+                        i.m_num_args = alts.size();
+                        for (alt_core const & a : alts) {
+                            if (alt_core_tag(a) == alt_core_kind::Ctor) {
+                                m_code.m_alts.push_back(case_alt { false, static_cast<unsigned>(ctor_info_tag(alt_core_ctor_info(a)).get_small_value()), 0 });
+                            } else {
+                                m_code.m_alts.push_back(case_alt { true, 0, 0 });
+                            }
+                        }
+                        emit(i);
+                        for (unsigned k = 0; k < alts.size(); k++) {
+                            alt_core const & a = alts[k];
+                            unsigned target = compile(alt_core_tag(a) == alt_core_kind::Ctor ? alt_core_ctor_cont(a) : alt_core_default_cont(a));
+                            m_code.m_alts[i.m_args + k].m_target = target;
+                        }
+                        done = true;
+                        break;
+                    }
+                    case fn_body_kind::Ret:
+                        i.m_op  = op::Ret;
+                        i.m_val = arg_slot(fn_body_ret_arg(*b));
+                        emit(i);
+                        done = true;
+                        break;
+                    case fn_body_kind::Jmp: {
+                        unsigned id = fn_body_jmp_jp(*b).get_small_value();
+                        auto it = std::find_if(m_jps.rbegin(), m_jps.rend(), [&](jp_info const & jp) { return jp.m_id == id; });
+                        if (it == m_jps.rend()) {
+                            throw exception(sstream() << "unknown join point " << id << " in '" << decl_fun_id(m_code.m_decl) << "'");
+                        }
+                        i.m_op  = op::Jmp;
+                        i.m_num = it->m_params;
+                        set_args(i, fn_body_jmp_args(*b));
+                        unsigned idx = emit(i);
+                        m_code.m_instrs[idx].m_next = it->m_body;
+                        done = true;
+                        break;
+                    }
+                    case fn_body_kind::Unreachable:
+                        i.m_op = op::Unreachable;
+                        emit(i);
+                        done = true;
+                        break;
+                }
+            }
+            m_jps.resize(num_jps);
+            return start;
+        }
+    public:
+        explicit code_builder(code & c) : m_code(c) {}
+
+        void operator()() {
+            m_code.m_entry = compile(decl_fun_body(m_code.m_decl));
+        }
     };
-    // caches symbol lookup successes _and_ failures
-    name_map<symbol_cache_entry> m_symbol_cache;
 
     /** \brief Get current stack frame */
     inline frame & get_frame() {
         return m_call_stack.back();
     }
 
-    /** \brief Get reference to stack slot of IR variable */
-    inline value & var(var_id const & v) {
-        // variables are 1-indexed
-        size_t i = get_frame().m_arg_bp + v.get_small_value() - 1;
-        // we don't know the frame size (unless we do an additional IR pass), so we extend it dynamically
-        if (i >= m_arg_stack.size()) {
-            m_arg_stack.resize(i + 1);
-        }
-        return m_arg_stack[i];
+    /** \brief Get reference to stack slot of IR variable, see `code_builder::slot` */
+    inline value & var(unsigned slot) {
+        lean_assert(m_base);
+        return m_base[slot];
     }
 
 public:
@@ -382,27 +1055,21 @@ public:
     }
 
 private:
-    value eval_arg(arg const & a) {
+    value eval_arg(unsigned slot) {
         // an "irrelevant" argument is type- or proof-erased; we can use an arbitrary value for it
-        return arg_is_irrelevant(a) ? box(0) : var(arg_var_id(a));
+        return slot == g_irrelevant_slot ? box(0) : var(slot);
     }
 
-    /** \brief Allocate constructor object with given tag and arguments */
-    object * alloc_ctor(ctor_info const & i, array_ref<arg> const & args) {
-        size_t tag = ctor_info_tag(i).get_small_value();
-        // number of boxed object fields
-        size_t size = ctor_info_size(i).get_small_value();
-        // number of unboxed USize fields (whose byte size the IR is ignorant of)
-        size_t usize = ctor_info_usize(i).get_small_value();
-        // byte size of all other unboxed fields
-        size_t ssize = ctor_info_ssize(i).get_small_value();
-        if (size == 0 && usize == 0 && ssize == 0) {
+    /** \brief Allocate constructor object with the layout and arguments of `Ctor` or `Reuse` instruction `i` */
+    object * alloc_ctor(code const & c, instr const & i) {
+        if (i.m_size == 0 && i.m_usize == 0 && i.m_ssize == 0) {
             // a constructor without data is optimized to a tagged pointer
-            return box(tag);
+            return box(i.m_num);
         } else {
-            object *o = alloc_cnstr(tag, size, usize * sizeof(void *) + ssize);
-            for (size_t i = 0; i < args.size(); i++) {
-                cnstr_set(o, i, eval_arg(args[i]).m_obj);
+            // `m_usize` is the number of unboxed USize fields (whose byte size the IR is ignorant of)
+            object *o = alloc_cnstr(i.m_num, i.m_size, i.m_usize * sizeof(void *) + i.m_ssize);
+            for (unsigned j = 0; j < i.m_num_args; j++) {
+                cnstr_set(o, j, eval_arg(c.m_args[i.m_args + j]).m_obj);
             }
             return o;
         }
@@ -421,133 +1088,13 @@ private:
         return cls;
     }
 
-    value eval_expr(expr const & e, type t) {
-        switch (expr_tag(e)) {
-            case expr_kind::Ctor:
-                return value { alloc_ctor(expr_ctor_info(e), expr_ctor_args(e)) };
-            case expr_kind::Reset: { // release fields if unique reference in preparation for `Reuse` below
-                object * o = var(expr_reset_obj(e)).m_obj;
-                if (is_exclusive(o)) {
-                    for (size_t i = 0; i < expr_reset_num_objs(e).get_small_value(); i++) {
-                        cnstr_release(o, i);
-                    }
-                    return o;
-                } else {
-                    dec_ref(o);
-                    return box(0);
-                }
-            }
-            case expr_kind::Reuse: { // reuse dead allocation if possible
-                object * o = var(expr_reuse_obj(e)).m_obj;
-                // check if `Reset` above had a unique reference it consumed
-                if (is_scalar(o)) {
-                    // fall back to regular allocation
-                    return alloc_ctor(expr_reuse_ctor(e), expr_reuse_args(e));
-                } else {
-                    // create new constructor object in-place
-                    if (expr_reuse_update_header(e)) {
-                        cnstr_set_tag(o, ctor_info_tag(expr_reuse_ctor(e)).get_small_value());
-                    }
-                    for (size_t i = 0; i < expr_reuse_args(e).size(); i++) {
-                        cnstr_set(o, i, eval_arg(expr_reuse_args(e)[i]).m_obj);
-                    }
-                    return o;
-                }
-            }
-            case expr_kind::Proj: // object field access
-                return cnstr_get(var(expr_proj_obj(e)).m_obj, expr_proj_idx(e).get_small_value());
-            case expr_kind::UProj: // USize field access
-                return cnstr_get_usize(var(expr_uproj_obj(e)).m_obj, expr_uproj_idx(e).get_small_value());
-            case expr_kind::SProj: { // other unboxed field access
-                size_t offset = expr_sproj_idx(e).get_small_value() * sizeof(void *) +
-                                expr_sproj_offset(e).get_small_value();
-                object * o = var(expr_sproj_obj(e)).m_obj;
-                switch (t) {
-                    case type::Float: return value::from_float(cnstr_get_float(o, offset));
-                    case type::UInt8: return cnstr_get_uint8(o, offset);
-                    case type::UInt16: return cnstr_get_uint16(o, offset);
-                    case type::UInt32: return cnstr_get_uint32(o, offset);
-                    case type::UInt64: return cnstr_get_uint64(o, offset);
-                    case type::USize:
-                    case type::Irrelevant:
-                    case type::Object:
-                    case type::TObject:
-                        break;
-                }
-                throw exception("invalid instruction");
-            }
-            case expr_kind::FAp: { // satured ("full") application of top-level function
-                if (expr_fap_args(e).size()) {
-                    return call(expr_fap_fun(e), expr_fap_args(e));
-                } else {
-                    // nullary function ("constant")
-                    return load(expr_fap_fun(e), t);
-                }
-            }
-            case expr_kind::PAp: { // unsatured (partial) application of top-level function
-                symbol_cache_entry sym = lookup_symbol(expr_pap_fun(e));
-                if (sym.m_addr) {
-                    // point closure directly at native symbol
-                    object * cls = alloc_closure(sym.m_addr, decl_params(sym.m_decl).size(), expr_pap_args(e).size());
-                    for (unsigned i = 0; i < expr_pap_args(e).size(); i++) {
-                        closure_set(cls, i, eval_arg(expr_pap_args(e)[i]).m_obj);
-                    }
-                    return cls;
-                } else {
-                    // point closure at interpreter stub
-                    object ** args = static_cast<object **>(LEAN_ALLOCA(expr_pap_args(e).size() * sizeof(object *))); // NOLINT
-                    for (size_t i = 0; i < expr_pap_args(e).size(); i++) {
-                        args[i] = eval_arg(expr_pap_args(e)[i]).m_obj;
-                    }
-                    return mk_stub_closure(sym.m_decl, expr_pap_args(e).size(), args);
-                }
-            }
-            case expr_kind::Ap: { // (saturated or unsatured) application of closure; mostly handled by runtime
-                object ** args = static_cast<object **>(LEAN_ALLOCA(expr_ap_args(e).size() * sizeof(object *))); // NOLINT
-                for (size_t i = 0; i < expr_ap_args(e).size(); i++) {
-                    args[i] = eval_arg(expr_ap_args(e)[i]).m_obj;
-                }
-                object * r = apply_n(var(expr_ap_fun(e)).m_obj, expr_ap_args(e).size(), args);
-                return r;
-            }
-            case expr_kind::Box: // box unboxed value
-                return box_t(var(expr_box_obj(e)).m_num, expr_box_type(e));
-            case expr_kind::Unbox: // unbox boxed value
-                return unbox_t(var(expr_unbox_obj(e)).m_obj, t);
-            case expr_kind::Lit: // load numeric or string literal
-                switch (lit_val_tag(expr_lit_val(e))) {
-                    case lit_val_kind::Num: {
-                        nat const & n = lit_val_num(expr_lit_val(e));
-                        switch (t) {
-                            case type::Float:
-                                lean_inc(n.raw());
-                                return value::from_float(lean_float_of_nat(n.raw()));
-                            case type::UInt8:
-                            case type::UInt16:
-                            case type::UInt32:
-                            case type::USize:
-                                return lean_usize_of_nat(n.raw());
-                            case type::UInt64:
-                                return lean_uint64_of_nat(n.raw());
-                            // `nat` literal
-                            case type::Object:
-                            case type::TObject:
-                                return n.to_obj_arg();
-                            case type::Irrelevant:
-                                break;
-                        }
-                        throw exception("invalid instruction");
-                    }
-                    case lit_val_kind::Str:
-                        return lit_val_str(expr_lit_val(e)).to_obj_arg();
-                }
-                break;
-            case expr_kind::IsShared:
-                return !is_exclusive(var(expr_is_shared_obj(e)).m_obj);
-            case expr_kind::IsTaggedPtr:
-                return !is_scalar(var(expr_is_tagged_ptr_obj(e)).m_obj);
+    /** \brief Return callee of `FAp` or `PAp` instruction. */
+    symbol_cache_entry & get_callee(instr & i) {
+        if (!i.m_fn) {
+            expr const & e = fn_body_vdecl_expr(*i.m_body);
+            i.m_fn = &lookup_symbol(i.m_op == op::PAp ? expr_pap_fun(e) : expr_fap_fun(e));
         }
-        throw exception(sstream() << "unexpected instruction kind " << static_cast<unsigned>(expr_tag(e)));
+        return *i.m_fn;
     }
 
     void check_system() {
@@ -558,186 +1105,320 @@ private:
             ss << ex.what() << "\n";
             ss << "interpreter stacktrace:\n";
             for (unsigned i = 0; i < m_call_stack.size(); i++) {
-                ss << "#" << (i + 1) << " " << m_call_stack[m_call_stack.size() - i - 1].m_fn << "\n";
+                ss << "#" << (i + 1) << " " << decl_fun_id(*m_call_stack[m_call_stack.size() - i - 1].m_decl) << "\n";
             }
             throw throwable(ss);
         }
     }
 
-    value eval_body(fn_body const & b0) {
+    /** \brief Interpret `c` in the current frame, see `push_frame`. */
+    value eval_body(code & c) {
         check_system();
 
-        // make reference reassignable...
-        std::reference_wrapper<fn_body const> b(b0);
+        /* Argument buffers of `TailCall`, `PAp` and `Ap`. They are reused across the iterations of the loop: with
+           `alloca`, the native stack would grow on every tail call of a long-running loop. */
+        buffer<value> args_buf;
+        buffer<object *> objs_buf;
+        // symbol cache entry of `c`, looked up on the first self tail call if `m_hot_threshold` is set
+        symbol_cache_entry * self = nullptr;
+        unsigned pc = c.m_entry;
         while (true) {
+            instr & i = c.m_instrs[pc];
             DEBUG_CODE(lean_trace(name({"interpreter", "step"}),
-                                  tout() << std::string(m_call_stack.size(), ' ') << format_fn_body_head(b) << "\n";);)
-            switch (fn_body_tag(b)) {
-                case fn_body_kind::VDecl: { // variable declaration
-                    expr const & e = fn_body_vdecl_expr(b);
-                    fn_body const & cont = fn_body_vdecl_cont(b);
-                    // tail recursion?
-                    if (expr_tag(e) == expr_kind::FAp && expr_fap_fun(e) == get_frame().m_fn &&
-                        fn_body_tag(cont) == fn_body_kind::Ret && !arg_is_irrelevant(fn_body_ret_arg(cont)) &&
-                        arg_var_id(fn_body_ret_arg(cont)) == fn_body_vdecl_var(b)) {
-                        // tail recursion! copy argument values to parameter slots and reset `b`
-                        array_ref<arg> const & args = expr_fap_args(e);
-                        // argument and parameter slots may overlap, so first copy arguments to end of stack
-                        size_t old_size = m_arg_stack.size();
-                        for (const auto & arg : args) {
-                            m_arg_stack.push_back(eval_arg(arg));
-                        }
-                        // now copy to parameter slots
-                        for (size_t i = 0; i < args.size(); i++) {
-                            m_arg_stack[get_frame().m_arg_bp + i] = m_arg_stack[old_size + i];
+                                  tout() << std::string(m_call_stack.size(), ' ') << format_fn_body_head(*i.m_body) << "\n";);)
+            value v;
+            switch (i.m_op) {
+                // variable declarations
+                case op::Ctor:
+                    v = alloc_ctor(c, i);
+                    break;
+                case op::Reset: { // release fields if unique reference in preparation for `Reuse` below
+                    object * o = var(i.m_src).m_obj;
+                    if (is_exclusive(o)) {
+                        for (unsigned j = 0; j < i.m_num; j++) {
+                            cnstr_release(o, j);
                         }
-                        m_arg_stack.resize(get_frame().m_arg_bp + args.size());
-                        b = b0;
-                        check_system();
-                        break;
+                        v = o;
+                    } else {
+                        dec_ref(o);
+                        v = box(0);
                     }
-                    value v = eval_expr(fn_body_vdecl_expr(b), fn_body_vdecl_type(b));
-                    // NOTE: `var` must be called *after* `eval_expr` because the stack may get resized and invalidate
-                    // the pointer
-                    var(fn_body_vdecl_var(b)) = v;
-                    DEBUG_CODE(lean_trace(name({"interpreter", "step"}),
-                                          tout() << std::string(m_call_stack.size(), ' ') << "=> x_";
-                                          tout() << fn_body_vdecl_var(b).get_small_value() << " = ";
-                                          print_value(tout(), var(fn_body_vdecl_var(b)), fn_body_vdecl_type(b));
-                                          tout() << "\n";);)
-                    b = fn_body_vdecl_cont(b);
                     break;
                 }
-                case fn_body_kind::JDecl: { // join-point declaration; store in stack slot just like variables
-                    size_t i = get_frame().m_jp_bp + fn_body_jdecl_id(b).get_small_value();
-                    if (i >= m_jp_stack.size()) {
-                        m_jp_stack.resize(i + 1);
+                case op::Reuse: { // reuse dead allocation if possible
+                    object * o = var(i.m_src).m_obj;
+                    // check if `Reset` above had a unique reference it consumed
+                    if (is_scalar(o)) {
+                        // fall back to regular allocation
+                        v = alloc_ctor(c, i);
+                    } else {
+                        // create new constructor object in-place
+                        if (i.m_flag) {
+                            cnstr_set_tag(o, i.m_num);
+                        }
+                        for (unsigned j = 0; j < i.m_num_args; j++) {
+                            cnstr_set(o, j, eval_arg(c.m_args[i.m_args + j]).m_obj);
+                        }
+                        v = o;
                     }
-                    m_jp_stack[i] = &b.get();
-                    b = fn_body_jdecl_cont(b);
                     break;
                 }
-                case fn_body_kind::Set: { // set boxed field of unique reference
-                    object * o = var(fn_body_set_var(b)).m_obj;
-                    lean_assert(is_exclusive(o));
-                    cnstr_set(o, fn_body_set_idx(b).get_small_value(), eval_arg(fn_body_set_arg(b)).m_obj);
-                    b = fn_body_set_cont(b);
+                case op::Proj: // object field access
+                    v = cnstr_get(var(i.m_src).m_obj, i.m_num);
                     break;
-                }
-                case fn_body_kind::SetTag: { // set constructor tag of unique reference
-                    object * o = var(fn_body_set_tag_var(b)).m_obj;
-                    lean_assert(is_exclusive(o));
-                    cnstr_set_tag(o, fn_body_set_tag_cidx(b).get_small_value());
-                    b = fn_body_set_tag_cont(b);
-                    break;
-                }
-                case fn_body_kind::USet: { // set USize field of unique reference
-                    object * o = var(fn_body_uset_target(b)).m_obj;
-                    lean_assert(is_exclusive(o));
-                    cnstr_set_usize(o, fn_body_uset_idx(b).get_small_value(), var(fn_body_uset_source(b)).m_num);
-                    b = fn_body_uset_cont(b);
+                case op::UProj: // USize field access
+                    v = cnstr_get_usize(var(i.m_src).m_obj, i.m_num);
                     break;
-                }
-                case fn_body_kind::SSet: { // set other unboxed field of unique reference
-                    object * o = var(fn_body_sset_target(b)).m_obj;
-                    size_t offset = fn_body_sset_idx(b).get_small_value() * sizeof(void *) +
-                                    fn_body_sset_offset(b).get_small_value();
-                    value v = var(fn_body_sset_source(b));
-                    lean_assert(is_exclusive(o));
-                    switch (fn_body_sset_type(b)) {
-                        case type::Float: cnstr_set_float(o, offset, v.m_float); break;
-                        case type::UInt8: cnstr_set_uint8(o, offset, v.m_num); break;
-                        case type::UInt16: cnstr_set_uint16(o, offset, v.m_num); break;
-                        case type::UInt32: cnstr_set_uint32(o, offset, v.m_num); break;
-                        case type::UInt64: cnstr_set_uint64(o, offset, v.m_num); break;
+                case op::SProj: { // other unboxed field access
+                    object * o = var(i.m_src).m_obj;
+                    switch (i.m_type) {
+                        case type::Float: v = value::from_float(cnstr_get_float(o, i.m_num)); break;
+                        case type::UInt8: v = cnstr_get_uint8(o, i.m_num); break;
+                        case type::UInt16: v = cnstr_get_uint16(o, i.m_num); break;
+                        case type::UInt32: v = cnstr_get_uint32(o, i.m_num); break;
+                        case type::UInt64: v = cnstr_get_uint64(o, i.m_num); break;
                         case type::USize:
                         case type::Irrelevant:
                         case type::Object:
                         case type::TObject:
-                            throw exception(sstream() << "invalid instruction");
+                            throw exception("invalid instruction");
                     }
-                    b = fn_body_sset_cont(b);
                     break;
                 }
-                case fn_body_kind::Inc: // increment reference counter
-                    inc(var(fn_body_inc_var(b)).m_obj, fn_body_inc_val(b).get_small_value());
-                    b = fn_body_inc_cont(b);
+                case op::FAp: // satured ("full") application of top-level function
+                    v = call(c, i);
+                    break;
+                case op::Const: // nullary function ("constant")
+                    v = load(expr_fap_fun(fn_body_vdecl_expr(*i.m_body)), i.m_type);
+                    break;
+                case op::TailCall: { // copy argument values to parameter slots and jump back to the entry
+                    // argument and parameter slots may overlap, so first copy arguments to a temporary buffer
+                    args_buf.clear();
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        args_buf.push_back(eval_arg(c.m_args[i.m_args + j]));
+                    }
+                    // now copy to parameter slots
+                    std::copy(args_buf.begin(), args_buf.end(), m_base);
+                    if (m_hot_threshold) {
+                        if (!self)
+                            self = &lookup_symbol(decl_fun_id(c.m_decl));
+                        if (is_hot(*self)) {
+                            // continue the running loop in native code and deliver its result
+                            return call_native(*self, m_base);
+                        }
+                    }
+                    pc = c.m_entry;
+                    check_system();
+                    continue;
+                }
+                case op::PAp: { // unsatured (partial) application of top-level function
+                    symbol_cache_entry & sym = get_callee(i);
+                    if (sym.m_addr) {
+                        // point closure directly at native symbol
+                        object * cls = alloc_closure(sym.m_addr, decl_params(sym.m_decl).size(), i.m_num_args);
+                        for (unsigned j = 0; j < i.m_num_args; j++) {
+                            closure_set(cls, j, eval_arg(c.m_args[i.m_args + j]).m_obj);
+                        }
+                        v = cls;
+                    } else {
+                        // point closure at interpreter stub
+                        objs_buf.resize(i.m_num_args);
+                        object ** args = objs_buf.data();
+                        for (unsigned j = 0; j < i.m_num_args; j++) {
+                            args[j] = eval_arg(c.m_args[i.m_args + j]).m_obj;
+                        }
+                        v = mk_stub_closure(sym.m_decl, i.m_num_args, args);
+                    }
                     break;
-                case fn_body_kind::Dec: { // decrement reference counter
-                    size_t n = fn_body_dec_val(b).get_small_value();
-                    for (size_t i = 0; i < n; i++) {
-                        dec(var(fn_body_dec_var(b)).m_obj);
+                }
+                case op::Ap: { // (saturated or unsatured) application of closure; mostly handled by runtime
+                    objs_buf.resize(i.m_num_args);
+                    object ** args = objs_buf.data();
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        args[j] = eval_arg(c.m_args[i.m_args + j]).m_obj;
                     }
-                    b = fn_body_dec_cont(b);
+                    v = apply_n(var(i.m_src).m_obj, i.m_num_args, args);
                     break;
                 }
-                case fn_body_kind::Del: // delete object of unique reference
-                    lean_free_object(var(fn_body_del_var(b)).m_obj);
-                    b = fn_body_del_cont(b);
+                case op::Box: // box unboxed value
+                    v = box_t(var(i.m_src), i.m_arg_type);
                     break;
-                case fn_body_kind::MData: // metadata; no-op
-                    b = fn_body_mdata_cont(b);
+                case op::Unbox: // unbox boxed value
+                    v = unbox_t(var(i.m_src).m_obj, i.m_type);
                     break;
-                case fn_body_kind::Case: { // branch according to constructor tag
-                    array_ref<alt_core> const & alts = fn_body_case_alts(b);
-                    unsigned tag;
-                    value v = var(fn_body_case_var(b));
-                    if (type_is_scalar(fn_body_case_var_type(b))) {
-                        tag = v.m_num;
-                    } else {
-                        tag = lean_obj_tag(v.m_obj);
+                case op::Lit: // load pre-decoded numeric or string literal
+                    if (i.m_flag) {
+                        lean_inc(i.m_lit.m_obj);
                     }
-                    for (alt_core const & a : alts) {
-                        switch (alt_core_tag(a)) {
-                            case alt_core_kind::Ctor:
-                                if (tag == ctor_info_tag(alt_core_ctor_info(a)).get_small_value()) {
-                                    b = alt_core_ctor_cont(a);
-                                    goto done;
-                                }
-                                break;
-                            case alt_core_kind::Default:
-                                b = alt_core_default_cont(a);
-                                goto done;
-                        }
+                    v = i.m_lit;
+                    break;
+                case op::IsShared:
+                    v = static_cast<uint64>(!is_exclusive(var(i.m_src).m_obj));
+                    break;
+                case op::IsTaggedPtr:
+                    v = static_cast<uint64>(!is_scalar(var(i.m_src).m_obj));
+                    break;
+                case op::Invalid:
+                    throw exception("invalid instruction");
+                // other statements
+                case op::Set: { // set boxed field of unique reference
+                    object * o = var(i.m_src).m_obj;
+                    lean_assert(is_exclusive(o));
+                    cnstr_set(o, i.m_num, eval_arg(i.m_val).m_obj);
+                    pc = i.m_next;
+                    continue;
+                }
+                case op::SetTag: { // set constructor tag of unique reference
+                    object * o = var(i.m_src).m_obj;
+                    lean_assert(is_exclusive(o));
+                    cnstr_set_tag(o, i.m_num);
+                    pc = i.m_next;
+                    continue;
+                }
+                case op::USet: { // set USize field of unique reference
+                    object * o = var(i.m_src).m_obj;
+                    lean_assert(is_exclusive(o));
+                    cnstr_set_usize(o, i.m_num, var(i.m_val).m_num);
+                    pc = i.m_next;
+                    continue;
+                }
+                case op::SSet: { // set other unboxed field of unique reference
+                    object * o = var(i.m_src).m_obj;
+                    value x = var(i.m_val);
+                    lean_assert(is_exclusive(o));
+                    switch (i.m_type) {
+                        case type::Float: cnstr_set_float(o, i.m_num, x.m_float); break;
+                        case type::UInt8: cnstr_set_uint8(o, i.m_num, x.m_num); break;
+                        case type::UInt16: cnstr_set_uint16(o, i.m_num, x.m_num); break;
+                        case type::UInt32: cnstr_set_uint32(o, i.m_num, x.m_num); break;
+                        case type::UInt64: cnstr_set_uint64(o, i.m_num, x.m_num); break;
+                        case type::USize:
+                        case type::Irrelevant:
+                        case type::Object:
+                        case type::TObject:
+                            throw exception(sstream() << "invalid instruction");
                     }
-                    throw exception("incomplete case");
-                    done: break;
+                    pc = i.m_next;
+                    continue;
                 }
-                case fn_body_kind::Ret:
-                    return eval_arg(fn_body_ret_arg(b));
-                case fn_body_kind::Jmp: { // jump to join-point
-                    fn_body const & jp = *m_jp_stack[get_frame().m_jp_bp + fn_body_jmp_jp(b).get_small_value()];
-                    lean_assert(fn_body_jdecl_params(jp).size() == fn_body_jmp_args(b).size());
-                    for (size_t i = 0; i < fn_body_jdecl_params(jp).size(); i++) {
-                        var(param_var(fn_body_jdecl_params(jp)[i])) = eval_arg(fn_body_jmp_args(b)[i]);
+                case op::Inc: // increment reference counter
+                    inc(var(i.m_src).m_obj, i.m_num);
+                    pc = i.m_next;
+                    continue;
+                case op::Dec: // decrement reference counter
+                    for (unsigned j = 0; j < i.m_num; j++) {
+                        dec(var(i.m_src).m_obj);
                     }
-                    b = fn_body_jdecl_body(jp);
-                    break;
+                    pc = i.m_next;
+                    continue;
+                case op::Del: // delete object of unique reference
+                    lean_free_object(var(i.m_src).m_obj);
+                    pc = i.m_next;
+                    continue;
+                case op::Case: { // branch according to constructor tag
+                    value x = var(i.m_src);
+                    unsigned tag = type_is_scalar(i.m_type) ? x.m_num : lean_obj_tag(x.m_obj);
+                    case_alt const * alt = c.m_alts.data() + i.m_args;
+                    case_alt const * end = alt + i.m_num_args;
+                    while (alt != end && !alt->m_default && alt->m_tag != tag) {
+                        alt++;
+                    }
+                    if (alt == end) {
+                        throw exception("incomplete case");
+                    }
+                    pc = alt->m_target;
+                    continue;
                 }
-                case fn_body_kind::Unreachable:
+                case op::Ret:
+                    return eval_arg(i.m_val);
+                case op::Jmp: // jump to join-point
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        var(c.m_args[i.m_num + j]) = eval_arg(c.m_args[i.m_args + j]);
+                    }
+                    pc = i.m_next;
+                    continue;
+                case op::Unreachable:
                     throw exception("unreachable code");
             }
+            var(i.m_dst) = v;
+            DEBUG_CODE(lean_trace(name({"interpreter", "step"}),
+                                  tout() << std::string(m_call_stack.size(), ' ') << "=> x_";
+                                  tout() << (i.m_dst + 1) << " = ";
+                                  print_value(tout(), var(i.m_dst), i.m_type);
+                                  tout() << "\n";);)
+            pc = i.m_next;
         }
     }
 
-    // specify argument base pointer explicitly because we've usually already pushed some function arguments
-    void push_frame(decl const & d, size_t arg_bp) {
+    unsigned get_profile_node(unsigned parent, decl const * d, bool native) {
+        auto it = m_profile_children.find(std::make_pair(parent, d));
+        if (it != m_profile_children.end())
+            return it->second;
+        unsigned idx = m_profile_nodes.size();
+        m_profile_nodes.push_back(profile_node { d, parent, native, 0, second_duration(0), second_duration(0), second_duration(0) });
+        m_profile_children.emplace(std::make_pair(parent, d), idx);
+        return idx;
+    }
+
+    /** \brief Add the call tree of this interpreter to the global profile. */
+    void report_profile() {
+        std::vector<std::string> labels(m_profile_nodes.size());
+        std::vector<std::string> stacks(m_profile_nodes.size());
+        lock_guard<mutex> lock(*g_interpreter_profile_mutex);
+        for (unsigned i = 1; i < m_profile_nodes.size(); i++) {
+            profile_node const & n = m_profile_nodes[i];
+            labels[i] = decl_fun_id(*n.m_decl).to_string();
+            if (n.m_native)
+                labels[i] += " [native]";
+            stacks[i] = n.m_parent == 0 ? labels[i] : stacks[n.m_parent] + ";" + labels[i];
+            interpreter_profile_entry & e = (*g_interpreter_profile_entries)[labels[i]];
+            e.m_calls += n.m_calls;
+            e.m_self  += n.m_self;
+            e.m_total += n.m_outer;
+            (*g_interpreter_profile_stacks)[stacks[i]] += n.m_self;
+        }
+    }
+
+    /** \brief Push frame for calling `d`. If `d` is interpreted, `base` are the slots allocated for it since taking `m`,
+        starting with its arguments. */
+    void push_frame(decl const & d, value * base, value_stack::mark const & m) {
         DEBUG_CODE({
             lean_trace(name({"interpreter", "call"}),
                        tout() << std::string(m_call_stack.size(), ' ')
                               << decl_fun_id(d);
-                       for (size_t i = arg_bp; i < m_arg_stack.size(); i++) {
-                           tout() << " "; print_value(tout(), m_arg_stack[i], param_type(decl_params(d)[i - arg_bp]));
+                       for (size_t i = 0; base && i < decl_params(d).size(); i++) {
+                           tout() << " "; print_value(tout(), base[i], param_type(decl_params(d)[i]));
                        }
                        tout() << "\n";);
         });
-        m_call_stack.emplace_back(decl_fun_id(d), arg_bp, m_jp_stack.size());
+        m_call_stack.push_back(frame { &d, base, m, 0, {}, second_duration(0) });
+        m_base = base;
+        if (m_profile) {
+            frame & f = get_frame();
+            unsigned parent = m_call_stack.size() > 1 ? m_call_stack[m_call_stack.size() - 2].m_prof_node : 0;
+            f.m_prof_node  = get_profile_node(parent, &d, base == nullptr);
+            f.m_prof_start = std::chrono::steady_clock::now();
+            m_profile_active[std::make_pair(base == nullptr, &d)]++;
+        }
+        m_max_depth = std::max(m_max_depth, m_call_stack.size());
     }
 
     void pop_frame(value DEBUG_CODE(r), type DEBUG_CODE(t)) {
-        m_arg_stack.resize(get_frame().m_arg_bp);
-        m_jp_stack.resize(get_frame().m_jp_bp);
+        if (m_profile) {
+            frame const & f = get_frame();
+            second_duration total = std::chrono::steady_clock::now() - f.m_prof_start;
+            profile_node & n = m_profile_nodes[f.m_prof_node];
+            n.m_calls++;
+            n.m_total += total;
+            n.m_self  += total - f.m_prof_children;
+            if (--m_profile_active[std::make_pair(f.m_base == nullptr, f.m_decl)] == 0)
+                n.m_outer += total;
+            if (m_call_stack.size() > 1)
+                m_call_stack[m_call_stack.size() - 2].m_prof_children += total;
+        }
+        m_stack.restore(get_frame().m_mark);
         m_call_stack.pop_back();
+        m_base = m_call_stack.empty() ? nullptr : get_frame().m_base;
         DEBUG_CODE({
             lean_trace(name({"interpreter", "call"}),
                        tout() << std::string(m_call_stack.size(), ' ')
@@ -748,28 +1429,100 @@ private:
     }
 
     /** \brief Return cached lookup result for given unmangled function name in the current binary. */
-    symbol_cache_entry lookup_symbol(name const & fn) {
-        if (symbol_cache_entry const * e = m_symbol_cache.find(fn)) {
-            return *e;
+    symbol_cache_entry & lookup_symbol(name const & fn) {
+        auto it = m_symbol_cache.find(fn);
+        if (it != m_symbol_cache.end()) {
+            return it->second;
         } else {
-            symbol_cache_entry e_new { get_decl(fn), nullptr, false };
-            if (m_prefer_native || decl_tag(e_new.m_decl) == decl_kind::Extern || has_init_attribute(m_env, fn)) {
-                string_ref mangled = name_mangle(fn, *g_mangle_prefix);
-                string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
-                // check for boxed version first
-                if (void *p_boxed = lookup_symbol_in_cur_exe(boxed_mangled.data())) {
-                    e_new.m_addr = p_boxed;
-                    e_new.m_boxed = true;
-                } else if (void *p = lookup_symbol_in_cur_exe(mangled.data())) {
-                    // if there is no boxed version, there are no unboxed parameters, so use default version
-                    e_new.m_addr = p;
-                }
+            shared_interpreter_cache::symbol_entry e;
+            if (!m_shared_scope || !g_shared_cache->find_symbol(m_shared_scope, fn, e)) {
+                e = lookup_symbol_core(fn);
+            }
+            symbol_cache_entry e_new { e.m_decl, nullptr, false, nullptr, 0 };
+            if (m_prefer_native || e.m_native_required) {
+                e_new.m_addr  = e.m_addr;
+                e_new.m_boxed = e.m_boxed;
+            }
+            return m_symbol_cache.emplace(fn, e_new).first->second;
+        }
+    }
+
+    /** \brief Look up declaration and native symbol of `fn`, and share the result with other interpreters if `fn` is
+        imported. When the symbol is not shared, we only look for it where `lookup_symbol` will use it. */
+    shared_interpreter_cache::symbol_entry lookup_symbol_core(name const & fn) {
+        shared_interpreter_cache::symbol_entry e { get_decl(fn), nullptr, false, false };
+        e.m_native_required = decl_tag(e.m_decl) == decl_kind::Extern || has_init_attribute(m_env, fn);
+        bool shared = m_shared_scope && lean_ir_is_imported_decl(m_env.raw(), fn.raw());
+        if (shared || m_prefer_native || e.m_native_required) {
+            e.m_addr = lookup_native_symbol(fn, e.m_boxed);
+        }
+        if (shared) {
+            g_shared_cache->insert_symbol(m_shared_scope, fn, e);
+        }
+        return e;
+    }
+
+    /** \brief Return address of native code for `fn` in the current binary and loaded libraries, or `nullptr`. */
+    static void * lookup_native_symbol(name const & fn, bool & boxed) {
+        string_ref mangled = name_mangle(fn, *g_mangle_prefix);
+        string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
+        // check for boxed version first
+        if (void *p_boxed = lookup_symbol_in_cur_exe(boxed_mangled.data())) {
+            boxed = true;
+            return p_boxed;
+        }
+        // if there is no boxed version, there are no unboxed parameters, so use default version
+        boxed = false;
+        return lookup_symbol_in_cur_exe(mangled.data());
+    }
+
+    /** \brief Switch a hot interpreted function to native code if that has become available since we looked it up,
+        e.g. by loading a shared library compiled from its module with `Lean.loadDynlib`. Native code is never
+        generated here: the interpreter runs on platforms without a C compiler or JIT. */
+    void tier_up(symbol_cache_entry & e) {
+        name const & fn = decl_fun_id(e.m_decl);
+        bool boxed;
+        if (void * addr = lookup_native_symbol(fn, boxed)) {
+            DEBUG_CODE(lean_trace(name({"interpreter", "tier_up"}), tout() << "switching '" << fn << "' to native code\n";);)
+            e.m_addr  = addr;
+            e.m_boxed = boxed;
+            if (m_shared_scope && lean_ir_is_imported_decl(m_env.raw(), fn.raw())) {
+                g_shared_cache->insert_symbol(m_shared_scope, fn, { e.m_decl, addr, boxed, has_init_attribute(m_env, fn) });
             }
-            m_symbol_cache.insert(fn, e_new);
-            return e_new;
         }
     }
 
+    /** \brief Count an interpreted call of `e`, and return true if `e` has native code, possibly after switching to it. */
+    bool is_hot(symbol_cache_entry & e) {
+        if (!e.m_addr && ++e.m_num_calls >= m_hot_threshold) {
+            // look again later if the native code has not been loaded yet
+            e.m_num_calls = 0;
+            tier_up(e);
+        }
+        return e.m_addr != nullptr;
+    }
+
+    /** \brief Return the pre-decoded body of `d`, translating it on first use. */
+    code & get_code(decl const & d) {
+        auto it = m_code_cache.find(decl_fun_id(d));
+        if (it != m_code_cache.end()) {
+            return *it->second;
+        }
+        std::unique_ptr<code> c(new code(d));
+        code_builder builder(*c);
+        builder();
+        code & r = *c;
+        m_code_cache.emplace(decl_fun_id(d), std::move(c));
+        return r;
+    }
+
+    code & get_code(symbol_cache_entry & e) {
+        if (!e.m_code) {
+            e.m_code = &get_code(e.m_decl);
+        }
+        return *e.m_code;
+    }
+
     /** \brief Retrieve Lean declaration from environment. */
     decl get_decl(name const & fn) {
         option_ref<decl> d = find_ir_decl(m_env, fn);
@@ -792,7 +1545,7 @@ private:
             return *o;
         }
 
-        symbol_cache_entry e = lookup_symbol(fn);
+        symbol_cache_entry & e = lookup_symbol(fn);
         if (e.m_addr) {
             // we can assume that all native code has been initialized (see e.g. `evalConst`)
 
@@ -807,18 +1560,33 @@ private:
                 case type::Object:
                 case type::TObject:
                 case type::Irrelevant:
-                    return *static_cast<object **>(e.m_addr);
+                    // closed terms compiled with `compiler.lazy_closed_terms` are null until first accessed by native
+                    // code, we evaluate them below in that case
+                    if (object * o = *static_cast<object **>(e.m_addr))
+                        return o;
+                    break;
             }
         }
 
-        // no native code, so might be part of the current module
+        // no native code or uninitialized, so might be part of the current module
         if (get_regular_init_fn_name_for(m_env, fn)) {
             // We don't know whether `[init]` decls can be re-executed, so let's not.
             throw exception(sstream() << "cannot evaluate `[init]` declaration '" << fn << "' in the same module");
         }
-        push_frame(e.m_decl, m_arg_stack.size());
-        value r = eval_body(decl_fun_body(e.m_decl));
-        pop_frame(r, decl_type(e.m_decl));
+        value r;
+        bool shared = m_shared_scope && lean_ir_is_imported_decl(m_env.raw(), fn.raw());
+        if (!shared || !g_shared_cache->find_constant(m_shared_scope, fn, r)) {
+            // the value is cached beyond the arenas of the current thread, see `IO.withArena`
+            scoped_no_arena no_arena;
+            code & c = get_code(e);
+            value_stack::mark m = m_stack.get_mark();
+            push_frame(c.m_decl, m_stack.alloc(c.m_num_slots), m);
+            r = eval_body(c);
+            pop_frame(r, decl_type(e.m_decl));
+            if (shared) {
+                g_shared_cache->insert_constant(m_shared_scope, fn, type_is_scalar(t), r);
+            }
+        }
         if (!type_is_scalar(t)) {
             inc(r.m_obj);
         }
@@ -826,61 +1594,97 @@ private:
         return r;
     }
 
-    value call(name const & fn, array_ref<arg> const & args) {
-        size_t old_size = m_arg_stack.size();
+    /** \brief Evaluate `FAp` instruction `i` of `c`. */
+    value call(code const & c, instr & i) {
+        unsigned const * args = c.m_args.data() + i.m_args;
+        unsigned num_args = i.m_num_args;
         value r;
-        symbol_cache_entry e = lookup_symbol(fn);
+        symbol_cache_entry & e = get_callee(i);
+        if (m_hot_threshold && decl_tag(e.m_decl) != decl_kind::Extern)
+            is_hot(e);
         if (e.m_addr) {
-            object ** args2 = static_cast<object **>(LEAN_ALLOCA(args.size() * sizeof(object *))); // NOLINT
-            for (size_t i = 0; i < args.size(); i++) {
-                type t = param_type(decl_params(e.m_decl)[i]);
-                args2[i] = box_t(eval_arg(args[i]), t);
-                if (e.m_boxed && param_borrow(decl_params(e.m_decl)[i])) {
-                    // NOTE: If we chose the boxed version where the IR chose the unboxed one, we need to manually increment
-                    // originally borrowed parameters because the wrapper will decrement these after the call.
-                    // Basically the wrapper is more homogeneous (removing both unboxed and borrowed parameters) than we
-                    // would need in this instance.
-                    inc(args2[i]);
-                }
-            }
-            push_frame(e.m_decl, old_size);
-            object * o = curry(e.m_addr, args.size(), args2);
-            type t = decl_type(e.m_decl);
-            if (type_is_scalar(t)) {
-                lean_assert(e.m_boxed);
-                // NOTE: this unboxing does not exist in the IR, so we should manually consume `o`
-                r = unbox_t(o, t);
-                lean_dec(o);
-            } else {
-                r = o;
+            value * vals = static_cast<value *>(LEAN_ALLOCA(num_args * sizeof(value))); // NOLINT
+            for (unsigned j = 0; j < num_args; j++) {
+                vals[j] = eval_arg(args[j]);
             }
+            push_frame(e.m_decl, nullptr, m_stack.get_mark());
+            r = call_native(e, vals);
         } else {
             if (decl_tag(e.m_decl) == decl_kind::Extern) {
+                name const & fn = decl_fun_id(e.m_decl);
                 string_ref mangled = name_mangle(fn, *g_mangle_prefix);
                 string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
                 throw exception(sstream() << "could not find native implementation of external declaration '" << fn
                                           << "' (symbols '" << boxed_mangled.data() << "' or '" << mangled.data() << "')");
             }
+            code & callee = get_code(e);
+            value_stack::mark m = m_stack.get_mark();
+            value * base = m_stack.alloc(callee.m_num_slots);
             // evaluate args in old stack frame
-            for (const auto & arg : args) {
-                m_arg_stack.push_back(eval_arg(arg));
+            for (unsigned j = 0; j < num_args; j++) {
+                base[j] = eval_arg(args[j]);
             }
-            push_frame(e.m_decl, old_size);
-            r = eval_body(decl_fun_body(e.m_decl));
+            push_frame(callee.m_decl, base, m);
+            r = eval_body(callee);
         }
         pop_frame(r, decl_type(e.m_decl));
         return r;
     }
 
+    /** \brief Call the native code of `e` with the arguments `args`, which are consumed like in an interpreted call. */
+    value call_native(symbol_cache_entry const & e, value const * args) {
+        unsigned num_args = decl_params(e.m_decl).size();
+        object ** args2 = static_cast<object **>(LEAN_ALLOCA(num_args * sizeof(object *))); // NOLINT
+        for (unsigned j = 0; j < num_args; j++) {
+            type t = param_type(decl_params(e.m_decl)[j]);
+            args2[j] = box_t(args[j], t);
+            if (e.m_boxed && param_borrow(decl_params(e.m_decl)[j])) {
+                // NOTE: If we chose the boxed version where the IR chose the unboxed one, we need to manually increment
+                // originally borrowed parameters because the wrapper will decrement these after the call.
+                // Basically the wrapper is more homogeneous (removing both unboxed and borrowed parameters) than we
+                // would need in this instance.
+                inc(args2[j]);
+            }
+        }
+        object * o = curry(e.m_addr, num_args, args2);
+        type t = decl_type(e.m_decl);
+        if (type_is_scalar(t)) {
+            lean_assert(e.m_boxed);
+            // NOTE: this unboxing does not exist in the IR, so we should manually consume `o`
+            value r = unbox_t(o, t);
+            lean_dec(o);
+            return r;
+        } else {
+            return o;
+        }
+    }
+
     // closure stub
     object * stub_m(object ** args) {
         decl d(args[2]);
-        size_t old_size = m_arg_stack.size();
+        if (m_hot_threshold) {
+            // the closure may have been created before native code for `d` was loaded
+            symbol_cache_entry & e = lookup_symbol(decl_fun_id(d));
+            if (is_hot(e)) {
+                size_t n = decl_params(d).size();
+                value * vals = static_cast<value *>(LEAN_ALLOCA(n * sizeof(value))); // NOLINT
+                for (size_t i = 0; i < n; i++) {
+                    vals[i] = args[3 + i];
+                }
+                push_frame(d, nullptr, m_stack.get_mark());
+                object * r = call_native(e, vals).m_obj;
+                pop_frame(r, type::TObject);
+                return r;
+            }
+        }
+        code & c = get_code(d);
+        value_stack::mark m = m_stack.get_mark();
+        value * base = m_stack.alloc(c.m_num_slots);
         for (size_t i = 0; i < decl_params(d).size(); i++) {
-            m_arg_stack.push_back(args[3 + i]);
+            base[i] = args[3 + i];
         }
-        push_frame(d, old_size);
-        object * r = eval_body(decl_fun_body(d)).m_obj;
+        push_frame(c.m_decl, base, m);
+        object * r = eval_body(c).m_obj;
         pop_frame(r, type::TObject);
         return r;
     }
@@ -937,9 +1741,20 @@ private:
 public:
     explicit interpreter(environment const & env, options const & opts) : m_env(env), m_opts(opts) {
         m_prefer_native = opts.get_bool(*g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE);
+        m_hot_threshold = m_prefer_native ? opts.get_unsigned(*g_interpreter_hot_threshold, LEAN_DEFAULT_INTERPRETER_HOT_THRESHOLD) : 0;
+        m_shared_scope  = env.get_imported_constants();
+        m_profile       = opts.get_bool(*g_interpreter_profile, LEAN_DEFAULT_INTERPRETER_PROFILE);
+        if (m_profile)
+            m_profile_nodes.push_back(profile_node { nullptr, 0, false, 0, second_duration(0), second_duration(0), second_duration(0) });
     }
 
     ~interpreter() {
+        g_interpreter_sessions++;
+        update_max(g_interpreter_max_depth, m_max_depth);
+        update_max(g_interpreter_max_slots, m_stack.get_max_in_use());
+        update_max(g_interpreter_max_segments, m_stack.get_num_segments());
+        if (m_profile)
+            report_profile();
         for_each(m_constant_cache, [](name const &, constant_cache_entry const & e) {
             if (!e.m_is_scalar) {
                 dec(e.m_val.m_obj);
@@ -1087,6 +1902,40 @@ extern "C" LEAN_EXPORT object * lean_run_mod_init(object * mod, object *) {
     }
 }
 
+void display_interpreter_stats(std::ostream & out) {
+    out << "interpreter statistics:\n";
+    out << "  sessions: " << g_interpreter_sessions.load() << "\n";
+    out << "  max call depth: " << g_interpreter_max_depth.load() << "\n";
+    out << "  max stack slots: " << g_interpreter_max_slots.load() << " in " << g_interpreter_max_segments.load()
+        << " segments\n";
+}
+
+void display_interpreter_profile(std::ostream & out) {
+    lock_guard<mutex> lock(*g_interpreter_profile_mutex);
+    if (g_interpreter_profile_entries->empty())
+        return;
+    std::vector<std::pair<std::string, interpreter_profile_entry>> entries(g_interpreter_profile_entries->begin(),
+                                                                          g_interpreter_profile_entries->end());
+    std::sort(entries.begin(), entries.end(), [](auto const & a, auto const & b) { return a.second.m_self > b.second.m_self; });
+    out << "interpreter profile (self time, total time, calls):\n";
+    for (size_t i = 0; i < entries.size() && i < 100; i++) {
+        interpreter_profile_entry const & e = entries[i].second;
+        out << "\t" << entries[i].first << " " << display_profiling_time{e.m_self} << " "
+            << display_profiling_time{e.m_total} << " " << e.m_calls << "\n";
+    }
+    if (char const * fn = std::getenv("LEAN_INTERPRETER_PROFILE_FILE")) {
+        std::ofstream stacks(fn);
+        if (stacks.fail()) {
+            out << "failed to create '" << fn << "'\n";
+            return;
+        }
+        for (auto const & p : *g_interpreter_profile_stacks) {
+            // flame graph tools expect integer sample counts; use microseconds
+            stacks << p.first << " " << static_cast<uint64>(p.second.count() * 1000000) << "\n";
+        }
+    }
+}
+
 extern "C" LEAN_EXPORT object * lean_run_init(object * env, object * opts, object * decl, object * init_decl, object *) {
     return interpreter::with_interpreter<object *>(TO_REF(environment, env), TO_REF(options, opts), TO_REF(name, decl), [&](interpreter & interp) {
         return interp.run_init(TO_REF(name, decl), TO_REF(name, init_decl));
@@ -1101,18 +1950,40 @@ void initialize_ir_interpreter() {
     mark_persistent(ir::g_boxed_suffix->raw());
     ir::g_boxed_mangled_suffix = new string_ref("___boxed");
     mark_persistent(ir::g_boxed_mangled_suffix->raw());
-    ir::g_interpreter_prefer_native = new name({"interpreter", "prefer_native"});
+    ir::g_interpreter_prefer_native = new option_key(name({"interpreter", "prefer_native"}));
+    ir::g_interpreter_hot_threshold = new option_key(name({"interpreter", "hot_threshold"}));
+    ir::g_interpreter_profile = new option_key(name({"interpreter", "profile"}));
+    ir::g_interpreter_profile_mutex = new mutex();
+    ir::g_interpreter_profile_entries = new std::unordered_map<std::string, ir::interpreter_profile_entry>();
+    ir::g_interpreter_profile_stacks = new std::unordered_map<std::string, second_duration>();
     ir::g_init_globals = new name_map<object *>();
-    register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
+    ir::g_shared_cache = new ir::shared_interpreter_cache();
+    ir::g_symbol_table = new ir::symbol_table();
+    register_memory_pressure_handler(ir::clear_shared_interpreter_cache);
+    register_bool_option(ir::g_interpreter_prefer_native->get_name(), LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
+    register_bool_option(ir::g_interpreter_profile->get_name(), LEAN_DEFAULT_INTERPRETER_PROFILE,
+                         "(interpreter) record time and calls of interpreted functions and of native functions called by them; "
+                         "the profile is displayed at exit and written in folded stacks format to the file named by "
+                         "LEAN_INTERPRETER_PROFILE_FILE if set");
+    register_unsigned_option(ir::g_interpreter_hot_threshold->get_name(), LEAN_DEFAULT_INTERPRETER_HOT_THRESHOLD,
+                             "(interpreter) number of interpreted calls or self tail calls of a function after which we check again whether native code for it has been loaded, and then switch running loops and existing closures of the function to it (0 to disable)");
     DEBUG_CODE({
         register_trace_class({"interpreter"});
         register_trace_class({"interpreter", "call"});
         register_trace_class({"interpreter", "step"});
+        register_trace_class({"interpreter", "tier_up"});
     });
 }
 
 void finalize_ir_interpreter() {
+    delete ir::g_symbol_table;
+    delete ir::g_shared_cache;
     delete ir::g_init_globals;
+    delete ir::g_interpreter_profile_stacks;
+    delete ir::g_interpreter_profile_entries;
+    delete ir::g_interpreter_profile_mutex;
+    delete ir::g_interpreter_profile;
+    delete ir::g_interpreter_hot_threshold;
     delete ir::g_interpreter_prefer_native;
     delete ir::g_boxed_mangled_suffix;
     delete ir::g_boxed_suffix;
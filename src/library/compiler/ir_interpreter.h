@@ -13,6 +13,11 @@ namespace ir {
 /** \brief Run `n` using the "boxed" ABI, i.e. with all-owned parameters. */
 object * run_boxed(environment const & env, options const & opts, name const & fn, unsigned n, object **args);
 uint32 run_main(environment const & env, options const & opts, int argv, char * argc[]);
+/** \brief Display call depth and stack size statistics of all interpreter sessions that have finished. */
+void display_interpreter_stats(std::ostream & out);
+/** \brief Display the profile recorded by interpreter sessions with `interpreter.profile` set that have finished,
+    and write it as folded stacks to the file named by `LEAN_INTERPRETER_PROFILE_FILE`. */
+void display_interpreter_profile(std::ostream & out);
 }
 void initialize_ir_interpreter();
 void finalize_ir_interpreter();
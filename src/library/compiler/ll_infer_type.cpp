@@ -9,11 +9,19 @@ Author: Leonardo de Moura
 #include "kernel/instantiate.h"
 #include "kernel/replace_fn.h"
 #include "kernel/inductive.h"
+#include "kernel/assoc_cache.h"
+#include "util/name_hash_map.h"
 #include "library/compiler/util.h"
 #include "library/compiler/extern_attribute.h"
 
 namespace lean {
 static expr * g_bot = nullptr;
+/* Every miss is a query to the type checker. */
+static cache_counters g_proj_type_counters("ll_infer_type projection");
+
+/* Types of the projections `S.i`, indexed by `S ++ i`. The types of all declarations of a compilation unit are
+   inferred repeatedly until they reach a fixpoint, and the field types of the structures they use do not change. */
+typedef name_hash_map<expr> proj_type_cache;
 
 /* Infer type of expressions in ENF or LLNF. */
 class ll_infer_type_fn {
@@ -21,6 +29,8 @@ class ll_infer_type_fn {
     local_ctx            m_lctx;
     buffer<name> const * m_new_decl_names{nullptr};
     buffer<expr> const * m_new_decl_types{nullptr};
+    proj_type_cache      m_local_proj_cache;
+    proj_type_cache &    m_proj_cache;
 
     environment const & env() const { return m_st.env(); }
     name_generator & ngen() { return m_st.ngen(); }
@@ -159,6 +169,22 @@ class ll_infer_type_fn {
     }
 
     expr infer_proj(expr const & e) {
+        name key(proj_sname(e), proj_idx(e).get_small_value());
+        auto it = m_proj_cache.find(key);
+        if (get_cache_stats_enabled()) {
+            if (it != m_proj_cache.end())
+                g_proj_type_counters.m_hits++;
+            else
+                g_proj_type_counters.m_misses++;
+        }
+        if (it != m_proj_cache.end())
+            return it->second;
+        expr r = infer_proj_core(e);
+        m_proj_cache.insert(mk_pair(key, r));
+        return r;
+    }
+
+    expr infer_proj_core(expr const & e) {
         name const & I_name   = proj_sname(e);
         inductive_val I_val   = env().get(I_name).to_inductive_val();
         lean_assert(I_val.get_ncnstrs() == 1);
@@ -227,20 +253,22 @@ class ll_infer_type_fn {
     }
 
 public:
-    ll_infer_type_fn(environment const & env, buffer<name> const & ns, buffer<expr> const & ts):
-        m_st(env), m_new_decl_names(&ns), m_new_decl_types(&ts) {}
+    ll_infer_type_fn(environment const & env, buffer<name> const & ns, buffer<expr> const & ts,
+                     proj_type_cache & proj_cache):
+        m_st(env), m_new_decl_names(&ns), m_new_decl_types(&ts), m_proj_cache(proj_cache) {}
     ll_infer_type_fn(environment const & env, local_ctx const & lctx):
-        m_st(env), m_lctx(lctx) {}
+        m_st(env), m_lctx(lctx), m_proj_cache(m_local_proj_cache) {}
     expr operator()(expr const & e) { return infer(e); }
 };
 
 void ll_infer_type(environment const & env, comp_decls const & ds, buffer<expr> & ts) {
     buffer<name> ns;
+    proj_type_cache proj_cache;
     ts.clear();
     /* Initialize `ts` */
     for (comp_decl const & d : ds) {
         /* For mutually recursive declarations `t` may contain `_bot`. */
-        expr t = ll_infer_type_fn(env, ns, ts)(d.snd());
+        expr t = ll_infer_type_fn(env, ns, ts, proj_cache)(d.snd());
         ns.push_back(d.fst());
         ts.push_back(t);
     }
@@ -249,7 +277,7 @@ void ll_infer_type(environment const & env, comp_decls const & ds, buffer<expr>
         bool modified = false;
         unsigned i = 0;
         for (comp_decl const & d : ds) {
-            expr t1 = ll_infer_type_fn(env, ns, ts)(d.snd());
+            expr t1 = ll_infer_type_fn(env, ns, ts, proj_cache)(d.snd());
             if (t1 != ts[i]) {
                 modified = true;
                 ts[i]    = t1;
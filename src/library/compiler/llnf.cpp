@@ -239,6 +239,10 @@ cnstr_info::cnstr_info(unsigned cidx, list<field_info> const & finfo):
             m_num_usizes++;
         else if (info.m_kind == field_info::Scalar)
             m_scalar_sz += info.m_size;
+        else if (info.m_kind == field_info::Struct)
+            for (field_info const & sub : info.m_fields)
+                if (sub.m_kind == field_info::Scalar)
+                    m_scalar_sz += sub.m_size;
     }
 }
 
@@ -254,6 +258,46 @@ unsigned get_llnf_arity(environment const & env, name const & n) {
     return *arity;
 }
 
+/* Maximal size of the scalars of a structure stored inline in the constructor objects containing it. */
+#define LEAN_MAX_FLAT_STRUCT_SIZE 16
+
+static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer<field_info> & result);
+
+/* Return the constructor of `type` if its values are stored inline in the constructor objects containing them.
+   This is the case for non-recursive structures tagged with `@[flat_struct]` without parameters whose relevant fields
+   are at least two scalars of at most `LEAN_MAX_FLAT_STRUCT_SIZE` bytes in total, e.g., `structure Point where (x y :
+   Float)`. Their values are only allocated when they are used as a whole, i.e., by projections and pattern matching.
+   The attribute is required because the layout is part of the ABI of the code compiled before, e.g., of `stage0`.
+   On success, `fields` contains the fields of the constructor. */
+static optional<name> is_flat_struct(type_checker::state & st, expr const & type, buffer<field_info> & fields) {
+    environment const & env = st.env();
+    fields.clear();
+    if (!is_constant(type) || is_runtime_builtin_type(const_name(type)) ||
+        !has_flat_struct_attribute(env, const_name(type)))
+        return optional<name>();
+    optional<constant_info> info = env.find(const_name(type));
+    if (!info || !info->is_inductive())
+        return optional<name>();
+    inductive_val I_val = info->to_inductive_val();
+    if (I_val.get_ncnstrs() != 1 || I_val.is_rec() || I_val.is_unsafe() || I_val.get_nparams() != 0 ||
+        I_val.get_nindices() != 0 || is_extern_constant(env, head(I_val.get_cnstrs())))
+        return optional<name>();
+    name K = head(I_val.get_cnstrs());
+    get_cnstr_info_core(st, K, fields);
+    unsigned num = 0, size = 0;
+    for (field_info const & f : fields) {
+        if (f.m_kind == field_info::Scalar) {
+            num++;
+            size += f.m_size;
+        } else if (f.m_kind != field_info::Irrelevant) {
+            return optional<name>();
+        }
+    }
+    if (num < 2 || size > LEAN_MAX_FLAT_STRUCT_SIZE)
+        return optional<name>();
+    return optional<name>(K);
+}
+
 static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer<field_info> & result) {
     environment const & env = st.env();
     constant_info info      = env.get(n);
@@ -266,6 +310,9 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
     buffer<expr> telescope;
     unsigned next_object     = 0;
     unsigned max_scalar_size = 0;
+    /* Scalars of `Struct` fields, their positions are fixed together with the other scalars. */
+    std::vector<std::vector<field_info>> struct_fields;
+    buffer<field_info> sub;
     to_telescope(env, lctx, st.ngen(), type, telescope);
     lean_assert(telescope.size() >= nparams);
     for (unsigned i = nparams; i < telescope.size(); i++) {
@@ -285,6 +332,13 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
                 if (!uint) throw exception("code generation failed, enumeration type is too big");
                 max_scalar_size = std::max(*sz, max_scalar_size);
                 result.push_back(field_info::mk_scalar(*sz, *uint));
+            } else if (optional<name> K = is_flat_struct(st, ftype, sub)) {
+                for (field_info const & f : sub)
+                    if (f.m_kind == field_info::Scalar)
+                        max_scalar_size = std::max(f.m_size, max_scalar_size);
+                result.push_back(field_info::mk_struct(*K, list<field_info>()));
+                struct_fields.emplace_back(sub.begin(), sub.end());
+                sub.clear();
             } else {
                 result.push_back(field_info::mk_object(next_object));
                 next_object++;
@@ -308,14 +362,31 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
     unsigned offset = 0;
     /* Fix regular scalar offsets and idxs */
     for (unsigned sz = max_scalar_size; sz > 0; sz--) {
+        unsigned struct_idx = 0;
         for (field_info & info : result) {
             if (info.m_kind == field_info::Scalar && info.m_size == sz) {
                 info.m_idx    = idx;
                 info.m_offset = offset;
                 offset += info.m_size;
+            } else if (info.m_kind == field_info::Struct) {
+                for (field_info & sub : struct_fields[struct_idx]) {
+                    if (sub.m_kind == field_info::Scalar && sub.m_size == sz) {
+                        sub.m_idx    = idx;
+                        sub.m_offset = offset;
+                        offset += sub.m_size;
+                    }
+                }
+                struct_idx++;
             }
         }
     }
+    unsigned struct_idx = 0;
+    for (field_info & info : result) {
+        if (info.m_kind == field_info::Struct) {
+            info.m_fields = to_list(struct_fields[struct_idx].begin(), struct_fields[struct_idx].end());
+            struct_idx++;
+        }
+    }
 }
 
 cnstr_info get_cnstr_info(type_checker::state & st, name const & n) {
@@ -524,6 +595,37 @@ class to_lambda_pure_fn {
         return mk_app(mk_llnf_uset(idx), major, v);
     }
 
+    /* Read the scalar `info` of the constructor object `major`. */
+    expr mk_scalar_proj(expr const & major, field_info const & info) {
+        if (info.is_float())
+            return mk_let_decl(info.get_type(), mk_fproj(major, info.m_idx, info.m_offset));
+        else
+            return mk_let_decl(info.get_type(), mk_sproj(major, info.m_size, info.m_idx, info.m_offset));
+    }
+
+    /* Write the scalar `info` of the constructor object `r`. */
+    expr mk_scalar_set(expr const & r, field_info const & info, expr const & v) {
+        if (info.is_float())
+            return mk_let_decl(mk_enf_object_type(), mk_fset(r, info.m_idx, info.m_offset, v));
+        else
+            return mk_let_decl(mk_enf_object_type(), mk_sset(r, info.m_size, info.m_idx, info.m_offset, v));
+    }
+
+    /* Allocate the value of the field `info` of kind `Struct` whose scalars are stored in `major`. */
+    expr mk_flat_struct_value(expr const & major, field_info const & info) {
+        lean_assert(info.m_kind == field_info::Struct);
+        cnstr_info k_info = get_cnstr_info(info.m_cnstr);
+        constructor_val k_val = env().get(info.m_cnstr).to_constructor_val();
+        expr r = mk_let_decl(mk_enf_object_type(), mk_llnf_cnstr(k_val.get_induct(), k_info.m_cidx, 0, k_info.m_scalar_sz));
+        list<field_info> fs = info.m_fields;
+        for (field_info const & k_field : k_info.m_field_info) {
+            if (k_field.m_kind == field_info::Scalar)
+                r = mk_scalar_set(r, k_field, mk_scalar_proj(major, head(fs)));
+            fs = tail(fs);
+        }
+        return r;
+    }
+
     expr visit_cases(expr const & e) {
         buffer<expr> args;
         expr const & fn = get_app_args(e, args);
@@ -586,11 +688,11 @@ class to_lambda_pure_fn {
                         fields.push_back(mk_let_decl(info.get_type(), mk_uproj(major, info.m_idx)));
                         break;
                     case field_info::Scalar:
-                        if (info.is_float()) {
-                            fields.push_back(mk_let_decl(info.get_type(), mk_fproj(major, info.m_idx, info.m_offset)));
-                        } else {
-                            fields.push_back(mk_let_decl(info.get_type(), mk_sproj(major, info.m_size, info.m_idx, info.m_offset)));
-                        }
+                        fields.push_back(mk_scalar_proj(major, info));
+                        break;
+                    case field_info::Struct:
+                        /* Remark: `mk_let` removes the allocation if the field is not used. */
+                        fields.push_back(mk_flat_struct_value(major, info));
                         break;
                     }
                     minor = binding_body(minor);
@@ -699,6 +801,21 @@ class to_lambda_pure_fn {
                 r = mk_let_decl(mk_enf_object_type(), mk_uset(r, info.m_idx, args[j]));
                 first = false;
                 break;
+            case field_info::Struct: {
+                if (first) {
+                    r = mk_let_decl(mk_enf_object_type(), r);
+                }
+                /* Copy the scalars of the structure value into `r`, they are stored at `info.m_fields`. */
+                cnstr_info s_info   = get_cnstr_info(info.m_cnstr);
+                list<field_info> fs = info.m_fields;
+                for (field_info const & s_field : s_info.m_field_info) {
+                    if (s_field.m_kind == field_info::Scalar)
+                        r = mk_scalar_set(r, head(fs), mk_scalar_proj(args[j], s_field));
+                    fs = tail(fs);
+                }
+                first = false;
+                break;
+            }
 
             default:
                 break;
@@ -738,6 +855,10 @@ class to_lambda_pure_fn {
                     }
                 }
                 break;
+            case field_info::Struct:
+                if (proj_idx(e) == i)
+                    return mk_flat_struct_value(visit(proj_expr(e)), info);
+                break;
             }
             i++;
         }
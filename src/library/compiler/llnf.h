@@ -53,12 +53,16 @@ unsigned get_llnf_arity(environment const & env, name const & c);
 struct field_info {
     /* Remark: the position of a scalar value in
        a constructor object is: `sizeof(void*)*m_idx + m_offset` */
-    enum kind { Irrelevant, Object, USize, Scalar };
+    enum kind { Irrelevant, Object, USize, Scalar, Struct };
     kind     m_kind;
     unsigned m_size;   // it is used only if `m_kind == Scalar`
     unsigned m_idx;
     unsigned m_offset; // it is used only if `m_kind == Scalar`
     expr     m_type;
+    /* `m_kind == Struct` is a field whose type is a small structure of scalars, see `is_flat_struct`.
+       Its scalars are stored inline in the constructor object, and `m_fields` contains their positions. */
+    name             m_cnstr;
+    list<field_info> m_fields;
     field_info():m_kind(Irrelevant), m_idx(0), m_type(mk_enf_neutral()) {}
     field_info(unsigned idx):m_kind(Object), m_idx(idx), m_type(mk_enf_object_type()) {}
     field_info(unsigned num, bool):m_kind(USize), m_idx(num), m_type(mk_constant(get_usize_name())) {}
@@ -70,6 +74,10 @@ struct field_info {
     static field_info mk_object(unsigned idx) { return field_info(idx); }
     static field_info mk_usize() { return field_info(0, true); }
     static field_info mk_scalar(unsigned sz, expr const & type) { return field_info(sz, 0, 0, type); }
+    static field_info mk_struct(name const & cnstr, list<field_info> const & fields) {
+        field_info r; r.m_kind = Struct; r.m_type = mk_enf_object_type(); r.m_cnstr = cnstr; r.m_fields = fields;
+        return r;
+    }
 };
 
 struct cnstr_info {
@@ -6,16 +6,26 @@ Author: Leonardo de Moura
 */
 #include <algorithm>
 #include "runtime/flet.h"
+#include "util/option_declarations.h"
 #include "kernel/instantiate.h"
 #include "kernel/for_each_fn.h"
+#include "kernel/find_fn.h"
 #include "kernel/abstract.h"
 #include "kernel/inductive.h"
 #include "library/class.h"
 #include "library/trace.h"
 #include "library/compiler/util.h"
 #include "library/compiler/csimp.h"
+#include "library/compiler/specialize.h"
 
 namespace lean {
+static option_key * g_specialize_budget   = nullptr;
+static option_key * g_specialize_max_size = nullptr;
+
+specialize_cfg::specialize_cfg(options const & opts):
+    m_budget(opts.get_unsigned(*g_specialize_budget, 0)),
+    m_max_size(opts.get_unsigned(*g_specialize_max_size, 0)) {}
+
 extern "C" uint8 lean_has_specialize_attribute(object* env, object* n);
 extern "C" uint8 lean_has_nospecialize_attribute(object* env, object* n);
 
@@ -266,6 +276,9 @@ static optional<name> get_cached_specialization(environment const & env, expr co
 class specialize_fn {
     type_checker::state m_st;
     csimp_cfg           m_cfg;
+    specialize_cfg      m_spec_cfg;
+    /* Estimated size of the specializations created for the current declaration, see `within_budget`. */
+    unsigned            m_budget_used{0};
     local_ctx           m_lctx;
     buffer<comp_decl>   m_new_decls;
     name                m_base_name;
@@ -1050,6 +1063,53 @@ class specialize_fn {
         return n;
     }
 
+    /* Return true if one of the declarations `ctx.m_mutual` uses one of them. */
+    bool is_recursive(expr const & fn, spec_ctx const & ctx) {
+        for (name const & n : ctx.m_mutual) {
+            optional<expr> code = get_code(mk_constant(n, const_levels(fn)));
+            if (code && ::lean::find(*code, [&](expr const & e, unsigned) {
+                        return is_constant(e) && ctx.in_mutual_decl(const_name(e));
+                    }))
+                return true;
+        }
+        return false;
+    }
+
+    /* The estimated size of specializing `fn`, i.e., the size of the code of the declarations copied. */
+    unsigned get_spec_size(expr const & fn, spec_ctx const & ctx) {
+        unsigned r = 0;
+        for (name const & n : ctx.m_mutual) {
+            if (optional<expr> code = get_code(mk_constant(n, const_levels(fn))))
+                r += get_lcnf_size(env(), *code);
+        }
+        return r;
+    }
+
+    /* Cost model for creating a new specialization of `fn`. Reusing a cached specialization is free.
+       - A function that is not recursive and is larger than `compiler.specialize_max_size` is not specialized:
+         its instance and higher-order arguments are used at most a few times per call, and the copy is large.
+         Specializing a recursive function removes the indirections from every iteration.
+       - The estimated sizes of the specializations created for a declaration, including the ones created for other
+         specializations, must not exceed `compiler.specialize_budget`. */
+    bool within_budget(expr const & fn, spec_ctx const & ctx) {
+        if (m_spec_cfg.m_budget == 0 && m_spec_cfg.m_max_size == 0)
+            return true;
+        unsigned size = get_spec_size(fn, ctx);
+        if (m_spec_cfg.m_max_size > 0 && size > m_spec_cfg.m_max_size && !is_recursive(fn, ctx)) {
+            lean_trace(name({"compiler", "spec_report"}),
+                       tout() << "skip " << const_name(fn) << " (size " << size << "): exceeds compiler.specialize_max_size\n";);
+            return false;
+        }
+        if (m_spec_cfg.m_budget > 0 && m_budget_used + size > m_spec_cfg.m_budget) {
+            lean_trace(name({"compiler", "spec_report"}),
+                       tout() << "skip " << const_name(fn) << " (size " << size << "): exceeds compiler.specialize_budget, "
+                       << m_budget_used << " used by " << m_base_name << "\n";);
+            return false;
+        }
+        m_budget_used += size;
+        return true;
+    }
+
     optional<expr> specialize(expr const & fn, buffer<expr> const & args, spec_ctx & ctx) {
         if (!is_specialize_candidate(fn, args))
             return none_expr();
@@ -1126,10 +1186,14 @@ class specialize_fn {
                            tout() << ">> key: " << trace_pp_expr(key) << "\n";);
                 // std::cerr << *it << " " << ctx.m_vars.size() << " " << ctx.m_params.size() << "\n";
                 new_fn_name = *it;
+                lean_trace(name({"compiler", "spec_report"}),
+                           tout() << "reuse " << *new_fn_name << " in " << m_base_name << "\n";);
             }
         }
         if (!new_fn_name) {
             /* Cache does not contain specialization result */
+            if (!within_budget(fn, ctx))
+                return none_expr();
             new_fn_name = spec_preprocess(fn, mask, ctx);
             if (!new_fn_name)
                 return none_expr();
@@ -1141,6 +1205,11 @@ class specialize_fn {
                     return none_expr();
                 }
             }
+            lean_trace(name({"compiler", "spec_report"}),
+                       unsigned size = 0;
+                       for (comp_decl const & new_decl : new_decls)
+                           size += get_lcnf_size(env(), new_decl.snd());
+                       tout() << "new " << *new_fn_name << " (size " << size << ")\n";);
             /* We should only re-specialize if the original function was marked with `[specialize]` attribute.
                Recall that we always specialize functions containing instance implicit arguments.
                This is a temporary workaround until we implement a proper code specializer.
@@ -1213,8 +1282,8 @@ class specialize_fn {
     }
 
 public:
-    specialize_fn(environment const & env, csimp_cfg const & cfg):
-        m_st(env), m_cfg(cfg), m_at("_at"), m_spec("_spec") {}
+    specialize_fn(environment const & env, csimp_cfg const & cfg, specialize_cfg const & spec_cfg):
+        m_st(env), m_cfg(cfg), m_spec_cfg(spec_cfg), m_at("_at"), m_spec("_spec") {}
 
     pair<environment, comp_decls> operator()(comp_decl const & d) {
         m_base_name = d.fst();
@@ -1225,11 +1294,13 @@ public:
     }
 };
 
-pair<environment, comp_decls> specialize_core(environment const & env, comp_decl const & d, csimp_cfg const & cfg) {
-    return specialize_fn(env, cfg)(d);
+pair<environment, comp_decls> specialize_core(environment const & env, comp_decl const & d, csimp_cfg const & cfg,
+                                              specialize_cfg const & spec_cfg) {
+    return specialize_fn(env, cfg, spec_cfg)(d);
 }
 
-pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg) {
+pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg,
+                                         specialize_cfg const & spec_cfg) {
     env = update_spec_info(env, ds);
     comp_decls r;
     for (comp_decl const & d : ds) {
@@ -1237,7 +1308,7 @@ pair<environment, comp_decls> specialize(environment env, comp_decls const & ds,
         if (has_specialize_attribute(env, d.fst())) {
             r = append(r, comp_decls(d));
         } else {
-            std::tie(env, new_ds) = specialize_core(env, d, cfg);
+            std::tie(env, new_ds) = specialize_core(env, d, cfg, spec_cfg);
             r = append(r, new_ds);
         }
     }
@@ -1247,8 +1318,19 @@ pair<environment, comp_decls> specialize(environment env, comp_decls const & ds,
 void initialize_specialize() {
     register_trace_class({"compiler", "spec_info"});
     register_trace_class({"compiler", "spec_candidate"});
+    register_trace_class({"compiler", "spec_report"});
+    g_specialize_budget = new option_key(name{"compiler", "specialize_budget"});
+    register_unsigned_option(g_specialize_budget->get_name(), 0,
+                             "(compiler) maximum estimated code size of the specializations created for a declaration, "
+                             "0 means no limit; see `trace.compiler.spec_report`");
+    g_specialize_max_size = new option_key(name{"compiler", "specialize_max_size"});
+    register_unsigned_option(g_specialize_max_size->get_name(), 0,
+                             "(compiler) do not specialize non-recursive functions whose code is larger than this size, "
+                             "0 means no limit");
 }
 
 void finalize_specialize() {
+    delete g_specialize_budget;
+    delete g_specialize_max_size;
 }
 }
@@ -9,7 +9,16 @@ Author: Leonardo de Moura
 #include "library/compiler/util.h"
 #include "library/compiler/csimp.h"
 namespace lean {
-pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg);
+/* Limits on the code created by `specialize`, see the options `compiler.specialize_budget` and
+   `compiler.specialize_max_size`. `0` means no limit. */
+struct specialize_cfg {
+    unsigned m_budget;
+    unsigned m_max_size;
+    specialize_cfg(options const & opts);
+};
+
+pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg,
+                                         specialize_cfg const & spec_cfg);
 void initialize_specialize();
 void finalize_specialize();
 }
@@ -102,6 +102,9 @@ bool has_noinline_attribute(environment const & env, name const & n) { return le
 extern "C" uint8 lean_has_never_extract_attribute(object* env, object *n);
 bool has_never_extract_attribute(environment const & env, name const & n) { return lean_has_never_extract_attribute(env.to_obj_arg(), n.to_obj_arg()); }
 
+extern "C" uint8 lean_has_flat_struct_attribute(object* env, object *n);
+bool has_flat_struct_attribute(environment const & env, name const & n) { return lean_has_flat_struct_attribute(env.to_obj_arg(), n.to_obj_arg()); }
+
 bool is_lcnf_atom(expr const & e) {
     switch (e.kind()) {
     case expr_kind::FVar: case expr_kind::Const: case expr_kind::Lit:
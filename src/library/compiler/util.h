@@ -39,6 +39,7 @@ bool has_inline_attribute(environment const & env, name const & n);
 bool has_noinline_attribute(environment const & env, name const & n);
 bool has_inline_if_reduce_attribute(environment const & env, name const & n);
 bool has_never_extract_attribute(environment const & env, name const & n);
+bool has_flat_struct_attribute(environment const & env, name const & n);
 
 expr unfold_macro_defs(environment const & env, expr const & e);
 
@@ -11,6 +11,8 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <limits>
 #include <sys/stat.h>
 #include "runtime/thread.h"
 #include "runtime/interrupt.h"
@@ -18,6 +20,7 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 #include "runtime/hash.h"
 #include "runtime/io.h"
 #include "runtime/compact.h"
+#include "runtime/compress.h"
 #include "runtime/buffer.h"
 #include "util/io.h"
 #include "util/name_map.h"
@@ -30,6 +33,7 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 #include <windows.h>
 #else
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
@@ -43,6 +47,201 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 namespace lean {
 // manually padded to multiple of word size, see `initialize_module`
 static char const * g_olean_header   = "oleanfile!!!!!!!";
+// Version 2 of the format appends a trailer after the compacted region:
+// the chunk offsets computed by `object_compactor::chunk_offsets` followed by their number.
+// Both headers must have the same length.
+static char const * g_olean_header_v2 = "oleanfile!!!!!v2";
+// Version 3 stores the compacted region compressed, split into independently decompressible frames at the chunk offsets:
+// the uncompressed size and the number of frames, an index of (uncompressed offset, compressed size) pairs, and the frames.
+// It is written when `LEAN_OLEAN_COMPRESS` is set to a nonzero value, and is never memory-mapped.
+static char const * g_olean_header_v3 = "oleanfile!!!!!v3";
+// Version 2 and 3 files compacted against a dictionary have a `d` at this position of the header and store the
+// identifier of the dictionary after the base address.
+static unsigned const g_olean_header_dict_pos = 13;
+static char const * g_olean_dict_header = "oleandict!!!!!v1";
+
+static bool get_olean_compress() {
+    char const * v = std::getenv("LEAN_OLEAN_COMPRESS");
+    return v && atoi(v) != 0;
+}
+
+/* \brief Number of threads used for compacting module data, set using `LEAN_COMPACTOR_THREADS`.
+   Parallel compaction is opt-in since it duplicates objects shared between declarations of different partitions. */
+static unsigned get_compactor_threads() {
+    char const * v = std::getenv("LEAN_COMPACTOR_THREADS");
+    return v ? std::max(atoi(v), 1) : 1;
+}
+
+// Base addresses of newly written modules are drawn from the range `[g_olean_base_begin, g_olean_base_begin + g_olean_base_size)`.
+// When reading modules, we reserve this range up front so that no other mapping (heap, shared libraries, thread stacks)
+// can end up at a module's base address, which would force us to copy the module instead of mapping it.
+// The range lies well below the default `mmap` area and PIE load addresses on x86-64 Linux, and above the
+// AddressSanitizer shadow memory.
+static size_t const g_olean_base_begin = 1ull << 45;
+static size_t const g_olean_base_size  = 1ull << 45;
+// `mmap` addresses must be page-aligned. The default (non-huge) page size on x86-64 is 4KB.
+// `MapViewOfFileEx` addresses must be aligned to the "memory allocation granularity", which is 64KB.
+static size_t const g_olean_base_align = 1ull << 16;
+// The beginning of the range is used for the dictionary of shared objects, see `lean_save_olean_dictionary`.
+static size_t const g_olean_dict_size  = 1ull << 40;
+
+// The reservation needs a user address space of at least 47 bits. This is only guaranteed on x86-64 Linux: aarch64
+// kernels may be configured with 39 or 42 bits of virtual addresses, and macOS uses the range for other mappings. On
+// other platforms, and whenever the range cannot be reserved, modules are mapped at their base address without
+// `MAP_FIXED` as before.
+#if defined(__linux__) && defined(__x86_64__)
+#define LEAN_OLEAN_RESERVATION
+/* \brief Address range reserved (as inaccessible memory) for mapping modules at their base addresses.
+   Ranges used by mapped modules are tracked so that modules with overlapping base addresses are copied instead. */
+class olean_reservation {
+    char *                   m_begin = nullptr;
+    size_t                   m_size  = 0;
+    mutex                    m_mutex;
+    std::map<char *, size_t> m_used;
+
+    static size_t align(size_t sz) { return (sz + g_olean_base_align - 1) & ~(g_olean_base_align - 1); }
+public:
+    olean_reservation() {
+        if (char const * v = std::getenv("LEAN_OLEAN_RESERVE")) {
+            if (atoi(v) == 0)
+                return;
+        }
+        void * hint = reinterpret_cast<void *>(g_olean_base_begin);
+        void * r = mmap(hint, g_olean_base_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (r == MAP_FAILED)
+            return;
+        if (r != hint) {
+            // part of the range is already in use, give up on the reservation
+            munmap(r, g_olean_base_size);
+            return;
+        }
+        m_begin = static_cast<char *>(r);
+        m_size  = g_olean_base_size;
+    }
+
+    /* \brief Try to map `size` bytes of `fd` at `addr` inside the reserved range.
+       Return `MAP_FAILED` if `addr` is outside the range, conflicts with another module, or `mmap` fails. */
+    void * map(char * addr, size_t size, int fd) {
+        size_t sz = align(size);
+        if (m_begin == nullptr || addr < m_begin || sz > m_size || addr > m_begin + (m_size - sz))
+            return MAP_FAILED;
+        unique_lock<mutex> lock(m_mutex);
+        auto it = m_used.lower_bound(addr);
+        if (it != m_used.end() && it->first < addr + sz)
+            return MAP_FAILED;
+        if (it != m_used.begin() && std::prev(it)->first + std::prev(it)->second > addr)
+            return MAP_FAILED;
+        // `MAP_FIXED` is safe here since we own the (so far unused) memory in this range
+        void * r = mmap(addr, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (r == MAP_FAILED)
+            return MAP_FAILED;
+        m_used.insert(std::make_pair(addr, sz));
+        return r;
+    }
+
+    /* \brief Return memory mapped using `map` to the reservation. */
+    void unmap(char * addr) {
+        unique_lock<mutex> lock(m_mutex);
+        auto it = m_used.find(addr);
+        lean_always_assert(it != m_used.end());
+        void * r = mmap(addr, it->second, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        lean_always_assert(r == addr);
+        m_used.erase(it);
+    }
+};
+
+static olean_reservation & get_olean_reservation() {
+    // initialized on first use, i.e. only in processes that actually import modules
+    static olean_reservation * g_reservation = new olean_reservation();
+    return *g_reservation;
+}
+#endif
+
+/* \brief Dictionary of objects shared between modules, see `lean_save_olean_dictionary`. It is mapped at its base
+   address for the rest of the process. */
+class olean_dictionary {
+    uint64                             m_id;
+    std::unique_ptr<object_dictionary> m_dict;
+public:
+    explicit olean_dictionary(std::string const & fn) {
+        std::ifstream in(fn, std::ios_base::binary);
+        if (in.fail())
+            throw exception(sstream() << "failed to open dictionary file '" << fn << "'");
+        in.seekg(0, in.end);
+        size_t size = in.tellg();
+        in.seekg(0);
+        size_t header_size = strlen(g_olean_dict_header);
+        std::string header(header_size, ' ');
+        char * base_addr;
+        in.read(&header[0], header_size);
+        in.read(reinterpret_cast<char *>(&base_addr), sizeof(base_addr));
+        in.read(reinterpret_cast<char *>(&m_id), sizeof(m_id));
+        header_size += sizeof(base_addr) + sizeof(m_id);
+        if (!in || size < header_size || header != g_olean_dict_header)
+            throw exception(sstream() << "failed to read dictionary file '" << fn << "', invalid header");
+        in.close();
+#ifdef LEAN_WINDOWS
+        throw exception(sstream() << "failed to map dictionary file '" << fn << "', dictionaries are not supported on this platform");
+#else
+        int fd = open(fn.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw exception(sstream() << "failed to open dictionary file '" << fn << "': " << strerror(errno));
+        char * buffer = static_cast<char *>(MAP_FAILED);
+#ifdef LEAN_OLEAN_RESERVATION
+        buffer = static_cast<char *>(get_olean_reservation().map(base_addr, size, fd));
+        if (buffer == MAP_FAILED)
+#endif
+        buffer = static_cast<char *>(mmap(base_addr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+        close(fd);
+        // objects in the dictionary are referenced by their addresses, so it cannot be relocated
+        if (buffer != base_addr)
+            throw exception(sstream() << "failed to map dictionary file '" << fn << "' at its base address");
+        m_dict.reset(new object_dictionary(buffer + header_size, size - header_size));
+#endif
+    }
+    uint64 id() const { return m_id; }
+    object_dictionary const * get() const { return m_dict.get(); }
+};
+
+/* \brief Return the dictionary set using `LEAN_OLEAN_DICT`, if any. */
+static olean_dictionary const * get_olean_dictionary() {
+    static char const * fn = std::getenv("LEAN_OLEAN_DICT");
+    if (!fn)
+        return nullptr;
+    // if loading fails, the exception is reported and loading is attempted again on the next call
+    static olean_dictionary * g_dict = new olean_dictionary(fn);
+    return g_dict;
+}
+
+static bool get_olean_keep_unchanged() {
+    char const * v = std::getenv("LEAN_OLEAN_KEEP_UNCHANGED");
+    return v && atoi(v) != 0;
+}
+
+/* \brief Return `true` if the file `fn` exists and consists of exactly the given pieces. */
+static bool file_has_contents(std::string const & fn, std::vector<std::pair<char const *, size_t>> const & pieces) {
+    std::ifstream in(fn, std::ios_base::binary);
+    if (in.fail())
+        return false;
+    in.seekg(0, in.end);
+    size_t size = in.tellg();
+    in.seekg(0);
+    size_t expected = 0;
+    for (auto const & piece : pieces)
+        expected += piece.second;
+    if (!in || size != expected)
+        return false;
+    std::vector<char> buffer(1 << 20);
+    for (auto const & piece : pieces) {
+        for (size_t i = 0; i < piece.second; i += buffer.size()) {
+            size_t n = std::min(buffer.size(), piece.second - i);
+            in.read(buffer.data(), n);
+            if (!in || memcmp(buffer.data(), piece.first + i, n) != 0)
+                return false;
+        }
+    }
+    return true;
+}
 
 extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg mod, b_obj_arg mdata, object *) {
     std::string olean_fn(string_cstr(fname));
@@ -50,10 +249,11 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
     // so that we neither expose partially-written files nor modify possibly memory-mapped files
     std::string olean_tmp_fn = olean_fn + ".tmp";
     try {
-        std::ofstream out(olean_tmp_fn, std::ios_base::binary);
-        if (out.fail()) {
-            return io_result_mk_error((sstream() << "failed to create file '" << olean_fn << "'").str());
-        }
+        // the pieces of the file, they are only written (or compared to the existing file) at the end
+        std::vector<std::pair<char const *, size_t>> pieces;
+        auto write = [&](void const * data, size_t sz) {
+            pieces.push_back(std::make_pair(static_cast<char const *>(data), sz));
+        };
 
         // Derive a base address that is uniformly distributed by deterministic, and should most likely
         // work for `mmap` on all interesting platforms
@@ -62,21 +262,84 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
 
         // Let's start with a hash of the module name. Note that while our string hash is a dubious 32-bit
         // algorithm, the mixing of multiple `Name` parts seems to result in a nicely distributed 64-bit
-        // output
-        size_t base_addr = name(mod, true).hash();
-        // x86-64 user space is currently limited to the lower 47 bits
-        // https://en.wikipedia.org/wiki/X86-64#Virtual_address_space_details
-        base_addr = base_addr & ((1LL<<47) - 1);
-        // `mmap` addresses must be page-aligned. The default (non-huge) page size on x86-64 is 4KB.
-        // `MapViewOfFileEx` addresses must be aligned to the "memory allocation granularity", which is 64KB.
-        base_addr = base_addr & ~((1LL<<16) - 1);
-
-        object_compactor compactor(reinterpret_cast<void *>(base_addr + strlen(g_olean_header) + sizeof(base_addr)));
-        compactor(mdata);
-        out.write(g_olean_header, strlen(g_olean_header));
-        out.write(reinterpret_cast<char *>(&base_addr), sizeof(base_addr));
-        out.write(static_cast<char const *>(compactor.data()), compactor.size());
+        // output. We map it into the range reserved for modules when reading them, see `olean_reservation`.
+        size_t base_addr = g_olean_base_begin + g_olean_dict_size + name(mod, true).hash() % (g_olean_base_size - g_olean_dict_size);
+        base_addr = base_addr & ~(g_olean_base_align - 1);
+
+        olean_dictionary const * dict = get_olean_dictionary();
+        bool compress = get_olean_compress();
+        std::string header(compress ? g_olean_header_v3 : g_olean_header_v2);
+        size_t header_size = header.size() + sizeof(base_addr);
+        if (dict) {
+            header[g_olean_header_dict_pos] = 'd';
+            header_size += sizeof(uint64);
+        }
+        object_compactor compactor(reinterpret_cast<void *>(base_addr + header_size));
+        if (dict)
+            compactor.set_dictionary(dict->get());
+        unsigned num_threads = get_compactor_threads();
+        if (num_threads > 1) {
+            // compact contiguous ranges of `ModuleData.constants`, which hold most of the data, in parallel
+            object * constants = cnstr_get(mdata, 1);
+            size_t num_consts  = array_size(constants);
+            std::vector<std::vector<object *>> partitions(num_threads);
+            for (size_t i = 0; i < num_consts; i++)
+                partitions[i * num_threads / num_consts].push_back(array_get(constants, i));
+            compactor(mdata, partitions);
+        } else {
+            compactor(mdata);
+        }
+        std::vector<uint64> chunk_offsets;
+        for (size_t offset : compactor.chunk_offsets())
+            chunk_offsets.push_back(offset);
+        // buffers referenced by `pieces`
+        uint64 dict_id = dict ? dict->id() : 0;
+        uint64 num_chunk_offsets = chunk_offsets.size();
+        std::vector<uint64> index;
+        std::vector<std::vector<char>> frames;
+        write(header.data(), header.size());
+        write(&base_addr, sizeof(base_addr));
+        if (dict)
+            write(&dict_id, sizeof(dict_id));
+        if (compress) {
+            std::vector<uint64> bounds;
+            bounds.push_back(0);
+            bounds.insert(bounds.end(), chunk_offsets.begin(), chunk_offsets.end());
+            bounds.push_back(compactor.size());
+            unsigned num_frames = bounds.size() - 1;
+            frames.resize(num_frames);
+            char const * data = static_cast<char const *>(compactor.data());
+            parallel_for(num_frames, hardware_concurrency(), [&](size_t, size_t i) {
+                lz_compress(data + bounds[i], bounds[i+1] - bounds[i], frames[i]);
+            });
+            index.push_back(compactor.size());
+            index.push_back(num_frames);
+            for (unsigned i = 0; i < num_frames; i++) {
+                index.push_back(bounds[i]);
+                index.push_back(frames[i].size());
+            }
+            write(reinterpret_cast<char *>(index.data()), sizeof(uint64) * index.size());
+            for (auto const & frame : frames)
+                write(frame.data(), frame.size());
+        } else {
+            write(static_cast<char const *>(compactor.data()), compactor.size());
+            write(reinterpret_cast<char *>(chunk_offsets.data()), sizeof(uint64) * num_chunk_offsets);
+            write(reinterpret_cast<char *>(&num_chunk_offsets), sizeof(num_chunk_offsets));
+        }
+        if (get_olean_keep_unchanged() && file_has_contents(olean_fn, pieces)) {
+            // keep the existing file (and its modification time)
+            return io_result_mk_ok(box(0));
+        }
+        std::ofstream out(olean_tmp_fn, std::ios_base::binary);
+        if (out.fail()) {
+            return io_result_mk_error((sstream() << "failed to create file '" << olean_fn << "'").str());
+        }
+        for (auto const & piece : pieces)
+            out.write(piece.first, piece.second);
         out.close();
+        if (!out) {
+            return io_result_mk_error((sstream() << "failed to write '" << olean_tmp_fn << "'").str());
+        }
         while (std::rename(olean_tmp_fn.c_str(), olean_fn.c_str()) != 0) {
 #ifdef LEAN_WINDOWS
             if (errno == EEXIST) {
@@ -103,6 +366,150 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
     }
 }
 
+/* \brief Add the declaration-name index `ModuleData.constNames` to module data written by older versions. */
+static object * upgrade_module_data(object * mod) {
+    unsigned const num_fields = 5;
+    if (lean_ctor_num_objs(mod) >= num_fields)
+        return mod;
+    object * r = alloc_cnstr(0, num_fields, 0);
+    for (unsigned i = 0; i < num_fields - 1; i++) {
+        inc(cnstr_get(mod, i));
+        cnstr_set(r, i, cnstr_get(mod, i));
+    }
+    object * constants = cnstr_get(mod, 1);
+    object * names     = array_mk_empty();
+    for (size_t i = 0; i < array_size(constants); i++) {
+        constant_info info(array_get(constants, i), true);
+        names = lean_array_push(names, info.get_name().to_obj_arg());
+    }
+    cnstr_set(r, num_fields - 1, names);
+    return r;
+}
+
+static object * mk_module_region(size_t data_size, char * buffer, char * base_addr, bool is_mmap, std::function<void()> const & free_data,
+                                 std::vector<size_t> const & chunk_offsets) {
+    compacted_region * region = new compacted_region(data_size, buffer, base_addr, is_mmap, free_data, chunk_offsets);
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+    // do not report as leak
+    __lsan_ignore_object(region);
+#endif
+#endif
+    object * mod = upgrade_module_data(region->read());
+    object * mod_region = alloc_cnstr(0, 2, 0);
+    cnstr_set(mod_region, 0, mod);
+    cnstr_set(mod_region, 1, box_size_t(reinterpret_cast<size_t>(region)));
+    return io_result_mk_ok(mod_region);
+}
+
+#ifndef LEAN_WINDOWS
+/* \brief Whether to give the kernel page hints for memory-mapped `.olean` files, enabled by `LEAN_OLEAN_MADVISE=1`. */
+static bool get_olean_madvise() {
+    char const * v = std::getenv("LEAN_OLEAN_MADVISE");
+    return v && atoi(v) != 0;
+}
+
+/* \brief Whether to lock memory-mapped `.olean` files into memory, see `LEAN_OLEAN_MLOCK`. */
+static bool get_olean_mlock() {
+    char const * v = std::getenv("LEAN_OLEAN_MLOCK");
+    return v && atoi(v) != 0;
+}
+
+/* \brief Give the kernel page hints for the memory-mapped `.olean` file at `[buffer, buffer + size)`, and return
+   whether it was locked into memory.
+
+   `importModules` touches objects all over the module data, e.g. the names of all constants to build the constant map
+   and all extension entries, so the whole file is requested up front using `MADV_WILLNEED` if `LEAN_OLEAN_MADVISE` is
+   set. The ranges are computed from the file size only: walking the objects to find the pages they are on would
+   already fault them in. With `LEAN_OLEAN_MLOCK`, the file is also locked into memory until the region is freed. */
+static bool advise_module_region(char * buffer, size_t size) {
+    if (get_olean_madvise())
+        madvise(buffer, size, MADV_WILLNEED);
+    // failures, e.g. because of `RLIMIT_MEMLOCK`, are ignored, the pages are only less likely to stay in memory
+    return get_olean_mlock() && mlock(buffer, size) == 0;
+}
+#endif
+
+/* getMajorPageFaults : BaseIO Nat */
+extern "C" LEAN_EXPORT object * lean_get_major_page_faults(object *) {
+#ifdef LEAN_WINDOWS
+    return io_result_mk_ok(box(0));
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return io_result_mk_ok(mk_nat_obj(static_cast<size_t>(usage.ru_majflt)));
+#endif
+}
+
+/* \brief Read the rest of a version 3 (compressed) `.olean` file, see `g_olean_header_v3`. */
+static object * read_compressed_module_data(std::string const & olean_fn, std::ifstream & in, size_t size, size_t header_size,
+                                            char * base_addr) {
+    uint64 sizes[2];
+    in.read(reinterpret_cast<char *>(sizes), sizeof(sizes));
+    size_t data_size  = sizes[0];
+    uint64 num_frames = sizes[1];
+    size_t index_pos  = header_size + sizeof(sizes);
+    if (!in || size < index_pos || num_frames == 0 || num_frames > (size - index_pos) / (2 * sizeof(uint64))) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid index").str());
+    }
+    std::vector<uint64> index(2 * num_frames);
+    in.read(reinterpret_cast<char *>(index.data()), sizeof(uint64) * index.size());
+    size_t compressed_size = size - index_pos - sizeof(uint64) * index.size();
+    /* frame `i` decompresses `[src[i], src[i] + index[2*i+1])` to `[index[2*i], dst_end[i])` */
+    std::vector<size_t> src, dst_end;
+    size_t src_pos = 0;
+    for (uint64 i = 0; i < num_frames; i++) {
+        size_t dst_begin = index[2*i];
+        size_t end       = i + 1 < num_frames ? index[2*(i+1)] : data_size;
+        size_t csize     = index[2*i+1];
+        if ((i == 0 && dst_begin != 0) || dst_begin > end || end > data_size || csize > compressed_size - src_pos) {
+            return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid index").str());
+        }
+        src.push_back(src_pos);
+        dst_end.push_back(end);
+        src_pos += csize;
+    }
+    if (!in || src_pos != compressed_size) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid index").str());
+    }
+    std::vector<char> compressed(compressed_size);
+    in.read(compressed.data(), compressed_size);
+    if (!in) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "'").str());
+    }
+    in.close();
+    char * buffer = static_cast<char *>(malloc(data_size));
+    std::function<void()> free_data = [=]() {
+        free(buffer);
+    };
+    atomic<bool> ok(true);
+    parallel_for(num_frames, hardware_concurrency(), [&](size_t, size_t i) {
+        if (!lz_decompress(compressed.data() + src[i], index[2*i+1], buffer + index[2*i], dst_end[i] - index[2*i]))
+            ok = false;
+    });
+    if (!ok) {
+        free_data();
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', corrupted data").str());
+    }
+    std::vector<size_t> chunk_offsets;
+    for (uint64 i = 1; i < num_frames; i++)
+        chunk_offsets.push_back(index[2*i]);
+    return mk_module_region(data_size, buffer, base_addr + header_size, false, free_data, chunk_offsets);
+}
+
+/* prefetchOLean : @& FilePath → IO Unit */
+extern "C" LEAN_EXPORT object * lean_prefetch_olean(b_obj_arg fname, object *) {
+#if !defined(LEAN_WINDOWS) && defined(POSIX_FADV_WILLNEED)
+    // only a hint: errors are reported when the file is read
+    int fd = open(string_cstr(fname), O_RDONLY);
+    if (fd != -1) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#endif
+    return io_result_mk_ok(box(0));
+}
+
 extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *) {
     std::string olean_fn(string_cstr(fname));
     try {
@@ -120,13 +527,55 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
         }
         char * header = new char[header_size];
         in.read(header, header_size);
-        if (strncmp(header, g_olean_header, header_size) != 0) {
+        bool has_dict = header[g_olean_header_dict_pos] == 'd';
+        if (has_dict)
+            header[g_olean_header_dict_pos] = '!';
+        bool is_v2 = strncmp(header, g_olean_header_v2, header_size) == 0;
+        bool is_v3 = strncmp(header, g_olean_header_v3, header_size) == 0;
+        if (!is_v2 && !is_v3 && (has_dict || strncmp(header, g_olean_header, header_size) != 0)) {
             return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid header").str());
         }
         delete[] header;
         char * base_addr;
         in.read(reinterpret_cast<char *>(&base_addr), sizeof(base_addr));
         header_size += sizeof(base_addr);
+        if (has_dict) {
+            uint64 dict_id;
+            in.read(reinterpret_cast<char *>(&dict_id), sizeof(dict_id));
+            header_size += sizeof(dict_id);
+            olean_dictionary const * dict = get_olean_dictionary();
+            if (!in || !dict || dict->id() != dict_id) {
+                return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', it was compacted against a dictionary of shared objects "
+                                           "that is not available, set `LEAN_OLEAN_DICT` to the dictionary file").str());
+            }
+        }
+        if (size < header_size) {
+            return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid header").str());
+        }
+        if (is_v3)
+            return read_compressed_module_data(olean_fn, in, size, header_size, base_addr);
+        /* size of the compacted region */
+        size_t data_size = size - header_size;
+        std::vector<size_t> chunk_offsets;
+        if (is_v2) {
+            uint64 num_chunk_offsets;
+            if (data_size < sizeof(num_chunk_offsets)) {
+                return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid trailer").str());
+            }
+            in.seekg(size - sizeof(num_chunk_offsets));
+            in.read(reinterpret_cast<char *>(&num_chunk_offsets), sizeof(num_chunk_offsets));
+            size_t trailer_size = sizeof(uint64) * (num_chunk_offsets + 1);
+            if (!in || num_chunk_offsets > data_size / sizeof(uint64) || data_size < trailer_size) {
+                return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid trailer").str());
+            }
+            data_size -= trailer_size;
+            std::vector<uint64> offsets(num_chunk_offsets);
+            in.seekg(header_size + data_size);
+            in.read(reinterpret_cast<char *>(offsets.data()), sizeof(uint64) * num_chunk_offsets);
+            for (uint64 offset : offsets)
+                chunk_offsets.push_back(offset);
+            in.seekg(header_size);
+        }
         char * buffer = nullptr;
         bool is_mmap = false;
         std::function<void()> free_data;
@@ -153,47 +602,189 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
         if (fd == -1) {
             return io_result_mk_error((sstream() << "failed to open '" << olean_fn << "': " << strerror(errno)).str());
         }
+        bool is_reserved = false;
+#ifdef LEAN_OLEAN_RESERVATION
+        buffer = static_cast<char *>(get_olean_reservation().map(base_addr, size, fd));
+        is_reserved = buffer != MAP_FAILED;
+        if (!is_reserved)
+#endif
+        // modules written by older versions may have a base address outside the reserved range
         buffer = static_cast<char *>(mmap(base_addr, size, PROT_READ, MAP_PRIVATE, fd, 0));
         close(fd);
         free_data = [=]() {
+#ifdef LEAN_OLEAN_RESERVATION
+            if (is_reserved) {
+                get_olean_reservation().unmap(buffer);
+                return;
+            }
+#endif
             if (buffer != MAP_FAILED) {
                 lean_always_assert(munmap(buffer, size) == 0);
             }
         };
 #endif
         if (buffer == base_addr) {
+#ifndef LEAN_WINDOWS
+            if (advise_module_region(buffer, size)) {
+                // release the lock before the pages are unmapped or returned to the reservation
+                std::function<void()> unmap = free_data;
+                free_data = [=]() {
+                    munlock(base_addr, size);
+                    unmap();
+                };
+            }
+#endif
             buffer += header_size;
             is_mmap = true;
         } else {
             free_data();
-            buffer = static_cast<char *>(malloc(size - header_size));
+            buffer = static_cast<char *>(malloc(data_size));
             free_data = [=]() {
                 free(buffer);
             };
-            in.read(buffer, size - header_size);
+            in.read(buffer, data_size);
             if (!in) {
                 return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "'").str());
             }
         }
         in.close();
-
-        compacted_region * region = new compacted_region(size - header_size, buffer, base_addr + header_size, is_mmap, free_data);
-#if defined(__has_feature)
-#if __has_feature(address_sanitizer)
-        // do not report as leak
-        __lsan_ignore_object(region);
-#endif
-#endif
-        object * mod = region->read();
-        object * mod_region = alloc_cnstr(0, 2, 0);
-        cnstr_set(mod_region, 0, mod);
-        cnstr_set(mod_region, 1, box_size_t(reinterpret_cast<size_t>(region)));
-        return io_result_mk_ok(mod_region);
+        return mk_module_region(data_size, buffer, base_addr + header_size, is_mmap, free_data, chunk_offsets);
     } catch (exception & ex) {
         return io_result_mk_error((sstream() << "failed to read '" << olean_fn << "': " << ex.what()).str());
     }
 }
 
+/*
+@[extern "lean_save_olean_dictionary"]
+opaque saveOleanDictionary (fname : @& FilePath) (oleans : @& Array FilePath) (minModules : @& Nat) : IO Unit */
+extern "C" LEAN_EXPORT object * lean_save_olean_dictionary(b_obj_arg fname, b_obj_arg oleans, b_obj_arg min_modules, object *) {
+    std::string dict_fn(string_cstr(fname));
+    unsigned min_uses = is_scalar(min_modules) ? std::max<size_t>(unbox(min_modules), 1) : std::numeric_limits<unsigned>::max();
+    std::vector<object *> mods;
+    auto free_mods = [&]() {
+        for (object * r : mods) {
+            compacted_region * region = reinterpret_cast<compacted_region *>(unbox_size_t(cnstr_get(r, 1)));
+            dec(r);
+            delete region;
+        }
+        mods.clear();
+    };
+    try {
+        // compact all modules into one region, counting the number of modules each object occurs in
+        object_compactor counter;
+        for (size_t i = 0; i < array_size(oleans); i++) {
+            object * r = lean_read_module_data(array_get(oleans, i), io_mk_world());
+            if (io_result_is_error(r)) {
+                free_mods();
+                return r;
+            }
+            object * mod_region = io_result_get_value(r);
+            inc(mod_region);
+            dec(r);
+            mods.push_back(mod_region);
+            counter.count_uses(cnstr_get(mod_region, 0));
+        }
+        std::vector<size_t> offsets = counter.shared_offsets(min_uses);
+        char * data = static_cast<char *>(malloc(counter.size()));
+        memcpy(data, counter.data(), counter.size());
+        compacted_region shared(counter.size(), data, nullptr, false, [=]() { free(data); });
+        shared.read();
+        object * objs = array_mk_empty();
+        for (size_t offset : offsets)
+            objs = lean_array_push(objs, reinterpret_cast<object *>(data + offset));
+        size_t base_addr = g_olean_base_begin;
+        uint64 dict_id   = 0;
+        object_compactor compactor(reinterpret_cast<void *>(base_addr + strlen(g_olean_dict_header) + sizeof(base_addr) + sizeof(dict_id)));
+        compactor(objs);
+        dec(objs);
+        if (compactor.size() > g_olean_dict_size) {
+            free_mods();
+            return io_result_mk_error((sstream() << "failed to write '" << dict_fn << "', dictionary is too big").str());
+        }
+        dict_id = hash(static_cast<uint64>(hash_str(compactor.size(), static_cast<unsigned char const *>(compactor.data()), 11)),
+                       static_cast<uint64>(compactor.size()));
+        std::ofstream out(dict_fn, std::ios_base::binary);
+        if (out.fail()) {
+            free_mods();
+            return io_result_mk_error((sstream() << "failed to create file '" << dict_fn << "'").str());
+        }
+        out.write(g_olean_dict_header, strlen(g_olean_dict_header));
+        out.write(reinterpret_cast<char *>(&base_addr), sizeof(base_addr));
+        out.write(reinterpret_cast<char *>(&dict_id), sizeof(dict_id));
+        out.write(static_cast<char const *>(compactor.data()), compactor.size());
+        out.close();
+        free_mods();
+        if (!out) {
+            return io_result_mk_error((sstream() << "failed to write '" << dict_fn << "'").str());
+        }
+        return io_result_mk_ok(box(0));
+    } catch (exception & ex) {
+        free_mods();
+        return io_result_mk_error((sstream() << "failed to write '" << dict_fn << "': " << ex.what()).str());
+    }
+}
+
+/* \brief Return the interface of the module data `mod`, i.e. everything that can affect modules importing it:
+   the module data without the values of theorems and without the entries of the extensions storing declaration
+   ranges and docstrings. */
+static object * mk_module_interface(object * mod) {
+    static char const * g_ignored_exts[] = { "declRangeExt", "docStringExt", "moduleDocExt" };
+    object * constants = cnstr_get(mod, 1);
+    object * iconsts   = array_mk_empty();
+    for (size_t i = 0; i < array_size(constants); i++) {
+        constant_info info(array_get(constants, i), true);
+        // for theorems, only keep the `ConstantVal`
+        object * c = info.is_theorem() ? cnstr_get(cnstr_get(info.raw(), 0), 0) : info.raw();
+        inc(c);
+        iconsts = lean_array_push(iconsts, c);
+    }
+    object * entries  = cnstr_get(mod, 3);
+    object * ientries = array_mk_empty();
+    for (size_t i = 0; i < array_size(entries); i++) {
+        object * entry = array_get(entries, i);
+        name ext(cnstr_get(entry, 0), true);
+        bool ignored = false;
+        for (char const * ignored_ext : g_ignored_exts)
+            ignored = ignored || (ext.is_string() && strcmp(ext.get_string().data(), ignored_ext) == 0);
+        if (!ignored) {
+            inc(entry);
+            ientries = lean_array_push(ientries, entry);
+        }
+    }
+    object * r = alloc_cnstr(0, 4, 0);
+    inc(cnstr_get(mod, 0));
+    cnstr_set(r, 0, cnstr_get(mod, 0));
+    cnstr_set(r, 1, iconsts);
+    inc(cnstr_get(mod, 2));
+    cnstr_set(r, 2, cnstr_get(mod, 2));
+    cnstr_set(r, 3, ientries);
+    return r;
+}
+
+/*
+@[extern "lean_read_module_interface_hash"]
+opaque readModuleInterfaceHash (fname : @& FilePath) : IO UInt64 */
+extern "C" LEAN_EXPORT object * lean_read_module_interface_hash(b_obj_arg fname, object *) {
+    object * r = lean_read_module_data(fname, io_mk_world());
+    if (io_result_is_error(r))
+        return r;
+    object * mod_region = io_result_get_value(r);
+    compacted_region * region = reinterpret_cast<compacted_region *>(unbox_size_t(cnstr_get(mod_region, 1)));
+    uint64 h;
+    {
+        object * iface = mk_module_interface(cnstr_get(mod_region, 0));
+        // the compacted representation only depends on the structure of `iface`
+        object_compactor compactor;
+        compactor(iface);
+        dec(iface);
+        unsigned char const * data = static_cast<unsigned char const *>(compactor.data());
+        h = (static_cast<uint64>(hash_str(compactor.size(), data, 31)) << 32) | hash_str(compactor.size(), data, 17);
+    }
+    dec(r);
+    delete region;
+    return io_result_mk_ok(box_uint64(h));
+}
+
 /*
 @[export lean.write_module_core]
 def writeModule (env : Environment) (fname : String) : IO Unit := */
@@ -0,0 +1,248 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <string>
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include "runtime/io.h"
+#include "runtime/buffer.h"
+#include "runtime/interrupt.h"
+#include "kernel/environment.h"
+#include "kernel/expr.h"
+
+namespace lean {
+/* Statistics about the memory used by an environment, see `Environment.displayObjectStats`. */
+
+static char const * g_object_kind_names[] = {
+    "constructor", "closure", "array", "struct array", "scalar array", "string", "bignum", "thunk", "task", "ref",
+    "external"
+};
+static constexpr unsigned g_num_object_kinds = sizeof(g_object_kind_names) / sizeof(g_object_kind_names[0]);
+
+static unsigned get_object_kind(object * o) {
+    uint8 tag = lean_ptr_tag(o);
+    return tag <= LeanMaxCtorTag ? 0 : std::min<unsigned>(tag - LeanClosure + 1, g_num_object_kinds - 1);
+}
+
+struct object_count {
+    uint64 m_num{0};
+    uint64 m_bytes{0};
+    uint64 m_persistent_bytes{0};
+};
+
+static uint64 sat_add(uint64 a, uint64 b) {
+    return a + b < a ? std::numeric_limits<uint64>::max() : a + b;
+}
+
+class object_stats_fn {
+    std::unordered_set<object *> m_visited;
+    object_count                 m_kinds[g_num_object_kinds];
+
+public:
+    /* Visit the objects reachable from `o` that have not been visited yet, and return their number and size. */
+    object_count visit(object * o) {
+        object_count r;
+        buffer<object *> todo;
+        todo.push_back(o);
+        while (!todo.empty()) {
+            object * o = todo.back();
+            todo.pop_back();
+            if (lean_is_scalar(o) || !m_visited.insert(o).second)
+                continue;
+            size_t sz = lean_object_byte_size(o);
+            object_count & k = m_kinds[get_object_kind(o)];
+            k.m_num++;
+            k.m_bytes += sz;
+            r.m_num++;
+            r.m_bytes += sz;
+            if (!lean_has_rc(o)) {
+                // objects of compacted regions and objects marked as persistent
+                k.m_persistent_bytes += sz;
+                r.m_persistent_bytes += sz;
+            }
+            uint8 tag = lean_ptr_tag(o);
+            if (tag <= LeanMaxCtorTag) {
+                object ** it  = lean_ctor_obj_cptr(o);
+                object ** end = it + lean_ctor_num_objs(o);
+                for (; it != end; ++it) todo.push_back(*it);
+                continue;
+            }
+            switch (tag) {
+            case LeanClosure: {
+                object ** it  = lean_closure_arg_cptr(o);
+                object ** end = it + lean_closure_num_fixed(o);
+                for (; it != end; ++it) todo.push_back(*it);
+                break;
+            }
+            case LeanArray: {
+                object ** it  = lean_array_cptr(o);
+                object ** end = it + lean_array_size(o);
+                for (; it != end; ++it) todo.push_back(*it);
+                break;
+            }
+            case LeanThunk:
+                if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
+                if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
+                break;
+            case LeanTask:
+                // do not wait for running tasks
+                if (object * v = task_get_value_if_finished(o)) todo.push_back(v);
+                break;
+            case LeanRef:
+                if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
+                break;
+            default:
+                // the contents of external objects are not visited
+                break;
+            }
+        }
+        return r;
+    }
+
+    void display_kinds(std::ostream & out) const {
+        out << "objects by kind (objects, bytes, bytes in compacted regions or persistent):\n";
+        for (unsigned i = 0; i < g_num_object_kinds; i++) {
+            if (m_kinds[i].m_num > 0)
+                out << "  " << g_object_kind_names[i] << ": " << m_kinds[i].m_num << ", " << m_kinds[i].m_bytes << ", "
+                    << m_kinds[i].m_persistent_bytes << "\n";
+        }
+    }
+};
+
+struct decl_expr_stats {
+    name   m_name;
+    uint64 m_dag_size;
+    uint64 m_tree_size;
+};
+
+/* Sizes of the expressions of a declaration: the number of distinct nodes, and the number of nodes if no subterm
+   was shared. */
+class expr_size_fn {
+    std::unordered_map<lean_object *, uint64> m_tree_size;
+    std::unordered_set<lean_object *> &       m_all;
+    uint64                                    m_all_bytes{0};
+
+    /* Store the children of `e` in `cs`, and return their number. */
+    static unsigned get_children(expr const & e, expr const * cs[3]) {
+        switch (e.kind()) {
+        case expr_kind::App:
+            cs[0] = &app_fn(e); cs[1] = &app_arg(e);
+            return 2;
+        case expr_kind::Lambda: case expr_kind::Pi:
+            cs[0] = &binding_domain(e); cs[1] = &binding_body(e);
+            return 2;
+        case expr_kind::Let:
+            cs[0] = &let_type(e); cs[1] = &let_value(e); cs[2] = &let_body(e);
+            return 3;
+        case expr_kind::MData:
+            cs[0] = &mdata_expr(e);
+            return 1;
+        case expr_kind::Proj:
+            cs[0] = &proj_expr(e);
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    /* The expressions can be arbitrarily deep, so they are traversed with an explicit stack. An expression is pushed
+       once to visit its children, and again with `true` to add up their sizes after they have been visited. */
+    uint64 tree_size(expr const & root) {
+        buffer<std::pair<expr const *, bool>> todo;
+        todo.push_back(mk_pair(&root, false));
+        while (!todo.empty()) {
+            expr const & e     = *todo.back().first;
+            bool children_done = todo.back().second;
+            todo.pop_back();
+            if (m_tree_size.find(e.raw()) != m_tree_size.end())
+                continue;
+            expr const * cs[3];
+            unsigned n = get_children(e, cs);
+            if (!children_done) {
+                check_system("object statistics");
+                if (m_all.insert(e.raw()).second)
+                    m_all_bytes += lean_object_byte_size(e.raw());
+                todo.push_back(mk_pair(&e, true));
+                for (unsigned i = 0; i < n; i++)
+                    todo.push_back(mk_pair(cs[i], false));
+            } else {
+                uint64 r = 1;
+                for (unsigned i = 0; i < n; i++)
+                    r = sat_add(r, m_tree_size.find(cs[i]->raw())->second);
+                m_tree_size.insert(mk_pair(e.raw(), r));
+            }
+        }
+        return m_tree_size.find(root.raw())->second;
+    }
+
+public:
+    expr_size_fn(std::unordered_set<lean_object *> & all):m_all(all) {}
+
+    void add(expr const & e, uint64 & tree) { tree = sat_add(tree, tree_size(e)); }
+    uint64 dag_size() const { return m_tree_size.size(); }
+    uint64 new_bytes() const { return m_all_bytes; }
+};
+
+static void display_top_decls(std::ostream & out, char const * title, std::vector<decl_expr_stats> & decls,
+                              bool (*lt)(decl_expr_stats const &, decl_expr_stats const &)) {
+    static constexpr size_t g_num_top_decls = 20;
+    size_t n = std::min(g_num_top_decls, decls.size());
+    std::partial_sort(decls.begin(), decls.begin() + n, decls.end(), lt);
+    out << title << " (DAG size, tree size):\n";
+    for (size_t i = 0; i < n; i++)
+        out << "  " << decls[i].m_name << ": " << decls[i].m_dag_size << ", " << decls[i].m_tree_size << "\n";
+}
+
+static void display_expr_stats(std::ostream & out, environment const & env) {
+    std::vector<decl_expr_stats> decls;
+    std::unordered_set<lean_object *> all;
+    uint64 dag_size = 0, tree_size = 0, bytes = 0;
+    env.for_each_constant([&](constant_info const & c) {
+            expr_size_fn fn(all);
+            uint64 tree = 0;
+            fn.add(c.get_type(), tree);
+            if (c.has_value())
+                fn.add(c.get_value(), tree);
+            decls.push_back({c.get_name(), fn.dag_size(), tree});
+            dag_size  = sat_add(dag_size, fn.dag_size());
+            tree_size = sat_add(tree_size, tree);
+            bytes    += fn.new_bytes();
+        });
+    out << "expressions of " << decls.size() << " constants:\n";
+    out << "  nodes, shared within each declaration: " << dag_size << "\n";
+    out << "  nodes, not shared:                     " << tree_size << "\n";
+    out << "  nodes, shared across declarations:     " << all.size() << " (" << bytes << " bytes)\n";
+    display_top_decls(out, "declarations with the largest expressions", decls,
+                      [](decl_expr_stats const & a, decl_expr_stats const & b) { return a.m_dag_size > b.m_dag_size; });
+    display_top_decls(out, "declarations with the largest unshared expressions", decls,
+                      [](decl_expr_stats const & a, decl_expr_stats const & b) { return a.m_tree_size > b.m_tree_size; });
+}
+
+/* displayObjectStatsCore (env : @& Environment) (roots : @& Array (String × NonScalar)) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_display_object_stats(b_obj_arg env, b_obj_arg roots, obj_arg) {
+    std::ostream & out = std::cout;
+    display_expr_stats(out, environment(env, true));
+    object_stats_fn fn;
+    out << "objects reachable from the environment, counted for the first of the following that reaches them "
+        << "(objects, bytes, bytes in compacted regions or persistent):\n";
+    object_count total;
+    for (size_t i = 0; i < array_size(roots); i++) {
+        object * root = array_get(roots, i);
+        object_count r = fn.visit(cnstr_get(root, 1));
+        total.m_num += r.m_num;
+        total.m_bytes += r.m_bytes;
+        total.m_persistent_bytes += r.m_persistent_bytes;
+        if (r.m_num > 0)
+            out << "  " << string_cstr(cnstr_get(root, 0)) << ": " << r.m_num << ", " << r.m_bytes << ", "
+                << r.m_persistent_bytes << "\n";
+    }
+    out << "  total: " << total.m_num << ", " << total.m_bytes << ", " << total.m_persistent_bytes << "\n";
+    fn.display_kinds(out);
+    return io_result_mk_ok(box(0));
+}
+}
@@ -15,10 +15,15 @@ Author: Gabriel Ebner
 #define LEAN_DEFAULT_PROFILER_THRESHOLD 100
 #endif
 
+#ifndef LEAN_DEFAULT_PROFILER_JSON
+#define LEAN_DEFAULT_PROFILER_JSON ""
+#endif
+
 namespace lean {
 
 static name * g_profiler           = nullptr;
 static name * g_profiler_threshold = nullptr;
+static name * g_profiler_json      = nullptr;
 
 bool get_profiler(options const & opts) {
     return opts.get_bool(*g_profiler, LEAN_DEFAULT_PROFILER);
@@ -28,19 +33,28 @@ second_duration get_profiling_threshold(options const & opts) {
     return second_duration(static_cast<double>(opts.get_unsigned(*g_profiler_threshold, LEAN_DEFAULT_PROFILER_THRESHOLD))/1000.0);
 }
 
+std::string get_profiler_json(options const & opts) {
+    return opts.get_string(*g_profiler_json, LEAN_DEFAULT_PROFILER_JSON);
+}
+
 void initialize_profiling() {
     g_profiler           = new name{"profiler"};
     mark_persistent(g_profiler->raw());
     g_profiler_threshold = new name{"profiler", "threshold"};
     mark_persistent(g_profiler_threshold->raw());
+    g_profiler_json      = new name{"profiler", "json"};
+    mark_persistent(g_profiler_json->raw());
     register_bool_option(*g_profiler, LEAN_DEFAULT_PROFILER, "(profiler) profile tactics and vm_eval command");
     register_unsigned_option(*g_profiler_threshold, LEAN_DEFAULT_PROFILER_THRESHOLD,
                              "(profiler) threshold in milliseconds, profiling times under threshold will not be reported");
+    register_option(*g_profiler_json, data_value_kind::String, LEAN_DEFAULT_PROFILER_JSON,
+                    "(profiler) name of a file to which every profiled span is appended as a JSON line, independently of `profiler`");
 }
 
 void finalize_profiling() {
     delete g_profiler;
     delete g_profiler_threshold;
+    delete g_profiler_json;
 }
 
 }
@@ -6,6 +6,7 @@ Author: Gabriel Ebner
 */
 #pragma once
 #include <chrono>
+#include <string>
 #include <util/options.h>
 
 namespace lean {
@@ -14,6 +15,8 @@ using second_duration = std::chrono::duration<double>;
 
 bool get_profiler(options const &);
 second_duration get_profiling_threshold(options const &);
+/** \brief Name of the JSON lines file set by the `profiler.json` option, or the empty string. */
+std::string get_profiler_json(options const &);
 
 void initialize_profiling();
 void finalize_profiling();
@@ -6,6 +6,18 @@ Author: Sebastian Ullrich
 */
 #include <string>
 #include <map>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#include <signal.h>
+#include <sys/time.h>
+#endif
+#include "runtime/alloc.h"
 #include "library/time_task.h"
 #include "library/trace.h"
 
@@ -13,13 +25,83 @@ namespace lean {
 
 static std::map<std::string, second_duration> * g_cum_times;
 static mutex * g_cum_times_mutex;
+static atomic<bool> g_collect_cum_times{false};
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
+void set_collect_profiling_times(bool flag) {
+    g_collect_cum_times = flag;
+}
+
+bool get_collect_profiling_times() {
+    return g_collect_cum_times;
+}
+
 void report_profiling_time(std::string const & category, second_duration time) {
     lock_guard<mutex> _(*g_cum_times_mutex);
     (*g_cum_times)[category] += time;
 }
 
+/* Sink for the `profiler.json` option. Each line is a JSON object of the form
+   `{"file":...,"decl":...,"category":...,"start":...,"end":...,"tid":...,"heartbeats":...}`
+   where `start` and `end` are microseconds since the Unix epoch, so that records of different processes
+   can be merged, and `tid` numbers the threads of the process in the order of their first record. */
+static std::string *   g_json_file_name;
+static std::string *   g_json_out_name;
+static std::ofstream * g_json_out;
+static mutex *         g_json_mutex;
+static atomic<unsigned> g_json_next_tid{0};
+LEAN_THREAD_VALUE(unsigned, g_json_tid, 0);
+
+void set_profiling_file_name(std::string const & fname) {
+    lock_guard<mutex> _(*g_json_mutex);
+    *g_json_file_name = fname;
+}
+
+static uint64 json_now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void display_json_string(std::ostream & out, std::string const & s) {
+    static char const hex[] = "0123456789abcdef";
+    out << '"';
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (u < 0x20)
+            out << "\\u00" << hex[u >> 4] << hex[u & 0xf];
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+static void write_json_record(std::string const & fname, name const & decl, std::string const & category,
+                              uint64 start, uint64 end, uint64 heartbeats) {
+    if (g_json_tid == 0)
+        g_json_tid = ++g_json_next_tid;
+    lock_guard<mutex> _(*g_json_mutex);
+    if (!g_json_out || *g_json_out_name != fname) {
+        delete g_json_out;
+        g_json_out      = new std::ofstream(fname, std::ios_base::app);
+        *g_json_out_name = fname;
+    }
+    std::ostream & out = *g_json_out;
+    out << "{\"file\":";
+    display_json_string(out, *g_json_file_name);
+    out << ",\"decl\":";
+    if (decl)
+        display_json_string(out, decl.to_string());
+    else
+        out << "null";
+    out << ",\"category\":";
+    display_json_string(out, category);
+    out << ",\"start\":" << start << ",\"end\":" << end << ",\"tid\":" << g_json_tid
+        << ",\"heartbeats\":" << heartbeats << "}\n";
+    out.flush();
+}
+
 void display_cumulative_profiling_times(std::ostream & out) {
     if (g_cum_times->empty())
         return;
@@ -28,31 +110,255 @@ void display_cumulative_profiling_times(std::ostream & out) {
         out << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
 }
 
+void reset_cumulative_profiling_times() {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    g_cum_times->clear();
+}
+
+void display_cumulative_profiling_times_json(std::ostream & out) {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    out << "{";
+    bool first = true;
+    for (auto const & p : *g_cum_times) {
+        if (!first)
+            out << ",";
+        first = false;
+        display_json_string(out, p.first);
+        out << ":" << p.second.count();
+    }
+    out << "}";
+}
+
+/* Sampling profiler, see `scoped_sample_profiler`. Every thread has a stack of the ids of its active `time_task`s.
+   It is only modified by the thread itself, and read by the `SIGPROF` handler, which interrupts the same thread, so
+   compiler fences are sufficient. Samples are stored in a buffer that is allocated when sampling starts, the handler
+   does not allocate or lock. */
+static constexpr unsigned g_max_sample_depth = 32;
+static constexpr size_t   g_max_samples      = 1 << 18;
+
+struct sample_stack {
+    unsigned m_depth{0};
+    unsigned m_frames[g_max_sample_depth];
+    uint64   m_last_heartbeats{0};
+};
+
+struct sample {
+    unsigned m_depth;
+    unsigned m_frames[g_max_sample_depth];
+    uint64   m_heartbeats;
+};
+
+static atomic<bool>                             g_sampling{false};
+/* Number of threads running `sample_handler`, which may still be using `g_samples`. */
+static atomic<unsigned>                         g_num_active_handlers{0};
+static sample *                                 g_samples;
+static atomic<size_t>                           g_num_samples{0};
+static mutex *                                  g_sample_frames_mutex;
+static std::unordered_map<std::string, unsigned> * g_sample_frame_ids;
+static std::vector<std::string> *               g_sample_frame_names;
+static std::vector<sample_stack *> *            g_sample_stacks;
+LEAN_THREAD_PTR(sample_stack, g_sample_stack);
+
+static unsigned get_sample_frame_id(std::string const & category, name const & decl) {
+    std::string frame = category;
+    if (decl)
+        frame += " of " + decl.to_string();
+    // `;` separates the frames of a folded stack
+    for (char & c : frame)
+        if (c == ';') c = ':';
+    lock_guard<mutex> _(*g_sample_frames_mutex);
+    auto it = g_sample_frame_ids->find(frame);
+    if (it != g_sample_frame_ids->end())
+        return it->second;
+    unsigned id = g_sample_frame_names->size();
+    g_sample_frame_names->push_back(frame);
+    (*g_sample_frame_ids)[frame] = id;
+    return id;
+}
+
+static void push_sample_frame(std::string const & category, name const & decl) {
+    unsigned id = get_sample_frame_id(category, decl);
+    if (!g_sample_stack) {
+        g_sample_stack = new sample_stack();
+        g_sample_stack->m_last_heartbeats = get_num_heartbeats();
+        lock_guard<mutex> _(*g_sample_frames_mutex);
+        g_sample_stacks->push_back(g_sample_stack);
+    }
+    sample_stack & s = *g_sample_stack;
+    if (s.m_depth < g_max_sample_depth)
+        s.m_frames[s.m_depth] = id;
+    std::atomic_signal_fence(std::memory_order_release);
+    s.m_depth++;
+}
+
+static void pop_sample_frame() {
+    std::atomic_signal_fence(std::memory_order_release);
+    g_sample_stack->m_depth--;
+}
+
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+static void record_sample() {
+    size_t i = g_num_samples++;
+    if (i >= g_max_samples)
+        return;
+    sample & r = g_samples[i];
+    r.m_depth      = 0;
+    r.m_heartbeats = 0;
+    if (sample_stack * s = g_sample_stack) {
+        std::atomic_signal_fence(std::memory_order_acquire);
+        r.m_depth = std::min(s->m_depth, g_max_sample_depth);
+        for (unsigned j = 0; j < r.m_depth; j++)
+            r.m_frames[j] = s->m_frames[j];
+        uint64 hb = get_num_heartbeats();
+        r.m_heartbeats = hb - s->m_last_heartbeats;
+        s->m_last_heartbeats = hb;
+    }
+}
+
+static void sample_handler(int) {
+    /* Incremented before checking `g_sampling`, so that `~scoped_sample_profiler` waits for this call if it has
+       seen `g_sampling` set. */
+    g_num_active_handlers++;
+    if (g_sampling)
+        record_sample();
+    g_num_active_handlers--;
+}
+#endif
+
+scoped_sample_profiler::scoped_sample_profiler(optional<std::string> const & fname):m_fname(fname) {
+    if (!m_fname)
+        return;
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    std::cerr << "warning: --sample-profile is not supported on this platform\n";
+    m_fname = optional<std::string>();
+#else
+    g_samples = new sample[g_max_samples];
+    g_num_samples = 0;
+    g_sampling = true;
+    struct sigaction act;
+    act.sa_handler = sample_handler;
+    act.sa_flags   = SA_RESTART;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGPROF, &act, nullptr);
+    itimerval timer;
+    timer.it_interval.tv_sec  = 0;
+    timer.it_interval.tv_usec = 1000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+}
+
+scoped_sample_profiler::~scoped_sample_profiler() {
+    if (!m_fname)
+        return;
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+    g_sampling = false;
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    /* Handlers interrupting other threads may still be writing their samples. */
+    while (g_num_active_handlers != 0)
+        this_thread::yield();
+    size_t n = std::min(static_cast<size_t>(g_num_samples), g_max_samples);
+    std::map<std::string, std::pair<uint64, uint64>> stacks;
+    {
+        lock_guard<mutex> _(*g_sample_frames_mutex);
+        for (size_t i = 0; i < n; i++) {
+            sample const & r = g_samples[i];
+            std::string stack = "lean";
+            for (unsigned j = 0; j < r.m_depth; j++)
+                stack += ";" + (*g_sample_frame_names)[r.m_frames[j]];
+            auto & p = stacks[stack];
+            p.first++;
+            p.second += r.m_heartbeats;
+        }
+    }
+    delete[] g_samples;
+    g_samples = nullptr;
+    std::ofstream out(*m_fname);
+    std::ofstream hb_out(*m_fname + ".heartbeats");
+    if (!out || !hb_out) {
+        std::cerr << "failed to create '" << *m_fname << "'\n";
+        return;
+    }
+    for (auto const & p : stacks) {
+        out << p.first << " " << p.second.first << "\n";
+        if (p.second.second > 0)
+            hb_out << p.first << " " << p.second.second << "\n";
+    }
+    if (g_num_samples > g_max_samples)
+        std::cerr << "sample profile: " << g_num_samples - g_max_samples << " samples dropped\n";
+#endif
+}
+
 void initialize_time_task() {
     g_cum_times_mutex = new mutex;
     g_cum_times = new std::map<std::string, second_duration>;
+    g_json_file_name = new std::string;
+    g_json_out_name  = new std::string;
+    g_json_out       = nullptr;
+    g_json_mutex     = new mutex;
+    g_sample_frames_mutex = new mutex;
+    g_sample_frame_ids    = new std::unordered_map<std::string, unsigned>;
+    g_sample_frame_names  = new std::vector<std::string>;
+    g_sample_stacks       = new std::vector<sample_stack *>;
 }
 
 void finalize_time_task() {
     delete g_cum_times;
     delete g_cum_times_mutex;
+    delete g_json_out;
+    delete g_json_out_name;
+    delete g_json_file_name;
+    delete g_json_mutex;
+    for (sample_stack * s : *g_sample_stacks)
+        delete s;
+    delete g_sample_stacks;
+    delete g_sample_frame_names;
+    delete g_sample_frame_ids;
+    delete g_sample_frames_mutex;
 }
 
 time_task::time_task(std::string const & category, options const & opts, name decl) :
-        m_category(category) {
+        m_category(category), m_start_heartbeats(get_num_heartbeats()), m_decl(decl),
+        m_json_fname(get_profiler_json(opts)) {
+    task_trace_begin(m_category);
+    if (g_sampling) {
+        push_sample_frame(m_category, decl);
+        m_sampled = true;
+    }
+    if (!m_json_fname.empty())
+        m_json_start = json_now();
     if (get_profiler(opts)) {
+        // the profiler may only be enabled locally, e.g. by `set_option profiler true in`
+        if (!g_collect_cum_times)
+            g_collect_cum_times = true;
         m_timeit = optional<xtimeit>(get_profiling_threshold(opts), [=](second_duration duration) mutable {
             tout() << m_category;
             if (decl)
                 tout() << " of " << decl;
-            tout() << " took " << display_profiling_time{duration} << "\n";
+            tout() << " took " << display_profiling_time{duration};
+            if (decl)
+                tout() << " (" << get_num_heartbeats() - m_start_heartbeats << " heartbeats)";
+            tout() << "\n";
         });
         m_parent_task = g_current_time_task;
         g_current_time_task = this;
+    } else if (g_collect_cum_times) {
+        // only contribute to the cumulative times
+        m_timeit = optional<xtimeit>([](second_duration) {});
+        m_parent_task = g_current_time_task;
+        g_current_time_task = this;
     }
 }
 
 time_task::~time_task() {
+    task_trace_end(m_category);
+    if (m_sampled)
+        pop_sample_frame();
+    if (!m_json_fname.empty())
+        write_json_record(m_json_fname, m_decl, m_category, m_json_start, json_now(),
+                          get_num_heartbeats() - m_start_heartbeats);
     if (m_timeit) {
         g_current_time_task = m_parent_task;
         report_profiling_time(m_category, m_timeit->get_elapsed());
@@ -68,4 +374,12 @@ extern "C" LEAN_EXPORT obj_res lean_profileit(b_obj_arg category, b_obj_arg opts
                 TO_REF(options, opts));
     return apply_1(fn, box(0));
 }
+
+/* profileitDecl {α : Type} (category : String) (opts : Options) (decl : Name) (fn : Unit → α) : α */
+extern "C" LEAN_EXPORT obj_res lean_profileit_decl(b_obj_arg category, b_obj_arg opts, b_obj_arg decl, obj_arg fn) {
+    time_task t(string_to_std(category),
+                TO_REF(options, opts),
+                TO_REF(name, decl));
+    return apply_1(fn, box(0));
+}
 }
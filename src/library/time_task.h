@@ -13,17 +13,49 @@ Author: Sebastian Ullrich
 namespace lean {
 void report_profiling_time(std::string const & category, second_duration time);
 void display_cumulative_profiling_times(std::ostream & out);
+/** \brief Discard the cumulative profiling times, e.g. between two requests of `lean --daemon`. */
+void reset_cumulative_profiling_times();
+/** \brief Collect cumulative profiling times even if the `profiler` option is not set, without reporting individual tasks. */
+void set_collect_profiling_times(bool flag);
+/** \brief Return true if cumulative profiling times are collected, i.e., if `set_collect_profiling_times(true)` was
+    called or the `profiler` option was set for some task. */
+bool get_collect_profiling_times();
+/** \brief Write the cumulative profiling times in seconds as a JSON object indexed by category. */
+void display_cumulative_profiling_times_json(std::ostream & out);
+/** \brief Write `s` as a JSON string literal. */
+void display_json_string(std::ostream & out, std::string const & s);
+/** \brief Set the file name reported in the `profiler.json` records of this process. */
+void set_profiling_file_name(std::string const & fname);
 
-/** Measure time of some task and report it for the final cumulative profile. */
+/** Measure time of some task and report it for the final cumulative profile.
+    If the `profiler.json` option is set, the span is also appended to that file as a JSON line. */
 class time_task {
     std::string     m_category;
+    uint64          m_start_heartbeats;
     optional<xtimeit> m_timeit;
     time_task *     m_parent_task;
+    name            m_decl;
+    std::string     m_json_fname;
+    uint64          m_json_start{0};
+    bool            m_sampled{false};
 public:
     time_task(std::string const & category, options const & opts, name decl = name());
     ~time_task();
 };
 
+/** \brief Sampling profiler for the `time_task`s of all threads, enabled by `lean --sample-profile=file`.
+    A `SIGPROF` timer records the stack of the active tasks of the interrupted thread every millisecond of CPU time,
+    and the heartbeats of the thread since its previous sample. When the object is destroyed, the samples are written
+    to `file` as folded stacks, i.e., one line `lean;<task>;...;<task> <samples>` per stack, and the heartbeats to
+    `file.heartbeats` in the same format, so that both can be turned into flame graphs. Does nothing if `fname` is
+    `none`. */
+class scoped_sample_profiler {
+    optional<std::string> m_fname;
+public:
+    scoped_sample_profiler(optional<std::string> const & fname);
+    ~scoped_sample_profiler();
+};
+
 void initialize_time_task();
 void finalize_time_task();
 }
@@ -5,10 +5,20 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <vector>
+#include <algorithm>
+#include <cstdlib>
 #include <lean/lean.h>
 #include "runtime/thread.h"
 #include "runtime/debug.h"
 #include "runtime/alloc.h"
+#include "runtime/memory.h"
+#include "runtime/int64.h"
+#include "runtime/allocprof.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define LEAN_HUGE_PAGE_SUPPORT
+#endif
 
 #ifdef LEAN_RUNTIME_STATS
 #define LEAN_RUNTIME_STAT_CODE(c) c
@@ -26,6 +36,8 @@ Author: Leonardo de Moura
 #define LEAN_SEGMENT_SIZE          8*1024*1024 // 8 Mb
 #define LEAN_NUM_SLOTS             (LEAN_MAX_SMALL_OBJECT_SIZE / LEAN_OBJECT_SIZE_DELTA)
 #define LEAN_MAX_TO_EXPORT_OBJS    1024
+#define LEAN_HUGE_PAGE_SIZE        2*1024*1024 // 2 Mb
+#define LEAN_ARENA_CHUNK_SIZE      1024*1024   // 1 Mb
 
 LEAN_CASSERT(LEAN_PAGE_SIZE > LEAN_MAX_SMALL_OBJECT_SIZE);
 LEAN_CASSERT(LEAN_SEGMENT_SIZE > LEAN_PAGE_SIZE);
@@ -41,6 +53,10 @@ static atomic<uint64> g_num_segments(0);
 static atomic<uint64> g_num_pages(0);
 static atomic<uint64> g_num_exports(0);
 static atomic<uint64> g_num_recycled_pages(0);
+static atomic<uint64> g_num_cached_pages(0);
+static atomic<uint64> g_num_reused_pages(0);
+static atomic<uint64> g_num_imports(0);
+static atomic<uint64> g_num_huge_segments(0);
 struct alloc_stats {
     ~alloc_stats() {
         std::cerr << "num. alloc.:         " << g_num_alloc << "\n";
@@ -48,9 +64,13 @@ struct alloc_stats {
         std::cerr << "num. dealloc.:       " << g_num_dealloc << "\n";
         std::cerr << "num. small dealloc.: " << g_num_small_dealloc << "\n";
         std::cerr << "num. segments:       " << g_num_segments << "\n";
+        std::cerr << "num. huge segments:  " << g_num_huge_segments << "\n";
         std::cerr << "num. pages:          " << g_num_pages << "\n";
         std::cerr << "num. recycled pages: " << g_num_recycled_pages << "\n";
+        std::cerr << "num. cached pages:   " << g_num_cached_pages << "\n";
+        std::cerr << "num. reused pages:   " << g_num_reused_pages << "\n";
         std::cerr << "num. exports:        " << g_num_exports << "\n";
+        std::cerr << "num. imports:        " << g_num_imports << "\n";
     }
 };
 static alloc_stats g_alloc_stats;
@@ -64,9 +84,11 @@ struct page_header {
     page *           m_prev;
     void *           m_free_list;
     unsigned         m_obj_size;
-    unsigned         m_max_free;
-    unsigned         m_num_free;
-    unsigned         m_slot_idx;
+    /* Atomic since `collect_heap_stats` reads them from other threads. They are only written by the owner
+       of the page, so relaxed loads and stores suffice. */
+    atomic<unsigned> m_max_free;
+    atomic<unsigned> m_num_free;
+    atomic<unsigned> m_slot_idx;
     bool             m_in_page_free_list;
 };
 
@@ -79,9 +101,15 @@ struct page {
     void set_prev(page * p) { m_header.m_prev = p; }
     void set_heap(heap * h) { m_header.m_heap = h; }
     heap * get_heap() { return m_header.m_heap; }
-    bool has_many_free() const { return m_header.m_num_free > m_header.m_max_free / 4; }
+    unsigned get_num_free() const { return m_header.m_num_free.load(memory_order_relaxed); }
+    unsigned get_max_free() const { return m_header.m_max_free.load(memory_order_relaxed); }
+    void set_num_free(unsigned n) { m_header.m_num_free.store(n, memory_order_relaxed); }
+    void set_max_free(unsigned n) { m_header.m_max_free.store(n, memory_order_relaxed); }
+    bool has_many_free() const { return get_num_free() > get_max_free() / 4; }
+    bool is_empty() const { return get_num_free() == get_max_free(); }
     bool in_page_free_list() const { return m_header.m_in_page_free_list; }
-    unsigned get_slot_idx() const { return m_header.m_slot_idx; }
+    unsigned get_slot_idx() const { return m_header.m_slot_idx.load(memory_order_relaxed); }
+    void set_slot_idx(unsigned i) { m_header.m_slot_idx.store(i, memory_order_relaxed); }
     void push_free_obj(void * o);
 };
 
@@ -91,7 +119,8 @@ inline char * align_ptr(char * p, size_t a) {
 
 struct segment {
     segment *    m_next{nullptr};
-    char *       m_next_page_mem;
+    /* Atomic since `collect_heap_stats` reads it from other threads. */
+    atomic<char *> m_next_page_mem;
     char         m_data[LEAN_SEGMENT_SIZE];
 
     char * get_first_page_mem() {
@@ -105,32 +134,54 @@ struct segment {
     }
 
     bool is_full() const {
-        return m_next_page_mem + LEAN_PAGE_SIZE > m_data + LEAN_SEGMENT_SIZE;
+        return m_next_page_mem.load(memory_order_relaxed) + LEAN_PAGE_SIZE > m_data + LEAN_SEGMENT_SIZE;
     }
 };
 
 struct heap {
-    segment * m_curr_segment{nullptr};
+    /* Atomic since `collect_heap_stats` reads it from other threads. */
+    atomic<segment *> m_curr_segment{nullptr};
     heap *    m_next_orphan{nullptr};
     page *    m_curr_page[LEAN_NUM_SLOTS];
     page *    m_page_free_list[LEAN_NUM_SLOTS];
+    /* Pages without any live object. They are reused by `alloc_page` for any slot
+       before we carve new pages out of `m_curr_segment`. */
+    page *    m_empty_pages{nullptr};
     /* Objects that must be sent to other heaps. */
     void *    m_to_export_list{nullptr};
     unsigned  m_to_export_list_size{0};
-    mutex     m_mutex; /* for the following fields */
     /* The following list contains object by this heap that were deallocated
-       by other heaps. */
-    void *    m_to_import_list{nullptr};
+       by other heaps. It is a lock-free multiple-producer single-consumer stack:
+       other heaps push whole batches of objects using compare-and-swap in `export_objs`,
+       and the owner takes the whole list at once in `import_objs`. */
+    atomic<void *> m_to_import_list{nullptr};
     uint64_t  m_heartbeat{0}; /* Counter for implementing "deterministic timeouts". It is currently the number of small allocations */
+    /* Number of bytes to be allocated before the next sample of the sampling allocation profiler, see `allocprof.h`.
+       It is kept negative while an arena is active so that `lean_alloc_small` takes the slow path. */
+    int64_t   m_bytes_until_sample{INT64_MAX};
+    /* Innermost active arena. */
+    arena *   m_arena{nullptr};
     void import_objs();
     void export_objs();
     void alloc_segment();
 };
 
 struct heap_manager {
-    /* The mutex protects the list of orphan segments. */
+    /* The mutex protects the list of orphan segments and `m_heaps`. */
     mutex             m_mutex;
     heap *            m_orphans{nullptr};
+    /* All heaps ever created, they are never deleted. We only use it to report statistics. */
+    std::vector<heap *> m_heaps;
+
+    void push_heap(heap * h) {
+        lock_guard<mutex> lock(m_mutex);
+        m_heaps.push_back(h);
+    }
+
+    std::vector<heap *> get_heaps() {
+        lock_guard<mutex> lock(m_mutex);
+        return m_heaps;
+    }
 
     void push_orphan(heap * h) {
         /* TODO(Leo): avoid mutex */
@@ -156,6 +207,41 @@ static inline page * get_page_of(void * o) {
     return reinterpret_cast<page*>((reinterpret_cast<size_t>(o)/LEAN_PAGE_SIZE)*LEAN_PAGE_SIZE);
 }
 
+/* The pages of an arena are not owned by any heap, i.e., their `m_heap` is `nullptr`, which makes
+   deallocating their objects from other threads a no-op. The free lists of the pages are not used,
+   objects are bump allocated at `m_next_obj` instead. */
+struct arena {
+    arena *   m_prev{nullptr};
+    /* Sampling counter of the enclosing arena or of the heap, see `heap::m_bytes_until_sample`. */
+    int64_t   m_bytes_until_sample{INT64_MAX};
+    bool      m_escaped{false};
+    /* Number of objects allocated in the arena, it bounds the walk of `move_out_of_arena`. */
+    uint64_t  m_num_allocs{0};
+    /* Number of objects of the arena freed while it was the innermost active arena. */
+    uint64_t  m_num_frees{0};
+    /* Memory chunks of LEAN_ARENA_CHUNK_SIZE bytes, sorted by address. */
+    std::vector<char *> m_chunks;
+    char *    m_next_page_mem{nullptr};
+    char *    m_chunk_end{nullptr};
+    /* Current page of each slot, and where its next object is allocated. */
+    page *    m_curr_page[LEAN_NUM_SLOTS];
+    char *    m_next_obj[LEAN_NUM_SLOTS];
+    /* Objects of each slot freed while the arena was active. */
+    void *    m_free_list[LEAN_NUM_SLOTS];
+    arena() {
+        for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+            m_curr_page[i] = nullptr;
+            m_next_obj[i]  = nullptr;
+            m_free_list[i] = nullptr;
+        }
+    }
+    bool contains(void * o) const {
+        char * c = static_cast<char *>(o);
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), c);
+        return it != m_chunks.begin() && c < *(it - 1) + LEAN_ARENA_CHUNK_SIZE;
+    }
+};
+
 LEAN_THREAD_GLOBAL_PTR(page *, g_curr_pages);
 LEAN_THREAD_PTR(heap, g_heap);
 static heap_manager * g_heap_manager = nullptr;
@@ -202,10 +288,10 @@ void page::push_free_obj(void * o) {
     lean_assert(get_page_of(o) == this);
     set_next_obj(o, m_header.m_free_list);
     m_header.m_free_list = o;
-    m_header.m_num_free++;
+    set_num_free(get_num_free() + 1);
     if (!in_page_free_list() && has_many_free()) {
         heap * h = get_heap();
-        unsigned slot_idx = m_header.m_slot_idx;
+        unsigned slot_idx = get_slot_idx();
         if (this != h->m_curr_page[slot_idx]) {
             LEAN_RUNTIME_STAT_CODE(g_num_recycled_pages++);
             m_header.m_in_page_free_list = true;
@@ -213,15 +299,26 @@ void page::push_free_obj(void * o) {
             page_list_insert(h->m_page_free_list[slot_idx], this);
         }
     }
+    if (in_page_free_list() && is_empty()) {
+        /* Move the page to the cache of empty pages, it can be reused for any slot. */
+        heap * h = get_heap();
+        unsigned slot_idx = get_slot_idx();
+        LEAN_RUNTIME_STAT_CODE(g_num_cached_pages++);
+        m_header.m_in_page_free_list = false;
+        if (this == h->m_page_free_list[slot_idx])
+            page_list_pop(h->m_page_free_list[slot_idx]);
+        else
+            page_list_remove(h->m_page_free_list[slot_idx], this);
+        set_next(h->m_empty_pages);
+        h->m_empty_pages = this;
+    }
 }
 
 void heap::import_objs() {
-    void * to_import = nullptr;
-    {   // TODO(Leo): avoid mutex using compare and swap
-        lock_guard<mutex> lock(m_mutex);
-        to_import = m_to_import_list;
-        m_to_import_list = nullptr;
-    }
+    if (m_to_import_list == nullptr)
+        return;
+    LEAN_RUNTIME_STAT_CODE(g_num_imports++);
+    void * to_import = m_to_import_list.exchange(nullptr);
     while (to_import) {
         page * p = get_page_of(to_import);
         void * n = get_next_obj(to_import);
@@ -260,33 +357,89 @@ void heap::export_objs() {
     m_to_export_list      = nullptr;
     m_to_export_list_size = 0;
     for (export_entry const & e : to_export) {
-        unique_lock<mutex> lock(e.m_heap->m_mutex);
-        set_next_obj(e.m_tail, e.m_heap->m_to_import_list);
-        e.m_heap->m_to_import_list = e.m_head;
+        void * head = e.m_heap->m_to_import_list;
+        do {
+            set_next_obj(e.m_tail, head);
+        } while (!e.m_heap->m_to_import_list.compare_exchange_strong(head, e.m_head));
+    }
+}
+
+/* Huge page support for segments, controlled by the environment variable `LEAN_HUGE_PAGES`:
+   - `0` or unset: segments are allocated using `new`.
+   - `1`: segments are mapped with `mmap` and `madvise(MADV_HUGEPAGE)` asks the kernel to back them
+     with transparent huge pages.
+   - `2`: we first try an explicit `MAP_HUGETLB` mapping, and fall back to `1` if no huge pages
+     are reserved. */
+static unsigned g_huge_pages = 0;
+
+#ifdef LEAN_HUGE_PAGE_SUPPORT
+static void * alloc_huge_segment_mem() {
+    size_t sz = lean_align(sizeof(segment), LEAN_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+    if (g_huge_pages >= 2) {
+        void * r = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (r != MAP_FAILED) {
+            LEAN_RUNTIME_STAT_CODE(g_num_huge_segments++);
+            return r;
+        }
+    }
+#endif
+    /* Over-allocate so that we can align the segment to a huge page boundary. */
+    size_t map_sz = sz + LEAN_HUGE_PAGE_SIZE;
+    char * r = static_cast<char *>(mmap(nullptr, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (r == MAP_FAILED)
+        return nullptr;
+    char * begin = align_ptr(r, LEAN_HUGE_PAGE_SIZE);
+    if (begin > r)
+        munmap(r, begin - r);
+    if (begin + sz < r + map_sz)
+        munmap(begin + sz, (r + map_sz) - (begin + sz));
+#ifdef MADV_HUGEPAGE
+    if (madvise(begin, sz, MADV_HUGEPAGE) == 0) {
+        LEAN_RUNTIME_STAT_CODE(g_num_huge_segments++);
     }
+#endif
+    return begin;
 }
+#endif
 
 void heap::alloc_segment() {
     LEAN_RUNTIME_STAT_CODE(g_num_segments++);
-    segment * s = new segment();
-    s->m_next   = m_curr_segment;
-    m_curr_segment = s;
+    segment * s = nullptr;
+#ifdef LEAN_HUGE_PAGE_SUPPORT
+    if (g_huge_pages) {
+        if (void * mem = alloc_huge_segment_mem())
+            s = new (mem) segment();
+    }
+#endif
+    if (!s)
+        s = new segment();
+    notify_heap_growth();
+    s->m_next   = m_curr_segment.load(memory_order_relaxed);
+    m_curr_segment.store(s, memory_order_release);
 }
 
 static page * alloc_page(heap * h, unsigned obj_size) {
     lean_assert(lean_align(obj_size, LEAN_OBJECT_SIZE_DELTA) == obj_size);
-    segment * s = h->m_curr_segment;
-    LEAN_RUNTIME_STAT_CODE(g_num_pages++);
-    page * p    = new (s->m_next_page_mem) page();
-    s->m_next_page_mem += LEAN_PAGE_SIZE;
-    if (s->is_full()) {
-        /* s is full, we need to allocate a new one. */
-        h->alloc_segment();
+    page * p;
+    if (h->m_empty_pages) {
+        LEAN_RUNTIME_STAT_CODE(g_num_reused_pages++);
+        p = page_list_pop(h->m_empty_pages);
+    } else {
+        segment * s = h->m_curr_segment.load(memory_order_relaxed);
+        LEAN_RUNTIME_STAT_CODE(g_num_pages++);
+        char * mem = s->m_next_page_mem.load(memory_order_relaxed);
+        p = new (mem) page();
+        s->m_next_page_mem.store(mem + LEAN_PAGE_SIZE, memory_order_relaxed);
+        if (s->is_full()) {
+            /* s is full, we need to allocate a new one. */
+            h->alloc_segment();
+        }
     }
     unsigned slot_idx        = lean_get_slot_idx(obj_size);
     p->m_header.m_heap       = h;
     page_list_insert(h->m_curr_page[slot_idx], p);
-    p->m_header.m_slot_idx   = slot_idx;
+    p->set_slot_idx(slot_idx);
     p->m_header.m_obj_size   = obj_size;
     char * curr_free         = p->m_data;
     set_next_obj(curr_free, nullptr);
@@ -312,12 +465,40 @@ static page * alloc_page(heap * h, unsigned obj_size) {
             lean_assert(n == num_free);
 #endif
     p->m_header.m_free_list  = curr_free;
-    p->m_header.m_max_free   = num_free;
-    p->m_header.m_num_free   = num_free;
+    p->set_max_free(num_free);
+    p->set_num_free(num_free);
     p->m_header.m_in_page_free_list = false;
     return p;
 }
 
+/* Add the pages of all segments of `h` to `r`. We traverse segments instead of the page lists
+   since the latter may be modified concurrently by the owner of `h`. */
+static void collect_heap_stats(heap * h, small_alloc_stats & r) {
+    r.m_num_heaps++;
+    for (segment * s = h->m_curr_segment.load(memory_order_acquire); s != nullptr; s = s->m_next) {
+        r.m_num_segments++;
+        char * end = s->m_next_page_mem.load(memory_order_relaxed);
+        for (char * it = s->get_first_page_mem(); it < end; it += LEAN_PAGE_SIZE) {
+            page const * pg = reinterpret_cast<page *>(it);
+            unsigned slot_idx = pg->get_slot_idx();
+            unsigned num_free = pg->get_num_free();
+            unsigned max_free = pg->get_max_free();
+            if (slot_idx >= LEAN_NUM_SLOTS || num_free > max_free)
+                continue; /* page is being initialized by its owner */
+            if (num_free == max_free) {
+                r.m_num_empty_pages++;
+                continue;
+            }
+            small_alloc_slot_stats & st = r.m_slots[slot_idx];
+            st.m_num_pages++;
+            st.m_live_bytes += static_cast<uint64_t>(max_free - num_free) * st.m_obj_size;
+            st.m_free_bytes += static_cast<uint64_t>(num_free) * st.m_obj_size;
+            if (num_free > 0)
+                st.m_num_partial_pages++;
+        }
+    }
+}
+
 static void finalize_heap(void * _h) {
     heap * h = static_cast<heap*>(_h);
     h->export_objs();
@@ -333,6 +514,9 @@ static void init_heap(bool main) {
         g_heap = h;
     } else {
         g_heap = new heap();
+        if (size_t rate = get_alloc_sample_rate())
+            g_heap->m_bytes_until_sample = rate;
+        g_heap_manager->push_heap(g_heap);
         g_curr_pages = g_heap->m_curr_page;
         for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
             g_heap->m_curr_page[i] = nullptr;
@@ -373,20 +557,83 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
     void * r = p->m_header.m_free_list;
     lean_assert(r);
     p->m_header.m_free_list = get_next_obj(r);
-    p->m_header.m_num_free--;
+    p->set_num_free(p->get_num_free() - 1);
     lean_assert(get_page_of(r) == p);
     return r;
 }
 
+LEAN_NOINLINE
+static void sample_alloc(heap * h, size_t sz) {
+    if (arena * a = h->m_arena) {
+        h->m_bytes_until_sample = -1;
+        a->m_bytes_until_sample -= sz;
+        if (a->m_bytes_until_sample >= 0)
+            return;
+        a->m_bytes_until_sample = get_alloc_sample_rate();
+    } else {
+        h->m_bytes_until_sample = get_alloc_sample_rate();
+    }
+    record_alloc_sample(sz);
+}
+
+static page * arena_alloc_page(arena * a, unsigned sz, unsigned slot_idx) {
+    if (a->m_next_page_mem == nullptr || a->m_next_page_mem + LEAN_PAGE_SIZE > a->m_chunk_end) {
+        /* Pages are aligned, so the first one starts at the first page boundary of the chunk. */
+        char * c = static_cast<char *>(malloc(LEAN_ARENA_CHUNK_SIZE));
+        if (c == nullptr) lean_internal_panic_out_of_memory();
+        a->m_chunks.insert(std::upper_bound(a->m_chunks.begin(), a->m_chunks.end(), c), c);
+        a->m_next_page_mem = align_ptr(c, LEAN_PAGE_SIZE);
+        a->m_chunk_end     = c + LEAN_ARENA_CHUNK_SIZE;
+    }
+    page * p = new (a->m_next_page_mem) page();
+    a->m_next_page_mem += LEAN_PAGE_SIZE;
+    p->m_header.m_heap     = nullptr;
+    p->m_header.m_next     = nullptr;
+    p->m_header.m_prev     = nullptr;
+    p->m_header.m_free_list = nullptr;
+    p->m_header.m_obj_size = sz;
+    p->set_max_free(0);
+    p->set_num_free(0);
+    p->set_slot_idx(slot_idx);
+    p->m_header.m_in_page_free_list = false;
+    a->m_curr_page[slot_idx] = p;
+    a->m_next_obj[slot_idx]  = p->m_data;
+    return p;
+}
+
+LEAN_NOINLINE
+static void * arena_alloc(arena * a, unsigned sz, unsigned slot_idx) {
+    a->m_num_allocs++;
+    if (void * r = a->m_free_list[slot_idx]) {
+        a->m_free_list[slot_idx] = get_next_obj(r);
+        return r;
+    }
+    char * r   = a->m_next_obj[slot_idx];
+    page * p   = a->m_curr_page[slot_idx];
+    if (p == nullptr || r + sz > reinterpret_cast<char *>(p) + LEAN_PAGE_SIZE) {
+        arena_alloc_page(a, sz, slot_idx);
+        r = a->m_next_obj[slot_idx];
+    }
+    a->m_next_obj[slot_idx] = r + sz;
+    lean_assert(get_page_of(r) == a->m_curr_page[slot_idx]);
+    return r;
+}
+
 extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
     page * p = g_heap->m_curr_page[slot_idx];
     g_heap->m_heartbeat++;
+    g_heap->m_bytes_until_sample -= sz;
+    if (LEAN_UNLIKELY(g_heap->m_bytes_until_sample < 0)) {
+        sample_alloc(g_heap, sz);
+        if (g_heap->m_arena)
+            return arena_alloc(g_heap->m_arena, sz, slot_idx);
+    }
     void * r = p->m_header.m_free_list;
     if (LEAN_UNLIKELY(r == nullptr)) {
         return lean_alloc_small_cold(sz, slot_idx, p);
     }
     p->m_header.m_free_list = get_next_obj(r);
-    p->m_header.m_num_free--;
+    p->set_num_free(p->get_num_free() - 1);
     lean_assert(get_page_of(r) == p);
     return r;
 }
@@ -408,6 +655,11 @@ void * alloc(size_t sz) {
     sz = lean_align(sz, LEAN_OBJECT_SIZE_DELTA);
     LEAN_RUNTIME_STAT_CODE(g_num_alloc++);
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
+        if (g_heap) {
+            g_heap->m_bytes_until_sample -= sz;
+            if (LEAN_UNLIKELY(g_heap->m_bytes_until_sample < 0))
+                sample_alloc(g_heap, sz);
+        }
         void * r = malloc(sz);
         if (r == nullptr) lean_internal_panic_out_of_memory();
         return r;
@@ -420,6 +672,18 @@ void * alloc(size_t sz) {
 
 LEAN_NOINLINE
 static void dealloc_small_core_cold(void * o) {
+    page * p = get_page_of(o);
+    if (p->get_heap() == nullptr) {
+        /* Object of an arena, its memory is released together with the arena. */
+        arena * a = g_heap->m_arena;
+        if (a && a->contains(o)) {
+            unsigned slot_idx = p->get_slot_idx();
+            set_next_obj(o, a->m_free_list[slot_idx]);
+            a->m_free_list[slot_idx] = o;
+            a->m_num_frees++;
+        }
+        return;
+    }
     set_next_obj(o, g_heap->m_to_export_list);
     g_heap->m_to_export_list = o;
     g_heap->m_to_export_list_size++;
@@ -461,7 +725,110 @@ extern "C" LEAN_EXPORT unsigned lean_small_mem_size(void * o) {
     return p->m_header.m_obj_size;
 }
 
+void get_small_alloc_stats(bool global, small_alloc_stats & r) {
+    r.m_slots.clear();
+    r.m_slots.resize(LEAN_NUM_SLOTS);
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++)
+        r.m_slots[i].m_obj_size = (i + 1) * LEAN_OBJECT_SIZE_DELTA;
+    if (global) {
+        for (heap * h : g_heap_manager->get_heaps())
+            collect_heap_stats(h, r);
+    } else if (g_heap) {
+        collect_heap_stats(g_heap, r);
+    }
+}
+
+void push_arena() {
+    if (LEAN_UNLIKELY(g_heap == nullptr)) {
+        init_heap(false);
+    }
+    arena * a = new arena();
+    a->m_prev = g_heap->m_arena;
+    if (a->m_prev) {
+        a->m_bytes_until_sample = a->m_prev->m_bytes_until_sample;
+    } else {
+        a->m_bytes_until_sample = g_heap->m_bytes_until_sample;
+    }
+    g_heap->m_arena = a;
+    g_heap->m_bytes_until_sample = -1;
+}
+
+arena * pop_arena() {
+    arena * a = g_heap->m_arena;
+    lean_assert(a);
+    g_heap->m_arena = a->m_prev;
+    if (a->m_prev) {
+        a->m_prev->m_bytes_until_sample = a->m_bytes_until_sample;
+    } else {
+        g_heap->m_bytes_until_sample = a->m_bytes_until_sample;
+    }
+    return a;
+}
+
+bool arena_contains(arena * a, void * o) {
+    return a->contains(o);
+}
+
+void mark_arena_escaped() {
+    if (g_heap) {
+        for (arena * a = g_heap->m_arena; a != nullptr; a = a->m_prev)
+            a->m_escaped = true;
+    }
+}
+
+bool arena_escaped(arena * a) {
+    return a->m_escaped;
+}
+
+uint64_t arena_num_allocs(arena * a) {
+    return a->m_num_allocs;
+}
+
+uint64_t arena_num_live_objects(arena * a) {
+    return a->m_num_allocs - a->m_num_frees;
+}
+
+bool has_active_arena() {
+    return g_heap && g_heap->m_arena;
+}
+
+bool in_active_arena(void * o) {
+    if (g_heap) {
+        for (arena * a = g_heap->m_arena; a != nullptr; a = a->m_prev)
+            if (a->contains(o))
+                return true;
+    }
+    return false;
+}
+
+arena * suspend_arenas() {
+    arena * a = g_heap ? g_heap->m_arena : nullptr;
+    if (a) {
+        g_heap->m_arena = nullptr;
+        g_heap->m_bytes_until_sample = a->m_bytes_until_sample;
+    }
+    return a;
+}
+
+void resume_arenas(arena * a) {
+    if (a) {
+        lean_assert(g_heap->m_arena == nullptr);
+        a->m_bytes_until_sample = g_heap->m_bytes_until_sample;
+        g_heap->m_arena = a;
+        g_heap->m_bytes_until_sample = -1;
+    }
+}
+
+void delete_arena(arena * a) {
+    for (char * c : a->m_chunks)
+        free(c);
+    delete a;
+}
+
 void initialize_alloc() {
+    if (char const * huge_pages = std::getenv("LEAN_HUGE_PAGES"))
+        g_huge_pages = atoi(huge_pages);
+    initialize_alloc_sampler();
     g_heap_manager = new heap_manager();
     init_heap(true);
 }
@@ -7,12 +7,91 @@ Author: Leonardo de Moura
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <vector>
 
 namespace lean {
+namespace allocator { struct arena; }
+using allocator::arena;
+
 void init_thread_heap();
 void * alloc(size_t sz);
 void dealloc(void * o, size_t sz);
 uint64_t get_num_heartbeats();
+
+/* Memory usage of one size class of the small object allocator. */
+struct small_alloc_slot_stats {
+    unsigned m_obj_size{0};
+    uint64_t m_live_bytes{0};
+    uint64_t m_free_bytes{0};
+    uint64_t m_num_pages{0};
+    /* Pages that are neither full nor empty. */
+    uint64_t m_num_partial_pages{0};
+};
+
+struct small_alloc_stats {
+    std::vector<small_alloc_slot_stats> m_slots;
+    /* Pages without live objects, they can be reused by any size class. */
+    uint64_t m_num_empty_pages{0};
+    uint64_t m_num_segments{0};
+    uint64_t m_num_heaps{0};
+};
+
+/* Collect memory usage statistics of the small object allocator for the heap of the current thread,
+   or for all heaps if `global` is true. Statistics of other threads' heaps are approximate if
+   those threads are allocating concurrently. */
+void get_small_alloc_stats(bool global, small_alloc_stats & r);
+
+/* Arenas of the small object allocator, see `lean_io_with_arena`. While an arena is active,
+   small objects allocated by the current thread are bump allocated in the pages of the arena,
+   and freeing them only makes their memory available to later allocations in the same arena.
+   Arenas can be nested, `pop_arena` returns the innermost one. */
+void push_arena();
+arena * pop_arena();
+/* Return true if `o` is a small object allocated in `a`. */
+bool arena_contains(arena * a, void * o);
+/* Objects of the active arenas of the current thread may be referenced by another thread, e.g., by a task.
+   Escaped arenas are never released. */
+void mark_arena_escaped();
+bool arena_escaped(arena * a);
+/* Number of objects allocated in `a` so far. */
+uint64_t arena_num_allocs(arena * a);
+/* Upper bound on the number of allocations of `a` that have not been freed yet. Objects freed while `a` was not the
+   innermost active arena of the current thread are still counted. */
+uint64_t arena_num_live_objects(arena * a);
+/* Release all objects of `a`. */
+void delete_arena(arena * a);
+/* Return true if the current thread has an active arena. */
+bool has_active_arena();
+/* Return true if `o` is an object of one of the active arenas of the current thread. */
+bool in_active_arena(void * o);
+/* Deactivate the arenas of the current thread, so that the following allocations use the heap. Return the innermost
+   arena, to be passed to `resume_arenas`. */
+arena * suspend_arenas();
+void resume_arenas(arena * a);
+
+/* Allocate from the heap while this object is alive, for objects that are stored in global data structures such as
+   closed terms and thunk values, which outlive the arenas of the current thread. */
+class scoped_no_arena {
+    arena * m_arena;
+public:
+    scoped_no_arena():m_arena(suspend_arenas()) {}
+    ~scoped_no_arena() { resume_arenas(m_arena); }
+};
+
+/* Push an arena while this object is alive. The arena is returned by `release`. If the object is destroyed before,
+   i.e., an exception was thrown, the arena is popped and kept alive, as its objects may still be referenced. */
+class scoped_arena {
+    bool m_active;
+public:
+    scoped_arena():m_active(true) { push_arena(); }
+    ~scoped_arena() {
+        if (m_active) {
+            mark_arena_escaped();
+            pop_arena();
+        }
+    }
+    arena * release() { m_active = false; return pop_arena(); }
+};
 void initialize_alloc();
 void finalize_alloc();
 }
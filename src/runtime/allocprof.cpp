@@ -4,7 +4,21 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
 #include "runtime/allocprof.h"
+#include "runtime/thread.h"
+#include "runtime/hash.h"
+
+#ifdef __GLIBC__
+#include <execinfo.h>
+#endif
+
+#define LEAN_ALLOC_SAMPLE_DEFAULT_RATE 512*1024 // 512 Kb
+#define LEAN_ALLOC_SAMPLE_MAX_FRAMES   64
+
 namespace lean {
 allocprof::allocprof(std::ostream & out, char const * msg):
     m_out(out), m_msg(msg) {
@@ -45,3 +59,84 @@ allocprof::~allocprof() {
 #endif
 }
 }
+
+namespace lean {
+typedef std::vector<void *> alloc_stack;
+
+struct alloc_stack_hash {
+    size_t operator()(alloc_stack const & s) const {
+        return hash_str(s.size() * sizeof(void *), reinterpret_cast<unsigned char const *>(s.data()), 31);
+    }
+};
+
+struct alloc_sample {
+    uint64 m_count{0};
+    uint64 m_bytes{0};
+};
+
+static size_t        g_alloc_sample_rate  = 0;
+static char const *  g_alloc_profile_file = nullptr;
+static mutex *       g_alloc_samples_mutex = nullptr;
+static std::unordered_map<alloc_stack, alloc_sample, alloc_stack_hash> * g_alloc_samples = nullptr;
+
+size_t get_alloc_sample_rate() {
+    return g_alloc_sample_rate;
+}
+
+void record_alloc_sample(size_t sz) {
+    if (!g_alloc_samples)
+        return;
+    alloc_stack stack;
+#ifdef __GLIBC__
+    void * buf[LEAN_ALLOC_SAMPLE_MAX_FRAMES];
+    int n = backtrace(buf, LEAN_ALLOC_SAMPLE_MAX_FRAMES);
+    /* skip `record_alloc_sample` and `sample_alloc` */
+    int skip = n > 2 ? 2 : 0;
+    stack.assign(buf + skip, buf + n);
+#endif
+    lock_guard<mutex> lock(*g_alloc_samples_mutex);
+    alloc_sample & s = (*g_alloc_samples)[stack];
+    s.m_count++;
+    s.m_bytes += sz;
+}
+
+static void dump_alloc_samples() {
+    std::ofstream out(g_alloc_profile_file);
+    if (!out) {
+        std::cerr << "failed to write allocation profile to '" << g_alloc_profile_file << "'\n";
+        return;
+    }
+    lock_guard<mutex> lock(*g_alloc_samples_mutex);
+    uint64 total_count = 0, total_bytes = 0;
+    for (auto const & e : *g_alloc_samples) {
+        total_count += e.second.m_count;
+        total_bytes += e.second.m_bytes;
+    }
+    /* We do not track deallocations, so the "in use" part of the profile is always empty. */
+    out << "heap profile: 0: 0 [" << total_count << ": " << total_bytes << "] @ heap_v2/" << g_alloc_sample_rate << "\n";
+    for (auto const & e : *g_alloc_samples) {
+        out << " 0: 0 [" << e.second.m_count << ": " << e.second.m_bytes << "] @";
+        for (void * pc : e.first)
+            out << " " << pc;
+        out << "\n";
+    }
+    out << "\nMAPPED_LIBRARIES:\n";
+    std::ifstream maps("/proc/self/maps");
+    if (maps)
+        out << maps.rdbuf();
+}
+
+void initialize_alloc_sampler() {
+    g_alloc_profile_file = std::getenv("LEAN_ALLOC_PROFILE");
+    if (!g_alloc_profile_file)
+        return;
+    g_alloc_sample_rate = LEAN_ALLOC_SAMPLE_DEFAULT_RATE;
+    if (char const * rate = std::getenv("LEAN_ALLOC_PROFILE_RATE")) {
+        if (atol(rate) > 0)
+            g_alloc_sample_rate = atol(rate);
+    }
+    g_alloc_samples_mutex = new mutex();
+    g_alloc_samples       = new std::unordered_map<alloc_stack, alloc_sample, alloc_stack_hash>();
+    std::atexit(dump_alloc_samples);
+}
+}
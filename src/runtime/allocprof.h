@@ -26,4 +26,15 @@ public:
     allocprof(std::ostream & out, char const * msg);
     ~allocprof();
 };
+
+/* Sampling allocation profiler, it does not require `RUNTIME_STATS=ON`.
+   It is enabled by setting the environment variable `LEAN_ALLOC_PROFILE` to the name of an output file.
+   Whenever a thread has allocated `LEAN_ALLOC_PROFILE_RATE` bytes (default: 512Kb) since its last sample,
+   we record the stack trace of the current allocation. When the process exits, the samples are written
+   to the output file using the legacy heap profile format understood by `pprof`. */
+void initialize_alloc_sampler();
+/* Return the sampling rate in bytes, or 0 if the sampling profiler is disabled. */
+size_t get_alloc_sample_rate();
+/* Record a sample for an allocation of `sz` bytes. */
+void record_alloc_sample(size_t sz);
 }
@@ -0,0 +1,292 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <deque>
+#include <memory>
+#include <lean/lean.h>
+#include "runtime/channel.h"
+#include "runtime/io.h"
+#include "runtime/object.h"
+#include "runtime/thread.h"
+
+namespace lean {
+extern "C" obj_res lean_io_promise_new(obj_arg);
+extern "C" obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg promise, obj_arg);
+
+/*
+Runtime support for `IO.BoundedChannel`.
+
+Messages are stored in a bounded multi-producer multi-consumer ring buffer (D. Vyukov's queue):
+every cell has a sequence number telling whether it is ready for the producer or the consumer of
+a given position, so producers and consumers only contend on the counter they increment with
+compare-and-swap, and sending and receiving do not take any lock while the buffer is neither
+full nor empty.
+
+Consumers that find the buffer empty register a promise under `m_mutex`, and producers that find
+it full wait on `m_not_full`. The counters `m_num_consumers` and `m_num_producers` allow the other
+side to skip the mutex when nobody is waiting. Lost wakeups are impossible since a waiting thread
+increments its counter before retrying under the mutex, and the other side updates the buffer
+before reading the counter, with sequentially consistent fences in between.
+
+Messages are marked as multi-threaded when they are sent.
+*/
+struct bounded_channel {
+    struct cell {
+        atomic<size_t> m_seq;
+        object *       m_value;
+    };
+    std::unique_ptr<cell[]> m_cells;
+    size_t                  m_mask;
+    atomic<size_t>          m_enqueue_pos{0};
+    atomic<size_t>          m_dequeue_pos{0};
+    atomic<bool>            m_closed{false};
+    mutex                   m_mutex;
+    condition_variable      m_not_full;
+    /* Promises of the consumers waiting for a message. */
+    std::deque<object *>    m_consumers;
+    atomic<unsigned>        m_num_consumers{0};
+    atomic<unsigned>        m_num_producers{0};
+
+    explicit bounded_channel(size_t capacity):m_cells(new cell[capacity]), m_mask(capacity - 1) {
+        for (size_t i = 0; i < capacity; i++)
+            m_cells[i].m_seq.store(i, memory_order_relaxed);
+    }
+
+    ~bounded_channel() {
+        object * v;
+        while (try_pop(v))
+            dec(v);
+        for (object * p : m_consumers) {
+            resolve(p, mk_option_none());
+            dec(p);
+        }
+    }
+
+    bool try_push(object * v) {
+        size_t pos = m_enqueue_pos.load(memory_order_relaxed);
+        cell * c;
+        while (true) {
+            c = &m_cells[pos & m_mask];
+            size_t seq = c->m_seq.load(memory_order_acquire);
+            intptr_t d = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (d == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (d < 0) {
+                /* full */
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(memory_order_relaxed);
+            }
+        }
+        c->m_value = v;
+        c->m_seq.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool try_pop(object * & v) {
+        size_t pos = m_dequeue_pos.load(memory_order_relaxed);
+        cell * c;
+        while (true) {
+            c = &m_cells[pos & m_mask];
+            size_t seq = c->m_seq.load(memory_order_acquire);
+            intptr_t d = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (d == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (d < 0) {
+                /* empty */
+                return false;
+            } else {
+                pos = m_dequeue_pos.load(memory_order_relaxed);
+            }
+        }
+        v = c->m_value;
+        c->m_seq.store(pos + m_mask + 1, memory_order_release);
+        return true;
+    }
+
+    static void resolve(object * promise, object * v) {
+        dec(lean_io_promise_resolve(v, promise, io_mk_world()));
+    }
+
+    /* Must be called after pushing a message. */
+    void notify_consumers() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (m_num_consumers.load(memory_order_relaxed) == 0)
+            return;
+        bool popped = false;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            object * v;
+            while (!m_consumers.empty() && try_pop(v)) {
+                object * p = m_consumers.front();
+                m_consumers.pop_front();
+                m_num_consumers--;
+                resolve(p, mk_option_some(v));
+                dec(p);
+                popped = true;
+            }
+        }
+        if (popped)
+            notify_producers();
+    }
+
+    /* Must be called after popping a message. */
+    void notify_producers() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (m_num_producers.load(memory_order_relaxed) != 0) {
+            lock_guard<mutex> lock(m_mutex);
+            m_not_full.notify_all();
+        }
+    }
+
+    void send(object * v) {
+        if (m_closed) {
+            dec(v);
+            return;
+        }
+        mark_mt(v);
+        if (!try_push(v)) {
+            m_num_producers++;
+            atomic_thread_fence(memory_order_seq_cst);
+            unique_lock<mutex> lock(m_mutex);
+            while (!try_push(v)) {
+                if (m_closed) {
+                    m_num_producers--;
+                    dec(v);
+                    return;
+                }
+                m_not_full.wait(lock);
+            }
+            m_num_producers--;
+        }
+        notify_consumers();
+    }
+
+    bool try_send(object * v) {
+        if (m_closed) {
+            dec(v);
+            return true;
+        }
+        mark_mt(v);
+        if (!try_push(v)) {
+            dec(v);
+            return false;
+        }
+        notify_consumers();
+        return true;
+    }
+
+    object * recv() {
+        object * v;
+        if (try_pop(v)) {
+            notify_producers();
+            return task_pure(mk_option_some(v));
+        }
+        unique_lock<mutex> lock(m_mutex);
+        m_num_consumers++;
+        atomic_thread_fence(memory_order_seq_cst);
+        if (try_pop(v)) {
+            m_num_consumers--;
+            lock.unlock();
+            notify_producers();
+            return task_pure(mk_option_some(v));
+        }
+        if (m_closed) {
+            m_num_consumers--;
+            return task_pure(mk_option_none());
+        }
+        object * r = lean_io_promise_new(io_mk_world());
+        object * p = lean_io_result_get_value(r);
+        inc(p);
+        dec(r);
+        inc(p);
+        m_consumers.push_back(p);
+        return p;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(m_mutex);
+        m_closed = true;
+        for (object * p : m_consumers) {
+            resolve(p, mk_option_none());
+            dec(p);
+        }
+        m_num_consumers -= static_cast<unsigned>(m_consumers.size());
+        m_consumers.clear();
+        m_not_full.notify_all();
+    }
+};
+
+static lean_external_class * g_bounded_channel_external_class = nullptr;
+
+static void bounded_channel_finalizer(void * h) {
+    delete static_cast<bounded_channel *>(h);
+}
+
+static void bounded_channel_foreach(void * h, b_obj_arg fn) {
+    bounded_channel * ch = static_cast<bounded_channel *>(h);
+    size_t end = ch->m_enqueue_pos.load();
+    for (size_t pos = ch->m_dequeue_pos.load(); pos != end; pos++) {
+        bounded_channel::cell & c = ch->m_cells[pos & ch->m_mask];
+        if (c.m_seq.load() != pos + 1)
+            continue;
+        inc(fn);
+        inc(c.m_value);
+        dec(apply_1(fn, c.m_value));
+    }
+}
+
+static bounded_channel * bounded_channel_get(b_obj_arg ch) {
+    return static_cast<bounded_channel *>(lean_get_external_data(ch));
+}
+
+/* BoundedChannel.new (capacity : @& Nat) : BaseIO (BoundedChannel α) */
+extern "C" LEAN_EXPORT obj_res lean_io_bounded_channel_new(b_obj_arg capacity, obj_arg) {
+    size_t n = 1;
+    if (is_scalar(capacity)) {
+        size_t k = unbox(capacity);
+        while (n < k && n < (static_cast<size_t>(1) << 24))
+            n *= 2;
+    } else {
+        n = static_cast<size_t>(1) << 24;
+    }
+    return io_result_mk_ok(lean_alloc_external(g_bounded_channel_external_class, new bounded_channel(n)));
+}
+
+/* BoundedChannel.capacity (ch : @& BoundedChannel α) : Nat */
+extern "C" LEAN_EXPORT obj_res lean_bounded_channel_capacity(b_obj_arg ch) {
+    return lean_usize_to_nat(bounded_channel_get(ch)->m_mask + 1);
+}
+
+/* BoundedChannel.send (v : α) (ch : @& BoundedChannel α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_bounded_channel_send(obj_arg v, b_obj_arg ch, obj_arg) {
+    bounded_channel_get(ch)->send(v);
+    return io_result_mk_ok(box(0));
+}
+
+/* BoundedChannel.trySend (v : α) (ch : @& BoundedChannel α) : BaseIO Bool */
+extern "C" LEAN_EXPORT obj_res lean_io_bounded_channel_try_send(obj_arg v, b_obj_arg ch, obj_arg) {
+    return io_result_mk_ok(box(bounded_channel_get(ch)->try_send(v)));
+}
+
+/* BoundedChannel.recv? (ch : @& BoundedChannel α) : BaseIO (Task (Option α)) */
+extern "C" LEAN_EXPORT obj_res lean_io_bounded_channel_recv(b_obj_arg ch, obj_arg) {
+    return io_result_mk_ok(bounded_channel_get(ch)->recv());
+}
+
+/* BoundedChannel.close (ch : @& BoundedChannel α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_bounded_channel_close(b_obj_arg ch, obj_arg) {
+    bounded_channel_get(ch)->close();
+    return io_result_mk_ok(box(0));
+}
+
+void initialize_channel() {
+    g_bounded_channel_external_class = lean_register_external_class(bounded_channel_finalizer, bounded_channel_foreach);
+}
+
+void finalize_channel() {
+}
+}
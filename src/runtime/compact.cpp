@@ -11,6 +11,7 @@ Author: Leonardo de Moura
 #include <cstring>
 #include <lean/lean.h>
 #include "runtime/hash.h"
+#include "runtime/thread.h"
 #include "runtime/compact.h"
 
 #ifndef LEAN_WINDOWS
@@ -19,6 +20,7 @@ Author: Leonardo de Moura
 
 #define LEAN_COMPACTOR_INIT_SZ 1024*1024
 #define LEAN_MAX_SHARING_TABLE_INITIAL_SIZE 1024*1024
+#define LEAN_COMPACTOR_CHUNK_SIZE 4*1024*1024
 
 // uncomment to track the number of each kind of object in an .olean file
 // #define LEAN_TAG_COUNTERS
@@ -61,7 +63,8 @@ object_compactor::object_compactor(void * base_addr):
     m_base_addr(base_addr),
     m_begin(malloc(LEAN_COMPACTOR_INIT_SZ)),
     m_end(m_begin),
-    m_capacity(static_cast<char*>(m_begin) + LEAN_COMPACTOR_INIT_SZ) {
+    m_capacity(static_cast<char*>(m_begin) + LEAN_COMPACTOR_INIT_SZ),
+    m_next_chunk_offset(LEAN_COMPACTOR_CHUNK_SIZE) {
 }
 
 object_compactor::~object_compactor() {
@@ -88,6 +91,12 @@ void * object_compactor::alloc(size_t sz) {
         free(m_begin);
         m_begin    = new_begin;
     }
+    if (size() >= m_next_chunk_offset) {
+        /* Remark: `save_max_sharing` may discard the object we are allocating by resetting `m_end`, but then
+           the next object is allocated at the same offset. */
+        m_chunk_offsets.push_back(size());
+        m_next_chunk_offset = size() + LEAN_COMPACTOR_CHUNK_SIZE;
+    }
     void * r = m_end;
     memset(r, 0, sz);
     m_end = static_cast<char*>(m_end) + sz;
@@ -95,12 +104,33 @@ void * object_compactor::alloc(size_t sz) {
     return r;
 }
 
+std::vector<size_t> object_compactor::chunk_offsets() const {
+    std::vector<size_t> r;
+    for (size_t offset : m_chunk_offsets) {
+        /* the last recorded object may have been discarded by `save_max_sharing` */
+        if (offset < size())
+            r.push_back(offset);
+    }
+    /* offsets of appended partitions are recorded out of order */
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+    return r;
+}
+
 void object_compactor::save(object * o, object * new_o) {
     lean_assert(m_begin <= new_o && new_o < m_end);
     m_obj_table.insert(std::make_pair(o, reinterpret_cast<object_offset>(reinterpret_cast<char*>(new_o) - reinterpret_cast<char*>(m_begin) + reinterpret_cast<size_t>(m_base_addr))));
 }
 
 void object_compactor::save_max_sharing(object * o, object * new_o, size_t new_o_sz) {
+    if (m_dictionary) {
+        if (object * d = m_dictionary->find(new_o, new_o_sz)) {
+            m_end = new_o;
+            // dictionary objects are referenced by their address
+            m_obj_table.insert(std::make_pair(o, d));
+            return;
+        }
+    }
     max_sharing_key k(reinterpret_cast<char*>(new_o) - reinterpret_cast<char*>(m_begin), new_o_sz);
     auto it = m_max_sharing_table->m_table.find(k);
     if (it != m_max_sharing_table->m_table.end()) {
@@ -109,6 +139,13 @@ void object_compactor::save_max_sharing(object * o, object * new_o, size_t new_o
     } else {
         m_max_sharing_table->m_table.insert(k);
     }
+    if (m_num_count_uses > 0) {
+        auto & u = m_uses[reinterpret_cast<char*>(new_o) - reinterpret_cast<char*>(m_begin)];
+        if (u.second != m_num_count_uses) {
+            u.first++;
+            u.second = m_num_count_uses;
+        }
+    }
     save(o, new_o);
 }
 
@@ -117,12 +154,18 @@ object_offset object_compactor::to_offset(object * o) {
         return o;
     } else {
         auto it = m_obj_table.find(o);
-        if (it == m_obj_table.end()) {
-            m_todo.push_back(o);
-            return g_null_offset;
-        } else {
+        if (it != m_obj_table.end())
             return it->second;
+        for (auto const & p : m_parts) {
+            auto it = p.first->m_obj_table.find(o);
+            if (it != p.first->m_obj_table.end()) {
+                // see `append`, references to dictionary objects are absolute
+                size_t offset = reinterpret_cast<size_t>(it->second);
+                return reinterpret_cast<object_offset>(offset < p.first->size() ? offset + p.second : offset);
+            }
         }
+        m_todo.push_back(o);
+        return g_null_offset;
     }
 }
 
@@ -320,10 +363,8 @@ tag_counter_manager g_tag_counter_manager;
 
 #endif
 
-void object_compactor::operator()(object * o) {
+void object_compactor::insert(object * o) {
     lean_assert(m_todo.empty());
-    // allocate for root address, see end of function
-    alloc(sizeof(object_offset));
     if (!lean_is_scalar(o)) {
         m_todo.push_back(o);
         while (!m_todo.empty()) {
@@ -354,22 +395,198 @@ void object_compactor::operator()(object * o) {
         }
         m_tmp.clear();
     }
+}
+
+void object_compactor::operator()(object * o) {
+    // allocate for root address, see end of function
+    alloc(sizeof(object_offset));
+    insert(o);
+    *static_cast<object_offset *>(m_begin) = to_offset(o);
+}
+
+/* Copy the objects compacted by `c` (with `nullptr` base address) to the end of this region and adjust their
+   references. */
+void object_compactor::append(std::unique_ptr<object_compactor> c) {
+    lean_assert(c->m_base_addr == nullptr);
+    size_t pos   = size();
+    size_t sz    = c->size();
+    char * begin = static_cast<char *>(alloc(sz));
+    memcpy(begin, c->m_begin, sz);
+    size_t delta = reinterpret_cast<size_t>(m_base_addr) + pos;
+    // references to dictionary objects are absolute
+    auto fix = [&](object * p) {
+        return lean_is_scalar(p) || reinterpret_cast<size_t>(p) >= sz ? p : reinterpret_cast<object *>(reinterpret_cast<size_t>(p) + delta);
+    };
+    char * next = begin;
+    char * end  = begin + sz;
+    while (next < end) {
+        object * curr = reinterpret_cast<object *>(next);
+        uint8 tag = lean_ptr_tag(curr);
+        size_t obj_sz;
+        if (tag <= LeanMaxCtorTag) {
+            object ** it = lean_ctor_obj_cptr(curr);
+            for (object ** it_end = it + lean_ctor_num_objs(curr); it != it_end; it++)
+                *it = fix(*it);
+            obj_sz = lean_object_byte_size(curr);
+        } else {
+            switch (tag) {
+            case LeanArray: {
+                object ** it = lean_array_cptr(curr);
+                for (object ** it_end = it + lean_array_size(curr); it != it_end; it++)
+                    *it = fix(*it);
+                obj_sz = lean_object_byte_size(curr);
+                break;
+            }
+            case LeanScalarArray:     obj_sz = lean_sarray_byte_size(curr); break;
+            case LeanString:          obj_sz = lean_string_byte_size(curr); break;
+            case LeanMPZ:
+#ifdef LEAN_USE_GMP
+                to_mpz(curr)->m_value.m_val[0]._mp_d = reinterpret_cast<mp_limb_t *>(reinterpret_cast<size_t>(to_mpz(curr)->m_value.m_val[0]._mp_d) + delta);
+                obj_sz = sizeof(mpz_object) + sizeof(mp_limb_t) * mpz_size(to_mpz(curr)->m_value.m_val);
+#else
+                to_mpz(curr)->m_value.m_digits = reinterpret_cast<mpn_digit *>(reinterpret_cast<size_t>(to_mpz(curr)->m_value.m_digits) + delta);
+                obj_sz = sizeof(mpz_object) + sizeof(mpn_digit) * to_mpz(curr)->m_value.m_size;
+#endif
+                break;
+            case LeanThunk:
+                lean_to_thunk(curr)->m_value = fix(lean_to_thunk(curr)->m_value);
+                obj_sz = sizeof(lean_thunk_object);
+                break;
+            case LeanRef:
+                lean_to_ref(curr)->m_value = fix(lean_to_ref(curr)->m_value);
+                obj_sz = sizeof(lean_ref_object);
+                break;
+            case LeanTask:
+                lean_to_task(curr)->m_value = fix(lean_to_task(curr)->m_value);
+                obj_sz = sizeof(lean_task_object);
+                break;
+            default:                  lean_unreachable();
+            }
+        }
+        next += lean_align(obj_sz, sizeof(void*));
+    }
+    if (sz > 0)
+        m_chunk_offsets.push_back(pos);
+    for (size_t offset : c->chunk_offsets())
+        m_chunk_offsets.push_back(pos + offset);
+    m_parts.emplace_back(std::move(c), delta);
+}
+
+void object_compactor::operator()(object * o, std::vector<std::vector<object *>> const & partitions) {
+    alloc(sizeof(object_offset));
+    std::vector<std::unique_ptr<object_compactor>> cs;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        cs.emplace_back(new object_compactor(nullptr));
+        cs.back()->set_dictionary(m_dictionary);
+    }
+    std::vector<std::unique_ptr<lthread>> threads;
+    for (size_t i = 1; i < partitions.size(); i++) {
+        threads.emplace_back(new lthread([&, i]() {
+            for (object * p : partitions[i])
+                cs[i]->insert(p);
+        }));
+    }
+    if (!partitions.empty()) {
+        for (object * p : partitions[0])
+            cs[0]->insert(p);
+    }
+    for (auto & th : threads)
+        th->join();
+    for (auto & c : cs)
+        append(std::move(c));
+    insert(o);
     *static_cast<object_offset *>(m_begin) = to_offset(o);
+    m_parts.clear();
 }
 
-compacted_region::compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data):
+void object_compactor::count_uses(object * o) {
+    if (size() == 0) {
+        // root slot, see `operator()`
+        alloc(sizeof(object_offset));
+        *static_cast<object_offset *>(m_begin) = box(0);
+    }
+    m_num_count_uses++;
+    insert(o);
+}
+
+std::vector<size_t> object_compactor::shared_offsets(unsigned min_uses) const {
+    std::vector<size_t> r;
+    for (auto const & u : m_uses) {
+        if (u.second.first >= min_uses)
+            r.push_back(u.first);
+    }
+    std::sort(r.begin(), r.end());
+    return r;
+}
+
+/* Return the size of the compacted object `o`, and store in `hash_sz` the size used by
+   `object_compactor::save_max_sharing` for it, or 0 if it is not subject to sharing. */
+static size_t compacted_object_size(object * o, size_t & hash_sz) {
+    uint8 tag = lean_ptr_tag(o);
+    size_t sz;
+    if (tag <= LeanMaxCtorTag) {
+        sz = hash_sz = lean_object_byte_size(o);
+    } else {
+        switch (tag) {
+        case LeanArray:       sz = hash_sz = sizeof(lean_array_object) + sizeof(void*) * lean_array_size(o); break;
+        case LeanScalarArray: sz = hash_sz = sizeof(lean_sarray_object) + lean_sarray_elem_size(o) * lean_sarray_size(o); break;
+        case LeanString:      sz = hash_sz = sizeof(lean_string_object) + lean_string_size(o); break;
+        case LeanMPZ:
+            // see `insert_mpz`, the size is stored in the header
+            sz = lean_object_byte_size(o);
+            hash_sz = 0;
+            break;
+        case LeanThunk: case LeanRef: case LeanTask:
+            sz = hash_sz = lean_object_byte_size(o);
+            break;
+        default:
+            lean_unreachable();
+        }
+    }
+    return lean_align(sz, sizeof(void*));
+}
+
+object_dictionary::object_dictionary(void * data, size_t sz):
+    m_begin(static_cast<char *>(data)), m_size(sz) {
+    char * next = m_begin + sizeof(object_offset);
+    char * end  = m_begin + sz;
+    while (next < end) {
+        object * o = reinterpret_cast<object *>(next);
+        size_t hash_sz;
+        next += compacted_object_size(o, hash_sz);
+        if (hash_sz > 0)
+            m_objects.insert(std::make_pair(hash_str(hash_sz, reinterpret_cast<unsigned char const *>(o), 17), o));
+    }
+}
+
+object * object_dictionary::find(void const * data, size_t sz) const {
+    auto range = m_objects.equal_range(hash_str(sz, static_cast<unsigned char const *>(data), 17));
+    for (auto it = range.first; it != range.second; ++it) {
+        size_t hash_sz;
+        compacted_object_size(it->second, hash_sz);
+        if (hash_sz == sz && memcmp(it->second, data, sz) == 0)
+            return it->second;
+    }
+    return nullptr;
+}
+
+compacted_region::compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data,
+                                   std::vector<size_t> chunk_offsets):
     m_base_addr(base_addr),
     m_is_mmap(is_mmap),
     m_free_data(free_data),
     m_begin(data),
     m_next(data),
-    m_end(static_cast<char*>(data)+sz) {
+    m_end(static_cast<char*>(data)+sz),
+    m_size(sz),
+    m_chunk_offsets(chunk_offsets) {
 }
 
 compacted_region::compacted_region(object_compactor const & c):
     m_begin(malloc(c.size())),
     m_next(m_begin),
-    m_end(static_cast<char*>(m_begin) + c.size()) {
+    m_end(static_cast<char*>(m_begin) + c.size()),
+    m_size(c.size()) {
     memcpy(m_begin, c.data(), c.size());
 }
 
@@ -379,6 +596,8 @@ compacted_region::~compacted_region() {
 
 inline object * compacted_region::fix_object_ptr(object * o) {
     if (lean_is_scalar(o)) return o;
+    // references outside of the region point into an `object_dictionary`, which is never relocated
+    if (reinterpret_cast<size_t>(o) - reinterpret_cast<size_t>(m_base_addr) >= m_size) return o;
     return reinterpret_cast<object*>(static_cast<char*>(m_begin) + (reinterpret_cast<size_t>(o) - reinterpret_cast<size_t>(m_base_addr)));
 }
 
@@ -390,11 +609,9 @@ inline void compacted_region::move(size_t d) {
     m_next = static_cast<char*>(m_next) + d;
 }
 
-inline void compacted_region::move(object * o) {
-    return move(lean_object_byte_size(o));
-}
+/* The `fix_*` procedures return the size of the object they relocated. */
 
-inline void compacted_region::fix_constructor(object * o) {
+inline size_t compacted_region::fix_constructor(object * o) {
     lean_assert(!lean_has_rc(o));
     object ** it  = lean_ctor_obj_cptr(o);
     object ** end = it + lean_ctor_num_objs(o);
@@ -402,44 +619,71 @@ inline void compacted_region::fix_constructor(object * o) {
         *it = fix_object_ptr(*it);
     }
     lean_assert(lean_object_byte_size(o) < 4192);
-    move(o);
+    return lean_object_byte_size(o);
 }
 
-inline void compacted_region::fix_array(object * o) {
+inline size_t compacted_region::fix_array(object * o) {
     object ** it  = lean_array_cptr(o);
     object ** end = it + lean_array_size(o);
     for (; it != end; it++) {
         *it = fix_object_ptr(*it);
     }
-    move(o);
+    return lean_object_byte_size(o);
 }
 
-inline void compacted_region::fix_thunk(object * o) {
+inline size_t compacted_region::fix_thunk(object * o) {
     lean_to_thunk(o)->m_value = fix_object_ptr(lean_to_thunk(o)->m_value);
-    move(sizeof(lean_thunk_object));
+    return sizeof(lean_thunk_object);
 }
 
-inline void compacted_region::fix_ref(object * o) {
+inline size_t compacted_region::fix_ref(object * o) {
     lean_to_ref(o)->m_value = fix_object_ptr(lean_to_ref(o)->m_value);
-    move(sizeof(lean_ref_object));
+    return sizeof(lean_ref_object);
 }
 
-inline void compacted_region::fix_task(object * o) {
+inline size_t compacted_region::fix_task(object * o) {
     lean_to_task(o)->m_value = fix_object_ptr(lean_to_task(o)->m_value);
-    move(sizeof(lean_task_object));
+    return sizeof(lean_task_object);
 }
 
-void compacted_region::fix_mpz(object * o) {
+size_t compacted_region::fix_mpz(object * o) {
 #ifdef LEAN_USE_GMP
     __mpz_struct & m = to_mpz(o)->m_value.m_val[0];
     m._mp_d = reinterpret_cast<mp_limb_t *>(static_cast<char *>(m_begin) + reinterpret_cast<size_t>(m._mp_d) - reinterpret_cast<size_t>(m_base_addr));
-    move(sizeof(mpz_object) + sizeof(mp_limb_t) * mpz_size(to_mpz(o)->m_value.m_val));
+    return sizeof(mpz_object) + sizeof(mp_limb_t) * mpz_size(to_mpz(o)->m_value.m_val);
 #else
     to_mpz(o)->m_value.m_digits = reinterpret_cast<mpn_digit*>(reinterpret_cast<char*>(o) + sizeof(mpz_object));
-    move(sizeof(mpz_object) + sizeof(mpn_digit) * to_mpz(o)->m_value.m_size);
+    return sizeof(mpz_object) + sizeof(mpn_digit) * to_mpz(o)->m_value.m_size;
 #endif
 }
 
+/* Relocate the objects in `[begin, end)`. `begin` must be the address of an object. */
+void compacted_region::relocate(char * begin, char * end) {
+    char * next = begin;
+    while (next < end) {
+        object * curr = reinterpret_cast<object*>(next);
+        uint8 tag = lean_ptr_tag(curr);
+        size_t sz;
+        if (tag <= LeanMaxCtorTag) {
+            sz = fix_constructor(curr);
+        } else {
+            switch (tag) {
+            case LeanClosure:         lean_unreachable();
+            case LeanArray:           sz = fix_array(curr); break;
+            case LeanScalarArray:     sz = lean_sarray_byte_size(curr); break;
+            case LeanString:          sz = lean_string_byte_size(curr); break;
+            case LeanMPZ:             sz = fix_mpz(curr); break;
+            case LeanThunk:           sz = fix_thunk(curr); break;
+            case LeanRef:             sz = fix_ref(curr); break;
+            case LeanTask:            sz = fix_task(curr); break;
+            case LeanExternal:        lean_unreachable();
+            default:                  lean_unreachable();
+            }
+        }
+        next += lean_align(sz, sizeof(void*));
+    }
+}
+
 object * compacted_region::read() {
     if (m_next == m_end)
         return nullptr; /* all objects have been read */
@@ -453,26 +697,33 @@ object * compacted_region::read() {
     }
     lean_assert(!m_is_mmap);
 
-    while (m_next < m_end) {
-        object * curr = reinterpret_cast<object*>(m_next);
-        uint8 tag = lean_ptr_tag(curr);
-        if (tag <= LeanMaxCtorTag) {
-            fix_constructor(curr);
-        } else {
-            switch (tag) {
-            case LeanClosure:         lean_unreachable();
-            case LeanArray:           fix_array(curr); break;
-            case LeanScalarArray:     move(lean_sarray_byte_size(curr)); break;
-            case LeanString:          move(lean_string_byte_size(curr)); break;
-            case LeanMPZ:             fix_mpz(curr); break;
-            case LeanThunk:           fix_thunk(curr); break;
-            case LeanRef:             fix_ref(curr); break;
-            case LeanTask:            fix_task(curr); break;
-            case LeanExternal:        lean_unreachable();
-            default:                  lean_unreachable();
-            }
+    /* chunk `i` is `[bounds[i], bounds[i+1])` */
+    std::vector<char *> bounds;
+    bounds.push_back(static_cast<char *>(m_next));
+    for (size_t offset : m_chunk_offsets) {
+        char * b = static_cast<char *>(m_begin) + offset;
+        if (bounds.back() < b && b < static_cast<char *>(m_end))
+            bounds.push_back(b);
+    }
+    bounds.push_back(static_cast<char *>(m_end));
+    unsigned num_chunks  = bounds.size() - 1;
+    unsigned num_threads = std::min(num_chunks, hardware_concurrency());
+    if (num_threads <= 1) {
+        relocate(bounds[0], bounds[num_chunks]);
+    } else {
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned t = 1; t < num_threads; t++) {
+            threads.emplace_back(new lthread([&, t]() {
+                for (unsigned i = t; i < num_chunks; i += num_threads)
+                    relocate(bounds[i], bounds[i+1]);
+            }));
         }
+        for (unsigned i = 0; i < num_chunks; i += num_threads)
+            relocate(bounds[i], bounds[i+1]);
+        for (auto & th : threads)
+            th->join();
     }
+    m_next = m_end;
     return root;
 }
 
@@ -13,6 +13,27 @@ Author: Leonardo de Moura
 namespace lean {
 typedef lean_object * object_offset;
 
+/* A compacted region of objects shared between several compacted regions. It must be used at the base address it was
+   compacted for, so that regions compacted against it (see `object_compactor::set_dictionary`) can reference its
+   objects directly. */
+class object_dictionary {
+    char * m_begin;
+    size_t m_size;
+    // content hash (as in `object_compactor::save_max_sharing`) to object
+    std::unordered_multimap<unsigned, object *> m_objects;
+public:
+    /* Index the objects of the compacted region `[data, data + sz)` (including its root slot). */
+    object_dictionary(void * data, size_t sz);
+    object_dictionary(object_dictionary const &) = delete;
+    object_dictionary & operator=(object_dictionary const &) = delete;
+    bool contains(void const * p) const {
+        return static_cast<size_t>(static_cast<char const *>(p) - m_begin) < m_size;
+    }
+    /* Return an object of the dictionary whose representation is `[data, data + sz)`, or `nullptr`. */
+    object * find(void const * data, size_t sz) const;
+    size_t num_objects() const { return m_objects.size(); }
+};
+
 class object_compactor {
     struct max_sharing_table;
     friend struct max_sharing_hash;
@@ -28,6 +49,18 @@ class object_compactor {
     void * m_begin;
     void * m_end;
     void * m_capacity;
+    // Offsets (relative to `m_begin`) of objects starting roughly every `LEAN_COMPACTOR_CHUNK_SIZE` bytes.
+    // They allow `compacted_region::read` to relocate chunks of the region in parallel.
+    std::vector<size_t> m_chunk_offsets;
+    size_t m_next_chunk_offset;
+    // Compactors of the partitions appended by `append`, and the offset that must be added to their offsets.
+    // Objects compacted by them are reused when reachable from the main graph.
+    std::vector<std::pair<std::unique_ptr<object_compactor>, size_t>> m_parts;
+    // Objects found in the dictionary are referenced instead of being copied, see `set_dictionary`.
+    object_dictionary const * m_dictionary = nullptr;
+    // Used by `count_uses`: the number of calls each compacted object (by offset) was used in, and the last one
+    std::unordered_map<size_t, std::pair<unsigned, unsigned>> m_uses;
+    unsigned m_num_count_uses = 0;
     size_t capacity() const { return static_cast<char*>(m_capacity) - static_cast<char*>(m_begin); }
     void save(object * o, object * new_o);
     void save_max_sharing(object * o, object * new_o, size_t new_o_sz);
@@ -43,6 +76,8 @@ class object_compactor {
     bool insert_task(object * o);
     bool insert_ref(object * o);
     void insert_mpz(object * o);
+    void insert(object * o);
+    void append(std::unique_ptr<object_compactor> c);
 public:
     object_compactor(void * base_addr = nullptr);
     object_compactor(object_compactor const &) = delete;
@@ -51,8 +86,22 @@ public:
     object_compactor operator=(object_compactor const &) = delete;
     object_compactor operator=(object_compactor &&) = delete;
     void operator()(object * o);
+    /* Compact `o` like `operator()`, but first compact the objects of each element of `partitions` in parallel,
+       each on a separate compactor, and append the results. Objects reachable from several partitions are
+       stored once per partition, so the result may be larger than the one produced by `operator()`. */
+    void operator()(object * o, std::vector<std::vector<object *>> const & partitions);
+    /* Reference objects of `d` instead of copying them when an object with the same representation would be
+       created. `d` must outlive the compacted region. */
+    void set_dictionary(object_dictionary const * d) { m_dictionary = d; }
+    /* Compact `o` (without setting the root) and count, for every compacted object, the number of `count_uses` calls
+       that used it. This is used to find objects shared between several modules. */
+    void count_uses(object * o);
+    /* Return the offsets of the objects used by at least `min_uses` calls to `count_uses`. */
+    std::vector<size_t> shared_offsets(unsigned min_uses) const;
     size_t size() const { return static_cast<char*>(m_end) - static_cast<char*>(m_begin); }
     void const * data() const { return m_begin; }
+    /* Return the offsets of object boundaries that split the compacted data into chunks. */
+    std::vector<size_t> chunk_offsets() const;
 };
 
 class compacted_region {
@@ -63,19 +112,24 @@ class compacted_region {
     void * m_begin;
     void * m_next;
     void * m_end;
+    size_t m_size;
+    // see `object_compactor::chunk_offsets`
+    std::vector<size_t> m_chunk_offsets;
     void move(size_t d);
-    void move(object * o);
     object * fix_object_ptr(object * o);
-    void fix_constructor(object * o);
-    void fix_array(object * o);
-    void fix_thunk(object * o);
-    void fix_ref(object * o);
-    void fix_task(object * o);
-    void fix_mpz(object * o);
+    size_t fix_constructor(object * o);
+    size_t fix_array(object * o);
+    size_t fix_thunk(object * o);
+    size_t fix_ref(object * o);
+    size_t fix_task(object * o);
+    size_t fix_mpz(object * o);
+    void relocate(char * begin, char * end);
 public:
     /* Creates a compacted object region using the given region in memory.
-       This object takes ownership of the region. */
-    compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data);
+       This object takes ownership of the region. If `chunk_offsets` are provided, relocation is performed
+       in parallel. */
+    compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data,
+                     std::vector<size_t> chunk_offsets = std::vector<size_t>());
     /* Creates a compacted object region using the object_compactor current state.
        It creates a copy of the compacted region generated by the object compactor. */
     explicit compacted_region(object_compactor const & c);
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include "runtime/compress.h"
+
+namespace lean {
+/*
+A compressed block is a sequence of sequences, each consisting of
+- a token byte: the high nibble is the number of literals, the low nibble the match length minus `LZ_MIN_MATCH`;
+  the value 15 in either nibble means that additional length bytes follow (each 255 means "add 255 and continue"),
+- the literal length extension bytes and the literals,
+- unless the input ends after the literals: a 2-byte little-endian match offset and the match length extension bytes.
+*/
+static size_t const   LZ_MIN_MATCH  = 4;
+static size_t const   LZ_MAX_OFFSET = 65535;
+static unsigned const LZ_HASH_BITS  = 16;
+
+static inline uint32_t lz_read32(char const * p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void lz_write_length(std::vector<char> & out, size_t len) {
+    while (len >= 255) {
+        out.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+}
+
+/* Emit `lit_len` literals starting at `lit`, followed by a match of length `match_len` at distance `offset`.
+   `match_len == 0` is only used for the final sequence. */
+static void lz_emit(std::vector<char> & out, char const * lit, size_t lit_len, size_t offset, size_t match_len) {
+    size_t ml = match_len == 0 ? 0 : match_len - LZ_MIN_MATCH;
+    out.push_back(static_cast<char>((std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(ml, 15)));
+    if (lit_len >= 15)
+        lz_write_length(out, lit_len - 15);
+    out.insert(out.end(), lit, lit + lit_len);
+    if (match_len != 0) {
+        out.push_back(static_cast<char>(offset & 0xff));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (ml >= 15)
+            lz_write_length(out, ml - 15);
+    }
+}
+
+void lz_compress(char const * src, size_t size, std::vector<char> & out) {
+    size_t anchor = 0;
+    if (size >= LZ_MIN_MATCH) {
+        std::vector<size_t> table(static_cast<size_t>(1) << LZ_HASH_BITS, 0);
+        size_t limit = size - LZ_MIN_MATCH;
+        size_t i     = 1;
+        while (i <= limit) {
+            uint32_t v    = lz_read32(src + i);
+            unsigned h    = lz_hash(v);
+            size_t cand   = table[h];
+            table[h]      = i;
+            if (i - cand <= LZ_MAX_OFFSET && lz_read32(src + cand) == v) {
+                size_t len = LZ_MIN_MATCH;
+                while (i + len < size && src[cand + len] == src[i + len])
+                    len++;
+                lz_emit(out, src + anchor, i - anchor, i - cand, len);
+                i     += len;
+                anchor = i;
+            } else {
+                // skip faster through incompressible data
+                i += 1 + ((i - anchor) >> 6);
+            }
+        }
+    }
+    lz_emit(out, src + anchor, size - anchor, 0, 0);
+}
+
+static inline bool lz_read_length(unsigned char const * & ip, unsigned char const * iend, size_t & len) {
+    while (true) {
+        if (ip == iend)
+            return false;
+        unsigned b = *ip++;
+        len += b;
+        if (b != 255)
+            return true;
+    }
+}
+
+bool lz_decompress(char const * src, size_t src_size, char * dst, size_t dst_size) {
+    unsigned char const * ip   = reinterpret_cast<unsigned char const *>(src);
+    unsigned char const * iend = ip + src_size;
+    char * op   = dst;
+    char * oend = dst + dst_size;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !lz_read_length(ip, iend, lit))
+            return false;
+        if (lit > static_cast<size_t>(iend - ip) || lit > static_cast<size_t>(oend - op))
+            return false;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t ml = token & 15;
+        if (ml == 15 && !lz_read_length(ip, iend, ml))
+            return false;
+        ml += LZ_MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || ml > static_cast<size_t>(oend - op))
+            return false;
+        char const * m = op - offset;
+        if (offset >= ml) {
+            memcpy(op, m, ml);
+        } else {
+            // overlapping match, e.g. a run of zeros
+            for (size_t k = 0; k < ml; k++)
+                op[k] = m[k];
+        }
+        op += ml;
+    }
+    return op == oend;
+}
+}
@@ -0,0 +1,18 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace lean {
+/* \brief Simple LZ77 block compressor tuned for compacted regions (many zero bytes and repeated headers).
+   Appends the compressed representation of `[src, src + size)` to `out`. Matches are restricted to the
+   current block, so blocks can be decompressed independently. */
+void lz_compress(char const * src, size_t size, std::vector<char> & out);
+
+/* \brief Decompress a block produced by `lz_compress` into `[dst, dst + dst_size)`.
+   Return `false` if the input is malformed or does not decompress to exactly `dst_size` bytes. */
+bool lz_decompress(char const * src, size_t src_size, char * dst, size_t dst_size);
+}
@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <vector>
+#include <unordered_map>
+#include <lean/lean.h>
+#include "runtime/concurrent_map.h"
+#include "runtime/io.h"
+#include "runtime/object.h"
+#include "runtime/thread.h"
+
+namespace lean {
+/*
+Runtime support for `IO.ConcurrentHashMap`.
+
+The map is split into a power-of-two number of shards, each guarded by its own mutex.
+A shard maps a 64-bit hash code to a *bucket*, an arbitrary Lean object (a `List (α × β)` on the Lean side).
+The runtime never inspects keys: lookups and updates are performed by Lean code on the bucket,
+so we only need to store, replace and hand out buckets while holding the lock of a single shard.
+Tasks accessing different shards never contend, unlike a cache stored in a single `IO.Ref`.
+
+Buckets are always marked as multi-threaded since the whole point of the map is to share them between tasks.
+*/
+struct concurrent_map {
+    struct shard {
+        mutex                                m_mutex;
+        std::unordered_map<uint64, object *> m_buckets;
+    };
+    std::vector<shard> m_shards;
+    uint64             m_mask;
+
+    explicit concurrent_map(unsigned num_shards):m_shards(num_shards), m_mask(num_shards - 1) {}
+
+    ~concurrent_map() {
+        for (shard & s : m_shards)
+            for (auto const & p : s.m_buckets)
+                dec(p.second);
+    }
+
+    shard & get_shard(uint64 h) {
+        // the low bits are used by `std::unordered_map`, so mix in the high bits as well
+        return m_shards[(h ^ (h >> 32)) & m_mask];
+    }
+};
+
+static lean_external_class * g_concurrent_map_external_class = nullptr;
+
+static void concurrent_map_finalizer(void * h) {
+    delete static_cast<concurrent_map *>(h);
+}
+
+static void concurrent_map_foreach(void * h, b_obj_arg fn) {
+    concurrent_map * m = static_cast<concurrent_map *>(h);
+    for (concurrent_map::shard & s : m->m_shards) {
+        unique_lock<mutex> lock(s.m_mutex);
+        for (auto const & p : s.m_buckets) {
+            inc(fn);
+            inc(p.second);
+            dec(apply_1(fn, p.second));
+        }
+    }
+}
+
+static concurrent_map * concurrent_map_get(b_obj_arg m) {
+    return static_cast<concurrent_map *>(lean_get_external_data(m));
+}
+
+/* ConcurrentHashMap.new (numShards : @& Nat) : BaseIO (ConcurrentHashMap α β) */
+extern "C" LEAN_EXPORT obj_res lean_io_concurrent_hash_map_new(b_obj_arg num_shards, obj_arg) {
+    unsigned n = 1;
+    if (is_scalar(num_shards)) {
+        size_t k = unbox(num_shards);
+        while (n < k && n < (1u << 16))
+            n *= 2;
+    } else {
+        n = 1u << 16;
+    }
+    return io_result_mk_ok(lean_alloc_external(g_concurrent_map_external_class, new concurrent_map(n)));
+}
+
+/* ConcurrentHashMap.getBucket (m : @& ConcurrentHashMap α β) (hash : UInt64) : BaseIO (List (α × β)) */
+extern "C" LEAN_EXPORT obj_res lean_io_concurrent_hash_map_get_bucket(b_obj_arg m, uint64 h, obj_arg) {
+    concurrent_map::shard & s = concurrent_map_get(m)->get_shard(h);
+    unique_lock<mutex> lock(s.m_mutex);
+    auto it = s.m_buckets.find(h);
+    if (it == s.m_buckets.end())
+        return io_result_mk_ok(box(0));
+    inc(it->second);
+    return io_result_mk_ok(it->second);
+}
+
+/* ConcurrentHashMap.modifyBucket (m : @& ConcurrentHashMap α β) (hash : UInt64)
+     (f : List (α × β) → List (α × β) × γ) : BaseIO γ
+
+   `f` is a pure function and is executed while holding the shard lock, so concurrent updates of the
+   same shard are serialized and no update is lost. An empty resulting bucket (`box(0)`) is removed. */
+extern "C" LEAN_EXPORT obj_res lean_io_concurrent_hash_map_modify_bucket(b_obj_arg m, uint64 h, obj_arg f, obj_arg) {
+    concurrent_map::shard & s = concurrent_map_get(m)->get_shard(h);
+    unique_lock<mutex> lock(s.m_mutex);
+    auto it = s.m_buckets.find(h);
+    object * bucket = box(0);
+    if (it != s.m_buckets.end()) {
+        bucket = it->second;
+        // give `f` the only reference so that it can update the bucket destructively
+        s.m_buckets.erase(it);
+    }
+    object * p   = apply_1(f, bucket);
+    object * nb  = cnstr_get(p, 0);
+    object * r   = cnstr_get(p, 1);
+    inc(nb);
+    inc(r);
+    dec(p);
+    if (is_scalar(nb)) {
+        dec(nb);
+    } else {
+        mark_mt(nb);
+        s.m_buckets.emplace(h, nb);
+    }
+    return io_result_mk_ok(r);
+}
+
+void initialize_concurrent_map() {
+    g_concurrent_map_external_class = lean_register_external_class(concurrent_map_finalizer, concurrent_map_foreach);
+}
+
+void finalize_concurrent_map() {
+}
+}
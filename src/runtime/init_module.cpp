@@ -12,6 +12,8 @@ Author: Leonardo de Moura
 #include "runtime/stack_overflow.h"
 #include "runtime/process.h"
 #include "runtime/mutex.h"
+#include "runtime/concurrent_map.h"
+#include "runtime/channel.h"
 
 namespace lean {
 extern "C" LEAN_EXPORT void lean_initialize_runtime_module() {
@@ -21,6 +23,8 @@ extern "C" LEAN_EXPORT void lean_initialize_runtime_module() {
     initialize_io();
     initialize_thread();
     initialize_mutex();
+    initialize_concurrent_map();
+    initialize_channel();
     initialize_process();
     initialize_stack_overflow();
 }
@@ -30,6 +34,8 @@ void initialize_runtime_module() {
 void finalize_runtime_module() {
     finalize_stack_overflow();
     finalize_process();
+    finalize_channel();
+    finalize_concurrent_map();
     finalize_mutex();
     finalize_thread();
     finalize_io();
@@ -5,18 +5,28 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <limits>
+#include <cstdlib>
 #include "runtime/thread.h"
 #include "runtime/interrupt.h"
 #include "runtime/exception.h"
 #include "runtime/memory.h"
+#include "runtime/object.h"
 
 namespace lean {
 LEAN_THREAD_VALUE(size_t, g_max_heartbeat, 0);
 LEAN_THREAD_VALUE(size_t, g_heartbeat, 0);
+/* `check_system` only performs its checks when `g_check_system_countdown` reaches zero, and then accounts for
+   the `g_check_system_batch` calls since the last time. See `get_check_system_interval`. */
+LEAN_THREAD_VALUE(unsigned, g_check_system_countdown, 1);
+LEAN_THREAD_VALUE(unsigned, g_check_system_batch, 1);
 
 void inc_heartbeat() { g_heartbeat++; }
 
-void reset_heartbeat() { g_heartbeat = 0; }
+void reset_heartbeat() {
+    g_heartbeat = 0;
+    g_check_system_countdown = 1;
+    g_check_system_batch     = 1;
+}
 
 void set_max_heartbeat(size_t max) { g_max_heartbeat = max; }
 
@@ -41,17 +51,48 @@ static bool interrupt_requested() {
     return g_interrupt_flag && g_interrupt_flag->load();
 }
 
+LEAN_THREAD_VALUE(bool, g_check_task_canceled, false);
+
+scoped_task_cancellation::scoped_task_cancellation() : flet(g_check_task_canceled, true) {}
+
 void check_interrupted() {
-    if (interrupt_requested() && !std::uncaught_exception()) {
+    if ((interrupt_requested() || (g_check_task_canceled && io_check_canceled_core())) && !std::uncaught_exception()) {
         throw interrupted();
     }
 }
 
-void check_system(char const * component_name) {
-    check_stack(component_name);
+/* Number of `check_system` calls checked together, set with the environment variable `LEAN_CHECK_SYSTEM_INTERVAL`.
+   By default, every call is checked. With a larger interval, interrupts, memory limits, and heartbeat limits are
+   detected up to `interval - 1` calls later, but heartbeat counts remain deterministic. */
+static unsigned get_check_system_interval() {
+    static unsigned interval = []() {
+        char const * s = std::getenv("LEAN_CHECK_SYSTEM_INTERVAL");
+        int n = s ? atoi(s) : 1;
+        return n > 0 ? static_cast<unsigned>(n) : 1u;
+    }();
+    return interval;
+}
+
+static void check_system_core(char const * component_name) {
+    unsigned batch = g_check_system_batch;
+    g_check_system_batch     = get_check_system_interval();
+    g_check_system_countdown = g_check_system_batch;
     check_memory(component_name);
     check_interrupted();
-    check_heartbeat();
+    g_heartbeat += batch;
+    if (g_max_heartbeat > 0 && g_heartbeat > g_max_heartbeat)
+        throw heartbeat_exception();
+#ifdef LEAN_LAZY_RC
+    free_deferred_objects(1024 * batch);
+#endif
+}
+
+void check_system(char const * component_name) {
+    /* The stack is always checked since running out of it is not recoverable. */
+    check_stack(component_name);
+    if (LEAN_LIKELY(--g_check_system_countdown != 0))
+        return;
+    check_system_core(component_name);
 }
 
 void sleep_for(unsigned ms, unsigned step_ms) {
@@ -47,7 +47,16 @@ struct scoped_interrupt_flag : flet<atomic_bool *> {
 };
 
 /**
-   \brief Throw an interrupted exception if the (interrupt) flag is set.
+   \brief Treat cancellation of the current task (see `IO.cancel`) as an interrupt while the object is alive.
+   Only use it around code whose callers handle the `interrupted` exception.
+*/
+struct scoped_task_cancellation : flet<bool> {
+    scoped_task_cancellation();
+};
+
+/**
+   \brief Throw an interrupted exception if the (interrupt) flag is set, or if the current task has been canceled
+   inside a `scoped_task_cancellation`.
 */
 void check_interrupted();
 
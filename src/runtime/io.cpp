@@ -13,6 +13,8 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #else
 #if defined(LEAN_EMSCRIPTEN)
 #include <emscripten.h>
@@ -20,10 +22,12 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 // Linux include files
 #include <unistd.h> // NOLINT
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/random.h>
 #endif
 #ifndef LEAN_WINDOWS
 #include <csignal>
+#include <poll.h>
 #endif
 #include <dirent.h>
 #include <fcntl.h>
@@ -36,6 +40,9 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include "util/io.h"
 #include "runtime/alloc.h"
 #include "runtime/io.h"
@@ -43,6 +50,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include "runtime/object.h"
 #include "runtime/thread.h"
 #include "runtime/allocprof.h"
+#include "runtime/memory.h"
 
 #ifdef _MSC_VER
 #define S_ISDIR(mode) ((mode & _S_IFDIR) != 0)
@@ -297,6 +305,165 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read(b_obj_arg h, usize nbyte
     }
 }
 
+/* Read up to `nbytes` from the file descriptor underlying `fp`, bypassing its buffer.
+   Returns an `Except IO.Error ByteArray`. */
+static obj_res handle_read_fd(FILE * fp, usize nbytes) {
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+#if defined(LEAN_WINDOWS)
+    usize n = std::fread(lean_sarray_cptr(res), 1, nbytes, fp);
+    bool failed = n == 0 && !feof(fp);
+    clearerr(fp);
+#else
+    ssize_t n;
+    do {
+        n = ::read(fileno(fp), lean_sarray_cptr(res), nbytes);
+    } while (n < 0 && errno == EINTR);
+    bool failed = n < 0;
+#endif
+    if (failed) {
+        dec_ref(res);
+        obj_res r = alloc_cnstr(0, 1, 0);
+        cnstr_set(r, 0, decode_io_error(errno, nullptr));
+        return r;
+    }
+    lean_sarray_set_size(res, n);
+    obj_res r = alloc_cnstr(1, 1, 0);
+    cnstr_set(r, 0, res);
+    return r;
+}
+
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#define LEAN_IO_EVENT_LOOP
+extern "C" obj_res lean_io_promise_new(obj_arg);
+extern "C" obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg promise, obj_arg);
+
+/* Single thread waiting for pending `Handle.readAsync` requests to become readable using `poll`.
+   Requests are added from arbitrary threads, which wake up the loop by writing to `m_wakeup[1]`. */
+class io_event_loop {
+    struct request {
+        object * m_handle;  // kept alive until the read completes
+        int      m_fd;
+        usize    m_nbytes;
+        object * m_promise;
+    };
+    mutex                  m_mutex;
+    std::vector<request>   m_requests;
+    std::unique_ptr<lthread> m_thread;
+    int                    m_wakeup[2] = {-1, -1};
+    bool                   m_stop = false;
+
+    void wakeup() {
+        char c = 0;
+        while (::write(m_wakeup[1], &c, 1) < 0 && errno == EINTR) {}
+    }
+
+    void run() {
+        std::vector<pollfd> fds;
+        std::vector<request> reqs;
+        while (true) {
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if (m_stop)
+                    return;
+                reqs = m_requests;
+            }
+            fds.clear();
+            fds.push_back(pollfd { m_wakeup[0], POLLIN, 0 });
+            for (request const & r : reqs)
+                fds.push_back(pollfd { r.m_fd, POLLIN, 0 });
+            if (poll(fds.data(), fds.size(), -1) < 0)
+                continue;
+            if (fds[0].revents & POLLIN) {
+                char buf[64];
+                while (::read(m_wakeup[0], buf, sizeof(buf)) == sizeof(buf)) {}
+            }
+            for (size_t i = 0; i < reqs.size(); i++) {
+                if (fds[i + 1].revents == 0)
+                    continue;
+                request const & r = reqs[i];
+                /* Serve at most one request per descriptor and iteration, as a second `read` could block. */
+                bool served = false;
+                for (size_t j = 0; j < i && !served; j++)
+                    served = fds[j + 1].revents != 0 && reqs[j].m_fd == r.m_fd;
+                if (served)
+                    continue;
+                {
+                    lock_guard<mutex> lock(m_mutex);
+                    m_requests.erase(std::find_if(m_requests.begin(), m_requests.end(),
+                                                  [&](request const & q) { return q.m_promise == r.m_promise; }));
+                }
+                /* Reading may fail here only for `POLLERR`/`POLLNVAL`, in which case the error is reported. */
+                obj_res v = handle_read_fd(io_get_handle(r.m_handle), r.m_nbytes);
+                lean_io_promise_resolve(v, r.m_promise, box(0));
+                dec_ref(r.m_promise);
+                dec_ref(r.m_handle);
+            }
+        }
+    }
+
+public:
+    ~io_event_loop() {
+        if (!m_thread)
+            return;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        wakeup();
+        m_thread->join();
+        close(m_wakeup[0]);
+        close(m_wakeup[1]);
+        /* Tasks waiting for the pending reads must not block forever. */
+        for (request const & r : m_requests) {
+            obj_res v = alloc_cnstr(0, 1, 0);
+            cnstr_set(v, 0, decode_io_error(ECANCELED, nullptr));
+            lean_io_promise_resolve(v, r.m_promise, box(0));
+            dec_ref(r.m_promise);
+            dec_ref(r.m_handle);
+        }
+        m_requests.clear();
+    }
+
+    /* Takes ownership of `h` and `promise`, which must have been marked as multi-threaded. */
+    bool add(object * h, usize nbytes, object * promise) {
+        lock_guard<mutex> lock(m_mutex);
+        if (!m_thread) {
+            if (::pipe(m_wakeup) != 0)
+                return false;
+            fcntl(m_wakeup[0], F_SETFL, O_NONBLOCK);
+            fcntl(m_wakeup[0], F_SETFD, FD_CLOEXEC);
+            fcntl(m_wakeup[1], F_SETFD, FD_CLOEXEC);
+            m_thread.reset(new lthread([this]() { run(); }));
+        }
+        m_requests.push_back(request { h, fileno(io_get_handle(h)), nbytes, promise });
+        wakeup();
+        return true;
+    }
+};
+
+static io_event_loop * g_io_event_loop = nullptr;
+#endif
+
+/* Handle.readAsync : (@& Handle) → USize → BaseIO (Task (Except IO.Error ByteArray)) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_async(b_obj_arg h, usize nbytes, obj_arg /* w */) {
+#if defined(LEAN_IO_EVENT_LOOP)
+    object * r = lean_io_promise_new(box(0));
+    object * promise = io_result_get_value(r);
+    inc_ref(promise, 2);
+    dec_ref(r);
+    inc_ref(h);
+    /* The event loop thread resolves the promise and releases both objects. */
+    mark_mt(promise);
+    mark_mt(h);
+    if (g_io_event_loop->add(h, nbytes, promise))
+        return io_result_mk_ok(promise);
+    dec_ref(h);
+    dec_ref(promise);
+    dec_ref(promise);
+#endif
+    return io_result_mk_ok(lean_task_pure(handle_read_fd(io_get_handle(h), nbytes)));
+}
+
 /* Handle.write : (@& Handle) → (@& ByteArray) → IO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg buf, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
@@ -309,16 +476,155 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
-static object * g_io_error_getline = nullptr;
+/* Handle.writeSliceAux : (@& Handle) → (@& ByteArray) → (@& Nat) → (@& Nat) → IO Unit
+   Writes the bytes at `[start, stop)`, clamped to the size of `buf`. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_slice(b_obj_arg h, b_obj_arg buf, b_obj_arg o_start, b_obj_arg o_stop, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    usize sz    = lean_sarray_size(buf);
+    usize stop  = lean_is_scalar(o_stop) ? std::min(lean_unbox(o_stop), sz) : sz;
+    usize start = lean_is_scalar(o_start) ? std::min(lean_unbox(o_start), stop) : stop;
+    usize n = stop - start;
+    usize m = std::fwrite(lean_sarray_cptr(buf) + start, 1, n, fp);
+    if (m == n) {
+        return io_result_mk_ok(box(0));
+    } else {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+}
 
-/*
-  Handle.getLine : (@& Handle) → IO Unit
-  The line returned by `lean_io_prim_handle_get_line`
-  is truncated at the first '\0' character and the
-  rest of the line is discarded. */
-extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
+/* Handle.writeMany : (@& Handle) → (@& Array ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_many(b_obj_arg h, b_obj_arg bufs, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    usize num  = lean_array_size(bufs);
+    usize total = 0;
+    for (usize i = 0; i < num; i++)
+        total += lean_sarray_size(lean_array_get_core(bufs, i));
+#if !defined(LEAN_WINDOWS)
+    /* Small writes are best coalesced by the buffer of `fp`, while large ones are passed to `writev` directly after
+       flushing the buffer. */
+    const usize writev_threshold = 64 * 1024;
+    if (total >= writev_threshold) {
+        if (std::fflush(fp) != 0)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+        int fd = fileno(fp);
+        iovec iov[64];
+        usize i = 0;      // next buffer
+        usize off = 0;    // bytes of `bufs[i]` already written
+        while (i < num) {
+            int cnt = 0;
+            for (usize j = i; j < num && cnt < 64; j++) {
+                b_obj_arg buf = lean_array_get_core(bufs, j);
+                usize skip = j == i ? off : 0;
+                iov[cnt].iov_base = lean_sarray_cptr(buf) + skip;
+                iov[cnt].iov_len  = lean_sarray_size(buf) - skip;
+                cnt++;
+            }
+            ssize_t n = ::writev(fd, iov, cnt);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return io_result_mk_error(decode_io_error(errno, nullptr));
+            }
+            /* Advance past the fully written buffers. */
+            usize m = n;
+            while (i < num && m >= lean_sarray_size(lean_array_get_core(bufs, i)) - off) {
+                m -= lean_sarray_size(lean_array_get_core(bufs, i)) - off;
+                i++;
+                off = 0;
+            }
+            off += m;
+        }
+        return io_result_mk_ok(box(0));
+    }
+#else
+    (void)total;
+#endif
+    for (usize i = 0; i < num; i++) {
+        b_obj_arg buf = lean_array_get_core(bufs, i);
+        usize n = lean_sarray_size(buf);
+        if (std::fwrite(lean_sarray_cptr(buf), 1, n, fp) != n)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.readAt : (@& Handle) → UInt64 → USize → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_at(b_obj_arg h, uint64 offset, usize nbytes, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
-    const int buf_sz = 64;
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+#if defined(LEAN_WINDOWS)
+    /* Unlike `pread`, this moves the file pointer of a synchronous handle. */
+    HANDLE fh = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fp)));
+    OVERLAPPED ov = {};
+    ov.Offset     = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD n = 0;
+    if (!ReadFile(fh, lean_sarray_cptr(res), static_cast<DWORD>(std::min<usize>(nbytes, MAXDWORD)), &n, &ov) &&
+        GetLastError() != ERROR_HANDLE_EOF) {
+        dec_ref(res);
+        return io_result_mk_error(std::string("failed to read from handle: ") + std::to_string(GetLastError()));
+    }
+#else
+    ssize_t n;
+    do {
+        n = ::pread(fileno(fp), lean_sarray_cptr(res), nbytes, offset);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        dec_ref(res);
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+#endif
+    lean_sarray_set_size(res, n);
+    return io_result_mk_ok(res);
+}
+
+/* Handle.writeAt : (@& Handle) → UInt64 → (@& ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_at(b_obj_arg h, uint64 offset, b_obj_arg buf, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    char const * data = reinterpret_cast<char const *>(lean_sarray_cptr(buf));
+    usize sz = lean_sarray_size(buf);
+#if defined(LEAN_WINDOWS)
+    HANDLE fh = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fp)));
+    while (sz > 0) {
+        OVERLAPPED ov = {};
+        ov.Offset     = static_cast<DWORD>(offset);
+        ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD n = 0;
+        if (!WriteFile(fh, data, static_cast<DWORD>(std::min<usize>(sz, MAXDWORD)), &n, &ov))
+            return io_result_mk_error(std::string("failed to write to handle: ") + std::to_string(GetLastError()));
+        data += n; sz -= n; offset += n;
+    }
+#else
+    while (sz > 0) {
+        ssize_t n = ::pwrite(fileno(fp), data, sz, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+        }
+        data += n; sz -= n; offset += n;
+    }
+#endif
+    return io_result_mk_ok(box(0));
+}
+
+static object * g_io_error_getline = nullptr;
+
+#if !defined(LEAN_WINDOWS)
+/* Line buffer reused by all `getline` calls of the current thread. */
+struct line_buffer {
+    char * m_data     = nullptr;
+    size_t m_capacity = 0;
+    ~line_buffer() { free(m_data); }
+};
+static LEAN_THREAD_LOCAL line_buffer g_line_buffer;
+#endif
+
+/* Read the next line of `fp`, including its line break. Returns the empty string at EOF and `nullptr` on failure.
+   The line is truncated at the first '\0' character and the rest of the line is discarded. */
+static obj_res read_line(FILE * fp) {
+#if defined(LEAN_WINDOWS)
+    const int buf_sz = 4096;
     char buf_str[buf_sz]; // NOLINT
     std::string result;
     bool first = true;
@@ -327,21 +633,189 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg
         if (out != nullptr) {
             if (strlen(buf_str) < buf_sz-1 || buf_str[buf_sz-2] == '\n') {
                 if (first) {
-                    return io_result_mk_ok(mk_string(out));
+                    return mk_string(out);
                 } else {
                     result.append(out);
-                    return io_result_mk_ok(mk_string(result));
+                    return mk_string(result);
                 }
             }
             result.append(out);
         } else if (std::feof(fp)) {
             clearerr(fp);
-            return io_result_mk_ok(mk_string(result));
+            return mk_string(result);
         } else {
-            return io_result_mk_error(g_io_error_getline);
+            return nullptr;
         }
         first = false;
     }
+#else
+    /* `getline` scans the buffer of `fp` using `memchr`, and the line is copied only once more into the new string. */
+    line_buffer & buf = g_line_buffer;
+    ssize_t n = getline(&buf.m_data, &buf.m_capacity, fp);
+    if (n < 0) {
+        if (std::feof(fp)) {
+            clearerr(fp);
+            return mk_string("");
+        }
+        return nullptr;
+    }
+    char const * nul = static_cast<char const *>(memchr(buf.m_data, 0, n));
+    return lean_mk_string_from_bytes(buf.m_data, nul ? nul - buf.m_data : n);
+#endif
+}
+
+/* Handle.getLine : (@& Handle) → IO String */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
+    obj_res line = read_line(io_get_handle(h));
+    if (line)
+        return io_result_mk_ok(line);
+    else
+        return io_result_mk_error(g_io_error_getline);
+}
+
+/* Handle.getLines : (@& Handle) → USize → IO (Array String) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_lines(b_obj_arg h, usize max_lines, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    obj_res lines = lean_alloc_array(0, std::min<usize>(max_lines, 1024));
+    for (usize i = 0; i < max_lines; i++) {
+        obj_res line = read_line(fp);
+        if (!line) {
+            dec_ref(lines);
+            return io_result_mk_error(g_io_error_getline);
+        }
+        if (lean_string_size(line) == 1) {
+            dec_ref(line);
+            break;
+        }
+        lines = lean_array_push(lines, line);
+    }
+    return io_result_mk_ok(lines);
+}
+
+/* Read-only memory mapping of a whole file. */
+struct mapped_file {
+    char const * m_data = nullptr;
+    size_t       m_size = 0;
+#if defined(LEAN_WINDOWS)
+    HANDLE       m_file = INVALID_HANDLE_VALUE;
+    HANDLE       m_map  = NULL;
+#endif
+};
+
+static lean_external_class * g_mapped_file_external_class = nullptr;
+
+static void mapped_file_finalizer(void * p) {
+    mapped_file * m = static_cast<mapped_file *>(p);
+#if defined(LEAN_WINDOWS)
+    if (m->m_data)
+        UnmapViewOfFile(m->m_data);
+    if (m->m_map)
+        CloseHandle(m->m_map);
+    if (m->m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m->m_file);
+#else
+    if (m->m_data)
+        munmap(const_cast<char *>(m->m_data), m->m_size);
+#endif
+    delete m;
+}
+
+static void mapped_file_foreach(void * /* mod */, b_obj_arg /* fn */) {
+}
+
+static mapped_file * mapped_file_get(b_obj_arg m) {
+    return static_cast<mapped_file *>(lean_get_external_data(m));
+}
+
+/* Clamp the natural number `n` to `[0, max]`. */
+static size_t nat_clamp(b_obj_arg n, size_t max) {
+    return lean_is_scalar(n) ? std::min<size_t>(lean_unbox(n), max) : max;
+}
+
+/* mmap : (@& FilePath) → IO MappedFile */
+extern "C" LEAN_EXPORT obj_res lean_io_mmap(b_obj_arg fname, obj_arg /* w */) {
+    std::unique_ptr<mapped_file> m(new mapped_file());
+#if defined(LEAN_WINDOWS)
+    // `FILE_SHARE_DELETE` is necessary to allow the file to (be marked to) be deleted while in use
+    m->m_file = CreateFile(string_cstr(fname), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->m_file == INVALID_HANDLE_VALUE) {
+        return io_result_mk_error(std::string("failed to open '") + string_cstr(fname) + "': " + std::to_string(GetLastError()));
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->m_file, &size)) {
+        mapped_file_finalizer(m.release());
+        return io_result_mk_error(std::string("failed to get size of '") + string_cstr(fname) + "': " + std::to_string(GetLastError()));
+    }
+    m->m_size = static_cast<size_t>(size.QuadPart);
+    // mapping an empty file fails
+    if (m->m_size > 0) {
+        m->m_map = CreateFileMapping(m->m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m->m_map != NULL)
+            m->m_data = static_cast<char const *>(MapViewOfFile(m->m_map, FILE_MAP_READ, 0, 0, 0));
+        if (!m->m_data) {
+            mapped_file_finalizer(m.release());
+            return io_result_mk_error(std::string("failed to map '") + string_cstr(fname) + "': " + std::to_string(GetLastError()));
+        }
+    }
+#else
+    int fd = open(string_cstr(fname), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return io_result_mk_error(decode_io_error(errno, fname));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    m->m_size = st.st_size;
+    // mapping an empty file fails
+    if (m->m_size > 0) {
+        void * data = mmap(nullptr, m->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            return io_result_mk_error(decode_io_error(err, fname));
+        }
+        m->m_data = static_cast<char const *>(data);
+    }
+    close(fd);
+#endif
+    return io_result_mk_ok(lean_alloc_external(g_mapped_file_external_class, m.release()));
+}
+
+/* MappedFile.size : (@& MappedFile) → Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_size(b_obj_arg m) {
+    return lean_usize_to_nat(mapped_file_get(m)->m_size);
+}
+
+/* MappedFile.getD : (@& MappedFile) → (@& Nat) → UInt8 → UInt8 */
+extern "C" LEAN_EXPORT uint8 lean_io_mapped_file_get_d(b_obj_arg m, b_obj_arg i, uint8 v0) {
+    mapped_file * f = mapped_file_get(m);
+    if (lean_is_scalar(i) && lean_unbox(i) < f->m_size)
+        return static_cast<uint8>(f->m_data[lean_unbox(i)]);
+    return v0;
+}
+
+/* MappedFile.extract : (@& MappedFile) → (@& Nat) → (@& Nat) → ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_extract(b_obj_arg m, b_obj_arg start, b_obj_arg stop) {
+    mapped_file * f = mapped_file_get(m);
+    size_t e = nat_clamp(stop, f->m_size);
+    size_t b = nat_clamp(start, e);
+    obj_res r = lean_alloc_sarray(1, e - b, e - b);
+    if (e > b)
+        memcpy(lean_sarray_cptr(r), f->m_data + b, e - b);
+    return r;
+}
+
+/* MappedFile.indexOfAux : (@& MappedFile) → UInt8 → (@& Nat) → Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_index_of(b_obj_arg m, uint8 v, b_obj_arg start) {
+    mapped_file * f = mapped_file_get(m);
+    size_t b = nat_clamp(start, f->m_size);
+    if (b == f->m_size)
+        return lean_usize_to_nat(f->m_size);
+    void const * p = memchr(f->m_data + b, v, f->m_size - b);
+    return lean_usize_to_nat(p ? static_cast<char const *>(p) - f->m_data : f->m_size);
 }
 
 /* Handle.putStr : (@& Handle) → (@& String) → IO Unit */
@@ -462,6 +936,77 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_num_heartbeats(obj_arg /* w */) {
     return io_result_mk_ok(lean_uint64_to_nat(get_num_heartbeats()));
 }
 
+/* getResidentMemory : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_get_resident_memory(obj_arg /* w */) {
+    return io_result_mk_ok(lean_usize_to_nat(get_allocated_memory()));
+}
+
+/* Handlers registered with `IO.registerMemoryPressureHandler`. */
+static mutex *                 g_lean_pressure_mutex    = nullptr;
+static std::vector<object *> * g_lean_pressure_handlers = nullptr;
+
+static void run_lean_memory_pressure_handlers() {
+    std::vector<object *> handlers;
+    {
+        lock_guard<mutex> _(*g_lean_pressure_mutex);
+        handlers = *g_lean_pressure_handlers;
+    }
+    for (object * h : handlers) {
+        inc(h);
+        object * r = apply_1(h, io_mk_world());
+        // errors of handlers are ignored, releasing memory is best effort
+        dec(r);
+    }
+}
+
+/* registerMemoryPressureHandler (h : IO Unit) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_register_memory_pressure_handler(obj_arg h, obj_arg /* w */) {
+    mark_mt(h);
+    mark_persistent(h);
+    lock_guard<mutex> _(*g_lean_pressure_mutex);
+    g_lean_pressure_handlers->push_back(h);
+    return io_result_mk_ok(box(0));
+}
+
+/*
+structure SmallAllocSlotStats where
+  objSize         : Nat
+  liveBytes       : Nat
+  freeBytes       : Nat
+  numPages        : Nat
+  numPartialPages : Nat
+
+structure SmallAllocStats where
+  slots         : Array SmallAllocSlotStats
+  numEmptyPages : Nat
+  numSegments   : Nat
+  numHeaps      : Nat
+
+getSmallAllocStats (global : Bool) : BaseIO SmallAllocStats
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_get_small_alloc_stats(uint8 global, obj_arg /* w */) {
+    small_alloc_stats st;
+    get_small_alloc_stats(global, st);
+    object * slots = array_mk_empty();
+    for (small_alloc_slot_stats const & s : st.m_slots) {
+        if (s.m_num_pages == 0)
+            continue;
+        object * o = alloc_cnstr(0, 5, 0);
+        cnstr_set(o, 0, lean_unsigned_to_nat(s.m_obj_size));
+        cnstr_set(o, 1, lean_uint64_to_nat(s.m_live_bytes));
+        cnstr_set(o, 2, lean_uint64_to_nat(s.m_free_bytes));
+        cnstr_set(o, 3, lean_uint64_to_nat(s.m_num_pages));
+        cnstr_set(o, 4, lean_uint64_to_nat(s.m_num_partial_pages));
+        slots = lean_array_push(slots, o);
+    }
+    object * r = alloc_cnstr(0, 4, 0);
+    cnstr_set(r, 0, slots);
+    cnstr_set(r, 1, lean_uint64_to_nat(st.m_num_empty_pages));
+    cnstr_set(r, 2, lean_uint64_to_nat(st.m_num_segments));
+    cnstr_set(r, 3, lean_uint64_to_nat(st.m_num_heaps));
+    return io_result_mk_ok(r);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_getenv(b_obj_arg env_var, obj_arg) {
 #if defined(LEAN_EMSCRIPTEN)
     // HACK(WN): getenv doesn't seem to work in Emscripten even though it should
@@ -574,6 +1119,17 @@ structure Metadata where
 
 constant metadata : @& FilePath → IO IO.FS.Metadata
 */
+/* The `FileType` of a file with mode `mode`. */
+static uint8 file_type_of_mode(unsigned mode) {
+    return
+        S_ISDIR(mode) ? 0 :
+        S_ISREG(mode) ? 1 :
+#ifndef LEAN_WINDOWS
+        S_ISLNK(mode) ? 2 :
+#endif
+        3;
+}
+
 static obj_res timespec_to_obj(timespec const & ts) {
     object * o = alloc_cnstr(0, 1, sizeof(uint32));
     cnstr_set(o, 0, lean_int64_to_int(ts.tv_sec));
@@ -599,16 +1155,116 @@ extern "C" LEAN_EXPORT obj_res lean_io_metadata(b_obj_arg fname, obj_arg) {
     cnstr_set(mdata, 1, timespec_to_obj(st.st_mtim));
 #endif
     cnstr_set_uint64(mdata, 2 * sizeof(object *), st.st_size);
-    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64),
-                    S_ISDIR(st.st_mode) ? 0 :
-                    S_ISREG(st.st_mode) ? 1 :
-#ifndef LEAN_WINDOWS
-                    S_ISLNK(st.st_mode) ? 2 :
-#endif
-                    3);
+    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64), file_type_of_mode(st.st_mode));
     return io_result_mk_ok(mdata);
 }
 
+/* Directory entry read by `lean_io_read_dirs`. */
+struct read_dirs_entry {
+    size_t      m_dir;   // index of the directory
+    std::string m_name;
+    uint8       m_type;  // `FileType`, or `read_dirs_unknown` if it must be determined using `stat`
+};
+static constexpr uint8 read_dirs_unknown = 255;
+
+#if defined(LEAN_WINDOWS)
+static constexpr char path_separator = '\\';
+#else
+static constexpr char path_separator = '/';
+#endif
+
+/* Whether the extension of `name`, in the sense of `FilePath.extension`, is in `exts`. */
+static bool has_extension(std::string const & name, b_obj_arg exts) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || dot == 0)
+        return false;
+    for (size_t i = 0; i < lean_array_size(exts); i++) {
+        b_obj_arg ext = lean_array_get_core(exts, i);
+        if (name.size() - dot - 1 == lean_string_size(ext) - 1 && name.compare(dot + 1, std::string::npos, lean_string_cstr(ext)) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+structure WalkEntry where
+  path : FilePath
+  type : FileType
+
+readDirs : (@& Array FilePath) → (@& Array String) → IO (Array WalkEntry)
+
+Reads all directories and determines the types of their entries using multiple threads, which hides most of the
+latency of network file systems. Symbolic links are followed. Non-directory entries are returned only if their
+extension is in `exts`, unless `exts` is empty. */
+extern "C" LEAN_EXPORT obj_res lean_io_read_dirs(b_obj_arg dirs, b_obj_arg exts, obj_arg) {
+    /* No more threads than this are created, as they mostly wait for I/O. */
+    const size_t max_threads = 16;
+    size_t num_dirs = lean_array_size(dirs);
+    std::vector<std::vector<read_dirs_entry>> entries(num_dirs);
+    std::vector<int> errors(num_dirs, 0);
+    parallel_for(num_dirs, max_threads, [&](size_t, size_t i) {
+        DIR * dp = opendir(string_cstr(lean_array_get_core(dirs, i)));
+        if (!dp) {
+            errors[i] = errno;
+            return;
+        }
+        while (dirent * entry = readdir(dp)) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+            uint8 type = read_dirs_unknown;
+#ifdef DT_DIR
+            if (entry->d_type == DT_DIR)
+                type = 0;
+            else if (entry->d_type == DT_REG)
+                type = 1;
+#endif
+            entries[i].push_back(read_dirs_entry { i, entry->d_name, type });
+        }
+        lean_always_assert(closedir(dp) == 0);
+    });
+    for (size_t i = 0; i < num_dirs; i++) {
+        if (errors[i] != 0)
+            return io_result_mk_error(decode_io_error(errors[i], lean_array_get_core(dirs, i)));
+    }
+
+    /* Determine the remaining types, which requires a `stat` call per entry. */
+    std::vector<read_dirs_entry *> unknown;
+    for (auto & dir_entries : entries) {
+        for (auto & e : dir_entries) {
+            if (e.m_type == read_dirs_unknown)
+                unknown.push_back(&e);
+        }
+    }
+    parallel_for(unknown.size(), max_threads, [&](size_t, size_t i) {
+        read_dirs_entry & e = *unknown[i];
+        std::string path = std::string(string_cstr(lean_array_get_core(dirs, e.m_dir))) + path_separator + e.m_name;
+        struct stat st;
+        /* Report broken symbolic links as such, like `metadata` would fail for them. */
+        e.m_type = stat(path.c_str(), &st) == 0 ? file_type_of_mode(st.st_mode) : 2;
+    });
+
+    bool filter = lean_array_size(exts) > 0;
+    object * arr = array_mk_empty();
+    for (auto & dir_entries : entries) {
+        for (auto & e : dir_entries) {
+            if (filter && e.m_type != 0 && !has_extension(e.m_name, exts))
+                continue;
+            b_obj_arg dir = lean_array_get_core(dirs, e.m_dir);
+            size_t dir_sz = lean_string_size(dir) - 1;
+            std::string path;
+            path.reserve(dir_sz + 1 + e.m_name.size());
+            path.append(string_cstr(dir), dir_sz);
+            path += path_separator;
+            path += e.m_name;
+            object * lentry = alloc_cnstr(0, 1, sizeof(uint8));
+            cnstr_set(lentry, 0, mk_string(path));
+            cnstr_set_uint8(lentry, sizeof(object *), e.m_type);
+            arr = lean_array_push(arr, lentry);
+        }
+    }
+    return io_result_mk_ok(arr);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_create_dir(b_obj_arg p, obj_arg) {
 #ifdef LEAN_WINDOWS
     if (mkdir(string_cstr(p)) == 0) {
@@ -731,25 +1387,86 @@ static inline atomic<object*> * mt_ref_val_addr(object * o) {
 */
 static inline bool ref_maybe_mt(b_obj_arg ref) { return lean_is_mt(ref) || lean_is_persistent(ref); }
 
+/*
+  Contended multi-threaded `ST.Ref`s.
+
+  A thread that finds the value of a multi-threaded ref missing (i.e., another thread has taken it
+  via `take` or is in the middle of `get`) first spins for a short while, since the ref is usually
+  only held for a few instructions. If the value does not reappear, the thread parks on a
+  condition variable chosen by hashing the address of the ref. Writers only touch the parking slot
+  when its waiter counter is nonzero, so the uncontended path is unchanged.
+
+  Lost wakeups are impossible: a waiter increments `m_waiters` before checking the ref under the
+  slot mutex, and a writer stores the value before reading `m_waiters` (both sequentially consistent),
+  so either the waiter sees the value or the writer sees the waiter and notifies it under the mutex.
+*/
+static unsigned const g_ref_spin_limit      = 128;
+static unsigned const g_ref_num_park_slots  = 64;
+
+struct ref_park_slot {
+    mutex              m_mutex;
+    condition_variable m_cv;
+    atomic<unsigned>   m_waiters{0};
+};
+
+static ref_park_slot g_ref_park_slots[g_ref_num_park_slots];
+static atomic<uint64> g_ref_num_contended{0};
+static atomic<uint64> g_ref_num_parked{0};
+
+static inline ref_park_slot & get_ref_park_slot(b_obj_arg ref) {
+    size_t h = reinterpret_cast<size_t>(ref) / sizeof(lean_ref_object);
+    return g_ref_park_slots[(h ^ (h >> 6)) % g_ref_num_park_slots];
+}
+
+/* Wake up threads waiting for the value of `ref`. Must be called after storing a value into `ref`. */
+static inline void ref_notify(b_obj_arg ref) {
+    ref_park_slot & slot = get_ref_park_slot(ref);
+    if (slot.m_waiters.load() != 0) {
+        lock_guard<mutex> lock(slot.m_mutex);
+        slot.m_cv.notify_all();
+    }
+}
+
+/* Take the value of the multi-threaded `ref`, waiting until it is available. */
+static object * ref_take_mt(b_obj_arg ref) {
+    atomic<object *> * val_addr = mt_ref_val_addr(ref);
+    object * val = val_addr->exchange(nullptr);
+    if (val != nullptr)
+        return val;
+    g_ref_num_contended++;
+    for (unsigned i = 0; i < g_ref_spin_limit; i++) {
+        this_thread::yield();
+        val = val_addr->exchange(nullptr);
+        if (val != nullptr)
+            return val;
+    }
+    g_ref_num_parked++;
+    ref_park_slot & slot = get_ref_park_slot(ref);
+    slot.m_waiters++;
+    {
+        unique_lock<mutex> lock(slot.m_mutex);
+        while ((val = val_addr->exchange(nullptr)) == nullptr)
+            slot.m_cv.wait(lock);
+    }
+    slot.m_waiters--;
+    return val;
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_get(b_obj_arg ref, obj_arg) {
     if (ref_maybe_mt(ref)) {
-        atomic<object *> * val_addr = mt_ref_val_addr(ref);
-        while (true) {
-            /*
-              We cannot simply read `val` from the ref and `inc` it like in the `else` branch since someone else could
-              write to the ref in between and remove the last owning reference to the object. Instead, we must take
-              ownership of the RC token in the ref via `exchange`, duplicate it, then put one RC token back. */
-            object * val = val_addr->exchange(nullptr);
-            if (val != nullptr) {
-                inc(val);
-                object * tmp = val_addr->exchange(val);
-                if (tmp != nullptr) {
-                    /* this may happen if another thread wrote `ref` */
-                    dec(tmp);
-                }
-                return io_result_mk_ok(val);
-            }
+        /*
+          We cannot simply read `val` from the ref and `inc` it like in the `else` branch since someone else could
+          write to the ref in between and remove the last owning reference to the object. Instead, we must take
+          ownership of the RC token in the ref via `exchange`, duplicate it, then put one RC token back. */
+        object * val = ref_take_mt(ref);
+        inc(val);
+        object * tmp = mt_ref_val_addr(ref)->exchange(val);
+        if (tmp != nullptr) {
+            /* this may happen if another thread wrote `ref` */
+            dec(tmp);
         }
+        ref_notify(ref);
+        return io_result_mk_ok(val);
     } else {
         object * val = lean_to_ref(ref)->m_value;
         lean_assert(val != nullptr);
@@ -760,12 +1477,7 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_get(b_obj_arg ref, obj_arg) {
 
 extern "C" LEAN_EXPORT obj_res lean_st_ref_take(b_obj_arg ref, obj_arg) {
     if (ref_maybe_mt(ref)) {
-        atomic<object *> * val_addr = mt_ref_val_addr(ref);
-        while (true) {
-            object * val = val_addr->exchange(nullptr);
-            if (val != nullptr)
-                return io_result_mk_ok(val);
-        }
+        return io_result_mk_ok(ref_take_mt(ref));
     } else {
         object * val = lean_to_ref(ref)->m_value;
         lean_assert(val != nullptr);
@@ -776,6 +1488,14 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_take(b_obj_arg ref, obj_arg) {
 
 static_assert(sizeof(atomic<unsigned short>) == sizeof(unsigned short), "`atomic<unsigned short>` and `unsigned short` must have the same size"); // NOLINT
 
+/* Storing `a` in a reference that was not allocated in the active arenas of the current thread may make objects of the
+   arenas reachable after they are released, see `lean_io_with_arena`. The arenas are kept alive in that case.
+   Multi-threaded references are handled by `mark_mt`. */
+static inline void check_arena_store(b_obj_arg ref, b_obj_arg a) {
+    if (LEAN_UNLIKELY(has_active_arena()) && !lean_is_scalar(a) && lean_has_rc(a) && !in_active_arena(ref))
+        mark_arena_escaped();
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_set(b_obj_arg ref, obj_arg a, obj_arg) {
     if (ref_maybe_mt(ref)) {
         /* We must mark `a` as multi-threaded if `ref` is marked as multi-threaded.
@@ -786,8 +1506,10 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_set(b_obj_arg ref, obj_arg a, obj_arg
         object * old_a = val_addr->exchange(a);
         if (old_a != nullptr)
             dec(old_a);
+        ref_notify(ref);
         return io_result_mk_ok(box(0));
     } else {
+        check_arena_store(ref, a);
         if (lean_to_ref(ref)->m_value != nullptr)
             dec(lean_to_ref(ref)->m_value);
         lean_to_ref(ref)->m_value = a;
@@ -802,6 +1524,7 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_ar
         atomic<object *> * val_addr = mt_ref_val_addr(ref);
         while (true) {
             object * old_a = val_addr->exchange(a);
+            ref_notify(ref);
             if (old_a != nullptr)
                 return io_result_mk_ok(old_a);
         }
@@ -809,11 +1532,26 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_ar
         object * old_a = lean_to_ref(ref)->m_value;
         if (old_a == nullptr)
             return io_result_mk_error(g_io_error_nullptr_read);
+        check_arena_store(ref, a);
         lean_to_ref(ref)->m_value = a;
         return io_result_mk_ok(old_a);
     }
 }
 
+/*
+structure RefContentionStats where
+  numContended : Nat
+  numParked    : Nat
+
+getRefContentionStats : BaseIO RefContentionStats
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_get_ref_contention_stats(obj_arg /* w */) {
+    object * r = alloc_cnstr(0, 2, 0);
+    cnstr_set(r, 0, lean_uint64_to_nat(g_ref_num_contended.load()));
+    cnstr_set(r, 1, lean_uint64_to_nat(g_ref_num_parked.load()));
+    return io_result_mk_ok(r);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_ptr_eq(b_obj_arg ref1, b_obj_arg ref2, obj_arg) {
     // TODO(Leo): ref_maybe_mt
     bool r = lean_to_ref(ref1)->m_value == lean_to_ref(ref2)->m_value;
@@ -880,16 +1618,136 @@ extern "C" LEAN_EXPORT obj_res lean_io_wait_any(b_obj_arg task_list, obj_arg) {
     return io_result_mk_ok(v);
 }
 
+/* waitAll (tasks : @& Array (Task α)) : BaseIO (Array α) */
+extern "C" LEAN_EXPORT obj_res lean_io_wait_all(b_obj_arg tasks, obj_arg) {
+    lean_io_wait_all_core(tasks);
+    size_t n = array_size(tasks);
+    object * r = alloc_array(n, n);
+    for (size_t i = 0; i < n; i++) {
+        object * v = lean_task_get(array_get(tasks, i));
+        lean_inc(v);
+        array_cptr(r)[i] = v;
+    }
+    return io_result_mk_ok(r);
+}
+
+/*
+  Task groups, see `IO.TaskGroup`. A group keeps a reference to each task added to it so that
+  `cancel` can reach all of them, finished tasks are dropped whenever the number of tasks has
+  doubled since the last time.
+*/
+struct task_group {
+    mutex                 m_mutex;
+    std::vector<object *> m_tasks;
+    size_t                m_prune_size{16};
+    bool                  m_canceled{false};
+    ~task_group() {
+        for (object * t : m_tasks)
+            dec(t);
+    }
+};
+
+static lean_external_class * g_task_group_external_class = nullptr;
+
+static void task_group_finalizer(void * h) {
+    delete static_cast<task_group *>(h);
+}
+
+static void task_group_foreach(void *, b_obj_arg) {}
+
+static task_group * task_group_get(b_obj_arg g) {
+    return static_cast<task_group *>(lean_get_external_data(g));
+}
+
+/* TaskGroup.new : BaseIO TaskGroup */
+extern "C" LEAN_EXPORT obj_res lean_io_task_group_new(obj_arg) {
+    return io_result_mk_ok(lean_alloc_external(g_task_group_external_class, new task_group()));
+}
+
+/* TaskGroup.add (g : @& TaskGroup) (t : @& Task α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_task_group_add(b_obj_arg g, b_obj_arg t, obj_arg) {
+    task_group * tg = task_group_get(g);
+    std::vector<object *> finished;
+    {
+        lock_guard<mutex> lock(tg->m_mutex);
+        if (tg->m_canceled)
+            lean_io_cancel_core(t);
+        inc(t);
+        tg->m_tasks.push_back(t);
+        if (tg->m_tasks.size() >= tg->m_prune_size) {
+            auto it = std::partition(tg->m_tasks.begin(), tg->m_tasks.end(),
+                                     [](object * t) { return !lean_io_has_finished_core(t); });
+            finished.assign(it, tg->m_tasks.end());
+            tg->m_tasks.erase(it, tg->m_tasks.end());
+            tg->m_prune_size = std::max(static_cast<size_t>(16), 2 * tg->m_tasks.size());
+        }
+    }
+    for (object * t : finished)
+        dec(t);
+    return io_result_mk_ok(box(0));
+}
+
+/* TaskGroup.cancel (g : @& TaskGroup) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_task_group_cancel(b_obj_arg g, obj_arg) {
+    task_group * tg = task_group_get(g);
+    lock_guard<mutex> lock(tg->m_mutex);
+    tg->m_canceled = true;
+    for (object * t : tg->m_tasks)
+        lean_io_cancel_core(t);
+    return io_result_mk_ok(box(0));
+}
+
+/* TaskGroup.isCanceled (g : @& TaskGroup) : BaseIO Bool */
+extern "C" LEAN_EXPORT obj_res lean_io_task_group_is_canceled(b_obj_arg g, obj_arg) {
+    task_group * tg = task_group_get(g);
+    lock_guard<mutex> lock(tg->m_mutex);
+    return io_result_mk_ok(box(tg->m_canceled));
+}
+
+/* TaskGroup.wait (g : @& TaskGroup) : BaseIO Unit
+
+   Tasks of the group may add further tasks to it, so we wait until no task is left unfinished. */
+extern "C" LEAN_EXPORT obj_res lean_io_task_group_wait(b_obj_arg g, obj_arg) {
+    task_group * tg = task_group_get(g);
+    while (true) {
+        object * pending;
+        {
+            lock_guard<mutex> lock(tg->m_mutex);
+            pending = alloc_array(0, tg->m_tasks.size());
+            for (object * t : tg->m_tasks) {
+                if (!lean_io_has_finished_core(t)) {
+                    inc(t);
+                    pending = lean_array_push(pending, t);
+                }
+            }
+        }
+        bool done = array_size(pending) == 0;
+        if (!done)
+            lean_io_wait_all_core(pending);
+        dec(pending);
+        if (done)
+            return io_result_mk_ok(box(0));
+    }
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_exit(uint8_t code, obj_arg /* w */) {
     exit(code);
 }
 
 void initialize_io() {
+    g_lean_pressure_mutex    = new mutex();
+    g_lean_pressure_handlers = new std::vector<object *>();
+    register_memory_pressure_handler(run_lean_memory_pressure_handlers);
     g_io_error_nullptr_read = lean_mk_io_user_error(mk_string("null reference read"));
     mark_persistent(g_io_error_nullptr_read);
     g_io_error_getline = lean_mk_io_user_error(mk_string("getLine failed"));
     mark_persistent(g_io_error_getline);
     g_io_handle_external_class = lean_register_external_class(io_handle_finalizer, io_handle_foreach);
+    g_task_group_external_class = lean_register_external_class(task_group_finalizer, task_group_foreach);
+    g_mapped_file_external_class = lean_register_external_class(mapped_file_finalizer, mapped_file_foreach);
+#if defined(LEAN_IO_EVENT_LOOP)
+    g_io_event_loop = new io_event_loop();
+#endif
 #if defined(LEAN_WINDOWS)
     _setmode(_fileno(stdout), _O_BINARY);
     _setmode(_fileno(stderr), _O_BINARY);
@@ -908,5 +1766,8 @@ void initialize_io() {
 }
 
 void finalize_io() {
+#if defined(LEAN_IO_EVENT_LOOP)
+    delete g_io_event_loop;
+#endif
 }
 }
@@ -8,6 +8,7 @@ Author: Leonardo de Moura, Mac Malone
 #include "runtime/object.h"
 #include "runtime/sstream.h"
 #include "runtime/exception.h"
+#include "runtime/thread.h"
 #include "runtime/load_dynlib.h"
 
 #ifdef LEAN_WINDOWS
@@ -17,6 +18,12 @@ Author: Leonardo de Moura, Mac Malone
 #endif
 
 namespace lean {
+static atomic<unsigned> g_dynlib_generation(0);
+
+unsigned get_dynlib_generation() {
+    return g_dynlib_generation;
+}
+
 void load_dynlib(std::string path) {
 #ifdef LEAN_WINDOWS
     HMODULE h = LoadLibrary(path.c_str());
@@ -29,6 +36,7 @@ void load_dynlib(std::string path) {
         throw exception(sstream() << "error loading library, " << dlerror());
     }
 #endif
+    g_dynlib_generation++;
     // NOTE: we never unload libraries
 }
 
@@ -9,4 +9,7 @@ Author: Mac Malone
 
 namespace lean {
 void load_dynlib(std::string path);
+/* Number of libraries loaded using `load_dynlib` so far. Caches of failed symbol lookups must be invalidated when it
+   changes. */
+unsigned get_dynlib_generation();
 }
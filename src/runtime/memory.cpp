@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #include <new>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 #include "runtime/exception.h"
 #include "runtime/memory.h"
 #include "runtime/thread.h"
@@ -15,6 +16,10 @@ Author: Leonardo de Moura
 #define LEAN_CHECK_MEM_THRESHOLD 200
 #endif
 
+#ifndef LEAN_SOFT_MEMORY_LIMIT
+#define LEAN_SOFT_MEMORY_LIMIT 90
+#endif
+
 #if defined(HAS_JEMALLOC)
 #include <jemalloc/jemalloc.h>
 
@@ -112,10 +117,55 @@ size_t get_current_rss() {
 
 namespace lean {
 static size_t g_max_memory = 0;
+static size_t g_soft_memory = 0;
 LEAN_THREAD_VALUE(size_t, g_counter, 0);
 
+static mutex *                                 g_pressure_mutex    = nullptr;
+static std::vector<memory_pressure_handler> *  g_pressure_handlers = nullptr;
+/* Memory usage at the last time the handlers were run. */
+static atomic<size_t>                          g_released_at{0};
+/* Set by `notify_heap_growth`, and cleared by the next `check_memory`. */
+static atomic<bool>                            g_heap_grew{false};
+
 void set_max_memory(size_t max) {
-    g_max_memory = max;
+    g_max_memory  = max;
+    g_soft_memory = max / 100 * LEAN_SOFT_MEMORY_LIMIT;
+}
+
+void register_memory_pressure_handler(memory_pressure_handler fn) {
+    if (!g_pressure_mutex) {
+        /* handlers are registered by module initializers, which may run before `initialize_runtime_module` */
+        g_pressure_mutex    = new mutex();
+        g_pressure_handlers = new std::vector<memory_pressure_handler>();
+    }
+    lock_guard<mutex> _(*g_pressure_mutex);
+    g_pressure_handlers->push_back(fn);
+}
+
+void release_cached_memory() {
+    if (!g_pressure_mutex)
+        return;
+    std::vector<memory_pressure_handler> handlers;
+    {
+        lock_guard<mutex> _(*g_pressure_mutex);
+        handlers = *g_pressure_handlers;
+    }
+    for (memory_pressure_handler fn : handlers)
+        fn();
+}
+
+/* Run the memory pressure handlers if usage `r` is above the soft limit. As freed memory is reused by the allocator
+   instead of being returned to the system, usage does not decrease afterwards, so we only run them again once usage
+   has grown by another twentieth of the maximum. */
+static void check_soft_memory(size_t r) {
+    if (r < g_soft_memory)
+        return;
+    size_t released_at = g_released_at;
+    if (released_at != 0 && r < released_at + g_max_memory / 20)
+        return;
+    if (!g_released_at.compare_exchange_strong(released_at, r))
+        return; // another thread is releasing memory
+    release_cached_memory();
 }
 
 void set_max_memory_megabyte(unsigned max) {
@@ -124,17 +174,25 @@ void set_max_memory_megabyte(unsigned max) {
     set_max_memory(m);
 }
 
+void notify_heap_growth() {
+    if (g_max_memory != 0 && !g_heap_grew.load(memory_order_relaxed))
+        g_heap_grew.store(true, memory_order_relaxed);
+}
+
 void check_memory(char const * component_name) {
     if (g_max_memory == 0) return;
     g_counter++;
-    if (g_counter >= LEAN_CHECK_MEM_THRESHOLD) {
+    if (g_counter >= LEAN_CHECK_MEM_THRESHOLD ||
+        (g_heap_grew.load(memory_order_relaxed) && g_heap_grew.exchange(false))) {
         g_counter = 0;
         // We try first get_peak_rss because it is much faster
         // than get_current_rss on Linux.
         size_t r = get_peak_rss();
-        if (r > 0 && r < g_max_memory) return;
+        if (r > 0 && r < g_soft_memory) return;
         r = get_current_rss();
-        if (r == 0 || r < g_max_memory) return;
+        if (r == 0) return;
+        check_soft_memory(r);
+        if (r < g_max_memory) return;
         throw memory_exception(component_name);
     }
 }
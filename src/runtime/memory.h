@@ -12,6 +12,20 @@ namespace lean {
 void set_max_memory(size_t max);
 /** \brief Set maximum amount of memory in megabytes */
 void set_max_memory_megabyte(unsigned max);
+/** \brief Check that memory usage is below the maximum set by `set_max_memory`, and throw `memory_exception` otherwise.
+    When usage exceeds the soft limit, i.e., `LEAN_SOFT_MEMORY_LIMIT` percent of the maximum, the registered memory
+    pressure handlers are run first so that caches can release their contents. */
 void check_memory(char const * component_name);
+/** \brief Function releasing cached data on memory pressure. It may be called from any thread. */
+typedef void (*memory_pressure_handler)();
+void register_memory_pressure_handler(memory_pressure_handler fn);
+/** \brief Run all memory pressure handlers. */
+void release_cached_memory();
+/** \brief Called by the small object allocator when it takes a new segment from the system. The handlers are not
+    run by the allocator itself, which may be in the middle of an allocation, but the next `check_memory` of any thread
+    then checks the memory usage instead of waiting for its periodic check. */
+void notify_heap_growth();
 size_t get_allocated_memory();
+/** \brief Peak resident set size of the process in bytes */
+size_t get_peak_rss();
 }
@@ -86,17 +86,46 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
-    // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
-    size_t i;
-    mpn_digit k;
+#define MASK_FIRST (~((mpn_digit)(-1) >> 1))
+#define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
+#define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
+#define BASE ((mpn_double_digit)0x01 << DIGIT_BITS)
+
+class  mpn_buffer : public buffer<mpn_digit> {
+public:
+    mpn_buffer() : buffer<mpn_digit>() {}
+
+    mpn_buffer(size_t nsz, const mpn_digit & elem = 0):buffer<mpn_digit>() {
+        for (size_t i = 0; i < nsz; i++) push_back(elem);
+    }
+
+    void resize(size_t nsz, const mpn_digit & elem = 0) {
+        buffer<mpn_digit>::resize(static_cast<unsigned>(nsz), elem);
+    }
+
+    mpn_digit & operator[](size_t idx) {
+        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+    }
+
+    const mpn_digit & operator[](size_t idx) const {
+        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+    }
+};
 
 #define DIGIT_BITS (sizeof(mpn_digit)*8)
 #define HALF_BITS (sizeof(mpn_digit)*4)
 
+/* Operands with fewer digits than this are multiplied using the schoolbook method.
+   The value was chosen by timing `mpn_mul` on random balanced operands of 16 to 1024 digits. */
+#define KARATSUBA_THRESHOLD 32
+
+static void mul_basecase(mpn_digit const * a, size_t const lnga,
+                         mpn_digit const * b, size_t const lngb,
+                         mpn_digit * c) {
+    // Essentially Knuth's Algorithm M.
+    size_t i;
+    mpn_digit k;
+
     for (unsigned i = 0; i < lnga; i++)
         c[i] = 0;
 
@@ -122,31 +151,120 @@ void mpn_mul(mpn_digit const * a, size_t const lnga,
     }
 }
 
-#define MASK_FIRST (~((mpn_digit)(-1) >> 1))
-#define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
-#define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
-#define BASE ((mpn_double_digit)0x01 << DIGIT_BITS)
-
-class  mpn_buffer : public buffer<mpn_digit> {
-public:
-    mpn_buffer() : buffer<mpn_digit>() {}
+/* r[0, lngr) += a[0, lnga), returns the carry. Requires lnga <= lngr. */
+static mpn_digit add_to(mpn_digit * r, size_t const lngr, mpn_digit const * a, size_t const lnga) {
+    mpn_digit k = 0;
+    size_t i = 0;
+    for (; i < lnga; i++) {
+        mpn_double_digit t = (mpn_double_digit)r[i] + (mpn_double_digit)a[i] + k;
+        r[i] = (mpn_digit)t;
+        k = (mpn_digit)(t >> DIGIT_BITS);
+    }
+    for (; k != 0 && i < lngr; i++) {
+        r[i]++;
+        k = r[i] == 0;
+    }
+    return k;
+}
 
-    mpn_buffer(size_t nsz, const mpn_digit & elem = 0):buffer<mpn_digit>() {
-        for (size_t i = 0; i < nsz; i++) push_back(elem);
+/* r[0, lngr) -= a[0, lnga), returns the borrow. Requires lnga <= lngr. */
+static mpn_digit sub_from(mpn_digit * r, size_t const lngr, mpn_digit const * a, size_t const lnga) {
+    mpn_digit k = 0;
+    size_t i = 0;
+    for (; i < lnga; i++) {
+        mpn_double_digit t = (mpn_double_digit)r[i] - (mpn_double_digit)a[i] - k;
+        r[i] = (mpn_digit)t;
+        k = (mpn_digit)(t >> DIGIT_BITS) & 1;
+    }
+    for (; k != 0 && i < lngr; i++) {
+        k = r[i] == 0;
+        r[i]--;
     }
+    return k;
+}
 
-    void resize(size_t nsz, const mpn_digit & elem = 0) {
-        buffer<mpn_digit>::resize(static_cast<unsigned>(nsz), elem);
+/* c[0, lnga) = |a - b|, returns true iff a < b. Requires lngb <= lnga. */
+static bool abs_diff(mpn_digit const * a, size_t const lnga,
+                     mpn_digit const * b, size_t const lngb,
+                     mpn_digit * c) {
+    mpn_digit borrow;
+    if (mpn_compare(a, lnga, b, lngb) >= 0) {
+        mpn_sub(a, lnga, b, lngb, c, &borrow);
+        return false;
+    } else {
+        mpn_sub(b, lngb, a, lnga, c, &borrow);
+        return true;
     }
+}
 
-    mpn_digit & operator[](size_t idx) {
-        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+/* Number of scratch digits used by `mul_karatsuba` for operands of `n` digits. */
+static size_t karatsuba_scratch_size(size_t n) {
+    if (n < KARATSUBA_THRESHOLD)
+        return 0;
+    size_t hh = n - n / 2;
+    return 4*hh + max(2*hh + 1, karatsuba_scratch_size(hh));
+}
+
+/* c[0, 2n) = a[0, n) * b[0, n), using `karatsuba_scratch_size(n)` digits at `s`. */
+static void mul_karatsuba(mpn_digit const * a, mpn_digit const * b, size_t const n,
+                          mpn_digit * c, mpn_digit * s) {
+    if (n < KARATSUBA_THRESHOLD) {
+        mul_basecase(a, n, b, n, c);
+        return;
     }
+    // a = a0 + a1 * BASE^h and b = b0 + b1 * BASE^h, where a1 and b1 have hh >= h digits.
+    // Then a * b = z0 + (z0 + z2 - (a1 - a0) * (b1 - b0)) * BASE^h + z2 * BASE^(2h),
+    // where z0 = a0 * b0 and z2 = a1 * b1.
+    size_t h  = n / 2;
+    size_t hh = n - h;
+    mpn_digit * da   = s;
+    mpn_digit * db   = s + hh;
+    mpn_digit * z1   = s + 2*hh;
+    mpn_digit * rest = s + 4*hh;
+    bool neg = abs_diff(a + h, hh, a, h, da) != abs_diff(b + h, hh, b, h, db);
+    mul_karatsuba(a, b, h, c, rest);
+    mul_karatsuba(a + h, b + h, hh, c + 2*h, rest);
+    mul_karatsuba(da, db, hh, z1, rest);
+    // The scratch space of the recursive calls is free again, store the middle term there.
+    mpn_digit * t = rest;
+    for (size_t i = 0; i < 2*hh; i++)
+        t[i] = c[2*h + i];
+    t[2*hh] = 0;
+    add_to(t, 2*hh + 1, c, 2*h);
+    if (neg)
+        add_to(t, 2*hh + 1, z1, 2*hh);
+    else
+        sub_from(t, 2*hh + 1, z1, 2*hh);
+    add_to(c + h, 2*n - h, t, 2*hh + 1);
+}
 
-    const mpn_digit & operator[](size_t idx) const {
-        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+void mpn_mul(mpn_digit const * a, size_t const lnga,
+             mpn_digit const * b, size_t const lngb,
+             mpn_digit * c) {
+    if (lnga < lngb) {
+        mpn_mul(b, lngb, a, lnga, c);
+    } else if (lngb < KARATSUBA_THRESHOLD) {
+        mul_basecase(a, lnga, b, lngb, c);
+    } else if (lnga == lngb) {
+        mpn_buffer s(karatsuba_scratch_size(lnga));
+        mul_karatsuba(a, b, lnga, c, s.data());
+    } else {
+        // Split `a` into chunks of `lngb` digits, and add up their products with `b`.
+        mpn_buffer s(karatsuba_scratch_size(lngb));
+        mpn_buffer t(2*lngb);
+        for (size_t i = 0; i < lnga + lngb; i++)
+            c[i] = 0;
+        for (size_t off = 0; off < lnga; off += lngb) {
+            size_t len = lnga - off < lngb ? lnga - off : lngb;
+            if (len == lngb)
+                mul_karatsuba(a + off, b, lngb, t.data(), s.data());
+            else
+                mpn_mul(b, lngb, a + off, len, t.data());
+            add_to(c + off, lnga + lngb - off, t.data(), len + lngb);
+        }
     }
-};
+}
+
 
 static size_t div_normalize(mpn_digit const * numer, size_t const lnum,
                             mpn_digit const * denom, size_t const lden,
@@ -220,9 +338,25 @@ static void div_1(mpn_buffer & numer, mpn_digit const denom,
     }
 }
 
+/* r[0, n] -= q * a[0, n), returns the borrow. */
+static mpn_digit submul_1(mpn_digit * r, mpn_digit const * a, size_t const n, mpn_digit const q) {
+    mpn_digit k = 0;
+    mpn_digit borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        mpn_double_digit p = (mpn_double_digit)a[i] * (mpn_double_digit)q + k;
+        k = (mpn_digit)(p >> DIGIT_BITS);
+        mpn_double_digit t = (mpn_double_digit)r[i] - (mpn_double_digit)(mpn_digit)p - borrow;
+        r[i] = (mpn_digit)t;
+        borrow = (mpn_digit)(t >> DIGIT_BITS) & 1;
+    }
+    mpn_double_digit t = (mpn_double_digit)r[n] - (mpn_double_digit)k - borrow;
+    r[n] = (mpn_digit)t;
+    return (mpn_digit)(t >> DIGIT_BITS) & 1;
+}
+
 static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
                   mpn_digit * quot, mpn_digit * rem,
-                  mpn_buffer & ms, mpn_buffer & ab) {
+                  mpn_buffer & ab) {
     lean_assert(denom.size() > 1);
 
     // This is essentially Knuth's Algorithm D.
@@ -231,8 +365,6 @@ static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
 
     lean_assert(numer.size() == m+n);
 
-    ms.resize(n+1);
-
     mpn_double_digit q_hat, temp, r_hat;
     mpn_digit borrow;
 
@@ -251,8 +383,7 @@ static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
         // Replace numer[j+n]...numer[j] with
         // numer[j+n]...numer[j] - q * (denom[n-1]...denom[0])
         mpn_digit q_hat_small = (mpn_digit)q_hat;
-        mpn_mul(&q_hat_small, 1, denom.data(), n, ms.data());
-        mpn_sub(&numer[j], n+1, ms.data(), n+1, &numer[j], &borrow);
+        borrow = submul_1(&numer[j], denom.data(), n, q_hat_small);
         quot[j] = q_hat_small;
         if (borrow) {
             quot[j]--;
@@ -296,12 +427,12 @@ void mpn_div(mpn_digit const * numer, size_t const lnum,
             rem[i] = (i < lnum) ? numer[i] : 0;
     }
     else  {
-        mpn_buffer u, v, t_ms, t_ab;
+        mpn_buffer u, v, t_ab;
         size_t d = div_normalize(numer, lnum, denom, lden, u, v);
         if (lden == 1)
             div_1(u, v[0], quot);
         else
-            div_n(u, v, quot, rem, t_ms, t_ab);
+            div_n(u, v, quot, rem, t_ab);
         div_unnormalize(u, v, d, rem);
     }
 
@@ -38,11 +38,15 @@ mpz::mpz(int v) {
     mpz_init_set_si(m_val, v);
 }
 
-mpz::mpz(uint64 v):
-    mpz(static_cast<unsigned>(v)) {
-    mpz tmp(static_cast<unsigned>(v >> 32));
-    mpz_mul_2exp(tmp.m_val, tmp.m_val, 32);
-    mpz_add(m_val, m_val, tmp.m_val);
+mpz::mpz(uint64 v) {
+    if (sizeof(unsigned long) == sizeof(uint64)) { // NOLINT
+        mpz_init_set_ui(m_val, static_cast<unsigned long>(v)); // NOLINT
+    } else {
+        mpz_init_set_ui(m_val, static_cast<unsigned>(v));
+        mpz tmp(static_cast<unsigned>(v >> 32));
+        mpz_mul_2exp(tmp.m_val, tmp.m_val, 32);
+        mpz_add(m_val, m_val, tmp.m_val);
+    }
 }
 
 mpz::mpz(int64 v) {
@@ -114,6 +118,30 @@ size_t mpz::get_size_t() const {
     return static_cast<size_t>(mpz_getlimbn(m_val, 0));
 }
 
+#ifdef LEAN_HAS_UINT128
+mpz mpz::of_uint128(uint128 v) {
+    uint64 words[2] = { static_cast<uint64>(v), static_cast<uint64>(v >> 64) };
+    mpz r;
+    mpz_import(r.m_val, 2, -1, sizeof(uint64), 0, 0, words);
+    return r;
+}
+
+bool mpz::is_uint128() const {
+    return is_nonneg() && mpz_sizeinbase(m_val, 2) <= 128;
+}
+
+uint128 mpz::get_uint128() const {
+    lean_assert(is_uint128());
+    if (sizeof(mp_limb_t) == sizeof(uint64)) { // NOLINT
+        // NOTE: mpz_getlimbn returns 0 if the index is out of range
+        return (static_cast<uint128>(mpz_getlimbn(m_val, 1)) << 64) | static_cast<uint64>(mpz_getlimbn(m_val, 0));
+    }
+    uint64 words[2] = { 0, 0 };
+    mpz_export(words, nullptr, -1, sizeof(uint64), 0, 0, m_val);
+    return (static_cast<uint128>(words[1]) << 64) | words[0];
+}
+#endif
+
 mpz & mpz::operator=(mpz const & v) {
     mpz_set(m_val, v.m_val); return *this;
 }
@@ -433,6 +461,31 @@ size_t mpz::get_size_t() const {
     }
 }
 
+#ifdef LEAN_HAS_UINT128
+static constexpr unsigned uint128_digits = sizeof(uint128) / sizeof(mpn_digit);
+
+mpz mpz::of_uint128(uint128 v) {
+    mpn_digit digits[uint128_digits];
+    for (unsigned i = 0; i < uint128_digits; i++)
+        digits[i] = static_cast<mpn_digit>(v >> (i * 8*sizeof(mpn_digit)));
+    mpz r;
+    r.set(uint128_digits, digits);
+    return r;
+}
+
+bool mpz::is_uint128() const {
+    return !m_sign && m_size <= uint128_digits;
+}
+
+uint128 mpz::get_uint128() const {
+    lean_assert(is_uint128());
+    uint128 r = 0;
+    for (size_t i = m_size; i > 0; i--)
+        r = (r << 8*sizeof(mpn_digit)) | m_digits[i - 1];
+    return r;
+}
+#endif
+
 mpz & mpz::operator=(mpz const & v) {
     if (v.m_digits != m_digits) {
         if (v.m_size == m_size) {
@@ -20,6 +20,11 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+#if defined(__SIZEOF_INT128__)
+#define LEAN_HAS_UINT128
+__extension__ typedef unsigned __int128 uint128;
+#endif
+
 /** \brief Wrapper for GMP integers */
 class mpz {
     friend class object_compactor;
@@ -61,10 +66,20 @@ public:
         else
             return mpz((unsigned) v); // NOLINT
     }
+#ifdef LEAN_HAS_UINT128
+    static mpz of_uint128(uint128 v);
+#endif
     mpz(mpz const & s);
     mpz(mpz && s);
     ~mpz();
 
+    /* The memory block holding the digits, if any. */
+#ifdef LEAN_USE_GMP
+    void const * get_digits_mem() const { return m_val->_mp_d; }
+#else
+    void const * get_digits_mem() const { return m_digits; }
+#endif
+
 #ifdef LEAN_USE_GMP
     void set(mpz_t r) const;
 #endif
@@ -140,6 +155,12 @@ public:
     unsigned int get_unsigned_int() const;
     size_t get_size_t() const;
 
+#ifdef LEAN_HAS_UINT128
+    /** \brief Return true iff the value is nonnegative and fits in 128 bits. */
+    bool is_uint128() const;
+    uint128 get_uint128() const;
+#endif
+
     mpz & operator=(mpz const & v);
     mpz & operator=(mpz && v) { swap(*this, v); return *this; }
     mpz & operator=(char const * v);
@@ -9,6 +9,9 @@ Author: Leonardo de Moura
 #include <vector>
 #include <deque>
 #include <cmath>
+#include <chrono>
+#include <fstream>
+#include <unordered_map>
 #include <lean/lean.h>
 #include "runtime/object.h"
 #include "runtime/thread.h"
@@ -159,6 +162,27 @@ static inline void lean_dealloc(lean_object * o, size_t sz) {
 #endif
 }
 
+/* Resize the memory of the exclusive array, scalar array, or string `o` from `old_sz` to `new_sz` bytes.
+   Objects that are not managed by the small object allocator are resized using `realloc`, which can
+   often extend them in place or remap their pages instead of copying them. */
+static lean_object * lean_realloc_object(lean_object * o, size_t old_sz, size_t new_sz) {
+#ifdef LEAN_SMALL_ALLOCATOR
+    old_sz = lean_align(old_sz, LEAN_OBJECT_SIZE_DELTA);
+    new_sz = lean_align(new_sz, LEAN_OBJECT_SIZE_DELTA);
+    if (old_sz <= LEAN_MAX_SMALL_OBJECT_SIZE || new_sz <= LEAN_MAX_SMALL_OBJECT_SIZE) {
+        lean_object * r = lean_alloc_object(new_sz);
+        memcpy(r, o, std::min(old_sz, new_sz));
+        lean_dealloc(o, old_sz);
+        return r;
+    }
+#else
+    (void)old_sz;
+#endif
+    void * r = realloc(o, new_sz);
+    if (r == nullptr) lean_internal_panic_out_of_memory();
+    return static_cast<lean_object *>(r);
+}
+
 extern "C" LEAN_EXPORT void lean_free_object(lean_object * o) {
     switch (lean_ptr_tag(o)) {
     case LeanArray:       return lean_dealloc(o, lean_array_byte_size(o));
@@ -219,18 +243,55 @@ static inline void dec(lean_object * o, lean_object* & todo) {
     }
 }
 
+static void lean_del_core(object * o, object * & todo);
+
 #ifdef LEAN_LAZY_RC
+/* Deferred reference counting.
+   Freeing a dead object graph eagerly in `lean_dec_ref_cold` takes time proportional to its size, and produces
+   latency spikes when large data structures die. In this mode, dead objects are instead queued in the thread-local
+   list `g_to_free`, and every release of an object and every allocation using `lean_alloc_object` frees at most
+   `LEAN_LAZY_RC_BATCH` queued objects. Safe points (`check_system`) free larger batches, and the queue is emptied
+   when a task finishes and when the thread terminates. Objects are always freed by the thread that released them,
+   so finalizers of external objects may run later than in the default mode. */
+#ifndef LEAN_LAZY_RC_BATCH
+#define LEAN_LAZY_RC_BATCH 4
+#endif
+
 LEAN_THREAD_PTR(object, g_to_free);
+LEAN_THREAD_VALUE(bool, g_to_free_finalizer, false);
+
+static inline void free_deferred_core(size_t max) {
+    while (g_to_free != nullptr && max > 0) {
+        object * o = pop_back(g_to_free);
+        lean_del_core(o, g_to_free);
+        max--;
+    }
+}
+
+static void free_deferred_at_thread_exit(void *) {
+    free_deferred_core(SIZE_MAX);
+}
+
+static inline void push_deferred(object * o) {
+    if (LEAN_UNLIKELY(!g_to_free_finalizer)) {
+        g_to_free_finalizer = true;
+        register_thread_finalizer(free_deferred_at_thread_exit, nullptr);
+    }
+    push_back(g_to_free, o);
+}
 #endif
 
-static void lean_del_core(object * o, object * & todo);
+void free_deferred_objects(size_t max) {
+#ifdef LEAN_LAZY_RC
+    free_deferred_core(max);
+#else
+    (void)max;
+#endif
+}
 
 extern "C" LEAN_EXPORT lean_object * lean_alloc_object(size_t sz) {
 #ifdef LEAN_LAZY_RC
-     if (g_to_free) {
-         object * o = pop_back(g_to_free);
-         lean_del_core(o, g_to_free);
-     }
+    free_deferred_core(LEAN_LAZY_RC_BATCH);
 #endif
 #ifdef LEAN_SMALL_ALLOCATOR
     return (lean_object*)alloc(sz);
@@ -298,22 +359,136 @@ static void lean_del_core(object * o, object * & todo) {
     }
 }
 
-extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
-    if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_LAZY_RC)
+/* Background deletion of large dead object graphs.
+   If the environment variable `LEAN_DEFERRED_FREE_THRESHOLD` is set to `n > 0`, `lean_dec_ref_cold` frees at most
+   `n` objects of a dead multi-threaded object graph on the current thread, and hands the remaining objects over to
+   a dedicated reclaimer thread. We only do it for multi-threaded objects because all objects reachable from them are
+   multi-threaded too, and their reference counters can be safely updated from the reclaimer thread. */
+class reclaimer {
+    mutex                 m_mutex;
+    condition_variable    m_todo_cv;
+    condition_variable    m_finished_cv;
+    /* Each element is a list of dead objects linked using `push_back`. */
+    std::vector<object *> m_todo_lists;
+    bool                  m_running{false};
+    bool                  m_shutting_down{false};
+
+    void run() {
+        unique_lock<mutex> lock(m_mutex);
+        while (true) {
+            if (m_todo_lists.empty()) {
+                if (m_shutting_down)
+                    break;
+                m_todo_cv.wait(lock);
+                continue;
+            }
+            object * todo = m_todo_lists.back();
+            m_todo_lists.pop_back();
+            lock.unlock();
+            while (todo != nullptr) {
+                object * o = pop_back(todo);
+                lean_del_core(o, todo);
+            }
+            lock.lock();
+        }
+        m_running = false;
+        m_finished_cv.notify_all();
+    }
+
+public:
+    ~reclaimer() {
+        unique_lock<mutex> lock(m_mutex);
+        m_shutting_down = true;
+        m_todo_cv.notify_all();
+        m_finished_cv.wait(lock, [&]() { return !m_running; });
+    }
+
+    void push(object * todo) {
+        unique_lock<mutex> lock(m_mutex);
+        m_todo_lists.push_back(todo);
+        if (!m_running) {
+            m_running = true;
+            lthread([this]() {
+                save_stack_info(false);
+                run();
+            });
+        }
+        m_todo_cv.notify_one();
+    }
+};
+
+static unsigned    g_deferred_free_threshold = 0;
+static reclaimer * g_reclaimer = nullptr;
+#endif
+
+extern "C" LEAN_EXPORT void lean_dec_ref_last(lean_object * o) {
+    if (o->m_rc == 0) {
+        /* `o` is a multi-threaded object whose counter was decremented with release semantics, see `lean_dec_ref`.
+           Synchronize with the threads that released the other references before freeing it. */
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
 #ifdef LEAN_LAZY_RC
-        push_back(g_to_free, o);
+    push_deferred(o);
+    free_deferred_core(LEAN_LAZY_RC_BATCH);
 #else
-        object * todo = nullptr;
-        while (true) {
-            lean_del_core(o, todo);
-            if (todo == nullptr)
-                return;
-            o = pop_back(todo);
+    object * todo = nullptr;
+#if defined(LEAN_MULTI_THREAD)
+    /* The reference counter of `o` is now 0 iff `o` is a multi-threaded object. See `reclaimer`. */
+    unsigned budget = o->m_rc == 0 ? g_deferred_free_threshold : 0;
+#endif
+    while (true) {
+        lean_del_core(o, todo);
+        if (todo == nullptr)
+            return;
+#if defined(LEAN_MULTI_THREAD)
+        if (LEAN_UNLIKELY(budget != 0) && --budget == 0) {
+            g_reclaimer->push(todo);
+            return;
         }
 #endif
+        o = pop_back(todo);
     }
+#endif
+}
+
+/* Out-of-line version of `lean_dec_ref` for compilers without atomic builtins. */
+extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
+    if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_release) == -1)
+        lean_dec_ref_last(o);
+}
+
+
+// =======================================
+// Reference counting profiles
+
+/* Not deleted by `finalize_object`, as `save_rc_profile` runs at exit. */
+static mutex *        g_rc_sites_mutex = nullptr;
+static lean_rc_site * g_rc_sites       = nullptr;
+
+static void save_rc_profile() {
+    char const * fname = std::getenv("LEAN_RC_PROFILE");
+    if (!fname)
+        return;
+    std::ofstream out(fname, std::ios_base::app);
+    if (out.fail())
+        return;
+    lock_guard<mutex> lock(*g_rc_sites_mutex);
+    /* The counters are updated without synchronization, so they are approximate in multi-threaded programs. */
+    for (lean_rc_site * s = g_rc_sites; s != nullptr; s = s->m_next)
+        out << s->m_fn << "\t" << s->m_kind << "\t" << s->m_var << "\t" << s->m_count << "\n";
 }
 
+extern "C" LEAN_EXPORT void lean_rc_site_register(lean_rc_site * s) {
+    lock_guard<mutex> lock(*g_rc_sites_mutex);
+    if (s->m_registered)
+        return;
+    if (g_rc_sites == nullptr)
+        std::atexit(save_rc_profile);
+    s->m_next       = g_rc_sites;
+    s->m_registered = true;
+    g_rc_sites      = s;
+}
 
 // =======================================
 // Closures
@@ -365,6 +540,67 @@ extern "C" LEAN_EXPORT lean_obj_res lean_array_set_panic(lean_obj_arg a, lean_ob
 // =======================================
 // Thunks
 
+/*
+  Thunks under evaluation.
+
+  A thread forcing a thunk whose closure has already been taken by another thread spins for a
+  short while, since most thunks are cheap to evaluate. Then it parks on a condition variable
+  chosen by hashing the address of the thunk, which is the wait list of all thunks with the
+  same hash. The evaluating thread only touches the parking slot when its waiter counter is
+  nonzero, so forcing a thunk without contention is unchanged.
+
+  As for multi-threaded `ST.Ref`s in `io.cpp`, lost wakeups are impossible: a waiter increments
+  `m_waiters` before checking `m_value` under the slot mutex, and the evaluating thread stores
+  `m_value` before reading `m_waiters`.
+*/
+static unsigned const g_thunk_spin_limit     = 128;
+static unsigned const g_thunk_num_park_slots = 64;
+
+struct thunk_park_slot {
+    mutex              m_mutex;
+    condition_variable m_cv;
+    atomic<unsigned>   m_waiters{0};
+};
+
+static thunk_park_slot g_thunk_park_slots[g_thunk_num_park_slots];
+static atomic<uint64> g_thunk_num_contended{0};
+static atomic<uint64> g_thunk_num_parked{0};
+
+static inline thunk_park_slot & get_thunk_park_slot(b_obj_arg t) {
+    size_t h = reinterpret_cast<size_t>(t) / sizeof(lean_thunk_object);
+    return g_thunk_park_slots[(h ^ (h >> 6)) % g_thunk_num_park_slots];
+}
+
+/* Wake up threads waiting for the value of `t`. Must be called after storing the value into `t`. */
+static inline void thunk_notify(b_obj_arg t) {
+    thunk_park_slot & slot = get_thunk_park_slot(t);
+    if (slot.m_waiters.load() != 0) {
+        lock_guard<mutex> lock(slot.m_mutex);
+        slot.m_cv.notify_all();
+    }
+}
+
+/* Wait until the thread evaluating `t` has stored its value. */
+static object * thunk_wait(b_obj_arg t) {
+    g_thunk_num_contended++;
+    for (unsigned i = 0; i < g_thunk_spin_limit; i++) {
+        this_thread::yield();
+        if (object * v = lean_to_thunk(t)->m_value)
+            return v;
+    }
+    g_thunk_num_parked++;
+    thunk_park_slot & slot = get_thunk_park_slot(t);
+    slot.m_waiters++;
+    object * v;
+    {
+        unique_lock<mutex> lock(slot.m_mutex);
+        while ((v = lean_to_thunk(t)->m_value) == nullptr)
+            slot.m_cv.wait(lock);
+    }
+    slot.m_waiters--;
+    return v;
+}
+
 extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
     object * c = lean_to_thunk(t)->m_closure.exchange(nullptr);
     if (c != nullptr) {
@@ -374,24 +610,45 @@ extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
            The behavior is compatible with `cnstr_obj` with also returns a reference
            to be object stored in the constructor object.
 
-           Recall that `apply_1` also consumes `c`'s RC. */
-        object * r = lean_apply_1(c, lean_box(0));
+           Recall that `apply_1` also consumes `c`'s RC.
+
+           The value may be used by other threads and outlive the arenas of the current thread,
+           so it is never allocated in an arena. */
+        object * r;
+        {
+            scoped_no_arena no_arena;
+            r = lean_apply_1(c, lean_box(0));
+        }
         lean_assert(r != nullptr); /* Closure must return a valid lean object */
         lean_assert(lean_to_thunk(t)->m_value == nullptr);
         mark_mt(r);
         lean_to_thunk(t)->m_value = r;
+        thunk_notify(t);
         return r;
     } else {
         lean_assert(c == nullptr);
-        /* There is another thread executing the closure. We keep waiting for the m_value to be
+        /* There is another thread executing the closure. We wait for the m_value to be
            set by another thread. */
-        while (!lean_to_thunk(t)->m_value) {
-            this_thread::yield();
-        }
-        return lean_to_thunk(t)->m_value;
+        if (object * v = lean_to_thunk(t)->m_value)
+            return v;
+        return thunk_wait(t);
     }
 }
 
+/*
+structure ThunkContentionStats where
+  numContended : Nat
+  numParked    : Nat
+
+getThunkContentionStats : BaseIO ThunkContentionStats
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_get_thunk_contention_stats(obj_arg /* w */) {
+    object * r = alloc_cnstr(0, 2, 0);
+    cnstr_set(r, 0, lean_uint64_to_nat(g_thunk_num_contended.load()));
+    cnstr_set(r, 1, lean_uint64_to_nat(g_thunk_num_parked.load()));
+    return io_result_mk_ok(r);
+}
+
 // =======================================
 // Mark Persistent
 
@@ -474,6 +731,172 @@ extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
     }
 }
 
+// =======================================
+// Arenas
+
+#ifdef LEAN_SMALL_ALLOCATOR
+/* Apply `f` to the address of each field of `o` that may contain an object. */
+template<typename F> static void for_each_obj_field(object * o, F && f) {
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag <= LeanMaxCtorTag) {
+        object ** it  = lean_ctor_obj_cptr(o);
+        object ** end = it + lean_ctor_num_objs(o);
+        for (; it != end; ++it) f(it);
+        return;
+    }
+    switch (tag) {
+    case LeanClosure: {
+        object ** it  = lean_closure_arg_cptr(o);
+        object ** end = it + lean_closure_num_fixed(o);
+        for (; it != end; ++it) f(it);
+        break;
+    }
+    case LeanArray: {
+        object ** it  = lean_array_cptr(o);
+        object ** end = it + lean_array_size(o);
+        for (; it != end; ++it) f(it);
+        break;
+    }
+    case LeanThunk:
+        f(reinterpret_cast<object **>(&lean_to_thunk(o)->m_closure));
+        f(reinterpret_cast<object **>(&lean_to_thunk(o)->m_value));
+        break;
+    case LeanRef:
+        f(&lean_to_ref(o)->m_value);
+        break;
+    case LeanTask:
+        /* Tasks created by `Task.pure`, other tasks mark the enclosing arenas as escaped. */
+        if (lean_to_task(o)->m_imp == nullptr)
+            f(reinterpret_cast<object **>(&lean_to_task(o)->m_value));
+        break;
+    default:
+        break;
+    }
+}
+
+/* Move the objects of `a` reachable from `r` to the heap, or to the enclosing arena. Objects outside of `a`
+   are not copied, but their fields are updated if they point to moved objects, e.g., because they were
+   updated destructively. Return false without modifying any object if an object of `a` cannot be moved, or if
+   more objects are reachable from `r` than a small multiple of the number of objects allocated in `a`: the walk
+   is bounded by the work done in the arena, for results such as large data structures that were only slightly
+   updated in it.
+
+   The arena is only released if nothing but the result refers to its objects. Thread-local caches, e.g., of the
+   kernel or of the interpreter, may keep references to objects of the arena after the action has returned, and
+   freeing them would leave these references dangling. So we also return false if the reference count of a reachable
+   object of `a` exceeds the number of references from the walked objects, or if `a` has live objects that are not
+   reachable from `r`. */
+static bool move_out_of_arena(arena * a, object * & r) {
+    uint64 budget = 4 * arena_num_allocs(a) + 1024;
+    /* Maps the reachable objects of `a` to their copy, and the other ones to `nullptr`. */
+    std::unordered_map<object *, object *> copies;
+    /* Number of references to each object of `a` from the walked objects. */
+    std::unordered_map<object *, uint64> in_degree;
+    std::vector<object *> objs;
+    std::vector<object *> todo;
+    todo.push_back(r);
+    while (!todo.empty()) {
+        object * o = todo.back();
+        todo.pop_back();
+        if (o == nullptr || lean_is_scalar(o) || !lean_has_rc(o) || !copies.insert({o, nullptr}).second)
+            continue;
+        if (budget-- == 0)
+            return false;
+        /* External objects may store objects of the arena that we cannot update. */
+        if (lean_is_external(o) && arena_contains(a, o))
+            return false;
+        objs.push_back(o);
+        for_each_obj_field(o, [&](object ** f) {
+                object * c = *f;
+                if (c != nullptr && !lean_is_scalar(c) && arena_contains(a, c))
+                    in_degree[c]++;
+                todo.push_back(c);
+            });
+    }
+    uint64 num_reached = 0;
+    for (object * o : objs) {
+        if (!arena_contains(a, o))
+            continue;
+        num_reached++;
+        if (lean_is_mpz(o) && arena_contains(a, const_cast<void *>(to_mpz(o)->m_value.get_digits_mem())))
+            num_reached++;
+        /* the root is also referenced by `r` */
+        uint64 num_refs = in_degree[o] + (o == r ? 1 : 0);
+        if (o->m_rc <= 0 || static_cast<uint64>(o->m_rc) != num_refs)
+            return false;
+    }
+    if (num_reached != arena_num_live_objects(a))
+        return false;
+    for (object * o : objs) {
+        if (!arena_contains(a, o))
+            continue;
+        object * c;
+        if (lean_is_mpz(o)) {
+            /* The digits of `o` may have been allocated in the arena as well. */
+            c = alloc_mpz(to_mpz(o)->m_value);
+            c->m_rc = o->m_rc;
+            to_mpz(o)->m_value.~mpz();
+        } else {
+            unsigned sz = lean_small_object_size(o);
+            c = lean_alloc_small_object(sz);
+            memcpy(c, o, sz);
+        }
+        copies[o] = c;
+    }
+    auto update = [&](object ** f) {
+        if (*f == nullptr || lean_is_scalar(*f))
+            return;
+        auto it = copies.find(*f);
+        if (it != copies.end() && it->second != nullptr)
+            *f = it->second;
+    };
+    for (object * o : objs) {
+        object * c = copies[o];
+        for_each_obj_field(c ? c : o, update);
+    }
+    update(&r);
+    return true;
+}
+#endif
+
+/* withArena {α} (act : IO α) : IO α */
+extern "C" LEAN_EXPORT obj_res lean_io_with_arena(obj_arg act, obj_arg w) {
+#ifdef LEAN_SMALL_ALLOCATOR
+    scoped_arena scope;
+    object * r = apply_1(act, w);
+    arena * a = scope.release();
+    /* We keep the arena alive, i.e., leak its memory, if we cannot move the result out of it. */
+    if (!arena_escaped(a) && move_out_of_arena(a, r))
+        delete_arena(a);
+    return r;
+#else
+    return apply_1(act, w);
+#endif
+}
+
+// =======================================
+// Lazily initialized closed terms
+
+extern "C" LEAN_EXPORT b_obj_res lean_lazy_closed_term_core(object ** p, object * (*init)()) {
+    /* Recursive because the initializer may access other lazily initialized closed terms. */
+    static recursive_mutex g_lazy_closed_term_mutex;
+    lock_guard<recursive_mutex> lock(g_lazy_closed_term_mutex);
+    if (object * r = *p)
+        return r;
+    /* The closed term outlives the arenas of the current thread. */
+    scoped_no_arena no_arena;
+    object * r = init();
+    /* Same as the eager initialization of closed terms in the module initializer. */
+    lean_mark_persistent(r);
+#ifdef LEAN_INLINE_ATOMIC_RC
+    /* `lean_lazy_closed_term` reads `*p` without taking the lock */
+    __atomic_store_n(p, r, __ATOMIC_RELEASE);
+#else
+    *p = r;
+#endif
+    return r;
+}
+
 // =======================================
 // Mark MT
 
@@ -491,12 +914,19 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 #endif
     if (lean_is_scalar(o) || !lean_is_st(o)) return;
 
+    /* Objects marked as multi-threaded are stored in tasks or global caches, so the active arenas of the current
+       thread cannot be released if one of their objects is reached. */
+    bool check_arena = has_active_arena();
     buffer<object*> todo;
     todo.push_back(o);
     while (!todo.empty()) {
         object * o = todo.back();
         todo.pop_back();
         if (!lean_is_scalar(o) && lean_is_st(o)) {
+            if (check_arena && in_active_arena(o)) {
+                mark_arena_escaped();
+                check_arena = false;
+            }
             o->m_rc = -o->m_rc;
             uint8_t tag = lean_ptr_tag(o);
             if (tag <= LeanMaxCtorTag) {
@@ -551,6 +981,200 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 
 LEAN_THREAD_PTR(lean_task_object, g_current_task_object);
 
+/*
+Opt-in tracer for the task manager, enabled by setting `LEAN_TASK_TRACE` to the name of an output file.
+
+It records when tasks are enqueued, run and finished, and the dependency edges created by `add_dep`.
+Spans of `time_task` categories (see `task_trace_begin`) are recorded on the thread executing them.
+When the task manager is finalized, the trace is written in the Chrome trace event format, which can be
+opened in `chrome://tracing` or Perfetto. Dependency edges are rendered as flow arrows, and the critical path,
+i.e. the chain of dependencies ending at the task that finished last, is stored in `otherData`.
+*/
+class task_tracer {
+    struct event {
+        char        m_ph;      // 'B'/'E' (span), 'i' (enqueued)
+        uint64      m_task;    // 0 for `time_task` spans
+        uint64      m_ts;
+        unsigned    m_tid;
+        std::string m_name;
+    };
+    struct task_info {
+        uint64   m_finished{0};
+        unsigned m_finished_tid{0};
+        std::vector<std::pair<uint64, unsigned>> m_starts;
+    };
+    mutex                                              m_mutex;
+    std::string                                        m_fname;
+    std::chrono::steady_clock::time_point              m_start;
+    atomic<unsigned>                                   m_next_tid{0};
+    uint64                                             m_next_id{0};
+    std::unordered_map<lean_task_object *, uint64>     m_ids;
+    std::unordered_map<uint64, task_info>              m_tasks;
+    std::vector<event>                                 m_events;
+    std::vector<std::pair<uint64, uint64>>             m_deps;
+
+    uint64 now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    unsigned tid();
+
+    uint64 get_id(lean_task_object * t) {
+        auto it = m_ids.find(t);
+        if (it != m_ids.end())
+            return it->second;
+        uint64 id = ++m_next_id;
+        m_ids[t] = id;
+        return id;
+    }
+
+    static void write_escaped(std::ostream & out, std::string const & s) {
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+    }
+
+    std::vector<uint64> critical_path() {
+        uint64 last = 0, last_ts = 0;
+        for (auto const & p : m_tasks) {
+            if (p.second.m_finished > last_ts) {
+                last    = p.first;
+                last_ts = p.second.m_finished;
+            }
+        }
+        std::unordered_map<uint64, uint64> pred;
+        for (auto const & d : m_deps) {
+            uint64 & p = pred[d.second];
+            if (p == 0 || m_tasks[d.first].m_finished > m_tasks[p].m_finished)
+                p = d.first;
+        }
+        std::vector<uint64> path;
+        for (uint64 t = last; t != 0 && path.size() <= m_tasks.size(); t = pred[t])
+            path.push_back(t);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+public:
+    explicit task_tracer(char const * fname):m_fname(fname), m_start(std::chrono::steady_clock::now()) {}
+
+    void enqueued(lean_task_object * t) {
+        unsigned tid = this->tid();
+        lock_guard<mutex> lock(m_mutex);
+        m_events.push_back({'i', get_id(t), now(), tid, std::string()});
+    }
+
+    uint64 started(lean_task_object * t) {
+        unsigned tid = this->tid();
+        lock_guard<mutex> lock(m_mutex);
+        uint64 id = get_id(t);
+        uint64 ts = now();
+        m_tasks[id].m_starts.emplace_back(ts, tid);
+        m_events.push_back({'B', id, ts, tid, std::string()});
+        return id;
+    }
+
+    void stopped(uint64 id) {
+        unsigned tid = this->tid();
+        lock_guard<mutex> lock(m_mutex);
+        m_events.push_back({'E', id, now(), tid, std::string()});
+    }
+
+    void finished(lean_task_object * t) {
+        unsigned tid = this->tid();
+        lock_guard<mutex> lock(m_mutex);
+        task_info & info   = m_tasks[get_id(t)];
+        info.m_finished     = now();
+        info.m_finished_tid = tid;
+    }
+
+    void dep(lean_task_object * t1, lean_task_object * t2) {
+        lock_guard<mutex> lock(m_mutex);
+        m_deps.emplace_back(get_id(t1), get_id(t2));
+    }
+
+    void freed(lean_task_object * t) {
+        lock_guard<mutex> lock(m_mutex);
+        m_ids.erase(t);
+    }
+
+    void span(char ph, std::string const & name) {
+        unsigned tid = this->tid();
+        lock_guard<mutex> lock(m_mutex);
+        m_events.push_back({ph, 0, now(), tid, name});
+    }
+
+    void write() {
+        lock_guard<mutex> lock(m_mutex);
+        std::ofstream out(m_fname);
+        if (!out)
+            return;
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto sep = [&]() { out << (first ? "" : ",\n"); first = false; };
+        for (event const & e : m_events) {
+            sep();
+            out << "{\"ph\":\"" << e.m_ph << "\",\"pid\":1,\"tid\":" << e.m_tid << ",\"ts\":" << e.m_ts;
+            if (e.m_task == 0) {
+                out << ",\"cat\":\"time_task\",\"name\":\"";
+                write_escaped(out, e.m_name);
+                out << "\"}";
+            } else if (e.m_ph == 'i') {
+                out << ",\"s\":\"t\",\"cat\":\"task\",\"name\":\"enqueue\",\"args\":{\"task\":" << e.m_task << "}}";
+            } else {
+                out << ",\"cat\":\"task\",\"name\":\"task " << e.m_task << "\"}";
+            }
+        }
+        uint64 flow_id = 0;
+        for (auto const & d : m_deps) {
+            task_info const & from = m_tasks[d.first];
+            task_info const & to   = m_tasks[d.second];
+            if (from.m_finished == 0)
+                continue;
+            for (auto const & st : to.m_starts) {
+                if (st.first < from.m_finished)
+                    continue;
+                flow_id++;
+                sep();
+                out << "{\"ph\":\"s\",\"pid\":1,\"tid\":" << from.m_finished_tid << ",\"ts\":" << from.m_finished
+                    << ",\"id\":" << flow_id << ",\"cat\":\"dep\",\"name\":\"dep\"},\n";
+                out << "{\"ph\":\"f\",\"bp\":\"e\",\"pid\":1,\"tid\":" << st.second << ",\"ts\":" << st.first
+                    << ",\"id\":" << flow_id << ",\"cat\":\"dep\",\"name\":\"dep\"}";
+                break;
+            }
+        }
+        out << "\n],\"otherData\":{\"criticalPath\":\"";
+        std::vector<uint64> path = critical_path();
+        for (size_t i = 0; i < path.size(); i++)
+            out << (i == 0 ? "" : " -> ") << "task " << path[i];
+        out << "\"}}\n";
+    }
+};
+
+static task_tracer * g_task_tracer = nullptr;
+LEAN_THREAD_VALUE(unsigned, g_task_tracer_tid, 0);
+
+unsigned task_tracer::tid() {
+    if (g_task_tracer_tid == 0)
+        g_task_tracer_tid = ++m_next_tid;
+    return g_task_tracer_tid;
+}
+
+void task_trace_begin(std::string const & name) {
+    if (g_task_tracer)
+        g_task_tracer->span('B', name);
+}
+
+void task_trace_end(std::string const & name) {
+    if (g_task_tracer)
+        g_task_tracer->span('E', name);
+}
+
 static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive) {
     lean_task_imp * imp = (lean_task_imp*)lean_alloc_small_object(sizeof(lean_task_imp));
     imp->m_closure     = c;
@@ -568,6 +1192,7 @@ static void free_task_imp(lean_task_imp * imp) {
 }
 
 static void free_task(lean_task_object * t) {
+    if (g_task_tracer) g_task_tracer->freed(t);
     if (t->m_imp) free_task_imp(t->m_imp);
     lean_free_small_object((lean_object*)t);
 }
@@ -576,12 +1201,94 @@ struct scoped_current_task_object : flet<lean_task_object *> {
     scoped_current_task_object(lean_task_object * t):flet(g_current_task_object, t) {}
 };
 
+/* Task queue owned by a single standard worker in work-stealing mode.
+   The owner pushes and pops at the back of the highest priority deque, other workers
+   steal from the front. The queue is protected by its own mutex, so spawning a task
+   from a worker thread does not need to take `task_manager::m_mutex`. */
+struct worker_queue {
+    mutex                                         m_mutex;
+    std::deque<lean_task_object *>                m_queues[LEAN_MAX_PRIO+1];
+    atomic<unsigned>                              m_max_prio{0};
+    atomic<unsigned>                              m_size{0};
+    /* NUMA node of the CPU the owner is pinned to when worker affinity is enabled. */
+    unsigned                                      m_node{0};
+
+    void push(lean_task_object * t) {
+        unsigned prio = t->m_imp->m_prio;
+        lean_assert(prio <= LEAN_MAX_PRIO);
+        if (prio > m_max_prio)
+            m_max_prio = prio;
+        m_queues[prio].push_back(t);
+        m_size++;
+    }
+
+    lean_task_object * pop(bool owner) {
+        lean_assert(m_size != 0);
+        std::deque<lean_task_object *> & q = m_queues[m_max_prio];
+        lean_assert(!q.empty());
+        lean_task_object * result;
+        if (owner) {
+            result = q.back();
+            q.pop_back();
+        } else {
+            result = q.front();
+            q.pop_front();
+        }
+        m_size--;
+        if (q.empty()) {
+            unsigned prio = m_max_prio;
+            while (prio > 0) {
+                --prio;
+                if (!m_queues[prio].empty())
+                    break;
+            }
+            m_max_prio = prio;
+        }
+        return result;
+    }
+};
+
+LEAN_THREAD_PTR(worker_queue, g_worker_queue);
+
+/* The number of dedicated workers can be bounded by setting the environment variable `LEAN_NUM_IO_THREADS`.
+   By default the pool grows as needed, since dedicated tasks may block indefinitely waiting for each other. */
+static unsigned get_lean_num_io_threads() {
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * num_threads = std::getenv("LEAN_NUM_IO_THREADS")) {
+        return atoi(num_threads);
+    }
+#endif
+    return 0;
+}
+
+/* Idle dedicated workers exit after this many milliseconds without work. */
+static unsigned const g_dedicated_worker_idle_ms = 10000;
+
+/* Task tracing can be enabled by setting the environment variable `LEAN_TASK_TRACE` to an output file name. */
+static char const * get_lean_task_trace() {
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * fname = std::getenv("LEAN_TASK_TRACE")) {
+        if (*fname)
+            return fname;
+    }
+#endif
+    return nullptr;
+}
+
 class task_manager {
     mutex                                         m_mutex;
-    unsigned                                      m_num_std_workers{0};
+    atomic<unsigned>                              m_num_std_workers{0};
     unsigned                                      m_idle_std_workers{0};
     unsigned                                      m_max_std_workers{0};
     unsigned                                      m_num_dedicated_workers{0};
+    /* Dedicated workers form a separate pool of reusable threads for (typically blocking) tasks with
+       priority `> LEAN_MAX_PRIO`, so that they neither occupy standard workers nor need a fresh thread each.
+       If `m_max_dedicated_workers` is nonzero, at most that many dedicated workers exist and further
+       dedicated tasks wait in `m_dedicated_queue`. */
+    unsigned                                      m_idle_dedicated_workers{0};
+    unsigned                                      m_max_dedicated_workers{0};
+    std::deque<lean_task_object *>                m_dedicated_queue;
+    condition_variable                            m_dedicated_cv;
     std::deque<lean_task_object *>                m_queues[LEAN_MAX_PRIO+1];
     unsigned                                      m_queues_size{0};
     unsigned                                      m_max_prio{0};
@@ -589,6 +1296,17 @@ class task_manager {
     condition_variable                            m_task_finished_cv;
     condition_variable                            m_worker_finished_cv;
     bool                                          m_shutting_down{false};
+    /* Work-stealing mode: one queue per standard worker. Empty if the mode is disabled. */
+    std::vector<std::unique_ptr<worker_queue>>    m_worker_queues;
+    /* Total number of tasks in `m_worker_queues`. */
+    atomic<unsigned>                              m_worker_queues_size{0};
+    /* Number of standard workers blocked on `m_queue_cv`. */
+    atomic<unsigned>                              m_sleeping_std_workers{0};
+    /* If true, standard worker `i` is pinned to CPU `m_cpus[i % m_cpus.size()]`. */
+    bool                                          m_affinity{false};
+    /* The CPUs in the affinity mask of the process, or empty if it could not be read, in which case workers
+       are not pinned. */
+    std::vector<unsigned>                         m_cpus;
 
     lean_task_object * dequeue() {
         lean_assert(m_queues_size != 0);
@@ -609,21 +1327,91 @@ class task_manager {
 
     void enqueue_core(lean_task_object * t) {
         lean_assert(t->m_imp);
+        if (g_task_tracer) g_task_tracer->enqueued(t);
         unsigned prio = t->m_imp->m_prio;
         if (prio > LEAN_MAX_PRIO) {
-            spawn_dedicated_worker(t);
+            enqueue_dedicated_core(t);
+            return;
+        }
+        if (try_enqueue_local(t)) {
+            notify_new_task_core();
             return;
         }
         if (prio > m_max_prio)
             m_max_prio = prio;
         m_queues[prio].push_back(t);
         m_queues_size++;
+        notify_new_task_core();
+    }
+
+    void enqueue_dedicated_core(lean_task_object * t) {
+        m_dedicated_queue.push_back(t);
+        if (m_dedicated_queue.size() <= m_idle_dedicated_workers)
+            m_dedicated_cv.notify_one();
+        else if (m_max_dedicated_workers == 0 || m_num_dedicated_workers < m_max_dedicated_workers)
+            spawn_dedicated_worker();
+    }
+
+    void notify_new_task_core() {
         if (!m_idle_std_workers && m_num_std_workers < m_max_std_workers)
             spawn_worker();
         else
             m_queue_cv.notify_one();
     }
 
+    /* In work-stealing mode, push `t` to the queue of the current worker thread.
+       Return `false` if `t` must go through the shared queues instead. */
+    bool try_enqueue_local(lean_task_object * t) {
+        worker_queue * q = g_worker_queue;
+        if (!q || t->m_imp->m_prio > LEAN_MAX_PRIO)
+            return false;
+        unique_lock<mutex> lock(q->m_mutex);
+        q->push(t);
+        m_worker_queues_size++;
+        return true;
+    }
+
+    /* Pop a task from the worker queue `q`, or steal one from another worker.
+       We take the highest priority task among all worker queues. On ties, the queue of the
+       current worker is preferred, and when worker affinity is enabled, victims on the same
+       NUMA node as `q` come next, so that dependent tasks, which are pushed to the queue of
+       the worker that finished their dependency, tend to stay on the node of their producer.
+       The caller is responsible for comparing against the shared queue, see `prefer_shared_queue`.
+       Return `nullptr` if the chosen queue was emptied concurrently; the caller should retry. */
+    lean_task_object * dequeue_local(worker_queue * q, unsigned idx) {
+        if (m_worker_queues_size == 0)
+            return nullptr;
+        worker_queue * best = nullptr;
+        unsigned best_prio  = 0;
+        unsigned n = m_worker_queues.size();
+        for (unsigned i = 1; i < n; i++) {
+            worker_queue * v = m_worker_queues[(idx + i) % n].get();
+            if (v->m_size == 0)
+                continue;
+            unsigned prio = v->m_max_prio;
+            if (!best || prio > best_prio ||
+                (prio == best_prio && m_affinity && v->m_node == q->m_node && best->m_node != q->m_node)) {
+                best      = v;
+                best_prio = prio;
+            }
+        }
+        if (q->m_size != 0 && (!best || q->m_max_prio >= best_prio)) {
+            unique_lock<mutex> lock(q->m_mutex);
+            if (q->m_size != 0) {
+                m_worker_queues_size--;
+                return q->pop(true);
+            }
+        }
+        if (best) {
+            unique_lock<mutex> lock(best->m_mutex);
+            if (best->m_size != 0) {
+                m_worker_queues_size--;
+                return best->pop(false);
+            }
+        }
+        return nullptr;
+    }
+
     void deactivate_task_core(unique_lock<mutex> & lock, lean_task_object * t) {
         object * c              = t->m_imp->m_closure;
         lean_task_object * it   = t->m_imp->m_head_dep;
@@ -642,22 +1430,61 @@ class task_manager {
         lock.lock();
     }
 
+    /* Return the highest priority of a task in the worker queues, or `-1` if they are empty. */
+    int max_worker_queues_prio() const {
+        int prio = -1;
+        for (auto const & v : m_worker_queues) {
+            if (v->m_size != 0)
+                prio = std::max(prio, static_cast<int>(v->m_max_prio.load()));
+        }
+        return prio;
+    }
+
+    /* Return `true` if the shared queue contains a task with higher priority than all tasks in the worker queues. */
+    bool prefer_shared_queue(worker_queue * q) const {
+        if (m_queues_size == 0)
+            return false;
+        return !q || m_worker_queues_size == 0 || static_cast<int>(m_max_prio) > max_worker_queues_prio();
+    }
+
     void spawn_worker() {
-        m_num_std_workers++;
-        lthread([this]() {
+        unsigned idx = m_num_std_workers++;
+        worker_queue * q = m_worker_queues.empty() ? nullptr : m_worker_queues[idx].get();
+        lthread([this, q, idx]() {
             save_stack_info(false);
+            if (m_affinity && !m_cpus.empty())
+                set_thread_affinity(m_cpus[idx % m_cpus.size()]);
+            g_worker_queue = q;
             unique_lock<mutex> lock(m_mutex);
             m_idle_std_workers++;
             while (true) {
-                if (m_queues_size == 0) {
-                    if (m_shutting_down) {
+                lean_task_object * t = nullptr;
+                if (prefer_shared_queue(q)) {
+                    t = dequeue();
+                } else if (q) {
+                    lock.unlock();
+                    t = dequeue_local(q, idx);
+                    lock.lock();
+                    if (!t && m_queues_size != 0)
+                        t = dequeue();
+                }
+                if (!t) {
+                    if (m_shutting_down && m_worker_queues_size == 0) {
                         break;
                     }
-                    m_queue_cv.wait(lock);
+                    if (q) {
+                        /* `try_enqueue_local` does not acquire `m_mutex`, so we must re-check the worker queues
+                           after announcing that we are about to sleep. See `enqueue`. */
+                        m_sleeping_std_workers++;
+                        if (m_worker_queues_size == 0 && !m_shutting_down)
+                            m_queue_cv.wait(lock);
+                        m_sleeping_std_workers--;
+                    } else {
+                        m_queue_cv.wait(lock);
+                    }
                     continue;
                 }
 
-                lean_task_object * t = dequeue();
                 m_idle_std_workers--;
                 run_task(lock, t);
                 m_idle_std_workers++;
@@ -665,17 +1492,33 @@ class task_manager {
             }
             m_idle_std_workers--;
             m_num_std_workers--;
+            g_worker_queue = nullptr;
             m_worker_finished_cv.notify_all();
         });
         // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
     }
 
-    void spawn_dedicated_worker(lean_task_object * t) {
+    void spawn_dedicated_worker() {
         m_num_dedicated_workers++;
-        lthread([this, t]() {
+        lthread([this]() {
             save_stack_info(false);
             unique_lock<mutex> lock(m_mutex);
-            run_task(lock, t);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_dedicated_worker_idle_ms);
+            while (true) {
+                if (!m_dedicated_queue.empty()) {
+                    lean_task_object * t = m_dedicated_queue.front();
+                    m_dedicated_queue.pop_front();
+                    run_task(lock, t);
+                    reset_heartbeat();
+                    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_dedicated_worker_idle_ms);
+                    continue;
+                }
+                if (m_shutting_down || std::chrono::steady_clock::now() >= deadline)
+                    break;
+                m_idle_dedicated_workers++;
+                m_dedicated_cv.wait_for(lock, chrono::milliseconds(g_dedicated_worker_idle_ms));
+                m_idle_dedicated_workers--;
+            }
             m_num_dedicated_workers--;
             m_worker_finished_cv.notify_all();
         });
@@ -695,11 +1538,18 @@ class task_manager {
             object * c = t->m_imp->m_closure;
             t->m_imp->m_closure = nullptr;
             lock.unlock();
+            uint64 trace_id = g_task_tracer ? g_task_tracer->started(t) : 0;
             v = lean_apply_1(c, box(0));
+            if (g_task_tracer) g_task_tracer->stopped(trace_id);
             // If deactivation was delayed by `m_keep_alive`, deactivate after the final execution (`v != nulltpr`)
             if (v != nullptr && t->m_imp->m_keep_alive) {
                 lean_dec_ref((lean_object*)t);
             }
+#ifdef LEAN_LAZY_RC
+            /* Do not delay the objects released by the task until the next task executed by this worker. */
+            free_deferred_objects(SIZE_MAX);
+#endif
+            trim_stack();
             lock.lock();
         }
         lean_assert(t->m_imp);
@@ -720,6 +1570,7 @@ class task_manager {
     }
 
     void resolve_core(lean_task_object * t, object * v) {
+        if (g_task_tracer) g_task_tracer->finished(t);
         handle_finished(t);
         mark_mt(v);
         t->m_value = v;
@@ -759,26 +1610,62 @@ class task_manager {
     }
 
 public:
-    task_manager(unsigned max_std_workers):
-        m_max_std_workers(max_std_workers) {
+    /* Worker affinity requires the per-worker queues, so `affinity` implies `work_stealing`. */
+    task_manager(unsigned max_std_workers, bool work_stealing, bool affinity):
+        m_max_std_workers(max_std_workers), m_max_dedicated_workers(get_lean_num_io_threads()), m_affinity(affinity) {
+        if (char const * fname = get_lean_task_trace())
+            g_task_tracer = new task_tracer(fname);
+        if (affinity)
+            m_cpus = get_affinity_cpus();
+        if (work_stealing || affinity) {
+            for (unsigned i = 0; i < max_std_workers; i++) {
+                m_worker_queues.emplace_back(new worker_queue());
+                if (!m_cpus.empty())
+                    m_worker_queues.back()->m_node = get_cpu_numa_node(m_cpus[i % m_cpus.size()]);
+            }
+        }
     }
 
     ~task_manager() {
         unique_lock<mutex> lock(m_mutex);
         m_shutting_down = true;
         m_queue_cv.notify_all();
+        m_dedicated_cv.notify_all();
         // wait for all workers to finish
         m_worker_finished_cv.wait(lock, [&]() { return m_num_std_workers + m_num_dedicated_workers == 0; });
+        if (g_task_tracer) {
+            g_task_tracer->write();
+            delete g_task_tracer;
+            g_task_tracer = nullptr;
+        }
     }
 
     void enqueue(lean_task_object * t) {
+        if (g_task_tracer && t->m_imp->m_prio <= LEAN_MAX_PRIO && g_worker_queue)
+            g_task_tracer->enqueued(t);
+        if (try_enqueue_local(t)) {
+            /* Fast path for tasks spawned by a worker: only wake up other workers if some of them
+               are sleeping or more workers may still be spawned. */
+            if (m_sleeping_std_workers != 0 || m_num_std_workers < m_max_std_workers) {
+                unique_lock<mutex> lock(m_mutex);
+                notify_new_task_core();
+            }
+            return;
+        }
         unique_lock<mutex> lock(m_mutex);
         enqueue_core(t);
     }
 
+    object * get_value_if_finished(lean_task_object * t) {
+        unique_lock<mutex> lock(m_mutex);
+        return t->m_value;
+    }
+
     void resolve(lean_task_object * t, object * v) {
         unique_lock<mutex> lock(m_mutex);
         if (t->m_value) {
+            /* `v` may contain tasks, whose deactivation acquires `m_mutex`. */
+            lock.unlock();
             dec(v);
             return;
         }
@@ -787,6 +1674,7 @@ public:
 
     void add_dep(lean_task_object * t1, lean_task_object * t2) {
         lean_assert(t2->m_value == nullptr);
+        if (g_task_tracer) g_task_tracer->dep(t1, t2);
         if (t1->m_value) {
             enqueue(t2);
             return;
@@ -810,6 +1698,22 @@ public:
         m_task_finished_cv.wait(lock, [&]() { return t->m_value != nullptr; });
     }
 
+    /* Wait until all tasks of the array `tasks` have finished, waking up once per finished task instead of once
+       per task of the array. */
+    void wait_all(object * tasks) {
+        size_t n = lean_array_size(tasks);
+        size_t i = 0;
+        auto finished = [&]() {
+            while (i < n && lean_to_task(lean_array_get_core(tasks, i))->m_value)
+                i++;
+            return i == n;
+        };
+        if (finished())
+            return;
+        unique_lock<mutex> lock(m_mutex);
+        m_task_finished_cv.wait(lock, finished);
+    }
+
     object * wait_any(object * task_list) {
         if (object * t = wait_any_check(task_list))
             return t;
@@ -848,11 +1752,31 @@ public:
 
 static task_manager * g_task_manager = nullptr;
 
+/* Work-stealing mode can be enabled by setting the environment variable `LEAN_WORK_STEALING=1`. */
+static bool get_lean_work_stealing() {
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * ws = std::getenv("LEAN_WORK_STEALING")) {
+        return atoi(ws) != 0;
+    }
+#endif
+    return false;
+}
+
+/* Pinning workers to CPUs can be enabled by setting the environment variable `LEAN_WORKER_AFFINITY=1`. */
+static bool get_lean_worker_affinity() {
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * aff = std::getenv("LEAN_WORKER_AFFINITY")) {
+        return atoi(aff) != 0;
+    }
+#endif
+    return false;
+}
+
 extern "C" LEAN_EXPORT void lean_init_task_manager_using(unsigned num_workers) {
     lean_assert(g_task_manager == nullptr);
 #if defined(LEAN_MULTI_THREAD)
     if (num_workers > 0) {
-        g_task_manager = new task_manager(num_workers);
+        g_task_manager = new task_manager(num_workers, get_lean_work_stealing(), get_lean_worker_affinity());
     }
 #endif
 }
@@ -881,7 +1805,7 @@ scoped_task_manager::scoped_task_manager(unsigned num_workers) {
     lean_assert(g_task_manager == nullptr);
 #if defined(LEAN_MULTI_THREAD)
     if (num_workers > 0) {
-        g_task_manager = new task_manager(num_workers);
+        g_task_manager = new task_manager(num_workers, get_lean_work_stealing(), get_lean_worker_affinity());
     }
 #endif
 }
@@ -912,6 +1836,7 @@ static inline void lean_set_task_header(lean_object * o) {
 
 static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive) {
     lean_mark_mt(c);
+    mark_arena_escaped();
     lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
     lean_set_task_header((lean_object*)o);
     o->m_value = nullptr;
@@ -1022,15 +1947,27 @@ extern "C" LEAN_EXPORT bool lean_io_has_finished_core(b_obj_arg t) {
     return lean_to_task(t)->m_value != nullptr;
 }
 
+b_obj_res task_get_value_if_finished(b_obj_arg t) {
+    if (g_task_manager)
+        return g_task_manager->get_value_if_finished(lean_to_task(t));
+    return lean_to_task(t)->m_value;
+}
+
 extern "C" LEAN_EXPORT b_obj_res lean_io_wait_any_core(b_obj_arg task_list) {
     return g_task_manager->wait_any(task_list);
 }
 
+extern "C" LEAN_EXPORT void lean_io_wait_all_core(b_obj_arg tasks) {
+    if (g_task_manager)
+        g_task_manager->wait_all(tasks);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_promise_new(obj_arg) {
     lean_always_assert(g_task_manager);
     bool keep_alive = false;
     unsigned prio = 0;
     object * closure = nullptr;
+    mark_arena_escaped();
     lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
     lean_set_task_header((lean_object*)o);
     o->m_value = nullptr;
@@ -1043,6 +1980,103 @@ extern "C" LEAN_EXPORT obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg
     return io_result_mk_ok(box(0));
 }
 
+/*
+  Shared state of the chunks of `Array.parMap`. Each chunk writes its results to distinct
+  indices of `m_result`, and the last chunk to finish, i.e., the one that decrements
+  `m_pending` to zero, resolves `m_promise` with it.
+*/
+struct par_map_state {
+    object *       m_result;
+    object *       m_promise;
+    atomic<size_t> m_pending;
+    par_map_state(object * result, object * promise, size_t pending):
+        m_result(result), m_promise(promise), m_pending(pending) {}
+    ~par_map_state() {
+        if (m_result) dec(m_result);
+        dec(m_promise);
+    }
+};
+
+static lean_external_class * g_par_map_state_class = nullptr;
+
+static void par_map_state_finalizer(void * s) {
+    delete static_cast<par_map_state *>(s);
+}
+
+static void par_map_state_foreach(void *, b_obj_arg) {}
+
+static obj_res par_map_chunk_fn(obj_arg f, obj_arg as, obj_arg st, obj_arg lo, obj_arg hi, obj_arg) {
+    par_map_state * s = static_cast<par_map_state *>(lean_get_external_data(st));
+    object ** out = lean_array_cptr(s->m_result);
+    size_t end = unbox(hi);
+    for (size_t i = unbox(lo); i < end; i++) {
+        object * a = lean_array_get_core(as, i);
+        inc(a);
+        inc(f);
+        out[i] = apply_1(f, a);
+    }
+    if (s->m_pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+        object * r  = s->m_result;
+        s->m_result = nullptr;
+        g_task_manager->resolve(lean_to_task(s->m_promise), r);
+    }
+    dec(f);
+    dec(as);
+    dec(st);
+    return box(0);
+}
+
+/* Array.parMap (f : α → β) (as : Array α) (chunkSize : Nat) (prio : Task.Priority) : Task (Array β) */
+extern "C" LEAN_EXPORT obj_res lean_array_par_map(obj_arg f, obj_arg as, obj_arg chunk_size, obj_arg prio) {
+    size_t n = lean_array_size(as);
+    size_t chunk = is_scalar(chunk_size) ? unbox(chunk_size) : n;
+    dec(chunk_size);
+    if (chunk == 0)
+        chunk = n / (4 * std::max(hardware_concurrency(), 1u));
+    chunk = std::max(chunk, static_cast<size_t>(1));
+    object * result = alloc_array(n, n);
+    if (!g_task_manager || n <= chunk) {
+        for (size_t i = 0; i < n; i++) {
+            object * a = lean_array_get_core(as, i);
+            inc(a);
+            inc(f);
+            lean_array_cptr(result)[i] = apply_1(f, a);
+        }
+        dec(f);
+        dec(as);
+        return lean_task_pure(result);
+    }
+    for (size_t i = 0; i < n; i++)
+        lean_array_cptr(result)[i] = box(0);
+    size_t num_chunks = (n + chunk - 1) / chunk;
+    object * r = lean_io_promise_new(io_mk_world());
+    object * promise = lean_io_result_get_value(r);
+    inc(promise);
+    dec(r);
+    inc(promise);
+    object * st = lean_alloc_external(g_par_map_state_class, new par_map_state(result, promise, num_chunks));
+    mark_mt(f);
+    mark_mt(as);
+    mark_mt(st);
+    for (size_t lo = 0; lo < n; lo += chunk) {
+        object * c = lean_alloc_closure((void*)par_map_chunk_fn, 6, 5);
+        inc(f);
+        inc(as);
+        inc(st);
+        lean_closure_set(c, 0, f);
+        lean_closure_set(c, 1, as);
+        lean_closure_set(c, 2, st);
+        lean_closure_set(c, 3, box(lo));
+        lean_closure_set(c, 4, box(std::min(lo + chunk, n)));
+        /* The chunks are not referenced by anyone, so they must be kept alive until they have run. */
+        dec(lean_task_spawn_core(c, unbox(prio), true));
+    }
+    dec(f);
+    dec(as);
+    dec(st);
+    return promise;
+}
+
 // =======================================
 // Natural numbers
 
@@ -1063,11 +2097,24 @@ extern "C" LEAN_EXPORT void lean_extract_mpz_value(lean_object * o, mpz_t v) {
 }
 #endif
 
+object * alloc_mpz(mpz && m) {
+    void * mem = lean_alloc_small_object(sizeof(mpz_object));
+    mpz_object * o = new (mem) mpz_object(std::move(m));
+    lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+    return (lean_object*)o;
+}
+
 object * mpz_to_nat_core(mpz const & m) {
     lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
     return alloc_mpz(m);
 }
 
+/* The results of bignum operations are temporaries, which we move into the new object instead of copying them. */
+object * mpz_to_nat_core(mpz && m) {
+    lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
+    return alloc_mpz(std::move(m));
+}
+
 static inline obj_res mpz_to_nat(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
         return lean_box(m.get_size_t());
@@ -1075,6 +2122,36 @@ static inline obj_res mpz_to_nat(mpz const & m) {
         return mpz_to_nat_core(m);
 }
 
+static inline obj_res mpz_to_nat(mpz && m) {
+    if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
+        return lean_box(m.get_size_t());
+    else
+        return mpz_to_nat_core(std::move(m));
+}
+
+#ifdef LEAN_HAS_UINT128
+/* Fast paths for arithmetic on values of at most 128 bits, which are frequent when overflowing 64-bit
+   arithmetic is implemented using `Nat`. They avoid creating temporary `mpz` values for the operands. */
+static inline obj_res uint128_to_nat(uint128 v) {
+    if (v <= LEAN_MAX_SMALL_NAT)
+        return lean_box(static_cast<size_t>(v));
+    else
+        return mpz_to_nat_core(mpz::of_uint128(v));
+}
+
+static inline bool nat_to_uint128(b_obj_arg a, uint128 & r) {
+    if (lean_is_scalar(a)) {
+        r = lean_unbox(a);
+        return true;
+    } else if (mpz_value(a).is_uint128()) {
+        r = mpz_value(a).get_uint128();
+        return true;
+    } else {
+        return false;
+    }
+}
+#endif
+
 extern "C" LEAN_EXPORT object * lean_cstr_to_nat(char const * n) {
     return mpz_to_nat(mpz(n));
 }
@@ -1101,6 +2178,11 @@ extern "C" LEAN_EXPORT object * lean_nat_big_succ(object * a) {
 
 extern "C" LEAN_EXPORT object * lean_nat_big_add(object * a1, object * a2) {
     lean_assert(!lean_is_scalar(a1) || !lean_is_scalar(a2));
+#ifdef LEAN_HAS_UINT128
+    uint128 v1, v2, r;
+    if (nat_to_uint128(a1, v1) && nat_to_uint128(a2, v2) && !__builtin_add_overflow(v1, v2, &r))
+        return uint128_to_nat(r);
+#endif
     if (lean_is_scalar(a1))
         return mpz_to_nat_core(mpz::of_size_t(lean_unbox(a1)) + mpz_value(a2));
     else if (lean_is_scalar(a2))
@@ -1111,6 +2193,11 @@ extern "C" LEAN_EXPORT object * lean_nat_big_add(object * a1, object * a2) {
 
 extern "C" LEAN_EXPORT object * lean_nat_big_sub(object * a1, object * a2) {
     lean_assert(!lean_is_scalar(a1) || !lean_is_scalar(a2));
+#ifdef LEAN_HAS_UINT128
+    uint128 v1, v2;
+    if (nat_to_uint128(a1, v1) && nat_to_uint128(a2, v2))
+        return v1 < v2 ? lean_box(0) : uint128_to_nat(v1 - v2);
+#endif
     if (lean_is_scalar(a1)) {
         lean_assert(mpz::of_size_t(lean_unbox(a1)) < mpz_value(a2));
         return lean_box(0);
@@ -1127,6 +2214,11 @@ extern "C" LEAN_EXPORT object * lean_nat_big_sub(object * a1, object * a2) {
 
 extern "C" LEAN_EXPORT object * lean_nat_big_mul(object * a1, object * a2) {
     lean_assert(!lean_is_scalar(a1) || !lean_is_scalar(a2));
+#ifdef LEAN_HAS_UINT128
+    uint128 v1, v2, r;
+    if (nat_to_uint128(a1, v1) && nat_to_uint128(a2, v2) && !__builtin_mul_overflow(v1, v2, &r))
+        return uint128_to_nat(r);
+#endif
     if (lean_is_scalar(a1))
         return mpz_to_nat(mpz::of_size_t(lean_unbox(a1)) * mpz_value(a2));
     else if (lean_is_scalar(a2))
@@ -1136,7 +2228,11 @@ extern "C" LEAN_EXPORT object * lean_nat_big_mul(object * a1, object * a2) {
 }
 
 extern "C" LEAN_EXPORT object * lean_nat_overflow_mul(size_t a1, size_t a2) {
+#ifdef LEAN_HAS_UINT128
+    return uint128_to_nat(static_cast<uint128>(a1) * a2);
+#else
     return mpz_to_nat(mpz::of_size_t(a1) * mpz::of_size_t(a2));
+#endif
 }
 
 extern "C" LEAN_EXPORT object * lean_nat_big_div(object * a1, object * a2) {
@@ -1541,6 +2637,21 @@ extern "C" LEAN_EXPORT obj_res lean_float_frexp(double a) {
 
 static inline char * w_string_cstr(object * o) { lean_assert(lean_is_string(o)); return lean_to_string(o)->m_data; }
 
+/* Strings of at least `LEAN_STRING_HASH_CACHE_MIN_SIZE` bytes cache their hash in the last 8 bytes of their capacity,
+   which `lean_mk_string_core` reserves for them. `m_other` is `1` while the cached hash is valid, and the functions
+   that update an exclusive string in place reset it. Only single-threaded strings are written to: persistent strings
+   may be in read-only memory, and strings shared between threads could be hashed concurrently. */
+#ifndef LEAN_STRING_HASH_CACHE_MIN_SIZE
+#define LEAN_STRING_HASH_CACHE_MIN_SIZE 128
+#endif
+
+static inline bool string_has_hash_slot(b_obj_arg o) {
+    return lean_string_size(o) >= LEAN_STRING_HASH_CACHE_MIN_SIZE &&
+        lean_string_capacity(o) >= lean_string_size(o) + sizeof(uint64);
+}
+
+static inline void string_reset_hash(object * o) { o->m_other = 0; }
+
 static object * string_ensure_capacity(object * o, size_t extra) {
     lean_assert(is_exclusive(o));
     size_t sz  = string_size(o);
@@ -1558,7 +2669,8 @@ static object * string_ensure_capacity(object * o, size_t extra) {
 
 extern "C" LEAN_EXPORT object * lean_mk_string_core(char const * s, size_t sz, size_t len) {
     size_t rsz = sz + 1;
-    object * r = lean_alloc_string(rsz, rsz, len);
+    size_t cap = rsz >= LEAN_STRING_HASH_CACHE_MIN_SIZE ? rsz + sizeof(uint64) : rsz;
+    object * r = lean_alloc_string(rsz, cap, len);
     memcpy(w_string_cstr(r), s, sz);
     w_string_cstr(r)[sz] = 0;
     return r;
@@ -1606,6 +2718,7 @@ extern "C" LEAN_EXPORT object * lean_string_push(object * s, unsigned c) {
         lean_dec_ref(s);
     } else {
         r = string_ensure_capacity(s, 5);
+        string_reset_hash(r);
     }
     unsigned consumed = push_unicode_scalar(w_string_cstr(r) + sz - 1, c);
     lean_to_string(r)->m_size   = sz + consumed;
@@ -1620,7 +2733,7 @@ extern "C" LEAN_EXPORT object * lean_string_append(object * s1, object * s2) {
     size_t len1     = lean_string_len(s1);
     size_t len2     = lean_string_len(s2);
     size_t new_len  = len1 + len2;
-    unsigned new_sz = sz1 + sz2 - 1;
+    size_t new_sz   = sz1 + sz2 - 1;
     object * r;
     if (!lean_is_exclusive(s1)) {
         r = lean_alloc_string(new_sz, mk_capacity(new_sz), new_len);
@@ -1629,6 +2742,7 @@ extern "C" LEAN_EXPORT object * lean_string_append(object * s1, object * s2) {
     } else {
         lean_assert(s1 != s2);
         r = string_ensure_capacity(s1, sz2-1);
+        string_reset_hash(r);
     }
     memcpy(w_string_cstr(r) + sz1 - 1, lean_string_cstr(s2), sz2 - 1);
     lean_to_string(r)->m_size   = new_sz;
@@ -1862,6 +2976,36 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b
     return lean_mk_string_from_bytes(lean_string_cstr(s) + b, new_sz);
 }
 
+/* Json.nextSpecialPos : (@& String) → (@& String.Pos) → String.Pos
+   Position of the first '"', '\\' or control character at or after `i0`, or the end position. Eight bytes are
+   tested at a time; the special characters are ASCII, so no UTF-8 continuation byte can match. */
+extern "C" LEAN_EXPORT obj_res lean_json_next_special_pos(b_obj_arg s, b_obj_arg i0) {
+    usize sz = lean_string_size(s) - 1;
+    if (!lean_is_scalar(i0) || lean_unbox(i0) >= sz)
+        return lean_box(sz);
+    unsigned char const * str = reinterpret_cast<unsigned char const *>(lean_string_cstr(s));
+    usize i = lean_unbox(i0);
+    const uint64 ones  = 0x0101010101010101ull;
+    const uint64 highs = 0x8080808080808080ull;
+    for (; i + 8 <= sz; i += 8) {
+        uint64 v;
+        memcpy(&v, str + i, sizeof(v));
+        uint64 q = v ^ (ones * '"');
+        uint64 b = v ^ (ones * '\\');
+        /* A byte of `x` is zero iff the corresponding byte of `(x - ones) & ~x & highs` is nonzero; a byte of `v` is
+           below 0x20 iff the same holds for `(v - ones * 0x20) & ~v & highs`. */
+        uint64 m = ((q - ones) & ~q) | ((b - ones) & ~b) | ((v - ones * 0x20) & ~v);
+        if (m & highs)
+            break;
+    }
+    for (; i < sz; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c < 0x20)
+            break;
+    }
+    return lean_box(i);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0) {
     if (!lean_is_scalar(i0)) {
         /* See comment at string_utf8_get */
@@ -1879,6 +3023,116 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0)
     return lean_box(i);
 }
 
+extern "C" LEAN_EXPORT obj_res lean_string_offset_of_pos(b_obj_arg s, b_obj_arg i0) {
+    usize sz = lean_string_size(s) - 1;
+    /* See comment at string_utf8_get */
+    usize i  = lean_is_scalar(i0) ? std::min(static_cast<usize>(lean_unbox(i0)), sz) : sz;
+    return lean_usize_to_nat(utf8_strlen(lean_string_cstr(s), i));
+}
+
+/* Position of the first occurrence of `pat[0:m]` in `str[i:n]`, or `n` if there is none. Candidates are located with
+   `memchr`, which the C library implements with vector instructions. As both strings are valid UTF-8, a match always
+   starts at a character boundary, so the byte positions agree with the character-wise reference implementations. */
+static usize find_bytes(char const * str, usize n, usize i, char const * pat, usize m) {
+    if (m == 0) return i;
+    while (i + m <= n) {
+        void const * p = memchr(str + i, pat[0], n - m + 1 - i);
+        if (p == nullptr) return n;
+        i = static_cast<char const *>(p) - str;
+        if (memcmp(str + i + 1, pat + 1, m - 1) == 0) return i;
+        i++;
+    }
+    return n;
+}
+
+/* String.posOf : (@& String) → Char → String.Pos */
+extern "C" LEAN_EXPORT obj_res lean_string_pos_of(b_obj_arg s, uint32 c) {
+    char const * str = lean_string_cstr(s);
+    usize sz = lean_string_size(s) - 1;
+    char pat[4];
+    unsigned m = push_unicode_scalar(pat, c);
+    return lean_box(find_bytes(str, sz, 0, pat, m));
+}
+
+/* String.contains : (@& String) → Char → Bool */
+extern "C" LEAN_EXPORT uint8 lean_string_contains(b_obj_arg s, uint32 c) {
+    usize sz = lean_string_size(s) - 1;
+    return lean_unbox(lean_string_pos_of(s, c)) < sz;
+}
+
+/* String.startsWith : (@& String) → (@& String) → Bool */
+extern "C" LEAN_EXPORT uint8 lean_string_starts_with(b_obj_arg s, b_obj_arg pre) {
+    usize sz = lean_string_size(pre) - 1;
+    return sz <= lean_string_size(s) - 1 && memcmp(lean_string_cstr(s), lean_string_cstr(pre), sz) == 0;
+}
+
+/* String.endsWith : (@& String) → (@& String) → Bool */
+extern "C" LEAN_EXPORT uint8 lean_string_ends_with(b_obj_arg s, b_obj_arg post) {
+    usize sz      = lean_string_size(s) - 1;
+    usize post_sz = lean_string_size(post) - 1;
+    return post_sz <= sz && memcmp(lean_string_cstr(s) + sz - post_sz, lean_string_cstr(post), post_sz) == 0;
+}
+
+/* String.splitOn : (@& String) → (@& String) → List String */
+extern "C" LEAN_EXPORT obj_res lean_string_split_on(b_obj_arg s, b_obj_arg sep) {
+    char const * str = lean_string_cstr(s);
+    usize sz  = lean_string_size(s) - 1;
+    usize m   = lean_string_size(sep) - 1;
+    std::vector<usize> starts;
+    starts.push_back(0);
+    if (m > 0) {
+        usize i = find_bytes(str, sz, 0, lean_string_cstr(sep), m);
+        while (i < sz) {
+            starts.push_back(i + m);
+            i = find_bytes(str, sz, i + m, lean_string_cstr(sep), m);
+        }
+    }
+    /* build the list from the last piece, which ends at `sz` */
+    obj_res r = lean_box(0);
+    usize e   = sz;
+    for (usize k = starts.size(); k > 0; k--) {
+        usize b = starts[k - 1];
+        obj_res piece;
+        if (b == 0 && e == sz) {
+            lean_inc(s);
+            piece = s;
+        } else {
+            piece = lean_mk_string_from_bytes(str + b, e - b);
+        }
+        obj_res new_r = lean_alloc_ctor(1, 2, 0);
+        lean_ctor_set(new_r, 0, piece);
+        lean_ctor_set(new_r, 1, r);
+        r = new_r;
+        e = b - m;
+    }
+    return r;
+}
+
+/* String.replace : (@& String) → (@& String) → (@& String) → String */
+extern "C" LEAN_EXPORT obj_res lean_string_replace(b_obj_arg s, b_obj_arg pattern, b_obj_arg replacement) {
+    char const * str = lean_string_cstr(s);
+    usize sz  = lean_string_size(s) - 1;
+    usize m   = lean_string_size(pattern) - 1;
+    usize i   = find_bytes(str, sz, 0, lean_string_cstr(pattern), m);
+    if (m == 0 || i == sz) {
+        lean_inc(s);
+        return s;
+    }
+    std::string r;
+    usize num = 0;
+    usize b   = 0;
+    while (i < sz) {
+        r.append(str + b, i - b);
+        r.append(lean_string_cstr(replacement), lean_string_size(replacement) - 1);
+        num++;
+        b = i + m;
+        i = find_bytes(str, sz, b, lean_string_cstr(pattern), m);
+    }
+    r.append(str + b, sz - b);
+    usize len = lean_string_len(s) - num * lean_string_len(pattern) + num * lean_string_len(replacement);
+    return lean_mk_string_core(r.data(), r.size(), len);
+}
+
 static unsigned get_utf8_char_size_at(std::string const & s, usize i) {
     if (auto sz = get_utf8_first_byte_opt(s[i])) {
         return *sz;
@@ -1899,6 +3153,7 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_set(obj_arg s, b_obj_arg i0, uin
     if (lean_is_exclusive(s)) {
         if (static_cast<unsigned char>(str[i]) < 128 && c < 128) {
             str[i] = c;
+            string_reset_hash(s);
             return s;
         }
     }
@@ -1916,7 +3171,123 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_set(obj_arg s, b_obj_arg i0, uin
 extern "C" LEAN_EXPORT uint64 lean_string_hash(b_obj_arg s) {
     usize sz = lean_string_size(s) - 1;
     char const * str = lean_string_cstr(s);
-    return hash_str(sz, (unsigned char const *) str, 11);
+    uint64 h;
+    if (s->m_other == 1) {
+        memcpy(&h, str + lean_string_capacity(s) - sizeof(uint64), sizeof(uint64));
+        return h;
+    }
+#if defined(LEAN_FAST_STRING_HASH)
+    h = hash_str_wy(sz, (unsigned char const *) str, 11);
+#else
+    h = hash_str(sz, (unsigned char const *) str, 11);
+#endif
+    if (lean_is_st(s) && string_has_hash_slot(s)) {
+        memcpy(w_string_cstr(s) + lean_string_capacity(s) - sizeof(uint64), &h, sizeof(uint64));
+        s->m_other = 1;
+    }
+    return h;
+}
+
+static char const g_digit_pairs[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/* Nat.repr : (@& Nat) → String
+   Small numbers are formatted two digits at a time from the end, big numbers by GMP or our own `mpz`. */
+extern "C" LEAN_EXPORT obj_res lean_nat_repr(b_obj_arg n) {
+    if (!lean_is_scalar(n))
+        return mk_string(mpz_value(n).to_string());
+    char buf[24];
+    char * end = buf + sizeof(buf);
+    char * p   = end;
+    usize v    = lean_unbox(n);
+    while (v >= 100) {
+        usize q = v / 100;
+        p -= 2;
+        memcpy(p, g_digit_pairs + 2 * (v - q * 100), 2);
+        v = q;
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, g_digit_pairs + 2 * v, 2);
+    } else {
+        *--p = static_cast<char>('0' + v);
+    }
+    return lean_mk_string_core(p, end - p, end - p);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/* Whether the eight bytes of `v` are ASCII digits. A byte is below '0' iff subtracting 0x30 sets its high bit, and
+   above '9' iff adding 0x46 does. */
+static inline bool is_eight_digits(uint64 v) {
+    return (((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) & 0x8080808080808080ull) == 0;
+}
+
+/* The value of the eight ASCII digits of `v`, combining pairs of digits, then pairs of pairs. */
+static inline uint64 parse_eight_digits(uint64 v) {
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    return (((v & 0x000000FF000000FFull) * 0x000F424000000064ull) +
+            (((v >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+}
+#endif
+
+/* String.toNat? : (@& String) → Option Nat
+   Numbers of up to 19 digits fit in a `uint64`, they are parsed eight digits at a time on little-endian platforms. */
+extern "C" LEAN_EXPORT obj_res lean_string_to_nat(b_obj_arg s) {
+    usize sz = lean_string_size(s) - 1;
+    unsigned char const * str = reinterpret_cast<unsigned char const *>(lean_string_cstr(s));
+    if (sz == 0)
+        return lean_box(0);
+    obj_res r;
+    if (sz <= 19) {
+        uint64 v = 0;
+        usize i  = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (; i + 8 <= sz; i += 8) {
+            uint64 d;
+            memcpy(&d, str + i, sizeof(d));
+            if (!is_eight_digits(d))
+                return lean_box(0);
+            v = v * 100000000 + parse_eight_digits(d);
+        }
+#endif
+        for (; i < sz; i++) {
+            unsigned d = str[i] - '0';
+            if (d > 9)
+                return lean_box(0);
+            v = v * 10 + d;
+        }
+        r = lean_uint64_to_nat(v);
+    } else {
+        for (usize i = 0; i < sz; i++) {
+            if (static_cast<unsigned>(str[i] - '0') > 9)
+                return lean_box(0);
+        }
+        r = lean_cstr_to_nat(reinterpret_cast<char const *>(str));
+    }
+    obj_res o = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(o, 0, r);
+    return o;
+}
+
+/* Native implementation of `Lean.FuzzyMatching.charMask`. */
+extern "C" LEAN_EXPORT uint64 lean_fuzzy_char_mask(b_obj_arg s) {
+    usize sz = lean_string_size(s) - 1;
+    unsigned char const * str = reinterpret_cast<unsigned char const *>(lean_string_cstr(s));
+    uint64 m = 0;
+    for (usize i = 0; i < sz; i++) {
+        unsigned c = str[i];
+        if ('A' <= c && c <= 'Z')
+            c += 'a' - 'A';
+        if ('a' <= c && c <= 'z')
+            m |= static_cast<uint64>(1) << (c - 'a');
+        else if (c < 128)
+            m |= static_cast<uint64>(1) << (26 + c % 37);
+        else
+            m |= (static_cast<uint64>(1) << 63) | 1;
+    }
+    return m;
 }
 
 // =======================================
@@ -1938,6 +3309,14 @@ extern "C" LEAN_EXPORT obj_res lean_copy_sarray(obj_arg a, size_t cap) {
     unsigned esz   = lean_sarray_elem_size(a);
     size_t sz      = lean_sarray_size(a);
     lean_assert(cap >= sz);
+    if (lean_is_exclusive(a)) {
+        if (cap == lean_sarray_capacity(a))
+            return a;
+        // grow in place if possible
+        object * r = lean_realloc_object(a, lean_sarray_byte_size(a), sizeof(lean_sarray_object) + esz*cap);
+        lean_to_sarray(r)->m_capacity = cap;
+        return r;
+    }
     object * r     = lean_alloc_sarray(esz, sz, cap);
     uint8 * it     = lean_sarray_cptr(a);
     uint8 * dest   = lean_sarray_cptr(r);
@@ -2024,6 +3403,32 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_byte_array_fill(obj_arg a, uint8 v) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    memset(lean_sarray_cptr(r), v, lean_sarray_size(r));
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_byte_array_index_of(b_obj_arg a, uint8 v, b_obj_arg o_start) {
+    size_t sz = lean_sarray_size(a);
+    if (!lean_is_scalar(o_start) || lean_unbox(o_start) >= sz)
+        return lean_box(sz);
+    size_t start = lean_unbox(o_start);
+    uint8 const * it = lean_sarray_cptr(a);
+    void const * r = memchr(it + start, v, sz - start);
+    return lean_box(r ? static_cast<uint8 const *>(r) - it : sz);
+}
+
+/* Lexicographic comparison, returns the `Ordering` constructor index. */
+extern "C" LEAN_EXPORT uint8 lean_byte_array_compare(b_obj_arg a, b_obj_arg b) {
+    size_t asz = lean_sarray_size(a);
+    size_t bsz = lean_sarray_size(b);
+    int c = memcmp(lean_sarray_cptr(a), lean_sarray_cptr(b), std::min(asz, bsz));
+    if (c == 0)
+        return asz < bsz ? 0 : (asz == bsz ? 1 : 2);
+    return c < 0 ? 0 : 2;
+}
+
 extern "C" LEAN_EXPORT obj_res lean_copy_float_array(obj_arg a) {
     return lean_copy_sarray(a, lean_sarray_capacity(a));
 }
@@ -2063,6 +3468,45 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_float_array_fill(obj_arg a, double d) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    std::fill_n(lean_float_array_cptr(r), lean_sarray_size(r), d);
+    return r;
+}
+
+/* The reductions below use four independent accumulators so that the loops can be vectorized without
+   reassociating floating point operations, which the C compiler is not allowed to do by itself. */
+extern "C" LEAN_EXPORT double lean_float_array_sum(b_obj_arg a) {
+    size_t n = lean_sarray_size(a);
+    double const * it = lean_float_array_cptr(a);
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (unsigned j = 0; j < 4; j++)
+            acc[j] += it[i + j];
+    }
+    double r = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; i++)
+        r += it[i];
+    return r;
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_dot(b_obj_arg a, b_obj_arg b) {
+    size_t n = std::min(lean_sarray_size(a), lean_sarray_size(b));
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (unsigned j = 0; j < 4; j++)
+            acc[j] += x[i + j] * y[i + j];
+    }
+    double r = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; i++)
+        r += x[i] * y[i];
+    return r;
+}
+
 // =======================================
 // Array functions for generated code
 
@@ -2090,30 +3534,55 @@ extern "C" LEAN_EXPORT object * lean_mk_array(obj_arg n, obj_arg v) {
     return r;
 }
 
-extern "C" LEAN_EXPORT obj_res lean_copy_expand_array(obj_arg a, bool expand) {
+/* Return an array with the elements of `a` and capacity `cap`, reusing the memory of `a` if it is exclusive. */
+static obj_res lean_copy_array_with_capacity(obj_arg a, size_t cap) {
     size_t sz      = lean_array_size(a);
-    size_t cap     = lean_array_capacity(a);
     lean_assert(cap >= sz);
-    if (expand) cap = (cap + 1) * 2;
-    lean_assert(!expand || cap > sz);
+    if (lean_is_exclusive(a)) {
+        if (cap == lean_array_capacity(a))
+            return a;
+        // grow in place if possible, which also transfers ownership of the elements
+        object * r = lean_realloc_object(a, lean_array_byte_size(a), sizeof(lean_array_object) + sizeof(void*)*cap);
+        lean_to_array(r)->m_capacity = cap;
+        return r;
+    }
     object * r     = lean_alloc_array(sz, cap);
     object ** it   = lean_array_cptr(a);
     object ** end  = it + sz;
     object ** dest = lean_array_cptr(r);
-    if (lean_is_exclusive(a)) {
-        // transfer ownership of elements directly instead of inc+dec
-        memcpy(dest, it, sz * sizeof(object *));
-        lean_dealloc(a, lean_array_byte_size(a));
-    } else {
-        for (; it != end; ++it, ++dest) {
-            *dest = *it;
-            lean_inc(*it);
-        }
-        lean_dec(a);
+    for (; it != end; ++it, ++dest) {
+        *dest = *it;
+        lean_inc(*it);
     }
+    lean_dec(a);
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_copy_expand_array(obj_arg a, bool expand) {
+    size_t cap = lean_array_capacity(a);
+    lean_assert(cap >= lean_array_size(a));
+    if (expand) cap = (cap + 1) * 2;
+    lean_assert(!expand || cap > lean_array_size(a));
+    return lean_copy_array_with_capacity(a, cap);
+}
+
+static size_t reserve_capacity(size_t sz, b_obj_arg n) {
+    if (!lean_is_scalar(n) || sz + lean_unbox(n) < sz)
+        lean_internal_panic_out_of_memory();
+    return sz + lean_unbox(n);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_array_reserve(obj_arg a, b_obj_arg n) {
+    size_t min_cap = reserve_capacity(lean_array_size(a), n);
+    if (min_cap <= lean_array_capacity(a))
+        return a;
+    return lean_copy_array_with_capacity(a, min_cap);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_sarray_reserve(obj_arg a, b_obj_arg n) {
+    return lean_sarray_ensure_capacity(a, reserve_capacity(lean_sarray_size(a), n), /* exact */ true);
+}
+
 extern "C" LEAN_EXPORT object * lean_array_push(obj_arg a, obj_arg v) {
     object * r;
     if (lean_is_exclusive(a)) {
@@ -2151,7 +3620,7 @@ extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2)
             if (!lean_string_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         } else {
-            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n1, 1)))
+            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         }
         n1 = lean_ctor_get(n1, 0);
@@ -2225,11 +3694,29 @@ extern "C" LEAN_EXPORT lean_external_class * lean_register_external_class(lean_e
 void initialize_object() {
     g_ext_classes       = new std::vector<external_object_class*>();
     g_ext_classes_mutex = new mutex();
+    g_rc_sites_mutex    = new mutex();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
+    g_par_map_state_class = lean_register_external_class(par_map_state_finalizer, par_map_state_foreach);
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_LAZY_RC)
+    if (char const * threshold = std::getenv("LEAN_DEFERRED_FREE_THRESHOLD")) {
+        if (atoi(threshold) > 0) {
+            g_deferred_free_threshold = atoi(threshold);
+            g_reclaimer = new reclaimer();
+        }
+    }
+#endif
 }
 
 void finalize_object() {
+    free_deferred_objects(SIZE_MAX);
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_LAZY_RC)
+    if (g_reclaimer) {
+        g_deferred_free_threshold = 0;
+        delete g_reclaimer;
+        g_reclaimer = nullptr;
+    }
+#endif
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
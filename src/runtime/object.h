@@ -28,6 +28,7 @@ struct mpz_object {
     mpz         m_value;
     mpz_object() {}
     explicit mpz_object(mpz const & m):m_value(m) {}
+    explicit mpz_object(mpz && m):m_value(std::move(m)) {}
 };
 
 typedef lean_external_class         external_object_class;
@@ -179,6 +180,7 @@ inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply
 // MPZ
 
 object * alloc_mpz(mpz const &);
+object * alloc_mpz(mpz &&);
 inline mpz_object * to_mpz(object * o) { lean_assert(is_mpz(o)); return (mpz_object*)o; }
 
 // =======================================
@@ -286,6 +288,14 @@ inline obj_res task_pure(obj_arg a) { return lean_task_pure(a); }
 inline obj_res task_bind(obj_arg x, obj_arg f, unsigned prio = 0, bool keep_alive = false) { return lean_task_bind_core(x, f, prio, keep_alive); }
 inline obj_res task_map(obj_arg f, obj_arg t, unsigned prio = 0, bool keep_alive = false) { return lean_task_map_core(f, t, prio, keep_alive); }
 inline b_obj_res task_get(b_obj_arg t) { return lean_task_get(t); }
+/* The value of `t` if it has finished, and `nullptr` otherwise, without waiting. The value is read under the lock of
+   the task manager, so that the objects reachable from it are visible to the calling thread. */
+b_obj_res task_get_value_if_finished(b_obj_arg t);
+
+/* Record the beginning/end of a span named `name` on the current thread if task tracing is enabled
+   (see `LEAN_TASK_TRACE`). Calls must be properly nested. */
+void task_trace_begin(std::string const & name);
+void task_trace_end(std::string const & name);
 
 inline bool io_check_canceled_core() { return lean_io_check_canceled_core(); }
 inline void io_cancel_core(b_obj_arg t) { return lean_io_cancel_core(t); }
@@ -310,6 +320,7 @@ inline obj_res mk_option_some(obj_arg v) { obj_res r = alloc_cnstr(1, 1, 0); cns
 
 inline mpz const & mpz_value(b_obj_arg o) { return to_mpz(o)->m_value; }
 object * mpz_to_nat_core(mpz const & m);
+object * mpz_to_nat_core(mpz && m);
 inline object * mk_nat_obj_core(mpz const & m) { return mpz_to_nat_core(m); }
 inline obj_res mk_nat_obj(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
@@ -474,6 +485,10 @@ inline obj_res st_ref_swap(b_obj_arg r, obj_arg v, obj_arg w) { return lean_st_r
 
 // =======================================
 // Module initialization/finalization
+/* Free at most `max` objects whose release has been deferred in the current thread. Only relevant when the runtime
+   is compiled with deferred reference counting (`LAZY_RC`). */
+void free_deferred_objects(size_t max);
+
 void initialize_object();
 void finalize_object();
 }
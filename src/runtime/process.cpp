@@ -20,9 +20,20 @@ Author: Jared Roesch
 #include <stdio.h>
 #include <strsafe.h>
 #else
+#include <vector>
 #include <unistd.h>
 #include <fcntl.h>
+#include <spawn.h>
 #include <sys/wait.h>
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern char ** environ;
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define LEAN_POSIX_SPAWN_CHDIR
+#endif
 #endif
 
 #include "runtime/object.h"
@@ -267,6 +278,10 @@ static optional<pipe> setup_stdio(stdio cfg) {
         if (::pipe(fds) == -1) {
             throw errno;
         } else {
+            /* Make sure that children spawned concurrently by other threads do not inherit our ends of the pipe,
+               which would keep the pipe open until they exit. */
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
             return optional<pipe>(pipe { fds[0], fds[1] });
         }
     case stdio::NUL:
@@ -276,6 +291,105 @@ static optional<pipe> setup_stdio(stdio cfg) {
     lean_unreachable();
 }
 
+/* Duplicate `fd` to `target` in the child process, clearing the close-on-exec flag set by `setup_stdio`. */
+static void dup_stdio(int fd, int target) {
+    if (fd == target)
+        fcntl(fd, F_SETFD, 0);
+    else
+        dup2(fd, target);
+}
+
+/* `posix_spawnp` avoids copying the page tables of the parent process, which is expensive for processes with large
+   heaps. We use it unless the child requires setup that it does not support. In particular, it looks up the program
+   using the `PATH` of the parent process, and `posix_spawn_file_actions_adddup2` may not clear the close-on-exec flag
+   if source and target coincide. */
+static bool can_posix_spawn(optional<pipe> const & stdin_pipe, optional<pipe> const & stdout_pipe, optional<pipe> const & stderr_pipe,
+  option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
+#ifndef LEAN_POSIX_SPAWN_CHDIR
+    if (cwd)
+        return false;
+#else
+    (void)cwd;
+#endif
+    for (auto & entry : env) {
+        if (strcmp(entry.fst().data(), "PATH") == 0)
+            return false;
+    }
+    if ((stdin_pipe && stdin_pipe->m_read_fd <= STDERR_FILENO) ||
+        (stdout_pipe && stdout_pipe->m_write_fd <= STDERR_FILENO) ||
+        (stderr_pipe && stderr_pipe->m_write_fd <= STDERR_FILENO))
+        return false;
+    return true;
+}
+
+static pid_t posix_spawn_child(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
+  stdio stderr_mode, optional<pipe> const & stdin_pipe, optional<pipe> const & stdout_pipe, optional<pipe> const & stderr_pipe,
+  option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (stdin_pipe)
+        posix_spawn_file_actions_adddup2(&actions, stdin_pipe->m_read_fd, STDIN_FILENO);
+    else if (stdin_mode == stdio::NUL)
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    if (stdout_pipe)
+        posix_spawn_file_actions_adddup2(&actions, stdout_pipe->m_write_fd, STDOUT_FILENO);
+    else if (stdout_mode == stdio::NUL)
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    if (stderr_pipe)
+        posix_spawn_file_actions_adddup2(&actions, stderr_pipe->m_write_fd, STDERR_FILENO);
+    else if (stderr_mode == stdio::NUL)
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+#ifdef LEAN_POSIX_SPAWN_CHDIR
+    if (cwd)
+        posix_spawn_file_actions_addchdir_np(&actions, cwd.get()->data());
+#else
+    lean_assert(!cwd);
+#endif
+
+    buffer<char *> pargs;
+    pargs.push_back(const_cast<char *>(proc_name.data()));
+    for (auto & arg : args)
+        pargs.push_back(const_cast<char *>(arg.data()));
+    pargs.push_back(NULL);
+
+    /* Compute the environment of the child, where later entries of `env` take precedence over earlier ones. */
+    char ** envp = environ;
+    std::vector<std::string> new_vars;
+    buffer<char *> new_envp;
+    if (env.size() > 0) {
+        auto overridden = [&](char const * var, size_t len) {
+            for (auto & entry : env) {
+                if (entry.fst().length() == len && strncmp(entry.fst().data(), var, len) == 0)
+                    return true;
+            }
+            return false;
+        };
+        for (char ** it = environ; *it; it++) {
+            char const * eq = strchr(*it, '=');
+            if (!eq || !overridden(*it, eq - *it))
+                new_envp.push_back(*it);
+        }
+        for (size_t i = 0; i < env.size(); i++) {
+            bool last = true;
+            for (size_t j = i + 1; j < env.size() && last; j++)
+                last = strcmp(env[i].fst().data(), env[j].fst().data()) != 0;
+            if (last && env[i].snd())
+                new_vars.push_back(std::string(env[i].fst().data()) + "=" + env[i].snd().get()->data());
+        }
+        for (auto & var : new_vars)
+            new_envp.push_back(const_cast<char *>(var.c_str()));
+        new_envp.push_back(NULL);
+        envp = new_envp.data();
+    }
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, pargs[0], &actions, nullptr, pargs.data(), envp);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0)
+        throw err;
+    return pid;
+}
+
 static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
   stdio stderr_mode, option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
     /* Setup stdio based on process configuration. */
@@ -283,7 +397,22 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
     auto stdout_pipe = setup_stdio(stdout_mode);
     auto stderr_pipe = setup_stdio(stderr_mode);
 
-    int pid = fork();
+    int pid;
+    if (can_posix_spawn(stdin_pipe, stdout_pipe, stderr_pipe, cwd, env)) {
+        try {
+            pid = posix_spawn_child(proc_name, args, stdin_mode, stdout_mode, stderr_mode, stdin_pipe, stdout_pipe, stderr_pipe, cwd, env);
+        } catch (int) {
+            for (auto const & p : { stdin_pipe, stdout_pipe, stderr_pipe }) {
+                if (p) {
+                    close(p->m_read_fd);
+                    close(p->m_write_fd);
+                }
+            }
+            throw;
+        }
+    } else {
+        pid = fork();
+    }
 
     if (pid == 0) {
         for (auto & entry : env) {
@@ -295,7 +424,7 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
         }
 
         if (stdin_pipe) {
-            dup2(stdin_pipe->m_read_fd, STDIN_FILENO);
+            dup_stdio(stdin_pipe->m_read_fd, STDIN_FILENO);
             close(stdin_pipe->m_write_fd);
         } else if (stdin_mode == stdio::NUL) {
             int fd = open("/dev/null", O_RDONLY);
@@ -303,7 +432,7 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
         }
 
         if (stdout_pipe) {
-            dup2(stdout_pipe->m_write_fd, STDOUT_FILENO);
+            dup_stdio(stdout_pipe->m_write_fd, STDOUT_FILENO);
             close(stdout_pipe->m_read_fd);
         } else if (stdout_mode == stdio::NUL) {
             int fd = open("/dev/null", O_WRONLY);
@@ -311,7 +440,7 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
         }
 
         if (stderr_pipe) {
-            dup2(stderr_pipe->m_write_fd, STDERR_FILENO);
+            dup_stdio(stderr_pipe->m_write_fd, STDERR_FILENO);
             close(stderr_pipe->m_read_fd);
         } else if (stderr_mode == stdio::NUL) {
             int fd = open("/dev/null", O_WRONLY);
@@ -18,6 +18,14 @@ Author: Leonardo de Moura
     #include <sys/time.h> // NOLINT
     #include <sys/resource.h> // NOLINT
 #endif
+#if defined(__linux__)
+    #include <unistd.h> // NOLINT
+    #include <sys/mman.h> // NOLINT
+#endif
+
+#ifndef LEAN_STACK_TRIM_THRESHOLD
+#define LEAN_STACK_TRIM_THRESHOLD 1024*1024 // 1 Mb
+#endif
 
 namespace lean {
 void throw_get_stack_size_failed() {
@@ -64,6 +72,8 @@ LEAN_THREAD_VALUE(bool, g_stack_info_init, false);
 LEAN_THREAD_VALUE(size_t, g_stack_size, 0);
 LEAN_THREAD_VALUE(size_t, g_stack_base, 0);
 LEAN_THREAD_VALUE(size_t, g_stack_threshold, 0);
+/* Lowest stack address seen by `check_stack` since the last `trim_stack`. */
+LEAN_THREAD_VALUE(size_t, g_stack_low, 0);
 
 void save_stack_info(bool main) {
     g_stack_info_init = true;
@@ -76,6 +86,7 @@ void save_stack_info(bool main) {
         // negative overflow
         g_stack_threshold = 0;
     }
+    g_stack_low = g_stack_base;
 }
 
 size_t get_used_stack_size() {
@@ -97,8 +108,46 @@ void check_stack(char const * component_name) {
         save_stack_info(false);
     char y;
     size_t curr_stack = reinterpret_cast<size_t>(&y);
+    if (curr_stack < g_stack_low)
+        g_stack_low = curr_stack;
     if (curr_stack < g_stack_threshold)
         throw stack_space_exception(component_name);
 }
+
+/*
+  Thread stacks are reserved with the size given by `--tstack`, but the operating system only commits their pages
+  when they are first used. Thus, a stack grows on demand, but it never shrinks, and a worker thread that once
+  elaborated a deeply nested term keeps the memory of its deepest stack forever. `trim_stack` releases the pages
+  below `LEAN_STACK_TRIM_THRESHOLD` from the current frame. It is called by task workers after each task.
+
+  Compiled Lean code does not call `check_stack`, so we also detect deep recursion with a canary word at the
+  threshold: if it has been overwritten, the stack has been used below it.
+*/
+#if defined(__linux__)
+static size_t const g_stack_canary_value = 0x5ac4ca2a7c1ea4ed;
+LEAN_THREAD_VALUE(size_t *, g_stack_canary, nullptr);
+
+void trim_stack() {
+    if (!g_stack_info_init || g_stack_threshold == 0)
+        return;
+    char y;
+    size_t curr_stack = reinterpret_cast<size_t>(&y);
+    size_t page_size  = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (curr_stack < g_stack_threshold + LEAN_STACK_TRIM_THRESHOLD + page_size)
+        return;
+    size_t hi = ((curr_stack - LEAN_STACK_TRIM_THRESHOLD) / page_size) * page_size;
+    size_t lo = ((g_stack_threshold + page_size - 1) / page_size) * page_size;
+    size_t * canary = reinterpret_cast<size_t *>(hi) - 1;
+    if (canary == g_stack_canary && *canary == g_stack_canary_value && g_stack_low >= hi)
+        return;
+    if (g_stack_canary != nullptr)
+        madvise(reinterpret_cast<void *>(lo), hi - lo, MADV_DONTNEED);
+    *canary        = g_stack_canary_value;
+    g_stack_canary = canary;
+    g_stack_low    = curr_stack;
+}
+#else
+void trim_stack() {}
+#endif
 }
 #endif
@@ -15,6 +15,7 @@ inline size_t get_stack_size(bool ) { return 8192*1024; }
 inline void save_stack_info(bool = true) {}
 inline size_t get_used_stack_size() { return 0; }
 inline size_t get_available_stack_size() { return 8192*1024; }
+inline void trim_stack() {}
 #else
 size_t get_stack_size(bool main);
 void save_stack_info(bool main = true);
@@ -27,5 +28,10 @@ size_t get_available_stack_size();
    user which module is the potential offender.
 */
 void check_stack(char const * component_name);
+/**
+   \brief Return the memory of the stack of the current thread below the current frame to the operating system if
+   the stack has grown by more than LEAN_STACK_TRIM_THRESHOLD since the last call. Only supported on Linux.
+*/
+void trim_stack();
 #endif
 }
@@ -6,12 +6,22 @@ Author: Leonardo de Moura
 */
 #include <utility>
 #include <vector>
+#include <memory>
 #include <iostream>
+#include <algorithm>
+#include <exception>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
 #else
 #include <pthread.h>
 #endif
+#if defined(LEAN_MULTI_THREAD) && defined(__linux__)
+#include <sched.h>
+#include <dirent.h>
+#include <cctype>
+#include <cstring>
+#include <string>
+#endif
 #include <lean/config.h>
 #include "runtime/thread.h"
 #include "runtime/interrupt.h"
@@ -149,6 +159,86 @@ lthread::~lthread() {}
 void lthread::join() { m_imp->join(); }
 #endif
 
+#if defined(LEAN_MULTI_THREAD) && defined(__linux__)
+bool set_thread_affinity(unsigned cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
+
+std::vector<unsigned> get_affinity_cpus() {
+    std::vector<unsigned> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0)
+        return cpus;
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+unsigned get_cpu_numa_node(unsigned cpu) {
+    // The directory of CPU `n` contains a `node<m>` entry for its NUMA node `m`.
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    unsigned node = 0;
+    if (DIR * d = opendir(dir.c_str())) {
+        while (dirent * e = readdir(d)) {
+            if (strncmp(e->d_name, "node", 4) == 0 && isdigit(e->d_name[4])) {
+                node = atoi(e->d_name + 4);
+                break;
+            }
+        }
+        closedir(d);
+    }
+    return node;
+}
+#else
+bool set_thread_affinity(unsigned) { return false; }
+std::vector<unsigned> get_affinity_cpus() { return std::vector<unsigned>(); }
+unsigned get_cpu_numa_node(unsigned) { return 0; }
+#endif
+
+void parallel_for(size_t n, size_t max_threads, std::function<void(size_t, size_t)> const & fn) {
+    size_t num_threads = std::min(n, max_threads);
+#if defined(LEAN_MULTI_THREAD)
+    if (num_threads > 1) {
+        atomic<size_t> next(0);
+        atomic<size_t> first_error(n);
+        // the first exception of each thread, and the index of the call that threw it
+        std::vector<std::exception_ptr> errors(num_threads);
+        std::vector<size_t> error_idx(num_threads, n);
+        auto run = [&](size_t t) {
+            for (size_t i = next++; i < n && i < first_error.load(); i = next++) {
+                try {
+                    fn(t, i);
+                } catch (...) {
+                    errors[t]    = std::current_exception();
+                    error_idx[t] = i;
+                    size_t j = first_error.load();
+                    while (i < j && !first_error.compare_exchange_weak(j, i)) {}
+                    return;
+                }
+            }
+        };
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (size_t t = 1; t < num_threads; t++)
+            threads.emplace_back(new lthread([&, t]() { run(t); }));
+        run(0);
+        for (auto & th : threads)
+            th->join();
+        size_t t = std::min_element(error_idx.begin(), error_idx.end()) - error_idx.begin();
+        if (errors[t])
+            std::rethrow_exception(errors[t]);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+        fn(0, i);
+}
+
 LEAN_THREAD_VALUE(bool, g_finalizing, false);
 
 bool in_thread_finalization() {
@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <iostream>
 #include <chrono>
 #include <functional>
+#include <vector>
 
 #ifndef LEAN_STACK_BUFFER_SPACE
 #define LEAN_STACK_BUFFER_SPACE 128*1024  // 128 Kb
@@ -228,6 +229,19 @@ void delete_thread_finalizer_manager();
 
 bool in_thread_finalization();
 
+/** \brief Pin the current thread to the CPU \c cpu. Return false if thread affinity is not supported. */
+bool set_thread_affinity(unsigned cpu);
+/** \brief Return the CPUs the current thread may run on, or an empty vector if they cannot be determined. */
+std::vector<unsigned> get_affinity_cpus();
+/** \brief Return the NUMA node of the CPU \c cpu, or 0 if it is unknown. */
+unsigned get_cpu_numa_node(unsigned cpu);
+
+/** \brief Run `fn(t, i)` for all `i < n` on up to `max_threads` threads, where `t < max_threads` identifies the
+    thread. The calling thread is thread 0 and takes part in the work.
+    If some calls throw, the exception of the call with the smallest `i` is rethrown once all threads have finished,
+    and the calls with larger `i` that have not started yet are skipped. */
+void parallel_for(size_t n, size_t max_threads, std::function<void(size_t, size_t)> const & fn);
+
 /**
     \brief Add \c fn to the list of functions used to reset thread local storage.
 
@@ -5,7 +5,20 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <algorithm>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LEAN_UTF8_SSE2
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define LEAN_UTF8_AVX2
+#endif
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define LEAN_UTF8_NEON
+#endif
 #include "runtime/debug.h"
 #include "runtime/optional.h"
 #include "runtime/utf8.h"
@@ -32,27 +45,104 @@ unsigned get_utf8_size(unsigned char c) {
         return 1; /* invalid */
 }
 
-extern "C" LEAN_EXPORT size_t lean_utf8_strlen(char const * str) {
+/* Continuation bytes are the bytes `0x80`-`0xBF`, i.e., the signed bytes smaller than `-64`.
+   The length of a well-formed UTF-8 string is the number of bytes that are not continuation bytes.
+
+   The vectorized versions below count the continuation bytes of `s[0, n)`, where `n` is a multiple of the vector
+   size. They add up the comparison masks (`-1` for continuation bytes), which may overflow after 255 iterations. */
+#if defined(LEAN_UTF8_SSE2)
+static size_t utf8_num_continuation_bytes_sse2(uchar const * s, size_t n) {
+    __m128i const threshold = _mm_set1_epi8(-64);
+    __m128i const zero      = _mm_setzero_si128();
     size_t r = 0;
-    while (*str != 0) {
-        unsigned sz = get_utf8_size(*str);
-        r++;
-        str += sz;
+    size_t i = 0;
+    while (i < n) {
+        __m128i acc = _mm_setzero_si128();
+        size_t end  = std::min(n, i + 255 * 16);
+        for (; i < end; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmplt_epi8(v, threshold));
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        r += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
     }
     return r;
 }
+#endif
+
+#if defined(LEAN_UTF8_AVX2)
+__attribute__((target("avx2")))
+static size_t utf8_num_continuation_bytes_avx2(uchar const * s, size_t n) {
+    __m256i const threshold = _mm256_set1_epi8(-64);
+    __m256i const zero      = _mm256_setzero_si256();
+    size_t r = 0;
+    size_t i = 0;
+    while (i < n) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t end  = std::min(n, i + 255 * 32);
+        for (; i < end; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(threshold, v));
+        }
+        __m256i sums = _mm256_sad_epu8(acc, zero);
+        r += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+             _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+    return r;
+}
+
+static bool has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool const g_has_avx2 = has_avx2();
+#endif
+
+#if defined(LEAN_UTF8_NEON)
+static size_t utf8_num_continuation_bytes_neon(uchar const * s, size_t n) {
+    int8x16_t const threshold = vdupq_n_s8(-64);
+    size_t r = 0;
+    for (size_t i = 0; i < n; i += 16) {
+        uint8x16_t m = vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(s + i)), threshold);
+        r += vaddvq_u8(vshrq_n_u8(m, 7));
+    }
+    return r;
+}
+#endif
+
+extern "C" LEAN_EXPORT size_t lean_utf8_strlen(char const * str) {
+    return lean_utf8_n_strlen(str, strlen(str));
+}
 
 size_t utf8_strlen(char const * str) {
     return lean_utf8_strlen(str);
 }
 
+/* Return the number of unicode scalar values in `str[0, sz)`, assuming it is well-formed UTF-8.
+   The vectorized implementation is picked based on the target architecture and (for AVX2) the current CPU. */
 extern "C" LEAN_EXPORT size_t lean_utf8_n_strlen(char const * str, size_t sz) {
-    size_t r = 0;
+    uchar const * s = reinterpret_cast<uchar const *>(str);
     size_t i = 0;
-    while (i < sz) {
-        unsigned d = get_utf8_size(str[i]);
-        r++;
-        i += d;
+    size_t r = 0;
+#if defined(LEAN_UTF8_AVX2)
+    if (g_has_avx2) {
+        i = sz & ~static_cast<size_t>(31);
+        r = i - utf8_num_continuation_bytes_avx2(s, i);
+    } else {
+        i = sz & ~static_cast<size_t>(15);
+        r = i - utf8_num_continuation_bytes_sse2(s, i);
+    }
+#elif defined(LEAN_UTF8_SSE2)
+    i = sz & ~static_cast<size_t>(15);
+    r = i - utf8_num_continuation_bytes_sse2(s, i);
+#elif defined(LEAN_UTF8_NEON)
+    i = sz & ~static_cast<size_t>(15);
+    r = i - utf8_num_continuation_bytes_neon(s, i);
+#endif
+    for (; i < sz; i++) {
+        if (!is_utf8_next(s[i]))
+            r++;
     }
     return r;
 }
@@ -30,9 +30,9 @@
 #endif
 
 namespace lean {
-static name * g_pp_indent  = nullptr;
-static name * g_pp_unicode = nullptr;
-static name * g_pp_width   = nullptr;
+static option_key * g_pp_indent  = nullptr;
+static option_key * g_pp_unicode = nullptr;
+static option_key * g_pp_width   = nullptr;
 
 unsigned get_pp_indent(options const & o) {
     return o.get_unsigned(*g_pp_indent, LEAN_DEFAULT_PP_INDENTATION);
@@ -107,12 +107,9 @@ format pp(name const & n) {
 }
 
 void initialize_format() {
-    g_pp_indent  = new name{"pp", "indent"};
-    mark_persistent(g_pp_indent->raw());
-    g_pp_unicode = new name{"pp", "unicode"};
-    mark_persistent(g_pp_unicode->raw());
-    g_pp_width   = new name{"pp", "width"};
-    mark_persistent(g_pp_width->raw());
+    g_pp_indent  = new option_key(name{"pp", "indent"});
+    g_pp_unicode = new option_key(name{"pp", "unicode"});
+    g_pp_width   = new option_key(name{"pp", "width"});
     g_line  = new format(box(static_cast<unsigned>(format::format_kind::LINE)));
     mark_persistent(g_line->raw());
     g_space = new format(" ");
@@ -10,6 +10,8 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <sstream>
 #include <string>
+#include <memory>
+#include <unordered_set>
 #include "runtime/thread.h"
 #include "runtime/debug.h"
 #include "runtime/sstream.h"
@@ -105,9 +107,21 @@ name::name(name const & prefix, char const * n):
     inc(prefix.raw());
 }
 
+/* `Name.num p k`. Unlike `lean_name_mk_numeral`, this does not call into Lean code. `name_generator::next` uses it to
+   create the name of every fresh free variable and metavariable. The hash must be the one computed by the
+   `@[computed_field]` of `Name`, i.e., `mixHash p.hash k` since `k < UInt64.size`. */
+static object * mk_name_numeral(b_obj_arg p, unsigned k) {
+    uint64 h    = lean_uint64_mix_hash(lean_name_hash(p), k);
+    object * r  = lean_alloc_ctor(static_cast<unsigned>(name_kind::NUMERAL), 2, sizeof(uint64));
+    inc(p);
+    lean_ctor_set(r, 0, p);
+    lean_ctor_set(r, 1, mk_nat_obj(k));
+    lean_ctor_set_uint64(r, sizeof(object*)*2, h);
+    return r;
+}
+
 name::name(name const & prefix, unsigned k):
-    object_ref(lean_name_mk_numeral(prefix.raw(), mk_nat_obj(k))) {
-    inc(prefix.raw());
+    object_ref(mk_name_numeral(prefix.raw(), k)) {
 }
 
 name::name(name const & prefix, string_ref const & s):
@@ -414,6 +428,42 @@ bool is_internal_name(name const & n) {
 
 static atomic<unsigned> * g_next_id = nullptr;
 
+/* Append-only table of interned names, split into shards protected by their own lock. */
+static unsigned const g_num_name_table_shards = 16;
+
+struct name_table_shard {
+    mutex                                               m_mutex;
+    std::unordered_set<name, name_hash_fn, name_eq_fn>  m_names;
+};
+
+static std::vector<std::unique_ptr<name_table_shard>> * g_name_table = nullptr;
+
+name name::intern() const {
+    if (is_anonymous())
+        return *this;
+    name_table_shard & s = *(*g_name_table)[hash() % g_num_name_table_shards];
+    {
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_names.find(*this);
+        if (it != s.m_names.end())
+            return *it;
+    }
+    name prefix = get_prefix().intern();
+    /* The representative is a new object, so that marking it does not race with other threads using `*this`. */
+    name r = is_string() ? name(prefix, get_string()) : name(prefix, get_numeral());
+    lock_guard<mutex> lock(s.m_mutex);
+    auto it = s.m_names.find(r);
+    if (it != s.m_names.end())
+        return *it;
+    mark_mt(r.raw());
+    s.m_names.insert(r);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_name_intern(b_obj_arg n) {
+    return name(n, true).intern().steal();
+}
+
 name name::mk_internal_unique_name() {
     unsigned id = (*g_next_id)++;
     return name(name(), id);
@@ -423,9 +473,13 @@ void initialize_name() {
     g_anonymous = new name();
     mark_persistent(g_anonymous->raw());
     g_next_id   = new atomic<unsigned>(0);
+    g_name_table = new std::vector<std::unique_ptr<name_table_shard>>();
+    for (unsigned i = 0; i < g_num_name_table_shards; i++)
+        g_name_table->emplace_back(new name_table_shard());
 }
 
 void finalize_name() {
+    delete g_name_table;
     delete g_next_id;
     delete g_anonymous;
 }
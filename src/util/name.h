@@ -96,6 +96,10 @@ public:
         </code>
     */
     static name mk_internal_unique_name();
+    /** \brief Return the representative of this name in the global name table, adding it if there is none.
+        Interned names are kept alive by the table, and structurally equal interned names are pointer equal, so
+        comparing them with `==` is cheap. The prefixes of interned names are interned as well. */
+    name intern() const;
     name & operator=(name const & other) { object_ref::operator=(other); return *this; }
     name & operator=(name && other) { object_ref::operator=(other); return *this; }
     static uint64_t hash(b_obj_arg n) {
@@ -30,7 +30,8 @@ public:
 
     name const & prefix() const { return m_prefix; }
 
-    /** \brief Return a unique name modulo \c prefix. */
+    /** \brief Return a unique name modulo \c prefix.
+        The result is `name(prefix(), i)`, which is constructed without calling into Lean code. */
     name next();
 
     /**
@@ -6,7 +6,10 @@ Author: Leonardo de Moura
 */
 #include <memory>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include "runtime/sstream.h"
+#include "runtime/thread.h"
 #include "util/options.h"
 #include "util/option_declarations.h"
 
@@ -18,20 +21,83 @@ namespace lean {
 static name * g_verbose    = nullptr;
 static name * g_max_memory = nullptr;
 static name * g_timeout    = nullptr;
+static option_key * g_verbose_key = nullptr;
+
+/* Interned option names, indexed by `option_key::idx`. */
+static std::vector<name> * g_option_keys = nullptr;
+static std::unordered_map<name, unsigned, name_hash_fn> * g_option_key_idx = nullptr;
+
+option_key::option_key(name const & n) {
+    auto it = g_option_key_idx->find(n);
+    if (it != g_option_key_idx->end()) {
+        m_idx = it->second;
+    } else {
+        m_idx = g_option_keys->size();
+        /* the interned names are shared by all threads */
+        mark_persistent(n.raw());
+        g_option_keys->push_back(n);
+        g_option_key_idx->insert(mk_pair(n, m_idx));
+    }
+}
+
+name const & option_key::get_name() const {
+    return (*g_option_keys)[m_idx];
+}
+
+/* Values of the interned options in the options object read last by this thread. Option objects are usually passed
+   down unchanged through a whole command, so the list is traversed once instead of once per lookup. */
+struct options_cache {
+    /* Keeps the cached options object alive, and thus its address unique. */
+    kvmap                   m_value;
+    bool                    m_valid = false;
+    std::vector<data_value> m_values;
+    std::vector<bool>       m_defined;
+
+    void reset(kvmap const & v) {
+        m_value = v;
+        m_valid = true;
+        unsigned n = g_option_keys->size();
+        m_values.assign(n, data_value());
+        m_defined.assign(n, false);
+        for (kvmap_entry const & e : v) {
+            auto it = g_option_key_idx->find(e.fst());
+            /* the first occurrence of a name takes precedence, see `find` */
+            if (it != g_option_key_idx->end() && !m_defined[it->second]) {
+                m_values[it->second]  = e.snd();
+                m_defined[it->second] = true;
+            }
+        }
+    }
+};
+
+MK_THREAD_LOCAL_GET_DEF(options_cache, get_options_cache);
+
+data_value const * options::find_cached(option_key const & k) const {
+    options_cache & c = get_options_cache();
+    if (!c.m_valid || c.m_value.raw() != m_value.raw() || k.idx() >= c.m_defined.size())
+        c.reset(m_value);
+    return c.m_defined[k.idx()] ? &c.m_values[k.idx()] : nullptr;
+}
 
 void initialize_options() {
+    g_option_keys    = new std::vector<name>();
+    g_option_key_idx = new std::unordered_map<name, unsigned, name_hash_fn>();
     g_verbose    = new name("verbose");
     mark_persistent(g_verbose->raw());
     g_max_memory = new name("max_memory");
     mark_persistent(g_max_memory->raw());
     g_timeout    = new name("timeout");
     mark_persistent(g_timeout->raw());
+    g_verbose_key = new option_key(*g_verbose);
 }
 
 void finalize_options() {
     delete g_verbose;
     delete g_max_memory;
     delete g_timeout;
+    delete g_verbose_key;
+    delete g_option_key_idx;
+    delete g_option_keys;
 }
 
 name const & get_verbose_opt_name() {
@@ -47,7 +113,7 @@ name const & get_timeout_opt_name() {
 }
 
 bool get_verbose(options const & opts) {
-    return opts.get_bool(*g_verbose, LEAN_DEFAULT_VERBOSE);
+    return opts.get_bool(*g_verbose_key, LEAN_DEFAULT_VERBOSE);
 }
 
 options join(options const & opts1, options const & opts2) {
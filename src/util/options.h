@@ -10,10 +10,24 @@ Author: Leonardo de Moura
 #include "util/kvmap.h"
 
 namespace lean {
+/** \brief An option name interned at initialization time. Reading an option through its key is a constant time
+    access into the values of all interned options, which are computed once per `options` object and thread.
+    Keys must be created during initialization, before any thread reads options through them. */
+class option_key {
+    unsigned m_idx;
+public:
+    explicit option_key(name const & n);
+    unsigned idx() const { return m_idx; }
+    name const & get_name() const;
+};
+
 /** \brief Configuration options. */
 class options {
     kvmap m_value;
     options(kvmap const & v):m_value(v) {}
+    /* Value of the option `k`, or `nullptr` if it is not set. The result is kept alive by a thread local cache
+       until the next lookup of the current thread. */
+    data_value const * find_cached(option_key const & k) const;
 public:
     options() {}
     explicit options(obj_arg o):m_value(o) {}
@@ -47,6 +61,23 @@ public:
         return default_value;
     }
 
+    bool get_bool(option_key const & k, bool default_value = false) const {
+        data_value const * r = find_cached(k);
+        if (r && r->kind() == data_value_kind::Bool)
+            return r->get_bool();
+        return default_value;
+    }
+
+    unsigned get_unsigned(option_key const & k, unsigned default_value = 0) const {
+        data_value const * r = find_cached(k);
+        if (r && r->kind() == data_value_kind::Nat) {
+            nat const & v = r->get_nat();
+            if (v.is_small())
+                return v.get_small_value();
+        }
+        return default_value;
+    }
+
     options update(name const & n, unsigned v) const { return options(set_nat(m_value, n, v)); }
     options update(name const & n, bool v) const { return options(set_bool(m_value, n, v)); }
     options update(name const & n, char const * v) const { return options(set_string(m_value, n, v)); }
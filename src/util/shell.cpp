@@ -15,6 +15,7 @@ Author: Leonardo de Moura
 #include <set>
 #include "runtime/stackinfo.h"
 #include "runtime/interrupt.h"
+#include "runtime/alloc.h"
 #include "runtime/memory.h"
 #include "runtime/thread.h"
 #include "runtime/debug.h"
@@ -28,6 +29,7 @@ Author: Leonardo de Moura
 #include "util/option_declarations.h"
 #include "kernel/environment.h"
 #include "kernel/kernel_exception.h"
+#include "kernel/type_checker.h"
 #include "library/formatter.h"
 #include "library/module.h"
 #include "library/time_task.h"
@@ -194,7 +196,7 @@ static void display_help(std::ostream & out) {
               << "                     and type check all imported modules\n";
     std::cout << "  --quiet -q         do not print verbose messages\n";
     std::cout << "  --memory=num -M    maximum amount of memory that should be used by Lean\n";
-    std::cout << "                     (in megabytes)\n";
+    std::cout << "                     (in megabytes), caches are released when usage gets close to it\n";
     std::cout << "  --timeout=num -T   maximum number of memory allocations per task\n";
     std::cout << "                     this is a deterministic way of interrupting long running tasks\n";
 #if defined(LEAN_MULTI_THREAD)
@@ -206,10 +208,19 @@ static void display_help(std::ostream & out) {
     std::cout << "  --plugin=file      load and initialize Lean shared library for registering linters etc.\n";
     std::cout << "  --load-dynlib=file load shared library to make its symbols available to the interpreter\n";
     std::cout << "  --deps             just print dependencies of a Lean input\n";
+    std::cout << "  --daemon           compile the files requested on stdin, one per line, reusing imported environments\n";
+    std::cout << "  --replay           check the declarations of the given modules and their imports with the kernel again,\n";
+    std::cout << "                     where the modules are read from their .olean files\n";
     std::cout << "  --print-prefix     print the installation prefix for Lean and exit\n";
     std::cout << "  --print-libdir     print the installation directory for Lean's built-in libraries and exit\n";
     std::cout << "  --profile          display elaboration/type checking time for each definition/theorem\n";
     std::cout << "  --stats            display environment statistics\n";
+    std::cout << "  --stats-json=file  write timings, heartbeats, memory usage and environment statistics to file as JSON\n";
+    std::cout << "  --kernel-stats     display kernel type checker statistics\n";
+    std::cout << "  --object-stats     display the sizes of the expressions and objects of the environment\n";
+    std::cout << "  --sample-profile=file\n";
+    std::cout << "                     sample the profiling categories and declarations being processed, and write\n";
+    std::cout << "                     them to file as folded stacks for flame graphs\n";
     DEBUG_CODE(
     std::cout << "  --debug=tag        enable assertions with the given tag\n";
         )
@@ -218,6 +229,10 @@ static void display_help(std::ostream & out) {
 
 static int print_prefix = 0;
 static int print_libdir = 0;
+static int print_kernel_stats = 0;
+static int run_daemon = 0;
+static int run_replay = 0;
+static int print_object_stats = 0;
 
 static struct option g_long_options[] = {
     {"version",      no_argument,       0, 'v'},
@@ -232,6 +247,8 @@ static struct option g_long_options[] = {
     {"trust",        required_argument, 0, 't'},
     {"profile",      no_argument,       0, 'P'},
     {"stats",        no_argument,       0, 'a'},
+    {"stats-json",   required_argument, 0, 'X'},
+    {"sample-profile", required_argument, 0, 'Y'},
     {"quiet",        no_argument,       0, 'q'},
     {"deps",         no_argument,       0, 'd'},
     {"deps-json",    no_argument,       0, 'J'},
@@ -248,6 +265,10 @@ static struct option g_long_options[] = {
     {"load-dynlib",  required_argument, 0, 'l'},
     {"print-prefix", no_argument,       &print_prefix, 1},
     {"print-libdir", no_argument,       &print_libdir, 1},
+    {"kernel-stats", no_argument,       &print_kernel_stats, 1},
+    {"daemon",       no_argument,       &run_daemon, 1},
+    {"replay",       no_argument,       &run_replay, 1},
+    {"object-stats", no_argument,       &print_object_stats, 1},
 #ifdef LEAN_DEBUG
     {"debug",        required_argument, 0, 'B'},
 #endif
@@ -369,6 +390,12 @@ uint32_t run_server_watchdog(buffer<string_ref> const & args) {
     return get_io_scalar_result<uint32_t>(lean_server_watchdog_main(arglist.to_obj_arg(), io_mk_world()));
 }
 
+/* def replayModules (mods : Array String) : IO UInt32 */
+extern "C" object * lean_replay_modules(object * mods, object * w);
+uint32_t replay_modules(array_ref<string_ref> const & mods) {
+    return get_io_scalar_result<uint32_t>(lean_replay_modules(mods.to_obj_arg(), io_mk_world()));
+}
+
 extern "C" object* lean_init_search_path(object* w);
 void init_search_path() {
     get_io_scalar_result<unsigned>(lean_init_search_path(io_mk_world()));
@@ -400,10 +427,153 @@ void print_imports_json(array_ref<string_ref> const & fnames) {
     consume_io_result(lean_print_imports_json(fnames.to_obj_arg(), io_mk_world()));
 }
 
+/* def environmentStatsJson (env : Environment) : String */
+extern "C" object* lean_environment_stats_json(object * env);
+
+/* Write the statistics requested by `--stats-json`. Timings are in seconds, memory sizes in bytes. */
+void write_stats_json(std::string const & json_fn, std::string const & mod_fn, environment const & env,
+                      second_duration init_time, second_duration total_time) {
+    std::ofstream out(json_fn);
+    if (out.fail())
+        throw exception(sstream() << "failed to create '" << json_fn << "'");
+    small_alloc_stats alloc;
+    get_small_alloc_stats(/* global */ true, alloc);
+    uint64 live_bytes = 0, free_bytes = 0, num_pages = 0;
+    for (small_alloc_slot_stats const & slot : alloc.m_slots) {
+        live_bytes += slot.m_live_bytes;
+        free_bytes += slot.m_free_bytes;
+        num_pages  += slot.m_num_pages;
+    }
+    string_ref env_stats = string_ref(lean_environment_stats_json(env.to_obj_arg()));
+    out << "{\"file\":";
+    display_json_string(out, mod_fn);
+    out << ",\"initialization\":" << init_time.count()
+        << ",\"total\":" << total_time.count()
+        << ",\"times\":";
+    display_cumulative_profiling_times_json(out);
+    out << ",\"heartbeats\":" << get_num_heartbeats()
+        << ",\"peakRss\":" << get_peak_rss()
+        << ",\"smallAlloc\":{\"liveBytes\":" << live_bytes << ",\"freeBytes\":" << free_bytes
+        << ",\"pages\":" << num_pages << ",\"emptyPages\":" << alloc.m_num_empty_pages
+        << ",\"segments\":" << alloc.m_num_segments << ",\"heaps\":" << alloc.m_num_heaps << "}"
+        << ",\"environment\":" << env_stats.data() << "}\n";
+}
+
+/* def displayObjectStats (env : Environment) : IO Unit */
+extern "C" object * lean_environment_display_object_stats(object * env, object * w);
+void display_object_stats(environment const & env) {
+    consume_io_result(lean_environment_display_object_stats(env.to_obj_arg(), io_mk_world()));
+}
+
 extern "C" object* lean_environment_free_regions(object * env, object * w);
 void environment_free_regions(environment && env) {
     consume_io_result(lean_environment_free_regions(env.steal(), io_mk_world()));
 }
+
+/* def saveResultCache (env : Environment) (fileName : String) : IO Unit */
+extern "C" object * lean_lcnf_save_result_cache(object * env, object * fname, object * w);
+void lcnf_save_result_cache(environment const & env, char const * fname) {
+    consume_io_result(lean_lcnf_save_result_cache(env.to_obj_arg(), mk_string(fname), io_mk_world()));
+}
+
+/* def enableImportCache : IO Unit */
+extern "C" object* lean_enable_import_cache(object * w);
+void enable_import_cache() {
+    consume_io_result(lean_enable_import_cache(io_mk_world()));
+}
+
+/* def freeEvictedImports : IO Unit */
+extern "C" object* lean_free_evicted_imports(object * w);
+void free_evicted_imports() {
+    consume_io_result(lean_free_evicted_imports(io_mk_world()));
+}
+
+/* Compile the file of a `--daemon` request. See `run_daemon_loop`. */
+static uint32 run_daemon_request(std::vector<std::string> const & args, options opts, unsigned trust_lvl) {
+    optional<std::string> olean_fn;
+    optional<std::string> ilean_fn;
+    optional<std::string> c_output;
+    optional<std::string> root_dir;
+    optional<std::string> mod_fn;
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string const & arg = args[i];
+        if (arg.size() >= 2 && arg[0] == '-' && std::string("oicRD").find(arg[1]) != std::string::npos) {
+            std::string val;
+            if (arg.size() > 2) {
+                val = arg.substr(2);
+            } else if (i + 1 < args.size()) {
+                val = args[++i];
+            } else {
+                throw exception(sstream() << "argument missing for option '" << arg << "'");
+            }
+            switch (arg[1]) {
+            case 'o': olean_fn = val; break;
+            case 'i': ilean_fn = val; break;
+            case 'c': c_output = val; break;
+            case 'R': root_dir = val; break;
+            case 'D': opts = set_config_option(opts, val.c_str()); break;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw exception(sstream() << "unsupported option '" << arg << "' in daemon request");
+        } else if (mod_fn) {
+            throw exception("expected exactly one file name");
+        } else {
+            mod_fn = arg;
+        }
+    }
+    if (!mod_fn)
+        throw exception("expected exactly one file name");
+    std::string contents = read_file(*mod_fn);
+    name main_module_name = *module_name_of_file(*mod_fn, root_dir, /* optional */ false);
+    set_profiling_file_name(*mod_fn);
+    pair_ref<environment, object_ref> r = run_new_frontend(contents, opts, *mod_fn, main_module_name, trust_lvl, ilean_fn);
+    environment env = r.fst();
+    bool ok = unbox(r.snd().raw());
+    if (olean_fn && ok) {
+        time_task t(".olean serialization", opts);
+        write_module(env, *olean_fn);
+    }
+    if (c_output && ok) {
+        time_task _("C code generation", opts);
+        ir::write_c_files(*c_output, ir::emit_c(env, main_module_name, opts));
+    }
+    return ok ? 0 : 1;
+}
+
+/* Process compilation requests read from stdin until it is closed. Each request is a line of tab-separated arguments
+   such as `-o`, `-i`, `-c`, `-R`, `-D` and the file name, with the same meaning as on the command line. The output
+   of a request is followed by a line `#exit <code>`. Imported environments are kept alive across requests, see
+   `importModulesCached`, so that build systems avoid the startup and import cost of a new process per file. */
+static uint32 run_daemon_loop(options const & opts, unsigned trust_lvl) {
+    enable_import_cache();
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::vector<std::string> args;
+        std::stringstream in(line);
+        std::string arg;
+        while (std::getline(in, arg, '\t')) {
+            if (!arg.empty())
+                args.push_back(arg);
+        }
+        if (args.empty())
+            continue;
+        uint32 ret = 1;
+        try {
+            ret = run_daemon_request(args, opts, trust_lvl);
+        } catch (throwable & ex) {
+            std::cout << ex.what() << "\n";
+        } catch (std::bad_alloc & ex) {
+            std::cout << "out of memory\n";
+        }
+        display_cumulative_profiling_times(std::cerr);
+        // the profile of each request only covers that request
+        reset_cumulative_profiling_times();
+        // no environment of the request is alive anymore
+        free_evicted_imports();
+        std::cout << "#exit " << ret << std::endl;
+    }
+    return 0;
+}
 }
 
 extern "C" object * lean_get_prefix(object * w);
@@ -452,6 +622,8 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     bool only_deps = false;
     bool deps_json = false;
     bool stats = false;
+    optional<std::string> stats_json_fn;
+    optional<std::string> sample_profile_fn;
     // 0 = don't run server, 1 = watchdog, 2 = worker
     int run_server = 0;
     unsigned num_threads    = 0;
@@ -555,6 +727,15 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             case 'a':
                 stats = true;
                 break;
+            case 'X':
+                check_optarg("stats-json");
+                stats_json_fn = optarg;
+                set_collect_profiling_times(true);
+                break;
+            case 'Y':
+                check_optarg("sample-profile");
+                sample_profile_fn = optarg;
+                break;
             case 'D':
                 try {
                     check_optarg("D");
@@ -626,6 +807,8 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
         report_profiling_time("initialization", init_time);
     }
 
+    // declared first so that the samples of all tasks are written
+    scoped_sample_profiler sample_profiler(sample_profile_fn);
     environment env(trust_lvl);
     scoped_task_manager scope_task_man(num_threads);
     optional<name> main_module_name;
@@ -639,6 +822,16 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
         else if (run_server == 2)
             return run_server_worker(opts);
 
+        if (run_daemon)
+            return run_daemon_loop(opts, trust_lvl);
+
+        if (run_replay) {
+            buffer<string_ref> mods;
+            for (int i = optind; i < argc; i++)
+                mods.push_back(string_ref(argv[i]));
+            return replay_modules(mods);
+        }
+
         if (only_deps && deps_json) {
             buffer<string_ref> fns;
             if (use_stdin) {
@@ -698,12 +891,25 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
 
         if (!main_module_name)
             main_module_name = name("_stdin");
+        if (print_kernel_stats)
+            set_kernel_stats_enabled(true);
+        set_profiling_file_name(mod_fn);
+        // The LCNF results of the previous build are reused only if `-Dcompiler.lcnfCache=<file>` is given,
+        // see `Lean.Compiler.LCNF.ResultCache`.
+        name lcnf_cache_opt({"compiler", "lcnfCache"});
         pair_ref<environment, object_ref> r = run_new_frontend(contents, opts, mod_fn, *main_module_name, trust_lvl, ilean_fn);
         env = r.fst();
         bool ok = unbox(r.snd().raw());
 
         if (stats) {
             env.display_stats();
+            ir::display_interpreter_stats(std::cout);
+        }
+        if (print_kernel_stats) {
+            display_kernel_stats(std::cerr);
+        }
+        if (print_object_stats) {
+            display_object_stats(env);
         }
 
         if (run && ok) {
@@ -714,20 +920,20 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
         if (olean_fn && ok) {
             time_task t(".olean serialization", opts);
             write_module(env, *olean_fn);
+            if (*opts.get_string(lcnf_cache_opt, ""))
+                lcnf_save_result_cache(env, opts.get_string(lcnf_cache_opt, ""));
         }
 
         if (c_output && ok) {
-            std::ofstream out(*c_output, std::ios_base::binary);
-            if (out.fail()) {
-                std::cerr << "failed to create '" << *c_output << "'\n";
-                return 1;
-            }
             time_task _("C code generation", opts);
-            out << lean::ir::emit_c(env, *main_module_name).data();
-            out.close();
+            lean::ir::write_c_files(*c_output, lean::ir::emit_c(env, *main_module_name, opts));
         }
 
-        display_cumulative_profiling_times(std::cerr);
+        if (get_collect_profiling_times())
+            display_cumulative_profiling_times(std::cerr);
+        ir::display_interpreter_profile(std::cerr);
+        if (stats_json_fn)
+            write_stats_json(*stats_json_fn, mod_fn, env, init_time, std::chrono::steady_clock::now() - init_start);
 
         return ok ? 0 : 1;
     } catch (lean::throwable & ex) {
@@ -0,0 +1,25 @@
+#!/usr/bin/env python3
+# Run `lean --stats-json` on a file and print its statistics as a YAML dictionary for temci's `parse_output`.
+# Usage: elab_bench.py FILE [LEAN_ARGS...]
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+fn = sys.argv[1]
+with tempfile.TemporaryDirectory() as tmp:
+    stats_fn = os.path.join(tmp, "stats.json")
+    subprocess.run(["lean", f"--stats-json={stats_fn}", *sys.argv[2:], fn], check=True, stdout=subprocess.DEVNULL)
+    with open(stats_fn) as f:
+        stats = json.load(f)
+
+print(f"'heartbeats': {stats['heartbeats']}")
+print(f"'peak rss': {stats['peakRss']}")
+print(f"'small alloc live bytes': {stats['smallAlloc']['liveBytes']}")
+print(f"'small alloc pages': {stats['smallAlloc']['pages']}")
+print(f"'imported modules': {stats['environment']['modules']}")
+print(f"'local consts': {stats['environment']['localConsts']}")
+for cat, secs in sorted(stats['times'].items()):
+    print(f"{cat!r}: {secs:f}")
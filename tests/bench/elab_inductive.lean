@@ -0,0 +1,503 @@
+/-! Elaboration and kernel benchmark: large inductive types and structures with derived instances. -/
+
+inductive Big where
+  | c0 (x : Nat) (y : Bool)
+  | c1 (x : Nat) (y : Bool)
+  | c2 (x : Nat) (y : Bool)
+  | c3 (x : Nat) (y : Bool)
+  | c4 (x : Nat) (y : Bool)
+  | c5 (x : Nat) (y : Bool)
+  | c6 (x : Nat) (y : Bool)
+  | c7 (x : Nat) (y : Bool)
+  | c8 (x : Nat) (y : Bool)
+  | c9 (x : Nat) (y : Bool)
+  | c10 (x : Nat) (y : Bool)
+  | c11 (x : Nat) (y : Bool)
+  | c12 (x : Nat) (y : Bool)
+  | c13 (x : Nat) (y : Bool)
+  | c14 (x : Nat) (y : Bool)
+  | c15 (x : Nat) (y : Bool)
+  | c16 (x : Nat) (y : Bool)
+  | c17 (x : Nat) (y : Bool)
+  | c18 (x : Nat) (y : Bool)
+  | c19 (x : Nat) (y : Bool)
+  | c20 (x : Nat) (y : Bool)
+  | c21 (x : Nat) (y : Bool)
+  | c22 (x : Nat) (y : Bool)
+  | c23 (x : Nat) (y : Bool)
+  | c24 (x : Nat) (y : Bool)
+  | c25 (x : Nat) (y : Bool)
+  | c26 (x : Nat) (y : Bool)
+  | c27 (x : Nat) (y : Bool)
+  | c28 (x : Nat) (y : Bool)
+  | c29 (x : Nat) (y : Bool)
+  | c30 (x : Nat) (y : Bool)
+  | c31 (x : Nat) (y : Bool)
+  | c32 (x : Nat) (y : Bool)
+  | c33 (x : Nat) (y : Bool)
+  | c34 (x : Nat) (y : Bool)
+  | c35 (x : Nat) (y : Bool)
+  | c36 (x : Nat) (y : Bool)
+  | c37 (x : Nat) (y : Bool)
+  | c38 (x : Nat) (y : Bool)
+  | c39 (x : Nat) (y : Bool)
+  | c40 (x : Nat) (y : Bool)
+  | c41 (x : Nat) (y : Bool)
+  | c42 (x : Nat) (y : Bool)
+  | c43 (x : Nat) (y : Bool)
+  | c44 (x : Nat) (y : Bool)
+  | c45 (x : Nat) (y : Bool)
+  | c46 (x : Nat) (y : Bool)
+  | c47 (x : Nat) (y : Bool)
+  | c48 (x : Nat) (y : Bool)
+  | c49 (x : Nat) (y : Bool)
+  | c50 (x : Nat) (y : Bool)
+  | c51 (x : Nat) (y : Bool)
+  | c52 (x : Nat) (y : Bool)
+  | c53 (x : Nat) (y : Bool)
+  | c54 (x : Nat) (y : Bool)
+  | c55 (x : Nat) (y : Bool)
+  | c56 (x : Nat) (y : Bool)
+  | c57 (x : Nat) (y : Bool)
+  | c58 (x : Nat) (y : Bool)
+  | c59 (x : Nat) (y : Bool)
+  | c60 (x : Nat) (y : Bool)
+  | c61 (x : Nat) (y : Bool)
+  | c62 (x : Nat) (y : Bool)
+  | c63 (x : Nat) (y : Bool)
+  | c64 (x : Nat) (y : Bool)
+  | c65 (x : Nat) (y : Bool)
+  | c66 (x : Nat) (y : Bool)
+  | c67 (x : Nat) (y : Bool)
+  | c68 (x : Nat) (y : Bool)
+  | c69 (x : Nat) (y : Bool)
+  | c70 (x : Nat) (y : Bool)
+  | c71 (x : Nat) (y : Bool)
+  | c72 (x : Nat) (y : Bool)
+  | c73 (x : Nat) (y : Bool)
+  | c74 (x : Nat) (y : Bool)
+  | c75 (x : Nat) (y : Bool)
+  | c76 (x : Nat) (y : Bool)
+  | c77 (x : Nat) (y : Bool)
+  | c78 (x : Nat) (y : Bool)
+  | c79 (x : Nat) (y : Bool)
+  deriving Repr, DecidableEq, Inhabited
+
+inductive Enum where
+  | e0
+  | e1
+  | e2
+  | e3
+  | e4
+  | e5
+  | e6
+  | e7
+  | e8
+  | e9
+  | e10
+  | e11
+  | e12
+  | e13
+  | e14
+  | e15
+  | e16
+  | e17
+  | e18
+  | e19
+  | e20
+  | e21
+  | e22
+  | e23
+  | e24
+  | e25
+  | e26
+  | e27
+  | e28
+  | e29
+  | e30
+  | e31
+  | e32
+  | e33
+  | e34
+  | e35
+  | e36
+  | e37
+  | e38
+  | e39
+  | e40
+  | e41
+  | e42
+  | e43
+  | e44
+  | e45
+  | e46
+  | e47
+  | e48
+  | e49
+  | e50
+  | e51
+  | e52
+  | e53
+  | e54
+  | e55
+  | e56
+  | e57
+  | e58
+  | e59
+  | e60
+  | e61
+  | e62
+  | e63
+  | e64
+  | e65
+  | e66
+  | e67
+  | e68
+  | e69
+  | e70
+  | e71
+  | e72
+  | e73
+  | e74
+  | e75
+  | e76
+  | e77
+  | e78
+  | e79
+  | e80
+  | e81
+  | e82
+  | e83
+  | e84
+  | e85
+  | e86
+  | e87
+  | e88
+  | e89
+  | e90
+  | e91
+  | e92
+  | e93
+  | e94
+  | e95
+  | e96
+  | e97
+  | e98
+  | e99
+  | e100
+  | e101
+  | e102
+  | e103
+  | e104
+  | e105
+  | e106
+  | e107
+  | e108
+  | e109
+  | e110
+  | e111
+  | e112
+  | e113
+  | e114
+  | e115
+  | e116
+  | e117
+  | e118
+  | e119
+  | e120
+  | e121
+  | e122
+  | e123
+  | e124
+  | e125
+  | e126
+  | e127
+  | e128
+  | e129
+  | e130
+  | e131
+  | e132
+  | e133
+  | e134
+  | e135
+  | e136
+  | e137
+  | e138
+  | e139
+  | e140
+  | e141
+  | e142
+  | e143
+  | e144
+  | e145
+  | e146
+  | e147
+  | e148
+  | e149
+  | e150
+  | e151
+  | e152
+  | e153
+  | e154
+  | e155
+  | e156
+  | e157
+  | e158
+  | e159
+  | e160
+  | e161
+  | e162
+  | e163
+  | e164
+  | e165
+  | e166
+  | e167
+  | e168
+  | e169
+  | e170
+  | e171
+  | e172
+  | e173
+  | e174
+  | e175
+  | e176
+  | e177
+  | e178
+  | e179
+  | e180
+  | e181
+  | e182
+  | e183
+  | e184
+  | e185
+  | e186
+  | e187
+  | e188
+  | e189
+  | e190
+  | e191
+  | e192
+  | e193
+  | e194
+  | e195
+  | e196
+  | e197
+  | e198
+  | e199
+  | e200
+  | e201
+  | e202
+  | e203
+  | e204
+  | e205
+  | e206
+  | e207
+  | e208
+  | e209
+  | e210
+  | e211
+  | e212
+  | e213
+  | e214
+  | e215
+  | e216
+  | e217
+  | e218
+  | e219
+  | e220
+  | e221
+  | e222
+  | e223
+  | e224
+  | e225
+  | e226
+  | e227
+  | e228
+  | e229
+  | e230
+  | e231
+  | e232
+  | e233
+  | e234
+  | e235
+  | e236
+  | e237
+  | e238
+  | e239
+  | e240
+  | e241
+  | e242
+  | e243
+  | e244
+  | e245
+  | e246
+  | e247
+  | e248
+  | e249
+  deriving Repr, DecidableEq, Inhabited
+
+structure Wide where
+  f0 : Nat := 0
+  f1 : Nat := 1
+  f2 : Nat := 2
+  f3 : Nat := 3
+  f4 : Nat := 4
+  f5 : Nat := 5
+  f6 : Nat := 6
+  f7 : Nat := 7
+  f8 : Nat := 8
+  f9 : Nat := 9
+  f10 : Nat := 10
+  f11 : Nat := 11
+  f12 : Nat := 12
+  f13 : Nat := 13
+  f14 : Nat := 14
+  f15 : Nat := 15
+  f16 : Nat := 16
+  f17 : Nat := 17
+  f18 : Nat := 18
+  f19 : Nat := 19
+  f20 : Nat := 20
+  f21 : Nat := 21
+  f22 : Nat := 22
+  f23 : Nat := 23
+  f24 : Nat := 24
+  f25 : Nat := 25
+  f26 : Nat := 26
+  f27 : Nat := 27
+  f28 : Nat := 28
+  f29 : Nat := 29
+  f30 : Nat := 30
+  f31 : Nat := 31
+  f32 : Nat := 32
+  f33 : Nat := 33
+  f34 : Nat := 34
+  f35 : Nat := 35
+  f36 : Nat := 36
+  f37 : Nat := 37
+  f38 : Nat := 38
+  f39 : Nat := 39
+  f40 : Nat := 40
+  f41 : Nat := 41
+  f42 : Nat := 42
+  f43 : Nat := 43
+  f44 : Nat := 44
+  f45 : Nat := 45
+  f46 : Nat := 46
+  f47 : Nat := 47
+  f48 : Nat := 48
+  f49 : Nat := 49
+  f50 : Nat := 50
+  f51 : Nat := 51
+  f52 : Nat := 52
+  f53 : Nat := 53
+  f54 : Nat := 54
+  f55 : Nat := 55
+  f56 : Nat := 56
+  f57 : Nat := 57
+  f58 : Nat := 58
+  f59 : Nat := 59
+  f60 : Nat := 60
+  f61 : Nat := 61
+  f62 : Nat := 62
+  f63 : Nat := 63
+  f64 : Nat := 64
+  f65 : Nat := 65
+  f66 : Nat := 66
+  f67 : Nat := 67
+  f68 : Nat := 68
+  f69 : Nat := 69
+  f70 : Nat := 70
+  f71 : Nat := 71
+  f72 : Nat := 72
+  f73 : Nat := 73
+  f74 : Nat := 74
+  f75 : Nat := 75
+  f76 : Nat := 76
+  f77 : Nat := 77
+  f78 : Nat := 78
+  f79 : Nat := 79
+  f80 : Nat := 80
+  f81 : Nat := 81
+  f82 : Nat := 82
+  f83 : Nat := 83
+  f84 : Nat := 84
+  f85 : Nat := 85
+  f86 : Nat := 86
+  f87 : Nat := 87
+  f88 : Nat := 88
+  f89 : Nat := 89
+  f90 : Nat := 90
+  f91 : Nat := 91
+  f92 : Nat := 92
+  f93 : Nat := 93
+  f94 : Nat := 94
+  f95 : Nat := 95
+  f96 : Nat := 96
+  f97 : Nat := 97
+  f98 : Nat := 98
+  f99 : Nat := 99
+  f100 : Nat := 100
+  f101 : Nat := 101
+  f102 : Nat := 102
+  f103 : Nat := 103
+  f104 : Nat := 104
+  f105 : Nat := 105
+  f106 : Nat := 106
+  f107 : Nat := 107
+  f108 : Nat := 108
+  f109 : Nat := 109
+  f110 : Nat := 110
+  f111 : Nat := 111
+  f112 : Nat := 112
+  f113 : Nat := 113
+  f114 : Nat := 114
+  f115 : Nat := 115
+  f116 : Nat := 116
+  f117 : Nat := 117
+  f118 : Nat := 118
+  f119 : Nat := 119
+  deriving Repr, Inhabited
+
+inductive Tree (α : Type) where
+  | leaf
+  | node (children : List (Tree α)) (val : α) (extra : Array (Tree α))
+
+mutual
+inductive M0 where
+  | base
+  | next (x : M1)
+inductive M1 where
+  | base
+  | next (x : M2)
+inductive M2 where
+  | base
+  | next (x : M3)
+inductive M3 where
+  | base
+  | next (x : M4)
+inductive M4 where
+  | base
+  | next (x : M5)
+inductive M5 where
+  | base
+  | next (x : M6)
+inductive M6 where
+  | base
+  | next (x : M7)
+inductive M7 where
+  | base
+  | next (x : M8)
+inductive M8 where
+  | base
+  | next (x : M9)
+inductive M9 where
+  | base
+  | next (x : M10)
+inductive M10 where
+  | base
+  | next (x : M11)
+inductive M11 where
+  | base
+  | next (x : M0)
+end
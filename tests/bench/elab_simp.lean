@@ -0,0 +1,9 @@
+/-! Elaboration benchmark: `simp` calls on large terms. -/
+
+example (x : Nat) : 0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((x + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) = x := by simp
+
+example (x : Nat) : 0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((x + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) = x := by simp
+
+example (x : Nat) : 0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((0 + ((x + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) + 0) * 1) = x := by simp
+
+example (xs : List Nat) : ((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((xs ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id) ++ []).map id).length = xs.length := by simp
@@ -0,0 +1,217 @@
+/-! Elaboration benchmark: deep instance chains and many coercion-heavy terms. -/
+
+class Depth (n : Nat) where
+  depth : Nat
+
+instance : Depth 0 := ⟨0⟩
+instance [Depth n] : Depth (n + 1) := ⟨Depth.depth n + 1⟩
+
+example : Depth.depth 100 = 100 := rfl
+
+class Wrap (α : Type) where
+  wrap : α → List α
+
+instance : Wrap Nat := ⟨fun x => [x]⟩
+instance [Wrap α] : Wrap (List α) := ⟨fun x => [x]⟩
+instance [Wrap α] [Wrap β] : Wrap (α × β) := ⟨fun x => [x]⟩
+
+def w0 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 0, [x * 0, x - 0])]
+def w1 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 1, [x * 1, x - 1])]
+def w2 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 2, [x * 2, x - 2])]
+def w3 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 3, [x * 3, x - 3])]
+def w4 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 4, [x * 4, x - 4])]
+def w5 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 5, [x * 5, x - 5])]
+def w6 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 6, [x * 6, x - 6])]
+def w7 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 7, [x * 7, x - 7])]
+def w8 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 8, [x * 8, x - 8])]
+def w9 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 9, [x * 9, x - 9])]
+def w10 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 10, [x * 10, x - 10])]
+def w11 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 11, [x * 11, x - 11])]
+def w12 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 12, [x * 12, x - 12])]
+def w13 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 13, [x * 13, x - 13])]
+def w14 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 14, [x * 14, x - 14])]
+def w15 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 15, [x * 15, x - 15])]
+def w16 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 16, [x * 16, x - 16])]
+def w17 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 17, [x * 17, x - 17])]
+def w18 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 18, [x * 18, x - 18])]
+def w19 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 19, [x * 19, x - 19])]
+def w20 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 20, [x * 20, x - 20])]
+def w21 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 21, [x * 21, x - 21])]
+def w22 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 22, [x * 22, x - 22])]
+def w23 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 23, [x * 23, x - 23])]
+def w24 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 24, [x * 24, x - 24])]
+def w25 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 25, [x * 25, x - 25])]
+def w26 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 26, [x * 26, x - 26])]
+def w27 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 27, [x * 27, x - 27])]
+def w28 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 28, [x * 28, x - 28])]
+def w29 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 29, [x * 29, x - 29])]
+def w30 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 30, [x * 30, x - 30])]
+def w31 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 31, [x * 31, x - 31])]
+def w32 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 32, [x * 32, x - 32])]
+def w33 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 33, [x * 33, x - 33])]
+def w34 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 34, [x * 34, x - 34])]
+def w35 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 35, [x * 35, x - 35])]
+def w36 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 36, [x * 36, x - 36])]
+def w37 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 37, [x * 37, x - 37])]
+def w38 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 38, [x * 38, x - 38])]
+def w39 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 39, [x * 39, x - 39])]
+def w40 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 40, [x * 40, x - 40])]
+def w41 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 41, [x * 41, x - 41])]
+def w42 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 42, [x * 42, x - 42])]
+def w43 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 43, [x * 43, x - 43])]
+def w44 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 44, [x * 44, x - 44])]
+def w45 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 45, [x * 45, x - 45])]
+def w46 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 46, [x * 46, x - 46])]
+def w47 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 47, [x * 47, x - 47])]
+def w48 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 48, [x * 48, x - 48])]
+def w49 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 49, [x * 49, x - 49])]
+def w50 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 50, [x * 50, x - 50])]
+def w51 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 51, [x * 51, x - 51])]
+def w52 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 52, [x * 52, x - 52])]
+def w53 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 53, [x * 53, x - 53])]
+def w54 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 54, [x * 54, x - 54])]
+def w55 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 55, [x * 55, x - 55])]
+def w56 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 56, [x * 56, x - 56])]
+def w57 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 57, [x * 57, x - 57])]
+def w58 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 58, [x * 58, x - 58])]
+def w59 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 59, [x * 59, x - 59])]
+def w60 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 60, [x * 60, x - 60])]
+def w61 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 61, [x * 61, x - 61])]
+def w62 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 62, [x * 62, x - 62])]
+def w63 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 63, [x * 63, x - 63])]
+def w64 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 64, [x * 64, x - 64])]
+def w65 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 65, [x * 65, x - 65])]
+def w66 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 66, [x * 66, x - 66])]
+def w67 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 67, [x * 67, x - 67])]
+def w68 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 68, [x * 68, x - 68])]
+def w69 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 69, [x * 69, x - 69])]
+def w70 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 70, [x * 70, x - 70])]
+def w71 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 71, [x * 71, x - 71])]
+def w72 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 72, [x * 72, x - 72])]
+def w73 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 73, [x * 73, x - 73])]
+def w74 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 74, [x * 74, x - 74])]
+def w75 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 75, [x * 75, x - 75])]
+def w76 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 76, [x * 76, x - 76])]
+def w77 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 77, [x * 77, x - 77])]
+def w78 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 78, [x * 78, x - 78])]
+def w79 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 79, [x * 79, x - 79])]
+def w80 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 80, [x * 80, x - 80])]
+def w81 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 81, [x * 81, x - 81])]
+def w82 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 82, [x * 82, x - 82])]
+def w83 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 83, [x * 83, x - 83])]
+def w84 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 84, [x * 84, x - 84])]
+def w85 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 85, [x * 85, x - 85])]
+def w86 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 86, [x * 86, x - 86])]
+def w87 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 87, [x * 87, x - 87])]
+def w88 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 88, [x * 88, x - 88])]
+def w89 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 89, [x * 89, x - 89])]
+def w90 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 90, [x * 90, x - 90])]
+def w91 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 91, [x * 91, x - 91])]
+def w92 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 92, [x * 92, x - 92])]
+def w93 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 93, [x * 93, x - 93])]
+def w94 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 94, [x * 94, x - 94])]
+def w95 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 95, [x * 95, x - 95])]
+def w96 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 96, [x * 96, x - 96])]
+def w97 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 97, [x * 97, x - 97])]
+def w98 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 98, [x * 98, x - 98])]
+def w99 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 99, [x * 99, x - 99])]
+def w100 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 100, [x * 100, x - 100])]
+def w101 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 101, [x * 101, x - 101])]
+def w102 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 102, [x * 102, x - 102])]
+def w103 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 103, [x * 103, x - 103])]
+def w104 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 104, [x * 104, x - 104])]
+def w105 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 105, [x * 105, x - 105])]
+def w106 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 106, [x * 106, x - 106])]
+def w107 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 107, [x * 107, x - 107])]
+def w108 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 108, [x * 108, x - 108])]
+def w109 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 109, [x * 109, x - 109])]
+def w110 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 110, [x * 110, x - 110])]
+def w111 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 111, [x * 111, x - 111])]
+def w112 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 112, [x * 112, x - 112])]
+def w113 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 113, [x * 113, x - 113])]
+def w114 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 114, [x * 114, x - 114])]
+def w115 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 115, [x * 115, x - 115])]
+def w116 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 116, [x * 116, x - 116])]
+def w117 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 117, [x * 117, x - 117])]
+def w118 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 118, [x * 118, x - 118])]
+def w119 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 119, [x * 119, x - 119])]
+def w120 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 120, [x * 120, x - 120])]
+def w121 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 121, [x * 121, x - 121])]
+def w122 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 122, [x * 122, x - 122])]
+def w123 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 123, [x * 123, x - 123])]
+def w124 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 124, [x * 124, x - 124])]
+def w125 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 125, [x * 125, x - 125])]
+def w126 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 126, [x * 126, x - 126])]
+def w127 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 127, [x * 127, x - 127])]
+def w128 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 128, [x * 128, x - 128])]
+def w129 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 129, [x * 129, x - 129])]
+def w130 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 130, [x * 130, x - 130])]
+def w131 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 131, [x * 131, x - 131])]
+def w132 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 132, [x * 132, x - 132])]
+def w133 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 133, [x * 133, x - 133])]
+def w134 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 134, [x * 134, x - 134])]
+def w135 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 135, [x * 135, x - 135])]
+def w136 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 136, [x * 136, x - 136])]
+def w137 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 137, [x * 137, x - 137])]
+def w138 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 138, [x * 138, x - 138])]
+def w139 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 139, [x * 139, x - 139])]
+def w140 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 140, [x * 140, x - 140])]
+def w141 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 141, [x * 141, x - 141])]
+def w142 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 142, [x * 142, x - 142])]
+def w143 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 143, [x * 143, x - 143])]
+def w144 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 144, [x * 144, x - 144])]
+def w145 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 145, [x * 145, x - 145])]
+def w146 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 146, [x * 146, x - 146])]
+def w147 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 147, [x * 147, x - 147])]
+def w148 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 148, [x * 148, x - 148])]
+def w149 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 149, [x * 149, x - 149])]
+def w150 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 150, [x * 150, x - 150])]
+def w151 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 151, [x * 151, x - 151])]
+def w152 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 152, [x * 152, x - 152])]
+def w153 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 153, [x * 153, x - 153])]
+def w154 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 154, [x * 154, x - 154])]
+def w155 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 155, [x * 155, x - 155])]
+def w156 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 156, [x * 156, x - 156])]
+def w157 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 157, [x * 157, x - 157])]
+def w158 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 158, [x * 158, x - 158])]
+def w159 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 159, [x * 159, x - 159])]
+def w160 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 160, [x * 160, x - 160])]
+def w161 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 161, [x * 161, x - 161])]
+def w162 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 162, [x * 162, x - 162])]
+def w163 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 163, [x * 163, x - 163])]
+def w164 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 164, [x * 164, x - 164])]
+def w165 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 165, [x * 165, x - 165])]
+def w166 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 166, [x * 166, x - 166])]
+def w167 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 167, [x * 167, x - 167])]
+def w168 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 168, [x * 168, x - 168])]
+def w169 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 169, [x * 169, x - 169])]
+def w170 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 170, [x * 170, x - 170])]
+def w171 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 171, [x * 171, x - 171])]
+def w172 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 172, [x * 172, x - 172])]
+def w173 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 173, [x * 173, x - 173])]
+def w174 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 174, [x * 174, x - 174])]
+def w175 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 175, [x * 175, x - 175])]
+def w176 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 176, [x * 176, x - 176])]
+def w177 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 177, [x * 177, x - 177])]
+def w178 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 178, [x * 178, x - 178])]
+def w179 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 179, [x * 179, x - 179])]
+def w180 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 180, [x * 180, x - 180])]
+def w181 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 181, [x * 181, x - 181])]
+def w182 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 182, [x * 182, x - 182])]
+def w183 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 183, [x * 183, x - 183])]
+def w184 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 184, [x * 184, x - 184])]
+def w185 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 185, [x * 185, x - 185])]
+def w186 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 186, [x * 186, x - 186])]
+def w187 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 187, [x * 187, x - 187])]
+def w188 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 188, [x * 188, x - 188])]
+def w189 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 189, [x * 189, x - 189])]
+def w190 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 190, [x * 190, x - 190])]
+def w191 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 191, [x * 191, x - 191])]
+def w192 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 192, [x * 192, x - 192])]
+def w193 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 193, [x * 193, x - 193])]
+def w194 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 194, [x * 194, x - 194])]
+def w195 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 195, [x * 195, x - 195])]
+def w196 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 196, [x * 196, x - 196])]
+def w197 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 197, [x * 197, x - 197])]
+def w198 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 198, [x * 198, x - 198])]
+def w199 (x : Nat) (y : List (Nat × List Nat)) : List (List (Nat × List Nat)) := Wrap.wrap y ++ Wrap.wrap [(x + 199, [x * 199, x - 199])]
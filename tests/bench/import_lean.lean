@@ -0,0 +1,2 @@
+-- Import benchmark: importing all modules of `Lean`.
+import Lean
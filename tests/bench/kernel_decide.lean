@@ -0,0 +1,8 @@
+/-! Kernel benchmark: large `decide` proofs checked by kernel reduction. -/
+
+example : ((List.range 50).map (· * 2)).foldl (· + ·) 0 = 2450 := by decide
+example : ((List.range 100).map (· * 2)).foldl (· + ·) 0 = 9900 := by decide
+example : ((List.range 150).map (· * 2)).foldl (· + ·) 0 = 22350 := by decide
+example : ((List.range 200).map (· * 2)).foldl (· + ·) 0 = 39800 := by decide
+
+example : (List.range 64).all (fun i => (i * i) % 7 != 3) = true := by decide
@@ -0,0 +1,105 @@
+import Lean.Data.Lsp
+open Lean Lsp JsonRpc IO
+
+/-!
+Replays a recorded LSP session against `lean --server` and reports the latency of each request method and the
+resident memory of the server processes. Usage:
+```
+lean --run lsp_replay.lean <session> [<recorded root URI> <root URI>]
+```
+A session is the client side of a server session in LSP wire format, as recorded in `wdIn.txt` by running the server
+with `LEAN_SERVER_LOG_DIR` set. Occurrences of the recorded root URI, by default `file:///LSP_BENCH`, are replaced with
+the given root URI, by default the URI of the current directory.
+
+Requests are sent one at a time, and their latency is the time until the server responds. Requests of the server
+are answered with `null`. Notifications are sent without waiting, so the latency of a request after `didChange`
+includes the elaboration needed to answer it.
+-/
+
+/-- Resident set size in bytes of the process `pid`, or `0` if it is not available. Only supported on Linux. -/
+def getRss (pid : String) : IO Nat := do
+  try
+    for line in (← FS.lines s!"/proc/{pid}/status") do
+      if line.startsWith "VmRSS:" then
+        let kb := (line.drop 6).trim.takeWhile Char.isDigit
+        return kb.toNat! * 1024
+    return 0
+  catch _ => return 0
+
+/-- Child processes of `pid`. Only supported on Linux. -/
+def getChildren (pid : String) : IO (Array String) := do
+  try
+    let mut r := #[]
+    for task in (← System.FilePath.readDir s!"/proc/{pid}/task") do
+      for child in (← FS.readFile (task.path / "children")).splitOn " " do
+        if !child.trim.isEmpty then r := r.push child.trim
+    return r
+  catch _ => return #[]
+
+/-- Total resident set size of the descendants of this process, i.e., the watchdog and the file workers. -/
+partial def getServerRss : IO Nat := do
+  let rec go (pid : String) : IO Nat := do
+    (← getChildren pid).foldlM (init := 0) fun s child => return s + (← getRss child) + (← go child)
+  go "self"
+
+/-- Read the messages of a session file until its end. -/
+partial def readSession (h : FS.Stream) (acc : Array Message := #[]) : IO (Array Message) := do
+  match (← (h.readLspMessage).toBaseIO) with
+  | .ok msg => readSession h (acc.push msg)
+  | .error _ => return acc
+
+def percentile (xs : Array Float) (p : Float) : Float :=
+  let xs := xs.qsort (· < ·)
+  xs[((xs.size.toFloat - 1) * p).round.toUInt64.toNat]!
+
+structure Stats where
+  latencies : HashMap String (Array Float) := {}
+  rss       : Array Nat := #[]
+
+partial def replay (msgs : Array Message) : Ipc.IpcM Stats := do
+  let mut stats : Stats := {}
+  for msg in msgs do
+    match msg with
+    | .request id method _ =>
+      let start ← monoNanosNow
+      (← Ipc.stdin).writeLspMessage msg
+      waitForResponse id
+      let ms := ((← monoNanosNow) - start).toFloat / 1000000
+      stats := { stats with latencies := stats.latencies.insert method ((stats.latencies.findD method #[]).push ms) }
+      stats := { stats with rss := stats.rss.push (← getServerRss) }
+      if method == "shutdown" then
+        (← Ipc.stdin).writeLspNotification ⟨"exit", Json.null⟩
+        return stats
+    | .notification "exit" _ => return stats
+    | _ => (← Ipc.stdin).writeLspMessage msg
+  Ipc.shutdown 1000000
+  return stats
+where
+  waitForResponse (id : RequestID) : Ipc.IpcM Unit := do
+    match (← Ipc.readMessage) with
+    | .response id' _ | .responseError id' .. =>
+      unless id' == id do waitForResponse id
+    | .request id' _ _ =>
+      (← Ipc.stdin).writeLspMessage (.response id' Json.null)
+      waitForResponse id
+    | _ => waitForResponse id
+
+def main (args : List String) : IO UInt32 := do
+  let (session, fromUri, toUri) ← match args with
+    | [s]       => pure (s, "file:///LSP_BENCH", s!"file://{← currentDir}")
+    | [s, f, t] => pure (s, f, t)
+    | _         => throw <| userError "usage: lsp_replay <session> [<recorded root URI> <root URI>]"
+  let msgs ← readSession (FS.Stream.ofHandle (← FS.Handle.mk session .read))
+  -- substitute URIs in the decoded messages, as the wire format contains their lengths
+  let msgs ← msgs.mapM fun msg =>
+    IO.ofExcept <| Json.parse ((toJson msg).compress.replace fromUri toUri) >>= fromJson? (α := Message)
+  let stats ← Ipc.runWith (← appPath) #["--server"] (replay msgs)
+  let methods := stats.latencies.toArray.qsort (·.1 < ·.1)
+  for (method, ls) in methods do
+    println s!"'{method} count': {ls.size}"
+    println s!"'{method} p50 ms': {percentile ls 0.5}"
+    println s!"'{method} p99 ms': {percentile ls 0.99}"
+  if !stats.rss.isEmpty then
+    println s!"'max server rss': {stats.rss.foldl max 0}"
+    println s!"'final server rss': {stats.rss.back}"
+  return 0
@@ -0,0 +1,26 @@
+/-! Document edited by the recorded session `lsp_session.jsonrpc`, see `lsp_replay.lean`. -/
+
+def fib : Nat → Nat
+  | 0 => 0
+  | 1 => 1
+  | n + 2 => fib n + fib (n + 1)
+
+theorem fib_succ_succ (n : Nat) : fib (n + 2) = fib n + fib (n + 1) := by
+  simp [fib]
+
+theorem fib_le (n : Nat) : fib n ≤ fib (n + 2) := by
+  rw [fib_succ_succ]
+  exact Nat.le_add_right _ _
+
+structure Point where
+  x : Nat
+  y : Nat
+  deriving Repr, DecidableEq
+
+def Point.add (p q : Point) : Point := ⟨p.x + q.x, p.y + q.y⟩
+
+theorem Point.add_comm (p q : Point) : p.add q = q.add p := by
+  simp [Point.add, Nat.add_comm]
+
+example (xs ys : List Nat) : (xs ++ ys).length = ys.length + xs.length := by
+  simp [Nat.add_comm]
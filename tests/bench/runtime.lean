@@ -0,0 +1,172 @@
+/-!
+Microbenchmarks for the runtime: small object allocation, reference counting of shared objects,
+closure application, and tasks. Usage: `runtime.lean.out <case> <n>`, the cases are listed in `main`.
+Every case prints a checksum and the average time per operation, except for `free`, which prints the pause times
+in the format expected by `parse_output` of temci.
+
+The data of the reference counting cases depends on `n`, which is only known at runtime. Constant data would be
+extracted into closed terms, which are persistent and not reference counted.
+-/
+
+/-- Allocate and free `n` arrays with `k` elements, i.e., objects of size `8 * (k + 3)` bytes. -/
+@[noinline] def allocFree (k : Nat) (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for i in [0:n] do
+    let a := mkArray k i
+    s := s + a[0]!
+  return s
+
+/-- Allocate `n` objects in a task and free them on the main thread. -/
+def crossThreadFree (n : Nat) : IO Nat := do
+  let mut s := 0
+  for _ in [0:n / 1000] do
+    let t ← IO.asTask (prio := .dedicated) do
+      return (List.range 1000).map fun i => #[i]
+    match t.get with
+    | .ok xs    => s := s + xs.length
+    | .error e  => throw e
+  return s
+
+@[noinline] def dup (a : α) : α × α := (a, a)
+
+/-- The list `[v, v + 1, ..., v + k - 1]`, allocated on the heap if `v` is only known at runtime. -/
+@[noinline] def mkList (v k : Nat) : List Nat := (List.range k).map (· + v)
+
+/-- `n` increments and decrements of the reference count of `xs`. -/
+@[noinline] def touch (xs : List Nat) (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for _ in [0:n] do
+    s := s + (dup xs).1.length
+  return s
+
+/-- Reference counting of an object shared with another thread, which uses atomic operations. -/
+def mtRefCount (n : Nat) : IO Nat := do
+  let xs := mkList n 3
+  let t := Task.spawn fun _ => touch xs n
+  return touch xs n + t.get
+
+inductive Tree where
+  | leaf
+  | node (l : Tree) (v : Nat) (r : Tree)
+
+/-- A complete tree of depth `d`, whose values are offset by `v`. -/
+def mkTree (v : Nat) : Nat → Tree
+  | 0     => .leaf
+  | d + 1 => .node (mkTree v d) (v + d) (mkTree v d)
+
+/-- Sum of the values of `t`. Pushing the children of a node on the work list updates their reference counts. -/
+@[noinline] partial def Tree.sum (t : Tree) : Nat :=
+  go [t] 0
+where
+  go : List Tree → Nat → Nat
+    | [], s                => s
+    | .leaf :: ts, s       => go ts s
+    | .node l v r :: ts, s => go (l :: r :: ts) (s + v)
+
+/--
+Traverse a tree shared by `8` tasks, `n` nodes in total. Similar to parallel elaboration tasks reading the same
+environment and expressions, all reference count updates are atomic, and the ones of the top nodes are contended.
+-/
+def mtTraverse (n : Nat) : Nat :=
+  let t := mkTree n 16
+  let ts := (List.range 8).map fun _ => Task.spawn fun _ => Id.run do
+    let mut s := 0
+    for _ in [0:n / 8 / 65535] do
+      s := s + t.sum
+    return s
+  ts.foldl (fun s t => s + t.get) 0
+
+/--
+Force `n / 1000` shared thunks, each of them from `8` tasks at the same time. The tasks that do not evaluate a thunk
+wait for the one that does, and the number of waits is reported on standard error.
+-/
+def mtThunk (n : Nat) : IO Nat := do
+  let mut s := 0
+  for i in [0:n / 1000] do
+    let t : Thunk Nat := .mk fun _ => (List.range 10000).foldl (· + ·) i
+    let ts := (List.range 8).map fun _ => Task.spawn fun _ => t.get
+    s := ts.foldl (fun s t => s + t.get) s
+  let stats ← IO.getThunkContentionStats
+  IO.eprintln s!"contended: {stats.numContended}, parked: {stats.numParked}"
+  return s
+
+/-- Apply closures of arity `1` to `4` with all their arguments, and partially applied closures. -/
+@[noinline] def fns : Array (Nat → Nat → Nat → Nat → Nat) := #[
+  fun a b c d => a + b + c + d,
+  (fun x a b c d => x + a + b + c + d) 1,
+  (fun x y a b c d => x + y + a + b + c + d) 1 2
+]
+
+@[noinline] def fns1 : Array (Nat → Nat) := #[(· + 1), (fun x y => x + y) 1]
+
+def applyClosures (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for i in [0:n] do
+    let f := fns[i % fns.size]!
+    s := s + f i 1 2 3
+    -- under-application, followed by the application of the resulting closure
+    let g := f i
+    s := s + g 1 2 3
+    s := s + fns1[i % fns1.size]! i
+  return s
+
+/-- Spawn a task and wait for it, `n` times. -/
+def spawnLatency (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for i in [0:n] do
+    s := s + (Task.spawn fun _ => i + 1).get
+  return s
+
+/-- Spawn `n` tasks, then wait for all of them. -/
+def spawnThroughput (n : Nat) : Nat :=
+  let ts := (List.range n).map fun i => Task.spawn fun _ => i + 1
+  ts.foldl (fun s t => s + t.get) 0
+
+@[noinline] def mkGraph (v k : Nat) : List (Array Nat) := (List.range k).map fun i => #[v + i]
+
+/--
+Release `n` dead object graphs of `100000` objects and report the longest and the average pause, i.e., the time until
+the program continues after the last reference of a graph has been dropped. Freeing is deferred when the runtime is
+compiled with `LAZY_RC`, and then spread over the allocations of the next graph.
+-/
+def freePauses (n : Nat) : IO Unit := do
+  let mut maxPause := 0
+  let mut total := 0
+  let mut s := 0
+  for i in [0:n] do
+    let xs ← IO.lazyPure fun _ => mkGraph i 100000
+    let start ← IO.monoNanosNow
+    -- `xs` dies together with this closure
+    s := s + (← IO.lazyPure fun _ => xs.length)
+    let pause := (← IO.monoNanosNow) - start
+    maxPause := max maxPause pause
+    total := total + pause
+  IO.println s!"'checksum': {s}"
+  IO.println s!"'max pause ms': {maxPause.toFloat / 1000000}"
+  IO.println s!"'avg pause ms': {total.toFloat / 1000000 / (max n 1).toFloat}"
+
+def run (name : String) (n : Nat) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r} ({(stop - start) / max n 1} ns/op)"
+
+def main : List String → IO UInt32
+  | [c, n] => do
+    let n := n.toNat!
+    match c with
+    | "alloc"      => for k in [1, 2, 4, 8, 16, 32, 64] do run s!"alloc {8 * (k + 3)} bytes" n (IO.lazyPure fun _ => allocFree k n)
+    | "xfree"      => run c n (crossThreadFree n)
+    | "rc"         => run c n (IO.lazyPure fun _ => touch (mkList n 3) n)
+    | "mtrc"       => run c n (mtRefCount n)
+    | "mttraverse" => run c n (IO.lazyPure fun _ => mtTraverse n)
+    | "mtthunk"    => run c n (mtThunk n)
+    | "apply"      => run c n (IO.lazyPure fun _ => applyClosures n)
+    | "spawn"      => run c n (IO.lazyPure fun _ => spawnLatency n)
+    | "spawn_many" => run c n (IO.lazyPure fun _ => spawnThroughput n)
+    | "free"       => freePauses n
+    | _            => IO.println s!"unknown case '{c}'"; return 1
+    return 0
+  | _ => do
+    IO.println "usage: runtime <alloc|xfree|rc|mtrc|mttraverse|mtthunk|apply|spawn|spawn_many|free> <n>"
+    return 1
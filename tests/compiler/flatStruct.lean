@@ -0,0 +1,46 @@
+/-! Structures of scalars stored inline in constructor objects, compiled to C. -/
+
+@[flat_struct] structure Point where
+  x : Float
+  y : Float
+
+-- has an object field, so it is not stored inline
+@[flat_struct] structure Tagged where
+  tag : Nat
+  val : UInt8
+
+@[flat_struct] structure Pixel where
+  r : UInt8
+  g : UInt8
+  b : UInt8
+
+structure Line where
+  name : String
+  t    : Tagged
+  a    : Point
+  b    : Point
+  c    : Pixel
+  w    : UInt8
+
+@[noinline] def mkLine (x : Float) : Line :=
+  { name := "l", t := ⟨1, 2⟩, a := { x, y := x + 1 }, b := { x := 2 * x, y := 3 }, c := ⟨10, 20, 30⟩, w := 7 }
+
+@[noinline] def Line.length (l : Line) : Float :=
+  Float.sqrt ((l.b.x - l.a.x)^2 + (l.b.y - l.a.y)^2)
+
+@[noinline] def Line.swap : Line → Line
+  | { name, t, a, b, c, w } => { name, t, a := b, b := a, c, w }
+
+@[noinline] def Line.start (l : Line) : Point := l.a
+
+@[noinline] def Line.move (l : Line) (dx : Float) : Line :=
+  { l with a.x := l.a.x + dx, c.g := l.c.g + 1 }
+
+def main : IO Unit := do
+  let l := mkLine 1
+  IO.println l.length
+  let s := l.swap
+  IO.println s!"{s.a.x} {s.a.y} {s.b.x} {s.b.y} {s.w}"
+  IO.println l.start.y
+  let l := l.move 1
+  IO.println s!"{l.name} {l.t.tag} {l.t.val} {l.a.x} {l.a.y} {l.c.r} {l.c.g} {l.c.b} {l.w}"
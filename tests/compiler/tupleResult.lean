@@ -0,0 +1,25 @@
+/-! Functions returning pairs and state monad actions, whose results are returned without allocating them. -/
+
+@[noinline] def divMod (a b : Nat) : Nat × Nat :=
+  (a / b, a % b)
+
+@[noinline] def swap (p : String × Nat) : Nat × String :=
+  (p.2, p.1)
+
+def count (xs : List Nat) : StateM (Nat × Nat) Unit := do
+  for x in xs do
+    modify fun (evens, odds) => if x % 2 == 0 then (evens + 1, odds) else (evens, odds + 1)
+
+partial def loop (n : Nat) (acc : Nat × Nat) : Nat × Nat :=
+  if n == 0 then acc else
+    let (q, r) := divMod (n + acc.1) 7
+    loop (n - 1) (acc.1 + q % 3, acc.2 + r)
+
+def main : IO Unit := do
+  let (q, r) := divMod 100 7
+  IO.println s!"{q} {r}"
+  let (n, s) := swap ("a", 1)
+  IO.println s!"{n} {s}"
+  let ((), (e, o)) := (count (List.range 11)).run (0, 0)
+  IO.println s!"{e} {o}"
+  IO.println (loop 1000 (0, 0))
@@ -0,0 +1,47 @@
+/-! Actions run with `IO.withArena`, whose results are moved out of the arena. -/
+
+def sumSquares (n : Nat) : IO (List Nat) := IO.withArena do
+  -- temporary objects that are dead when the action is done
+  let tmp := (List.range n).map (· * 2)
+  let xs := (List.range n).map fun i => i * i
+  return xs.take (tmp.length / 200)
+
+def fill (a : Array String) : IO (Array String) := IO.withArena do
+  -- updated destructively, the new elements are allocated in the arena
+  return a.map (· ++ "!")
+
+def big : IO Nat := IO.withArena do
+  return (List.range 30).foldl (fun s i => s * 1000 + i) 1
+
+def nested : IO (List String) := IO.withArena do
+  let xs ← IO.withArena do
+    return (List.range 3).map toString
+  return xs ++ ["x"]
+
+def fail : IO Nat := IO.withArena do
+  throw <| IO.userError s!"error {(List.range 5).map (· + 1)}"
+
+def storeInRef (r : IO.Ref (List Nat)) : IO Unit := IO.withArena do
+  -- the arena is kept alive, as its objects are reachable from `r`
+  r.set ((List.range 5).map (· + 10))
+
+def forceThunk (t : Thunk (List Nat)) : IO Nat := IO.withArena do
+  -- the value of the thunk is allocated on the heap
+  return t.get.length
+
+def main : IO Unit := do
+  IO.println (← sumSquares 1000)
+  IO.println (← fill #["a", "b"])
+  IO.println ((← big) % 1000000007)
+  IO.println (← nested)
+  try discard <| fail catch e => IO.println e
+  let t ← IO.withArena do return (Task.pure [1, 2, 3])
+  IO.println t.get
+  let r ← IO.mkRef []
+  storeInRef r
+  discard <| IO.withArena do return (List.range 100).map (· + 1)
+  IO.println (← r.get)
+  let t := Thunk.mk fun _ => (List.range 4).map (· * 3)
+  IO.println (← forceThunk t)
+  discard <| IO.withArena do return (List.range 100).map (· + 1)
+  IO.println t.get
@@ -0,0 +1,7 @@
+set_option linter.async true
+
+def f (x : Nat) : Nat := 0
+
+#eval f 1
+
+def g (y : Nat) : Nat := 1
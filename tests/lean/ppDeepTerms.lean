@@ -0,0 +1,12 @@
+def f (n : Nat) : Nat := n
+
+-- the output for repeated subterms is reused
+#check (f (f 1), f (f 1), fun x : Nat => (f (f x), f (f x)))
+
+set_option pp.deepTerms false in
+set_option pp.deepTerms.threshold 4 in
+#check f (f (f (f (f (f (f (f (f (f 0)))))))))
+
+set_option pp.deepTerms false in
+set_option pp.deepTerms.threshold 4 in
+#check (f (f (f (f (f (f 0))))), f (f (f (f (f (f 0))))))
@@ -0,0 +1,21 @@
+import Lean
+open Lean
+
+def mkThm (n : Name) (type value : Expr) : Declaration :=
+  .thmDecl { name := n, levelParams := [], type, value, all := [n] }
+
+#eval show CoreM Unit from do
+  addDecls [
+    mkThm `t1 (mkConst ``True) (mkConst ``True.intro),
+    .defnDecl { name := `d1, levelParams := [], type := mkConst ``Prop, value := mkConst ``True,
+                hints := .abbrev, safety := .safe, all := [`d1] },
+    mkThm `t2 (mkConst `d1) (mkConst `t1)]
+  assert! (← getEnv).contains `t2
+
+#eval show CoreM Unit from do
+  try
+    addDecls [mkThm `bad1 (mkConst ``True) (mkConst ``True.intro), mkThm `bad2 (mkConst ``False) (mkConst `bad1)]
+    throwError "unreachable"
+  catch ex =>
+    assert! (← ex.toMessageData.toString).startsWith "(kernel) declaration type mismatch"
+    assert! !(← getEnv).contains `bad1
@@ -0,0 +1,9 @@
+def xs : Array Nat := (List.range 10000).toArray.map fun i => (i * 7919) % 10007
+
+#eval show IO Unit from do
+  assert! xs.parMap (· + 1) == xs.map (· + 1)
+  assert! xs.parMap (· * 2) (grainSize := 100) == xs.map (· * 2)
+  assert! xs.parFoldl (· + ·) (· + ·) 0 (grainSize := 333) == xs.foldl (· + ·) 0
+  assert! xs.parQSort (· < ·) (grainSize := 500) == xs.qsort (· < ·)
+  assert! (#[] : Array Nat).parQSort (· < ·) == #[]
+  assert! Array.parChunks 10 3 == #[(0, 3), (3, 6), (6, 9), (9, 10)]
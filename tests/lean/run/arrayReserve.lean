@@ -0,0 +1,15 @@
+def pushN (n : Nat) : Array Nat := Id.run do
+  let mut as := (#[] : Array Nat).reserve 10
+  for i in [0:n] do
+    as := as.push i
+  return as
+
+#eval show IO Unit from do
+  let as := pushN 100000
+  assert! as.size == 100000 && as[99999]! == 99999
+  assert! ((#[1, 2].reserve 1000).push 3) == #[1, 2, 3]
+  let mut bs := ByteArray.empty.reserve 4
+  for i in [0:10000] do
+    bs := bs.push i.toUInt8
+  assert! bs.size == 10000 && bs[9999]! == (9999 : Nat).toUInt8
+  assert! ((FloatArray.empty.reserve 3).push 1.5).toList == [1.5]
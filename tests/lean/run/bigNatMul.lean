@@ -0,0 +1,11 @@
+-- Exercise the subquadratic multiplication paths with large and unbalanced operands.
+def a : Nat := 3^20000 + 12345
+def b : Nat := 7^9000 + 1
+def c : Nat := 2^4096 - 1
+
+#eval show IO Unit from do
+  assert! (a + 1) * (a - 1) == a * a - 1
+  assert! (a * b) / b == a && (a * b) % b == 0
+  assert! (a * c) / c == a && (a * c + 17) % c == 17
+  assert! (b * c) * a == b * (c * a)
+  assert! c * c == 2^8192 - 2^4097 + 1
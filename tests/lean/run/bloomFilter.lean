@@ -0,0 +1,24 @@
+import Lean
+open Lean
+
+-- inserted values always pass the filter
+#eval show IO Unit from do
+  let names := (List.range 1000).map fun i => Name.mkSimple s!"n{i}"
+  let f := names.foldl BloomFilter.insert (BloomFilter.mkEmpty names.length)
+  unless names.all f.mayContain do
+    throw <| IO.userError "inserted name rejected"
+  let others := (List.range 1000).filter fun i => f.mayContain (Name.mkSimple s!"m{i}")
+  unless others.length < 20 do
+    throw <| IO.userError s!"too many false positives: {others.length}"
+  unless ({} : BloomFilter).mayContain `x do
+    throw <| IO.userError "the empty filter must not reject names"
+
+-- lookups of imported and local constants
+def localConst := 1
+
+#eval show MetaM Unit from do
+  let env ← getEnv
+  unless env.contains ``Nat.add && (env.find? ``List.map).isSome && env.contains ``localConst do
+    throw <| IO.userError "constant not found"
+  if env.contains `Nat.doesNotExist || (env.find? `localConstDoesNotExist).isSome then
+    throw <| IO.userError "unexpected constant"
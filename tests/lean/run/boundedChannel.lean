@@ -0,0 +1,36 @@
+def test : IO Unit := do
+  let ch ← IO.BoundedChannel.new (α := Nat) (capacity := 5)
+  assert! ch.capacity == 8
+  -- producers block while the buffer is full
+  let producers ← (List.range 4).mapM fun i => IO.asTask (prio := .dedicated) do
+    for j in [0:1000] do
+      ch.send (i * 1000 + j)
+  let consumers ← (List.range 2).mapM fun _ => IO.asTask (prio := .dedicated) do
+    let mut s := 0
+    for v in ch.sync do
+      s := s + v
+    return s
+  for t in producers do
+    discard <| IO.ofExcept t.get
+  ch.close
+  let mut s := 0
+  for t in consumers do
+    s := s + (← IO.ofExcept t.get)
+  assert! s == (List.range 4000).foldl (· + ·) 0
+
+def testNonBlocking : IO Unit := do
+  let ch ← IO.BoundedChannel.new (α := String) (capacity := 2)
+  let t ← ch.recv?
+  assert! (← ch.trySend "a")
+  assert! t.get == some "a"
+  assert! (← ch.trySend "b")
+  assert! (← ch.trySend "c")
+  assert! !(← ch.trySend "d")
+  ch.close
+  ch.send "e"
+  assert! (← ch.sync.recv?) == some "b"
+  assert! (← ch.sync.recv?) == some "c"
+  assert! (← ch.sync.recv?) == none
+
+#eval test
+#eval testNonBlocking
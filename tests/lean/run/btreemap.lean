@@ -0,0 +1,56 @@
+import Lean.Data.BTreeMap
+import Lean.Data.RBMap
+
+open Lean
+
+/-- Apply pseudo-random insertions and erasures to a `BTreeMap` and an `RBMap`, and compare the results. -/
+def check (n : Nat) (seed : Nat) : IO Unit := do
+  let mut t : BTreeMap Nat Nat compare := {}
+  let mut r : RBMap Nat Nat compare := {}
+  let mut x := seed
+  for i in [0:n] do
+    x := (x * 1103515245 + 12345) % 2147483648
+    let k := x % 500
+    if x % 3 == 0 then
+      t := t.erase k
+      r := r.erase k
+    else
+      t := t.insert k i
+      r := r.insert k i
+  unless t.toList == r.toList do
+    throw <| IO.userError s!"mismatch: {t.toList} vs. {r.toList}"
+  unless t.size == r.size do
+    throw <| IO.userError s!"wrong size {t.size}, expected {r.size}"
+  for k in [0:500] do
+    unless t.find? k == r.find? k do
+      throw <| IO.userError s!"wrong value for {k}"
+  unless t.min == r.min && t.max == r.max do
+    throw <| IO.userError "wrong min/max"
+
+#eval check 100 1
+#eval check 5000 2
+#eval check 20000 3
+
+def ascending : BTreeMap Nat String compare :=
+  (List.range 1000).foldl (fun t i => t.insert i (toString i)) {}
+
+def expect (b : Bool) (msg : String) : IO Unit :=
+  unless b do throw <| IO.userError msg
+
+def checkAscending : IO Unit := do
+  expect (ascending.size == 1000) "size"
+  expect (ascending.depth ≤ 4) "depth"
+  expect (ascending.find? 617 == some "617") "find?"
+  expect (ascending.fold (fun s k _ => s + k) 0 == 499500) "fold"
+  expect (ascending.any fun k _ => k == 999) "any"
+  expect (ascending.all fun k v => toString k == v) "all"
+  -- `for` stops at `break`
+  let mut n := 0
+  for (k, _) in ascending do
+    if k == 10 then break
+    n := n + 1
+  expect (n == 10) "break"
+  let t := (List.range 1000).foldl (fun t i => t.erase i) ascending
+  expect (t.isEmpty && t.toList.isEmpty) "erase"
+
+#eval checkAscending
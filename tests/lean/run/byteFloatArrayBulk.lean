@@ -0,0 +1,20 @@
+def bs : ByteArray := [3, 1, 4, 1, 5].toByteArray
+
+#eval show IO Unit from do
+  assert! (bs.fill 7).toList == [7, 7, 7, 7, 7]
+  assert! bs.indexOf? 1 == some 1
+  assert! bs.indexOf? 1 (start := 2) == some 3
+  assert! bs.indexOf? 9 == none
+  assert! compare bs bs == .eq
+  assert! compare bs ([3, 1, 4].toByteArray) == .gt
+  assert! compare bs ([3, 2].toByteArray) == .lt
+  assert! bs == [3, 1, 4, 1, 5].toByteArray
+
+def fs : FloatArray := [1, 2, 3, 4, 5, 6].toFloatArray
+
+#eval show IO Unit from do
+  assert! fs.sum == 21
+  assert! fs.dot fs == 91
+  assert! (fs.map (· * 2)).toList == [2, 4, 6, 8, 10, 12]
+  assert! (fs.zipWith (· - ·) ([1, 1, 1].toFloatArray)).toList == [0, 1, 2]
+  assert! (fs.fill 0).sum == 0
@@ -0,0 +1,21 @@
+def bs : ByteArray := [1, 2, 3, 4, 5, 6].toByteArray
+
+#eval show IO Unit from do
+  let s := bs.toSubarray 1 4
+  assert! s.size == 3
+  assert! s[0]! == 2 && s[2]! == 4
+  assert! s.toByteArray.toList == [2, 3, 4]
+  assert! s.foldl (· + ·.toNat) 0 == 9
+  let mut acc := #[]
+  for b in s do
+    acc := acc.push b
+  assert! acc == #[2, 3, 4]
+  assert! (bs.toSubarray 4 2).size == 0
+  assert! (bs.toSubarray 3 100).toByteArray.toList == [4, 5, 6]
+
+#eval show IO Unit from do
+  let tmp := "byteSubarray.tmp"
+  IO.FS.withFile tmp .write fun h => h.writeSubarray (bs.toSubarray 2 5)
+  let r ← IO.FS.readBinFile tmp
+  IO.FS.removeFile tmp
+  assert! r.toList == [3, 4, 5]
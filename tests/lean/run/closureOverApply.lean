@@ -0,0 +1,19 @@
+-- Over-applied and large-arity closures go through the generic paths of `lean_apply_*`.
+@[noinline] def add3 (a b c : Nat) : Nat → Nat := fun d => a + b + c + d
+
+@[noinline] def sum18 (a1 a2 a3 a4 a5 a6 a7 a8 a9 a10 a11 a12 a13 a14 a15 a16 a17 a18 : Nat) : Nat :=
+  a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10 + a11 + a12 + a13 + a14 + a15 + a16 + a17 + a18
+
+@[noinline] def mkPap (n : Nat) : Nat → Nat → Nat → Nat → Nat := add3 n
+
+@[noinline] def mkPap18 (n : Nat) := sum18 n 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1
+
+#eval show IO Unit from do
+  let f := mkPap 1
+  assert! f 2 3 4 == 10
+  assert! f 2 3 4 == 10 -- `f` is shared now
+  assert! mkPap 1 2 3 4 == 10
+  let g := mkPap18 [1, 2].length
+  assert! g 1 1 == 19
+  assert! g 2 2 == 21
+  assert! mkPap18 0 1 1 == 17
@@ -0,0 +1,28 @@
+import Lean.Syntax.Compact
+import Lean.Parser.Module
+open Lean
+
+def sameInfo : SourceInfo → SourceInfo → Bool
+  | .original l p t e, .original l' p' t' e' =>
+    l.startPos == l'.startPos && l.stopPos == l'.stopPos && p == p' && t.startPos == t'.startPos &&
+      t.stopPos == t'.stopPos && e == e'
+  | .synthetic p e c, .synthetic p' e' c' => p == p' && e == e' && c == c'
+  | .none, .none => true
+  | _, _ => false
+
+/-- `stx` is equal to `stx'` including its source info. -/
+partial def sameInfos : Syntax → Syntax → Bool
+  | .node i k as, .node i' k' as' =>
+    sameInfo i i' && k == k' && as.size == as'.size && (as.zip as').all fun (a, a') => sameInfos a a'
+  | s, s' => s == s' && sameInfo s.getHeadInfo s'.getHeadInfo
+
+#eval show IO Unit from do
+  let input := "/- comment -/ import Init.Data  -- trailing\nimport  Lean.Syntax\n"
+  let (stx, _, _) ← Parser.parseHeader (Parser.mkInputContext input "<input>")
+  for stx in [stx, stx.updateLeading] do
+    let stx' := stx.compact.expand input
+    unless sameInfos stx stx' && stx.reprint == stx'.reprint do
+      throw <| IO.userError s!"mismatch: {stx} vs. {stx'}"
+    if let .node _ _ args := stx.compact then
+      if args.all (· matches .other _) then
+        throw <| IO.userError "not compacted"
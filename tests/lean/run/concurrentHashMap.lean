@@ -0,0 +1,20 @@
+def test : IO Unit := do
+  let m ← IO.ConcurrentHashMap.new (α := Nat) (β := Nat) (numShards := 8)
+  let tasks ← (List.range 8).mapM fun i => IO.asTask do
+    for j in [0:1000] do
+      m.insert (i * 1000 + j) j
+      discard <| m.findOrInsert (j % 10) i
+  for t in tasks do
+    discard <| IO.ofExcept t.get
+  for i in [0:8] do
+    for j in [0:1000] do
+      if i * 1000 + j ≥ 10 then
+        assert! (← m.find? (i * 1000 + j)) == some j
+  m.erase 4242
+  assert! !(← m.contains 4242)
+  assert! (← m.contains 4243)
+  let v ← m.findOrInsert 100000 1
+  assert! v == 1
+  assert! (← m.findOrInsert 100000 2) == 1
+
+#eval test
@@ -0,0 +1,413 @@
+/-! Common subexpression elimination on a long sequence of let-declarations. -/
+
+def f (x : Nat) : Nat :=
+  let a0 := x
+  let a1 := a0 * 3 + x
+  let b1 := a0 * 3 + x
+  let a2 := a1 * 3 + x
+  let b2 := a1 * 3 + x
+  let a3 := a2 * 3 + x
+  let b3 := a2 * 3 + x
+  let a4 := a3 * 3 + x
+  let b4 := a3 * 3 + x
+  let a5 := a4 * 3 + x
+  let b5 := a4 * 3 + x
+  let a6 := a5 * 3 + x
+  let b6 := a5 * 3 + x
+  let a7 := a6 * 3 + x
+  let b7 := a6 * 3 + x
+  let a8 := a7 * 3 + x
+  let b8 := a7 * 3 + x
+  let a9 := a8 * 3 + x
+  let b9 := a8 * 3 + x
+  let a10 := a9 * 3 + x
+  let b10 := a9 * 3 + x
+  let a11 := a10 * 3 + x
+  let b11 := a10 * 3 + x
+  let a12 := a11 * 3 + x
+  let b12 := a11 * 3 + x
+  let a13 := a12 * 3 + x
+  let b13 := a12 * 3 + x
+  let a14 := a13 * 3 + x
+  let b14 := a13 * 3 + x
+  let a15 := a14 * 3 + x
+  let b15 := a14 * 3 + x
+  let a16 := a15 * 3 + x
+  let b16 := a15 * 3 + x
+  let a17 := a16 * 3 + x
+  let b17 := a16 * 3 + x
+  let a18 := a17 * 3 + x
+  let b18 := a17 * 3 + x
+  let a19 := a18 * 3 + x
+  let b19 := a18 * 3 + x
+  let a20 := a19 * 3 + x
+  let b20 := a19 * 3 + x
+  let a21 := a20 * 3 + x
+  let b21 := a20 * 3 + x
+  let a22 := a21 * 3 + x
+  let b22 := a21 * 3 + x
+  let a23 := a22 * 3 + x
+  let b23 := a22 * 3 + x
+  let a24 := a23 * 3 + x
+  let b24 := a23 * 3 + x
+  let a25 := a24 * 3 + x
+  let b25 := a24 * 3 + x
+  let a26 := a25 * 3 + x
+  let b26 := a25 * 3 + x
+  let a27 := a26 * 3 + x
+  let b27 := a26 * 3 + x
+  let a28 := a27 * 3 + x
+  let b28 := a27 * 3 + x
+  let a29 := a28 * 3 + x
+  let b29 := a28 * 3 + x
+  let a30 := a29 * 3 + x
+  let b30 := a29 * 3 + x
+  let a31 := a30 * 3 + x
+  let b31 := a30 * 3 + x
+  let a32 := a31 * 3 + x
+  let b32 := a31 * 3 + x
+  let a33 := a32 * 3 + x
+  let b33 := a32 * 3 + x
+  let a34 := a33 * 3 + x
+  let b34 := a33 * 3 + x
+  let a35 := a34 * 3 + x
+  let b35 := a34 * 3 + x
+  let a36 := a35 * 3 + x
+  let b36 := a35 * 3 + x
+  let a37 := a36 * 3 + x
+  let b37 := a36 * 3 + x
+  let a38 := a37 * 3 + x
+  let b38 := a37 * 3 + x
+  let a39 := a38 * 3 + x
+  let b39 := a38 * 3 + x
+  let a40 := a39 * 3 + x
+  let b40 := a39 * 3 + x
+  let a41 := a40 * 3 + x
+  let b41 := a40 * 3 + x
+  let a42 := a41 * 3 + x
+  let b42 := a41 * 3 + x
+  let a43 := a42 * 3 + x
+  let b43 := a42 * 3 + x
+  let a44 := a43 * 3 + x
+  let b44 := a43 * 3 + x
+  let a45 := a44 * 3 + x
+  let b45 := a44 * 3 + x
+  let a46 := a45 * 3 + x
+  let b46 := a45 * 3 + x
+  let a47 := a46 * 3 + x
+  let b47 := a46 * 3 + x
+  let a48 := a47 * 3 + x
+  let b48 := a47 * 3 + x
+  let a49 := a48 * 3 + x
+  let b49 := a48 * 3 + x
+  let a50 := a49 * 3 + x
+  let b50 := a49 * 3 + x
+  let a51 := a50 * 3 + x
+  let b51 := a50 * 3 + x
+  let a52 := a51 * 3 + x
+  let b52 := a51 * 3 + x
+  let a53 := a52 * 3 + x
+  let b53 := a52 * 3 + x
+  let a54 := a53 * 3 + x
+  let b54 := a53 * 3 + x
+  let a55 := a54 * 3 + x
+  let b55 := a54 * 3 + x
+  let a56 := a55 * 3 + x
+  let b56 := a55 * 3 + x
+  let a57 := a56 * 3 + x
+  let b57 := a56 * 3 + x
+  let a58 := a57 * 3 + x
+  let b58 := a57 * 3 + x
+  let a59 := a58 * 3 + x
+  let b59 := a58 * 3 + x
+  let a60 := a59 * 3 + x
+  let b60 := a59 * 3 + x
+  let a61 := a60 * 3 + x
+  let b61 := a60 * 3 + x
+  let a62 := a61 * 3 + x
+  let b62 := a61 * 3 + x
+  let a63 := a62 * 3 + x
+  let b63 := a62 * 3 + x
+  let a64 := a63 * 3 + x
+  let b64 := a63 * 3 + x
+  let a65 := a64 * 3 + x
+  let b65 := a64 * 3 + x
+  let a66 := a65 * 3 + x
+  let b66 := a65 * 3 + x
+  let a67 := a66 * 3 + x
+  let b67 := a66 * 3 + x
+  let a68 := a67 * 3 + x
+  let b68 := a67 * 3 + x
+  let a69 := a68 * 3 + x
+  let b69 := a68 * 3 + x
+  let a70 := a69 * 3 + x
+  let b70 := a69 * 3 + x
+  let a71 := a70 * 3 + x
+  let b71 := a70 * 3 + x
+  let a72 := a71 * 3 + x
+  let b72 := a71 * 3 + x
+  let a73 := a72 * 3 + x
+  let b73 := a72 * 3 + x
+  let a74 := a73 * 3 + x
+  let b74 := a73 * 3 + x
+  let a75 := a74 * 3 + x
+  let b75 := a74 * 3 + x
+  let a76 := a75 * 3 + x
+  let b76 := a75 * 3 + x
+  let a77 := a76 * 3 + x
+  let b77 := a76 * 3 + x
+  let a78 := a77 * 3 + x
+  let b78 := a77 * 3 + x
+  let a79 := a78 * 3 + x
+  let b79 := a78 * 3 + x
+  let a80 := a79 * 3 + x
+  let b80 := a79 * 3 + x
+  let a81 := a80 * 3 + x
+  let b81 := a80 * 3 + x
+  let a82 := a81 * 3 + x
+  let b82 := a81 * 3 + x
+  let a83 := a82 * 3 + x
+  let b83 := a82 * 3 + x
+  let a84 := a83 * 3 + x
+  let b84 := a83 * 3 + x
+  let a85 := a84 * 3 + x
+  let b85 := a84 * 3 + x
+  let a86 := a85 * 3 + x
+  let b86 := a85 * 3 + x
+  let a87 := a86 * 3 + x
+  let b87 := a86 * 3 + x
+  let a88 := a87 * 3 + x
+  let b88 := a87 * 3 + x
+  let a89 := a88 * 3 + x
+  let b89 := a88 * 3 + x
+  let a90 := a89 * 3 + x
+  let b90 := a89 * 3 + x
+  let a91 := a90 * 3 + x
+  let b91 := a90 * 3 + x
+  let a92 := a91 * 3 + x
+  let b92 := a91 * 3 + x
+  let a93 := a92 * 3 + x
+  let b93 := a92 * 3 + x
+  let a94 := a93 * 3 + x
+  let b94 := a93 * 3 + x
+  let a95 := a94 * 3 + x
+  let b95 := a94 * 3 + x
+  let a96 := a95 * 3 + x
+  let b96 := a95 * 3 + x
+  let a97 := a96 * 3 + x
+  let b97 := a96 * 3 + x
+  let a98 := a97 * 3 + x
+  let b98 := a97 * 3 + x
+  let a99 := a98 * 3 + x
+  let b99 := a98 * 3 + x
+  let a100 := a99 * 3 + x
+  let b100 := a99 * 3 + x
+  let a101 := a100 * 3 + x
+  let b101 := a100 * 3 + x
+  let a102 := a101 * 3 + x
+  let b102 := a101 * 3 + x
+  let a103 := a102 * 3 + x
+  let b103 := a102 * 3 + x
+  let a104 := a103 * 3 + x
+  let b104 := a103 * 3 + x
+  let a105 := a104 * 3 + x
+  let b105 := a104 * 3 + x
+  let a106 := a105 * 3 + x
+  let b106 := a105 * 3 + x
+  let a107 := a106 * 3 + x
+  let b107 := a106 * 3 + x
+  let a108 := a107 * 3 + x
+  let b108 := a107 * 3 + x
+  let a109 := a108 * 3 + x
+  let b109 := a108 * 3 + x
+  let a110 := a109 * 3 + x
+  let b110 := a109 * 3 + x
+  let a111 := a110 * 3 + x
+  let b111 := a110 * 3 + x
+  let a112 := a111 * 3 + x
+  let b112 := a111 * 3 + x
+  let a113 := a112 * 3 + x
+  let b113 := a112 * 3 + x
+  let a114 := a113 * 3 + x
+  let b114 := a113 * 3 + x
+  let a115 := a114 * 3 + x
+  let b115 := a114 * 3 + x
+  let a116 := a115 * 3 + x
+  let b116 := a115 * 3 + x
+  let a117 := a116 * 3 + x
+  let b117 := a116 * 3 + x
+  let a118 := a117 * 3 + x
+  let b118 := a117 * 3 + x
+  let a119 := a118 * 3 + x
+  let b119 := a118 * 3 + x
+  let a120 := a119 * 3 + x
+  let b120 := a119 * 3 + x
+  let a121 := a120 * 3 + x
+  let b121 := a120 * 3 + x
+  let a122 := a121 * 3 + x
+  let b122 := a121 * 3 + x
+  let a123 := a122 * 3 + x
+  let b123 := a122 * 3 + x
+  let a124 := a123 * 3 + x
+  let b124 := a123 * 3 + x
+  let a125 := a124 * 3 + x
+  let b125 := a124 * 3 + x
+  let a126 := a125 * 3 + x
+  let b126 := a125 * 3 + x
+  let a127 := a126 * 3 + x
+  let b127 := a126 * 3 + x
+  let a128 := a127 * 3 + x
+  let b128 := a127 * 3 + x
+  let a129 := a128 * 3 + x
+  let b129 := a128 * 3 + x
+  let a130 := a129 * 3 + x
+  let b130 := a129 * 3 + x
+  let a131 := a130 * 3 + x
+  let b131 := a130 * 3 + x
+  let a132 := a131 * 3 + x
+  let b132 := a131 * 3 + x
+  let a133 := a132 * 3 + x
+  let b133 := a132 * 3 + x
+  let a134 := a133 * 3 + x
+  let b134 := a133 * 3 + x
+  let a135 := a134 * 3 + x
+  let b135 := a134 * 3 + x
+  let a136 := a135 * 3 + x
+  let b136 := a135 * 3 + x
+  let a137 := a136 * 3 + x
+  let b137 := a136 * 3 + x
+  let a138 := a137 * 3 + x
+  let b138 := a137 * 3 + x
+  let a139 := a138 * 3 + x
+  let b139 := a138 * 3 + x
+  let a140 := a139 * 3 + x
+  let b140 := a139 * 3 + x
+  let a141 := a140 * 3 + x
+  let b141 := a140 * 3 + x
+  let a142 := a141 * 3 + x
+  let b142 := a141 * 3 + x
+  let a143 := a142 * 3 + x
+  let b143 := a142 * 3 + x
+  let a144 := a143 * 3 + x
+  let b144 := a143 * 3 + x
+  let a145 := a144 * 3 + x
+  let b145 := a144 * 3 + x
+  let a146 := a145 * 3 + x
+  let b146 := a145 * 3 + x
+  let a147 := a146 * 3 + x
+  let b147 := a146 * 3 + x
+  let a148 := a147 * 3 + x
+  let b148 := a147 * 3 + x
+  let a149 := a148 * 3 + x
+  let b149 := a148 * 3 + x
+  let a150 := a149 * 3 + x
+  let b150 := a149 * 3 + x
+  let a151 := a150 * 3 + x
+  let b151 := a150 * 3 + x
+  let a152 := a151 * 3 + x
+  let b152 := a151 * 3 + x
+  let a153 := a152 * 3 + x
+  let b153 := a152 * 3 + x
+  let a154 := a153 * 3 + x
+  let b154 := a153 * 3 + x
+  let a155 := a154 * 3 + x
+  let b155 := a154 * 3 + x
+  let a156 := a155 * 3 + x
+  let b156 := a155 * 3 + x
+  let a157 := a156 * 3 + x
+  let b157 := a156 * 3 + x
+  let a158 := a157 * 3 + x
+  let b158 := a157 * 3 + x
+  let a159 := a158 * 3 + x
+  let b159 := a158 * 3 + x
+  let a160 := a159 * 3 + x
+  let b160 := a159 * 3 + x
+  let a161 := a160 * 3 + x
+  let b161 := a160 * 3 + x
+  let a162 := a161 * 3 + x
+  let b162 := a161 * 3 + x
+  let a163 := a162 * 3 + x
+  let b163 := a162 * 3 + x
+  let a164 := a163 * 3 + x
+  let b164 := a163 * 3 + x
+  let a165 := a164 * 3 + x
+  let b165 := a164 * 3 + x
+  let a166 := a165 * 3 + x
+  let b166 := a165 * 3 + x
+  let a167 := a166 * 3 + x
+  let b167 := a166 * 3 + x
+  let a168 := a167 * 3 + x
+  let b168 := a167 * 3 + x
+  let a169 := a168 * 3 + x
+  let b169 := a168 * 3 + x
+  let a170 := a169 * 3 + x
+  let b170 := a169 * 3 + x
+  let a171 := a170 * 3 + x
+  let b171 := a170 * 3 + x
+  let a172 := a171 * 3 + x
+  let b172 := a171 * 3 + x
+  let a173 := a172 * 3 + x
+  let b173 := a172 * 3 + x
+  let a174 := a173 * 3 + x
+  let b174 := a173 * 3 + x
+  let a175 := a174 * 3 + x
+  let b175 := a174 * 3 + x
+  let a176 := a175 * 3 + x
+  let b176 := a175 * 3 + x
+  let a177 := a176 * 3 + x
+  let b177 := a176 * 3 + x
+  let a178 := a177 * 3 + x
+  let b178 := a177 * 3 + x
+  let a179 := a178 * 3 + x
+  let b179 := a178 * 3 + x
+  let a180 := a179 * 3 + x
+  let b180 := a179 * 3 + x
+  let a181 := a180 * 3 + x
+  let b181 := a180 * 3 + x
+  let a182 := a181 * 3 + x
+  let b182 := a181 * 3 + x
+  let a183 := a182 * 3 + x
+  let b183 := a182 * 3 + x
+  let a184 := a183 * 3 + x
+  let b184 := a183 * 3 + x
+  let a185 := a184 * 3 + x
+  let b185 := a184 * 3 + x
+  let a186 := a185 * 3 + x
+  let b186 := a185 * 3 + x
+  let a187 := a186 * 3 + x
+  let b187 := a186 * 3 + x
+  let a188 := a187 * 3 + x
+  let b188 := a187 * 3 + x
+  let a189 := a188 * 3 + x
+  let b189 := a188 * 3 + x
+  let a190 := a189 * 3 + x
+  let b190 := a189 * 3 + x
+  let a191 := a190 * 3 + x
+  let b191 := a190 * 3 + x
+  let a192 := a191 * 3 + x
+  let b192 := a191 * 3 + x
+  let a193 := a192 * 3 + x
+  let b193 := a192 * 3 + x
+  let a194 := a193 * 3 + x
+  let b194 := a193 * 3 + x
+  let a195 := a194 * 3 + x
+  let b195 := a194 * 3 + x
+  let a196 := a195 * 3 + x
+  let b196 := a195 * 3 + x
+  let a197 := a196 * 3 + x
+  let b197 := a196 * 3 + x
+  let a198 := a197 * 3 + x
+  let b198 := a197 * 3 + x
+  let a199 := a198 * 3 + x
+  let b199 := a198 * 3 + x
+  let a200 := a199 * 3 + x
+  let b200 := a199 * 3 + x
+  a1 - b1 + a41 - b41 + a81 - b81 + a121 - b121 + a161 - b161 + a200 % 1000
+
+def g (x : Nat) : Nat := Id.run do
+  let mut a := x
+  for _ in [0:200] do
+    a := a * 3 + x
+  return a % 1000
+
+example : f 1 = g 1 := by native_decide
@@ -0,0 +1,24 @@
+/-!
+`lean --daemon` compiles the file of each request read from its standard input. The second request has the same
+imports as the first one and reuses its imported environment.
+-/
+
+#eval show IO Unit from do
+  let dir : System.FilePath := "daemon.lean.dir"
+  IO.FS.createDirAll dir
+  IO.FS.writeFile (dir / "A.lean") "def a := 1\n"
+  IO.FS.writeFile (dir / "B.lean") "theorem b : 1 + 1 = 2 := rfl\n"
+  let lean ← IO.appPath
+  let daemon ← IO.Process.spawn {
+    cmd    := lean.toString
+    args   := #["--daemon"]
+    stdin  := .piped
+    stdout := .piped
+  }
+  let (stdin, daemon) ← daemon.takeStdin
+  stdin.putStr s!"-R\t{dir}\t{dir / "A.lean"}\n-R\t{dir}\t{dir / "B.lean"}\n"
+  let out ← daemon.stdout.readToEnd
+  let exitCode ← daemon.wait
+  IO.FS.removeDirAll dir
+  unless exitCode == 0 && (out.splitOn "#exit 0\n").length == 3 do
+    throw <| IO.userError s!"daemon failed:\n{out}"
@@ -0,0 +1,39 @@
+import Lean
+open Lean Meta
+
+def check (b : Bool) (msg : String) : MetaM Unit :=
+  unless b do throwError msg
+
+#eval show MetaM Unit from do
+  let m₁ ← mkFreshExprMVar (mkConst ``Nat)
+  let m₂ ← mkFreshExprMVar (mkConst ``Nat)
+  let u ← mkFreshLevelMVar
+  m₁.mvarId!.assign (mkNatLit 0)
+  -- a failing checkpoint undoes the assignments made in it, including reassignments and nested checkpoints
+  let r ← checkpointDefEq do
+    m₁.mvarId!.assign (mkNatLit 1)
+    assignLevelMVar u.mvarId! levelOne
+    discard <| checkpointDefEq do
+      m₂.mvarId!.assign (mkNatLit 2)
+      return true
+    check (← m₂.mvarId!.isAssigned) "nested assignment lost"
+    return false
+  check (!r) "unexpected success"
+  check ((← getExprMVarAssignment? m₁.mvarId!) == some (mkNatLit 0)) "reassignment not undone"
+  check (!(← m₂.mvarId!.isAssigned)) "assignment not undone"
+  check (!(← isLevelMVarAssigned u.mvarId!)) "level assignment not undone"
+  check (!(← getMCtx).trailing && (← getMCtx).trail.isEmpty) "trail still in use"
+  -- a successful checkpoint keeps them
+  check (← isDefEq m₂ (mkNatLit 3)) "isDefEq failed"
+  check ((← instantiateMVars m₂) == mkNatLit 3) "assignment lost"
+  check (!(← getMCtx).trailing && (← getMCtx).trail.isEmpty) "trail still in use"
+  -- exceptions also undo them
+  try
+    discard <| checkpointDefEq do
+      m₁.mvarId!.assign (mkNatLit 4)
+      throwError "failure"
+  catch _ => pure ()
+  check ((← getExprMVarAssignment? m₁.mvarId!) == some (mkNatLit 0)) "assignment not undone after exception"
+
+example (f : Nat → Nat) (h : ∀ x, f x = x) : f (f 2) = 2 := by
+  rw [h, h]
@@ -0,0 +1,31 @@
+import Lean
+open Lean Meta
+
+def check (b : Bool) (msg : String) : MetaM Unit :=
+  unless b do throwError msg
+
+#eval show MetaM Unit from do
+  let t ← mkAppM ``Nat.add #[mkNatLit 2, mkNatLit 3]
+  let s := mkNatLit 5
+  check (← isDefEq t s) "isDefEq failed"
+  let misses := (← get).cache.defEqClosedMisses
+  check (misses > 0) "closed problem not cached"
+  -- the problem is closed, so the result survives the `isDefEq` call
+  check (← isDefEq t s) "isDefEq failed"
+  check ((← get).cache.defEqClosedHits > 0) "no hit"
+  check ((← get).cache.defEqClosedMisses == misses) "unexpected miss"
+  -- the transparency is part of the key
+  discard <| withReducible <| isDefEq t s
+  check ((← get).cache.defEqClosedMisses > misses) "result reused for another transparency"
+  -- and so are the options that affect unfolding, which `set_option ... in` can change within a declaration
+  let misses := (← get).cache.defEqClosedMisses
+  discard <| withOptions (smartUnfolding.set · false) <| isDefEq t s
+  check ((← get).cache.defEqClosedMisses > misses) "result reused for another value of `smartUnfolding`"
+  -- problems with metavariables are not cached in it
+  let m ← mkFreshExprMVar (mkConst ``Nat)
+  let entries := (← get).cache.defEqClosed.size
+  check (← isDefEq m s) "isDefEq failed"
+  check ((← get).cache.defEqClosed.size == entries) "problem with metavariables cached"
+
+set_option trace.Meta.isDefEq.cache.stats true in
+example : (fun x : Nat => x + 0) = (fun x : Nat => x) := rfl
@@ -0,0 +1,20 @@
+import Lean.Server.FileWorker.DiagnosticsCache
+open Lean Server FileWorker DiagnosticsCache Lsp
+
+def diags : Array Diagnostic := #[
+  { range := ⟨⟨1, 2⟩, ⟨1, 5⟩⟩, severity? := DiagnosticSeverity.error, message := "unknown identifier 'x'" },
+  { range := ⟨⟨3, 0⟩, ⟨3, 7⟩⟩, severity? := DiagnosticSeverity.information, message := "1" }
+]
+
+#eval show IO Unit from do
+  let fileName : System.FilePath := "diagnosticsCache.diags"
+  let key ← computeKey "def x := 1" {} #[`Init]
+  save fileName { key, diagnostics := diags }
+  let some ds ← load fileName key | throw <| IO.userError "cache miss"
+  unless ds.map (·.message) == diags.map (·.message) && ds.map (·.range) == diags.map (·.range) do
+    throw <| IO.userError "wrong diagnostics"
+  -- other contents
+  let key' ← computeKey "def x := 2" {} #[`Init]
+  unless key != key' && (← load fileName key').isNone do
+    throw <| IO.userError "unexpected cache hit"
+  IO.FS.removeFile fileName
@@ -0,0 +1,17 @@
+import Lean
+
+open Lean Meta DiscrTree
+
+def entries : Array (Array Key × Nat) := Id.run do
+  let mut es := #[]
+  for i in [0:10000] do
+    let root := Key.const (Name.mkSimple s!"c{i % 53}") 1
+    es := es.push (#[root, .lit (.natVal (i % 7)), .star], i % 5000)
+  return es
+
+-- `insertMany` must build the same tree as inserting the entries one by one
+#eval show IO Unit from do
+  let d₁ := entries.foldl (init := (DiscrTree.empty : DiscrTree Nat)) fun d (keys, v) => d.insertCore keys v
+  let d₂ := (DiscrTree.empty : DiscrTree Nat).insertMany entries
+  unless toString d₁.format == toString d₂.format do
+    throw <| IO.userError "insertMany differs from insertCore"
@@ -0,0 +1,18 @@
+import Lean
+
+open Lean Meta DiscrTree
+
+def keys : List Key := [
+  .star, .other, .arrow, .lit (.natVal 3), .lit (.natVal 10), .lit (.strVal "a"),
+  .const `Nat.add 2, .const `Nat.add 3, .const `HAdd.hAdd 6, .fvar ⟨`x⟩ 0, .fvar ⟨`y⟩ 1,
+  .proj `Prod 0, .proj `Prod 1]
+
+-- `Key.cmp` must agree with `Key.lt`, which is used to keep the children of trie nodes sorted
+#eval show IO Unit from do
+  for k₁ in keys do
+    for k₂ in keys do
+      let expected := if k₁.lt k₂ then Ordering.lt else if k₂.lt k₁ then .gt else .eq
+      unless k₁.cmp k₂ == expected do
+        throw <| IO.userError s!"inconsistent comparison of {repr k₁} and {repr k₂}"
+      unless (k₁.cmp k₂ == .eq) == (k₁ == k₂) do
+        throw <| IO.userError s!"inconsistent equality of {repr k₁} and {repr k₂}"
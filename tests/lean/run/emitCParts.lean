@@ -0,0 +1,30 @@
+import Lean
+open Lean IR
+
+def f1 (n : Nat) : Nat := n + 1
+def f2 (n : Nat) : Nat := f1 n * 2
+def f3 (xs : List Nat) : Nat := xs.foldl (· + f2 ·) 0
+def f4 (s : String) : String := s ++ toString (f3 [1, 2, 3])
+def big : List Nat := List.range 10
+
+/-- Number of occurrences of `pat` in `s`. -/
+def count (s pat : String) : Nat :=
+  (s.splitOn pat).length - 1
+
+#eval show CoreM Unit from do
+  let .ok parts := emitCParts (← getEnv) `emitCParts (numParts := 3) | throwError "emitCParts failed"
+  unless parts.size == 3 do throwError "wrong number of parts"
+  -- every function is defined in exactly one part
+  for fn in ["l_f1(", "l_f2(", "l_f3(", "l_f4("] do
+    let defs := parts.foldl (init := 0) fun n p => n + count p s!"LEAN_EXPORT lean_object* {fn}lean_object* x_1) \{"
+    unless defs == 1 do throwError "{fn} is defined {defs} times"
+  -- only the first part defines the closed terms and the initializer
+  unless count parts[0]! "initialize_emitCParts" == 1 do throwError "missing initializer"
+  for p in parts[1:] do
+    unless count p "initialize_emitCParts" == 0 do throwError "initializer in other part"
+    if count p "static " > 0 then throwError "static definition in other part"
+  -- the other parts only declare the functions they use, and nothing uses `f4`
+  for p in parts[1:] do
+    if count p "l_f4(lean_object* x_1) {" == 0 && count p "l_f4(" > 0 then throwError "unused declaration of f4"
+  let .ok c := emitC (← getEnv) `emitCParts | throwError "emitC failed"
+  unless c == (← IO.ofExcept (emitCParts (← getEnv) `emitCParts)).get! 0 do throwError "single part differs"
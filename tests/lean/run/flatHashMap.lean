@@ -0,0 +1,33 @@
+import Lean.Data.FlatHashMap
+import Lean.Data.HashMap
+
+open Lean
+
+-- compare against `HashMap` on a pseudo-random sequence of insertions and erasures
+def check (n : Nat) : IO Unit := do
+  let mut m : FlatHashMap Nat Nat := {}
+  let mut r : HashMap Nat Nat := {}
+  let mut x := 7
+  for i in [0:n] do
+    x := (x * 1103515245 + 12345) % 2147483648
+    let k := x % 1000
+    if x % 3 == 0 then
+      m := m.erase k
+      r := r.erase k
+    else
+      m := m.insert k i
+      r := r.insert k i
+    unless m.size == r.size do
+      throw <| IO.userError s!"unexpected size {m.size}, expected {r.size}"
+  for k in [0:1000] do
+    unless m.find? k == r.find? k do
+      throw <| IO.userError s!"unexpected value for {k}"
+  unless m.fold (fun s _ v => s + v) 0 == r.fold (fun s _ v => s + v) 0 do
+    throw <| IO.userError "unexpected fold result"
+
+#eval check 20000
+
+#eval show IO Unit from do
+  let m : FlatHashMap String Nat := FlatHashMap.ofList [("a", 1), ("b", 2), ("a", 3)]
+  unless m.size == 2 && m.find? "a" == some 3 && m.find? "c" == none && m.contains "b" do
+    throw <| IO.userError "unexpected result"
@@ -0,0 +1,39 @@
+@[flat_struct] structure Point where
+  x : Float
+  y : Float
+
+-- has an object field, so it is not stored inline
+@[flat_struct] structure Tagged where
+  tag : Nat
+  val : UInt8
+
+structure Line where
+  name : String
+  t    : Tagged
+  a    : Point
+  b    : Point
+  w    : UInt8
+
+@[noinline] def mkLine (x : Float) : Line :=
+  { name := "l", t := ⟨1, 2⟩, a := { x, y := x + 1 }, b := { x := 2 * x, y := 3 }, w := 7 }
+
+@[noinline] def Line.length (l : Line) : Float :=
+  Float.sqrt ((l.b.x - l.a.x)^2 + (l.b.y - l.a.y)^2)
+
+@[noinline] def Line.swap : Line → Line
+  | { name, t, a, b, w } => { name, t, a := b, b := a, w }
+
+@[noinline] def Line.start (l : Line) : Point := l.a
+
+@[noinline] def Line.move (l : Line) (dx : Float) : Line :=
+  { l with a.x := l.a.x + dx }
+
+def test : IO Unit := do
+  let l := mkLine 1
+  assert! l.length == Float.sqrt 2
+  assert! l.swap.a.x == 2 && l.swap.b.y == 2 && l.swap.w == 7
+  assert! l.start.y == 2
+  let l := l.move 1
+  assert! l.a.x == 2 && l.a.y == 2 && l.name == "l" && l.t.tag == 1 && l.t.val == 2
+
+#eval test
@@ -0,0 +1,23 @@
+import Lean.Data.FuzzyMatching
+
+open Lean.FuzzyMatching
+
+def words := ["Nat.add_comm", "List.foldl", "_private.Lean.Foo.0.bar", "αβ.map", "x₁", "HashMap.insert"]
+def patterns := ["nac", "NAT", "fold", "bar", "map", "α", "x", "₁", "hmi", "zz", "a.c", ""]
+
+-- `charMask` must never exclude a word that the fuzzy matcher accepts
+#eval show IO Unit from do
+  for w in words do
+    for p in patterns do
+      if (fuzzyMatchScore? p w).isSome && charMask p &&& charMask w != charMask p then
+        throw <| IO.userError s!"charMask excludes match of {p} in {w}"
+
+#eval show IO Unit from do
+  unless charMask "zz" &&& charMask "List.foldl" != charMask "zz" do
+    throw <| IO.userError "expected `zz` to be excluded"
+
+-- the native implementation agrees with the definition
+#eval show IO Unit from do
+  for (s, m) in [("", 0), ("aB", 3), ("Z", 1 <<< 25), (".", 1 <<< (26 + 46 % 37)), ("α", 1 <<< 63 ||| 1)] do
+    unless charMask s == m do
+      throw <| IO.userError s!"unexpected mask {charMask s} of {s}"
@@ -0,0 +1,22 @@
+open IO FS
+
+def test : IO Unit := do
+  let path : System.FilePath := "handleGetLines.tmp"
+  let lines := (List.range 3000).map fun i => s!"line {i} {String.mk (List.replicate (i % 300) 'x')}"
+  IO.FS.writeFile path (String.intercalate "\n" lines)
+  unless (← IO.FS.lines path).toList == lines do
+    throw <| IO.userError "unexpected lines"
+  let h ← Handle.mk path .read
+  let batch ← h.getLines 2
+  unless batch == #["line 0 \n", "line 1 x\n"] do
+    throw <| IO.userError s!"unexpected batch {batch}"
+  unless (← h.getLine) == "line 2 xx\n" do
+    throw <| IO.userError "unexpected line"
+  let rest ← h.getLines 5000
+  unless rest.size == 2997 && rest.back == lines.getLast! do
+    throw <| IO.userError "unexpected rest"
+  unless (← h.getLines 10).isEmpty do
+    throw <| IO.userError "expected EOF"
+  IO.FS.removeFile path
+
+#eval test
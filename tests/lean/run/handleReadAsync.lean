@@ -0,0 +1,25 @@
+open IO FS
+
+partial def readAllAsync (h : Handle) (acc : ByteArray := .empty) : IO ByteArray := do
+  let chunk ← IO.ofExcept (← h.readAsync 7).get
+  if chunk.isEmpty then
+    return acc
+  readAllAsync h (acc ++ chunk)
+
+def test : IO Unit := do
+  let path : System.FilePath := "handleReadAsync.tmp"
+  let contents := String.join (List.replicate 100 "hello async world\n")
+  IO.FS.writeFile path contents
+  let h ← Handle.mk path .read
+  let bytes ← readAllAsync h
+  unless bytes.data == contents.toUTF8.data do
+    throw <| IO.userError "unexpected contents"
+  -- several pending reads on different handles
+  let hs ← (List.range 4).mapM fun _ => Handle.mk path .read
+  let tasks ← hs.mapM (·.readAsync 5)
+  for t in tasks do
+    unless (← IO.ofExcept t.get).data == "hello".toUTF8.data do
+      throw <| IO.userError "unexpected chunk"
+  IO.FS.removeFile path
+
+#eval test
@@ -0,0 +1,28 @@
+open IO FS
+
+def bytes (s : String) : ByteArray := s.toUTF8
+
+def test : IO Unit := do
+  let path : System.FilePath := "handleVectoredIO.tmp"
+  -- small chunks go through the handle buffer, large ones through `writev`
+  let small := (List.range 100).toArray.map fun i => bytes s!"{i};"
+  let large := (List.range 100).toArray.map fun i => bytes (String.mk (List.replicate 1000 (Char.ofNat (97 + i % 26))))
+  let h ← Handle.mk path .write
+  h.writeMany small
+  h.writeMany (#[ByteArray.empty] ++ large ++ #[ByteArray.empty])
+  h.flush
+  let expected := small.foldl (· ++ ·) .empty ++ large.foldl (· ++ ·) .empty
+  unless (← IO.FS.readBinFile path).data == expected.data do
+    throw <| IO.userError "unexpected contents after writeMany"
+  -- positional I/O
+  let h ← Handle.mk path .readWrite
+  h.writeAt 2 (bytes "XY")
+  unless (← h.readAt 0 5).data == (bytes "0;XY2").data do
+    throw <| IO.userError "unexpected readAt"
+  unless (← h.readAt expected.size.toUInt64 5).isEmpty do
+    throw <| IO.userError "expected EOF"
+  unless (← h.readAt (expected.size - 2).toUInt64 5).size == 2 do
+    throw <| IO.userError "expected partial read"
+  IO.FS.removeFile path
+
+#eval test
@@ -0,0 +1,40 @@
+import Lean
+open Lean Meta
+
+/-! Assignment chains, beta reduction of instantiated heads, and delayed assignments. -/
+
+run_meta do
+  let nat := mkConst ``Nat
+  let m₁ ← mkFreshExprMVar nat
+  let m₂ ← mkFreshExprMVar nat
+  m₁.mvarId!.assign (mkApp (mkConst ``Nat.succ) m₂)
+  m₂.mvarId!.assign (mkNatLit 1)
+  let e ← instantiateMVars (mkApp2 (mkConst ``Nat.add) m₁ m₁)
+  unless e == mkApp2 (mkConst ``Nat.add) (mkApp (mkConst ``Nat.succ) (mkNatLit 1)) (mkApp (mkConst ``Nat.succ) (mkNatLit 1)) do
+    throwError "unexpected result {e}"
+  -- The instantiated value is written back to the assignment of `m₁`
+  let some v ← getExprMVarAssignment? m₁.mvarId! | throwError "not assigned"
+  unless v == mkApp (mkConst ``Nat.succ) (mkNatLit 1) do
+    throwError "unexpected assignment {v}"
+
+run_meta do
+  let nat := mkConst ``Nat
+  let f ← mkFreshExprMVar (← mkArrow nat nat)
+  f.mvarId!.assign (.lam `x nat (mkApp (mkConst ``Nat.succ) (.bvar 0)) .default)
+  let e ← instantiateMVars (mkApp f (mkNatLit 2))
+  unless e == mkApp (mkConst ``Nat.succ) (mkNatLit 2) do
+    throwError "unexpected result {e}"
+
+run_meta do
+  let nat := mkConst ``Nat
+  withLocalDeclD `x nat fun x => do
+    let pending ← mkFreshExprMVar nat
+    let f ← mkFreshExprMVar (← mkArrow nat nat)
+    assignDelayedMVar f.mvarId! #[x] pending.mvarId!
+    let e := mkApp f (mkNatLit 3)
+    unless (← instantiateMVars e) == e do
+      throwError "delayed assignment applied too early"
+    pending.mvarId!.assign (mkApp2 (mkConst ``Nat.add) x x)
+    let e ← instantiateMVars e
+    unless e == mkApp2 (mkConst ``Nat.add) (mkNatLit 3) (mkNatLit 3) do
+      throwError "unexpected result {e}"
@@ -0,0 +1,15 @@
+/-! Long-running tail-recursive loops in the interpreter run in constant native stack space. -/
+
+def loop (n : Nat) (acc : UInt64) (k : UInt64) : UInt64 :=
+  if n == 0 then acc else loop (n - 1) (acc + k) k
+
+def loopApp (f : UInt64 → UInt64) (n : Nat) (acc : UInt64) : UInt64 :=
+  if n == 0 then acc else loopApp f (n - 1) (f acc)
+
+def test : IO Unit := do
+  let r := loop 5000000 0 3
+  unless r == 15000000 do throw <| IO.userError s!"unexpected result {r}"
+  let r := loopApp (· + 2) 5000000 0
+  unless r == 10000000 do throw <| IO.userError s!"unexpected result {r}"
+
+#eval test
@@ -0,0 +1,30 @@
+import Lean.Data.Json
+
+open Lean
+
+def check (input : String) (expected : Json) : IO Unit := do
+  match Json.parse input with
+  | .ok j =>
+    unless j == expected do
+      throw <| IO.userError s!"unexpected result {j.compress} for {input}"
+    unless Json.parse j.compress == .ok j do
+      throw <| IO.userError s!"round trip failed for {input}"
+  | .error e => throw <| IO.userError e
+
+#eval Json.nextSpecialPos "abcdefghijkl\"mn" 0 == ⟨12⟩
+#eval Json.nextSpecialPos "αβγδεζηθ\\" 0 == ⟨16⟩
+#eval Json.nextSpecialPos "abc" 1 == ⟨3⟩
+
+#eval check "\"\"" (.str "")
+#eval check "\"plain text that is longer than a word\"" (.str "plain text that is longer than a word")
+#eval check "\"tab\\tquote\\\"backslash\\\\\"" (.str "tab\tquote\"backslash\\")
+#eval check "\"\\u00e9\\u00C9 ümlaut\"" (.str "éÉ ümlaut")
+#eval check "{\"key with \\n newline\": [\"a\", \"b\\u0001\"]}"
+  (Json.mkObj [("key with \n newline", Json.arr #["a", "b\x01"])])
+#eval check s!"\"{String.mk (List.replicate 1000 'x')}\\n{String.mk (List.replicate 1000 'y')}\""
+  (.str (String.mk (List.replicate 1000 'x') ++ "\n" ++ String.mk (List.replicate 1000 'y')))
+
+-- control characters must be escaped
+#eval match Json.parse "\"a\x01\"" with
+  | .ok _ => throw <| IO.userError "expected error"
+  | .error _ => pure ()
@@ -0,0 +1,12 @@
+set_option kernel.async true
+
+theorem t1 : 2 ^ 64 + 1 = 18446744073709551617 := by decide
+theorem t2 (n : Nat) : n + 0 = n := rfl
+theorem t3 : 2 ^ 64 + 1 = 18446744073709551617 ∧ ∀ n : Nat, n + 0 = n := ⟨t1, t2⟩
+
+example : (10 : Nat) + 0 = 10 := t2 10
+
+#print axioms t3
+
+set_option kernel.async false in
+theorem t4 : True := trivial
@@ -0,0 +1,22 @@
+/-!
+`LEAN_KERNEL_MAX_SHARING=n` makes the kernel maximally share the types and values with at least `n` subterms before
+checking them, which `--kernel-stats` reports.
+-/
+
+def input := "def f (n : Nat) : Nat := (n + 1) * (n + 1) + (n + 1)
+
+theorem f_eq (n : Nat) : f n = (n + 1) * (n + 1) + (n + 1) := rfl
+"
+
+#eval show IO Unit from do
+  let file : System.FilePath := "kernelMaxSharing.lean.input"
+  IO.FS.writeFile file input
+  let lean ← IO.appPath
+  let run := IO.Process.output {
+    cmd  := lean.toString
+    args := #["--kernel-stats", file.toString]
+    env  := #[("LEAN_KERNEL_MAX_SHARING", "1")]
+  }
+  let out ← tryFinally run (IO.FS.removeFile file)
+  unless out.exitCode == 0 && (out.stderr.splitOn "max_sharing: ").length > 1 do
+    throw <| IO.userError s!"terms were not shared:\n{out.stdout}{out.stderr}"
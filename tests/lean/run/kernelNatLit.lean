@@ -0,0 +1,21 @@
+import Lean
+
+open Lean
+
+def checkWhnf (e : Expr) (expected : Nat) : CoreM Unit := do
+  let r ← ofExceptKernelException (Kernel.whnf (← getEnv) {} e)
+  unless r == mkRawNatLit expected do
+    throwError "unexpected whnf result {r}, expected {expected}"
+
+def binOp (op : Name) (a b : Nat) : Expr :=
+  mkApp2 (mkConst op) (mkRawNatLit a) (mkRawNatLit b)
+
+#eval checkWhnf (binOp ``Nat.pow 2 1000) (2^1000)
+#eval checkWhnf (binOp ``Nat.gcd (2^200 * 3^5) (6^100)) (2^100 * 3^5)
+#eval checkWhnf (mkApp (mkConst ``Nat.log2) (mkRawNatLit (2^300 + 1))) 300
+#eval checkWhnf (binOp ``Nat.land (2^100 + 12) (2^100 + 10)) (2^100 + 8)
+#eval checkWhnf (binOp ``Nat.lor (2^100) 5) (2^100 + 5)
+#eval checkWhnf (binOp ``Nat.xor (2^100 + 6) 3) (2^100 + 5)
+#eval checkWhnf (binOp ``Nat.shiftLeft 3 200) (3 * 2^200)
+#eval checkWhnf (binOp ``Nat.shiftRight (2^200 + 2^150) 150) (2^50 + 1)
+
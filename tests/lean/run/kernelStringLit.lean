@@ -0,0 +1,25 @@
+import Lean
+
+open Lean
+
+def checkWhnf (e expected : Expr) : CoreM Unit := do
+  let env ← getEnv
+  let r ← ofExceptKernelException (Kernel.whnf env {} e)
+  unless (← ofExceptKernelException (Kernel.isDefEq env {} r expected)) do
+    throwError "unexpected whnf result {r}, expected {expected}"
+
+def str (s : String) : Expr := mkStrLit s
+
+#eval checkWhnf (mkApp (mkConst ``String.length) (str "αβγ abc")) (mkRawNatLit 7)
+#eval checkWhnf (mkApp (mkConst ``String.utf8ByteSize) (str "αβγ abc")) (mkRawNatLit 10)
+#eval checkWhnf (mkApp2 (mkConst ``String.append) (str "foo") (str "bär")) (str "foobär")
+#eval checkWhnf (mkApp2 (mkConst ``String.get) (str "aβc") (mkApp (mkConst ``String.Pos.mk) (mkRawNatLit 3)))
+  (mkApp (mkConst ``Char.ofNat) (mkRawNatLit 'c'.toNat))
+-- not at the beginning of a character
+#eval checkWhnf (mkApp2 (mkConst ``String.get) (str "aβc") (mkApp (mkConst ``String.Pos.mk) (mkRawNatLit 2)))
+  (mkApp (mkConst ``Char.ofNat) (mkRawNatLit 'A'.toNat))
+
+theorem ex1 : "hello world".length = 11 := rfl
+theorem ex2 : "hello " ++ "world" = "hello world" := by decide
+theorem ex3 : "hello".get ⟨1⟩ = 'e' := rfl
+theorem ex4 : "hello" ≠ "world" := by decide
@@ -0,0 +1,20 @@
+import Lean
+open Lean
+
+def check (b : Bool) (msg : String) : IO Unit :=
+  unless b do throw <| IO.userError msg
+
+#eval show IO Unit from do
+  let ids := (List.range 100).toArray.map fun i => FVarId.mk (.num `_test i)
+  let mut lctx : LocalContext := {}
+  for id in ids do
+    lctx := lctx.mkLocalDecl id id.name (mkConst ``Nat)
+  for id in ids do
+    check ((lctx.find? id).map (·.fvarId) == some id) s!"{id.name} not found"
+  check (lctx.find? ⟨`_test⟩).isNone "unexpected declaration"
+  -- erased and modified declarations among the most recent ones
+  let lctx := lctx.erase ids[98]!
+  check (lctx.find? ids[98]!).isNone "erased declaration found"
+  let lctx := lctx.setUserName ids[99]! `y
+  check ((lctx.find? ids[99]!).map (·.userName) == some `y) "outdated declaration found"
+  check ((lctx.find? ids[97]!).map (·.index) == some 97) "wrong index"
@@ -0,0 +1,29 @@
+open IO FS
+
+def test : IO Unit := do
+  let path : System.FilePath := "mmapFile.tmp"
+  let contents := String.join ((List.range 1000).map fun i => s!"{i},")
+  IO.FS.writeFile path contents
+  let m ← IO.FS.mmap path
+  unless m.size == contents.utf8ByteSize do
+    throw <| IO.userError s!"unexpected size {m.size}"
+  unless (m.extract 0 m.size).data == contents.toUTF8.data do
+    throw <| IO.userError "unexpected contents"
+  unless (m.extract 2 6).data == "1,2,".toUTF8.data && (m.extract 5 1000000).size == m.size - 5 do
+    throw <| IO.userError "unexpected extract"
+  unless m.getD 0 7 == '0'.toNat.toUInt8 && m.getD m.size 7 == 7 do
+    throw <| IO.userError "unexpected getD"
+  unless m.indexOf? ','.toNat.toUInt8 == some 1 && m.indexOf? ','.toNat.toUInt8 3 == some 3 && m.indexOf? ','.toNat.toUInt8 4 == some 5 && m.indexOf? 0 == none do
+    throw <| IO.userError "unexpected indexOf?"
+  let commas := m.foldl (init := 0) fun n b => if b == ','.toNat.toUInt8 then n + 1 else n
+  unless commas == 1000 do
+    throw <| IO.userError s!"unexpected number of commas {commas}"
+  let emptyPath : System.FilePath := "mmapFileEmpty.tmp"
+  IO.FS.writeFile emptyPath ""
+  let e ← IO.FS.mmap emptyPath
+  unless e.size == 0 && (e.extract 0 10).size == 0 && e.indexOf? 0 == none do
+    throw <| IO.userError "unexpected empty mapping"
+  IO.FS.removeFile path
+  IO.FS.removeFile emptyPath
+
+#eval test
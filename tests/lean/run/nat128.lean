@@ -0,0 +1,12 @@
+-- Arithmetic on `Nat`s just above the scalar range, which uses the 128-bit fast paths of the runtime.
+def m : Nat := 2^64 - 1
+
+#eval show IO Unit from do
+  assert! m * m == 340282366920938463426481119284349108225
+  assert! m * m + m == m * (m + 1)
+  assert! (m * m) - (m * m - 1) == 1
+  assert! (m + 1) - (m + 2) == 0
+  assert! (2^127 + 2^127) == 2^128
+  assert! (2^128 - 1) + 1 == 2^128
+  assert! (2^100) * (2^100) == 2^200
+  assert! (0xFFFFFFFFFFFFFFFF : UInt64).toNat * 3 == 3 * m
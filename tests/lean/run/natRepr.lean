@@ -0,0 +1,22 @@
+/-! The runtime implementations of `Nat.repr` and `String.toNat?` agree with their reference implementations. -/
+
+def check (name : String) (ok : Bool) : IO Unit :=
+  unless ok do throw <| IO.userError s!"{name} differs from the reference implementation"
+
+def refToNat? (s : String) : Option Nat :=
+  if s.isNat then some <| s.foldl (fun n c => n*10 + (c.toNat - '0'.toNat)) 0 else none
+
+def numbers : List Nat :=
+  [0, 1, 9, 10, 99, 100, 101, 12345678, 99999999, 100000000, 2^32, 2^63 - 1, 2^63, 2^64 - 1, 2^64,
+   10^19 - 1, 10^19, 10^40 + 7]
+
+def checkAll : IO Unit := do
+  for n in numbers do
+    check s!"Nat.repr {n}" (Nat.repr n == (Nat.toDigits 10 n).asString)
+    check s!"toNat? (repr {n})" (n.repr.toNat? == some n)
+  for s in ["", "0", "007", "12a", "a12", "1234567/", "1234567:", "12345678x", "١٢", "9999999999999999999",
+            "99999999999999999999", "123456789012345678901234567890x", " 1"] do
+    check s!"toNat? {repr s}" (s.toNat? == refToNat? s)
+  check "Int.repr" ((-1234567 : Int).repr == "-1234567")
+
+#eval checkAll
@@ -0,0 +1,9 @@
+import Lean
+open Lean
+
+-- the statistics are only printed, check that walking the objects of an environment succeeds
+#eval show IO Unit from do
+  let env ← mkEmptyEnvironment
+  let .ok env := env.addDecl (.axiomDecl { name := `a, levelParams := [], type := .sort 1, isUnsafe := false })
+    | throw <| IO.userError "failed to add axiom"
+  env.displayObjectStats
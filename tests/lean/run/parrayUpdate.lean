@@ -0,0 +1,30 @@
+import Lean.Data.PersistentArray
+open Lean
+
+def build (n : Nat) : PArray Nat := Id.run do
+  let mut a : PArray Nat := {}
+  for i in [:n] do
+    a := a.push i
+  return a
+
+def tst : IO Unit := do
+  let n := 5000
+  let a := build n
+  assert! a.size == n
+  assert! a.toList == List.range n
+  let mut b := a
+  for i in [:n] do
+    b := b.set i (2 * i)
+  assert! b.toList == (List.range n).map (2 * ·)
+  -- `a` is shared with `b`, and must not be affected by the updates
+  assert! a.toList == List.range n
+  let c := (List.range n).foldl (init := b) fun c i => c.modify i (· + 1)
+  assert! c.toList == (List.range n).map (2 * · + 1)
+  let mut d := c
+  for _ in [:n - 10] do
+    d := d.pop
+  assert! d.size == 10
+  assert! d.toList == (List.range 10).map (2 * · + 1)
+  IO.println "done"
+
+#eval tst
@@ -0,0 +1,24 @@
+set_option parseAhead true
+
+def f (x : Nat) := x + 1
+
+theorem f_eq (x : Nat) : f x = x + 1 := rfl
+
+-- the following commands change the parser, so the commands after them must not use the speculative parse
+infixl:65 " +++ " => fun a b => f a + b
+
+example : 1 +++ 2 = 4 := rfl
+
+namespace Foo
+scoped notation "foo!" => 42
+end Foo
+
+open Foo
+
+example : foo! = 42 := rfl
+
+section
+local syntax "bar!" : term
+local macro_rules | `(bar!) => `(0)
+example : bar! = 0 := rfl
+end
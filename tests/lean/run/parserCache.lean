@@ -0,0 +1,30 @@
+import Lean
+open Lean Parser
+
+def parseTermTwice (input : String) : CoreM (Syntax × Syntax × Nat) := do
+  let c := mkParserContext (mkInputContext input "<input>") { env := (← getEnv), options := {} }
+  let s := termParser.fn c (mkParserState input)
+  let stx₁ := s.stxStack.back
+  let s := termParser.fn c (s.restore 0 0)
+  return (stx₁, s.stxStack.back, s.cache.hits)
+
+#eval show CoreM Unit from do
+  let (stx₁, stx₂, hits) ← parseTermTwice "fun x => x + if x > 0 then (x, 1) else (0, x)"
+  unless stx₁ == stx₂ && hits > 0 do
+    throwError "unexpected result {stx₂}, hits: {hits}"
+
+-- the result of an erroneous parse is replayed as well
+#eval show CoreM Unit from do
+  let (stx₁, stx₂, _) ← parseTermTwice "(1 + "
+  unless stx₁ == stx₂ do
+    throwError "unexpected result {stx₂}"
+
+-- `open ... in` changes the token table, and must not reuse results from outside
+namespace Foo
+scoped syntax "foo!" : term
+scoped macro_rules | `(foo!) => `(1)
+end Foo
+
+example : (open Foo in foo!) = 1 := rfl
+
+example : (fun (x : Nat) => by first | exact x + 1 | exact x) 1 = 2 := rfl
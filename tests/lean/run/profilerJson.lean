@@ -0,0 +1,17 @@
+import Lean
+
+set_option profiler.json "profilerJson.jsonl"
+
+def f (n : Nat) : Nat := n + 1
+
+#eval show IO Unit from do
+  let lines := (← IO.FS.lines "profilerJson.jsonl").filter (· != "")
+  IO.FS.removeFile "profilerJson.jsonl"
+  let records ← lines.mapM fun l => IO.ofExcept (Lean.Json.parse l)
+  unless records.any (·.getObjValAs? String "category" == .ok "elaboration") do
+    throw <| IO.userError s!"no elaboration record in {lines}"
+  for r in records do
+    let .ok start := r.getObjValAs? Nat "start" | throw <| IO.userError s!"missing start: {r}"
+    let .ok stop := r.getObjValAs? Nat "end" | throw <| IO.userError s!"missing end: {r}"
+    unless start ≤ stop do
+      throw <| IO.userError s!"invalid span: {r}"
@@ -0,0 +1,20 @@
+import Lean
+
+set_option profiler.json "profilerTactics.jsonl"
+set_option profiler.tactics true
+
+theorem foo (a b : Nat) (h : a = b) : b = a := by
+  subst h
+  rfl
+
+set_option profiler.tactics false
+set_option profiler.json ""
+
+#eval show IO Unit from do
+  let lines := (← IO.FS.lines "profilerTactics.jsonl").filter (· != "")
+  IO.FS.removeFile "profilerTactics.jsonl"
+  let records ← lines.mapM fun l => IO.ofExcept (Lean.Json.parse l)
+  unless records.any fun r =>
+      r.getObjValAs? String "category" == .ok "tactic Lean.Parser.Tactic.subst" &&
+      r.getObjValAs? String "decl" == .ok "foo" do
+    throw <| IO.userError s!"no record of 'subst' in {lines}"
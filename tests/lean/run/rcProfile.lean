@@ -0,0 +1,17 @@
+import Lean
+open Lean IR
+
+def countAbove (xs : List Nat) (n : Nat) : Nat :=
+  xs.foldl (fun c x => if x > n then c + 1 else c) 0
+
+#eval show CoreM Unit from do
+  let .ok c := emitC (← getEnv) `rcProfile (rcProfile := true) | throwError "emitC failed"
+  unless (c.splitOn "LEAN_RC_SITE(\"countAbove\", \"entry\", \"x\");").length == 2 do
+    throwError "missing entry counter"
+
+#eval show IO Unit from do
+  let prof := RCProfile.parse "test" "countAbove\tentry\tx\t10\ncountAbove\tdec\tp0\t4\ncountAbove\tdec\tp0\t2\n"
+  assert! prof.entries `countAbove == 10
+  assert! prof.paramCount `countAbove "dec" 0 == 6
+  assert! prof.paramCount `countAbove "dec" 1 == 0
+  assert! prof.entries `other == 0
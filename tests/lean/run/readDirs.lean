@@ -0,0 +1,30 @@
+open IO FS System
+
+def test : IO Unit := do
+  let root : FilePath := "readDirs.tmp"
+  if ← root.pathExists then
+    removeDirAll root
+  for i in [0:5] do
+    let dir := root / s!"d{i}" / "sub"
+    createDirAll dir
+    writeFile (root / s!"d{i}" / s!"f{i}.olean") ""
+    writeFile (dir / s!"g{i}.ilean") ""
+    writeFile (dir / s!"h{i}.txt") ""
+  let entries ← readDirs #[root / "d0", root / "d1"]
+  unless entries.size == 4 && (entries.filter (·.type == .dir)).size == 2 do
+    throw <| IO.userError s!"unexpected entries {repr entries}"
+  let collected ← IO.mkRef (#[] : Array FilePath)
+  root.walkDirBatched (exts := #["ilean"]) fun es =>
+    collected.modify (· ++ (es.filter (·.type == .file)).map (·.path))
+  let files := (← collected.get).map (·.fileName.getD "")
+  unless files.qsort (· < ·) == #["g0.ilean", "g1.ilean", "g2.ilean", "g3.ilean", "g4.ilean"] do
+    throw <| IO.userError s!"unexpected files {files}"
+  -- `enter` prunes the traversal
+  let count ← IO.mkRef 0
+  root.walkDirBatched (enter := fun p => return p.fileName != some "sub") fun es =>
+    count.modify (· + es.size)
+  unless (← count.get) == 15 do
+    throw <| IO.userError s!"unexpected count {← count.get}"
+  removeDirAll root
+
+#eval test
@@ -0,0 +1,6 @@
+import Lean
+
+-- `lean --replay Init.Prelude`
+#eval show IO Unit from do
+  unless (← Lean.replayModules #["Init.Prelude"]) == 0 do
+    throw <| IO.userError "replay failed"
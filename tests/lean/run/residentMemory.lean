@@ -0,0 +1,3 @@
+#eval show IO Unit from do
+  unless (← IO.getResidentMemory) > 0 do
+    throw <| IO.userError "expected a positive resident set size"
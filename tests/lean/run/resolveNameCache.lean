@@ -0,0 +1,55 @@
+/-! Name resolution results must not be reused after the namespace, open declarations, or constants change. -/
+
+def Foo.x := 1
+def Boo.x := "a"
+
+namespace Test
+def y := 2
+example : y = 2 := rfl
+end Test
+
+example : Foo.x = 1 := rfl
+
+section
+open Foo
+example : x = 1 := rfl
+def Test.z := x
+end
+
+section
+open Boo
+example : x = "a" := rfl
+end
+
+-- `y` was resolved before `Test2.y` existed
+namespace Test2
+def v := Test.y
+def y := "b"
+example : y = "b" := rfl
+end Test2
+
+-- aliases added by `export`
+namespace Bar
+export Foo (x)
+end Bar
+example : Bar.x = 1 := rfl
+
+protected def Foo.w := 3
+section
+open Foo
+example : Foo.w = 3 := rfl
+end
+
+/-! A second resolution of the same identifier is answered by the cache, which is dropped by new constants. -/
+open Lean Elab Command in
+#eval show CommandElabM Unit from do
+  discard <| resolveGlobalName `Foo.x
+  modify fun s => { s with resolveNameCache.entries := s.resolveNameCache.entries.insert `Foo.x [(`Boo.x, [])] }
+  let r ← resolveGlobalName `Foo.x
+  unless r == [(`Boo.x, [])] do throwError "expected a cache hit, got {r}"
+  liftCoreM <| addDecl <| .defnDecl {
+    name := `Foo.fresh, levelParams := [], type := mkConst ``Nat, value := mkNatLit 1
+    hints := .abbrev, safety := .safe }
+  unless (← get).resolveNameCache.entries.isEmpty do throwError "expected an empty cache"
+  let r ← resolveGlobalName `Foo.x
+  unless r == [(`Foo.x, [])] do throwError "expected `Foo.x`, got {r}"
@@ -0,0 +1,33 @@
+inductive Tree where
+  | leaf
+  | node (l : Tree) (size : Nat) (r : Tree)
+
+def Tree.size : Tree → Nat
+  | .leaf       => 0
+  | .node _ n _ => n
+
+-- not inlined by the code generator, but by the IR before inserting reset/reuse instructions
+def mkNode (l r : Tree) : Tree :=
+  .node l (l.size + r.size + 1) r
+
+def Tree.mirror : Tree → Tree
+  | .node l _ r => mkNode r.mirror l.mirror
+  | .leaf       => .leaf
+
+def Tree.build : Nat → Tree
+  | 0     => .leaf
+  | n + 1 => mkNode (Tree.build n) .leaf
+
+def Tree.leftDepth : Tree → Nat
+  | .node l _ _ => l.leftDepth + 1
+  | .leaf       => 0
+
+set_option compiler.stats true in
+def test : IO Unit := do
+  let t := Tree.build 10
+  assert! t.size == 10 && t.leftDepth == 10
+  let t := t.mirror
+  assert! t.size == 10 && t.leftDepth == 1
+  assert! t.mirror.leftDepth == 10
+
+#eval test
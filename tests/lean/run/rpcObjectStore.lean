@@ -0,0 +1,38 @@
+import Lean.Server.Rpc.Basic
+open Lean Server
+
+def check (b : Bool) (msg : String) : IO Unit :=
+  unless b do throw <| IO.userError msg
+
+#eval show IO Unit from do
+  let act : StateM RpcObjectStore (Array Lsp.RpcRef × Bool × Bool × Bool × Option Nat) := do
+    let r0 ← rpcStoreRef (.mk (0 : Nat))
+    let r1 ← rpcStoreRef (.mk (1 : Nat))
+    let released ← rpcReleaseRef r0
+    let releasedTwice ← rpcReleaseRef r0
+    -- reuses the slot of `r0` with a new generation
+    let r2 ← rpcStoreRef (.mk (2 : Nat))
+    let st ← get
+    let stale := (rpcGetRef r0 st).isNone
+    let v2 := (rpcGetRef r2 st) >>= (·.get? Nat)
+    return (#[r0, r1, r2], released, releasedTwice, stale, v2)
+  let ((refs, released, releasedTwice, stale, v2), st) := act.run {}
+  check released "release failed"
+  check (!releasedTwice) "released twice"
+  check stale "stale reference is valid"
+  check (v2 == some 2) "wrong object"
+  check (refs[0]! != refs[2]!) "reference reused"
+  check (st.slots.size == 2) "slot not reused"
+  check (((rpcGetRef refs[1]! st) >>= (·.get? Nat)) == some 1) "wrong object"
+
+#eval show IO Unit from do
+  -- a slot whose generation is exhausted is not reused
+  let lastGeneration := (1 <<< RpcObjectStore.generationBits) - 1
+  let st : RpcObjectStore := { slots := #[{ generation := lastGeneration, obj? := some (.mk (0 : Nat)) }] }
+  let r0 := RpcObjectStore.mkRef 0 lastGeneration
+  check (r0.p.toNat < 2^53) "reference is not an exact JSON number"
+  let (released, st) := (rpcReleaseRef r0).run st
+  check released "release failed"
+  let (r1, st) := (rpcStoreRef (.mk (1 : Nat))).run st
+  check (st.slots.size == 2) "exhausted slot reused"
+  check (r1 == RpcObjectStore.mkRef 1 0) "wrong slot"
@@ -0,0 +1,33 @@
+/-!
+`lean --sample-profile=file` writes the samples as folded stacks to `file` and their heartbeats to
+`file.heartbeats`.
+-/
+
+def input := "def sum (n : Nat) : Nat := (List.range n).foldl (· + ·) 0
+
+theorem sum_eq : sum 100 = 4950 := by decide
+"
+
+#eval show IO Unit from do
+  -- sampling is not supported on Windows
+  if System.Platform.isWindows then return
+  let file : System.FilePath := "sampleProfile.lean.input"
+  let profile : System.FilePath := "sampleProfile.lean.folded"
+  let heartbeats : System.FilePath := "sampleProfile.lean.folded.heartbeats"
+  IO.FS.writeFile file input
+  let lean ← IO.appPath
+  let run := IO.Process.output {
+    cmd  := lean.toString
+    args := #[s!"--sample-profile={profile}", file.toString]
+  }
+  let out ← tryFinally run (IO.FS.removeFile file)
+  unless out.exitCode == 0 do
+    throw <| IO.userError s!"lean failed:\n{out.stdout}{out.stderr}"
+  unless (← profile.pathExists) && (← heartbeats.pathExists) do
+    throw <| IO.userError "sample profile was not written"
+  let lines := (← IO.FS.lines profile).filter (· != "")
+  IO.FS.removeFile profile
+  IO.FS.removeFile heartbeats
+  -- every folded stack starts at the root frame and ends with its number of samples
+  unless lines.all fun l => l.startsWith "lean" && (l.splitOn " ").getLast!.isNat do
+    throw <| IO.userError s!"invalid folded stacks:\n{lines}"
@@ -0,0 +1,25 @@
+import Lean.Util.Path
+
+open Lean System
+
+def test : IO Unit := do
+  let root : FilePath := "searchPathCache.tmp"
+  if ← root.pathExists then
+    IO.FS.removeDirAll root
+  let sp : SearchPath := [root / "a", root / "b"]
+  IO.FS.createDirAll (root / "a")
+  IO.FS.createDirAll (root / "b" / "Pkg")
+  for _ in [0:2] do
+    unless (← sp.findWithExt "olean" `Pkg.Foo) == some (root / "b" / "Pkg" / "Foo.olean") do
+      throw <| IO.userError "unexpected path"
+  -- cached entries are revalidated
+  IO.FS.removeDirAll (root / "b" / "Pkg")
+  IO.FS.createDirAll (root / "a" / "Pkg")
+  unless (← sp.findWithExt "olean" `Pkg.Foo) == some (root / "a" / "Pkg" / "Foo.olean") do
+    throw <| IO.userError "unexpected path after moving package"
+  IO.FS.removeDirAll (root / "a" / "Pkg")
+  unless (← sp.findWithExt "olean" `Pkg.Foo) == none do
+    throw <| IO.userError "expected missing package"
+  IO.FS.removeDirAll root
+
+#eval test
@@ -0,0 +1,20 @@
+set_option simp.persistentCache true
+
+def f (x : Nat) : Nat := x + 0
+
+@[simp] theorem f_eq (x : Nat) : f x = x := by simp [f]
+
+example (x y : Nat) (h : x = y) : f (f x) + f y = y + y := by
+  simp
+  simp [h]
+
+example (x y : Nat) : f (f x) + f y = x + y := by
+  simp
+
+-- `x` has a different type here, so the entries for `f x` above must not be used
+example (x : Nat) (h : f (f x) = 1) : x = 1 := by
+  simp at h
+  exact h
+
+example (p : Prop) [Decidable p] (x : Nat) : (if p then f x else f x) = x := by
+  simp
@@ -0,0 +1,14 @@
+def checkStats (global : Bool) : IO Unit := do
+  let xs := (List.range 1000).toArray.map fun i => toString i
+  let st ← IO.getSmallAllocStats global
+  unless st.numHeaps ≥ 1 && st.numSegments ≥ st.numHeaps do
+    throw <| IO.userError s!"unexpected number of heaps/segments: {repr st}"
+  unless st.slots.any (·.liveBytes > 0) do
+    throw <| IO.userError "no live objects reported"
+  for slot in st.slots do
+    unless slot.numPartialPages ≤ slot.numPages do
+      throw <| IO.userError s!"unexpected slot statistics: {repr slot}"
+  IO.println xs.size
+
+#eval checkStats false
+#eval checkStats true
@@ -0,0 +1,23 @@
+/-! Code compiled with limits on specialization behaves the same. -/
+
+def sumWith [Add α] [OfNat α 0] (xs : List α) : α :=
+  xs.foldl (· + ·) 0
+
+def addAll (n : Nat) : StateM Nat Unit := do
+  for i in [0:n] do
+    modify (· + i)
+
+def runState (n : Nat) : Nat :=
+  (addAll n |>.run 0).2
+
+set_option compiler.specialize_budget 1 in
+def f1 (n : Nat) : Nat := sumWith (List.range n) + runState n
+
+set_option compiler.specialize_max_size 1 in
+def f2 (n : Nat) : Nat := sumWith (List.range n) + runState n
+
+def f3 (n : Nat) : Nat := sumWith (List.range n) + runState n
+
+example : f1 100 = 9900 := by native_decide
+example : f2 100 = 9900 := by native_decide
+example : f3 100 = 9900 := by native_decide
@@ -0,0 +1,27 @@
+import Lean.Data.HashMap
+
+/-! Long strings cache their hash, which must be reset when they are updated in place. -/
+
+def check (name : String) (ok : Bool) : IO Unit :=
+  unless ok do throw <| IO.userError s!"{name}: cached hash is stale"
+
+/-- The hash of `s` computed from a fresh copy of its characters. -/
+@[noinline] def freshHash (s : String) : UInt64 :=
+  hash (String.mk s.data)
+
+def main : IO Unit := do
+  let mut s := String.mk (List.replicate 300 'a')
+  for i in [0:50] do
+    -- cache the hash, then update the string in place
+    check "hash" (hash s == freshHash s)
+    s := s.push 'b'
+    check "push" (hash s == freshHash s)
+    s := s ++ toString i
+    check "append" (hash s == freshHash s)
+    s := s.set 0 'c'
+    check "set" (hash s == freshHash s)
+  let m : Lean.HashMap String Nat := (List.range 100).foldl (init := {}) fun m i =>
+    m.insert (String.mk (List.replicate 200 'x') ++ toString i) i
+  check "HashMap" <| (List.range 100).all fun i => m.find? (String.mk (List.replicate 200 'x') ++ toString i) == some i
+
+#eval main
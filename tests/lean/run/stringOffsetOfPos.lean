@@ -0,0 +1,11 @@
+def checkOffsets (s : String) : IO Unit := do
+  for i in [0:s.utf8ByteSize + 2] do
+    let expected := String.offsetOfPosAux s ⟨i⟩ 0 0
+    let r := s.offsetOfPos ⟨i⟩
+    unless r == expected do
+      throw <| IO.userError s!"offsetOfPos {repr s} {i} = {r}, expected {expected}"
+
+#eval checkOffsets ""
+#eval checkOffsets "hello"
+#eval checkOffsets "αβγ abc 中文 😀!"
+#eval checkOffsets (String.join (List.replicate 40 "aé中😀"))
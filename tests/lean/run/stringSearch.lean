@@ -0,0 +1,30 @@
+/-! The runtime implementations of the string search functions agree with their reference implementations. -/
+
+def inputs : List String :=
+  ["", "a", "aab", "abab", "a,b,,c,", ",", "αβγ,αβ,", "中文 中文中", "😀a😀😀b", "xxxyxxxxy"]
+
+def patterns : List String :=
+  ["", "a", "ab", ",", "aab", "αβ", "中", "😀", "😀😀", "xxy", "xxxxxxxxxxxxxxxxxxxx"]
+
+def check (name : String) (ok : Bool) : IO Unit :=
+  unless ok do throw <| IO.userError s!"{name} differs from the reference implementation"
+
+def checkAll : IO Unit := do
+  for s in inputs do
+    for p in patterns do
+      let refSplit := if p == "" then [s] else String.splitOnAux s p 0 0 0 []
+      check s!"{repr s}.splitOn {repr p}" (s.splitOn p == refSplit)
+      let refReplace := if p.isEmpty then s else String.replaceAux s p "<>" "" 0 0
+      check s!"{repr s}.replace {repr p}" (s.replace p "<>" == refReplace)
+      check s!"{repr s}.startsWith {repr p}" (s.startsWith p == (s.toSubstring.take p.length == p.toSubstring))
+      check s!"{repr s}.endsWith {repr p}" (s.endsWith p == (s.toSubstring.takeRight p.length == p.toSubstring))
+    for c in ['a', ',', 'β', '中', '😀', 'z'] do
+      check s!"{repr s}.posOf {repr c}" (s.posOf c == String.posOfAux s c s.endPos 0)
+      check s!"{repr s}.contains {repr c}" (s.contains c == s.any (· == c))
+
+#eval checkAll
+
+-- a partial match may overlap with the next occurrence of the separator
+#eval check "splitOn overlap" ("aab".splitOn "ab" == ["a", ""] && "xxxyxxxxy".splitOn "xxy" == ["x", "xx", ""])
+#eval check "Substring.splitOn overlap" (("aab".toSubstring.splitOn "ab").map (·.toString) == ["a", ""])
+#eval check "replace length" (("aé".replace "é" "中文").length == 3)
@@ -0,0 +1,31 @@
+import Lean
+
+open Lean Meta
+
+set_option synthInstance.globalCache true
+
+class Foo (α : Type) where
+  val : Nat
+
+instance : Foo Nat := ⟨1⟩
+
+example : Foo.val Nat = 1 := rfl
+example : Foo.val Nat = 1 := rfl
+
+-- adding an instance must invalidate cached results
+instance (priority := high) : Foo Nat := ⟨2⟩
+
+example : Foo.val Nat = 2 := rfl
+
+class Bar (α : Type)
+
+def barNat : Expr := mkApp (mkConst ``Bar) (mkConst ``Nat)
+
+#eval show MetaM Unit from do
+  unless (← synthInstance? barNat).isNone do throwError "unexpected instance"
+
+-- cached failures are invalidated as well
+instance : Bar Nat := ⟨⟩
+
+#eval show MetaM Unit from do
+  unless (← synthInstance? barNat).isSome do throwError "expected an instance"
@@ -0,0 +1,37 @@
+def testParMap : IO Unit := do
+  let as := Array.range 10000
+  let t := as.parMap (· * 2)
+  assert! t.get == as.map (· * 2)
+  assert! (as.parMap (chunkSize := 7) toString).get == as.map toString
+  assert! ((#[] : Array Nat).parMap (· + 1)).get == #[]
+
+def testWaitAll : IO Unit := do
+  let ts := (List.range 20).toArray.map fun i => Task.spawn fun _ => i * i
+  assert! (← IO.waitAll ts) == (List.range 20).toArray.map fun i => i * i
+
+partial def spin : IO Unit := do
+  unless (← IO.checkCanceled) do
+    IO.sleep 1
+    spin
+
+def testTaskGroup : IO Unit := do
+  let g ← IO.TaskGroup.new
+  let r ← IO.mkRef 0
+  for _ in [0:4] do
+    discard <| g.spawn (prio := .dedicated) do
+      discard <| g.spawn (prio := .dedicated) spin
+      spin
+      r.modify (· + 1)
+  IO.sleep 10
+  g.cancel
+  assert! (← g.isCanceled)
+  g.wait
+  assert! (← r.get) == 4
+  -- tasks added after cancellation are canceled right away
+  let t ← g.spawn spin
+  g.wait
+  assert! (← IO.hasFinished t)
+
+#eval testParMap
+#eval testWaitAll
+#eval testTaskGroup
@@ -0,0 +1,25 @@
+import Lean
+open Lean Meta
+
+def g (n : Nat) : Nat := n + 1
+
+-- the cached result for `g x` must not be reused after the value of the let-variable `x` changes
+#eval show MetaM Unit from do
+  withLetDecl `x (mkConst ``Nat) (mkNatLit 1) fun x => do
+    let e := mkApp (mkConst ``g) x
+    let r₁ ← whnf e
+    let r₂ ← whnf e
+    unless r₁ == r₂ do throwError "unexpected {r₂}, expected {r₁}"
+  withLetDecl `x (mkConst ``Nat) (mkNatLit 2) fun x => do
+    let r ← whnf (mkNatSucc (mkApp (mkConst ``g) x))
+    unless r.isAppOf ``Nat.succ do throwError "unexpected {r}"
+  withLocalDeclD `y (mkConst ``Nat) fun y => do
+    let e := mkApp (mkConst ``g) y
+    let r₁ ← whnf e
+    let r₂ ← whnf e
+    unless r₁ == r₂ do throwError "unexpected {r₂}, expected {r₁}"
+
+example (x : Nat) (h : g x = x + 1) : g x = Nat.succ x := by
+  let y := x
+  show g y = _
+  exact h